@@ -0,0 +1,86 @@
+/*!
+ *  \file minmaxkernelbench.cpp
+ *  \brief Микробенчмарк ядер MinMaxKernel: значений в секунду для каждого варианта.
+ */
+#include "minmaxkernel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+/*!
+ *  \brief Измеряет производительность варианта на одном размере кадра.
+ *  \param[in] variant Вариант ядра.
+ *  \param[in] samples Значения.
+ *  \param[in] width Количество колонок.
+ *  \param[out] out Буфер пар min/max.
+ *  \return Значений в секунду.
+ */
+double measure(MinMaxKernel::Variant variant, const std::vector<float> &samples, int width, std::vector<float> &out)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto count = static_cast<std::int64_t>(samples.size());
+
+    // Прогрев и подбор числа повторов так, чтобы замер длился ~200 мс.
+    int repeats = 1;
+    for (;;) {
+        const auto start = Clock::now();
+        for (int r = 0; r < repeats; ++r) {
+            MinMaxKernel::decimate(variant, samples.data(), count, width, 0, width, out.data());
+        }
+        const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= 0.2) {
+            return static_cast<double>(count) * repeats / seconds;
+        }
+        repeats *= 2;
+    }
+}
+
+} // namespace
+
+/*!
+ *  \brief Запускает замеры для всех поддерживаемых вариантов.
+ *  \return 0 при совпадении результатов всех вариантов, иначе 1.
+ */
+int main()
+{
+    const int width = 1920;
+    const int binCounts[] = {4096, 65536, 262144, 1048576};
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> dist(-120.0f, 0.0f);
+
+    std::printf("best variant: %s\n", MinMaxKernel::variantName(MinMaxKernel::bestVariant()));
+    std::printf("%-10s %10s %8s %16s\n", "variant", "bins", "width", "bins/s");
+
+    int status = 0;
+    for (const int bins : binCounts) {
+        std::vector<float> samples(static_cast<size_t>(bins));
+        std::generate(samples.begin(), samples.end(), [&] { return dist(rng); });
+
+        std::vector<float> reference(static_cast<size_t>(width) * 2);
+        MinMaxKernel::decimate(MinMaxKernel::Variant::Scalar, samples.data(), bins, width, 0, width,
+                               reference.data());
+
+        for (int v = 0; v < MinMaxKernel::kVariantCount; ++v) {
+            const auto variant = static_cast<MinMaxKernel::Variant>(v);
+            if (!MinMaxKernel::isSupported(variant)) {
+                continue;
+            }
+            std::vector<float> out(reference.size());
+            const double rate = measure(variant, samples, width, out);
+            const bool identical = std::memcmp(out.data(), reference.data(), out.size() * sizeof(float)) == 0;
+            if (!identical) {
+                status = 1;
+            }
+            std::printf("%-10s %10d %8d %16.3e%s\n", MinMaxKernel::variantName(variant), bins, width, rate,
+                        identical ? "" : "  MISMATCH");
+        }
+    }
+    return status;
+}
@@ -0,0 +1,225 @@
+/*!
+ *  \file scenariosoak.cpp
+ *  \brief Нагрузочный прогон конвейера по сценарию без дисплея.
+ *
+ *  Время сценария идет в load раз быстрее настоящего: кадры, импульсы и
+ *  пеленги выдаются с кратно большей частотой. Кадры делятся между
+ *  потоками по номерам; каждый поток проводит свой кадр через весь
+ *  конвейер обработки (синтез, пирамида, обнаружение CA-CFAR, пеленгация,
+ *  сопровождение). Раз в секунду печатается достигнутая частота кадров и
+ *  задержки, в конце — итог; код завершения 2 означает, что машина не
+ *  выдержала заданную нагрузку.
+ */
+#include "bearingtracker.h"
+#include "directionfinder.h"
+#include "latencyhistogram.h"
+#include "scenariosimulator.h"
+#include "signaldetector.h"
+#include "spectrumframepool.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QThread>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+//! \brief Доля кадров, которую прогон обязан выдержать, чтобы считаться успешным.
+constexpr double kRequiredRateFraction = 0.95;
+
+//! \brief Общие счетчики прогона.
+struct SoakCounters
+{
+    //! \brief Обработанные кадры.
+    std::atomic<quint64> frames{0};
+    //! \brief Кадры, начатые позже своего срока больше чем на период.
+    std::atomic<quint64> lateFrames{0};
+    //! \brief Обнаруженные сигналы.
+    std::atomic<quint64> detections{0};
+    //! \brief Импульсы, переданные пеленгатору.
+    std::atomic<quint64> pulses{0};
+    //! \brief Полученные пеленги.
+    std::atomic<quint64> bearings{0};
+    //! \brief Длительность обработки кадра от синтеза до сопровождения.
+    LatencyHistogram processing;
+};
+
+/*!
+ *  \brief Обрабатывает кадры worker, worker + threads, ... до истечения времени.
+ *  \param[in] simulator Имитатор.
+ *  \param[in] worker Номер потока.
+ *  \param[in] threads Число потоков.
+ *  \param[in] periodSec Период кадров, с.
+ *  \param[in] start Начало прогона.
+ *  \param[in] stop Конец прогона.
+ *  \param[in,out] counters Счетчики.
+ */
+void runWorker(const ScenarioSimulator &simulator, int worker, int threads, double periodSec, Clock::time_point start,
+               Clock::time_point stop, SoakCounters &counters)
+{
+    const ScenarioSimulator::Scenario &scenario = simulator.scenario();
+    SpectrumFramePool pool(4, scenario.binCount);
+
+    SignalDetector detector;
+    SignalDetector::Settings detectorSettings;
+    detectorSettings.method = SignalDetector::Method::CellAveraging;
+    detector.setSettings(detectorSettings);
+    SignalDetector::Band band;
+    band.minHz = scenario.minHz;
+    band.maxHz = scenario.maxHz;
+    band.thresholdDb = scenario.noiseFloorDb + 10.0;
+    detector.setBands({band});
+
+    DirectionFinder finder;
+    const std::shared_ptr<DirectionFinder::BearingQueue> queue = finder.bearingQueue();
+    BearingTracker tracker;
+    DirectionFinder::PulseBatch pulses;
+    DirectionFinder::BearingBatch bearingBatch;
+    SignalBatch signalBatch;
+    std::vector<double> azimuths;
+
+    const auto period = std::chrono::duration<double>(periodSec);
+    // Кадр сам по себе: при одном потоке синтез делится между потоками пула.
+    const bool parallel = threads == 1;
+    for (quint64 index = static_cast<quint64>(worker);; index += static_cast<quint64>(threads)) {
+        const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(period * index);
+        Clock::time_point now = Clock::now();
+        // Кадры, не начатые до конца прогона, не засчитываются: отставание
+        // снижает достигнутую частоту, а не продлевает прогон.
+        if (deadline >= stop || now >= stop) {
+            break;
+        }
+        if (now < deadline) {
+            std::this_thread::sleep_until(deadline);
+            now = Clock::now();
+        } else if (now - deadline > period) {
+            counters.lateFrames.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        SpectrumFrame frame = simulator.renderFrame(index, pool, parallel);
+        frame.rebuildPyramid();
+        detector.process(frame);
+        while (detector.takeBatch(signalBatch)) {
+            counters.detections.fetch_add(signalBatch.signalList.size(), std::memory_order_relaxed);
+        }
+
+        const double frameSec = 1.0 / scenario.frameRateHz;
+        const int pulseCount = simulator.renderPulses(simulator.frameTimeSec(index), frameSec,
+                                                      finder.activeSettings(), finder.antennaAzimuthDeg(), pulses);
+        if (pulseCount > 0) {
+            finder.process(pulses);
+            counters.pulses.fetch_add(static_cast<quint64>(pulseCount), std::memory_order_relaxed);
+        }
+        while (queue->tryPop(bearingBatch)) {
+            azimuths.clear();
+            for (const DirectionFinder::Bearing &bearing : bearingBatch.bearings) {
+                azimuths.push_back(bearing.azimuthDeg);
+            }
+            const qint64 nowMs = frame.timestampUs() / 1000;
+            tracker.ingest(azimuths.data(), static_cast<int>(azimuths.size()), nowMs);
+            tracker.prune(nowMs);
+            counters.bearings.fetch_add(azimuths.size(), std::memory_order_relaxed);
+        }
+
+        counters.processing.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - now).count());
+        counters.frames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+/*!
+ *  \brief Запускает нагрузочный прогон.
+ *  \param[in] argc Количество аргументов.
+ *  \param[in] argv Аргументы: файл сценария и параметры прогона.
+ *  \return 0 — нагрузка выдержана, 1 — ошибка параметров, 2 — нагрузка не выдержана.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("SiriusScope scenario soak test"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("scenario"), QStringLiteral("Scenario JSON file."));
+    const QCommandLineOption durationOption(QStringLiteral("duration"), QStringLiteral("Run time, s."),
+                                            QStringLiteral("seconds"), QStringLiteral("60"));
+    const QCommandLineOption loadOption(QStringLiteral("load"), QStringLiteral("Time compression factor."),
+                                        QStringLiteral("factor"), QStringLiteral("10"));
+    const QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("Pipeline threads."),
+                                           QStringLiteral("count"), QString::number(QThread::idealThreadCount()));
+    parser.addOptions({durationOption, loadOption, threadsOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+    ScenarioSimulator::Scenario scenario;
+    QString error;
+    if (!ScenarioSimulator::load(parser.positionalArguments().constFirst(), scenario, &error)) {
+        std::fprintf(stderr, "%s\n", qPrintable(error));
+        return 1;
+    }
+    const double durationSec = qMax(1.0, parser.value(durationOption).toDouble());
+    const double load = qMax(0.01, parser.value(loadOption).toDouble());
+    const int threads = qMax(1, parser.value(threadsOption).toInt());
+
+    const ScenarioSimulator simulator(scenario, QDateTime::currentMSecsSinceEpoch() * 1000);
+    const double targetRateHz = simulator.scenario().frameRateHz * load;
+    std::printf("scenario: %d emitters, %d bins, %.1f Hz x %.1f = %.1f frames/s, %d threads, %.0f s\n",
+                static_cast<int>(simulator.scenario().emitters.size()), simulator.scenario().binCount,
+                simulator.scenario().frameRateHz, load, targetRateHz, threads, durationSec);
+
+    SoakCounters counters;
+    const Clock::time_point start = Clock::now() + std::chrono::milliseconds(100);
+    const Clock::time_point stop = start + std::chrono::duration_cast<Clock::duration>(
+                                               std::chrono::duration<double>(durationSec));
+    std::vector<std::thread> workers;
+    for (int worker = 0; worker < threads; ++worker) {
+        workers.emplace_back(runWorker, std::cref(simulator), worker, threads, 1.0 / targetRateHz, start, stop,
+                             std::ref(counters));
+    }
+
+    LatencyHistogram::Counts previous{};
+    LatencyHistogram::Counts current{};
+    quint64 previousFrames = 0;
+    for (Clock::time_point report = start + std::chrono::seconds(1); report < stop; report += std::chrono::seconds(1)) {
+        std::this_thread::sleep_until(report);
+        counters.processing.snapshot(current);
+        const quint64 frames = counters.frames.load(std::memory_order_relaxed);
+        std::printf("%6.0f s  %8.1f frames/s  late %llu  p50 %lld us  p99 %lld us  max %lld us\n",
+                    std::chrono::duration<double>(report - start).count(), static_cast<double>(frames - previousFrames),
+                    static_cast<unsigned long long>(counters.lateFrames.load(std::memory_order_relaxed)),
+                    static_cast<long long>(LatencyHistogram::percentileUs(current, previous, 0.5)),
+                    static_cast<long long>(LatencyHistogram::percentileUs(current, previous, 0.99)),
+                    static_cast<long long>(counters.processing.takeMaxUs()));
+        std::fflush(stdout);
+        previous = current;
+        previousFrames = frames;
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    const quint64 frames = counters.frames.load();
+    const double achievedRateHz = frames / durationSec;
+    counters.processing.snapshot(current);
+    const LatencyHistogram::Counts empty{};
+    std::printf("total: %llu frames (%.1f/s of %.1f/s), late %llu, detections %llu, pulses %llu, bearings %llu, "
+                "p99 %lld us\n",
+                static_cast<unsigned long long>(frames), achievedRateHz, targetRateHz,
+                static_cast<unsigned long long>(counters.lateFrames.load()),
+                static_cast<unsigned long long>(counters.detections.load()),
+                static_cast<unsigned long long>(counters.pulses.load()),
+                static_cast<unsigned long long>(counters.bearings.load()),
+                static_cast<long long>(LatencyHistogram::percentileUs(current, empty, 0.99)));
+    return achievedRateHz >= kRequiredRateFraction * targetRateHz ? 0 : 2;
+}
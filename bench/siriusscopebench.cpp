@@ -0,0 +1,915 @@
+/*!
+ *  \file siriusscopebench.cpp
+ *  \brief Бенчмарки горячих путей конвейера спектра (QtTest QBENCHMARK) с выводом результатов в JSON.
+ *
+ *  Запуск: benchSiriusScope [--json файл] [параметры QtTest]. Результаты
+ *  QBENCHMARK пишутся логгером QtTest в XML и переводятся в JSON (по
+ *  умолчанию benchSiriusScope.json) вместе с описанием машины, чтобы
+ *  прогоны на одной машине можно было сравнивать между собой.
+ */
+#include "bearingtracker.h"
+#include "datastreamadapter.h"
+#include "datastreamsender.h"
+#include "directionfinder.h"
+#include "fftprocessor.h"
+#include "frequencyviewportmodel.h"
+#include "latestvalueslot.h"
+#include "minmaxkernel.h"
+#include "recordingmanager.h"
+#include "scenariosimulator.h"
+#include "signaldetector.h"
+#include "signaltable.h"
+#include "spectrumcodec.h"
+#include "spectrumdecimator.h"
+#include "spectrumengine.h"
+#include "spectrumframe.h"
+#include "spectrumframepool.h"
+#include "spectrumplotitem.h"
+#include "waterfallhistory.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTemporaryDir>
+#include <QXmlStreamReader>
+#include <QtTest>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+//! \brief Нижняя граница панорамы, Гц.
+constexpr double kPanoramaMinHz = 300e6;
+//! \brief Верхняя граница панорамы, Гц.
+constexpr double kPanoramaMaxHz = 18e9;
+
+/*!
+ *  \brief Создает кадр панорамы: шум с отдельными сигналами.
+ *  \param[in] binCount Количество значений.
+ *  \param[in] withPyramid Построить пирамиду min/max.
+ *  \return Кадр спектра.
+ */
+SpectrumFrame makeFrame(int binCount, bool withPyramid)
+{
+    SpectrumFrame frame(binCount);
+    frame.setSpan(kPanoramaMinHz, kPanoramaMaxHz);
+    frame.setDbRange(-120.0f, 0.0f);
+
+    std::mt19937 rng(12345);
+    std::normal_distribution<float> noise(-100.0f, 2.0f);
+    float *bins = frame.bins();
+    for (int i = 0; i < binCount; ++i) {
+        bins[i] = noise(rng);
+    }
+    for (int position = binCount / 64; position + 16 < binCount; position += binCount / 32) {
+        for (int k = 0; k < 16; ++k) {
+            bins[position + k] = -50.0f;
+        }
+    }
+
+    if (withPyramid) {
+        frame.rebuildPyramid();
+    }
+    return frame;
+}
+
+/*!
+ *  \brief Возвращает описание полос для SpectrumPlotItem и SignalDetector.
+ *  \param[in] count Количество полос, равномерно распределенных по панораме.
+ *  \return Полосы детектора.
+ */
+std::vector<SignalDetector::Band> makeBands(int count)
+{
+    std::vector<SignalDetector::Band> bands;
+    const double widthHz = (kPanoramaMaxHz - kPanoramaMinHz) / count;
+    for (int i = 0; i < count; ++i) {
+        SignalDetector::Band band;
+        band.id = i;
+        band.minHz = kPanoramaMinHz + i * widthHz;
+        band.maxHz = band.minHz + widthHz * 0.8;
+        band.thresholdDb = -85.0 + (i % 4);
+        bands.push_back(band);
+    }
+    return bands;
+}
+
+/*!
+ *  \brief Переводит результаты QBENCHMARK из XML QtTest в JSON.
+ *  \param[in] xmlPath Файл логгера xml.
+ *  \param[in] jsonPath Файл результатов.
+ *  \return false, если XML не прочитан или JSON не записан.
+ */
+bool writeJson(const QString &xmlPath, const QString &jsonPath)
+{
+    QFile xmlFile(xmlPath);
+    if (!xmlFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonArray results;
+    QString function;
+    QXmlStreamReader xml(&xmlFile);
+    while (!xml.atEnd()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement) {
+            continue;
+        }
+        const QXmlStreamAttributes attributes = xml.attributes();
+        if (xml.name() == QLatin1String("TestFunction")) {
+            function = attributes.value(QLatin1String("name")).toString();
+        } else if (xml.name() == QLatin1String("BenchmarkResult")) {
+            results.append(QJsonObject{
+                {QStringLiteral("function"), function},
+                {QStringLiteral("tag"), attributes.value(QLatin1String("tag")).toString()},
+                {QStringLiteral("metric"), attributes.value(QLatin1String("metric")).toString()},
+                {QStringLiteral("value"), attributes.value(QLatin1String("value")).toDouble()},
+                {QStringLiteral("iterations"), attributes.value(QLatin1String("iterations")).toInt()}});
+        }
+    }
+    if (xml.hasError()) {
+        return false;
+    }
+
+    const QJsonObject root{
+        {QStringLiteral("suite"), QStringLiteral("benchSiriusScope")},
+        {QStringLiteral("timestamp"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate)},
+        {QStringLiteral("host"), QSysInfo::machineHostName()},
+        {QStringLiteral("os"), QSysInfo::prettyProductName()},
+        {QStringLiteral("cpuArchitecture"), QSysInfo::currentCpuArchitecture()},
+        {QStringLiteral("qtVersion"), QString::fromLatin1(qVersion())},
+        {QStringLiteral("minMaxKernel"),
+         QString::fromLatin1(MinMaxKernel::variantName(MinMaxKernel::bestVariant()))},
+        {QStringLiteral("results"), results}};
+
+    QFile jsonFile(jsonPath);
+    if (!jsonFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return jsonFile.write(QJsonDocument(root).toJson(QJsonDocument::Indented)) > 0;
+}
+
+} // namespace
+
+/*!
+ *  \class SiriusScopeBench
+ *  \brief Набор замеров: формирование кадра, сведение min/max, обзор при
+ *  перетаскивании, сопровождение пеленгов, обнаружение сигналов, таблица сигналов,
+ *  пеленгация и выдача буферов кадров.
+ */
+class SiriusScopeBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    //! \brief Параметры замера формирования кадра.
+    void produceFrame_data();
+    //! \brief Формирование кадра SpectrumEngine из синтетического I/Q.
+    void produceFrame();
+    //! \brief Параметры замера сведения min/max.
+    void decimateMinMax_data();
+    //! \brief Сведение кадра к парам min/max: линейный проход и запрос к пирамиде.
+    void decimateMinMax();
+    //! \brief Параметры замера изменения обзора.
+    void applyViewport_data();
+    //! \brief Серия изменений обзора с частотой событий мыши при перетаскивании.
+    void applyViewport();
+    //! \brief Параметры замера сопровождения пеленгов.
+    void bearingIngest_data();
+    //! \brief Прием пеленгов BearingTracker на одном такте.
+    void bearingIngest();
+    //! \brief Параметры замера обнаружения сигналов.
+    void detectSignals_data();
+    //! \brief Обнаружение сигналов SignalDetector в кадре 1M значений.
+    void detectSignals();
+    //! \brief Параметры замера таблицы сигналов.
+    void signalTable_data();
+    //! \brief Объединение пакета и пересортировка таблицы сигналов из 100 тысяч строк.
+    void signalTable();
+    //! \brief Параметры замера пеленгации.
+    void directionFind_data();
+    //! \brief Пеленгация пакета из 256 импульсов DirectionFinder.
+    void directionFind();
+    //! \brief Параметры замера выдачи буферов кадров.
+    void frameBuffers_data();
+    //! \brief Выдача кадра панорамы, разделение с потребителями и возврат буфера.
+    void frameBuffers();
+    //! \brief Кадры обхода при отстающей записи и истории водопада: пул буферов не исчерпывается.
+    void recordUnderLoad();
+    //! \brief Замер кадра обхода, который держат запись, история водопада и держатели UI.
+void SiriusScopeBench::recordUnderLoad()
+{
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    SpectrumEngine engine;
+    FFTProcessor::Settings settings;
+    settings.fftSize = 65536;
+    engine.setSettings(settings);
+    SpectrumEngine::SweepSettings sweep;
+    sweep.dwellSpanHz = 1e9;
+    engine.setSweepSettings(sweep);
+
+    RecordingManager recorder;
+    RecordingManager::Settings recording;
+    recording.directory = directory.path();
+    QVERIFY(recorder.startRecording(recording));
+    WaterfallHistory::Settings historySettings;
+    historySettings.hotBytes = 0;
+    historySettings.coldBytes = qint64(256) << 20;
+    WaterfallHistory history(historySettings);
+
+    // Держатели вне очередей, как в конвейере приложения: слот доставки,
+    // последний и панорамный кадры контроллера и кадр графика.
+    LatestValueSlot<SpectrumFrame> slot;
+    SpectrumFrame latestFrame;
+    SpectrumFrame panoramaFrame;
+    SpectrumFrame plotFrame;
+    QBENCHMARK {
+        SpectrumFrame frame = engine.produce(kPanoramaMinHz, kPanoramaMaxHz);
+        recorder.submit(frame);
+        history.submit(frame);
+        panoramaFrame = frame;
+        slot.writeBuffer() = std::move(frame);
+        slot.publish();
+        if (slot.consume()) {
+            latestFrame = slot.readBuffer();
+            plotFrame = latestFrame;
+        }
+    }
+    recorder.stopRecording();
+    recorder.wait();
+    QVERIFY(recorder.writtenFrames() > 0);
+    QCOMPARE(engine.framePoolExhaustedCount(), quint64(0));
+}
+
+//! \brief Транспорт и размер кадра потока РПУ.
+    void streamIngest_data();
+    //! \brief Передача кадра спектра через локальный транспорт и его сборка в пул.
+    void streamIngest();
+    //! \brief Число излучателей и распараллеливание синтеза.
+    void scenarioRender_data();
+    //! \brief Синтез кадра 256k значений имитатором сценария.
+    void scenarioRender();
+    //! \brief Добавление кадра 1M значений в историю водопада.
+    void waterfallAppend();
+    //! \brief Обзор и сдвиг обзора между запросами истории водопада.
+    void waterfallQuery_data();
+    //! \brief Выборка 2048 x 2048 из истории водопада в 2048 строк.
+    void waterfallQuery();
+    //! \brief Шаг и разрядность квантования и операция кодека.
+    void spectrumCodec_data();
+    //! \brief Кодирование, декодирование и декодирование диапазона кадра 1M значений.
+    void spectrumCodec();
+};
+
+//! \brief Размер БПФ и полоса стоянки (0 — вся панорама за одну стоянку).
+void SiriusScopeBench::produceFrame_data()
+{
+    QTest::addColumn<int>("fftSize");
+    QTest::addColumn<double>("dwellSpanHz");
+
+    QTest::newRow("fft 4096 / single dwell") << 4096 << 0.0;
+    QTest::newRow("fft 65536 / single dwell") << 65536 << 0.0;
+    QTest::newRow("fft 65536 / sweep 1 GHz") << 65536 << 1e9;
+}
+
+//! \brief Замер SpectrumEngine::produce() по всей панораме.
+void SiriusScopeBench::produceFrame()
+{
+    QFETCH(int, fftSize);
+    QFETCH(double, dwellSpanHz);
+
+    SpectrumEngine engine;
+    FFTProcessor::Settings settings;
+    settings.fftSize = fftSize;
+    engine.setSettings(settings);
+    SpectrumEngine::SweepSettings sweep;
+    sweep.dwellSpanHz = dwellSpanHz;
+    engine.setSweepSettings(sweep);
+
+    // Первый кадр применяет параметры и заполняет буферы.
+    SpectrumFrame frame = engine.produce(kPanoramaMinHz, kPanoramaMaxHz);
+    QVERIFY(frame.isValid());
+
+    QBENCHMARK {
+        frame = engine.produce(kPanoramaMinHz, kPanoramaMaxHz);
+    }
+    QVERIFY(frame.isValid());
+}
+
+//! \brief Количество значений, ширина и способ сведения.
+void SiriusScopeBench::decimateMinMax_data()
+{
+    QTest::addColumn<int>("binCount");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<bool>("pyramid");
+
+    for (const int binCount : {65536, 262144, 1048576}) {
+        for (const int width : {800, 1920, 3840}) {
+            for (const bool pyramid : {false, true}) {
+                QTest::addRow("%d bins / %d px / %s", binCount, width, pyramid ? "pyramid" : "linear")
+                    << binCount << width << pyramid;
+            }
+        }
+    }
+}
+
+//! \brief Замер SpectrumDecimator::decimateMinMax() для всего кадра.
+void SiriusScopeBench::decimateMinMax()
+{
+    QFETCH(int, binCount);
+    QFETCH(int, width);
+    QFETCH(bool, pyramid);
+
+    const SpectrumFrame frame = makeFrame(binCount, pyramid);
+    std::vector<float> out(static_cast<size_t>(width) * 2);
+
+    if (pyramid) {
+        QBENCHMARK {
+            SpectrumDecimator::decimateMinMax(frame, kPanoramaMinHz, kPanoramaMaxHz, width, out.data());
+        }
+    } else {
+        QBENCHMARK {
+            SpectrumDecimator::decimateMinMax(frame.constBins(), binCount, width, out.data());
+        }
+    }
+    QVERIFY(out[1] >= out[0]);
+}
+
+//! \brief Подписчик изменения обзора: только модель или модель и SpectrumPlot.
+void SiriusScopeBench::applyViewport_data()
+{
+    QTest::addColumn<bool>("withPlot");
+
+    QTest::newRow("model") << false;
+    QTest::newRow("model + plot 1920 px / 50 bands") << true;
+}
+
+/*!
+ *  \brief Замер 120 изменений обзора (около секунды перетаскивания).
+ *
+ *  Обзор шириной 1 ГГц сдвигается шагами по 10 МГц, как при панорамировании
+ *  мышью; с SpectrumPlot каждое изменение пересчитывает пороги и колонки.
+ */
+void SiriusScopeBench::applyViewport()
+{
+    QFETCH(bool, withPlot);
+
+    FrequencyViewportModel model;
+    SpectrumPlotItem plot;
+    if (withPlot) {
+        plot.setSize(QSizeF(1920.0, 400.0));
+        plot.setFrame(makeFrame(SpectrumEngine::kMaxPanoramaBins, true));
+
+        QVariantList bands;
+        for (const SignalDetector::Band &band : makeBands(50)) {
+            bands.append(QVariantMap{{QStringLiteral("bandId"), band.id},
+                                     {QStringLiteral("centerHz"), (band.minHz + band.maxHz) * 0.5},
+                                     {QStringLiteral("widthHz"), band.maxHz - band.minHz},
+                                     {QStringLiteral("thresholdDb"), band.thresholdDb},
+                                     {QStringLiteral("enabled"), true}});
+        }
+        plot.setBands(bands);
+        QObject::connect(&model, &FrequencyViewportModel::viewportChanged, &plot,
+                         [&plot](double minHz, double maxHz) {
+                             plot.setViewMinHz(minHz);
+                             plot.setViewMaxHz(maxHz);
+                         });
+    }
+
+    constexpr int kStepsPerDrag = 120;
+    constexpr double kStepHz = 10e6;
+    const QString sourceTag = QStringLiteral("bench");
+    int step = 0;
+    QBENCHMARK {
+        for (int i = 0; i < kStepsPerDrag; ++i, ++step) {
+            const double minHz = 1e9 + (step % 1000) * kStepHz;
+            model.setViewport(minHz, minHz + 1e9, sourceTag);
+        }
+    }
+    QVERIFY(model.viewMaxHz() > model.viewMinHz());
+}
+
+//! \brief Количество пеленгов на такт.
+void SiriusScopeBench::bearingIngest_data()
+{
+    QTest::addColumn<int>("bearingCount");
+
+    QTest::newRow("4 bearings") << 4;
+    QTest::newRow("16 bearings") << 16;
+    QTest::newRow("64 bearings") << 64;
+}
+
+//! \brief Замер BearingTracker::ingest() на такте 16 мс с дрожанием пеленгов.
+void SiriusScopeBench::bearingIngest()
+{
+    QFETCH(int, bearingCount);
+
+    constexpr int kTicks = 256;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> azimuth(0.0, 360.0);
+    std::normal_distribution<double> jitter(0.0, 1.0);
+    std::vector<double> targets(static_cast<size_t>(bearingCount));
+    for (double &target : targets) {
+        target = azimuth(rng);
+    }
+    std::vector<std::vector<double>> ticks(kTicks);
+    for (std::vector<double> &tick : ticks) {
+        for (const double target : targets) {
+            tick.push_back(target + jitter(rng));
+        }
+    }
+
+    BearingTracker tracker;
+    qint64 nowMs = 0;
+    int tick = 0;
+    QBENCHMARK {
+        const std::vector<double> &bearings = ticks[static_cast<size_t>(tick++ % kTicks)];
+        tracker.ingest(bearings.data(), bearingCount, nowMs);
+        nowMs += 16;
+    }
+    QVERIFY(!tracker.tracks().empty());
+}
+
+//! \brief Способ вычисления порога.
+void SiriusScopeBench::detectSignals_data()
+{
+    QTest::addColumn<int>("method");
+
+    QTest::newRow("threshold / 1M bins / 32 bands") << static_cast<int>(SignalDetector::Method::Threshold);
+    QTest::newRow("CA-CFAR / 1M bins / 32 bands") << static_cast<int>(SignalDetector::Method::CellAveraging);
+    QTest::newRow("OS-CFAR / 1M bins / 32 bands") << static_cast<int>(SignalDetector::Method::OrderedStatistic);
+}
+
+//! \brief Замер SignalDetector::process() с выборкой пакета.
+void SiriusScopeBench::detectSignals()
+{
+    QFETCH(int, method);
+
+    const SpectrumFrame frame = makeFrame(1 << 20, false);
+    SignalDetector detector;
+    SignalDetector::Settings settings;
+    settings.method = static_cast<SignalDetector::Method>(method);
+    detector.setSettings(settings);
+    detector.setBands(makeBands(32));
+
+    SignalBatch batch;
+    QBENCHMARK {
+        detector.process(frame);
+        detector.takeBatch(batch);
+    }
+    QVERIFY(!batch.signalList.empty());
+}
+
+//! \brief Выполняемое действие: такт с новым пакетом или полная пересортировка.
+void SiriusScopeBench::signalTable_data()
+{
+    QTest::addColumn<bool>("resort");
+
+    QTest::newRow("merge 256 signals / 100k rows") << false;
+    QTest::newRow("resort 100k rows") << true;
+}
+
+//! \brief Замер SignalTable::merge() и takeChanges() при сортировке по частоте.
+void SiriusScopeBench::signalTable()
+{
+    QFETCH(bool, resort);
+
+    constexpr int kSignalsPerBatch = 256;
+    constexpr int kRows = 100000;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> frequency(1e9, 6e9);
+    std::uniform_real_distribution<float> amplitude(-100.0f, -20.0f);
+    qint64 timestampUs = 0;
+    const auto makeBatch = [&]() {
+        SignalBatch batch;
+        timestampUs += 16000;
+        batch.timestampUs = timestampUs;
+        for (int i = 0; i < kSignalsPerBatch; ++i) {
+            SignalEntity signal;
+            signal.timestampUs = timestampUs;
+            signal.frequencyHz = frequency(rng);
+            signal.bandwidthHz = 25e3;
+            signal.amplitudeDb = amplitude(rng);
+            batch.signalList.push_back(signal);
+        }
+        std::sort(batch.signalList.begin(), batch.signalList.end(),
+                  [](const SignalEntity &left, const SignalEntity &right) { return left.frequencyHz < right.frequencyHz; });
+        return batch;
+    };
+
+    SignalTable table;
+    SignalTable::Settings settings;
+    settings.maxRows = kRows;
+    settings.mergeHoldUs = 0;
+    settings.sortColumn = SignalTable::FrequencyColumn;
+    settings.sortDescending = false;
+    table.setSettings(settings);
+    SignalTable::Changes changes;
+    while (table.rows().size() < kRows) {
+        table.merge(makeBatch());
+        table.takeChanges(changes);
+    }
+
+    const SignalBatch batch = makeBatch();
+    int column = SignalTable::FrequencyColumn;
+    QBENCHMARK {
+        if (resort) {
+            column = column == SignalTable::FrequencyColumn ? SignalTable::AmplitudeColumn : SignalTable::FrequencyColumn;
+            settings.sortColumn = column;
+            table.setSettings(settings);
+        } else {
+            table.merge(batch);
+        }
+        table.takeChanges(changes);
+    }
+    QVERIFY(!table.order().empty());
+}
+
+//! \brief Шаг таблицы диаграмм и количество каналов.
+void SiriusScopeBench::directionFind_data()
+{
+    QTest::addColumn<double>("stepDeg");
+    QTest::addColumn<int>("channelCount");
+
+    QTest::newRow("256 pulses / 0.25 deg / 4 channels") << 0.25 << 4;
+    QTest::newRow("256 pulses / 0.05 deg / 8 channels") << 0.05 << 8;
+}
+
+//! \brief Замер DirectionFinder::process() с выборкой пакета пеленгов.
+void SiriusScopeBench::directionFind()
+{
+    QFETCH(double, stepDeg);
+    QFETCH(int, channelCount);
+
+    constexpr int kPulses = 256;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> frequency(1e9, 6e9);
+    SignalBatch signalBatch;
+    for (int i = 0; i < kPulses; ++i) {
+        SignalEntity signal;
+        signal.frequencyHz = frequency(rng);
+        signal.amplitudeDb = -50.0f;
+        signalBatch.signalList.push_back(signal);
+    }
+
+    DirectionFinder finder;
+    finder.setStepDeg(stepDeg);
+    finder.setChannelCount(channelCount);
+    // Пустой пакет применяет параметры и перестраивает таблицу до замера.
+    finder.process(DirectionFinder::PulseBatch());
+
+    SyntheticArraySource source;
+    DirectionFinder::PulseBatch pulses;
+    source.makePulses(signalBatch, finder.activeSettings(), 0.0, pulses);
+
+    const std::shared_ptr<DirectionFinder::BearingQueue> queue = finder.bearingQueue();
+    DirectionFinder::BearingBatch bearings;
+    QBENCHMARK {
+        finder.process(pulses);
+        queue->tryPop(bearings);
+    }
+    QVERIFY(!bearings.bearings.empty());
+}
+
+//! \brief Источник буфера: новый кадр в куче или пул.
+void SiriusScopeBench::frameBuffers_data()
+{
+    QTest::addColumn<bool>("pooled");
+
+    QTest::newRow("heap / 512k bins / 4 consumers") << false;
+    QTest::newRow("pool / 512k bins / 4 consumers") << true;
+}
+
+//! \brief Замер выдачи кадра, его заполнения и разделения с потребителями.
+void SiriusScopeBench::frameBuffers()
+{
+    QFETCH(bool, pooled);
+
+    constexpr int kBins = 1 << 19;
+    constexpr int kConsumers = 4;
+    SpectrumFramePool pool(8, kBins);
+    std::vector<SpectrumFrame> consumers(kConsumers);
+    float value = -100.0f;
+    QBENCHMARK {
+        SpectrumFrame frame = pooled ? pool.acquire(kBins) : SpectrumFrame(kBins);
+        std::fill_n(frame.bins(), kBins, value);
+        value += 0.001f;
+        // Потребители отпускают прежний кадр, получая новый.
+        for (SpectrumFrame &consumer : consumers) {
+            consumer = frame;
+        }
+    }
+    QVERIFY(consumers.front().binCount() == kBins);
+    QCOMPARE(pool.exhaustedCount(), quint64(0));
+}
+
+//! \brief Транспорт и размер кадра потока РПУ.
+void SiriusScopeBench::streamIngest_data()
+{
+    QTest::addColumn<bool>("sharedMemory");
+    QTest::addColumn<int>("binCount");
+
+    QTest::newRow("udp loopback / 32k bins") << false << (1 << 15);
+    QTest::newRow("udp loopback / 128k bins") << false << (1 << 17);
+    QTest::newRow("shm ring / 512k bins") << true << (1 << 19);
+}
+
+//! \brief Замер передачи кадра и его сборки потоком приема до публикации.
+void SiriusScopeBench::streamIngest()
+{
+    QFETCH(bool, sharedMemory);
+    QFETCH(int, binCount);
+
+    constexpr quint16 kPort = 50123;
+    const QString ringName = QStringLiteral("siriusscope-bench-%1").arg(QCoreApplication::applicationPid());
+
+    // Передатчик — замена РПУ: кольцо создает он, приемник его открывает.
+    DataStreamSender sender;
+    DataStreamAdapter adapter;
+    DataStreamAdapter::Settings settings;
+    if (sharedMemory) {
+        QVERIFY(sender.openSharedMemory(ringName, qint64(64) << 20));
+        QVERIFY(DataStreamAdapter::parseAddress(QStringLiteral("shm://") + ringName, settings));
+    } else {
+        QVERIFY(DataStreamAdapter::parseAddress(QStringLiteral("udp://127.0.0.1:%1").arg(kPort), settings));
+    }
+    QVERIFY(adapter.open(settings));
+    if (!sharedMemory) {
+        QVERIFY(sender.openUdp(QStringLiteral("127.0.0.1"), kPort));
+    }
+
+    const SpectrumFrame frame = makeFrame(binCount, false);
+    // Кадр считается принятым, когда поток приема собрал его целиком.
+    const auto sendAndWait = [&]() {
+        const quint64 before = adapter.statistics().completedFrames;
+        if (!sender.sendSpectrum(frame)) {
+            return false;
+        }
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (adapter.statistics().completedFrames == before) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    };
+    QVERIFY(sendAndWait());
+
+    bool delivered = true;
+    QBENCHMARK {
+        delivered = sendAndWait() && delivered;
+    }
+    QVERIFY(delivered);
+
+    const DataStreamAdapter::Statistics stats = adapter.statistics();
+    QCOMPARE(stats.malformedPackets, quint64(0));
+    QCOMPARE(stats.incompleteFrames, quint64(0));
+    SpectrumFrame received;
+    QVERIFY(adapter.source()->takeSpectrum(received));
+    QCOMPARE(received.binCount(), binCount);
+    QVERIFY(std::equal(frame.constBins(), frame.constBins() + binCount, received.constBins()));
+    adapter.close();
+}
+
+//! \brief Число излучателей и распараллеливание синтеза.
+void SiriusScopeBench::scenarioRender_data()
+{
+    QTest::addColumn<int>("emitterCount");
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("256k bins / 100 emitters / 1 thread") << 100 << false;
+    QTest::newRow("256k bins / 10000 emitters / 1 thread") << 10000 << false;
+    QTest::newRow("256k bins / 10000 emitters / pool") << 10000 << true;
+}
+
+//! \brief Замер ScenarioSimulator::renderFrame() с пирамидой min/max.
+void SiriusScopeBench::scenarioRender()
+{
+    QFETCH(int, emitterCount);
+    QFETCH(bool, parallel);
+
+    ScenarioSimulator::Scenario scenario;
+    scenario.binCount = 1 << 18;
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<double> frequency(scenario.minHz, scenario.maxHz);
+    std::uniform_real_distribution<double> power(-90.0, -30.0);
+    for (int i = 0; i < emitterCount; ++i) {
+        ScenarioSimulator::Emitter emitter;
+        emitter.frequencyHz = frequency(rng);
+        emitter.bandwidthHz = 1e6;
+        emitter.powerDb = power(rng);
+        // Каждый четвертый излучатель импульсный со скважностью 100.
+        if (i % 4 == 0) {
+            emitter.pulsePeriodUs = 1000.0;
+            emitter.pulseWidthUs = 10.0;
+        }
+        scenario.emitters.push_back(emitter);
+    }
+
+    const ScenarioSimulator simulator(scenario);
+    SpectrumFramePool pool(4, scenario.binCount);
+    quint64 index = 0;
+    SpectrumFrame frame;
+    QBENCHMARK {
+        frame = simulator.renderFrame(index++, pool, parallel);
+        frame.rebuildPyramid();
+    }
+    QCOMPARE(frame.binCount(), scenario.binCount);
+    QVERIFY(*std::max_element(frame.constBins(), frame.constBins() + frame.binCount()) > -60.0f);
+}
+
+//! \brief Замер добавления строки в WaterfallHistory: передача кадра, сведение, пирамида, плитки и вытеснение.
+void SiriusScopeBench::waterfallAppend()
+{
+    WaterfallHistory::Settings settings;
+    // Бюджеты урезаны, чтобы долгий замер не занимал гигабайты диска.
+    settings.hotBytes = 0;
+    settings.coldBytes = qint64(256) << 20;
+    WaterfallHistory history(settings);
+    const SpectrumFrame frame = makeFrame(1 << 20, true);
+
+    QBENCHMARK {
+        history.submit(frame);
+        history.flush();
+    }
+    QVERIFY(history.rowCount() > 0);
+}
+
+//! \brief Ширина обзора (0 — вся панорама) и сдвиг на 10% ширины перед каждым запросом.
+void SiriusScopeBench::waterfallQuery_data()
+{
+    QTest::addColumn<double>("spanHz");
+    QTest::addColumn<bool>("pan");
+
+    QTest::newRow("2048 x 2048 / full span") << 0.0 << false;
+    QTest::newRow("2048 x 2048 / 100 MHz") << 100e6 << false;
+    QTest::newRow("2048 x 2048 / 1 GHz / pan") << 1e9 << true;
+}
+
+//! \brief Замер WaterfallHistory::query() при бюджете памяти меньше объема истории (только плитки в памяти).
+void SiriusScopeBench::waterfallQuery()
+{
+    QFETCH(double, spanHz);
+    QFETCH(bool, pan);
+
+    constexpr int kRows = 2048;
+    constexpr int kWidth = 2048;
+    WaterfallHistory::Settings settings;
+    // Наименьший бюджет памяти: большая часть плиток уходит на диск.
+    settings.hotBytes = 0;
+    WaterfallHistory history(settings);
+    const SpectrumFrame frame = makeFrame(1 << 20, true);
+    for (int row = 0; row < kRows; ++row) {
+        history.submit(frame);
+        history.flush();
+    }
+    QVERIFY(history.stats().coldTiles > 0);
+
+    const double span = spanHz > 0.0 ? spanHz : kPanoramaMaxHz - kPanoramaMinHz;
+    double minHz = kPanoramaMinHz;
+    std::vector<quint8> levels(static_cast<size_t>(kWidth) * kRows);
+    QBENCHMARK {
+        if (pan) {
+            minHz += span * 0.1;
+            if (minHz + span > kPanoramaMaxHz) {
+                minHz = kPanoramaMinHz;
+            }
+        }
+        history.query(0, kRows, minHz, minHz + span, kWidth, kRows, levels.data());
+    }
+    QVERIFY(*std::max_element(levels.begin(), levels.end()) > 0);
+}
+
+//! \brief Шаг и разрядность квантования и операция кодека.
+void SiriusScopeBench::spectrumCodec_data()
+{
+    QTest::addColumn<double>("stepDb");
+    QTest::addColumn<bool>("uint8Codes");
+    QTest::addColumn<QString>("operation");
+
+    QTest::newRow("1M bins / 0.1 dB int16 / encode") << 0.1 << false << QStringLiteral("encode");
+    QTest::newRow("1M bins / 0.5 dB uint8 / encode") << 0.5 << true << QStringLiteral("encode");
+    QTest::newRow("1M bins / 0.1 dB int16 / decode") << 0.1 << false << QStringLiteral("decode");
+    QTest::newRow("1M bins / 0.5 dB uint8 / decode") << 0.5 << true << QStringLiteral("decode");
+    QTest::newRow("1M bins / 0.1 dB int16 / slice 16k") << 0.1 << false << QStringLiteral("slice");
+}
+
+//! \brief Замер SpectrumCodec на последовательности кадров с меняющимся шумом и неподвижными сигналами.
+void SiriusScopeBench::spectrumCodec()
+{
+    QFETCH(double, stepDb);
+    QFETCH(bool, uint8Codes);
+    QFETCH(QString, operation);
+
+    constexpr int kBinCount = 1 << 20;
+    constexpr int kVariants = 4;
+    SpectrumCodec::Settings settings;
+    settings.stepDb = static_cast<float>(stepDb);
+    if (uint8Codes) {
+        // 256 кодов по 0.5 дБ: шкала -160..-32.5 дБ.
+        settings.floorDb = -160.0f;
+        settings.width = SpectrumCodec::Width::UInt8;
+    }
+
+    // Шум каждого кадра взят из сдвинутого шума исходного кадра.
+    const SpectrumFrame source = makeFrame(kBinCount, false);
+    const float *bins = source.constBins();
+    std::vector<std::vector<float>> frames(kVariants, std::vector<float>(kBinCount));
+    for (int k = 0; k < kVariants; ++k) {
+        for (int i = 0; i < kBinCount; ++i) {
+            const float shifted = bins[(i + k * 7919) % kBinCount];
+            frames[k][i] = bins[i] > -60.0f || shifted > -60.0f ? bins[i] : shifted;
+        }
+    }
+
+    SpectrumCodec encoder(settings);
+    std::vector<uchar> buffer(static_cast<size_t>(SpectrumCodec::maxEncodedBytes(kBinCount)));
+    if (operation == QLatin1String("encode")) {
+        int index = 0;
+        qint64 bytes = 0;
+        QBENCHMARK {
+            bytes = encoder.encode(frames[index++ % kVariants].data(), kBinCount, buffer.data());
+        }
+        QVERIFY(bytes > 0);
+        QVERIFY(bytes < qint64(kBinCount) * qint64(sizeof(float)) / 2);
+        return;
+    }
+
+    // Последовательность от ключевого кадра до следующего ключевого декодируется по кругу.
+    std::vector<std::vector<uchar>> streams(static_cast<size_t>(encoder.settings().keyInterval));
+    for (size_t k = 0; k < streams.size(); ++k) {
+        const qint64 bytes = encoder.encode(frames[k % kVariants].data(), kBinCount, buffer.data());
+        streams[k].assign(buffer.begin(), buffer.begin() + bytes);
+    }
+    QVERIFY(SpectrumCodec::isKeyFrame(streams.front().data(), qint64(streams.front().size())));
+
+    const bool slice = operation == QLatin1String("slice");
+    const int firstBin = slice ? kBinCount / 2 : 0;
+    const int lastBin = slice ? firstBin + 16384 : kBinCount;
+    SpectrumCodec decoder(settings);
+    std::vector<float> db(static_cast<size_t>(lastBin - firstBin));
+    size_t index = 0;
+    bool decoded = true;
+    QBENCHMARK {
+        const std::vector<uchar> &stream = streams[index++ % streams.size()];
+        decoded = decoder.decodeSlice(stream.data(), qint64(stream.size()), firstBin, lastBin, db.data()) && decoded;
+    }
+    QVERIFY(decoded);
+    const float *expected = frames[(index - 1) % streams.size() % kVariants].data() + firstBin;
+    float maxError = 0.0f;
+    for (size_t i = 0; i < db.size(); ++i) {
+        maxError = std::max(maxError, std::abs(db[i] - std::max(expected[i], settings.floorDb)));
+    }
+    QVERIFY(maxError <= settings.stepDb * 0.5f + 1e-3f);
+}
+
+/*!
+ *  \brief Запускает замеры и сохраняет результаты в JSON.
+ *  \param[in] argc Количество аргументов.
+ *  \param[in] argv Аргументы: --json файл и параметры QtTest.
+ *  \return Число неудачных проверок или 1, если результаты не записаны.
+ */
+int main(int argc, char *argv[])
+{
+    // Замеры запускаются на машине без дисплея: элементам Qt Quick окно не нужно.
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    QStringList arguments = QCoreApplication::arguments();
+    QString jsonPath = QStringLiteral("benchSiriusScope.json");
+    const qsizetype jsonIndex = arguments.indexOf(QStringLiteral("--json"));
+    if (jsonIndex > 0 && jsonIndex + 1 < arguments.size()) {
+        jsonPath = arguments.at(jsonIndex + 1);
+        arguments.remove(jsonIndex, 2);
+    }
+
+    QTemporaryDir xmlDir;
+    if (!xmlDir.isValid()) {
+        return 1;
+    }
+    const QString xmlPath = xmlDir.filePath(QStringLiteral("results.xml"));
+    arguments << QStringLiteral("-o") << xmlPath + QStringLiteral(",xml") << QStringLiteral("-o")
+              << QStringLiteral("-,txt");
+
+    SiriusScopeBench bench;
+    const int failures = QTest::qExec(&bench, arguments);
+    if (!writeJson(xmlPath, jsonPath)) {
+        qWarning("benchSiriusScope: failed to write %s", qPrintable(jsonPath));
+        return failures > 0 ? failures : 1;
+    }
+    return failures;
+}
+
+#include "siriusscopebench.moc"
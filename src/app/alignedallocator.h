@@ -0,0 +1,69 @@
+/*!
+ *  \file alignedallocator.h
+ *  \brief Распределитель памяти с выравниванием по строке кэша.
+ */
+#ifndef ALIGNEDALLOCATOR_H
+#define ALIGNEDALLOCATOR_H
+
+#include <cstddef>
+#include <new>
+
+/*!
+ *  \class AlignedAllocator
+ *  \brief Распределитель для стандартных контейнеров, выравнивающий начало блока.
+ *
+ *  Значения кадров, выровненные по строке кэша, не делят строку с чужими
+ *  данными и читаются векторными ядрами без смещенных строк в начале.
+ *
+ *  \tparam T Тип элемента.
+ *  \tparam Alignment Выравнивание, байты (степень двойки).
+ */
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+    static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0,
+                  "Alignment must be a power of two not less than alignof(T)");
+
+public:
+    using value_type = T;
+
+    //! \brief Распределитель того же выравнивания для другого типа.
+    template <typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+    //! \brief Конструирует копию распределителя другого типа.
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) noexcept
+    {
+    }
+
+    //! \brief Выделяет выровненную память под count элементов.
+    T *allocate(std::size_t count)
+    {
+        return static_cast<T *>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+    }
+    //! \brief Освобождает память, выделенную allocate().
+    void deallocate(T *pointer, std::size_t) noexcept
+    {
+        ::operator delete(pointer, std::align_val_t(Alignment));
+    }
+
+    //! \brief Распределители без состояния взаимозаменяемы.
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const noexcept
+    {
+        return true;
+    }
+    //! \brief Распределители без состояния взаимозаменяемы.
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const noexcept
+    {
+        return false;
+    }
+};
+
+#endif // ALIGNEDALLOCATOR_H
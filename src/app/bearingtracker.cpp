@@ -0,0 +1,225 @@
+/*!
+ *  \file bearingtracker.cpp
+ *  \brief Реализация BearingTracker.
+ */
+#include "bearingtracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//! \brief Наименьшая ширина угловой корзины, градусы.
+constexpr double kMinBucketDeg = 0.25;
+
+} // namespace
+
+//! \brief Конструирует сопровождение с параметрами по умолчанию.
+BearingTracker::BearingTracker()
+{
+    setSettings(Settings());
+}
+
+/*!
+ *  \brief Задает параметры сопровождения.
+ *  \param[in] settings Параметры (нормализуются).
+ */
+void BearingTracker::setSettings(const Settings &settings)
+{
+    m_settings = settings;
+    m_settings.maxTargets = qMax(0, settings.maxTargets);
+    m_settings.matchThresholdDeg = qBound(0.0, settings.matchThresholdDeg, 180.0);
+    m_settings.ttlMs = qMax<qint64>(0, settings.ttlMs);
+    m_settings.fadeMs = qMax<qint64>(0, settings.fadeMs);
+    m_settings.scoreDecayPerIngest = qBound(0.0, settings.scoreDecayPerIngest, 1.0);
+    m_settings.azimuthLerpK = qBound(0.0, settings.azimuthLerpK, 1.0);
+
+    // Корзина не уже порога: все трассы в пределах порога лежат в корзине
+    // пеленга или в соседних. При менее чем трех корзинах соседи совпадают,
+    // и проще держать все трассы в одной.
+    const int count = static_cast<int>(360.0 / qMax(kMinBucketDeg, m_settings.matchThresholdDeg));
+    const int buckets = count < 3 ? 1 : count;
+    m_bucketDeg = 360.0 / buckets;
+    m_buckets.assign(static_cast<size_t>(buckets), {});
+    rebuildBuckets();
+}
+
+/*!
+ *  \brief Принимает пеленги, обновляет и прореживает трассы.
+ *  \param[in] bearingsDeg Пеленги, градусы.
+ *  \param[in] count Количество пеленгов.
+ *  \param[in] nowMs Текущее время, мс от начала эпохи.
+ */
+void BearingTracker::ingest(const double *bearingsDeg, int count, qint64 nowMs)
+{
+    for (Track &track : m_tracks) {
+        track.score *= m_settings.scoreDecayPerIngest;
+    }
+
+    const int bucketCount = static_cast<int>(m_buckets.size());
+    for (int i = 0; i < count; ++i) {
+        if (!std::isfinite(bearingsDeg[i])) {
+            continue;
+        }
+        const double azimuth = normalize360(bearingsDeg[i]);
+        const int bucket = bucketOf(azimuth);
+
+        int best = -1;
+        double bestDiff = 1e9;
+        const int neighbours = bucketCount == 1 ? 0 : 1;
+        for (int offset = -neighbours; offset <= neighbours; ++offset) {
+            const int b = (bucket + offset + bucketCount) % bucketCount;
+            for (const int index : m_buckets[static_cast<size_t>(b)]) {
+                const double diff = wrapDiff(m_tracks[static_cast<size_t>(index)].azimuthDeg, azimuth);
+                if (diff < bestDiff) {
+                    bestDiff = diff;
+                    best = index;
+                }
+            }
+        }
+
+        if (best >= 0 && bestDiff <= m_settings.matchThresholdDeg) {
+            Track &track = m_tracks[static_cast<size_t>(best)];
+            const int previousBucket = bucketOf(track.azimuthDeg);
+            track.azimuthDeg = circularLerp(track.azimuthDeg, azimuth, m_settings.azimuthLerpK);
+            track.lastSeenMs = nowMs;
+            track.score += 1.0;
+            moveBucket(best, previousBucket, bucketOf(track.azimuthDeg));
+        } else {
+            Track track;
+            track.id = m_nextId++;
+            track.azimuthDeg = azimuth;
+            track.lastSeenMs = nowMs;
+            track.score = 1.0;
+            m_tracks.push_back(track);
+            m_buckets[static_cast<size_t>(bucket)].push_back(static_cast<int>(m_tracks.size()) - 1);
+        }
+    }
+
+    prune(nowMs);
+}
+
+/*!
+ *  \brief Удаляет устаревшие трассы и ограничивает их число.
+ *  \param[in] nowMs Текущее время, мс от начала эпохи.
+ */
+void BearingTracker::prune(qint64 nowMs)
+{
+    const qint64 ttlMs = m_settings.ttlMs;
+    const size_t before = m_tracks.size();
+    m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(),
+                                  [nowMs, ttlMs](const Track &track) { return nowMs - track.lastSeenMs > ttlMs; }),
+                   m_tracks.end());
+
+    // Свежие раньше, при равной свежести — с большим счетом.
+    const auto fresher = [](const Track &a, const Track &b) {
+        if (a.lastSeenMs != b.lastSeenMs) {
+            return a.lastSeenMs > b.lastSeenMs;
+        }
+        return a.score > b.score;
+    };
+
+    // Полная сортировка не нужна: достаточно отделить maxTargets лучших.
+    const size_t maxTargets = static_cast<size_t>(m_settings.maxTargets);
+    if (m_tracks.size() > maxTargets) {
+        std::nth_element(m_tracks.begin(), m_tracks.begin() + static_cast<std::ptrdiff_t>(maxTargets), m_tracks.end(),
+                         fresher);
+        m_tracks.resize(maxTargets);
+    }
+
+    const auto freshest = std::min_element(m_tracks.begin(), m_tracks.end(), fresher);
+    m_freshestId = freshest == m_tracks.end() ? 0 : freshest->id;
+
+    // Удаление и nth_element переставляют трассы, поэтому индексы корзин
+    // пересобираются; при неизменном составе они остаются верными.
+    if (m_tracks.size() != before || before > maxTargets) {
+        rebuildBuckets();
+    }
+}
+
+//! \brief Удаляет все трассы.
+void BearingTracker::clear()
+{
+    m_tracks.clear();
+    for (std::vector<int> &bucket : m_buckets) {
+        bucket.clear();
+    }
+    m_freshestId = 0;
+}
+
+//! \brief Приводит угол к диапазону [0, 360).
+double BearingTracker::normalize360(double deg) noexcept
+{
+    double result = std::fmod(deg, 360.0);
+    if (result < 0.0) {
+        result += 360.0;
+    }
+    return result >= 360.0 ? 0.0 : result;
+}
+
+//! \brief Возвращает кратчайшее круговое расстояние между углами, градусы 0..180.
+double BearingTracker::wrapDiff(double a, double b) noexcept
+{
+    const double diff = std::fabs(normalize360(a) - normalize360(b));
+    return diff > 180.0 ? 360.0 - diff : diff;
+}
+
+/*!
+ *  \brief Круговая интерполяция угла.
+ *  \param[in] fromDeg Исходный угол.
+ *  \param[in] toDeg Целевой угол.
+ *  \param[in] k Доля сдвига по кратчайшей дуге, 0..1.
+ *  \return Угол в диапазоне [0, 360).
+ */
+double BearingTracker::circularLerp(double fromDeg, double toDeg, double k) noexcept
+{
+    const double from = normalize360(fromDeg);
+    double delta = normalize360(toDeg) - from;
+    if (delta > 180.0) {
+        delta -= 360.0;
+    } else if (delta < -180.0) {
+        delta += 360.0;
+    }
+    return normalize360(from + delta * k);
+}
+
+//! \brief Возвращает корзину угла.
+int BearingTracker::bucketOf(double deg) const noexcept
+{
+    const int count = static_cast<int>(m_buckets.size());
+    return qMin(count - 1, static_cast<int>(normalize360(deg) / m_bucketDeg));
+}
+
+//! \brief Раскладывает трассы по корзинам заново.
+void BearingTracker::rebuildBuckets()
+{
+    for (std::vector<int> &bucket : m_buckets) {
+        bucket.clear();
+    }
+    if (m_buckets.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < m_tracks.size(); ++i) {
+        m_buckets[static_cast<size_t>(bucketOf(m_tracks[i].azimuthDeg))].push_back(static_cast<int>(i));
+    }
+}
+
+/*!
+ *  \brief Переносит трассу в другую корзину.
+ *  \param[in] track Индекс трассы.
+ *  \param[in] from Прежняя корзина.
+ *  \param[in] to Новая корзина.
+ */
+void BearingTracker::moveBucket(int track, int from, int to)
+{
+    if (from == to) {
+        return;
+    }
+    std::vector<int> &source = m_buckets[static_cast<size_t>(from)];
+    const auto it = std::find(source.begin(), source.end(), track);
+    if (it != source.end()) {
+        *it = source.back();
+        source.pop_back();
+    }
+    m_buckets[static_cast<size_t>(to)].push_back(track);
+}
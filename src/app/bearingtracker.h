@@ -0,0 +1,130 @@
+/*!
+ *  \file bearingtracker.h
+ *  \brief Объединение зашумленных пеленгов в устойчивые трассы целей.
+ */
+#ifndef BEARINGTRACKER_H
+#define BEARINGTRACKER_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+/*!
+ *  \class BearingTracker
+ *  \brief Сопровождает цели по пеленгам с затуханием счета и временем жизни трасс.
+ *
+ *  Каждый пеленг обновляет ближайшую трассу, если она не дальше
+ *  matchThresholdDeg (азимут трассы подтягивается к пеленгу круговой
+ *  интерполяцией), иначе создает новую. Трассы разложены по угловым
+ *  корзинам шириной не меньше порога совпадения, поэтому ближайшая трасса
+ *  ищется только в корзине пеленга и двух соседних — O(1) на пеленг.
+ *
+ *  После каждого приема устаревшие (старше ttlMs) трассы удаляются, а из
+ *  оставшихся сохраняются maxTargets самых свежих (при равной свежести —
+ *  с большим счетом).
+ */
+class BearingTracker
+{
+public:
+    //! \brief Параметры сопровождения.
+    struct Settings
+    {
+        //! \brief Максимальное число трасс.
+        int maxTargets = 15;
+        //! \brief Наибольшее расстояние от пеленга до трассы, при котором он ее обновляет, градусы.
+        double matchThresholdDeg = 4.0;
+        //! \brief Время жизни трассы без обновлений, мс.
+        qint64 ttlMs = 12000;
+        //! \brief Время угасания трассы на индикаторе, мс.
+        qint64 fadeMs = 8000;
+        //! \brief Множитель счета трасс на каждый прием пеленгов.
+        double scoreDecayPerIngest = 0.98;
+        //! \brief Доля сдвига азимута трассы к совпавшему пеленгу, 0..1.
+        double azimuthLerpK = 0.25;
+    };
+
+    //! \brief Трасса цели.
+    struct Track
+    {
+        //! \brief Постоянный идентификатор трассы.
+        quint64 id = 0;
+        //! \brief Азимут, градусы 0..360.
+        double azimuthDeg = 0.0;
+        //! \brief Время последнего совпавшего пеленга, мс от начала эпохи.
+        qint64 lastSeenMs = 0;
+        //! \brief Счет: число совпадений с затуханием.
+        double score = 0.0;
+    };
+
+    //! \brief Конструирует сопровождение с параметрами по умолчанию.
+    BearingTracker();
+
+    /*!
+     *  \brief Задает параметры сопровождения.
+     *  \param[in] settings Параметры (нормализуются).
+     */
+    void setSettings(const Settings &settings);
+    //! \brief Возвращает нормализованные параметры.
+    const Settings &settings() const noexcept { return m_settings; }
+
+    /*!
+     *  \brief Принимает пеленги, обновляет и прореживает трассы.
+     *  \param[in] bearingsDeg Пеленги, градусы (любые, приводятся к 0..360).
+     *  \param[in] count Количество пеленгов.
+     *  \param[in] nowMs Текущее время, мс от начала эпохи.
+     */
+    void ingest(const double *bearingsDeg, int count, qint64 nowMs);
+    /*!
+     *  \brief Удаляет устаревшие трассы и ограничивает их число.
+     *  \param[in] nowMs Текущее время, мс от начала эпохи.
+     */
+    void prune(qint64 nowMs);
+    //! \brief Удаляет все трассы.
+    void clear();
+
+    //! \brief Возвращает трассы (порядок не определен).
+    const std::vector<Track> &tracks() const noexcept { return m_tracks; }
+    //! \brief Возвращает идентификатор самой свежей трассы (0 — трасс нет).
+    quint64 freshestId() const noexcept { return m_freshestId; }
+
+    //! \brief Приводит угол к диапазону [0, 360).
+    static double normalize360(double deg) noexcept;
+    //! \brief Возвращает кратчайшее круговое расстояние между углами, градусы 0..180.
+    static double wrapDiff(double a, double b) noexcept;
+    /*!
+     *  \brief Круговая интерполяция угла.
+     *  \param[in] fromDeg Исходный угол.
+     *  \param[in] toDeg Целевой угол.
+     *  \param[in] k Доля сдвига по кратчайшей дуге, 0..1.
+     *  \return Угол в диапазоне [0, 360).
+     */
+    static double circularLerp(double fromDeg, double toDeg, double k) noexcept;
+
+private:
+    //! \brief Возвращает корзину угла.
+    int bucketOf(double deg) const noexcept;
+    //! \brief Раскладывает трассы по корзинам заново.
+    void rebuildBuckets();
+    /*!
+     *  \brief Переносит трассу в другую корзину.
+     *  \param[in] track Индекс трассы.
+     *  \param[in] from Прежняя корзина.
+     *  \param[in] to Новая корзина.
+     */
+    void moveBucket(int track, int from, int to);
+
+    //! \brief Нормализованные параметры.
+    Settings m_settings;
+    //! \brief Трассы.
+    std::vector<Track> m_tracks;
+    //! \brief Индексы трасс по угловым корзинам.
+    std::vector<std::vector<int>> m_buckets;
+    //! \brief Ширина корзины, градусы.
+    double m_bucketDeg = 360.0;
+    //! \brief Следующий идентификатор трассы.
+    quint64 m_nextId = 1;
+    //! \brief Идентификатор самой свежей трассы.
+    quint64 m_freshestId = 0;
+};
+
+#endif // BEARINGTRACKER_H
@@ -0,0 +1,629 @@
+/*!
+ *  \file codeckernel.cpp
+ *  \brief Реализация CodecKernel.
+ */
+#include "codeckernel.h"
+
+#include <cmath>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIRIUS_CODEC_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using Block = CodecKernel::Block;
+
+//! \brief Количество 16-битных дорожек упаковки.
+constexpr int kLanes = 8;
+//! \brief Количество значений в дорожке блока.
+constexpr int kSlots = CodecKernel::kBlockValues / kLanes;
+//! \brief Количество вариантов предсказания.
+constexpr int kModeCount = 4;
+
+//! \brief Сигнатура ядра квантования.
+using QuantizeFn = void (*)(const float *, std::uint16_t *, std::int64_t, float, float, std::uint16_t);
+//! \brief Сигнатура ядра восстановления дБ.
+using DequantizeFn = void (*)(const std::uint16_t *, float *, std::int64_t, float, float);
+//! \brief Сигнатура ядра кодирования блока.
+using EncodeFn = Block (*)(const std::uint16_t *, const std::uint16_t *, unsigned char *);
+//! \brief Сигнатура ядра декодирования блока.
+using DecodeFn = void (*)(const Block &, const unsigned char *, const std::uint16_t *, std::uint16_t *);
+
+//! \brief Зигзаг-представление остатка: малые по модулю остатки дают малые коды.
+inline std::uint16_t zigzag(std::uint16_t residual)
+{
+    return static_cast<std::uint16_t>((residual << 1) ^ (0u - (residual >> 15)));
+}
+
+//! \brief Обратное зигзаг-представление.
+inline std::uint16_t unzigzag(std::uint16_t value)
+{
+    return static_cast<std::uint16_t>((value >> 1) ^ (0u - (value & 1u)));
+}
+
+//! \brief Возвращает разрядность 0..16 по объединению (OR) зигзаг-кодов.
+inline int widthOf(unsigned bits)
+{
+    return bits == 0 ? 0 : 32 - __builtin_clz(bits);
+}
+
+/*!
+ *  \brief Выбирает предсказание с наименьшей разрядностью (при равенстве — с меньшим номером).
+ *  \param[in] bits Объединение зигзаг-кодов каждого предсказания.
+ *  \param[in] modeCount Количество рассмотренных предсказаний.
+ *  \param[out] width Разрядность выбранного предсказания.
+ */
+inline int chooseMode(const unsigned *bits, int modeCount, int &width)
+{
+    int mode = 0;
+    width = widthOf(bits[0]);
+    for (int m = 1; m < modeCount; ++m) {
+        const int candidate = widthOf(bits[m]);
+        if (candidate < width) {
+            width = candidate;
+            mode = m;
+        }
+    }
+    return mode;
+}
+
+//! \brief Скалярное квантование (порядок операций совпадает с векторными вариантами).
+void quantizeScalar(const float *db, std::uint16_t *codes, std::int64_t count, float floorDb, float invStep,
+                    std::uint16_t maxCode)
+{
+    const float top = static_cast<float>(maxCode);
+    for (std::int64_t i = 0; i < count; ++i) {
+        float value = (db[i] - floorDb) * invStep;
+        value = value > 0.0f ? value : 0.0f;
+        value = value < top ? value : top;
+        codes[i] = static_cast<std::uint16_t>(std::lrintf(value));
+    }
+}
+
+//! \brief Скалярное восстановление дБ.
+void dequantizeScalar(const std::uint16_t *codes, float *db, std::int64_t count, float floorDb, float stepDb)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        db[i] = floorDb + static_cast<float>(codes[i]) * stepDb;
+    }
+}
+
+/*!
+ *  \brief Возвращает ряд предсказания: код или разность с предыдущим кадром.
+ *  \param[in] codes Коды блока.
+ *  \param[in] reference Коды предыдущего кадра.
+ *  \param[in] temporal Признак временного предсказания.
+ *  \param[in] i Номер значения.
+ */
+inline std::uint16_t seriesAt(const std::uint16_t *codes, const std::uint16_t *reference, bool temporal, int i)
+{
+    return temporal ? static_cast<std::uint16_t>(codes[i] - reference[i]) : codes[i];
+}
+
+//! \brief Скалярное кодирование блока.
+Block encodeBlockScalar(const std::uint16_t *codes, const std::uint16_t *reference, unsigned char *payload)
+{
+    unsigned bits[kModeCount] = {0, 0, 0, 0};
+    const int modeCount = reference ? kModeCount : 2;
+    for (int temporal = 0; temporal * 2 < modeCount; ++temporal) {
+        const std::uint16_t base = seriesAt(codes, reference, temporal, 0);
+        std::uint16_t previous = base;
+        for (int i = 0; i < CodecKernel::kBlockValues; ++i) {
+            const std::uint16_t value = seriesAt(codes, reference, temporal, i);
+            bits[temporal * 2] |= zigzag(static_cast<std::uint16_t>(value - base));
+            bits[temporal * 2 + 1] |= zigzag(static_cast<std::uint16_t>(value - previous));
+            previous = value;
+        }
+    }
+
+    Block block{};
+    int width = 0;
+    const int mode = chooseMode(bits, modeCount, width);
+    const bool temporal = (mode & CodecKernel::kModeTemporal) != 0;
+    const bool delta = (mode & CodecKernel::kModeDelta) != 0;
+    block.base = seriesAt(codes, reference, temporal, 0);
+    block.mode = static_cast<std::uint8_t>(mode);
+    block.width = static_cast<std::uint8_t>(width);
+    if (width == 0) {
+        return block;
+    }
+
+    std::uint16_t residuals[CodecKernel::kBlockValues];
+    std::uint16_t previous = block.base;
+    for (int i = 0; i < CodecKernel::kBlockValues; ++i) {
+        const std::uint16_t value = seriesAt(codes, reference, temporal, i);
+        residuals[i] = zigzag(static_cast<std::uint16_t>(value - (delta ? previous : block.base)));
+        previous = value;
+    }
+
+    // Дорожка lane накапливает значения lane, lane + 8, ... и выводит каждые 16 бит.
+    for (int lane = 0; lane < kLanes; ++lane) {
+        std::uint32_t accumulator = 0;
+        int filled = 0;
+        int word = 0;
+        for (int slot = 0; slot < kSlots; ++slot) {
+            accumulator |= static_cast<std::uint32_t>(residuals[slot * kLanes + lane]) << filled;
+            filled += width;
+            if (filled >= 16) {
+                const std::uint16_t out = static_cast<std::uint16_t>(accumulator);
+                std::memcpy(payload + (word * kLanes + lane) * 2, &out, sizeof(out));
+                ++word;
+                filled -= 16;
+                accumulator >>= 16;
+            }
+        }
+    }
+    return block;
+}
+
+//! \brief Скалярное декодирование блока.
+void decodeBlockScalar(const Block &block, const unsigned char *payload, const std::uint16_t *reference,
+                       std::uint16_t *codes)
+{
+    const int width = block.width;
+    const std::uint32_t mask = (1u << width) - 1u;
+    std::uint16_t residuals[CodecKernel::kBlockValues];
+    for (int lane = 0; lane < kLanes; ++lane) {
+        std::uint32_t accumulator = 0;
+        int available = 0;
+        int word = 0;
+        for (int slot = 0; slot < kSlots; ++slot) {
+            if (available < width) {
+                std::uint16_t in;
+                std::memcpy(&in, payload + (word * kLanes + lane) * 2, sizeof(in));
+                accumulator |= static_cast<std::uint32_t>(in) << available;
+                ++word;
+                available += 16;
+            }
+            residuals[slot * kLanes + lane] = static_cast<std::uint16_t>(accumulator & mask);
+            accumulator >>= width;
+            available -= width;
+        }
+    }
+
+    const bool delta = (block.mode & CodecKernel::kModeDelta) != 0;
+    const bool temporal = (block.mode & CodecKernel::kModeTemporal) != 0;
+    std::uint16_t value = block.base;
+    for (int i = 0; i < CodecKernel::kBlockValues; ++i) {
+        const std::uint16_t residual = unzigzag(residuals[i]);
+        value = static_cast<std::uint16_t>((delta ? value : block.base) + residual);
+        codes[i] = temporal ? static_cast<std::uint16_t>(value + reference[i]) : value;
+    }
+}
+
+#ifdef SIRIUS_CODEC_X86
+
+//! \brief Зигзаг-представление восьми остатков.
+inline __m128i zigzagSse2(__m128i residual)
+{
+    return _mm_xor_si128(_mm_slli_epi16(residual, 1), _mm_srai_epi16(residual, 15));
+}
+
+//! \brief Объединение (OR) восьми 16-битных значений.
+inline unsigned horizontalOrSse2(__m128i bits)
+{
+    bits = _mm_or_si128(bits, _mm_srli_si128(bits, 8));
+    bits = _mm_or_si128(bits, _mm_srli_si128(bits, 4));
+    bits = _mm_or_si128(bits, _mm_srli_si128(bits, 2));
+    return static_cast<unsigned>(_mm_cvtsi128_si32(bits)) & 0xFFFFu;
+}
+
+/*!
+ *  \brief Векторы ряда предсказания и его сдвига на одно значение для восьми значений блока.
+ *  \param[in] codes Коды блока.
+ *  \param[in] reference Коды предыдущего кадра или nullptr.
+ *  \param[in] slot Номер восьмерки значений.
+ *  \param[in] base Первое значение ряда (предшественник значения 0).
+ *  \param[out] previous Ряд, сдвинутый на одно значение.
+ */
+inline __m128i seriesSse2(const std::uint16_t *codes, const std::uint16_t *reference, int slot, std::uint16_t base,
+                          __m128i &previous)
+{
+    const int i = slot * kLanes;
+    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + i));
+    if (reference) {
+        value = _mm_sub_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i *>(reference + i)));
+    }
+    if (slot == 0) {
+        previous = _mm_insert_epi16(_mm_slli_si128(value, 2), base, 0);
+    } else {
+        previous = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + i - 1));
+        if (reference) {
+            previous = _mm_sub_epi16(previous, _mm_loadu_si128(reinterpret_cast<const __m128i *>(reference + i - 1)));
+        }
+    }
+    return value;
+}
+
+/*!
+ *  \brief Вычисляет остатки выбранного предсказания и упаковывает их восемью дорожками.
+ *
+ *  Общая часть SSE2 и AVX2: значения упаковываются последовательно по восьмеркам.
+ *
+ *  \param[in] codes Коды блока.
+ *  \param[in] reference Коды предыдущего кадра или nullptr.
+ *  \param[in] block Описание блока (width > 0).
+ *  \param[out] payload Данные блока.
+ */
+inline void packBlockSse2(const std::uint16_t *codes, const std::uint16_t *reference, const Block &block,
+                          unsigned char *payload)
+{
+    const bool delta = (block.mode & CodecKernel::kModeDelta) != 0;
+    const std::uint16_t *ref = (block.mode & CodecKernel::kModeTemporal) != 0 ? reference : nullptr;
+    const int width = block.width;
+    const __m128i baseVector = _mm_set1_epi16(static_cast<short>(block.base));
+    __m128i accumulator = _mm_setzero_si128();
+    int filled = 0;
+    __m128i *out = reinterpret_cast<__m128i *>(payload);
+    for (int slot = 0; slot < kSlots; ++slot) {
+        __m128i previous;
+        const __m128i value = seriesSse2(codes, ref, slot, block.base, previous);
+        const __m128i residual = zigzagSse2(_mm_sub_epi16(value, delta ? previous : baseVector));
+        accumulator = _mm_or_si128(accumulator, _mm_sll_epi16(residual, _mm_cvtsi32_si128(filled)));
+        filled += width;
+        if (filled >= 16) {
+            _mm_storeu_si128(out++, accumulator);
+            filled -= 16;
+            // Старшие биты значения, не поместившиеся в выведенное слово.
+            accumulator = _mm_srl_epi16(residual, _mm_cvtsi32_si128(width - filled));
+        }
+    }
+}
+
+//! \brief Кодирование блока SSE2: восемь значений за шаг.
+Block encodeBlockSse2(const std::uint16_t *codes, const std::uint16_t *reference, unsigned char *payload)
+{
+    unsigned bits[kModeCount] = {0, 0, 0, 0};
+    const int modeCount = reference ? kModeCount : 2;
+    for (int temporal = 0; temporal * 2 < modeCount; ++temporal) {
+        const std::uint16_t *ref = temporal ? reference : nullptr;
+        const std::uint16_t base = seriesAt(codes, reference, temporal, 0);
+        const __m128i baseVector = _mm_set1_epi16(static_cast<short>(base));
+        __m128i offsetBits = _mm_setzero_si128();
+        __m128i deltaBits = _mm_setzero_si128();
+        for (int slot = 0; slot < kSlots; ++slot) {
+            __m128i previous;
+            const __m128i value = seriesSse2(codes, ref, slot, base, previous);
+            offsetBits = _mm_or_si128(offsetBits, zigzagSse2(_mm_sub_epi16(value, baseVector)));
+            deltaBits = _mm_or_si128(deltaBits, zigzagSse2(_mm_sub_epi16(value, previous)));
+        }
+        bits[temporal * 2] = horizontalOrSse2(offsetBits);
+        bits[temporal * 2 + 1] = horizontalOrSse2(deltaBits);
+    }
+
+    Block block{};
+    int width = 0;
+    const int mode = chooseMode(bits, modeCount, width);
+    block.base = seriesAt(codes, reference, (mode & CodecKernel::kModeTemporal) != 0, 0);
+    block.mode = static_cast<std::uint8_t>(mode);
+    block.width = static_cast<std::uint8_t>(width);
+    if (width > 0) {
+        packBlockSse2(codes, reference, block, payload);
+    }
+    return block;
+}
+
+//! \brief Декодирование блока SSE2: распаковка и префиксная сумма восьми значений за шаг.
+void decodeBlockSse2(const Block &block, const unsigned char *payload, const std::uint16_t *reference,
+                     std::uint16_t *codes)
+{
+    const int width = block.width;
+    const bool delta = (block.mode & CodecKernel::kModeDelta) != 0;
+    const bool temporal = (block.mode & CodecKernel::kModeTemporal) != 0;
+    const __m128i mask = _mm_set1_epi16(static_cast<short>((1u << width) - 1u));
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i *in = reinterpret_cast<const __m128i *>(payload);
+
+    __m128i current = _mm_setzero_si128();
+    int available = 0;
+    // Для спектральной разности — последнее восстановленное значение во всех дорожках.
+    __m128i carry = _mm_set1_epi16(static_cast<short>(block.base));
+    for (int slot = 0; slot < kSlots; ++slot) {
+        __m128i value;
+        if (width == 0) {
+            value = _mm_setzero_si128();
+        } else if (available >= width) {
+            value = _mm_and_si128(current, mask);
+            current = _mm_srl_epi16(current, _mm_cvtsi32_si128(width));
+            available -= width;
+        } else {
+            const __m128i next = _mm_loadu_si128(in++);
+            value = _mm_and_si128(_mm_or_si128(current, _mm_sll_epi16(next, _mm_cvtsi32_si128(available))), mask);
+            current = _mm_srl_epi16(next, _mm_cvtsi32_si128(width - available));
+            available = 16 - (width - available);
+        }
+
+        // Обратный зигзаг: (z >> 1) ^ -(z & 1).
+        value = _mm_xor_si128(_mm_srli_epi16(value, 1),
+                              _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(value, one)));
+        if (delta) {
+            value = _mm_add_epi16(value, _mm_slli_si128(value, 2));
+            value = _mm_add_epi16(value, _mm_slli_si128(value, 4));
+            value = _mm_add_epi16(value, _mm_slli_si128(value, 8));
+            value = _mm_add_epi16(value, carry);
+            carry = _mm_shufflehi_epi16(value, 0xFF);
+            carry = _mm_unpackhi_epi64(carry, carry);
+        } else {
+            value = _mm_add_epi16(value, carry);
+        }
+        if (temporal) {
+            value = _mm_add_epi16(value,
+                                  _mm_loadu_si128(reinterpret_cast<const __m128i *>(reference + slot * kLanes)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + slot * kLanes), value);
+    }
+}
+
+//! \brief Упаковка восьми int32 0..65535 в uint16 (SSE2 не имеет беззнакового насыщения).
+inline __m128i packCodesSse2(__m128i low, __m128i high)
+{
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    return _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(low, bias32), _mm_sub_epi32(high, bias32)), bias16);
+}
+
+//! \brief Квантование SSE2: восемь значений за шаг.
+void quantizeSse2(const float *db, std::uint16_t *codes, std::int64_t count, float floorDb, float invStep,
+                  std::uint16_t maxCode)
+{
+    const __m128 floor = _mm_set1_ps(floorDb);
+    const __m128 scale = _mm_set1_ps(invStep);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 top = _mm_set1_ps(static_cast<float>(maxCode));
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // max(NaN, 0) дает 0, как и скалярный вариант.
+        const __m128 low
+            = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(db + i), floor), scale), zero), top);
+        const __m128 high
+            = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(db + i + 4), floor), scale), zero), top);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + i),
+                         packCodesSse2(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high)));
+    }
+    quantizeScalar(db + i, codes + i, count - i, floorDb, invStep, maxCode);
+}
+
+//! \brief Восстановление дБ SSE2: восемь значений за шаг.
+void dequantizeSse2(const std::uint16_t *codes, float *db, std::int64_t count, float floorDb, float stepDb)
+{
+    const __m128 floor = _mm_set1_ps(floorDb);
+    const __m128 step = _mm_set1_ps(stepDb);
+    const __m128i zero = _mm_setzero_si128();
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + i));
+        const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(value, zero));
+        const __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(value, zero));
+        _mm_storeu_ps(db + i, _mm_add_ps(floor, _mm_mul_ps(low, step)));
+        _mm_storeu_ps(db + i + 4, _mm_add_ps(floor, _mm_mul_ps(high, step)));
+    }
+    dequantizeScalar(codes + i, db + i, count - i, floorDb, stepDb);
+}
+
+//! \brief Объединение (OR) шестнадцати 16-битных значений.
+__attribute__((target("avx2")))
+inline unsigned horizontalOrAvx2(__m256i bits)
+{
+    return horizontalOrSse2(_mm_or_si128(_mm256_castsi256_si128(bits), _mm256_extracti128_si256(bits, 1)));
+}
+
+/*!
+ *  \brief Кодирование блока AVX2: оценка предсказаний по шестнадцать значений за шаг.
+ *
+ *  Упаковка последовательна по восьмеркам значений и выполняется так же, как в SSE2.
+ */
+__attribute__((target("avx2")))
+Block encodeBlockAvx2(const std::uint16_t *codes, const std::uint16_t *reference, unsigned char *payload)
+{
+    unsigned bits[kModeCount] = {0, 0, 0, 0};
+    const int modeCount = reference ? kModeCount : 2;
+    for (int temporal = 0; temporal * 2 < modeCount; ++temporal) {
+        const std::uint16_t *ref = temporal ? reference : nullptr;
+        const std::uint16_t base = seriesAt(codes, reference, temporal, 0);
+        const __m256i baseVector = _mm256_set1_epi16(static_cast<short>(base));
+        __m256i offsetBits = _mm256_setzero_si256();
+        __m256i deltaBits = _mm256_setzero_si256();
+
+        // Первые шестнадцать значений: предшественник значения 0 — само base.
+        __m128i firstPrevious;
+        __m128i secondPrevious;
+        const __m128i first = seriesSse2(codes, ref, 0, base, firstPrevious);
+        const __m128i second = seriesSse2(codes, ref, 1, base, secondPrevious);
+        __m256i value = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        __m256i previous = _mm256_inserti128_si256(_mm256_castsi128_si256(firstPrevious), secondPrevious, 1);
+        for (int i = 0;;) {
+            const __m256i offset = _mm256_sub_epi16(value, baseVector);
+            const __m256i step = _mm256_sub_epi16(value, previous);
+            offsetBits = _mm256_or_si256(offsetBits,
+                                         _mm256_xor_si256(_mm256_slli_epi16(offset, 1), _mm256_srai_epi16(offset, 15)));
+            deltaBits = _mm256_or_si256(deltaBits,
+                                        _mm256_xor_si256(_mm256_slli_epi16(step, 1), _mm256_srai_epi16(step, 15)));
+            i += 16;
+            if (i >= CodecKernel::kBlockValues) {
+                break;
+            }
+            value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(codes + i));
+            previous = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(codes + i - 1));
+            if (ref) {
+                value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ref + i)));
+                previous = _mm256_sub_epi16(previous,
+                                            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ref + i - 1)));
+            }
+        }
+        bits[temporal * 2] = horizontalOrAvx2(offsetBits);
+        bits[temporal * 2 + 1] = horizontalOrAvx2(deltaBits);
+    }
+
+    Block block{};
+    int width = 0;
+    const int mode = chooseMode(bits, modeCount, width);
+    block.base = seriesAt(codes, reference, (mode & CodecKernel::kModeTemporal) != 0, 0);
+    block.mode = static_cast<std::uint8_t>(mode);
+    block.width = static_cast<std::uint8_t>(width);
+    if (width > 0) {
+        packBlockSse2(codes, reference, block, payload);
+    }
+    return block;
+}
+
+//! \brief Квантование AVX2: шестнадцать значений за шаг.
+__attribute__((target("avx2")))
+void quantizeAvx2(const float *db, std::uint16_t *codes, std::int64_t count, float floorDb, float invStep,
+                  std::uint16_t maxCode)
+{
+    const __m256 floor = _mm256_set1_ps(floorDb);
+    const __m256 scale = _mm256_set1_ps(invStep);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 top = _mm256_set1_ps(static_cast<float>(maxCode));
+    std::int64_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 low = _mm256_min_ps(
+            _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(db + i), floor), scale), zero), top);
+        const __m256 high = _mm256_min_ps(
+            _mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(db + i + 8), floor), scale), zero), top);
+        // packus чередует 128-битные половины; перестановка возвращает порядок значений.
+        const __m256i packed = _mm256_packus_epi32(_mm256_cvtps_epi32(low), _mm256_cvtps_epi32(high));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(codes + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    quantizeScalar(db + i, codes + i, count - i, floorDb, invStep, maxCode);
+}
+
+//! \brief Восстановление дБ AVX2: восемь значений за шаг без FMA.
+__attribute__((target("avx2")))
+void dequantizeAvx2(const std::uint16_t *codes, float *db, std::int64_t count, float floorDb, float stepDb)
+{
+    const __m256 floor = _mm256_set1_ps(floorDb);
+    const __m256 step = _mm256_set1_ps(stepDb);
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i value
+            = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(codes + i)));
+        _mm256_storeu_ps(db + i, _mm256_add_ps(floor, _mm256_mul_ps(_mm256_cvtepi32_ps(value), step)));
+    }
+    dequantizeScalar(codes + i, db + i, count - i, floorDb, stepDb);
+}
+
+#endif
+
+//! \brief Возвращает ядро квантования для варианта.
+QuantizeFn quantizeFunction(CodecKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_CODEC_X86
+    case CodecKernel::Variant::Sse2:
+        return quantizeSse2;
+    case CodecKernel::Variant::Avx2:
+        return quantizeAvx2;
+#endif
+    default:
+        return quantizeScalar;
+    }
+}
+
+//! \brief Возвращает ядро восстановления дБ для варианта.
+DequantizeFn dequantizeFunction(CodecKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_CODEC_X86
+    case CodecKernel::Variant::Sse2:
+        return dequantizeSse2;
+    case CodecKernel::Variant::Avx2:
+        return dequantizeAvx2;
+#endif
+    default:
+        return dequantizeScalar;
+    }
+}
+
+//! \brief Возвращает ядро кодирования блока для варианта.
+EncodeFn encodeFunction(CodecKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_CODEC_X86
+    case CodecKernel::Variant::Sse2:
+        return encodeBlockSse2;
+    case CodecKernel::Variant::Avx2:
+        return encodeBlockAvx2;
+#endif
+    default:
+        return encodeBlockScalar;
+    }
+}
+
+//! \brief Возвращает ядро декодирования блока для варианта (AVX2 распаковывает так же, как SSE2).
+DecodeFn decodeFunction(CodecKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_CODEC_X86
+    case CodecKernel::Variant::Sse2:
+    case CodecKernel::Variant::Avx2:
+        return decodeBlockSse2;
+#endif
+    default:
+        return decodeBlockScalar;
+    }
+}
+
+} // namespace
+
+//! \brief Возвращает лучший поддерживаемый процессором вариант (определяется один раз).
+CodecKernel::Variant CodecKernel::bestVariant() noexcept
+{
+    static const Variant best = [] {
+        for (int v = kVariantCount - 1; v > 0; --v) {
+            if (isSupported(static_cast<Variant>(v))) {
+                return static_cast<Variant>(v);
+            }
+        }
+        return Variant::Scalar;
+    }();
+    return best;
+}
+
+//! \brief Проверяет, поддерживает ли процессор вариант.
+bool CodecKernel::isSupported(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return true;
+#ifdef SIRIUS_CODEC_X86
+    case Variant::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Variant::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+//! \brief Квантует значения дБ.
+void CodecKernel::quantize(Variant variant, const float *db, std::uint16_t *codes, std::int64_t count, float floorDb,
+                           float invStep, std::uint16_t maxCode) noexcept
+{
+    quantizeFunction(variant)(db, codes, count, floorDb, invStep, maxCode);
+}
+
+//! \brief Восстанавливает значения дБ.
+void CodecKernel::dequantize(Variant variant, const std::uint16_t *codes, float *db, std::int64_t count, float floorDb,
+                             float stepDb) noexcept
+{
+    dequantizeFunction(variant)(codes, db, count, floorDb, stepDb);
+}
+
+//! \brief Кодирует блок кодов.
+CodecKernel::Block CodecKernel::encodeBlock(Variant variant, const std::uint16_t *codes,
+                                            const std::uint16_t *reference, unsigned char *payload) noexcept
+{
+    return encodeFunction(variant)(codes, reference, payload);
+}
+
+//! \brief Декодирует блок кодов.
+void CodecKernel::decodeBlock(Variant variant, const Block &block, const unsigned char *payload,
+                              const std::uint16_t *reference, std::uint16_t *codes) noexcept
+{
+    decodeFunction(variant)(block, payload, reference, codes);
+}
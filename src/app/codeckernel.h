@@ -0,0 +1,110 @@
+/*!
+ *  \file codeckernel.h
+ *  \brief Векторизованные ядра кодека спектра: квантование дБ, предсказание и упаковка блоков.
+ */
+#ifndef CODECKERNEL_H
+#define CODECKERNEL_H
+
+#include <cstdint>
+
+/*!
+ *  \class CodecKernel
+ *  \brief Ядра SpectrumCodec для кодов uint16: скалярное, SSE2 и AVX2.
+ *
+ *  Кадр кодируется блоками по kBlockValues кодов. Для блока выбирается
+ *  предсказание с наименьшей разрядностью остатков: по самому коду или по
+ *  разности с кодом предыдущего кадра (временное), в каждом случае от
+ *  первого значения блока или от соседнего значения (спектральная
+ *  разность). Остатки в зигзаг-представлении упаковываются по width бит
+ *  «вертикально»: значение i попадает в 16-битную дорожку i % 8, поэтому
+ *  упаковка и распаковка идут восемью значениями за шаг.
+ *
+ *  Вся арифметика кодов ведется по модулю 2^16, так что кодирование без
+ *  потерь для любых кодов. Все варианты дают побитно одинаковый результат;
+ *  вариант выбирается один раз по возможностям процессора.
+ */
+class CodecKernel
+{
+public:
+    //! \brief Вариант реализации ядра.
+    enum class Variant : int {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2
+    };
+
+    //! \brief Количество вариантов.
+    static constexpr int kVariantCount = 3;
+    //! \brief Количество кодов в блоке.
+    static constexpr int kBlockValues = 128;
+    //! \brief Признак спектральной разности в Block::mode.
+    static constexpr std::uint8_t kModeDelta = 1;
+    //! \brief Признак временного предсказания в Block::mode.
+    static constexpr std::uint8_t kModeTemporal = 2;
+
+    //! \brief Описание закодированного блока (хранится в потоке как есть).
+    struct Block
+    {
+        //! \brief Первое значение предсказываемого ряда.
+        std::uint16_t base;
+        //! \brief Предсказание: сочетание kModeDelta и kModeTemporal.
+        std::uint8_t mode;
+        //! \brief Разрядность остатков 0..16; данные блока занимают width * 16 байт.
+        std::uint8_t width;
+    };
+
+    //! \brief Возвращает лучший поддерживаемый процессором вариант.
+    static Variant bestVariant() noexcept;
+    //! \brief Проверяет, поддерживает ли процессор вариант.
+    static bool isSupported(Variant variant) noexcept;
+
+    /*!
+     *  \brief Квантует дБ: code = round((db - floorDb) * invStep), ограниченный 0..maxCode.
+     *
+     *  NaN и значения ниже floorDb дают 0, значения выше шкалы — maxCode.
+     *
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] db Значения, дБ.
+     *  \param[out] codes Коды.
+     *  \param[in] count Количество значений.
+     *  \param[in] floorDb Уровень кода 0, дБ.
+     *  \param[in] invStep Величина, обратная шагу квантования, 1/дБ.
+     *  \param[in] maxCode Наибольший код.
+     */
+    static void quantize(Variant variant, const float *db, std::uint16_t *codes, std::int64_t count, float floorDb,
+                         float invStep, std::uint16_t maxCode) noexcept;
+    /*!
+     *  \brief Восстанавливает дБ: db = floorDb + code * stepDb.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] codes Коды.
+     *  \param[out] db Значения, дБ.
+     *  \param[in] count Количество значений.
+     *  \param[in] floorDb Уровень кода 0, дБ.
+     *  \param[in] stepDb Шаг квантования, дБ.
+     */
+    static void dequantize(Variant variant, const std::uint16_t *codes, float *db, std::int64_t count, float floorDb,
+                           float stepDb) noexcept;
+
+    /*!
+     *  \brief Кодирует блок из kBlockValues кодов.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] codes Коды блока.
+     *  \param[in] reference Коды того же блока в предыдущем кадре или nullptr (без временного предсказания).
+     *  \param[out] payload Данные блока, не больше 16 * 16 байт.
+     *  \return Описание блока.
+     */
+    static Block encodeBlock(Variant variant, const std::uint16_t *codes, const std::uint16_t *reference,
+                             unsigned char *payload) noexcept;
+    /*!
+     *  \brief Декодирует блок из kBlockValues кодов.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] block Описание блока.
+     *  \param[in] payload Данные блока (block.width * 16 байт).
+     *  \param[in] reference Коды того же блока в предыдущем кадре (нужны при kModeTemporal).
+     *  \param[out] codes Коды блока (может совпадать с reference).
+     */
+    static void decodeBlock(Variant variant, const Block &block, const unsigned char *payload,
+                            const std::uint16_t *reference, std::uint16_t *codes) noexcept;
+};
+
+#endif // CODECKERNEL_H
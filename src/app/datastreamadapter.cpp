@@ -0,0 +1,311 @@
+/*!
+ *  \file datastreamadapter.cpp
+ *  \brief Реализация DataStreamAdapter.
+ */
+#include "datastreamadapter.h"
+
+#include "alignedallocator.h"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace StreamFormat;
+
+namespace {
+
+//! \brief Период проверки запроса остановки при отсутствии датаграмм, мс.
+constexpr int kReceiveTimeoutMs = 100;
+//! \brief Наибольшее число датаграмм за один вызов приема.
+constexpr int kMaxBatchSize = 1024;
+//! \brief Число пустых опросов кольца до перехода к паузам.
+constexpr int kIdleSpinCount = 2000;
+//! \brief Пауза между опросами пустого кольца, мкс.
+constexpr unsigned long kIdleSleepUs = 100;
+
+//! \brief Префикс адреса UDP.
+constexpr char kUdpScheme[] = "udp://";
+//! \brief Префикс адреса разделяемой памяти.
+constexpr char kSharedMemoryScheme[] = "shm://";
+
+} // namespace
+
+/*!
+ *  \brief Разбирает адрес потока.
+ *  \param[in] address Адрес потока.
+ *  \param[in,out] settings Параметры.
+ *  \return false, если адрес не распознан.
+ */
+bool DataStreamAdapter::parseAddress(const QString &address, Settings &settings)
+{
+    const QString trimmed = address.trimmed();
+    if (trimmed.startsWith(QLatin1String(kSharedMemoryScheme), Qt::CaseInsensitive)) {
+        const QString name = trimmed.mid(static_cast<int>(sizeof(kSharedMemoryScheme)) - 1);
+        if (name.isEmpty()) {
+            return false;
+        }
+        settings.transport = Transport::SharedMemory;
+        settings.sharedMemoryName = name;
+        return true;
+    }
+    if (trimmed.startsWith(QLatin1String(kUdpScheme), Qt::CaseInsensitive)) {
+        const QString rest = trimmed.mid(static_cast<int>(sizeof(kUdpScheme)) - 1);
+        const int colon = rest.lastIndexOf(QLatin1Char(':'));
+        if (colon < 0) {
+            return false;
+        }
+        bool ok = false;
+        const quint16 port = rest.mid(colon + 1).toUShort(&ok);
+        if (!ok || port == 0) {
+            return false;
+        }
+        const QString host = rest.left(colon);
+        settings.transport = Transport::Udp;
+        settings.host = host.isEmpty() ? QStringLiteral("0.0.0.0") : host;
+        settings.port = port;
+        return true;
+    }
+    return false;
+}
+
+/*!
+ *  \brief Конструирует закрытый приемник.
+ *  \param[in] parent Родительский объект.
+ */
+DataStreamAdapter::DataStreamAdapter(QObject *parent)
+    : QThread(parent)
+{
+    setObjectName(QStringLiteral("DataStreamAdapter"));
+}
+
+//! \brief Останавливает прием.
+DataStreamAdapter::~DataStreamAdapter()
+{
+    close();
+}
+
+/*!
+ *  \brief Открывает транспорт, создает источник и запускает поток приема.
+ *  \param[in] settings Параметры приема.
+ *  \return false, если сокет или кольцо открыть не удалось.
+ */
+bool DataStreamAdapter::open(const Settings &settings)
+{
+    close();
+
+    if (settings.transport == Transport::SharedMemory) {
+        if (!m_ring.open(settings.sharedMemoryName)) {
+            return false;
+        }
+    } else {
+#if defined(Q_OS_UNIX)
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(settings.port);
+        if (::inet_pton(AF_INET, settings.host.toLatin1().constData(), &address.sin_addr) != 1) {
+            return false;
+        }
+        m_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_socket < 0) {
+            return false;
+        }
+        const int reuse = 1;
+        ::setsockopt(m_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        // Большой приемный буфер переживает паузы потока приема; без прав
+        // администратора ядро ограничивает его net.core.rmem_max.
+        const int bufferBytes = settings.socketBufferBytes;
+#if defined(Q_OS_LINUX)
+        if (::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUFFORCE, &bufferBytes, sizeof(bufferBytes)) != 0)
+#endif
+        {
+            ::setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+        }
+        timeval timeout{};
+        timeout.tv_usec = kReceiveTimeoutMs * 1000;
+        ::setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        if (::bind(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            closeTransport();
+            return false;
+        }
+#else
+        return false;
+#endif
+    }
+
+    m_settings = settings;
+    m_settings.batchSize = qBound(1, settings.batchSize, kMaxBatchSize);
+    m_source = std::make_shared<StreamIqSource>(settings.sampleCapacity);
+    m_reassembler = std::make_unique<StreamReassembler>(m_source);
+    start();
+    return true;
+}
+
+//! \brief Останавливает прием и закрывает транспорт.
+void DataStreamAdapter::close()
+{
+    if (isRunning()) {
+        requestInterruption();
+        wait();
+    }
+    closeTransport();
+}
+
+//! \brief Возвращает снимок счетчиков.
+DataStreamAdapter::Statistics DataStreamAdapter::statistics() const
+{
+    Statistics stats;
+    if (m_reassembler) {
+        static_cast<StreamReassembler::Statistics &>(stats) = m_reassembler->statistics();
+    }
+    if (m_source) {
+        stats.skippedSamples = m_source->skippedSamples();
+    }
+    stats.ringDroppedPackets = m_ring.droppedPackets();
+    return stats;
+}
+
+//! \brief Цикл приема.
+void DataStreamAdapter::run()
+{
+    if (m_settings.transport == Transport::SharedMemory) {
+        receiveSharedMemory();
+    } else {
+        receiveUdp();
+    }
+}
+
+//! \brief Принимает датаграммы UDP, пока не запрошена остановка.
+void DataStreamAdapter::receiveUdp()
+{
+#if defined(Q_OS_UNIX)
+    const int batchSize = m_settings.batchSize;
+    std::vector<PacketHeader> headers(static_cast<size_t>(batchSize));
+    std::vector<int> payloadBytes(static_cast<size_t>(batchSize));
+    std::vector<StreamReassembler::Slot> batch(static_cast<size_t>(batchSize));
+    std::vector<char, AlignedAllocator<char>> scratch(static_cast<size_t>(batchSize) * kMaxDatagramPayloadBytes);
+    std::vector<iovec> vectors(static_cast<size_t>(batchSize) * 3);
+#if defined(Q_OS_LINUX)
+    std::vector<mmsghdr> messages(static_cast<size_t>(batchSize));
+#else
+    std::vector<msghdr> messages(static_cast<size_t>(batchSize));
+#endif
+    for (int k = 0; k < batchSize; ++k) {
+        batch[static_cast<size_t>(k)].scratch = scratch.data() + static_cast<size_t>(k) * kMaxDatagramPayloadBytes;
+    }
+
+    while (!isInterruptionRequested()) {
+        // Заголовок каждой датаграммы ложится в свой массив, данные — в
+        // предсказанное место, а то, что в него не поместилось, — в запасной
+        // буфер со смещением, продолжающим данные.
+        m_reassembler->predict(batch.data(), batchSize);
+        for (int k = 0; k < batchSize; ++k) {
+            StreamReassembler::Slot &slot = batch[static_cast<size_t>(k)];
+            iovec *vector = vectors.data() + static_cast<size_t>(k) * 3;
+            vector[0].iov_base = &headers[static_cast<size_t>(k)];
+            vector[0].iov_len = sizeof(PacketHeader);
+            int count = 2;
+            if (slot.predicted) {
+                vector[1].iov_base = slot.predicted;
+                vector[1].iov_len = static_cast<size_t>(slot.predictedBytes);
+                vector[2].iov_base = slot.scratch + slot.predictedBytes;
+                vector[2].iov_len = static_cast<size_t>(kMaxDatagramPayloadBytes - slot.predictedBytes);
+                count = 3;
+            } else {
+                vector[1].iov_base = slot.scratch;
+                vector[1].iov_len = static_cast<size_t>(kMaxDatagramPayloadBytes);
+            }
+#if defined(Q_OS_LINUX)
+            msghdr &message = messages[static_cast<size_t>(k)].msg_hdr;
+#else
+            msghdr &message = messages[static_cast<size_t>(k)];
+#endif
+            message = msghdr{};
+            message.msg_iov = vector;
+            message.msg_iovlen = count;
+        }
+
+#if defined(Q_OS_LINUX)
+        const int received = ::recvmmsg(m_socket, messages.data(), static_cast<unsigned int>(batchSize),
+                                        MSG_WAITFORONE, nullptr);
+#else
+        int received = 0;
+        while (received < batchSize) {
+            const ssize_t length = ::recvmsg(m_socket, &messages[static_cast<size_t>(received)],
+                                             received == 0 ? 0 : MSG_DONTWAIT);
+            if (length < 0) {
+                break;
+            }
+            payloadBytes[static_cast<size_t>(received)] = static_cast<int>(length);
+            ++received;
+        }
+        if (received == 0) {
+            received = -1;
+        }
+#endif
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                continue;
+            }
+            emit errorOccurred(QString::fromLocal8Bit(std::strerror(errno)));
+            return;
+        }
+
+        for (int k = 0; k < received; ++k) {
+#if defined(Q_OS_LINUX)
+            const int length = static_cast<int>(messages[static_cast<size_t>(k)].msg_len);
+            const bool truncated = (messages[static_cast<size_t>(k)].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+#else
+            const int length = payloadBytes[static_cast<size_t>(k)];
+            const bool truncated = (messages[static_cast<size_t>(k)].msg_flags & MSG_TRUNC) != 0;
+#endif
+            payloadBytes[static_cast<size_t>(k)] =
+                truncated || length < kPacketHeaderBytes ? -1 : length - kPacketHeaderBytes;
+        }
+        m_reassembler->acceptBatch(headers.data(), payloadBytes.data(), batch.data(), received);
+    }
+#endif
+}
+
+//! \brief Читает кольцо разделяемой памяти, пока не запрошена остановка.
+void DataStreamAdapter::receiveSharedMemory()
+{
+    int idle = 0;
+    while (!isInterruptionRequested()) {
+        quint64 recordBytes = 0;
+        const PacketHeader *record = m_ring.begin(recordBytes);
+        if (!record) {
+            if (++idle > kIdleSpinCount) {
+                QThread::usleep(kIdleSleepUs);
+            } else {
+                QThread::yieldCurrentThread();
+            }
+            continue;
+        }
+        idle = 0;
+
+        // Заголовок копируется: проверенные поля не должны меняться под сборщиком.
+        const PacketHeader header = *record;
+        m_reassembler->accept(header, reinterpret_cast<const char *>(record) + kPacketHeaderBytes,
+                              static_cast<int>(header.payloadBytes));
+        m_ring.release(recordBytes);
+    }
+}
+
+//! \brief Закрывает сокет и кольцо.
+void DataStreamAdapter::closeTransport()
+{
+#if defined(Q_OS_UNIX)
+    if (m_socket >= 0) {
+        ::close(m_socket);
+    }
+#endif
+    m_socket = -1;
+    m_ring.close();
+}
@@ -0,0 +1,137 @@
+/*!
+ *  \file datastreamadapter.h
+ *  \brief Прием потока отсчетов и кадров спектра РПУ по UDP и через разделяемую память.
+ */
+#ifndef DATASTREAMADAPTER_H
+#define DATASTREAMADAPTER_H
+
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "sharedstreamring.h"
+#include "streamreassembler.h"
+
+/*!
+ *  \class DataStreamAdapter
+ *  \brief Поток приема данных РПУ: пакеты StreamFormat собираются в источник StreamIqSource.
+ *
+ *  По UDP датаграммы забираются пачками recvmmsg(): заголовок пакета
+ *  ложится в свой массив, данные — сразу в место, предсказанное
+ *  StreamReassembler (буфер кадра из пула или кольцо отсчетов), так что в
+ *  установившемся потоке данные не копируются ни разу после ядра. Из
+ *  разделяемой памяти данные копируются прямо из кольца в место
+ *  назначения. Движок получает данные через source(), подключенный как
+ *  обычный источник IqSource.
+ *
+ *  Сокет и кольцо открываются в open() (поток UI), дальше ими владеет
+ *  поток приема. Счетчики читаются из любого потока.
+ */
+class DataStreamAdapter : public QThread
+{
+    Q_OBJECT
+
+public:
+    //! \brief Транспорт потока.
+    enum class Transport {
+        //! \brief Датаграммы UDP.
+        Udp,
+        //! \brief Кольцевой буфер в разделяемой памяти.
+        SharedMemory
+    };
+
+    //! \brief Параметры приема.
+    struct Settings
+    {
+        //! \brief Транспорт.
+        Transport transport = Transport::Udp;
+        //! \brief Адрес приема UDP (IPv4).
+        QString host = QStringLiteral("0.0.0.0");
+        //! \brief Порт приема UDP.
+        quint16 port = 50000;
+        //! \brief Имя объекта разделяемой памяти.
+        QString sharedMemoryName;
+        //! \brief Наибольшее число датаграмм за один вызов recvmmsg().
+        int batchSize = 64;
+        //! \brief Запрашиваемый размер приемного буфера сокета, байты.
+        int socketBufferBytes = 32 << 20;
+        //! \brief Емкость кольца отсчетов.
+        int sampleCapacity = StreamIqSource::kDefaultSampleCapacity;
+    };
+
+    //! \brief Счетчики приема.
+    struct Statistics : StreamReassembler::Statistics
+    {
+        //! \brief Отсчеты, пропущенные движком из-за отставания.
+        quint64 skippedSamples = 0;
+        //! \brief Пакеты, не записанные РПУ в переполненное кольцо разделяемой памяти.
+        quint64 ringDroppedPackets = 0;
+    };
+
+    /*!
+     *  \brief Разбирает адрес потока.
+     *
+     *  Поддерживаются "udp://адрес:порт", "udp://:порт" и "shm://имя".
+     *
+     *  \param[in] address Адрес потока.
+     *  \param[in,out] settings Параметры; заполняются транспорт и адрес.
+     *  \return false, если адрес не распознан.
+     */
+    static bool parseAddress(const QString &address, Settings &settings);
+
+    /*!
+     *  \brief Конструирует закрытый приемник.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit DataStreamAdapter(QObject *parent = nullptr);
+    //! \brief Останавливает прием.
+    ~DataStreamAdapter() override;
+
+    /*!
+     *  \brief Открывает транспорт, создает источник и запускает поток приема (поток UI).
+     *  \param[in] settings Параметры приема.
+     *  \return false, если сокет или кольцо открыть не удалось.
+     */
+    bool open(const Settings &settings);
+    //! \brief Останавливает прием и закрывает транспорт (поток UI).
+    void close();
+    //! \brief Проверяет, идет ли прием.
+    bool isOpen() const noexcept { return isRunning(); }
+
+    //! \brief Возвращает источник с принятыми данными (пустой, пока прием не открыт).
+    std::shared_ptr<StreamIqSource> source() const { return m_source; }
+    //! \brief Возвращает снимок счетчиков (любой поток).
+    Statistics statistics() const;
+
+signals:
+    //! \brief Сигнал об ошибке приема (прием прекращается).
+    void errorOccurred(const QString &message);
+
+protected:
+    //! \brief Цикл приема.
+    void run() override;
+
+private:
+    //! \brief Принимает датаграммы UDP, пока не запрошена остановка.
+    void receiveUdp();
+    //! \brief Читает кольцо разделяемой памяти, пока не запрошена остановка.
+    void receiveSharedMemory();
+    //! \brief Закрывает сокет и кольцо.
+    void closeTransport();
+
+    //! \brief Параметры приема.
+    Settings m_settings;
+    //! \brief Источник с принятыми данными.
+    std::shared_ptr<StreamIqSource> m_source;
+    //! \brief Сборщик пакетов (поток приема).
+    std::unique_ptr<StreamReassembler> m_reassembler;
+    //! \brief Дескриптор сокета UDP или -1.
+    int m_socket = -1;
+    //! \brief Кольцо разделяемой памяти.
+    SharedStreamRing m_ring;
+};
+
+#endif // DATASTREAMADAPTER_H
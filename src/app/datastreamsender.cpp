@@ -0,0 +1,263 @@
+/*!
+ *  \file datastreamsender.cpp
+ *  \brief Реализация DataStreamSender.
+ */
+#include "datastreamsender.h"
+
+#include <QThread>
+
+#include <array>
+#include <chrono>
+
+#if defined(Q_OS_UNIX)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+using namespace StreamFormat;
+
+namespace {
+
+//! \brief Наибольшее число датаграмм за один вызов передачи.
+constexpr int kSendBatch = 64;
+
+} // namespace
+
+//! \brief Закрывает транспорт.
+DataStreamSender::~DataStreamSender()
+{
+    close();
+}
+
+/*!
+ *  \brief Открывает передачу по UDP.
+ *  \param[in] host Адрес получателя.
+ *  \param[in] port Порт получателя.
+ *  \param[in] payloadBytes Наибольший размер данных датаграммы, байты.
+ *  \return false, если сокет открыть не удалось.
+ */
+bool DataStreamSender::openUdp(const QString &host, quint16 port, int payloadBytes)
+{
+    close();
+#if defined(Q_OS_UNIX)
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (::inet_pton(AF_INET, host.toLatin1().constData(), &address.sin_addr) != 1) {
+        return false;
+    }
+    m_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0) {
+        return false;
+    }
+    // Сокет соединяется с получателем: датаграммам не нужен адрес.
+    if (::connect(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        close();
+        return false;
+    }
+    m_payloadBytes = qBound(8, payloadBytes, kMaxDatagramPayloadBytes);
+    m_headers.reserve(kSendBatch);
+    m_payloads.reserve(kSendBatch);
+    return true;
+#else
+    Q_UNUSED(host);
+    Q_UNUSED(port);
+    Q_UNUSED(payloadBytes);
+    return false;
+#endif
+}
+
+/*!
+ *  \brief Создает кольцо разделяемой памяти и открывает передачу в него.
+ *  \param[in] name Имя объекта разделяемой памяти.
+ *  \param[in] capacityBytes Размер кольца, байты.
+ *  \param[in] payloadBytes Наибольший размер данных пакета, байты.
+ *  \return false, если кольцо создать не удалось.
+ */
+bool DataStreamSender::openSharedMemory(const QString &name, qint64 capacityBytes, int payloadBytes)
+{
+    close();
+    if (!m_ring.create(name, capacityBytes)) {
+        return false;
+    }
+    // Пакет занимает не больше четверти кольца, чтобы писатель не ждал
+    // освобождения всего кольца ради одной записи.
+    const qint64 limit = static_cast<qint64>(m_ring.capacityBytes()) / 4 - kPacketHeaderBytes;
+    m_payloadBytes = static_cast<int>(qBound<qint64>(8, payloadBytes, limit));
+    return true;
+}
+
+//! \brief Закрывает транспорт.
+void DataStreamSender::close()
+{
+#if defined(Q_OS_UNIX)
+    if (m_socket >= 0) {
+        ::close(m_socket);
+    }
+#endif
+    m_socket = -1;
+    m_ring.close();
+    m_headers.clear();
+    m_payloads.clear();
+}
+
+/*!
+ *  \brief Передает кадр спектра.
+ *  \param[in] frame Кадр.
+ *  \return false, если хотя бы один пакет не передан.
+ */
+bool DataStreamSender::sendSpectrum(const SpectrumFrame &frame)
+{
+    if (!frame.isValid()) {
+        return false;
+    }
+    PacketHeader header{};
+    header.type = static_cast<quint16>(PacketType::Spectrum);
+    header.frameSequence = m_nextFrame++;
+    header.timestampUs = frame.timestampUs();
+    header.minHz = frame.viewMinHz();
+    header.maxHz = frame.viewMaxHz();
+    header.minDb = frame.minDb();
+    header.maxDb = frame.maxDb();
+    return sendFragments(header, reinterpret_cast<const char *>(frame.constBins()),
+                         static_cast<quint32>(frame.binCount()) * sizeof(float), sizeof(float));
+}
+
+/*!
+ *  \brief Передает блок отсчетов I/Q.
+ *  \param[in] samples Отсчеты.
+ *  \param[in] count Количество отсчетов.
+ *  \param[in] sampleRateHz Частота дискретизации, Гц.
+ *  \param[in] centerHz Центральная частота, Гц.
+ *  \param[in] timestampUs Время первого отсчета, мкс от начала эпохи.
+ *  \return false, если хотя бы один пакет не передан.
+ */
+bool DataStreamSender::sendSamples(const std::complex<float> *samples, int count, double sampleRateHz,
+                                   double centerHz, qint64 timestampUs)
+{
+    if (count <= 0) {
+        return false;
+    }
+    PacketHeader header{};
+    header.type = static_cast<quint16>(PacketType::Samples);
+    header.frameSequence = m_nextBlock++;
+    header.timestampUs = timestampUs;
+    header.minHz = centerHz - 0.5 * sampleRateHz;
+    header.maxHz = centerHz + 0.5 * sampleRateHz;
+    return sendFragments(header, reinterpret_cast<const char *>(samples),
+                         static_cast<quint32>(count) * sizeof(std::complex<float>), sizeof(std::complex<float>));
+}
+
+/*!
+ *  \brief Разбивает данные на пакеты и передает их.
+ *  \param[in] header Заголовок-образец.
+ *  \param[in] data Данные.
+ *  \param[in] bytes Размер данных, байты.
+ *  \param[in] alignment Кратность размера данных пакета, байты.
+ *  \return false, если хотя бы один пакет не передан.
+ */
+bool DataStreamSender::sendFragments(PacketHeader header, const char *data, quint32 bytes, int alignment)
+{
+    if (m_socket < 0 && !m_ring.isOpen()) {
+        return false;
+    }
+    const quint32 fragmentBytes = static_cast<quint32>(qMax(alignment, m_payloadBytes / alignment * alignment));
+    header.magic = kPacketMagic;
+    header.version = kVersion;
+    header.frameBytes = bytes;
+    header.fragmentCount = (bytes + fragmentBytes - 1) / fragmentBytes;
+
+    bool ok = true;
+    for (quint32 index = 0; index < header.fragmentCount; ++index) {
+        header.sequence = m_nextSequence++;
+        header.fragmentIndex = index;
+        header.fragmentOffset = index * fragmentBytes;
+        header.payloadBytes = qMin(fragmentBytes, bytes - header.fragmentOffset);
+        const char *payload = data + header.fragmentOffset;
+
+        if (m_socket >= 0) {
+            m_headers.push_back(header);
+            m_payloads.push_back(payload);
+            if (static_cast<int>(m_headers.size()) == kSendBatch) {
+                ok = flushDatagrams() && ok;
+            }
+            continue;
+        }
+
+        // Процесс РПУ не может ждать бесконечно: после паузы пакет отбрасывается.
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_ringWaitMs);
+        bool written = m_ring.write(header, payload);
+        while (!written && std::chrono::steady_clock::now() < deadline) {
+            QThread::yieldCurrentThread();
+            written = m_ring.write(header, payload);
+        }
+        if (written) {
+            ++m_sentPackets;
+        } else {
+            m_ring.reportDropped();
+            ++m_failedPackets;
+            ok = false;
+        }
+    }
+    if (m_socket >= 0) {
+        ok = flushDatagrams() && ok;
+    }
+    return ok;
+}
+
+//! \brief Передает накопленные датаграммы одним вызовом.
+bool DataStreamSender::flushDatagrams()
+{
+#if defined(Q_OS_UNIX)
+    const int count = static_cast<int>(m_headers.size());
+    std::array<iovec, 2 * kSendBatch> vectors;
+#if defined(Q_OS_LINUX)
+    std::array<mmsghdr, kSendBatch> messages{};
+#endif
+    bool ok = true;
+    int sent = 0;
+    for (int k = 0; k < count; ++k) {
+        vectors[static_cast<size_t>(2 * k)].iov_base = &m_headers[static_cast<size_t>(k)];
+        vectors[static_cast<size_t>(2 * k)].iov_len = sizeof(PacketHeader);
+        vectors[static_cast<size_t>(2 * k + 1)].iov_base = const_cast<char *>(m_payloads[static_cast<size_t>(k)]);
+        vectors[static_cast<size_t>(2 * k + 1)].iov_len = m_headers[static_cast<size_t>(k)].payloadBytes;
+#if defined(Q_OS_LINUX)
+        messages[static_cast<size_t>(k)].msg_hdr.msg_iov = &vectors[static_cast<size_t>(2 * k)];
+        messages[static_cast<size_t>(k)].msg_hdr.msg_iovlen = 2;
+#endif
+    }
+#if defined(Q_OS_LINUX)
+    while (sent < count) {
+        const int result = ::sendmmsg(m_socket, messages.data() + sent, static_cast<unsigned int>(count - sent), 0);
+        if (result <= 0) {
+            break;
+        }
+        sent += result;
+    }
+#else
+    for (; sent < count; ++sent) {
+        msghdr message{};
+        message.msg_iov = &vectors[static_cast<size_t>(2 * sent)];
+        message.msg_iovlen = 2;
+        if (::sendmsg(m_socket, &message, 0) < 0) {
+            break;
+        }
+    }
+#endif
+    if (sent < count) {
+        m_failedPackets += static_cast<quint64>(count - sent);
+        ok = false;
+    }
+    m_sentPackets += static_cast<quint64>(sent);
+    m_headers.clear();
+    m_payloads.clear();
+    return ok;
+#else
+    m_headers.clear();
+    m_payloads.clear();
+    return false;
+#endif
+}
@@ -0,0 +1,124 @@
+/*!
+ *  \file datastreamsender.h
+ *  \brief Передатчик потока StreamFormat — замена РПУ для локальной проверки приема.
+ */
+#ifndef DATASTREAMSENDER_H
+#define DATASTREAMSENDER_H
+
+#include <QString>
+#include <QtGlobal>
+
+#include <complex>
+#include <vector>
+
+#include "sharedstreamring.h"
+#include "spectrumframe.h"
+#include "streamformat.h"
+
+/*!
+ *  \class DataStreamSender
+ *  \brief Разбивает кадры спектра и блоки отсчетов на пакеты и передает их по UDP или в кольцо.
+ *
+ *  По UDP пакеты уходят пачками sendmmsg(): заголовок и данные собираются
+ *  ядром из отдельных буферов, данные берутся прямо из кадра. В кольцо
+ *  разделяемой памяти передатчик пишет как процесс РПУ: при переполнении
+ *  он ждет читателя не дольше заданного времени, затем пакет отбрасывается.
+ *  Объект используется из одного потока.
+ */
+class DataStreamSender
+{
+public:
+    //! \brief Наибольший размер данных пакета в кольце по умолчанию, байты.
+    static constexpr int kDefaultRingPayloadBytes = 1 << 20;
+
+    //! \brief Конструирует закрытый передатчик.
+    DataStreamSender() = default;
+    //! \brief Закрывает транспорт.
+    ~DataStreamSender();
+
+    DataStreamSender(const DataStreamSender &) = delete;
+    DataStreamSender &operator=(const DataStreamSender &) = delete;
+
+    /*!
+     *  \brief Открывает передачу по UDP.
+     *  \param[in] host Адрес получателя (IPv4).
+     *  \param[in] port Порт получателя.
+     *  \param[in] payloadBytes Наибольший размер данных датаграммы, байты.
+     *  \return false, если сокет открыть не удалось.
+     */
+    bool openUdp(const QString &host, quint16 port, int payloadBytes = StreamFormat::kMaxDatagramPayloadBytes);
+    /*!
+     *  \brief Создает кольцо разделяемой памяти и открывает передачу в него.
+     *  \param[in] name Имя объекта разделяемой памяти.
+     *  \param[in] capacityBytes Размер кольца, байты.
+     *  \param[in] payloadBytes Наибольший размер данных пакета, байты.
+     *  \return false, если кольцо создать не удалось.
+     */
+    bool openSharedMemory(const QString &name, qint64 capacityBytes, int payloadBytes = kDefaultRingPayloadBytes);
+    //! \brief Закрывает транспорт.
+    void close();
+
+    //! \brief Задает наибольшее ожидание места в кольце, мс.
+    void setRingWaitMs(int waitMs) noexcept { m_ringWaitMs = qMax(0, waitMs); }
+
+    /*!
+     *  \brief Передает кадр спектра.
+     *  \param[in] frame Кадр.
+     *  \return false, если хотя бы один пакет не передан.
+     */
+    bool sendSpectrum(const SpectrumFrame &frame);
+    /*!
+     *  \brief Передает блок отсчетов I/Q.
+     *  \param[in] samples Отсчеты.
+     *  \param[in] count Количество отсчетов.
+     *  \param[in] sampleRateHz Частота дискретизации, Гц.
+     *  \param[in] centerHz Центральная частота, Гц.
+     *  \param[in] timestampUs Время первого отсчета, мкс от начала эпохи.
+     *  \return false, если хотя бы один пакет не передан.
+     */
+    bool sendSamples(const std::complex<float> *samples, int count, double sampleRateHz, double centerHz,
+                     qint64 timestampUs);
+
+    //! \brief Возвращает число переданных пакетов.
+    quint64 sentPackets() const noexcept { return m_sentPackets; }
+    //! \brief Возвращает число пакетов, которые передать не удалось.
+    quint64 failedPackets() const noexcept { return m_failedPackets; }
+
+private:
+    /*!
+     *  \brief Разбивает данные на пакеты и передает их.
+     *  \param[in] header Заголовок-образец (тип, кадр, полоса, шкала).
+     *  \param[in] data Данные.
+     *  \param[in] bytes Размер данных, байты.
+     *  \param[in] alignment Кратность размера данных пакета, байты.
+     *  \return false, если хотя бы один пакет не передан.
+     */
+    bool sendFragments(StreamFormat::PacketHeader header, const char *data, quint32 bytes, int alignment);
+    //! \brief Передает накопленные датаграммы одним вызовом.
+    bool flushDatagrams();
+
+    //! \brief Дескриптор сокета UDP или -1.
+    int m_socket = -1;
+    //! \brief Кольцо разделяемой памяти.
+    SharedStreamRing m_ring;
+    //! \brief Наибольший размер данных пакета, байты.
+    int m_payloadBytes = StreamFormat::kMaxDatagramPayloadBytes;
+    //! \brief Наибольшее ожидание места в кольце, мс.
+    int m_ringWaitMs = 100;
+    //! \brief Сквозной номер следующего пакета.
+    quint32 m_nextSequence = 0;
+    //! \brief Номер следующего кадра спектра.
+    quint64 m_nextFrame = 0;
+    //! \brief Номер следующего блока отсчетов.
+    quint64 m_nextBlock = 0;
+    //! \brief Заголовки накопленных датаграмм.
+    std::vector<StreamFormat::PacketHeader> m_headers;
+    //! \brief Данные накопленных датаграмм (размер — в заголовке).
+    std::vector<const char *> m_payloads;
+    //! \brief Число переданных пакетов.
+    quint64 m_sentPackets = 0;
+    //! \brief Число непереданных пакетов.
+    quint64 m_failedPackets = 0;
+};
+
+#endif // DATASTREAMSENDER_H
@@ -0,0 +1,372 @@
+/*!
+ *  \file detectorkernel.cpp
+ *  \brief Реализация DetectorKernel.
+ */
+#include "detectorkernel.h"
+
+#include <algorithm>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIRIUS_DETECTOR_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//! \brief Сигнатура ядра сравнения с общим порогом.
+using CompareFn = void (*)(const float *, std::int64_t, float, std::uint64_t *);
+//! \brief Сигнатура ядра сравнения с порогами отдельных значений.
+using CompareArrayFn = void (*)(const float *, const float *, std::int64_t, std::uint64_t *);
+//! \brief Сигнатура ядра CA-CFAR для внутренних значений (окна целиком внутри кадра).
+using CellAveragingFn = void (*)(const double *, std::int64_t, std::int64_t, int, int, double, float, float *);
+
+/*!
+ *  \brief Собирает слово маски скалярно.
+ *  \param[in] values Значения слова.
+ *  \param[in] thresholds Пороги значений или nullptr.
+ *  \param[in] threshold Общий порог (если thresholds == nullptr).
+ *  \param[in] count Количество значений, не больше 64.
+ *  \return Слово маски.
+ */
+inline std::uint64_t compareWordScalar(const float *values, const float *thresholds, float threshold, int count)
+{
+    std::uint64_t bits = 0;
+    for (int k = 0; k < count; ++k) {
+        const float t = thresholds ? thresholds[k] : threshold;
+        bits |= static_cast<std::uint64_t>(values[k] > t) << k;
+    }
+    return bits;
+}
+
+//! \brief Скалярное сравнение с общим порогом.
+void compareScalar(const float *values, std::int64_t count, float threshold, std::uint64_t *mask)
+{
+    for (std::int64_t base = 0, w = 0; base < count; base += 64, ++w) {
+        mask[w] = compareWordScalar(values + base, nullptr, threshold, static_cast<int>(std::min<std::int64_t>(64, count - base)));
+    }
+}
+
+//! \brief Скалярное сравнение с порогами значений.
+void compareArrayScalar(const float *values, const float *thresholds, std::int64_t count, std::uint64_t *mask)
+{
+    for (std::int64_t base = 0, w = 0; base < count; base += 64, ++w) {
+        mask[w] = compareWordScalar(values + base, thresholds + base, 0.0f,
+                                    static_cast<int>(std::min<std::int64_t>(64, count - base)));
+    }
+}
+
+/*!
+ *  \brief Порог CA-CFAR одного значения с обрезанными границами кадра окнами.
+ *  \param[in] prefix Префиксные суммы.
+ *  \param[in] count Количество значений кадра.
+ *  \param[in] i Номер значения.
+ *  \param[in] guard Число защитных ячеек.
+ *  \param[in] training Число обучающих ячеек.
+ *  \param[in] offset Превышение над шумом.
+ *  \param[in] floor Нижняя граница порога.
+ *  \return Порог.
+ */
+inline float cellAveragingAt(const double *prefix, std::int64_t count, std::int64_t i, int guard, int training,
+                             float offset, float floor)
+{
+    const std::int64_t leftBegin = std::max<std::int64_t>(0, i - guard - training);
+    const std::int64_t leftEnd = std::max<std::int64_t>(0, i - guard);
+    const std::int64_t rightBegin = std::min(count, i + guard + 1);
+    const std::int64_t rightEnd = std::min(count, i + guard + training + 1);
+    const std::int64_t cells = (leftEnd - leftBegin) + (rightEnd - rightBegin);
+    if (cells <= 0) {
+        return floor;
+    }
+    const double sum = (prefix[leftEnd] - prefix[leftBegin]) + (prefix[rightEnd] - prefix[rightBegin]);
+    return std::max(floor, static_cast<float>(sum / static_cast<double>(cells)) + offset);
+}
+
+//! \brief Скалярный CA-CFAR для внутренних значений [first, last).
+void cellAveragingScalar(const double *prefix, std::int64_t first, std::int64_t last, int guard, int training,
+                         double offset, float floor, float *out)
+{
+    const double scale = 1.0 / (2.0 * training);
+    for (std::int64_t i = first; i < last; ++i) {
+        const double sum = (prefix[i + guard + training + 1] - prefix[i + guard + 1])
+                           + (prefix[i - guard] - prefix[i - guard - training]);
+        out[i - first] = std::max(floor, static_cast<float>(sum * scale + offset));
+    }
+}
+
+#ifdef SIRIUS_DETECTOR_X86
+
+//! \brief Сравнение SSE2 с общим порогом: 4 значения за шаг.
+void compareSse2(const float *values, std::int64_t count, float threshold, std::uint64_t *mask)
+{
+    const __m128 t = _mm_set1_ps(threshold);
+    std::int64_t base = 0;
+    std::int64_t w = 0;
+    for (; base + 64 <= count; base += 64, ++w) {
+        std::uint64_t bits = 0;
+        for (int k = 0; k < 64; k += 4) {
+            const int m = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(values + base + k), t));
+            bits |= static_cast<std::uint64_t>(m) << k;
+        }
+        mask[w] = bits;
+    }
+    if (base < count) {
+        mask[w] = compareWordScalar(values + base, nullptr, threshold, static_cast<int>(count - base));
+    }
+}
+
+//! \brief Сравнение SSE2 с порогами значений.
+void compareArraySse2(const float *values, const float *thresholds, std::int64_t count, std::uint64_t *mask)
+{
+    std::int64_t base = 0;
+    std::int64_t w = 0;
+    for (; base + 64 <= count; base += 64, ++w) {
+        std::uint64_t bits = 0;
+        for (int k = 0; k < 64; k += 4) {
+            const int m = _mm_movemask_ps(
+                _mm_cmpgt_ps(_mm_loadu_ps(values + base + k), _mm_loadu_ps(thresholds + base + k)));
+            bits |= static_cast<std::uint64_t>(m) << k;
+        }
+        mask[w] = bits;
+    }
+    if (base < count) {
+        mask[w] = compareWordScalar(values + base, thresholds + base, 0.0f, static_cast<int>(count - base));
+    }
+}
+
+//! \brief CA-CFAR SSE2: 2 значения за шаг в двойной точности.
+void cellAveragingSse2(const double *prefix, std::int64_t first, std::int64_t last, int guard, int training,
+                       double offset, float floor, float *out)
+{
+    const __m128d scale = _mm_set1_pd(1.0 / (2.0 * training));
+    const __m128d off = _mm_set1_pd(offset);
+    const __m128 fl = _mm_set1_ps(floor);
+    std::int64_t i = first;
+    for (; i + 4 <= last; i += 4) {
+        __m128d sum0 = _mm_add_pd(
+            _mm_sub_pd(_mm_loadu_pd(prefix + i + guard + training + 1), _mm_loadu_pd(prefix + i + guard + 1)),
+            _mm_sub_pd(_mm_loadu_pd(prefix + i - guard), _mm_loadu_pd(prefix + i - guard - training)));
+        __m128d sum1 = _mm_add_pd(
+            _mm_sub_pd(_mm_loadu_pd(prefix + i + guard + training + 3), _mm_loadu_pd(prefix + i + guard + 3)),
+            _mm_sub_pd(_mm_loadu_pd(prefix + i - guard + 2), _mm_loadu_pd(prefix + i - guard - training + 2)));
+        sum0 = _mm_add_pd(_mm_mul_pd(sum0, scale), off);
+        sum1 = _mm_add_pd(_mm_mul_pd(sum1, scale), off);
+        const __m128 noise = _mm_movelh_ps(_mm_cvtpd_ps(sum0), _mm_cvtpd_ps(sum1));
+        _mm_storeu_ps(out + (i - first), _mm_max_ps(noise, fl));
+    }
+    cellAveragingScalar(prefix, i, last, guard, training, offset, floor, out + (i - first));
+}
+
+//! \brief Сравнение AVX2 с общим порогом: 8 значений за шаг.
+__attribute__((target("avx2")))
+void compareAvx2(const float *values, std::int64_t count, float threshold, std::uint64_t *mask)
+{
+    const __m256 t = _mm256_set1_ps(threshold);
+    std::int64_t base = 0;
+    std::int64_t w = 0;
+    for (; base + 64 <= count; base += 64, ++w) {
+        std::uint64_t bits = 0;
+        for (int k = 0; k < 64; k += 8) {
+            const int m = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + base + k), t, _CMP_GT_OQ));
+            bits |= static_cast<std::uint64_t>(static_cast<unsigned>(m)) << k;
+        }
+        mask[w] = bits;
+    }
+    if (base < count) {
+        mask[w] = compareWordScalar(values + base, nullptr, threshold, static_cast<int>(count - base));
+    }
+}
+
+//! \brief Сравнение AVX2 с порогами значений.
+__attribute__((target("avx2")))
+void compareArrayAvx2(const float *values, const float *thresholds, std::int64_t count, std::uint64_t *mask)
+{
+    std::int64_t base = 0;
+    std::int64_t w = 0;
+    for (; base + 64 <= count; base += 64, ++w) {
+        std::uint64_t bits = 0;
+        for (int k = 0; k < 64; k += 8) {
+            const int m = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(values + base + k),
+                                                           _mm256_loadu_ps(thresholds + base + k), _CMP_GT_OQ));
+            bits |= static_cast<std::uint64_t>(static_cast<unsigned>(m)) << k;
+        }
+        mask[w] = bits;
+    }
+    if (base < count) {
+        mask[w] = compareWordScalar(values + base, thresholds + base, 0.0f, static_cast<int>(count - base));
+    }
+}
+
+//! \brief CA-CFAR AVX2: 8 значений за шаг, суммы в двойной точности.
+__attribute__((target("avx2")))
+void cellAveragingAvx2(const double *prefix, std::int64_t first, std::int64_t last, int guard, int training,
+                       double offset, float floor, float *out)
+{
+    const __m256d scale = _mm256_set1_pd(1.0 / (2.0 * training));
+    const __m256d off = _mm256_set1_pd(offset);
+    const __m256 fl = _mm256_set1_ps(floor);
+    const double *rightEnd = prefix + guard + training + 1;
+    const double *rightBegin = prefix + guard + 1;
+    const double *leftEnd = prefix - guard;
+    const double *leftBegin = prefix - guard - training;
+    std::int64_t i = first;
+    for (; i + 8 <= last; i += 8) {
+        __m256d sum0 = _mm256_add_pd(_mm256_sub_pd(_mm256_loadu_pd(rightEnd + i), _mm256_loadu_pd(rightBegin + i)),
+                                     _mm256_sub_pd(_mm256_loadu_pd(leftEnd + i), _mm256_loadu_pd(leftBegin + i)));
+        __m256d sum1 = _mm256_add_pd(
+            _mm256_sub_pd(_mm256_loadu_pd(rightEnd + i + 4), _mm256_loadu_pd(rightBegin + i + 4)),
+            _mm256_sub_pd(_mm256_loadu_pd(leftEnd + i + 4), _mm256_loadu_pd(leftBegin + i + 4)));
+        sum0 = _mm256_add_pd(_mm256_mul_pd(sum0, scale), off);
+        sum1 = _mm256_add_pd(_mm256_mul_pd(sum1, scale), off);
+        const __m256 noise = _mm256_set_m128(_mm256_cvtpd_ps(sum1), _mm256_cvtpd_ps(sum0));
+        _mm256_storeu_ps(out + (i - first), _mm256_max_ps(noise, fl));
+    }
+    cellAveragingScalar(prefix, i, last, guard, training, offset, floor, out + (i - first));
+}
+
+#endif // SIRIUS_DETECTOR_X86
+
+/*!
+ *  \brief Возвращает ядро сравнения с общим порогом для варианта.
+ *  \param[in] variant Вариант ядра.
+ */
+CompareFn compareFunction(DetectorKernel::Variant variant) noexcept
+{
+    switch (variant) {
+#ifdef SIRIUS_DETECTOR_X86
+    case DetectorKernel::Variant::Sse2:
+        return &compareSse2;
+    case DetectorKernel::Variant::Avx2:
+        return &compareAvx2;
+#endif
+    default:
+        return &compareScalar;
+    }
+}
+
+/*!
+ *  \brief Возвращает ядро сравнения с порогами значений для варианта.
+ *  \param[in] variant Вариант ядра.
+ */
+CompareArrayFn compareArrayFunction(DetectorKernel::Variant variant) noexcept
+{
+    switch (variant) {
+#ifdef SIRIUS_DETECTOR_X86
+    case DetectorKernel::Variant::Sse2:
+        return &compareArraySse2;
+    case DetectorKernel::Variant::Avx2:
+        return &compareArrayAvx2;
+#endif
+    default:
+        return &compareArrayScalar;
+    }
+}
+
+/*!
+ *  \brief Возвращает ядро CA-CFAR для варианта.
+ *  \param[in] variant Вариант ядра.
+ */
+CellAveragingFn cellAveragingFunction(DetectorKernel::Variant variant) noexcept
+{
+    switch (variant) {
+#ifdef SIRIUS_DETECTOR_X86
+    case DetectorKernel::Variant::Sse2:
+        return &cellAveragingSse2;
+    case DetectorKernel::Variant::Avx2:
+        return &cellAveragingAvx2;
+#endif
+    default:
+        return &cellAveragingScalar;
+    }
+}
+
+} // namespace
+
+//! \brief Возвращает лучший поддерживаемый процессором вариант (определяется один раз).
+DetectorKernel::Variant DetectorKernel::bestVariant() noexcept
+{
+    static const Variant best = [] {
+        for (int v = kVariantCount - 1; v > 0; --v) {
+            if (isSupported(static_cast<Variant>(v))) {
+                return static_cast<Variant>(v);
+            }
+        }
+        return Variant::Scalar;
+    }();
+    return best;
+}
+
+//! \brief Проверяет, поддерживает ли процессор вариант.
+bool DetectorKernel::isSupported(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return true;
+#ifdef SIRIUS_DETECTOR_X86
+    case Variant::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Variant::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+/*!
+ *  \brief Сравнивает значения с общим порогом.
+ *  \param[in] variant Вариант ядра.
+ *  \param[in] values Значения.
+ *  \param[in] count Количество значений.
+ *  \param[in] threshold Порог.
+ *  \param[out] mask Маска.
+ */
+void DetectorKernel::compare(Variant variant, const float *values, std::int64_t count, float threshold,
+                             std::uint64_t *mask) noexcept
+{
+    compareFunction(variant)(values, count, threshold, mask);
+}
+
+/*!
+ *  \brief Сравнивает значения с порогами отдельных значений.
+ *  \param[in] variant Вариант ядра.
+ *  \param[in] values Значения.
+ *  \param[in] thresholds Пороги.
+ *  \param[in] count Количество значений.
+ *  \param[out] mask Маска.
+ */
+void DetectorKernel::compare(Variant variant, const float *values, const float *thresholds, std::int64_t count,
+                             std::uint64_t *mask) noexcept
+{
+    compareArrayFunction(variant)(values, thresholds, count, mask);
+}
+
+/*!
+ *  \brief Вычисляет порог CA-CFAR для значений [first, last).
+ *
+ *  Значения, окна которых целиком внутри кадра, обрабатываются векторным
+ *  ядром; у краев кадра окна обрезаются и считаются скалярно.
+ */
+void DetectorKernel::cellAveragingThreshold(Variant variant, const double *prefix, std::int64_t count,
+                                            std::int64_t first, std::int64_t last, int guard, int training,
+                                            float offset, float floor, float *thresholds) noexcept
+{
+    const std::int64_t reach = static_cast<std::int64_t>(guard) + training;
+    const std::int64_t innerFirst = std::clamp(reach, first, last);
+    const std::int64_t innerLast = std::clamp(count - reach, innerFirst, last);
+
+    for (std::int64_t i = first; i < innerFirst; ++i) {
+        thresholds[i - first] = cellAveragingAt(prefix, count, i, guard, training, offset, floor);
+    }
+    if (training > 0 && innerLast > innerFirst) {
+        cellAveragingFunction(variant)(prefix, innerFirst, innerLast, guard, training, offset, floor,
+                                       thresholds + (innerFirst - first));
+    } else {
+        for (std::int64_t i = innerFirst; i < innerLast; ++i) {
+            thresholds[i - first] = cellAveragingAt(prefix, count, i, guard, training, offset, floor);
+        }
+    }
+    for (std::int64_t i = innerLast; i < last; ++i) {
+        thresholds[i - first] = cellAveragingAt(prefix, count, i, guard, training, offset, floor);
+    }
+}
@@ -0,0 +1,84 @@
+/*!
+ *  \file detectorkernel.h
+ *  \brief Векторизованные ядра сравнения с порогом и CA-CFAR для SignalDetector.
+ */
+#ifndef DETECTORKERNEL_H
+#define DETECTORKERNEL_H
+
+#include <cstdint>
+
+/*!
+ *  \class DetectorKernel
+ *  \brief Ядра обнаружения для float32: скалярное, SSE2 и AVX2.
+ *
+ *  Результат сравнения — битовая маска: бит i слова i / 64 установлен,
+ *  если значение i строго больше порога (NaN порог не превышает). Биты
+ *  за последним значением нулевые. Вариант выбирается один раз по
+ *  возможностям процессора; все варианты дают одинаковую маску.
+ */
+class DetectorKernel
+{
+public:
+    //! \brief Вариант реализации ядра.
+    enum class Variant : int {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2
+    };
+
+    //! \brief Количество вариантов.
+    static constexpr int kVariantCount = 3;
+
+    //! \brief Возвращает лучший поддерживаемый процессором вариант.
+    static Variant bestVariant() noexcept;
+    //! \brief Проверяет, поддерживает ли процессор вариант.
+    static bool isSupported(Variant variant) noexcept;
+
+    //! \brief Возвращает число 64-битных слов маски для count значений.
+    static std::int64_t maskWords(std::int64_t count) noexcept { return (count + 63) / 64; }
+
+    /*!
+     *  \brief Сравнивает значения с общим порогом.
+     *  \param[in] variant Вариант ядра (должен поддерживаться).
+     *  \param[in] values Значения.
+     *  \param[in] count Количество значений.
+     *  \param[in] threshold Порог.
+     *  \param[out] mask Маска на maskWords(count) слов.
+     */
+    static void compare(Variant variant, const float *values, std::int64_t count, float threshold,
+                        std::uint64_t *mask) noexcept;
+    /*!
+     *  \brief Сравнивает значения с порогами отдельных значений.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] values Значения.
+     *  \param[in] thresholds Пороги (count штук).
+     *  \param[in] count Количество значений.
+     *  \param[out] mask Маска на maskWords(count) слов.
+     */
+    static void compare(Variant variant, const float *values, const float *thresholds, std::int64_t count,
+                        std::uint64_t *mask) noexcept;
+
+    /*!
+     *  \brief Вычисляет порог CA-CFAR для значений [first, last) по префиксным суммам.
+     *
+     *  Шум значения i — среднее обучающих ячеек [i - guard - training, i - guard)
+     *  и (i + guard, i + guard + training], обрезанных границами [0, count).
+     *  Порог — максимум из floor и шума плюс offset; без обучающих ячеек — floor.
+     *
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] prefix Префиксные суммы: prefix[k] — сумма значений [0, k), count + 1 штук.
+     *  \param[in] count Количество значений кадра.
+     *  \param[in] first Первое значение диапазона.
+     *  \param[in] last Значение за последним.
+     *  \param[in] guard Число защитных ячеек с каждой стороны.
+     *  \param[in] training Число обучающих ячеек с каждой стороны.
+     *  \param[in] offset Превышение порога над шумом.
+     *  \param[in] floor Нижняя граница порога.
+     *  \param[out] thresholds Пороги (last - first штук).
+     */
+    static void cellAveragingThreshold(Variant variant, const double *prefix, std::int64_t count,
+                                       std::int64_t first, std::int64_t last, int guard, int training,
+                                       float offset, float floor, float *thresholds) noexcept;
+};
+
+#endif // DETECTORKERNEL_H
@@ -0,0 +1,297 @@
+/*!
+ *  \file directionfinder.cpp
+ *  \brief Реализация DirectionFinder и SyntheticArraySource.
+ */
+#include "directionfinder.h"
+
+#include <QtMath>
+
+#include <cmath>
+
+namespace {
+
+//! \brief Ослабление на краю ширины диаграммы, дБ.
+constexpr double kBeamEdgeDb = 3.0;
+//! \brief Ширина ячейки частот одного модельного источника, Гц.
+constexpr double kEmitterCellHz = 1e6;
+//! \brief Шаг азимутов модельных источников соседних ячеек, градусы (золотой угол).
+constexpr double kEmitterSpreadDeg = 137.50776405;
+
+//! \brief Приводит угол к диапазону [0, 360).
+double wrap360(double deg) noexcept
+{
+    const double wrapped = std::fmod(deg, 360.0);
+    return wrapped < 0.0 ? wrapped + 360.0 : wrapped;
+}
+
+} // namespace
+
+/*!
+ *  \brief Конструирует пеленгатор с параметрами по умолчанию.
+ *  \param[in] parent Родительский объект.
+ */
+DirectionFinder::DirectionFinder(QObject *parent)
+    : QObject(parent)
+    , m_bearings(std::make_shared<BearingQueue>())
+    , m_variant(DirectionKernel::bestVariant())
+    , m_activeSettings(m_settings)
+{
+    // Таблица строится до запуска потока DSP; дальше ее перестраивает только он.
+    rebuildTable();
+}
+
+//! \brief Задает количество каналов.
+void DirectionFinder::setChannelCount(int value)
+{
+    Settings settings = m_settings;
+    settings.channelCount = value;
+    settings = normalized(settings);
+    if (settings.channelCount == m_settings.channelCount) {
+        return;
+    }
+    m_settings = settings;
+    publishSettings();
+}
+
+//! \brief Задает ширину диаграммы антенны, градусы.
+void DirectionFinder::setBeamWidthDeg(double value)
+{
+    Settings settings = m_settings;
+    settings.beamWidthDeg = value;
+    settings = normalized(settings);
+    if (qFuzzyCompare(settings.beamWidthDeg, m_settings.beamWidthDeg)) {
+        return;
+    }
+    m_settings = settings;
+    publishSettings();
+}
+
+//! \brief Задает шаг таблицы диаграмм, градусы.
+void DirectionFinder::setStepDeg(double value)
+{
+    Settings settings = m_settings;
+    settings.stepDeg = value;
+    settings = normalized(settings);
+    if (qFuzzyCompare(settings.stepDeg, m_settings.stepDeg)) {
+        return;
+    }
+    m_settings = settings;
+    publishSettings();
+}
+
+//! \brief Задает порог расхождения амплитуд, дБ.
+void DirectionFinder::setMaxResidualDb(double value)
+{
+    Settings settings = m_settings;
+    settings.maxResidualDb = value;
+    settings = normalized(settings);
+    if (qFuzzyCompare(settings.maxResidualDb + 1.0, m_settings.maxResidualDb + 1.0)) {
+        return;
+    }
+    m_settings = settings;
+    publishSettings();
+}
+
+//! \brief Задает азимут оси антенной системы, градусы.
+void DirectionFinder::setAntennaAzimuthDeg(double value)
+{
+    value = wrap360(value);
+    if (m_antennaAzimuthDeg.exchange(value, std::memory_order_relaxed) != value) {
+        emit antennaAzimuthChanged();
+    }
+}
+
+/*!
+ *  \brief Вычисляет пеленги пакета импульсов и ставит их в очередь.
+ *  \param[in] batch Пакет импульсов.
+ *  \return false, если очередь заполнена и пакет пеленгов отброшен.
+ */
+bool DirectionFinder::process(const PulseBatch &batch)
+{
+    if (m_settingsRequests.consume()) {
+        m_activeSettings = m_settingsRequests.readBuffer();
+        rebuildTable();
+    }
+    if (batch.pulses.empty()) {
+        return true;
+    }
+
+    const int channelCount = m_activeSettings.channelCount;
+    const double angleStepDeg = 360.0 / static_cast<double>(m_angleCount);
+    const float *table = m_table.data();
+
+    BearingBatch bearings;
+    bearings.timestampUs = batch.timestampUs;
+    bearings.bearings.reserve(batch.pulses.size());
+    for (const Pulse &pulse : batch.pulses) {
+        // Среднее по каналам вычитается, как и в таблице: остается только
+        // соотношение амплитуд, не зависящее от уровня сигнала.
+        float measurement[kMaxChannels];
+        float mean = 0.0f;
+        for (int c = 0; c < channelCount; ++c) {
+            mean += pulse.amplitudeDb[static_cast<size_t>(c)];
+        }
+        mean /= static_cast<float>(channelCount);
+        for (int c = 0; c < channelCount; ++c) {
+            measurement[c] = pulse.amplitudeDb[static_cast<size_t>(c)] - mean;
+        }
+
+        float bestError = 0.0f;
+        const std::int64_t best = DirectionKernel::search(m_variant, table, m_angleCount, m_angleCount, measurement,
+                                                          channelCount, bestError);
+        const float residualDb = std::sqrt(bestError / static_cast<float>(channelCount));
+        if (!(residualDb <= m_activeSettings.maxResidualDb)) {
+            continue;
+        }
+
+        // Уточнение между узлами таблицы по параболе через соседние углы.
+        const float left = DirectionKernel::error(table, m_angleCount, (best + m_angleCount - 1) % m_angleCount,
+                                                  measurement, channelCount);
+        const float right = DirectionKernel::error(table, m_angleCount, (best + 1) % m_angleCount, measurement,
+                                                   channelCount);
+        const float curvature = left - 2.0f * bestError + right;
+        const double offset = curvature > 0.0f ? qBound(-0.5, 0.5 * (left - right) / curvature, 0.5) : 0.0;
+
+        Bearing bearing;
+        bearing.timestampUs = pulse.timestampUs;
+        bearing.frequencyHz = pulse.frequencyHz;
+        bearing.azimuthDeg = static_cast<float>(
+            wrap360(pulse.antennaAzimuthDeg + (static_cast<double>(best) + offset) * angleStepDeg));
+        bearing.residualDb = residualDb;
+        bearings.bearings.push_back(bearing);
+    }
+
+    if (bearings.bearings.empty()) {
+        return true;
+    }
+    if (!m_bearings->tryPush(std::move(bearings))) {
+        m_droppedBatches.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/*!
+ *  \brief Возвращает усиление антенны по модели диаграммы.
+ *  \param[in] offsetDeg Угол от оси антенны, градусы.
+ *  \param[in] beamWidthDeg Ширина диаграммы по уровню -3 дБ, градусы.
+ *  \return Усиление, дБ, не ниже kPatternFloorDb.
+ */
+float DirectionFinder::patternDb(double offsetDeg, double beamWidthDeg) noexcept
+{
+    // Гауссов главный лепесток: -3 дБ на половине ширины от оси.
+    double offset = wrap360(offsetDeg);
+    if (offset > 180.0) {
+        offset -= 360.0;
+    }
+    const double ratio = offset / (0.5 * beamWidthDeg);
+    return static_cast<float>(qMax<double>(kPatternFloorDb, -kBeamEdgeDb * ratio * ratio));
+}
+
+/*!
+ *  \brief Возвращает направление оси канала относительно оси антенной системы.
+ *  \param[in] channel Номер канала.
+ *  \param[in] channelCount Количество каналов.
+ *  \return Угол, градусы.
+ */
+double DirectionFinder::channelBoresightDeg(int channel, int channelCount) noexcept
+{
+    return 360.0 * channel / channelCount;
+}
+
+//! \brief Приводит параметры к допустимым значениям.
+DirectionFinder::Settings DirectionFinder::normalized(const Settings &settings) noexcept
+{
+    Settings result = settings;
+    result.channelCount = qBound(2, settings.channelCount, kMaxChannels);
+    result.beamWidthDeg = qBound(10.0, settings.beamWidthDeg, 360.0);
+    result.stepDeg = qBound(0.05, settings.stepDeg, 5.0);
+    result.maxResidualDb = qMax(0.0, settings.maxResidualDb);
+    return result;
+}
+
+//! \brief Публикует параметры для потока DSP.
+void DirectionFinder::publishSettings()
+{
+    m_settingsRequests.writeBuffer() = m_settings;
+    m_settingsRequests.publish();
+    emit settingsChanged();
+}
+
+//! \brief Строит таблицу диаграмм по действующим параметрам.
+void DirectionFinder::rebuildTable()
+{
+    const int channelCount = m_activeSettings.channelCount;
+    // Шаг подгоняется так, чтобы таблица ровно покрывала круг.
+    m_angleCount = qMax<std::int64_t>(1, qRound64(360.0 / m_activeSettings.stepDeg));
+    m_table.assign(static_cast<size_t>(m_angleCount) * static_cast<size_t>(channelCount), 0.0f);
+
+    float gains[kMaxChannels];
+    for (std::int64_t k = 0; k < m_angleCount; ++k) {
+        const double angleDeg = 360.0 * static_cast<double>(k) / static_cast<double>(m_angleCount);
+        float mean = 0.0f;
+        for (int c = 0; c < channelCount; ++c) {
+            gains[c] = patternDb(angleDeg - channelBoresightDeg(c, channelCount), m_activeSettings.beamWidthDeg);
+            mean += gains[c];
+        }
+        mean /= static_cast<float>(channelCount);
+        for (int c = 0; c < channelCount; ++c) {
+            m_table[static_cast<size_t>(c * m_angleCount + k)] = gains[c] - mean;
+        }
+    }
+}
+
+/*!
+ *  \brief Конструирует модель.
+ *  \param[in] seed Начальное состояние генератора шума.
+ */
+SyntheticArraySource::SyntheticArraySource(std::uint32_t seed)
+    : m_random(seed != 0 ? seed : 1)
+{
+}
+
+/*!
+ *  \brief Формирует импульсы с амплитудами каналов по пакету обнаружений.
+ *  \param[in] batch Пакет обнаружений.
+ *  \param[in] settings Параметры антенной системы.
+ *  \param[in] antennaAzimuthDeg Азимут оси антенной системы, градусы.
+ *  \param[out] pulses Пакет импульсов; память переиспользуется.
+ */
+void SyntheticArraySource::makePulses(const SignalBatch &batch, const DirectionFinder::Settings &settings,
+                                      double antennaAzimuthDeg, DirectionFinder::PulseBatch &pulses)
+{
+    pulses.timestampUs = batch.timestampUs;
+    pulses.pulses.clear();
+    for (const SignalEntity &signal : batch.signalList) {
+        DirectionFinder::Pulse pulse;
+        pulse.timestampUs = signal.timestampUs;
+        pulse.frequencyHz = signal.frequencyHz;
+        pulse.antennaAzimuthDeg = static_cast<float>(antennaAzimuthDeg);
+        const double relativeDeg = emitterAzimuthDeg(signal.frequencyHz) - antennaAzimuthDeg;
+        for (int c = 0; c < settings.channelCount; ++c) {
+            const float gainDb = DirectionFinder::patternDb(
+                relativeDeg - DirectionFinder::channelBoresightDeg(c, settings.channelCount), settings.beamWidthDeg);
+            pulse.amplitudeDb[static_cast<size_t>(c)] = signal.amplitudeDb + gainDb + m_noiseDb * nextGaussian();
+        }
+        pulses.pulses.push_back(pulse);
+    }
+}
+
+//! \brief Возвращает азимут модельного источника сигнала частоты frequencyHz, градусы.
+double SyntheticArraySource::emitterAzimuthDeg(double frequencyHz) noexcept
+{
+    return wrap360(std::floor(frequencyHz / kEmitterCellHz) * kEmitterSpreadDeg);
+}
+
+//! \brief Возвращает нормально распределенное число (преобразование Бокса — Мюллера).
+float SyntheticArraySource::nextGaussian() noexcept
+{
+    const auto uniform = [this]() {
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+        return (static_cast<double>(m_random >> 8) + 1.0) / 16777217.0;
+    };
+    const double radius = std::sqrt(-2.0 * std::log(uniform()));
+    return static_cast<float>(radius * std::cos(2.0 * M_PI * uniform()));
+}
@@ -0,0 +1,254 @@
+/*!
+ *  \file directionfinder.h
+ *  \brief Амплитудная пеленгация обнаруженных импульсов по многоканальным амплитудам.
+ */
+#ifndef DIRECTIONFINDER_H
+#define DIRECTIONFINDER_H
+
+#include <QObject>
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "directionkernel.h"
+#include "latestvalueslot.h"
+#include "signalentity.h"
+#include "spscqueue.h"
+
+/*!
+ *  \class DirectionFinder
+ *  \brief Вычисляет пеленги импульсов сравнением амплитуд каналов с диаграммами антенн.
+ *
+ *  Антенная система — channelCount антенн, оси которых равномерно
+ *  разнесены по кругу относительно оси антенной системы. Диаграмма каждой
+ *  антенны в дБ заранее сводится в таблицу по углам с шагом stepDeg; из
+ *  таблицы и из измерения вычитается среднее по каналам, поэтому пеленг не
+ *  зависит от уровня сигнала. Для каждого импульса DirectionKernel ищет
+ *  угол с наименьшей суммой квадратов расхождений, угол уточняется
+ *  параболой по соседним значениям и переводится в азимут с учетом
+ *  азимута антенной системы в момент импульса.
+ *
+ *  Импульсы обрабатываются пакетами в потоке DSP (process()); пеленги
+ *  пакетом передаются через lock-free очередь bearingQueue() ее
+ *  единственному потребителю (потоку сопровождения целей) в обход потока
+ *  UI. Параметры публикуются из потока UI через LatestValueSlot, азимут
+ *  антенной системы — атомарной переменной.
+ */
+class DirectionFinder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int channelCount READ channelCount WRITE setChannelCount NOTIFY settingsChanged)
+    Q_PROPERTY(double beamWidthDeg READ beamWidthDeg WRITE setBeamWidthDeg NOTIFY settingsChanged)
+    Q_PROPERTY(double stepDeg READ stepDeg WRITE setStepDeg NOTIFY settingsChanged)
+    Q_PROPERTY(double maxResidualDb READ maxResidualDb WRITE setMaxResidualDb NOTIFY settingsChanged)
+    Q_PROPERTY(double antennaAzimuthDeg READ antennaAzimuthDeg WRITE setAntennaAzimuthDeg NOTIFY antennaAzimuthChanged)
+
+public:
+    //! \brief Наибольшее число каналов.
+    static constexpr int kMaxChannels = 8;
+    //! \brief Нижняя граница диаграммы антенны, дБ.
+    static constexpr float kPatternFloorDb = -40.0f;
+    //! \brief Емкость очереди пакетов пеленгов.
+    static constexpr std::size_t kQueueCapacity = 64;
+
+    //! \brief Параметры пеленгации.
+    struct Settings
+    {
+        //! \brief Количество каналов (антенн).
+        int channelCount = 4;
+        //! \brief Ширина диаграммы антенны по уровню -3 дБ, градусы.
+        double beamWidthDeg = 90.0;
+        //! \brief Шаг таблицы диаграмм, градусы.
+        double stepDeg = 0.25;
+        //! \brief Наибольшее среднеквадратичное расхождение амплитуд, при котором пеленг принимается, дБ.
+        double maxResidualDb = 3.0;
+    };
+
+    //! \brief Импульс с амплитудами каналов.
+    struct Pulse
+    {
+        //! \brief Время импульса, мкс от начала эпохи.
+        qint64 timestampUs = 0;
+        //! \brief Частота, Гц.
+        double frequencyHz = 0.0;
+        //! \brief Азимут оси антенной системы в момент импульса, градусы.
+        float antennaAzimuthDeg = 0.0f;
+        //! \brief Амплитуды каналов, дБ.
+        std::array<float, kMaxChannels> amplitudeDb{};
+    };
+
+    //! \brief Пакет импульсов одного кадра.
+    struct PulseBatch
+    {
+        //! \brief Время кадра, мкс от начала эпохи.
+        qint64 timestampUs = 0;
+        //! \brief Импульсы.
+        std::vector<Pulse> pulses;
+    };
+
+    //! \brief Пеленг импульса.
+    struct Bearing
+    {
+        //! \brief Время импульса, мкс от начала эпохи.
+        qint64 timestampUs = 0;
+        //! \brief Частота, Гц.
+        double frequencyHz = 0.0;
+        //! \brief Азимут, градусы 0..360.
+        float azimuthDeg = 0.0f;
+        //! \brief Среднеквадратичное расхождение амплитуд с диаграммами, дБ.
+        float residualDb = 0.0f;
+    };
+
+    //! \brief Пакет пеленгов одного кадра.
+    struct BearingBatch
+    {
+        //! \brief Время кадра, мкс от начала эпохи.
+        qint64 timestampUs = 0;
+        //! \brief Пеленги.
+        std::vector<Bearing> bearings;
+    };
+
+    //! \brief Очередь пакетов пеленгов для одного потребителя.
+    using BearingQueue = SpscQueue<BearingBatch, kQueueCapacity>;
+
+    /*!
+     *  \brief Конструирует пеленгатор с параметрами по умолчанию.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit DirectionFinder(QObject *parent = nullptr);
+
+    //! \brief Возвращает количество каналов.
+    int channelCount() const noexcept { return m_settings.channelCount; }
+    //! \brief Задает количество каналов (2..kMaxChannels).
+    void setChannelCount(int value);
+    //! \brief Возвращает ширину диаграммы антенны, градусы.
+    double beamWidthDeg() const noexcept { return m_settings.beamWidthDeg; }
+    //! \brief Задает ширину диаграммы антенны, градусы.
+    void setBeamWidthDeg(double value);
+    //! \brief Возвращает шаг таблицы диаграмм, градусы.
+    double stepDeg() const noexcept { return m_settings.stepDeg; }
+    //! \brief Задает шаг таблицы диаграмм, градусы.
+    void setStepDeg(double value);
+    //! \brief Возвращает порог расхождения амплитуд, дБ.
+    double maxResidualDb() const noexcept { return m_settings.maxResidualDb; }
+    //! \brief Задает порог расхождения амплитуд, дБ.
+    void setMaxResidualDb(double value);
+
+    //! \brief Возвращает азимут оси антенной системы, градусы (любой поток).
+    double antennaAzimuthDeg() const noexcept { return m_antennaAzimuthDeg.load(std::memory_order_relaxed); }
+    //! \brief Задает азимут оси антенной системы, градусы.
+    void setAntennaAzimuthDeg(double value);
+
+    /*!
+     *  \brief Вычисляет пеленги пакета импульсов и ставит их в очередь (поток DSP).
+     *  \param[in] batch Пакет импульсов.
+     *  \return false, если очередь заполнена и пакет пеленгов отброшен.
+     */
+    bool process(const PulseBatch &batch);
+    //! \brief Возвращает действующие параметры (поток DSP).
+    const Settings &activeSettings() const noexcept { return m_activeSettings; }
+
+    //! \brief Возвращает очередь пеленгов; у очереди должен быть один потребитель.
+    std::shared_ptr<BearingQueue> bearingQueue() const noexcept { return m_bearings; }
+    //! \brief Возвращает число пакетов пеленгов, отброшенных из-за переполнения очереди.
+    quint64 droppedBatches() const noexcept { return m_droppedBatches.load(std::memory_order_relaxed); }
+
+    /*!
+     *  \brief Возвращает усиление антенны по модели диаграммы.
+     *  \param[in] offsetDeg Угол от оси антенны, градусы.
+     *  \param[in] beamWidthDeg Ширина диаграммы по уровню -3 дБ, градусы.
+     *  \return Усиление, дБ, не ниже kPatternFloorDb.
+     */
+    static float patternDb(double offsetDeg, double beamWidthDeg) noexcept;
+    /*!
+     *  \brief Возвращает направление оси канала относительно оси антенной системы.
+     *  \param[in] channel Номер канала.
+     *  \param[in] channelCount Количество каналов.
+     *  \return Угол, градусы.
+     */
+    static double channelBoresightDeg(int channel, int channelCount) noexcept;
+    //! \brief Приводит параметры к допустимым значениям.
+    static Settings normalized(const Settings &settings) noexcept;
+
+signals:
+    //! \brief Сигнал об изменении параметров.
+    void settingsChanged();
+    //! \brief Сигнал об изменении азимута антенной системы.
+    void antennaAzimuthChanged();
+
+private:
+    //! \brief Публикует параметры для потока DSP.
+    void publishSettings();
+    //! \brief Строит таблицу диаграмм по действующим параметрам (поток DSP).
+    void rebuildTable();
+
+    //! \brief Параметры (поток UI).
+    Settings m_settings;
+    //! \brief Слот параметров (UI -> DSP).
+    LatestValueSlot<Settings> m_settingsRequests;
+    //! \brief Азимут оси антенной системы, градусы.
+    std::atomic<double> m_antennaAzimuthDeg{0.0};
+    //! \brief Очередь пакетов пеленгов (DSP -> потребитель).
+    std::shared_ptr<BearingQueue> m_bearings;
+    //! \brief Число отброшенных пакетов пеленгов.
+    std::atomic<quint64> m_droppedBatches{0};
+
+    //! \brief Вариант векторного ядра.
+    DirectionKernel::Variant m_variant;
+    //! \brief Действующие параметры (поток DSP).
+    Settings m_activeSettings;
+    //! \brief Таблица диаграмм без среднего по каналам: channelCount строк по m_angleCount значений.
+    std::vector<float> m_table;
+    //! \brief Количество углов таблицы.
+    std::int64_t m_angleCount = 0;
+};
+
+/*!
+ *  \class SyntheticArraySource
+ *  \brief Модель антенной системы: амплитуды каналов для обнаруженных сигналов.
+ *
+ *  Заменяет многоканальный приемник, пока его нет: каждому сигналу
+ *  сопоставляется неподвижный источник с азимутом, зависящим от частоты
+ *  (ячейка 1 МГц), и амплитуды каналов вычисляются по модели диаграмм
+ *  DirectionFinder::patternDb() с гауссовым шумом.
+ */
+class SyntheticArraySource
+{
+public:
+    /*!
+     *  \brief Конструирует модель.
+     *  \param[in] seed Начальное состояние генератора шума.
+     */
+    explicit SyntheticArraySource(std::uint32_t seed = 1);
+
+    //! \brief Задает среднеквадратичный шум амплитуд каналов, дБ.
+    void setNoiseDb(float noiseDb) noexcept { m_noiseDb = qMax(0.0f, noiseDb); }
+
+    /*!
+     *  \brief Формирует импульсы с амплитудами каналов по пакету обнаружений.
+     *  \param[in] batch Пакет обнаружений.
+     *  \param[in] settings Параметры антенной системы.
+     *  \param[in] antennaAzimuthDeg Азимут оси антенной системы, градусы.
+     *  \param[out] pulses Пакет импульсов; память переиспользуется.
+     */
+    void makePulses(const SignalBatch &batch, const DirectionFinder::Settings &settings, double antennaAzimuthDeg,
+                    DirectionFinder::PulseBatch &pulses);
+
+    //! \brief Возвращает азимут модельного источника сигнала частоты frequencyHz, градусы.
+    static double emitterAzimuthDeg(double frequencyHz) noexcept;
+
+private:
+    //! \brief Возвращает нормально распределенное число.
+    float nextGaussian() noexcept;
+
+    //! \brief Состояние генератора xorshift32.
+    std::uint32_t m_random = 1;
+    //! \brief Среднеквадратичный шум амплитуд, дБ.
+    float m_noiseDb = 0.5f;
+};
+
+#endif // DIRECTIONFINDER_H
@@ -0,0 +1,201 @@
+/*!
+ *  \file directionkernel.cpp
+ *  \brief Реализация DirectionKernel.
+ */
+#include "directionkernel.h"
+
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIRIUS_DIRECTION_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//! \brief Сигнатура ядра поиска.
+using SearchFn = std::int64_t (*)(const float *, std::int64_t, std::int64_t, const float *, int, float &);
+
+/*!
+ *  \brief Скалярный поиск углов [first, angleCount) с продолжением текущего минимума.
+ *  \param[in,out] bestIndex Индекс лучшего угла.
+ *  \param[in,out] bestError Его расхождение.
+ */
+void searchTail(const float *table, std::int64_t stride, std::int64_t first, std::int64_t angleCount,
+                const float *measurement, int channelCount, std::int64_t &bestIndex, float &bestError)
+{
+    for (std::int64_t k = first; k < angleCount; ++k) {
+        const float error = DirectionKernel::error(table, stride, k, measurement, channelCount);
+        if (error < bestError) {
+            bestError = error;
+            bestIndex = k;
+        }
+    }
+}
+
+//! \brief Скалярный поиск.
+std::int64_t searchScalar(const float *table, std::int64_t stride, std::int64_t angleCount,
+                          const float *measurement, int channelCount, float &bestError)
+{
+    std::int64_t bestIndex = 0;
+    bestError = std::numeric_limits<float>::infinity();
+    searchTail(table, stride, 0, angleCount, measurement, channelCount, bestIndex, bestError);
+    return bestIndex;
+}
+
+#ifdef SIRIUS_DIRECTION_X86
+
+/*!
+ *  \brief Выбирает лучшую дорожку: наименьшее расхождение, при равенстве — наименьший индекс.
+ *  \param[in] errors Расхождения дорожек.
+ *  \param[in] indices Индексы дорожек.
+ *  \param[in] lanes Количество дорожек.
+ *  \param[out] bestError Расхождение лучшей дорожки.
+ *  \return Индекс лучшей дорожки.
+ */
+std::int64_t reduceLanes(const float *errors, const std::int32_t *indices, int lanes, float &bestError)
+{
+    std::int64_t bestIndex = 0;
+    bestError = std::numeric_limits<float>::infinity();
+    for (int lane = 0; lane < lanes; ++lane) {
+        if (errors[lane] < bestError || (errors[lane] == bestError && indices[lane] < bestIndex)) {
+            bestError = errors[lane];
+            bestIndex = indices[lane];
+        }
+    }
+    return bestIndex;
+}
+
+//! \brief Поиск SSE2: 4 угла за шаг.
+std::int64_t searchSse2(const float *table, std::int64_t stride, std::int64_t angleCount,
+                        const float *measurement, int channelCount, float &bestError)
+{
+    __m128 best = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128i bestIndices = _mm_setzero_si128();
+    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    std::int64_t k = 0;
+    for (; k + 4 <= angleCount; k += 4) {
+        __m128 error = _mm_setzero_ps();
+        for (int c = 0; c < channelCount; ++c) {
+            const __m128 delta = _mm_sub_ps(_mm_loadu_ps(table + c * stride + k), _mm_set1_ps(measurement[c]));
+            error = _mm_add_ps(error, _mm_mul_ps(delta, delta));
+        }
+        const __m128 less = _mm_cmplt_ps(error, best);
+        best = _mm_or_ps(_mm_and_ps(less, error), _mm_andnot_ps(less, best));
+        const __m128i lessIndices = _mm_castps_si128(less);
+        bestIndices = _mm_or_si128(_mm_and_si128(lessIndices, indices), _mm_andnot_si128(lessIndices, bestIndices));
+        indices = _mm_add_epi32(indices, step);
+    }
+
+    alignas(16) float errors[4];
+    alignas(16) std::int32_t laneIndices[4];
+    _mm_store_ps(errors, best);
+    _mm_store_si128(reinterpret_cast<__m128i *>(laneIndices), bestIndices);
+    std::int64_t bestIndex = reduceLanes(errors, laneIndices, 4, bestError);
+    searchTail(table, stride, k, angleCount, measurement, channelCount, bestIndex, bestError);
+    return bestIndex;
+}
+
+//! \brief Поиск AVX2: 8 углов за шаг (без FMA — результат совпадает со скалярным).
+__attribute__((target("avx2")))
+std::int64_t searchAvx2(const float *table, std::int64_t stride, std::int64_t angleCount,
+                        const float *measurement, int channelCount, float &bestError)
+{
+    __m256 best = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    __m256i bestIndices = _mm256_setzero_si256();
+    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    std::int64_t k = 0;
+    for (; k + 8 <= angleCount; k += 8) {
+        __m256 error = _mm256_setzero_ps();
+        for (int c = 0; c < channelCount; ++c) {
+            const __m256 delta = _mm256_sub_ps(_mm256_loadu_ps(table + c * stride + k),
+                                               _mm256_set1_ps(measurement[c]));
+            error = _mm256_add_ps(error, _mm256_mul_ps(delta, delta));
+        }
+        const __m256 less = _mm256_cmp_ps(error, best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, error, less);
+        bestIndices = _mm256_blendv_epi8(bestIndices, indices, _mm256_castps_si256(less));
+        indices = _mm256_add_epi32(indices, step);
+    }
+
+    alignas(32) float errors[8];
+    alignas(32) std::int32_t laneIndices[8];
+    _mm256_store_ps(errors, best);
+    _mm256_store_si256(reinterpret_cast<__m256i *>(laneIndices), bestIndices);
+    std::int64_t bestIndex = reduceLanes(errors, laneIndices, 8, bestError);
+    searchTail(table, stride, k, angleCount, measurement, channelCount, bestIndex, bestError);
+    return bestIndex;
+}
+
+#endif
+
+//! \brief Возвращает ядро поиска для варианта.
+SearchFn searchFunction(DirectionKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_DIRECTION_X86
+    case DirectionKernel::Variant::Sse2:
+        return searchSse2;
+    case DirectionKernel::Variant::Avx2:
+        return searchAvx2;
+#endif
+    default:
+        return searchScalar;
+    }
+}
+
+} // namespace
+
+//! \brief Возвращает лучший поддерживаемый процессором вариант (определяется один раз).
+DirectionKernel::Variant DirectionKernel::bestVariant() noexcept
+{
+    static const Variant best = [] {
+        for (int v = kVariantCount - 1; v > 0; --v) {
+            if (isSupported(static_cast<Variant>(v))) {
+                return static_cast<Variant>(v);
+            }
+        }
+        return Variant::Scalar;
+    }();
+    return best;
+}
+
+//! \brief Проверяет, поддерживает ли процессор вариант.
+bool DirectionKernel::isSupported(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return true;
+#ifdef SIRIUS_DIRECTION_X86
+    case Variant::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Variant::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+//! \brief Ищет угол с наименьшим расхождением.
+std::int64_t DirectionKernel::search(Variant variant, const float *table, std::int64_t stride,
+                                     std::int64_t angleCount, const float *measurement, int channelCount,
+                                     float &bestError) noexcept
+{
+    return searchFunction(variant)(table, stride, angleCount, measurement, channelCount, bestError);
+}
+
+//! \brief Вычисляет расхождение для одного угла.
+float DirectionKernel::error(const float *table, std::int64_t stride, std::int64_t angle, const float *measurement,
+                             int channelCount) noexcept
+{
+    float error = 0.0f;
+    for (int c = 0; c < channelCount; ++c) {
+        const float delta = table[c * stride + angle] - measurement[c];
+        const float square = delta * delta;
+        error = error + square;
+    }
+    return error;
+}
@@ -0,0 +1,65 @@
+/*!
+ *  \file directionkernel.h
+ *  \brief Векторизованный поиск пеленга по таблице диаграмм направленности.
+ */
+#ifndef DIRECTIONKERNEL_H
+#define DIRECTIONKERNEL_H
+
+#include <cstdint>
+
+/*!
+ *  \class DirectionKernel
+ *  \brief Поиск угла с наименьшим расхождением амплитуд каналов: скалярный, SSE2 и AVX2.
+ *
+ *  Таблица хранится по каналам: для канала c значения диаграммы всех углов
+ *  лежат подряд с шагом stride. Для каждого угла k вычисляется сумма по
+ *  каналам квадратов (table[c][k] - measurement[c]); векторные варианты
+ *  обрабатывают 4 или 8 углов за шаг в том же порядке операций, поэтому
+ *  все варианты выбирают один и тот же угол. Вариант выбирается один раз
+ *  по возможностям процессора.
+ */
+class DirectionKernel
+{
+public:
+    //! \brief Вариант реализации ядра.
+    enum class Variant : int {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2
+    };
+
+    //! \brief Количество вариантов.
+    static constexpr int kVariantCount = 3;
+
+    //! \brief Возвращает лучший поддерживаемый процессором вариант.
+    static Variant bestVariant() noexcept;
+    //! \brief Проверяет, поддерживает ли процессор вариант.
+    static bool isSupported(Variant variant) noexcept;
+
+    /*!
+     *  \brief Ищет угол с наименьшим расхождением.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] table Таблица диаграмм по каналам.
+     *  \param[in] stride Шаг между каналами в таблице, значения.
+     *  \param[in] angleCount Количество углов.
+     *  \param[in] measurement Измеренные амплитуды каналов.
+     *  \param[in] channelCount Количество каналов.
+     *  \param[out] bestError Наименьшая сумма квадратов расхождений.
+     *  \return Индекс угла; при равенстве — наименьший.
+     */
+    static std::int64_t search(Variant variant, const float *table, std::int64_t stride, std::int64_t angleCount,
+                               const float *measurement, int channelCount, float &bestError) noexcept;
+    /*!
+     *  \brief Вычисляет расхождение для одного угла в том же порядке операций.
+     *  \param[in] table Таблица диаграмм по каналам.
+     *  \param[in] stride Шаг между каналами в таблице, значения.
+     *  \param[in] angle Индекс угла.
+     *  \param[in] measurement Измеренные амплитуды каналов.
+     *  \param[in] channelCount Количество каналов.
+     *  \return Сумма квадратов расхождений.
+     */
+    static float error(const float *table, std::int64_t stride, std::int64_t angle, const float *measurement,
+                       int channelCount) noexcept;
+};
+
+#endif // DIRECTIONKERNEL_H
@@ -0,0 +1,601 @@
+/*!
+ *  \file fftprocessor.cpp
+ *  \brief Реализация FFTProcessor.
+ */
+#include "fftprocessor.h"
+
+#include <QList>
+#include <QPair>
+#include <QThreadPool>
+#include <QtMath>
+#include <QtConcurrent/QtConcurrentMap>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SIRIUS_FFT_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/*!
+ *  \struct FftPlan
+ *  \brief Предвычисленные таблицы БПФ одного размера.
+ */
+struct FftPlan
+{
+    //! \brief Двоичный логарифм размера.
+    int log2Size = 0;
+    //! \brief Размер БПФ.
+    int size = 0;
+    //! \brief Таблица двоично-инверсной перестановки.
+    std::vector<std::uint32_t> bitReverse;
+    /*!
+     *  \brief Поворачивающие множители по этапам, пары (re, im).
+     *
+     *  Для этапа с половиной бабочки h множители exp(-i * pi * j / h), j < h,
+     *  лежат подряд начиная с комплексного индекса h, поэтому каждый этап
+     *  читает их последовательно.
+     */
+    std::vector<float> twiddles;
+};
+
+namespace {
+
+//! \brief Размер блока, этапы внутри которого выполняются без выхода из кэша.
+constexpr int kBlockSize = 1 << 12;
+//! \brief Размер БПФ, начиная с которого работа делится между потоками.
+constexpr int kParallelThreshold = 1 << 17;
+//! \brief Число бабочек или значений в одной задаче пула.
+constexpr std::int64_t kTaskChunk = 1 << 14;
+//! \brief Нижняя граница мощности перед логарифмом.
+constexpr float kPowerFloor = 1e-20f;
+
+/*!
+ *  \brief Выполняет fn(first, last) для диапазонов [0, count), при необходимости в пуле потоков.
+ *  \param[in] count Общее количество элементов.
+ *  \param[in] chunk Количество элементов в одной задаче.
+ *  \param[in] parallel Разрешено ли деление между потоками.
+ *  \param[in] fn Обработчик диапазона.
+ */
+template <typename Fn>
+void forEachChunk(std::int64_t count, std::int64_t chunk, bool parallel, Fn fn)
+{
+    if (!parallel || count <= chunk) {
+        fn(std::int64_t(0), count);
+        return;
+    }
+
+    // Диапазоны не пересекаются: каждая задача пишет только свои элементы.
+    QList<QPair<qint64, qint64>> ranges;
+    for (qint64 first = 0; first < count; first += chunk) {
+        ranges.append({first, qMin<qint64>(count, first + chunk)});
+    }
+    QtConcurrent::blockingMap(ranges, [&fn](const QPair<qint64, qint64> &range) {
+        fn(range.first, range.second);
+    });
+}
+
+/*!
+ *  \brief Строит план БПФ.
+ *  \param[in] log2Size Двоичный логарифм размера.
+ *  \return План.
+ */
+std::shared_ptr<const FftPlan> buildPlan(int log2Size)
+{
+    auto plan = std::make_shared<FftPlan>();
+    plan->log2Size = log2Size;
+    plan->size = 1 << log2Size;
+
+    const int size = plan->size;
+    plan->bitReverse.resize(size);
+    plan->bitReverse[0] = 0;
+    for (int i = 1; i < size; ++i) {
+        plan->bitReverse[i] = (plan->bitReverse[i >> 1] >> 1) | ((i & 1u) << (log2Size - 1));
+    }
+
+    plan->twiddles.assign(static_cast<std::size_t>(size) * 2, 0.0f);
+    for (int half = 1; half < size; half <<= 1) {
+        for (int j = 0; j < half; ++j) {
+            const double angle = -M_PI * j / half;
+            plan->twiddles[(half + j) * 2] = static_cast<float>(std::cos(angle));
+            plan->twiddles[(half + j) * 2 + 1] = static_cast<float>(std::sin(angle));
+        }
+    }
+    return plan;
+}
+
+/*!
+ *  \brief Возвращает разделяемый план для размера, строя его при первом запросе.
+ *  \param[in] log2Size Двоичный логарифм размера.
+ *  \return План.
+ */
+std::shared_ptr<const FftPlan> planFor(int log2Size)
+{
+    // Планы живут, пока их используют: слабые ссылки не удерживают
+    // таблицы больших размеров после смены настроек.
+    static std::mutex mutex;
+    static std::array<std::weak_ptr<const FftPlan>, 32> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const FftPlan> plan = cache[log2Size].lock();
+    if (!plan) {
+        plan = buildPlan(log2Size);
+        cache[log2Size] = plan;
+    }
+    return plan;
+}
+
+/*!
+ *  \brief Выполняет бабочки j в [jFirst, jLast) одной группы этапа.
+ *  \param[in,out] data Данные (пары re, im).
+ *  \param[in] group Начало группы, комплексный индекс.
+ *  \param[in] half Половина размера бабочки этапа.
+ *  \param[in] twiddles Множители этапа (указатель на комплексный индекс half).
+ *  \param[in] jFirst Первая бабочка.
+ *  \param[in] jLast Бабочка за последней.
+ */
+inline void butterflies(float *data, std::int64_t group, int half, const float *twiddles,
+                        std::int64_t jFirst, std::int64_t jLast) noexcept
+{
+    float *a = data + group * 2;
+    float *b = a + static_cast<std::int64_t>(half) * 2;
+    std::int64_t j = jFirst;
+#ifdef SIRIUS_FFT_SSE2
+    // Две бабочки за шаг: (br + i bi)(wr + i wi) через перестановку и смену знака.
+    const __m128 signMask = _mm_castsi128_ps(_mm_set_epi32(0, int(0x80000000), 0, int(0x80000000)));
+    for (; j + 2 <= jLast; j += 2) {
+        const __m128 w = _mm_loadu_ps(twiddles + j * 2);
+        const __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+        const __m128 wi = _mm_xor_ps(_mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1)), signMask);
+        const __m128 vb = _mm_loadu_ps(b + j * 2);
+        const __m128 swapped = _mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m128 t = _mm_add_ps(_mm_mul_ps(vb, wr), _mm_mul_ps(swapped, wi));
+        const __m128 va = _mm_loadu_ps(a + j * 2);
+        _mm_storeu_ps(b + j * 2, _mm_sub_ps(va, t));
+        _mm_storeu_ps(a + j * 2, _mm_add_ps(va, t));
+    }
+#endif
+    for (; j < jLast; ++j) {
+        const float wr = twiddles[j * 2];
+        const float wi = twiddles[j * 2 + 1];
+        const float br = b[j * 2];
+        const float bi = b[j * 2 + 1];
+        const float tr = br * wr - bi * wi;
+        const float ti = br * wi + bi * wr;
+        const float ar = a[j * 2];
+        const float ai = a[j * 2 + 1];
+        b[j * 2] = ar - tr;
+        b[j * 2 + 1] = ai - ti;
+        a[j * 2] = ar + tr;
+        a[j * 2 + 1] = ai + ti;
+    }
+}
+
+/*!
+ *  \brief Выполняет все этапы с половиной бабочки меньше blockSize внутри одного блока.
+ *  \param[in,out] data Данные блока (пары re, im).
+ *  \param[in] blockSize Размер блока, комплексные значения.
+ *  \param[in] plan План БПФ.
+ */
+void transformBlock(float *data, int blockSize, const FftPlan &plan) noexcept
+{
+    // Первые два этапа объединены в бабочку по основанию 4: их множители
+    // равны 1 и -i, умножения не нужны.
+    for (int i = 0; i < blockSize * 2; i += 8) {
+        const float s0r = data[i] + data[i + 2];
+        const float s0i = data[i + 1] + data[i + 3];
+        const float d0r = data[i] - data[i + 2];
+        const float d0i = data[i + 1] - data[i + 3];
+        const float s1r = data[i + 4] + data[i + 6];
+        const float s1i = data[i + 5] + data[i + 7];
+        const float d1r = data[i + 4] - data[i + 6];
+        const float d1i = data[i + 5] - data[i + 7];
+        data[i] = s0r + s1r;
+        data[i + 1] = s0i + s1i;
+        data[i + 4] = s0r - s1r;
+        data[i + 5] = s0i - s1i;
+        // d1 * (-i) = (d1i, -d1r).
+        data[i + 2] = d0r + d1i;
+        data[i + 3] = d0i - d1r;
+        data[i + 6] = d0r - d1i;
+        data[i + 7] = d0i + d1r;
+    }
+    for (int half = 4; half < blockSize; half <<= 1) {
+        const float *twiddles = plan.twiddles.data() + static_cast<std::size_t>(half) * 2;
+        for (int group = 0; group < blockSize; group += half * 2) {
+            butterflies(data, group, half, twiddles, 0, half);
+        }
+    }
+}
+
+/*!
+ *  \brief Выполняет этапы БПФ над данными в двоично-инверсном порядке.
+ *
+ *  Ранние этапы выполняются поблочно (блок помещается в кэш), поздние —
+ *  по этапам с делением бабочек на диапазоны.
+ *
+ *  \param[in,out] data Данные (пары re, im).
+ *  \param[in] plan План БПФ.
+ */
+void runStages(float *data, const FftPlan &plan)
+{
+    const int size = plan.size;
+    const int blockSize = qMin(size, kBlockSize);
+    const bool parallel = size >= kParallelThreshold && QThreadPool::globalInstance()->maxThreadCount() > 1;
+
+    const std::int64_t blocks = size / blockSize;
+    const std::int64_t blocksPerTask = qMax<std::int64_t>(1, kTaskChunk / blockSize);
+    forEachChunk(blocks, blocksPerTask, parallel, [&](std::int64_t first, std::int64_t last) {
+        for (std::int64_t block = first; block < last; ++block) {
+            transformBlock(data + block * blockSize * 2, blockSize, plan);
+        }
+    });
+
+    const std::int64_t butterflyCount = size / 2;
+    for (int half = blockSize; half < size; half <<= 1) {
+        const float *twiddles = plan.twiddles.data() + static_cast<std::size_t>(half) * 2;
+        forEachChunk(butterflyCount, kTaskChunk, parallel, [&](std::int64_t first, std::int64_t last) {
+            // Бабочка с номером k принадлежит группе k / half со смещением k % half.
+            while (first < last) {
+                const std::int64_t group = first / half;
+                const std::int64_t j = first % half;
+                const std::int64_t jLast = qMin<std::int64_t>(half, j + (last - first));
+                butterflies(data, group * half * 2, half, twiddles, j, jLast);
+                first += jLast - j;
+            }
+        });
+    }
+}
+
+/*!
+ *  \brief Вычисляет коэффициенты окна (периодическая форма).
+ *  \param[in] window Оконная функция.
+ *  \param[in] size Размер окна.
+ *  \param[out] out Коэффициенты.
+ */
+void buildWindow(FFTProcessor::Window window, int size, std::vector<float> &out)
+{
+    // Коэффициенты косинусных сумм a0 - a1 cos + a2 cos2 - a3 cos3 + a4 cos4.
+    std::array<double, 5> a{1.0, 0.0, 0.0, 0.0, 0.0};
+    switch (window) {
+    case FFTProcessor::Window::Rectangular:
+        break;
+    case FFTProcessor::Window::Hann:
+        a = {0.5, 0.5, 0.0, 0.0, 0.0};
+        break;
+    case FFTProcessor::Window::Hamming:
+        a = {0.54, 0.46, 0.0, 0.0, 0.0};
+        break;
+    case FFTProcessor::Window::Blackman:
+        a = {0.42, 0.5, 0.08, 0.0, 0.0};
+        break;
+    case FFTProcessor::Window::BlackmanHarris:
+        a = {0.35875, 0.48829, 0.14128, 0.01168, 0.0};
+        break;
+    case FFTProcessor::Window::FlatTop:
+        a = {0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368};
+        break;
+    }
+
+    out.resize(size);
+    for (int n = 0; n < size; ++n) {
+        const double x = 2.0 * M_PI * n / size;
+        out[n] = static_cast<float>(a[0] - a[1] * std::cos(x) + a[2] * std::cos(2.0 * x)
+                                    - a[3] * std::cos(3.0 * x) + a[4] * std::cos(4.0 * x));
+    }
+}
+
+/*!
+ *  \brief Коэффициенты log2(m) = t * (c1 + c3 t^2 + c5 t^4 + c7 t^6), t = (m - 1) / (m + 1).
+ *
+ *  При m в [sqrt(0.5), sqrt(2)) |t| < 0.172, погрешность меньше 1e-7.
+ */
+constexpr float kLogC1 = 2.8853900817779268f;  // 2 / ln 2
+constexpr float kLogC3 = 0.9617966939259756f;  // 2 / (3 ln 2)
+constexpr float kLogC5 = 0.5770780163555854f;  // 2 / (5 ln 2)
+constexpr float kLogC7 = 0.4121985831111324f;  // 2 / (7 ln 2)
+//! \brief 10 * log10(2): перевод log2 в дБ.
+constexpr float kDbPerLog2 = 3.0102999566398120f;
+//! \brief sqrt(2).
+constexpr float kSqrt2 = 1.4142135623730951f;
+
+/*!
+ *  \brief Скалярный перевод мощности в дБ тем же методом, что и векторный.
+ */
+inline float powerToDbScalar(float power, float offsetDb) noexcept
+{
+    const float x = power > kPowerFloor ? power : kPowerFloor;
+    std::uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 127;
+    bits = (bits & 0x7fffffu) | 0x3f800000u;
+    float m;
+    std::memcpy(&m, &bits, sizeof(m));
+    if (m > kSqrt2) {
+        m *= 0.5f;
+        exponent += 1;
+    }
+    const float t = (m - 1.0f) / (m + 1.0f);
+    const float t2 = t * t;
+    const float log2m = t * (kLogC1 + t2 * (kLogC3 + t2 * (kLogC5 + t2 * kLogC7)));
+    return (static_cast<float>(exponent) + log2m) * kDbPerLog2 + offsetDb;
+}
+
+} // namespace
+
+//! \brief Конструирует обработчик с параметрами по умолчанию.
+FFTProcessor::FFTProcessor()
+{
+    configure(Settings());
+}
+
+/*!
+ *  \brief Конструирует обработчик.
+ *  \param[in] settings Параметры обработки.
+ */
+FFTProcessor::FFTProcessor(const Settings &settings)
+{
+    configure(settings);
+}
+
+//! \brief Разрушает обработчик.
+FFTProcessor::~FFTProcessor() = default;
+
+/*!
+ *  \brief Применяет новые параметры и сбрасывает накопленные данные.
+ *  \param[in] settings Параметры обработки.
+ */
+void FFTProcessor::configure(const Settings &settings)
+{
+    Settings normalized = settings;
+    int log2Size = 10;
+    while ((1 << log2Size) < normalized.fftSize && (1 << log2Size) < kMaxFftSize) {
+        ++log2Size;
+    }
+    normalized.fftSize = 1 << log2Size;
+    normalized.overlap = qBound(0.0, normalized.overlap, kMaxOverlap);
+    normalized.averageCount = qBound(1, normalized.averageCount, 1024);
+
+    const bool sizeChanged = !m_plan || m_plan->log2Size != log2Size;
+    const bool windowChanged = sizeChanged || normalized.window != m_settings.window;
+    m_settings = normalized;
+    m_hopSize = qMax(1, static_cast<int>(std::lround(m_settings.fftSize * (1.0 - m_settings.overlap))));
+
+    if (sizeChanged) {
+        m_plan = planFor(log2Size);
+        m_ring.assign(m_settings.fftSize, {});
+        m_work.assign(m_settings.fftSize, {});
+        m_power.assign(m_settings.fftSize, 0.0f);
+    }
+    if (windowChanged) {
+        buildWindow(m_settings.window, m_settings.fftSize, m_window);
+        double sum = 0.0;
+        for (float w : m_window) {
+            sum += w;
+        }
+        // Тон амплитуды A дает 20 * log10(A) дБ независимо от размера и окна.
+        m_normDb = static_cast<float>(-20.0 * std::log10(sum));
+    }
+    reset();
+}
+
+//! \brief Сбрасывает накопленные отсчеты и усреднение.
+void FFTProcessor::reset()
+{
+    m_writePos = 0;
+    m_filled = 0;
+    m_sinceSegment = 0;
+    m_pendingSegments = 0;
+    m_hasAverage = false;
+}
+
+/*!
+ *  \brief Возвращает число отсчетов, которых не хватает до следующего сегмента.
+ *  \return Количество отсчетов.
+ */
+int FFTProcessor::samplesUntilNextSegment() const noexcept
+{
+    if (m_filled < m_settings.fftSize) {
+        return m_settings.fftSize - m_filled;
+    }
+    return qMax(1, m_hopSize - m_sinceSegment);
+}
+
+/*!
+ *  \brief Добавляет отсчеты I/Q и вычисляет сегменты.
+ *  \param[in] samples Комплексные отсчеты.
+ *  \param[in] count Количество отсчетов.
+ *  \return Количество вычисленных сегментов.
+ */
+int FFTProcessor::process(const std::complex<float> *samples, int count)
+{
+    const int size = m_settings.fftSize;
+    int segments = 0;
+    while (count > 0) {
+        const int step = qMin(count, samplesUntilNextSegment());
+
+        // Копирование в кольцо не более чем двумя непрерывными частями.
+        const int head = qMin(step, size - m_writePos);
+        std::copy(samples, samples + head, m_ring.begin() + m_writePos);
+        std::copy(samples + head, samples + step, m_ring.begin());
+        m_writePos = (m_writePos + step) & (size - 1);
+        m_filled = qMin(size, m_filled + step);
+        m_sinceSegment += step;
+        samples += step;
+        count -= step;
+
+        if (m_filled == size && m_sinceSegment >= m_hopSize) {
+            computeSegment();
+            m_sinceSegment = 0;
+            ++segments;
+        }
+    }
+    return segments;
+}
+
+//! \brief Проверяет, накоплено ли достаточно сегментов для выхода.
+bool FFTProcessor::hasOutput() const noexcept
+{
+    if (m_settings.averaging == Averaging::Welch) {
+        return m_pendingSegments >= m_settings.averageCount;
+    }
+    return m_pendingSegments > 0;
+}
+
+//! \brief Вычисляет сегмент, начинающийся с самого старого отсчета кольцевого буфера.
+void FFTProcessor::computeSegment()
+{
+    const FftPlan &plan = *m_plan;
+    const int size = plan.size;
+    const int mask = size - 1;
+    const int start = m_writePos;
+    const bool parallel = size >= kParallelThreshold && QThreadPool::globalInstance()->maxThreadCount() > 1;
+
+    // Окно применяется вместе с двоично-инверсной перестановкой.
+    const std::uint32_t *reverse = plan.bitReverse.data();
+    const std::complex<float> *ring = m_ring.data();
+    const float *window = m_window.data();
+    std::complex<float> *work = m_work.data();
+    forEachChunk(size, kTaskChunk, parallel, [=](std::int64_t first, std::int64_t last) {
+        for (std::int64_t i = first; i < last; ++i) {
+            const std::uint32_t n = reverse[i];
+            const std::complex<float> v = ring[(start + n) & mask];
+            work[i] = {v.real() * window[n], v.imag() * window[n]};
+        }
+    });
+
+    float *data = reinterpret_cast<float *>(work);
+    runStages(data, plan);
+
+    const Averaging averaging = m_settings.averaging;
+    const bool first = !m_hasAverage || (averaging == Averaging::Welch && m_pendingSegments == 0);
+    const float alpha = 2.0f / (m_settings.averageCount + 1);
+    float *power = m_power.data();
+    forEachChunk(size, kTaskChunk, parallel, [=](std::int64_t firstBin, std::int64_t lastBin) {
+        for (std::int64_t i = firstBin; i < lastBin; ++i) {
+            const float re = data[i * 2];
+            const float im = data[i * 2 + 1];
+            const float p = re * re + im * im;
+            if (first || averaging == Averaging::None) {
+                power[i] = p;
+            } else if (averaging == Averaging::Welch) {
+                power[i] += p;
+            } else {
+                power[i] += alpha * (p - power[i]);
+            }
+        }
+    });
+
+    ++m_pendingSegments;
+    m_hasAverage = true;
+}
+
+/*!
+ *  \brief Выдает усредненный спектр в дБ с нулевой частотой в центре.
+ *  \param[out] out Буфер на fftSize() значений.
+ *  \return false, если нет вычисленных сегментов.
+ */
+bool FFTProcessor::takeSpectrumDb(float *out)
+{
+    if (!m_hasAverage || (m_settings.averaging == Averaging::Welch && m_pendingSegments == 0)) {
+        return false;
+    }
+
+    float offsetDb = m_normDb;
+    if (m_settings.averaging == Averaging::Welch) {
+        offsetDb -= static_cast<float>(10.0 * std::log10(m_pendingSegments));
+    }
+
+    const int size = m_settings.fftSize;
+    const int half = size / 2;
+    const bool parallel = size >= kParallelThreshold && QThreadPool::globalInstance()->maxThreadCount() > 1;
+    const float *power = m_power.data();
+    forEachChunk(size, kTaskChunk, parallel, [=](std::int64_t first, std::int64_t last) {
+        // Выход i берет мощность (i + half) mod size; диапазон делится на две непрерывные части.
+        const std::int64_t split = qBound(first, std::int64_t(half), last);
+        powerToDb(power + first + half, split - first, offsetDb, out + first);
+        powerToDb(power + split - half, last - split, offsetDb, out + split);
+    });
+
+    m_pendingSegments = 0;
+    return true;
+}
+
+/*!
+ *  \brief Прямое БПФ на месте.
+ *  \param[in,out] data Комплексные значения.
+ *  \param[in] size Размер (степень двойки).
+ */
+void FFTProcessor::transform(std::complex<float> *data, int size)
+{
+    int log2Size = 0;
+    while ((1 << log2Size) < size) {
+        ++log2Size;
+    }
+    if (!data || size < kMinFftSize || size > kMaxFftSize || (1 << log2Size) != size) {
+        return;
+    }
+
+    const std::shared_ptr<const FftPlan> plan = planFor(log2Size);
+    for (int i = 0; i < size; ++i) {
+        const int j = static_cast<int>(plan->bitReverse[i]);
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+    runStages(reinterpret_cast<float *>(data), *plan);
+}
+
+/*!
+ *  \brief Переводит мощность в дБ: 4 значения за шаг SSE2, остаток скалярно.
+ *  \param[in] power Мощности.
+ *  \param[in] count Количество значений.
+ *  \param[in] offsetDb Смещение, дБ.
+ *  \param[out] out Результат.
+ */
+void FFTProcessor::powerToDb(const float *power, std::int64_t count, float offsetDb, float *out) noexcept
+{
+    std::int64_t i = 0;
+#ifdef SIRIUS_FFT_SSE2
+    const __m128 floor = _mm_set1_ps(kPowerFloor);
+    const __m128i mantissaMask = _mm_set1_epi32(0x7fffff);
+    const __m128i one = _mm_set1_epi32(0x3f800000);
+    const __m128i bias = _mm_set1_epi32(127);
+    const __m128 onef = _mm_set1_ps(1.0f);
+    const __m128 halff = _mm_set1_ps(0.5f);
+    const __m128 sqrt2 = _mm_set1_ps(kSqrt2);
+    const __m128 c1 = _mm_set1_ps(kLogC1);
+    const __m128 c3 = _mm_set1_ps(kLogC3);
+    const __m128 c5 = _mm_set1_ps(kLogC5);
+    const __m128 c7 = _mm_set1_ps(kLogC7);
+    const __m128 scale = _mm_set1_ps(kDbPerLog2);
+    const __m128 offset = _mm_set1_ps(offsetDb);
+
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_max_ps(_mm_loadu_ps(power + i), floor);
+        const __m128i bits = _mm_castps_si128(x);
+        __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), bias));
+        __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mantissaMask), one));
+
+        // m > sqrt(2): m /= 2, показатель + 1.
+        const __m128 above = _mm_cmpgt_ps(m, sqrt2);
+        m = _mm_or_ps(_mm_and_ps(above, _mm_mul_ps(m, halff)), _mm_andnot_ps(above, m));
+        exponent = _mm_add_ps(exponent, _mm_and_ps(above, onef));
+
+        const __m128 t = _mm_div_ps(_mm_sub_ps(m, onef), _mm_add_ps(m, onef));
+        const __m128 t2 = _mm_mul_ps(t, t);
+        __m128 poly = _mm_add_ps(c5, _mm_mul_ps(t2, c7));
+        poly = _mm_add_ps(c3, _mm_mul_ps(t2, poly));
+        poly = _mm_add_ps(c1, _mm_mul_ps(t2, poly));
+        const __m128 log2x = _mm_add_ps(exponent, _mm_mul_ps(t, poly));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(log2x, scale), offset));
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] = powerToDbScalar(power[i], offsetDb);
+    }
+}
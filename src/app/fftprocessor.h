@@ -0,0 +1,171 @@
+/*!
+ *  \file fftprocessor.h
+ *  \brief Вычисление спектра мощности из комплексных отсчетов I/Q.
+ */
+#ifndef FFTPROCESSOR_H
+#define FFTPROCESSOR_H
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct FftPlan;
+
+/*!
+ *  \class FFTProcessor
+ *  \brief Оконное БПФ с перекрытием и усреднением спектров мощности.
+ *
+ *  Отсчеты I/Q накапливаются в кольцевом буфере размером с БПФ; каждые
+ *  hopSize() отсчетов вычисляется очередной сегмент. Спектры мощности
+ *  усредняются по Уэлчу (среднее сегментов одного выхода) или
+ *  экспоненциально (между выходами). Планы БПФ (таблица перестановки и
+ *  поворачивающие множители) строятся один раз на размер и разделяются
+ *  всеми экземплярами. Большие БПФ выполняются на всех ядрах.
+ *
+ *  Класс не потокобезопасен: все вызовы выполняются в одном потоке DSP.
+ */
+class FFTProcessor
+{
+public:
+    //! \brief Оконная функция.
+    enum class Window : int {
+        Rectangular = 0,
+        Hann = 1,
+        Hamming = 2,
+        Blackman = 3,
+        BlackmanHarris = 4,
+        FlatTop = 5
+    };
+
+    //! \brief Режим усреднения спектров мощности.
+    enum class Averaging : int {
+        None = 0,
+        Welch = 1,
+        Exponential = 2
+    };
+
+    //! \brief Параметры обработки.
+    struct Settings
+    {
+        //! \brief Размер БПФ (округляется до степени двойки в диапазоне kMinFftSize..kMaxFftSize).
+        int fftSize = 65536;
+        //! \brief Оконная функция.
+        Window window = Window::BlackmanHarris;
+        //! \brief Доля перекрытия соседних сегментов, 0..kMaxOverlap.
+        double overlap = 0.5;
+        //! \brief Режим усреднения.
+        Averaging averaging = Averaging::Exponential;
+        //! \brief Число сегментов на выход (Уэлч) или эквивалентная длина экспоненциального среднего.
+        int averageCount = 4;
+    };
+
+    //! \brief Минимальный размер БПФ.
+    static constexpr int kMinFftSize = 1 << 10;
+    //! \brief Максимальный размер БПФ.
+    static constexpr int kMaxFftSize = 1 << 20;
+    //! \brief Максимальная доля перекрытия.
+    static constexpr double kMaxOverlap = 0.95;
+
+    //! \brief Конструирует обработчик с параметрами по умолчанию.
+    FFTProcessor();
+    /*!
+     *  \brief Конструирует обработчик.
+     *  \param[in] settings Параметры обработки.
+     */
+    explicit FFTProcessor(const Settings &settings);
+    //! \brief Разрушает обработчик.
+    ~FFTProcessor();
+
+    /*!
+     *  \brief Применяет новые параметры и сбрасывает накопленные данные.
+     *  \param[in] settings Параметры обработки (нормализуются).
+     */
+    void configure(const Settings &settings);
+    //! \brief Возвращает нормализованные параметры обработки.
+    const Settings &settings() const noexcept { return m_settings; }
+    //! \brief Возвращает размер БПФ.
+    int fftSize() const noexcept { return m_settings.fftSize; }
+    //! \brief Возвращает шаг между началами соседних сегментов, отсчеты.
+    int hopSize() const noexcept { return m_hopSize; }
+
+    //! \brief Сбрасывает накопленные отсчеты и усреднение.
+    void reset();
+
+    /*!
+     *  \brief Возвращает число отсчетов, которых не хватает до следующего сегмента.
+     *  \return Количество отсчетов (не меньше 1).
+     */
+    int samplesUntilNextSegment() const noexcept;
+
+    /*!
+     *  \brief Добавляет отсчеты I/Q и вычисляет все сегменты, ставшие полными.
+     *  \param[in] samples Комплексные отсчеты.
+     *  \param[in] count Количество отсчетов.
+     *  \return Количество вычисленных сегментов.
+     */
+    int process(const std::complex<float> *samples, int count);
+
+    //! \brief Проверяет, накоплено ли достаточно сегментов для выхода.
+    bool hasOutput() const noexcept;
+
+    /*!
+     *  \brief Выдает усредненный спектр в дБ относительно полной шкалы.
+     *
+     *  Нулевая частота находится в центре: значение i соответствует частоте
+     *  (i - fftSize / 2) * sampleRate / fftSize. Накопление Уэлча сбрасывается.
+     *
+     *  \param[out] out Буфер на fftSize() значений.
+     *  \return false, если еще не вычислено ни одного сегмента.
+     */
+    bool takeSpectrumDb(float *out);
+
+    /*!
+     *  \brief Прямое БПФ на месте.
+     *  \param[in,out] data Комплексные значения.
+     *  \param[in] size Размер (степень двойки, kMinFftSize..kMaxFftSize).
+     */
+    static void transform(std::complex<float> *data, int size);
+
+    /*!
+     *  \brief Векторизованно переводит мощность в дБ: out = 10 * log10(power) + offsetDb.
+     *  \param[in] power Мощности (значения меньше 1e-20 ограничиваются снизу).
+     *  \param[in] count Количество значений.
+     *  \param[in] offsetDb Смещение, дБ.
+     *  \param[out] out Результат (может совпадать с power).
+     */
+    static void powerToDb(const float *power, std::int64_t count, float offsetDb, float *out) noexcept;
+
+private:
+    //! \brief Вычисляет сегмент, начинающийся с самого старого отсчета кольцевого буфера.
+    void computeSegment();
+
+    //! \brief Нормализованные параметры.
+    Settings m_settings;
+    //! \brief Шаг между сегментами, отсчеты.
+    int m_hopSize = 0;
+    //! \brief План БПФ текущего размера.
+    std::shared_ptr<const FftPlan> m_plan;
+    //! \brief Коэффициенты окна.
+    std::vector<float> m_window;
+    //! \brief Поправка нормировки: -20 * log10(сумма коэффициентов окна), дБ.
+    float m_normDb = 0.0f;
+    //! \brief Кольцевой буфер последних fftSize отсчетов.
+    std::vector<std::complex<float>> m_ring;
+    //! \brief Позиция записи в кольцевом буфере.
+    int m_writePos = 0;
+    //! \brief Количество записанных отсчетов (не больше fftSize).
+    int m_filled = 0;
+    //! \brief Отсчеты, поступившие после последнего сегмента.
+    int m_sinceSegment = 0;
+    //! \brief Рабочий буфер БПФ.
+    std::vector<std::complex<float>> m_work;
+    //! \brief Накопленная (усредненная) мощность.
+    std::vector<float> m_power;
+    //! \brief Сегменты, накопленные с последнего выхода.
+    int m_pendingSegments = 0;
+    //! \brief Признак инициализированного экспоненциального среднего.
+    bool m_hasAverage = false;
+};
+
+#endif // FFTPROCESSOR_H
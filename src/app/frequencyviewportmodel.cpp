@@ -61,6 +61,7 @@ void FrequencyViewportModel::applyViewport(double minHz, double maxHz, const QSt
         || !qFuzzyCompare(maxHz + 1.0, m_viewMaxHz + 1.0)) {
         m_viewMinHz = minHz;
         m_viewMaxHz = maxHz;
+        ++m_generation;
         emit viewportChanged(m_viewMinHz, m_viewMaxHz, sourceTag);
     }
 }
@@ -11,6 +11,9 @@
 /*!
  *  \class FrequencyViewportModel
  *  \brief Управляет видимым диапазоном частот и ограничивает его глобальными границами.
+ *
+ *  Каждое изменение диапазона получает новое поколение: по нему
+ *  SpectrumControllerStub отличает результаты устаревших запросов обзора.
  */
 class FrequencyViewportModel : public QObject
 {
@@ -19,6 +22,7 @@ class FrequencyViewportModel : public QObject
     Q_PROPERTY(double viewMaxHz READ viewMaxHz WRITE setViewMaxHz NOTIFY viewportChanged FINAL)
     Q_PROPERTY(double globalMinHz READ globalMinHz CONSTANT)
     Q_PROPERTY(double globalMaxHz READ globalMaxHz CONSTANT)
+    Q_PROPERTY(quint64 generation READ generation NOTIFY viewportChanged FINAL)
 
 public:
     //! \brief Конструирует модель с границами по умолчанию.
@@ -36,6 +40,9 @@ public:
     //! \brief Возвращает глобальную максимальную границу в Гц.
     //! \return Глобальная максимальная частота.
     double globalMaxHz() const noexcept { return m_globalMaxHz; }
+    //! \brief Возвращает поколение диапазона (растет при каждом изменении).
+    //! \return Поколение текущего диапазона.
+    quint64 generation() const noexcept { return m_generation; }
 
     /*!
      *  \brief Устанавливает обе границы, нормализует порядок и применяет ограничения.
@@ -83,6 +90,8 @@ private:
     const double m_globalMinHz = 300e6;
     //! \brief Глобальная верхняя граница.
     const double m_globalMaxHz = 18e9;
+    //! \brief Поколение текущего диапазона.
+    quint64 m_generation = 0;
 };
 
 #endif // FREQUENCYVIEWPORTMODEL_H
@@ -0,0 +1,441 @@
+/*!
+ *  \file indicatordialitem.cpp
+ *  \brief Реализация IndicatorDialItem.
+ */
+#include "indicatordialitem.h"
+
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <QSGVertexColorMaterial>
+#include <QtMath>
+
+#include <cmath>
+
+namespace {
+
+//! \brief Отступ рисок от края шкалы относительно радиуса.
+constexpr float kTickPadRatio = 0.03f;
+//! \brief Число сегментов окружности маркера.
+constexpr int kMarkerSegments = 12;
+//! \brief Радиус маркера самой свежей трассы, пикселей.
+constexpr float kFreshestRadius = 4.0f;
+//! \brief Радиус маркера, пикселей.
+constexpr float kMarkerRadius = 3.0f;
+//! \brief Внешний радиус ореола самой свежей трассы, пикселей.
+constexpr float kHaloOuterRadius = 7.0f;
+//! \brief Внутренний радиус ореола, пикселей.
+constexpr float kHaloInnerRadius = 5.0f;
+//! \brief Прозрачность ореола.
+constexpr float kHaloOpacity = 0.22f;
+//! \brief Наименьшая прозрачность маркера угасающей трассы.
+constexpr double kMinMarkerOpacity = 0.10;
+//! \brief Положение пояса целей между внутренним и внешним кольцом.
+constexpr float kTargetBeltRatio = 0.55f;
+//! \brief Отображаемый азимут считается совпавшим с входным, градусы.
+constexpr double kAzimuthEpsilonDeg = 0.01;
+//! \brief Наименьшая доля сближения: луч всегда догоняет антенну.
+constexpr double kMinSmoothing = 0.01;
+//! \brief Длительность кадра, к которой отнесено сглаживание, мс.
+constexpr double kSmoothingFrameMs = 1000.0 / 60.0;
+
+//! \brief Ряд рисок шкалы.
+struct TickRow
+{
+    //! \brief Шаг, градусы.
+    int stepDeg;
+    //! \brief Шаг старшего ряда, риски которого не повторяются (0 — нет).
+    int skipDeg;
+    //! \brief Длина относительно радиуса.
+    float lengthRatio;
+    //! \brief Ширина, пикселей.
+    float width;
+    //! \brief Прозрачность.
+    float opacity;
+};
+
+//! \brief Ряды рисок: через 30°, 15° и 5°.
+constexpr TickRow kTickRows[] = {
+    {30, 0, 0.085f, 2.0f, 0.95f},
+    {15, 30, 0.055f, 2.0f, 0.70f},
+    {5, 15, 0.032f, 1.0f, 0.55f},
+};
+
+//! \brief Приводит угол к диапазону [0, 360).
+double wrap360(double deg) noexcept
+{
+    const double wrapped = std::fmod(deg, 360.0);
+    return wrapped < 0.0 ? wrapped + 360.0 : wrapped;
+}
+
+//! \brief Возвращает число вершин всех рисок.
+int tickVertexCount() noexcept
+{
+    int count = 0;
+    for (const TickRow &row : kTickRows) {
+        for (int deg = 0; deg < 360; deg += row.stepDeg) {
+            count += (row.skipDeg > 0 && deg % row.skipDeg == 0) ? 0 : 6;
+        }
+    }
+    return count;
+}
+
+/*!
+ *  \brief Создает узел треугольников с цветом в вершинах.
+ *  \return Новый узел, владеющий геометрией и материалом.
+ */
+QSGGeometryNode *createColoredNode()
+{
+    auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+
+    auto *node = new QSGGeometryNode;
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setMaterial(new QSGVertexColorMaterial);
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+//! \brief Цвет вершины с заранее умноженной прозрачностью, как требует QSGVertexColorMaterial.
+struct VertexColor
+{
+    uchar r;
+    uchar g;
+    uchar b;
+    uchar a;
+};
+
+/*!
+ *  \brief Возвращает цвет вершины.
+ *  \param[in] color Цвет.
+ *  \param[in] opacity Дополнительная прозрачность 0..1.
+ */
+VertexColor vertexColor(const QColor &color, float opacity) noexcept
+{
+    const float a = qBound(0.0f, static_cast<float>(color.alphaF()) * opacity, 1.0f);
+    const auto channel = [a](float value) { return static_cast<uchar>(qRound(value * a * 255.0f)); };
+    return {channel(color.redF()), channel(color.greenF()), channel(color.blueF()), channel(1.0f)};
+}
+
+/*!
+ *  \brief Записывает треугольник.
+ *  \param[in,out] v Указатель на вершины; сдвигается на 3.
+ */
+void putTriangle(QSGGeometry::ColoredPoint2D *&v, const QPointF &a, const QPointF &b, const QPointF &c,
+                 VertexColor color) noexcept
+{
+    for (const QPointF &p : {a, b, c}) {
+        (v++)->set(static_cast<float>(p.x()), static_cast<float>(p.y()), color.r, color.g, color.b, color.a);
+    }
+}
+
+/*!
+ *  \brief Записывает четырехугольник двумя треугольниками (6 вершин).
+ *  \param[in,out] v Указатель на вершины; сдвигается на 6.
+ */
+void putQuad(QSGGeometry::ColoredPoint2D *&v, const QPointF &a, const QPointF &b, const QPointF &c, const QPointF &d,
+             VertexColor color) noexcept
+{
+    putTriangle(v, a, b, c, color);
+    putTriangle(v, a, c, d, color);
+}
+
+//! \brief Возвращает точку окружности в компасной системе (0° вверх, по часовой стрелке).
+QPointF polar(const QPointF &center, double radius, double deg) noexcept
+{
+    const double rad = qDegreesToRadians(deg);
+    return {center.x() + radius * std::sin(rad), center.y() - radius * std::cos(rad)};
+}
+
+} // namespace
+
+//! \brief Конструирует элемент отрисовки.
+IndicatorDialItem::IndicatorDialItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+/*!
+ *  \brief Задает входной азимут; первое значение отображается сразу.
+ *  \param[in] azimuthDeg Азимут, градусы (приводится к 0..360).
+ */
+void IndicatorDialItem::setAzimuthDeg(double azimuthDeg)
+{
+    const double value = wrap360(azimuthDeg);
+    if (m_hasAzimuth && value == m_azimuthDeg)
+        return;
+    m_azimuthDeg = value;
+    emit azimuthDegChanged();
+
+    if (!m_hasAzimuth || m_smoothing >= 1.0) {
+        m_hasAzimuth = true;
+        m_smoothingClock.invalidate();
+        if (m_renderAzimuthDeg != value) {
+            m_renderAzimuthDeg = value;
+            emit renderAzimuthDegChanged();
+        }
+        return;
+    }
+    if (!m_smoothingClock.isValid()) {
+        m_smoothingClock.start();
+        if (window()) {
+            window()->update();
+        }
+    }
+}
+
+//! \brief Задает долю сближения за 1/60 с (kMinSmoothing..1, 1 — без сглаживания).
+void IndicatorDialItem::setSmoothing(double smoothing)
+{
+    const double value = qBound(kMinSmoothing, smoothing, 1.0);
+    if (qFuzzyCompare(m_smoothing, value))
+        return;
+    m_smoothing = value;
+    emit smoothingChanged();
+}
+
+//! \brief Задает радиус внутреннего кольца относительно внешнего.
+void IndicatorDialItem::setInnerRadiusRatio(double innerRadiusRatio)
+{
+    const double value = qBound(0.0, innerRadiusRatio, 1.0);
+    if (qFuzzyCompare(m_innerRadiusRatio, value))
+        return;
+    m_innerRadiusRatio = value;
+    m_markersDirty = true;
+    update();
+    emit innerRadiusRatioChanged();
+}
+
+/*!
+ *  \brief Задает модель трасс целей.
+ *
+ *  Модель сообщает о каждом принятом снимке сигналом nowMsChanged(), а об
+ *  очистке — сбросом; строки снимка к этому моменту уже обновлены, поэтому
+ *  маркеры перечитываются один раз на снимок, а не на каждую строку.
+ *
+ *  \param[in] tracker Модель или nullptr.
+ */
+void IndicatorDialItem::setTracker(TargetTrackerModel *tracker)
+{
+    if (m_tracker == tracker)
+        return;
+    for (const QMetaObject::Connection &connection : m_trackerConnections) {
+        disconnect(connection);
+    }
+    m_trackerConnections.clear();
+    m_tracker = tracker;
+    if (tracker) {
+        m_trackerConnections.push_back(
+            connect(tracker, &TargetTrackerModel::nowMsChanged, this, &IndicatorDialItem::syncMarkers));
+        m_trackerConnections.push_back(
+            connect(tracker, &TargetTrackerModel::countChanged, this, &IndicatorDialItem::syncMarkers));
+        m_trackerConnections.push_back(
+            connect(tracker, &QAbstractItemModel::modelReset, this, &IndicatorDialItem::syncMarkers));
+        m_trackerConnections.push_back(connect(tracker, &QObject::destroyed, this, [this] {
+            // Модель уже разрушается: маркеры убираются без обращения к ней.
+            m_tracker = nullptr;
+            m_trackerConnections.clear();
+            syncMarkers();
+            emit trackerChanged();
+        }));
+    }
+    syncMarkers();
+    emit trackerChanged();
+}
+
+//! \brief Задает цвет рисок.
+void IndicatorDialItem::setTickColor(const QColor &tickColor)
+{
+    if (m_tickColor == tickColor)
+        return;
+    m_tickColor = tickColor;
+    m_ticksDirty = true;
+    update();
+    emit tickColorChanged();
+}
+
+//! \brief Задает цвет маркеров целей.
+void IndicatorDialItem::setTargetColor(const QColor &targetColor)
+{
+    if (m_targetColor == targetColor)
+        return;
+    m_targetColor = targetColor;
+    m_markersDirty = true;
+    update();
+    emit targetColorChanged();
+}
+
+//! \brief Перечитывает трассы модели и планирует перерисовку, если маркеры изменились.
+void IndicatorDialItem::syncMarkers()
+{
+    m_pendingMarkers.clear();
+    if (m_tracker) {
+        const quint64 freshestId = m_tracker->freshestId();
+        for (const BearingTracker::Track &track : m_tracker->tracks()) {
+            Marker marker;
+            marker.azimuthDeg = track.azimuthDeg;
+            marker.alphaLevel = qRound(qMax(kMinMarkerOpacity, m_tracker->alpha(track.lastSeenMs)) * kAlphaLevels);
+            marker.freshest = track.id == freshestId;
+            m_pendingMarkers.push_back(marker);
+        }
+    }
+    if (m_pendingMarkers == m_markers)
+        return;
+    m_markers.swap(m_pendingMarkers);
+    m_markersDirty = true;
+    update();
+}
+
+/*!
+ *  \brief Сдвигает отображаемый азимут к входному (поток UI, перед кадром).
+ *
+ *  Доля сближения за кадр пересчитывается по фактическому времени кадра,
+ *  поэтому скорость подтягивания луча не зависит от частоты обновления
+ *  экрана. Пока азимуты не совпали, запрашивается следующий кадр.
+ */
+void IndicatorDialItem::advanceAzimuth()
+{
+    if (!m_smoothingClock.isValid())
+        return;
+
+    const double elapsedMs = static_cast<double>(m_smoothingClock.restart());
+    double delta = m_azimuthDeg - m_renderAzimuthDeg;
+    if (delta > 180.0) {
+        delta -= 360.0;
+    } else if (delta < -180.0) {
+        delta += 360.0;
+    }
+    const double k = 1.0 - std::pow(1.0 - m_smoothing, elapsedMs / kSmoothingFrameMs);
+    if (qAbs(delta * (1.0 - k)) < kAzimuthEpsilonDeg) {
+        m_renderAzimuthDeg = m_azimuthDeg;
+        m_smoothingClock.invalidate();
+    } else {
+        m_renderAzimuthDeg = wrap360(m_renderAzimuthDeg + delta * k);
+        window()->update();
+    }
+    emit renderAzimuthDegChanged();
+}
+
+//! \brief Отслеживает изменение размеров для перестройки геометрии.
+void IndicatorDialItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() == oldGeometry.size())
+        return;
+
+    m_ticksDirty = true;
+    m_markersDirty = true;
+    update();
+}
+
+/*!
+ *  \brief Подключает сглаживание азимута к окну, в котором оказался элемент.
+ *  \param[in] change Вид изменения.
+ *  \param[in] value Данные изменения.
+ */
+void IndicatorDialItem::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    QQuickItem::itemChange(change, value);
+    if (change != ItemSceneChange)
+        return;
+
+    disconnect(m_afterAnimatingConnection);
+    if (value.window) {
+        // afterAnimating приходит в потоке UI перед синхронизацией каждого кадра.
+        m_afterAnimatingConnection = connect(value.window, &QQuickWindow::afterAnimating,
+                                             this, &IndicatorDialItem::advanceAzimuth);
+        if (m_smoothingClock.isValid()) {
+            value.window->update();
+        }
+    }
+}
+
+//! \brief Обновляет узлы рисок и маркеров в потоке отрисовки.
+QSGNode *IndicatorDialItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QSGNode *root = oldNode;
+    if (!root) {
+        root = new QSGNode;
+        root->appendChildNode(createColoredNode());
+        root->appendChildNode(createColoredNode());
+        m_ticksDirty = true;
+        m_markersDirty = true;
+    }
+
+    auto *tickNode = static_cast<QSGGeometryNode *>(root->childAtIndex(0));
+    auto *markerNode = static_cast<QSGGeometryNode *>(root->childAtIndex(1));
+    const QPointF center(width() / 2.0, height() / 2.0);
+    const double outerRadius = qMin(width(), height()) / 2.0;
+
+    if (m_ticksDirty) {
+        QSGGeometry *geometry = tickNode->geometry();
+        geometry->allocate(outerRadius > 0.0 ? tickVertexCount() : 0);
+        QSGGeometry::ColoredPoint2D *v = geometry->vertexDataAsColoredPoint2D();
+        const double tickOuter = outerRadius * (1.0 - kTickPadRatio);
+        for (const TickRow &row : kTickRows) {
+            if (outerRadius <= 0.0) {
+                break;
+            }
+            const VertexColor color = vertexColor(m_tickColor, row.opacity);
+            const double tickInner = tickOuter - outerRadius * row.lengthRatio;
+            for (int deg = 0; deg < 360; deg += row.stepDeg) {
+                if (row.skipDeg > 0 && deg % row.skipDeg == 0) {
+                    continue;
+                }
+                // Половина ширины риски поперек радиуса.
+                const double rad = qDegreesToRadians(static_cast<double>(deg));
+                const QPointF side(std::cos(rad) * row.width / 2.0, std::sin(rad) * row.width / 2.0);
+                const QPointF inner = polar(center, tickInner, deg);
+                const QPointF outer = polar(center, tickOuter, deg);
+                putQuad(v, inner - side, outer - side, outer + side, inner + side, color);
+            }
+        }
+        tickNode->markDirty(QSGNode::DirtyGeometry);
+        m_ticksDirty = false;
+    }
+
+    if (m_markersDirty) {
+        bool hasFreshest = false;
+        for (const Marker &marker : m_markers) {
+            hasFreshest = hasFreshest || marker.freshest;
+        }
+        const int markerVertices = kMarkerSegments * 3;
+        const int haloVertices = kMarkerSegments * 6;
+        QSGGeometry *geometry = markerNode->geometry();
+        geometry->allocate(outerRadius > 0.0
+                               ? static_cast<int>(m_markers.size()) * markerVertices + (hasFreshest ? haloVertices : 0)
+                               : 0);
+        QSGGeometry::ColoredPoint2D *v = geometry->vertexDataAsColoredPoint2D();
+
+        const double innerRadius = outerRadius * m_innerRadiusRatio;
+        const double beltRadius = innerRadius + (outerRadius - innerRadius) * kTargetBeltRatio;
+        const double segmentDeg = 360.0 / kMarkerSegments;
+        for (const Marker &marker : m_markers) {
+            if (outerRadius <= 0.0) {
+                break;
+            }
+            const QPointF position = polar(center, beltRadius, marker.azimuthDeg);
+            if (marker.freshest) {
+                const VertexColor halo = vertexColor(m_targetColor, kHaloOpacity);
+                for (int s = 0; s < kMarkerSegments; ++s) {
+                    putQuad(v, polar(position, kHaloInnerRadius, s * segmentDeg),
+                            polar(position, kHaloOuterRadius, s * segmentDeg),
+                            polar(position, kHaloOuterRadius, (s + 1) * segmentDeg),
+                            polar(position, kHaloInnerRadius, (s + 1) * segmentDeg), halo);
+                }
+            }
+            const VertexColor color =
+                vertexColor(m_targetColor, static_cast<float>(marker.alphaLevel) / kAlphaLevels);
+            const float radius = marker.freshest ? kFreshestRadius : kMarkerRadius;
+            for (int s = 0; s < kMarkerSegments; ++s) {
+                putTriangle(v, position, polar(position, radius, s * segmentDeg),
+                            polar(position, radius, (s + 1) * segmentDeg), color);
+            }
+        }
+        markerNode->markDirty(QSGNode::DirtyGeometry);
+        m_markersDirty = false;
+    }
+
+    return root;
+}
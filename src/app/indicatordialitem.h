@@ -0,0 +1,170 @@
+/*!
+ *  \file indicatordialitem.h
+ *  \brief Шкала индикатора антенны и маркеры целей средствами scene graph.
+ */
+#ifndef INDICATORDIALITEM_H
+#define INDICATORDIALITEM_H
+
+#include <QColor>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QQuickItem>
+
+#include <vector>
+
+#include "targettrackermodel.h"
+
+/*!
+ *  \class IndicatorDialItem
+ *  \brief Рисует риски шкалы и маркеры целей двумя узлами QSGGeometryNode.
+ *
+ *  Шкала занимает квадрат по меньшей стороне элемента (0° вверху, отсчет
+ *  по часовой стрелке). Все риски лежат в одной геометрии, которая
+ *  перестраивается только при изменении размеров или цвета. Все маркеры
+ *  целей (и ореол самой свежей) лежат во второй геометрии с цветом в
+ *  вершинах: прозрачность маркера берется из угасания трассы
+ *  TargetTrackerModel::alpha() и квантуется до kAlphaLevels уровней, так что
+ *  геометрия обновляется, только когда меняется набор трасс, их азимуты
+ *  или видимая прозрачность.
+ *
+ *  Отображаемый азимут луча (renderAzimuthDeg) подтягивается к входному
+ *  azimuthDeg по времени кадров окна, а не по таймеру: пока антенна
+ *  неподвижна, элемент не вызывает ни перерисовки, ни пересчета привязок.
+ */
+class IndicatorDialItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(double azimuthDeg READ azimuthDeg WRITE setAzimuthDeg NOTIFY azimuthDegChanged FINAL)
+    Q_PROPERTY(double renderAzimuthDeg READ renderAzimuthDeg NOTIFY renderAzimuthDegChanged FINAL)
+    Q_PROPERTY(double smoothing READ smoothing WRITE setSmoothing NOTIFY smoothingChanged FINAL)
+    Q_PROPERTY(double innerRadiusRatio READ innerRadiusRatio WRITE setInnerRadiusRatio
+                   NOTIFY innerRadiusRatioChanged FINAL)
+    Q_PROPERTY(TargetTrackerModel *tracker READ tracker WRITE setTracker NOTIFY trackerChanged FINAL)
+    Q_PROPERTY(QColor tickColor READ tickColor WRITE setTickColor NOTIFY tickColorChanged FINAL)
+    Q_PROPERTY(QColor targetColor READ targetColor WRITE setTargetColor NOTIFY targetColorChanged FINAL)
+
+public:
+    //! \brief Число уровней прозрачности маркера.
+    static constexpr int kAlphaLevels = 64;
+
+    //! \brief Конструирует элемент отрисовки.
+    explicit IndicatorDialItem(QQuickItem *parent = nullptr);
+
+    //! \brief Возвращает входной азимут антенны, градусы 0..360.
+    double azimuthDeg() const noexcept { return m_azimuthDeg; }
+    //! \brief Возвращает отображаемый азимут луча, градусы 0..360.
+    double renderAzimuthDeg() const noexcept { return m_renderAzimuthDeg; }
+    //! \brief Возвращает долю сближения отображаемого азимута с входным за 1/60 с.
+    double smoothing() const noexcept { return m_smoothing; }
+    //! \brief Возвращает радиус внутреннего кольца относительно внешнего.
+    double innerRadiusRatio() const noexcept { return m_innerRadiusRatio; }
+    //! \brief Возвращает модель трасс целей.
+    TargetTrackerModel *tracker() const noexcept { return m_tracker; }
+    //! \brief Возвращает цвет рисок.
+    QColor tickColor() const { return m_tickColor; }
+    //! \brief Возвращает цвет маркеров целей.
+    QColor targetColor() const { return m_targetColor; }
+
+public slots:
+    /*!
+     *  \brief Задает входной азимут; первое значение отображается сразу.
+     *  \param[in] azimuthDeg Азимут, градусы (приводится к 0..360).
+     */
+    void setAzimuthDeg(double azimuthDeg);
+    //! \brief Задает долю сближения за 1/60 с (0.01..1, 1 — без сглаживания).
+    void setSmoothing(double smoothing);
+    //! \brief Задает радиус внутреннего кольца относительно внешнего.
+    void setInnerRadiusRatio(double innerRadiusRatio);
+    /*!
+     *  \brief Задает модель трасс целей.
+     *  \param[in] tracker Модель или nullptr.
+     */
+    void setTracker(TargetTrackerModel *tracker);
+    //! \brief Задает цвет рисок.
+    void setTickColor(const QColor &tickColor);
+    //! \brief Задает цвет маркеров целей.
+    void setTargetColor(const QColor &targetColor);
+
+signals:
+    //! \brief Сигнал об изменении входного азимута.
+    void azimuthDegChanged();
+    //! \brief Сигнал об изменении отображаемого азимута.
+    void renderAzimuthDegChanged();
+    //! \brief Сигнал об изменении сглаживания.
+    void smoothingChanged();
+    //! \brief Сигнал об изменении радиуса внутреннего кольца.
+    void innerRadiusRatioChanged();
+    //! \brief Сигнал о смене модели трасс.
+    void trackerChanged();
+    //! \brief Сигнал об изменении цвета рисок.
+    void tickColorChanged();
+    //! \brief Сигнал об изменении цвета маркеров.
+    void targetColorChanged();
+
+protected:
+    //! \brief Обновляет узлы рисок и маркеров в потоке отрисовки.
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    //! \brief Отслеживает изменение размеров для перестройки геометрии.
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    //! \brief Подключает сглаживание азимута к кадрам окна элемента.
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+
+private:
+    //! \brief Маркер цели в том виде, в каком он нарисован.
+    struct Marker
+    {
+        //! \brief Азимут, градусы.
+        double azimuthDeg = 0.0;
+        //! \brief Уровень прозрачности 0..kAlphaLevels.
+        int alphaLevel = 0;
+        //! \brief Признак самой свежей трассы.
+        bool freshest = false;
+
+        //! \brief Сравнивает маркеры.
+        bool operator==(const Marker &other) const noexcept
+        {
+            return azimuthDeg == other.azimuthDeg && alphaLevel == other.alphaLevel && freshest == other.freshest;
+        }
+    };
+
+    //! \brief Перечитывает трассы модели и планирует перерисовку, если маркеры изменились.
+    void syncMarkers();
+    //! \brief Сдвигает отображаемый азимут к входному (поток UI, перед кадром).
+    void advanceAzimuth();
+
+    //! \brief Входной азимут, градусы.
+    double m_azimuthDeg = 0.0;
+    //! \brief Отображаемый азимут, градусы.
+    double m_renderAzimuthDeg = 0.0;
+    //! \brief Доля сближения за 1/60 с.
+    double m_smoothing = 0.1;
+    //! \brief Радиус внутреннего кольца относительно внешнего.
+    double m_innerRadiusRatio = 0.3;
+    //! \brief Входной азимут уже задавался.
+    bool m_hasAzimuth = false;
+    //! \brief Время с предыдущего шага сглаживания (недействительно, пока азимут не меняется).
+    QElapsedTimer m_smoothingClock;
+    //! \brief Соединение с сигналом кадров окна.
+    QMetaObject::Connection m_afterAnimatingConnection;
+
+    //! \brief Модель трасс.
+    QPointer<TargetTrackerModel> m_tracker;
+    //! \brief Соединения с сигналами модели.
+    std::vector<QMetaObject::Connection> m_trackerConnections;
+    //! \brief Нарисованные маркеры.
+    std::vector<Marker> m_markers;
+    //! \brief Маркеры, прочитанные из модели (переиспользуемый буфер).
+    std::vector<Marker> m_pendingMarkers;
+
+    //! \brief Цвет рисок.
+    QColor m_tickColor = QColor(QStringLiteral("#9aa3b1"));
+    //! \brief Цвет маркеров.
+    QColor m_targetColor = QColor(QStringLiteral("#2b2f36"));
+
+    //! \brief Требуется перестроить риски.
+    bool m_ticksDirty = true;
+    //! \brief Требуется перестроить маркеры.
+    bool m_markersDirty = true;
+};
+
+#endif // INDICATORDIALITEM_H
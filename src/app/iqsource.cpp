@@ -0,0 +1,217 @@
+/*!
+ *  \file iqsource.cpp
+ *  \brief Реализация источников отсчетов I/Q.
+ */
+#include "iqsource.h"
+
+#include <QtMath>
+
+#include <cmath>
+
+namespace {
+
+//! \brief Размер таблицы шума (степень двойки).
+constexpr std::uint32_t kNoiseTableSize = 1u << 16;
+//! \brief Отсчетов между случайными переходами по таблице шума.
+constexpr int kNoiseRun = 4096;
+//! \brief Отсчетов между пересчетами мгновенной частоты сигнала.
+constexpr int kModulationBlock = 64;
+//! \brief Отношение частоты дискретизации к частоте модуляции.
+constexpr double kModulationDivider = 4096.0;
+
+} // namespace
+
+/*!
+ *  \brief Конструирует источник со стандартным набором сигналов.
+ *  \param[in] seed Начальное значение генератора шума.
+ */
+SyntheticIqSource::SyntheticIqSource(std::uint32_t seed)
+    : m_random(seed != 0 ? seed : 1)
+{
+    // Гауссов шум по Боксу — Мюллеру, единичная дисперсия на компоненту.
+    m_noise.resize(kNoiseTableSize);
+    for (std::complex<float> &value : m_noise) {
+        const double u1 = (nextRandom() + 1.0) / 4294967297.0;
+        const double u2 = nextRandom() / 4294967296.0;
+        const double r = std::sqrt(-2.0 * std::log(u1));
+        value = {static_cast<float>(r * std::cos(2.0 * M_PI * u2)),
+                 static_cast<float>(r * std::sin(2.0 * M_PI * u2))};
+    }
+
+    setNoiseLevelDb(-53.0);
+    setSignals({
+        {1.2e9, 80e6, -30.0},
+        {3.6e9, 120e6, -37.0},
+        {6.8e9, 150e6, -30.0},
+        {12.3e9, 200e6, -21.0},
+        {16.2e9, 140e6, -40.0},
+    });
+}
+
+/*!
+ *  \brief Перестраивает источник на диапазон [minHz, maxHz].
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+void SyntheticIqSource::tune(double minHz, double maxHz)
+{
+    m_centerHz = 0.5 * (minHz + maxHz);
+    m_sampleRateHz = qMax(1.0, maxHz - minHz);
+}
+
+/*!
+ *  \brief Задает уровень шума относительно полной шкалы.
+ *  \param[in] noiseLevelDb Мощность шума на отсчет, дБ.
+ */
+void SyntheticIqSource::setNoiseLevelDb(double noiseLevelDb)
+{
+    // Мощность делится поровну между I и Q.
+    m_noiseSigma = static_cast<float>(std::sqrt(0.5 * std::pow(10.0, noiseLevelDb / 10.0)));
+}
+
+/*!
+ *  \brief Заменяет набор сигналов.
+ *  \param[in] signalList Сигналы.
+ */
+void SyntheticIqSource::setSignals(const std::vector<Signal> &signalList)
+{
+    // Сценарий обновляет параметры сигналов на ходу: фазы продолжаются без скачков.
+    m_signals.resize(signalList.size());
+    for (size_t i = 0; i < signalList.size(); ++i) {
+        m_signals[i].signal = signalList[i];
+        m_signals[i].amplitude = std::pow(10.0, signalList[i].levelDb / 20.0);
+    }
+}
+
+//! \brief Возвращает следующее число xorshift32.
+std::uint32_t SyntheticIqSource::nextRandom() noexcept
+{
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 17;
+    m_random ^= m_random << 5;
+    return m_random;
+}
+
+/*!
+ *  \brief Формирует отсчеты: шум плюс сигналы, попадающие в полосу.
+ *  \param[out] out Буфер на count отсчетов.
+ *  \param[in] count Количество отсчетов.
+ *  \return count.
+ */
+int SyntheticIqSource::read(std::complex<float> *out, int count)
+{
+    for (int i = 0; i < count;) {
+        if (i % kNoiseRun == 0) {
+            m_noisePos = nextRandom();
+        }
+        const int run = qMin(count - i, kNoiseRun - i % kNoiseRun);
+        for (int k = 0; k < run; ++k) {
+            const std::complex<float> n = m_noise[(m_noisePos + k) & (kNoiseTableSize - 1)];
+            out[i + k] = {n.real() * m_noiseSigma, n.imag() * m_noiseSigma};
+        }
+        m_noisePos += run;
+        i += run;
+    }
+
+    const double nyquistHz = 0.5 * m_sampleRateHz;
+    const double modulationStep = 2.0 * M_PI / kModulationDivider;
+    const double startSec = m_timeSec;
+    m_timeSec += count / m_sampleRateHz;
+    for (SignalState &state : m_signals) {
+        const Signal &signal = state.signal;
+        const double offsetHz = signal.centerHz + signal.driftHzPerSec * startSec - m_centerHz;
+        if (qAbs(offsetHz) - signal.deviationHz > nyquistHz) {
+            continue;
+        }
+
+        // Внутри блока частота постоянна: несущая вращается умножением на
+        // фазовый шаг, точная фаза восстанавливается в начале каждого блока.
+        for (int i = 0; i < count; i += kModulationBlock) {
+            const int block = qMin(kModulationBlock, count - i);
+            const double blockSec = startSec + i / m_sampleRateHz;
+            const double frequencyHz = signal.centerHz + signal.driftHzPerSec * blockSec - m_centerHz
+                                       + signal.deviationHz * std::sin(state.modulationPhase);
+            const double step = 2.0 * M_PI * frequencyHz / m_sampleRateHz;
+            if (signal.pulsePeriodUs > 0.0) {
+                // Между импульсами сигнала нет, но несущая продолжает вращаться.
+                const double phaseUs = std::fmod(blockSec * 1e6 - signal.pulseOffsetUs, signal.pulsePeriodUs);
+                const double positionUs = phaseUs < 0.0 ? phaseUs + signal.pulsePeriodUs : phaseUs;
+                if (positionUs >= signal.pulseWidthUs) {
+                    state.phase = std::remainder(state.phase + step * block, 2.0 * M_PI);
+                    state.modulationPhase = std::remainder(state.modulationPhase + modulationStep * block, 2.0 * M_PI);
+                    continue;
+                }
+            }
+
+            std::complex<float> phasor(static_cast<float>(state.amplitude * std::cos(state.phase)),
+                                       static_cast<float>(state.amplitude * std::sin(state.phase)));
+            const float stepRe = static_cast<float>(std::cos(step));
+            const float stepIm = static_cast<float>(std::sin(step));
+            for (int k = 0; k < block; ++k) {
+                out[i + k] = {out[i + k].real() + phasor.real(), out[i + k].imag() + phasor.imag()};
+                phasor = {phasor.real() * stepRe - phasor.imag() * stepIm,
+                          phasor.real() * stepIm + phasor.imag() * stepRe};
+            }
+
+            state.phase = std::remainder(state.phase + step * block, 2.0 * M_PI);
+            state.modulationPhase = std::remainder(state.modulationPhase + modulationStep * block, 2.0 * M_PI);
+        }
+    }
+    return count;
+}
+
+/*!
+ *  \brief Открывает файл cf32.
+ *  \param[in] path Путь к файлу.
+ *  \param[in] sampleRateHz Частота дискретизации записи, Гц.
+ *  \param[in] centerHz Центральная частота записи, Гц.
+ *  \return true, если файл открыт и не пуст.
+ */
+bool FileIqSource::open(const QString &path, double sampleRateHz, double centerHz)
+{
+    m_file.close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < qint64(sizeof(std::complex<float>))) {
+        m_file.close();
+        return false;
+    }
+    m_sampleRateHz = qMax(1.0, sampleRateHz);
+    m_centerHz = centerHz;
+    return true;
+}
+
+/*!
+ *  \brief Читает отсчеты, по достижении конца файла продолжая с начала.
+ *  \param[out] out Буфер на count отсчетов.
+ *  \param[in] count Запрошенное количество.
+ *  \return Количество прочитанных отсчетов.
+ */
+int FileIqSource::read(std::complex<float> *out, int count)
+{
+    if (!m_file.isOpen()) {
+        return 0;
+    }
+
+    constexpr qint64 sampleBytes = sizeof(std::complex<float>);
+    int done = 0;
+    bool rewound = false;
+    while (done < count) {
+        const qint64 bytes = m_file.read(reinterpret_cast<char *>(out + done), (count - done) * sampleBytes);
+        if (bytes < 0) {
+            break;
+        }
+        done += static_cast<int>(bytes / sampleBytes);
+        if (bytes % sampleBytes != 0) {
+            // Неполный последний отсчет файла отбрасывается.
+            m_file.seek(m_file.pos() - bytes % sampleBytes);
+        }
+        if (done < count) {
+            if (bytes == 0 && rewound) {
+                break;
+            }
+            rewound = bytes == 0;
+            m_file.seek(0);
+        }
+    }
+    return done;
+}
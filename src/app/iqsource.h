@@ -0,0 +1,196 @@
+/*!
+ *  \file iqsource.h
+ *  \brief Источники комплексных отсчетов I/Q для вычисления спектра.
+ */
+#ifndef IQSOURCE_H
+#define IQSOURCE_H
+
+#include <QFile>
+#include <QString>
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "spectrumframe.h"
+
+/*!
+ *  \class IqSource
+ *  \brief Интерфейс источника отсчетов I/Q.
+ *
+ *  Источник читается только из потока DSP.
+ */
+class IqSource
+{
+public:
+    //! \brief Разрушает источник.
+    virtual ~IqSource() = default;
+
+    //! \brief Возвращает частоту дискретизации, Гц.
+    virtual double sampleRateHz() const = 0;
+    //! \brief Возвращает центральную частоту, Гц.
+    virtual double centerHz() const = 0;
+
+    //! \brief Проверяет, может ли источник перестраиваться (обход панорамы стоянками).
+    virtual bool isTunable() const { return false; }
+
+    /*!
+     *  \brief Перестраивает источник на диапазон [minHz, maxHz], если он это поддерживает.
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     */
+    virtual void tune(double minHz, double maxHz)
+    {
+        Q_UNUSED(minHz);
+        Q_UNUSED(maxHz);
+    }
+
+    /*!
+     *  \brief Читает отсчеты.
+     *  \param[out] out Буфер на count отсчетов.
+     *  \param[in] count Запрошенное количество.
+     *  \return Количество прочитанных отсчетов (0 — данных нет).
+     */
+    virtual int read(std::complex<float> *out, int count) = 0;
+
+    /*!
+     *  \brief Забирает готовый кадр спектра, если источник выдает их сам (например, РПУ).
+     *
+     *  Готовый кадр выдается движком вместо вычисленного по отсчетам.
+     *
+     *  \param[out] frame Кадр, если он появился с прошлого вызова.
+     *  \return true, если получен новый кадр.
+     */
+    virtual bool takeSpectrum(SpectrumFrame &frame)
+    {
+        Q_UNUSED(frame);
+        return false;
+    }
+};
+
+/*!
+ *  \class SyntheticIqSource
+ *  \brief Синтетический широкополосный приемник: сигналы с ЧМ на фоне белого шума.
+ *
+ *  Сигналы заданы абсолютными частотами, поэтому при перестройке
+ *  они остаются на своих местах. Частота модуляции пропорциональна
+ *  частоте дискретизации, чтобы сигнал занимал свою полосу уже в одном
+ *  сегменте БПФ при любом диапазоне обзора. Шум берется из заранее вычисленной
+ *  таблицы гауссовых отсчетов со случайным смещением; последовательность
+ *  детерминирована при одинаковом начальном значении.
+ *
+ *  Импульсные сигналы включаются по времени источника (сумма прочитанных
+ *  отсчетов, деленная на частоту дискретизации) с точностью до блока
+ *  пересчета частоты; уход частоты отсчитывается от того же времени.
+ */
+class SyntheticIqSource : public IqSource
+{
+public:
+    //! \brief Параметры одного сигнала.
+    struct Signal
+    {
+        //! \brief Центральная частота, Гц.
+        double centerHz = 0.0;
+        //! \brief Девиация (половина занимаемой полосы), Гц.
+        double deviationHz = 0.0;
+        //! \brief Амплитуда относительно полной шкалы, дБ.
+        double levelDb = 0.0;
+        //! \brief Период повторения импульсов, мкс (0 — непрерывный сигнал).
+        double pulsePeriodUs = 0.0;
+        //! \brief Длительность импульса, мкс.
+        double pulseWidthUs = 0.0;
+        //! \brief Начало первого импульса, мкс.
+        double pulseOffsetUs = 0.0;
+        //! \brief Уход центральной частоты, Гц/с.
+        double driftHzPerSec = 0.0;
+    };
+
+    /*!
+     *  \brief Конструирует источник со стандартным набором сигналов.
+     *  \param[in] seed Начальное значение генератора шума.
+     */
+    explicit SyntheticIqSource(std::uint32_t seed = 1);
+
+    double sampleRateHz() const override { return m_sampleRateHz; }
+    double centerHz() const override { return m_centerHz; }
+    bool isTunable() const override { return true; }
+    void tune(double minHz, double maxHz) override;
+    int read(std::complex<float> *out, int count) override;
+
+    //! \brief Задает уровень шума (мощность на отсчет) относительно полной шкалы, дБ.
+    void setNoiseLevelDb(double noiseLevelDb);
+    //! \brief Заменяет набор сигналов (фазы сигналов с теми же номерами сохраняются).
+    void setSignals(const std::vector<Signal> &signalList);
+    //! \brief Возвращает время источника, с.
+    double timeSec() const noexcept { return m_timeSec; }
+
+private:
+    //! \brief Состояние сигнала.
+    struct SignalState
+    {
+        //! \brief Параметры сигнала.
+        Signal signal;
+        //! \brief Амплитуда (линейная).
+        double amplitude = 0.0;
+        //! \brief Фаза несущей, рад.
+        double phase = 0.0;
+        //! \brief Фаза модуляции, рад.
+        double modulationPhase = 0.0;
+    };
+
+    //! \brief Возвращает следующее псевдослучайное число.
+    std::uint32_t nextRandom() noexcept;
+
+    //! \brief Частота дискретизации, Гц.
+    double m_sampleRateHz = 1e6;
+    //! \brief Центральная частота, Гц.
+    double m_centerHz = 0.0;
+    //! \brief Время источника, с.
+    double m_timeSec = 0.0;
+    //! \brief Среднеквадратичное значение шума на компоненту.
+    float m_noiseSigma = 0.0f;
+    //! \brief Сигналы.
+    std::vector<SignalState> m_signals;
+    //! \brief Таблица гауссова шума единичной дисперсии.
+    std::vector<std::complex<float>> m_noise;
+    //! \brief Состояние генератора xorshift32.
+    std::uint32_t m_random = 1;
+    //! \brief Позиция в таблице шума.
+    std::uint32_t m_noisePos = 0;
+};
+
+/*!
+ *  \class FileIqSource
+ *  \brief Циклическое чтение записанных отсчетов I/Q из файла.
+ *
+ *  Формат файла: чередующиеся float32 I и Q (cf32) без заголовка.
+ */
+class FileIqSource : public IqSource
+{
+public:
+    //! \brief Конструирует закрытый источник.
+    FileIqSource() = default;
+
+    /*!
+     *  \brief Открывает файл.
+     *  \param[in] path Путь к файлу cf32.
+     *  \param[in] sampleRateHz Частота дискретизации записи, Гц.
+     *  \param[in] centerHz Центральная частота записи, Гц.
+     *  \return true, если файл открыт и содержит хотя бы один отсчет.
+     */
+    bool open(const QString &path, double sampleRateHz, double centerHz);
+
+    double sampleRateHz() const override { return m_sampleRateHz; }
+    double centerHz() const override { return m_centerHz; }
+    int read(std::complex<float> *out, int count) override;
+
+private:
+    //! \brief Открытый файл.
+    QFile m_file;
+    //! \brief Частота дискретизации, Гц.
+    double m_sampleRateHz = 0.0;
+    //! \brief Центральная частота, Гц.
+    double m_centerHz = 0.0;
+};
+
+#endif // IQSOURCE_H
@@ -0,0 +1,127 @@
+/*!
+ *  \file latencyhistogram.h
+ *  \brief Гистограмма задержек без блокировок с логарифмическими корзинами.
+ */
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/*!
+ *  \class LatencyHistogram
+ *  \brief Считает задержки в микросекундах по корзинам с относительной точностью 25 %.
+ *
+ *  Значения до 16 мкс имеют собственные корзины; дальше каждая октава
+ *  делится на четыре корзины. Запись — один fetch_add и обновление
+ *  максимума, поэтому писать могут несколько потоков одновременно.
+ *  Читатель снимает копию счетчиков и вычисляет процентили по разности
+ *  двух копий, то есть за интервал между ними.
+ */
+class LatencyHistogram
+{
+public:
+    //! \brief Количество корзин (до ~2^28 мкс).
+    static constexpr int kBucketCount = 112;
+
+    //! \brief Копия счетчиков корзин.
+    using Counts = std::array<quint64, kBucketCount>;
+
+    /*!
+     *  \brief Добавляет значение.
+     *  \param[in] valueUs Задержка, мкс.
+     */
+    void record(qint64 valueUs) noexcept
+    {
+        valueUs = qMax<qint64>(0, valueUs);
+        m_counts[static_cast<size_t>(bucketOf(valueUs))].fetch_add(1, std::memory_order_relaxed);
+        qint64 max = m_maxUs.load(std::memory_order_relaxed);
+        while (valueUs > max && !m_maxUs.compare_exchange_weak(max, valueUs, std::memory_order_relaxed)) {
+        }
+    }
+
+    /*!
+     *  \brief Копирует счетчики корзин.
+     *  \param[out] counts Счетчики.
+     */
+    void snapshot(Counts &counts) const noexcept
+    {
+        for (int i = 0; i < kBucketCount; ++i) {
+            counts[static_cast<size_t>(i)] = m_counts[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+        }
+    }
+
+    //! \brief Возвращает максимум с прошлого вызова и сбрасывает его, мкс.
+    qint64 takeMaxUs() noexcept { return m_maxUs.exchange(0, std::memory_order_relaxed); }
+
+    //! \brief Обнуляет счетчики и максимум.
+    void reset() noexcept
+    {
+        for (std::atomic<quint64> &count : m_counts) {
+            count.store(0, std::memory_order_relaxed);
+        }
+        m_maxUs.store(0, std::memory_order_relaxed);
+    }
+
+    //! \brief Возвращает номер корзины значения, мкс.
+    static int bucketOf(qint64 valueUs) noexcept
+    {
+        if (valueUs < 16) {
+            return static_cast<int>(valueUs);
+        }
+        const int exponent = 63 - qCountLeadingZeroBits(static_cast<quint64>(valueUs));
+        const int sub = static_cast<int>((valueUs >> (exponent - 2)) & 3);
+        return qMin(kBucketCount - 1, 16 + (exponent - 4) * 4 + sub);
+    }
+
+    //! \brief Возвращает верхнюю границу корзины, мкс.
+    static qint64 bucketUpperUs(int bucket) noexcept
+    {
+        if (bucket < 16) {
+            return bucket;
+        }
+        const int exponent = 4 + (bucket - 16) / 4;
+        const int sub = (bucket - 16) % 4;
+        return ((qint64(4 + sub + 1)) << (exponent - 2)) - 1;
+    }
+
+    /*!
+     *  \brief Вычисляет процентиль по разности двух копий счетчиков.
+     *  \param[in] current Текущая копия.
+     *  \param[in] previous Копия начала интервала.
+     *  \param[in] fraction Доля, 0..1.
+     *  \return Верхняя граница корзины процентиля, мкс (0 — значений не было).
+     */
+    static qint64 percentileUs(const Counts &current, const Counts &previous, double fraction) noexcept
+    {
+        quint64 total = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            total += current[static_cast<size_t>(i)] - previous[static_cast<size_t>(i)];
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        const quint64 rank = qMin(total, static_cast<quint64>(fraction * static_cast<double>(total)) + 1);
+        quint64 seen = 0;
+        for (int i = 0; i < kBucketCount; ++i) {
+            seen += current[static_cast<size_t>(i)] - previous[static_cast<size_t>(i)];
+            if (seen >= rank) {
+                return bucketUpperUs(i);
+            }
+        }
+        return bucketUpperUs(kBucketCount - 1);
+    }
+
+private:
+    //! \brief Счетчики корзин.
+    std::array<std::atomic<quint64>, kBucketCount> m_counts{};
+    //! \brief Максимум с последнего takeMaxUs(), мкс.
+    std::atomic<qint64> m_maxUs{0};
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,87 @@
+/*!
+ *  \file latestvalueslot.h
+ *  \brief Lock-free слот «побеждает последнее значение» для одного писателя и одного читателя.
+ */
+#ifndef LATESTVALUESLOT_H
+#define LATESTVALUESLOT_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+/*!
+ *  \class LatestValueSlot
+ *  \brief Тройной буфер для передачи значений от одного потока другому.
+ *
+ *  Писатель заполняет свой буфер и публикует его атомарным обменом с
+ *  промежуточным буфером, читатель забирает промежуточный буфер тем же
+ *  обменом. Ни одна из сторон не блокируется; если читатель не успел
+ *  забрать значение, оно заменяется более свежим и учитывается как
+ *  отброшенное.
+ *
+ *  \tparam T Тип значения; должен быть копируемым и конструируемым по умолчанию.
+ */
+template <typename T>
+class LatestValueSlot
+{
+public:
+    //! \brief Возвращает буфер писателя для заполнения (только поток писателя).
+    T &writeBuffer() noexcept { return m_buffers[m_backIndex]; }
+
+    /*!
+     *  \brief Публикует заполненный буфер писателя (только поток писателя).
+     *  \return true, если предыдущее опубликованное значение не было прочитано.
+     */
+    bool publish() noexcept
+    {
+        const std::uint8_t previous = m_middle.exchange(static_cast<std::uint8_t>(m_backIndex | kFreshBit),
+                                                        std::memory_order_acq_rel);
+        m_backIndex = previous & kIndexMask;
+        const bool dropped = (previous & kFreshBit) != 0;
+        if (dropped) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        return dropped;
+    }
+
+    /*!
+     *  \brief Забирает последнее опубликованное значение (только поток читателя).
+     *  \return true, если с прошлого вызова было опубликовано новое значение.
+     */
+    bool consume() noexcept
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+            return false;
+        }
+        const std::uint8_t previous = m_middle.exchange(m_frontIndex, std::memory_order_acq_rel);
+        m_frontIndex = previous & kIndexMask;
+        return true;
+    }
+
+    //! \brief Возвращает буфер читателя, обновляемый вызовом consume() (только поток читателя).
+    const T &readBuffer() const noexcept { return m_buffers[m_frontIndex]; }
+    //! \brief Возвращает буфер читателя для переноса значения (только поток читателя).
+    T &readBuffer() noexcept { return m_buffers[m_frontIndex]; }
+
+    //! \brief Возвращает число значений, замененных до прочтения.
+    std::uint64_t droppedCount() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    //! \brief Маска индекса буфера в промежуточном слоте.
+    static constexpr std::uint8_t kIndexMask = 0x3;
+    //! \brief Признак непрочитанного значения в промежуточном слоте.
+    static constexpr std::uint8_t kFreshBit = 0x4;
+
+    //! \brief Три буфера: писателя, промежуточный и читателя.
+    std::array<T, 3> m_buffers{};
+    //! \brief Индекс буфера писателя.
+    std::uint8_t m_backIndex = 0;
+    //! \brief Индекс промежуточного буфера и признак свежести.
+    std::atomic<std::uint8_t> m_middle{1};
+    //! \brief Индекс буфера читателя.
+    std::uint8_t m_frontIndex = 2;
+    //! \brief Счетчик отброшенных значений.
+    std::atomic<std::uint64_t> m_dropped{0};
+};
+
+#endif // LATESTVALUESLOT_H
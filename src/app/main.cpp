@@ -7,9 +7,19 @@
 #include <QSGRendererInterface>
 
 #include "appstate.h"
+#include "directionfinder.h"
 #include "frequencyviewportmodel.h"
+#include "indicatordialitem.h"
+#include "pipelineprofiler.h"
+#include "signalentity.h"
+#include "signaltablemodel.h"
 #include "spectrumcontrollerstub.h"
 #include "spectrumdecimator.h"
+#include "spectrumframe.h"
+#include "spectrumplotitem.h"
+#include "targettrackermodel.h"
+#include "traceprocessor.h"
+#include "waterfallitem.h"
 
 /*! \brief Инициализирует Qt/QML и запускает цикл обработки событий.
  *  \param[in] argc Количество аргументов командной строки.
@@ -20,6 +30,10 @@ int main(int argc, char *argv[])
 {
     QGuiApplication app(argc, argv);
 
+    qRegisterMetaType<SpectrumFrame>();
+    qRegisterMetaType<SignalBatch>();
+    qRegisterMetaType<SpectrumTraces>();
+
     QQuickWindow::setTextRenderType(QQuickWindow::NativeTextRendering);
 
     QQmlApplicationEngine engine;
@@ -40,6 +54,19 @@ int main(int argc, char *argv[])
     FrequencyViewportModel viewportModel;
     SpectrumControllerStub spectrumController;
     SpectrumDecimator spectrumDecimator;
+    SignalTableModel signalTable;
+
+    // Спектр формируется сразу на всю панораму; масштабирование и сдвиг
+    // обслуживаются пирамидой min/max. Точный диапазон запрашивается только
+    // при приближении глубже детализации панорамы.
+    spectrumController.requestSpectrum(viewportModel.globalMinHz(), viewportModel.globalMaxHz());
+    QObject::connect(&viewportModel, &FrequencyViewportModel::viewportChanged, &spectrumController,
+                     [&viewportModel, &spectrumController](double minHz, double maxHz) {
+                         spectrumController.scheduleViewport(minHz, maxHz, viewportModel.generation());
+                     });
+
+    QObject::connect(&spectrumController, &SpectrumControllerStub::signalsDetected, &signalTable,
+                     &SignalTableModel::appendBatch);
 
     qmlRegisterSingletonInstance(
         "SiriusScope",
@@ -62,6 +89,27 @@ int main(int argc, char *argv[])
         &spectrumDecimator
         );
 
+    qmlRegisterSingletonInstance(
+        "SiriusScope",
+        1, 0,
+        "PipelineProfiler",
+        &PipelineProfiler::instance()
+        );
+
+    qmlRegisterSingletonInstance(
+        "SiriusScope",
+        1, 0,
+        "SignalTable",
+        &signalTable
+        );
+
+    qmlRegisterType<SpectrumPlotItem>("SiriusScope", 1, 0, "SpectrumPlot");
+    qmlRegisterType<WaterfallItem>("SiriusScope", 1, 0, "Waterfall");
+    qmlRegisterType<TargetTrackerModel>("SiriusScope", 1, 0, "TargetTracker");
+    qmlRegisterType<IndicatorDialItem>("SiriusScope", 1, 0, "IndicatorDial");
+    qmlRegisterUncreatableType<DirectionFinder>("SiriusScope", 1, 0, "DirectionFinder",
+                                                QStringLiteral("DirectionFinder is owned by SpectrumController"));
+
     engine.loadFromModule("SiriusScope", "Main");
 
     return app.exec();
@@ -0,0 +1,340 @@
+/*!
+ *  \file minmaxkernel.cpp
+ *  \brief Реализация MinMaxKernel.
+ */
+#include "minmaxkernel.h"
+
+#include <algorithm>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIRIUS_MINMAX_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//! \brief Сигнатура ядра свертки массива.
+using ReduceFn = void (*)(const float *, std::int64_t, float &, float &);
+
+constexpr float kInf = std::numeric_limits<float>::infinity();
+
+/*!
+ *  \brief Приводит -0 к +0, чтобы результат не зависел от порядка обхода.
+ *  \param[in] v Значение.
+ *  \return То же значение, ноль всегда положительный.
+ */
+inline float canonicalZero(float v) noexcept
+{
+    return v == 0.0f ? 0.0f : v;
+}
+
+/*!
+ *  \brief Скалярная свертка: семантика совпадает с minps/maxps (NaN пропускается).
+ */
+void reduceScalar(const float *data, std::int64_t count, float &minVal, float &maxVal)
+{
+    float mn = kInf;
+    float mx = -kInf;
+    for (std::int64_t i = 0; i < count; ++i) {
+        const float v = data[i];
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+    }
+    minVal = canonicalZero(mn);
+    maxVal = canonicalZero(mx);
+}
+
+#ifdef SIRIUS_MINMAX_X86
+
+/*!
+ *  \brief Свертка SSE2: 4 значения за шаг, два независимых аккумулятора.
+ */
+void reduceSse2(const float *data, std::int64_t count, float &minVal, float &maxVal)
+{
+    if (count < 8) {
+        reduceScalar(data, count, minVal, maxVal);
+        return;
+    }
+
+    __m128 mn0 = _mm_set1_ps(kInf);
+    __m128 mx0 = _mm_set1_ps(-kInf);
+    __m128 mn1 = mn0;
+    __m128 mx1 = mx0;
+
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128 a = _mm_loadu_ps(data + i);
+        const __m128 b = _mm_loadu_ps(data + i + 4);
+        mn0 = _mm_min_ps(a, mn0);
+        mx0 = _mm_max_ps(a, mx0);
+        mn1 = _mm_min_ps(b, mn1);
+        mx1 = _mm_max_ps(b, mx1);
+    }
+    for (; i + 4 <= count; i += 4) {
+        const __m128 a = _mm_loadu_ps(data + i);
+        mn0 = _mm_min_ps(a, mn0);
+        mx0 = _mm_max_ps(a, mx0);
+    }
+    mn0 = _mm_min_ps(mn0, mn1);
+    mx0 = _mm_max_ps(mx0, mx1);
+
+    alignas(16) float mins[4];
+    alignas(16) float maxs[4];
+    _mm_store_ps(mins, mn0);
+    _mm_store_ps(maxs, mx0);
+
+    float mn = kInf;
+    float mx = -kInf;
+    for (int k = 0; k < 4; ++k) {
+        mn = mins[k] < mn ? mins[k] : mn;
+        mx = maxs[k] > mx ? maxs[k] : mx;
+    }
+    for (; i < count; ++i) {
+        const float v = data[i];
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+    }
+    minVal = canonicalZero(mn);
+    maxVal = canonicalZero(mx);
+}
+
+/*!
+ *  \brief Свертка AVX2: 8 значений за шаг, два независимых аккумулятора.
+ */
+__attribute__((target("avx2")))
+void reduceAvx2(const float *data, std::int64_t count, float &minVal, float &maxVal)
+{
+    if (count < 16) {
+        reduceScalar(data, count, minVal, maxVal);
+        return;
+    }
+
+    __m256 mn0 = _mm256_set1_ps(kInf);
+    __m256 mx0 = _mm256_set1_ps(-kInf);
+    __m256 mn1 = mn0;
+    __m256 mx1 = mx0;
+
+    std::int64_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256 a = _mm256_loadu_ps(data + i);
+        const __m256 b = _mm256_loadu_ps(data + i + 8);
+        mn0 = _mm256_min_ps(a, mn0);
+        mx0 = _mm256_max_ps(a, mx0);
+        mn1 = _mm256_min_ps(b, mn1);
+        mx1 = _mm256_max_ps(b, mx1);
+    }
+    for (; i + 8 <= count; i += 8) {
+        const __m256 a = _mm256_loadu_ps(data + i);
+        mn0 = _mm256_min_ps(a, mn0);
+        mx0 = _mm256_max_ps(a, mx0);
+    }
+    mn0 = _mm256_min_ps(mn0, mn1);
+    mx0 = _mm256_max_ps(mx0, mx1);
+
+    alignas(32) float mins[8];
+    alignas(32) float maxs[8];
+    _mm256_store_ps(mins, mn0);
+    _mm256_store_ps(maxs, mx0);
+
+    float mn = kInf;
+    float mx = -kInf;
+    for (int k = 0; k < 8; ++k) {
+        mn = mins[k] < mn ? mins[k] : mn;
+        mx = maxs[k] > mx ? maxs[k] : mx;
+    }
+    for (; i < count; ++i) {
+        const float v = data[i];
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+    }
+    minVal = canonicalZero(mn);
+    maxVal = canonicalZero(mx);
+}
+
+/*!
+ *  \brief Свертка AVX-512: 16 значений за шаг, хвост — маскированной загрузкой.
+ */
+__attribute__((target("avx512f")))
+void reduceAvx512(const float *data, std::int64_t count, float &minVal, float &maxVal)
+{
+    if (count < 32) {
+        reduceScalar(data, count, minVal, maxVal);
+        return;
+    }
+
+    const __m512 posInf = _mm512_set1_ps(kInf);
+    const __m512 negInf = _mm512_set1_ps(-kInf);
+    __m512 mn0 = posInf;
+    __m512 mx0 = negInf;
+    __m512 mn1 = posInf;
+    __m512 mx1 = negInf;
+
+    std::int64_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        const __m512 a = _mm512_loadu_ps(data + i);
+        const __m512 b = _mm512_loadu_ps(data + i + 16);
+        mn0 = _mm512_min_ps(a, mn0);
+        mx0 = _mm512_max_ps(a, mx0);
+        mn1 = _mm512_min_ps(b, mn1);
+        mx1 = _mm512_max_ps(b, mx1);
+    }
+    if (i < count) {
+        const std::int64_t rest = std::min<std::int64_t>(count - i, 16);
+        const __mmask16 mask = static_cast<__mmask16>((1u << rest) - 1u);
+        const __m512 a = _mm512_mask_loadu_ps(posInf, mask, data + i);
+        const __m512 b = _mm512_mask_loadu_ps(negInf, mask, data + i);
+        mn0 = _mm512_min_ps(a, mn0);
+        mx0 = _mm512_max_ps(b, mx0);
+        i += rest;
+    }
+    mn0 = _mm512_min_ps(mn0, mn1);
+    mx0 = _mm512_max_ps(mx0, mx1);
+
+    alignas(64) float mins[16];
+    alignas(64) float maxs[16];
+    _mm512_store_ps(mins, mn0);
+    _mm512_store_ps(maxs, mx0);
+
+    float mn = kInf;
+    float mx = -kInf;
+    for (int k = 0; k < 16; ++k) {
+        mn = mins[k] < mn ? mins[k] : mn;
+        mx = maxs[k] > mx ? maxs[k] : mx;
+    }
+    for (; i < count; ++i) {
+        const float v = data[i];
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+    }
+    minVal = canonicalZero(mn);
+    maxVal = canonicalZero(mx);
+}
+
+#endif // SIRIUS_MINMAX_X86
+
+/*!
+ *  \brief Возвращает ядро для варианта.
+ *  \param[in] variant Вариант ядра.
+ *  \return Указатель на функцию свертки.
+ */
+ReduceFn reduceFunction(MinMaxKernel::Variant variant) noexcept
+{
+    switch (variant) {
+#ifdef SIRIUS_MINMAX_X86
+    case MinMaxKernel::Variant::Sse2:
+        return &reduceSse2;
+    case MinMaxKernel::Variant::Avx2:
+        return &reduceAvx2;
+    case MinMaxKernel::Variant::Avx512:
+        return &reduceAvx512;
+#endif
+    default:
+        return &reduceScalar;
+    }
+}
+
+} // namespace
+
+//! \brief Возвращает лучший поддерживаемый процессором вариант (определяется один раз).
+MinMaxKernel::Variant MinMaxKernel::bestVariant() noexcept
+{
+    static const Variant best = [] {
+        for (int v = kVariantCount - 1; v > 0; --v) {
+            if (isSupported(static_cast<Variant>(v))) {
+                return static_cast<Variant>(v);
+            }
+        }
+        return Variant::Scalar;
+    }();
+    return best;
+}
+
+//! \brief Проверяет, поддерживает ли процессор вариант.
+bool MinMaxKernel::isSupported(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return true;
+#ifdef SIRIUS_MINMAX_X86
+    case Variant::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Variant::Avx2:
+        return __builtin_cpu_supports("avx2");
+    case Variant::Avx512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+//! \brief Возвращает имя варианта.
+const char *MinMaxKernel::variantName(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return "scalar";
+    case Variant::Sse2:
+        return "sse2";
+    case Variant::Avx2:
+        return "avx2";
+    case Variant::Avx512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+/*!
+ *  \brief Находит min/max непрерывного массива выбранным вариантом.
+ *  \param[in] variant Вариант ядра.
+ *  \param[in] data Значения.
+ *  \param[in] count Количество значений.
+ *  \param[out] minVal Минимум.
+ *  \param[out] maxVal Максимум.
+ */
+void MinMaxKernel::reduce(Variant variant, const float *data, std::int64_t count, float &minVal, float &maxVal) noexcept
+{
+    reduceFunction(variant)(data, count, minVal, maxVal);
+}
+
+/*!
+ *  \brief Сводит массив к парам min/max для диапазона колонок.
+ *  \param[in] variant Вариант ядра.
+ *  \param[in] samples Значения.
+ *  \param[in] count Количество значений.
+ *  \param[in] width Общее количество колонок.
+ *  \param[in] firstColumn Первая колонка.
+ *  \param[in] lastColumn Колонка за последней.
+ *  \param[out] out Буфер пар min/max.
+ */
+void MinMaxKernel::decimate(Variant variant, const float *samples, std::int64_t count, int width,
+                            int firstColumn, int lastColumn, float *out) noexcept
+{
+    if (!samples || !out || count <= 0 || width <= 0) {
+        return;
+    }
+    firstColumn = std::clamp(firstColumn, 0, width);
+    lastColumn = std::clamp(lastColumn, firstColumn, width);
+
+    const ReduceFn fn = reduceFunction(variant);
+
+    // Граница floor(x * count / width) ведется как целая часть и остаток,
+    // поэтому деление выполняется один раз на диапазон, а не на колонку.
+    const std::int64_t quotient = count / width;
+    const std::int64_t remainder = count % width;
+    std::int64_t boundary = (static_cast<std::int64_t>(firstColumn) * count) / width;
+    std::int64_t error = (static_cast<std::int64_t>(firstColumn) * count) % width;
+
+    for (int x = firstColumn; x < lastColumn; ++x) {
+        const std::int64_t start = boundary;
+        boundary += quotient;
+        error += remainder;
+        if (error >= width) {
+            error -= width;
+            ++boundary;
+        }
+        const std::int64_t end = std::min(count, std::max(start + 1, boundary));
+        fn(samples + start, end - start, out[x * 2], out[x * 2 + 1]);
+    }
+}
@@ -0,0 +1,67 @@
+/*!
+ *  \file minmaxkernel.h
+ *  \brief Векторизованные ядра поиска min/max с выбором варианта во время выполнения.
+ */
+#ifndef MINMAXKERNEL_H
+#define MINMAXKERNEL_H
+
+#include <cstdint>
+
+/*!
+ *  \class MinMaxKernel
+ *  \brief Ядра min/max для float32: скалярное, SSE2, AVX2 и AVX-512.
+ *
+ *  Вариант выбирается один раз по возможностям процессора. Все варианты
+ *  дают побитно одинаковый результат: NaN пропускаются, нули приводятся
+ *  к +0, пустая колонка дает пару (+inf, -inf).
+ */
+class MinMaxKernel
+{
+public:
+    //! \brief Вариант реализации ядра.
+    enum class Variant : int {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2,
+        Avx512 = 3
+    };
+
+    //! \brief Количество вариантов.
+    static constexpr int kVariantCount = 4;
+
+    //! \brief Возвращает лучший поддерживаемый процессором вариант.
+    static Variant bestVariant() noexcept;
+    //! \brief Проверяет, поддерживает ли процессор вариант.
+    static bool isSupported(Variant variant) noexcept;
+    //! \brief Возвращает имя варианта.
+    static const char *variantName(Variant variant) noexcept;
+
+    /*!
+     *  \brief Находит min/max непрерывного массива.
+     *  \param[in] variant Вариант ядра (должен поддерживаться).
+     *  \param[in] data Значения.
+     *  \param[in] count Количество значений.
+     *  \param[out] minVal Минимум (+inf для пустого массива).
+     *  \param[out] maxVal Максимум (-inf для пустого массива).
+     */
+    static void reduce(Variant variant, const float *data, std::int64_t count, float &minVal, float &maxVal) noexcept;
+
+    /*!
+     *  \brief Сводит массив к парам min/max для колонок [firstColumn, lastColumn).
+     *
+     *  Колонка x покрывает значения [floor(x * count / width), floor((x + 1) * count / width)),
+     *  но не меньше одного значения. Границы считаются без деления на каждой колонке.
+     *
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] samples Значения.
+     *  \param[in] count Количество значений.
+     *  \param[in] width Общее количество колонок.
+     *  \param[in] firstColumn Первая обрабатываемая колонка.
+     *  \param[in] lastColumn Колонка за последней обрабатываемой.
+     *  \param[out] out Буфер на 2 * width значений; заполняются только колонки диапазона.
+     */
+    static void decimate(Variant variant, const float *samples, std::int64_t count, int width,
+                         int firstColumn, int lastColumn, float *out) noexcept;
+};
+
+#endif // MINMAXKERNEL_H
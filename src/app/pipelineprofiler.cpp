@@ -0,0 +1,261 @@
+/*!
+ *  \file pipelineprofiler.cpp
+ *  \brief Реализация PipelineProfiler.
+ */
+#include "pipelineprofiler.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QVariantMap>
+
+#include <chrono>
+
+std::atomic<bool> PipelineProfiler::s_active{false};
+
+//! \brief Возвращает экземпляр синглтона.
+PipelineProfiler &PipelineProfiler::instance()
+{
+    static PipelineProfiler inst;
+    return inst;
+}
+
+//! \brief Возвращает монотонное время, нс.
+qint64 PipelineProfiler::nowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+//! \brief Возвращает имя этапа.
+const char *PipelineProfiler::stageName(Stage stage) noexcept
+{
+    switch (stage) {
+    case Stage::Generate:
+        return "generate";
+    case Stage::Detect:
+        return "detect";
+    case Stage::Deliver:
+        return "deliver";
+    case Stage::Decimate:
+        return "decimate";
+    case Stage::Render:
+        return "render";
+    case Stage::EndToEnd:
+        return "end-to-end";
+    }
+    return "unknown";
+}
+
+//! \brief Конструирует синглтон; SIRIUS_PROFILE=1 включает профилирование при запуске.
+PipelineProfiler::PipelineProfiler(QObject *parent)
+    : QObject(parent)
+{
+    m_summaryTimer.setInterval(kSummaryIntervalMs);
+    connect(&m_summaryTimer, &QTimer::timeout, this, &PipelineProfiler::updateSummary);
+
+    if (qEnvironmentVariableIntValue("SIRIUS_PROFILE") != 0) {
+        setEnabled(true);
+    }
+}
+
+/*!
+ *  \brief Учитывает длительность этапа.
+ *  \param[in] stage Этап.
+ *  \param[in] startNs Начало, нс.
+ *  \param[in] endNs Конец, нс.
+ *  \param[in] sequence Номер кадра.
+ */
+void PipelineProfiler::record(Stage stage, qint64 startNs, qint64 endNs, quint64 sequence) noexcept
+{
+    if (!isActive()) {
+        return;
+    }
+    m_histograms[static_cast<size_t>(stage)].record((endNs - startNs) / 1000);
+
+    if (!m_tracing.load(std::memory_order_acquire)) {
+        return;
+    }
+    // Заполненное кольцо не перезаписывается: трасса хранит первые kTraceCapacity событий.
+    const int slot = m_traceIndex.fetch_add(1, std::memory_order_relaxed);
+    if (slot < kTraceCapacity) {
+        TraceEvent &event = m_trace[static_cast<size_t>(slot)];
+        event.stage = static_cast<int>(stage);
+        event.sequence = sequence;
+        event.startNs = startNs;
+        event.durationNs = endNs - startNs;
+        event.ready.store(true, std::memory_order_release);
+    }
+}
+
+/*!
+ *  \brief Учитывает пропущенные кадры.
+ *  \param[in] count Количество кадров.
+ */
+void PipelineProfiler::addDroppedFrames(quint64 count) noexcept
+{
+    if (isActive() && count > 0) {
+        m_droppedFrames.fetch_add(count, std::memory_order_relaxed);
+    }
+}
+
+/*!
+ *  \brief Сохраняет события трассы.
+ *
+ *  Каждый этап выводится отдельной дорожкой (tid), номер кадра — в args,
+ *  чтобы в просмотрщике можно было проследить один кадр по всем этапам.
+ *
+ *  \param[in] path Путь к файлу; пустой — файл во временном каталоге.
+ *  \return Путь к записанному файлу или пустая строка при ошибке.
+ */
+QString PipelineProfiler::writeTrace(const QString &path) const
+{
+    const QString filePath = !path.isEmpty()
+        ? path
+        : QDir::temp().filePath(QStringLiteral("siriusscope-trace-%1.json")
+                                    .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss"))));
+
+    QJsonArray events;
+    for (int stage = 0; stage < kStageCount; ++stage) {
+        events.append(QJsonObject{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), 1},
+            {QStringLiteral("tid"), stage},
+            {QStringLiteral("args"),
+             QJsonObject{{QStringLiteral("name"), QString::fromLatin1(stageName(static_cast<Stage>(stage)))}}}});
+    }
+
+    const int count = m_trace ? qMin(m_traceIndex.load(std::memory_order_relaxed), kTraceCapacity) : 0;
+    for (int i = 0; i < count; ++i) {
+        const TraceEvent &event = m_trace[static_cast<size_t>(i)];
+        if (!event.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+        events.append(QJsonObject{
+            {QStringLiteral("name"), QString::fromLatin1(stageName(static_cast<Stage>(event.stage)))},
+            {QStringLiteral("cat"), QStringLiteral("pipeline")},
+            {QStringLiteral("ph"), QStringLiteral("X")},
+            {QStringLiteral("pid"), 1},
+            {QStringLiteral("tid"), event.stage},
+            {QStringLiteral("ts"), static_cast<double>(event.startNs) / 1000.0},
+            {QStringLiteral("dur"), static_cast<double>(event.durationNs) / 1000.0},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("sequence"), static_cast<qint64>(event.sequence)}}}});
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QString();
+    }
+    const QJsonObject root{{QStringLiteral("traceEvents"), events},
+                           {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")}};
+    if (file.write(QJsonDocument(root).toJson(QJsonDocument::Compact)) <= 0) {
+        return QString();
+    }
+    return filePath;
+}
+
+//! \brief Обнуляет гистограммы, счетчик пропусков и трассу.
+void PipelineProfiler::reset()
+{
+    for (LatencyHistogram &histogram : m_histograms) {
+        histogram.reset();
+    }
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    if (isTracing()) {
+        setTracing(false);
+        setTracing(true);
+    }
+    restartInterval();
+}
+
+//! \brief Включает или выключает профилирование.
+void PipelineProfiler::setEnabled(bool enabled)
+{
+    if (isActive() == enabled)
+        return;
+
+    if (enabled) {
+        restartInterval();
+        m_summaryTimer.start();
+    } else {
+        m_summaryTimer.stop();
+        m_stages.clear();
+        m_framesPerSecond = 0.0;
+        emit summaryChanged();
+    }
+    s_active.store(enabled, std::memory_order_relaxed);
+    emit enabledChanged();
+}
+
+/*!
+ *  \brief Начинает новую трассу или останавливает запись событий.
+ *
+ *  События остановленной трассы сохраняются до начала следующей.
+ *
+ *  \param[in] tracing Признак записи.
+ */
+void PipelineProfiler::setTracing(bool tracing)
+{
+    if (isTracing() == tracing)
+        return;
+
+    if (tracing) {
+        if (!m_trace) {
+            m_trace = std::make_unique<TraceEvent[]>(kTraceCapacity);
+        }
+        for (int i = 0; i < kTraceCapacity; ++i) {
+            m_trace[static_cast<size_t>(i)].ready.store(false, std::memory_order_relaxed);
+        }
+        m_traceIndex.store(0, std::memory_order_relaxed);
+    }
+    m_tracing.store(tracing, std::memory_order_release);
+    emit tracingChanged();
+}
+
+//! \brief Вычисляет p50/p99/максимум каждого этапа за прошедший интервал.
+void PipelineProfiler::updateSummary()
+{
+    const double seconds = qMax(1e-3, m_intervalClock.restart() / 1000.0);
+
+    QVariantList stages;
+    LatencyHistogram::Counts counts;
+    for (int stage = 0; stage < kStageCount; ++stage) {
+        LatencyHistogram &histogram = m_histograms[static_cast<size_t>(stage)];
+        LatencyHistogram::Counts &previous = m_intervalCounts[static_cast<size_t>(stage)];
+        histogram.snapshot(counts);
+
+        quint64 count = 0;
+        for (int i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+            count += counts[static_cast<size_t>(i)] - previous[static_cast<size_t>(i)];
+        }
+        stages.append(QVariantMap{
+            {QStringLiteral("name"), QString::fromLatin1(stageName(static_cast<Stage>(stage)))},
+            {QStringLiteral("count"), count},
+            {QStringLiteral("p50Ms"), LatencyHistogram::percentileUs(counts, previous, 0.50) / 1000.0},
+            {QStringLiteral("p99Ms"), LatencyHistogram::percentileUs(counts, previous, 0.99) / 1000.0},
+            {QStringLiteral("maxMs"), histogram.takeMaxUs() / 1000.0}});
+
+        if (static_cast<Stage>(stage) == Stage::EndToEnd) {
+            m_framesPerSecond = static_cast<double>(count) / seconds;
+        }
+        previous = counts;
+    }
+
+    m_stages = stages;
+    emit summaryChanged();
+}
+
+//! \brief Запоминает текущие счетчики как начало интервала сводки.
+void PipelineProfiler::restartInterval()
+{
+    for (int stage = 0; stage < kStageCount; ++stage) {
+        m_histograms[static_cast<size_t>(stage)].snapshot(m_intervalCounts[static_cast<size_t>(stage)]);
+        m_histograms[static_cast<size_t>(stage)].takeMaxUs();
+    }
+    m_intervalClock.start();
+}
@@ -0,0 +1,179 @@
+/*!
+ *  \file pipelineprofiler.h
+ *  \brief Измерение задержек этапов конвейера спектра и запись трассы Chrome.
+ */
+#ifndef PIPELINEPROFILER_H
+#define PIPELINEPROFILER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+#include <QVariantList>
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "latencyhistogram.h"
+
+/*!
+ *  \class PipelineProfiler
+ *  \brief Собирает задержки этапов кадра: формирование, обнаружение, доставку
+ *  в UI, сведение и отрисовку, а также сквозную задержку и пропуски кадров.
+ *
+ *  Этапы отмечаются в разных потоках (формирования, UI, отрисовки) и
+ *  пишутся в гистограммы LatencyHistogram без блокировок. Раз в секунду
+ *  поток UI вычисляет p50/p99/максимум за прошедший интервал и сообщает
+ *  summaryChanged. При включенной трассе события пишутся в кольцо
+ *  фиксированного размера и сохраняются writeTrace() в формате trace event
+ *  (chrome://tracing, Perfetto).
+ *
+ *  Пока профилирование выключено, места измерений проверяют только
+ *  isActive() — одно атомарное чтение — и не читают часы.
+ *
+ *  Экземпляр является синглтоном и доступен через PipelineProfiler::instance().
+ */
+class PipelineProfiler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged FINAL)
+    Q_PROPERTY(bool tracing READ isTracing WRITE setTracing NOTIFY tracingChanged FINAL)
+    Q_PROPERTY(QVariantList stages READ stages NOTIFY summaryChanged FINAL)
+    Q_PROPERTY(double framesPerSecond READ framesPerSecond NOTIFY summaryChanged FINAL)
+    Q_PROPERTY(quint64 droppedFrames READ droppedFrames NOTIFY summaryChanged FINAL)
+
+public:
+    //! \brief Этап конвейера.
+    enum class Stage : int {
+        //! \brief Формирование кадра (источник, БПФ, сборка панорамы, пирамида).
+        Generate = 0,
+        //! \brief Обнаружение сигналов в потоке формирования.
+        Detect = 1,
+        //! \brief От публикации кадра до его получения потоком UI.
+        Deliver = 2,
+        //! \brief Сведение кадра к колонкам спектра.
+        Decimate = 3,
+        //! \brief От синхронизации scene graph до вывода кадра на экран.
+        Render = 4,
+        //! \brief От начала формирования до вывода на экран.
+        EndToEnd = 5
+    };
+
+    //! \brief Количество этапов.
+    static constexpr int kStageCount = 6;
+    //! \brief Емкость кольца событий трассы.
+    static constexpr int kTraceCapacity = 1 << 16;
+    //! \brief Интервал вычисления сводки, мс.
+    static constexpr int kSummaryIntervalMs = 1000;
+
+    //! \brief Возвращает экземпляр синглтона.
+    static PipelineProfiler &instance();
+
+    //! \brief Проверяет, включено ли профилирование (вызывается в горячих путях).
+    static bool isActive() noexcept { return s_active.load(std::memory_order_relaxed); }
+    //! \brief Возвращает монотонное время, нс.
+    static qint64 nowNs() noexcept;
+    //! \brief Возвращает имя этапа.
+    static const char *stageName(Stage stage) noexcept;
+
+    /*!
+     *  \brief Учитывает длительность этапа (из любого потока, без блокировок).
+     *  \param[in] stage Этап.
+     *  \param[in] startNs Начало, нс nowNs().
+     *  \param[in] endNs Конец, нс nowNs().
+     *  \param[in] sequence Номер кадра.
+     */
+    void record(Stage stage, qint64 startNs, qint64 endNs, quint64 sequence) noexcept;
+    /*!
+     *  \brief Учитывает кадры, замененные более новыми до вывода на экран.
+     *  \param[in] count Количество кадров.
+     */
+    void addDroppedFrames(quint64 count) noexcept;
+
+    //! \brief Проверяет, включено ли профилирование.
+    bool isEnabled() const noexcept { return isActive(); }
+    //! \brief Проверяет, пишется ли трасса.
+    bool isTracing() const noexcept { return m_tracing.load(std::memory_order_relaxed); }
+    //! \brief Возвращает сводку за последний интервал: {name, count, p50Ms, p99Ms, maxMs} на этап.
+    QVariantList stages() const { return m_stages; }
+    //! \brief Возвращает число кадров, выведенных на экран за секунду последнего интервала.
+    double framesPerSecond() const noexcept { return m_framesPerSecond; }
+    //! \brief Возвращает число пропущенных кадров с включения профилирования.
+    quint64 droppedFrames() const noexcept { return m_droppedFrames.load(std::memory_order_relaxed); }
+
+    /*!
+     *  \brief Сохраняет записанные события трассы в формате trace event JSON.
+     *  \param[in] path Путь к файлу; пустой — файл во временном каталоге.
+     *  \return Путь к записанному файлу или пустая строка при ошибке.
+     */
+    Q_INVOKABLE QString writeTrace(const QString &path = QString()) const;
+    //! \brief Обнуляет гистограммы, счетчик пропусков и трассу.
+    Q_INVOKABLE void reset();
+
+public slots:
+    //! \brief Включает или выключает профилирование.
+    void setEnabled(bool enabled);
+    //! \brief Начинает новую трассу или останавливает запись событий.
+    void setTracing(bool tracing);
+
+signals:
+    //! \brief Сигнал о включении или выключении профилирования.
+    void enabledChanged();
+    //! \brief Сигнал о начале или остановке трассы.
+    void tracingChanged();
+    //! \brief Сигнал о новой сводке.
+    void summaryChanged();
+
+private slots:
+    //! \brief Вычисляет сводку за прошедший интервал.
+    void updateSummary();
+
+private:
+    //! \brief Событие трассы.
+    struct TraceEvent
+    {
+        //! \brief Событие записано полностью.
+        std::atomic<bool> ready{false};
+        //! \brief Этап.
+        int stage = 0;
+        //! \brief Номер кадра.
+        quint64 sequence = 0;
+        //! \brief Начало, нс.
+        qint64 startNs = 0;
+        //! \brief Длительность, нс.
+        qint64 durationNs = 0;
+    };
+
+    //! \brief Конструирует синглтон; профилирование включается переменной SIRIUS_PROFILE.
+    explicit PipelineProfiler(QObject *parent = nullptr);
+    //! \brief Запоминает текущие счетчики как начало интервала сводки.
+    void restartInterval();
+
+    //! \brief Признак включенного профилирования.
+    static std::atomic<bool> s_active;
+
+    //! \brief Гистограммы этапов.
+    std::array<LatencyHistogram, kStageCount> m_histograms;
+    //! \brief Счетчики гистограмм в начале интервала сводки (поток UI).
+    std::array<LatencyHistogram::Counts, kStageCount> m_intervalCounts{};
+    //! \brief Число пропущенных кадров.
+    std::atomic<quint64> m_droppedFrames{0};
+
+    //! \brief Кольцо событий трассы (выделяется при первом включении трассы).
+    std::unique_ptr<TraceEvent[]> m_trace;
+    //! \brief Индекс следующего события трассы.
+    std::atomic<int> m_traceIndex{0};
+    //! \brief Признак записи трассы.
+    std::atomic<bool> m_tracing{false};
+
+    //! \brief Таймер сводки.
+    QTimer m_summaryTimer;
+    //! \brief Длительность интервала сводки.
+    QElapsedTimer m_intervalClock;
+    //! \brief Сводка за последний интервал.
+    QVariantList m_stages;
+    //! \brief Кадров на экран в секунду за последний интервал.
+    double m_framesPerSecond = 0.0;
+};
+
+#endif // PIPELINEPROFILER_H
@@ -0,0 +1,202 @@
+/*!
+ *  \file recordingformat.h
+ *  \brief Структуры файла записи спектра (*.ssr) и его разреженного индекса (*.ssi).
+ *
+ *  Файл записи:
+ *  \code
+ *  [FileHeader, kFileHeaderBytes][чанк 0][чанк 1]...
+ *  чанк: [ChunkHeader, kChunkHeaderBytes][запись][запись]...[неиспользуемый хвост]
+ *  запись: [RecordHeader][данные кадра][выравнивание до kRecordAlignment]
+ *  данные кадра (kEncodingFloat32): [binCount значений float]
+ *  данные кадра (kEncodingSpectrumCodec): [CodedRecordHeader][поток SpectrumCodec]
+ *  \endcode
+ *
+ *  Все чанки файла имеют одинаковый размер FileHeader::chunkBytes, запись
+ *  никогда не пересекает границу чанка. Чанк, заголовок которого помечен
+ *  sealed, полностью сброшен на диск; последний незапечатанный чанк
+ *  читается до первой записи с неверной сигнатурой.
+ *
+ *  В сжатом файле первая запись каждого чанка — ключевой кадр кодека, а
+ *  каждая запись хранит расстояние до ключевого кадра своего чанка, так что
+ *  любой кадр декодируется без чтения других чанков.
+ *
+ *  Файл индекса содержит IndexEntry для первой записи каждого чанка и для
+ *  каждой kIndexStride-й записи файла, упорядоченные по времени. Поля
+ *  хранятся в порядке байтов платформы (little-endian на всех целевых).
+ */
+#ifndef RECORDINGFORMAT_H
+#define RECORDINGFORMAT_H
+
+#include <QtGlobal>
+
+#include <type_traits>
+
+namespace RecordingFormat {
+
+//! \brief Сигнатура файла записи ("SSRF").
+constexpr quint32 kFileMagic = 0x46525353u;
+//! \brief Сигнатура чанка ("SSCH").
+constexpr quint32 kChunkMagic = 0x48435353u;
+//! \brief Сигнатура записи кадра ("SSFR").
+constexpr quint32 kRecordMagic = 0x52465353u;
+//! \brief Версия формата (версия 1 — без полей кодирования, только kEncodingFloat32).
+constexpr quint32 kVersion = 2;
+
+//! \brief Значения кадра хранятся как float.
+constexpr quint32 kEncodingFloat32 = 0;
+//! \brief Значения кадра сжаты SpectrumCodec.
+constexpr quint32 kEncodingSpectrumCodec = 1;
+
+//! \brief Размер области заголовка файла (одна страница памяти).
+constexpr qint64 kFileHeaderBytes = 4096;
+//! \brief Размер области заголовка чанка.
+constexpr qint64 kChunkHeaderBytes = 64;
+//! \brief Выравнивание записей внутри чанка.
+constexpr qint64 kRecordAlignment = 16;
+//! \brief Шаг разреженного индекса, записи.
+constexpr int kIndexStride = 32;
+
+//! \brief Расширение файла записи.
+constexpr const char kRecordingSuffix[] = "ssr";
+//! \brief Расширение файла индекса.
+constexpr const char kIndexSuffix[] = "ssi";
+
+//! \brief Заголовок файла записи.
+struct FileHeader
+{
+    //! \brief Сигнатура kFileMagic.
+    quint32 magic;
+    //! \brief Версия формата.
+    quint32 version;
+    //! \brief Размер чанка, байты.
+    qint64 chunkBytes;
+    //! \brief Время создания файла, мкс от начала эпохи.
+    qint64 createdUs;
+    //! \brief Номер файла в серии записи.
+    quint32 fileIndex;
+    //! \brief Количество начатых чанков.
+    quint32 chunkCount;
+    //! \brief Признак штатного закрытия файла.
+    quint32 closed;
+    //! \brief Резерв.
+    quint32 reserved;
+    //! \brief Кодирование значений (kEncodingFloat32 или kEncodingSpectrumCodec).
+    quint32 encoding;
+    //! \brief Шаг квантования кодека, дБ.
+    float stepDb;
+    //! \brief Уровень кода 0 кодека, дБ.
+    float floorDb;
+};
+
+//! \brief Заголовок чанка.
+struct ChunkHeader
+{
+    //! \brief Сигнатура kChunkMagic.
+    quint32 magic;
+    //! \brief Номер чанка в файле.
+    quint32 chunkIndex;
+    //! \brief Время первой записи чанка, мкс.
+    qint64 firstTimestampUs;
+    //! \brief Время последней записи чанка, мкс.
+    qint64 lastTimestampUs;
+    //! \brief Номер кадра первой записи чанка.
+    quint64 firstSequence;
+    //! \brief Занятые байты чанка, включая заголовок.
+    qint64 usedBytes;
+    //! \brief Количество записей.
+    quint32 recordCount;
+    //! \brief Признак запечатанного (сброшенного на диск) чанка.
+    quint32 sealed;
+    //! \brief Резерв.
+    quint64 reserved;
+};
+
+//! \brief Заголовок записи кадра.
+struct RecordHeader
+{
+    //! \brief Сигнатура kRecordMagic (записывается последней).
+    quint32 magic;
+    //! \brief Количество значений спектра.
+    quint32 binCount;
+    //! \brief Порядковый номер кадра.
+    quint64 sequence;
+    //! \brief Время формирования кадра, мкс от начала эпохи.
+    qint64 timestampUs;
+    //! \brief Нижняя граница диапазона кадра, Гц.
+    double viewMinHz;
+    //! \brief Верхняя граница диапазона кадра, Гц.
+    double viewMaxHz;
+    //! \brief Нижняя граница шкалы, дБ.
+    float minDb;
+    //! \brief Верхняя граница шкалы, дБ.
+    float maxDb;
+};
+
+//! \brief Заголовок сжатых данных кадра.
+struct CodedRecordHeader
+{
+    //! \brief Размер потока SpectrumCodec, байты.
+    quint32 codedBytes;
+    //! \brief Расстояние от ключевого кадра чанка до этой записи, байты (0 — запись ключевая).
+    quint32 keyOffset;
+    //! \brief Резерв.
+    quint64 reserved;
+};
+
+//! \brief Элемент разреженного индекса.
+struct IndexEntry
+{
+    //! \brief Время формирования кадра, мкс от начала эпохи.
+    qint64 timestampUs;
+    //! \brief Порядковый номер кадра.
+    quint64 sequence;
+    //! \brief Смещение записи от начала файла, байты.
+    qint64 offset;
+};
+
+static_assert(sizeof(FileHeader) <= kFileHeaderBytes, "FileHeader does not fit its area");
+static_assert(sizeof(ChunkHeader) <= kChunkHeaderBytes, "ChunkHeader does not fit its area");
+static_assert(sizeof(RecordHeader) % kRecordAlignment == 0, "RecordHeader breaks payload alignment");
+static_assert(sizeof(CodedRecordHeader) % kRecordAlignment == 0, "CodedRecordHeader breaks payload alignment");
+static_assert(std::is_trivially_copyable_v<FileHeader> && std::is_trivially_copyable_v<ChunkHeader>
+                  && std::is_trivially_copyable_v<RecordHeader> && std::is_trivially_copyable_v<CodedRecordHeader>
+                  && std::is_trivially_copyable_v<IndexEntry>,
+              "Recording structures must be trivially copyable");
+
+/*!
+ *  \brief Возвращает размер записи кадра с выравниванием.
+ *  \param[in] binCount Количество значений спектра.
+ *  \return Размер, байты.
+ */
+constexpr qint64 recordBytes(qint64 binCount) noexcept
+{
+    const qint64 bytes = static_cast<qint64>(sizeof(RecordHeader)) + binCount * static_cast<qint64>(sizeof(float));
+    return (bytes + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+/*!
+ *  \brief Возвращает размер сжатой записи кадра с выравниванием.
+ *  \param[in] codedBytes Размер потока SpectrumCodec, байты.
+ *  \return Размер, байты.
+ */
+constexpr qint64 codedRecordBytes(qint64 codedBytes) noexcept
+{
+    const qint64 bytes
+        = static_cast<qint64>(sizeof(RecordHeader)) + static_cast<qint64>(sizeof(CodedRecordHeader)) + codedBytes;
+    return (bytes + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+}
+
+/*!
+ *  \brief Возвращает смещение чанка от начала файла.
+ *  \param[in] chunkIndex Номер чанка.
+ *  \param[in] chunkBytes Размер чанка, байты.
+ *  \return Смещение, байты.
+ */
+constexpr qint64 chunkOffset(qint64 chunkIndex, qint64 chunkBytes) noexcept
+{
+    return kFileHeaderBytes + chunkIndex * chunkBytes;
+}
+
+} // namespace RecordingFormat
+
+#endif // RECORDINGFORMAT_H
@@ -0,0 +1,391 @@
+/*!
+ *  \file recordingmanager.cpp
+ *  \brief Реализация RecordingManager.
+ */
+#include "recordingmanager.h"
+
+#include "recordingformat.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QtGlobal>
+
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#elif defined(Q_OS_WIN)
+#include <qt_windows.h>
+#endif
+
+using namespace RecordingFormat;
+
+namespace {
+
+//! \brief Период проверки запроса остановки при пустой очереди, мс.
+constexpr int kWakeIntervalMs = 50;
+//! \brief Гранулярность размера чанка, байты.
+constexpr qint64 kChunkGranularity = qint64(1) << 20;
+//! \brief Минимальный размер чанка, байты.
+constexpr qint64 kMinChunkBytes = qint64(4) << 20;
+
+/*!
+ *  \brief Синхронно сбрасывает на диск отображенную область файла.
+ *  \param[in] data Начало отображения (выровнено по странице).
+ *  \param[in] size Размер области, байты.
+ */
+void flushMapping(uchar *data, qint64 size)
+{
+#if defined(Q_OS_UNIX)
+    ::msync(data, static_cast<size_t>(size), MS_SYNC);
+#elif defined(Q_OS_WIN)
+    ::FlushViewOfFile(data, static_cast<SIZE_T>(size));
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+#endif
+}
+
+} // namespace
+
+/*!
+ *  \brief Конструирует менеджер записи.
+ *  \param[in] parent Родительский объект.
+ */
+RecordingManager::RecordingManager(QObject *parent)
+    : QThread(parent)
+{
+    setObjectName(QStringLiteral("RecordingManager"));
+}
+
+//! \brief Останавливает запись и дожидается завершения потока.
+RecordingManager::~RecordingManager()
+{
+    stopRecording();
+    wait();
+}
+
+/*!
+ *  \brief Начинает новую серию записи.
+ *  \param[in] settings Параметры записи.
+ *  \return false, если каталог недоступен.
+ */
+bool RecordingManager::startRecording(const Settings &settings)
+{
+    // Поток записи переиспользуется: прошлая серия должна быть закрыта.
+    stopRecording();
+    wait();
+
+    if (settings.directory.isEmpty() || !QDir().mkpath(settings.directory)) {
+        return false;
+    }
+
+    m_settings = settings;
+    m_settings.chunkBytes = qMax(kMinChunkBytes, (settings.chunkBytes + kChunkGranularity - 1)
+                                                     / kChunkGranularity * kChunkGranularity);
+    m_settings.maxFileBytes = qMax(settings.maxFileBytes, chunkOffset(2, m_settings.chunkBytes));
+    m_codec = SpectrumCodec(settings.codec);
+
+    // Кадры, попавшие в очередь после прошлой остановки, к новой серии не относятся.
+    SpectrumFrame stale;
+    while (m_available.tryAcquire()) {
+        m_queue.tryPop(stale);
+    }
+
+    m_seriesName = QDateTime::currentDateTime().toString(QStringLiteral("'spectrum_'yyyyMMdd_HHmmss"));
+    m_fileIndex = 0;
+    m_writtenFrames.store(0, std::memory_order_relaxed);
+    m_droppedFrames.store(0, std::memory_order_relaxed);
+    m_writtenBytes.store(0, std::memory_order_relaxed);
+
+    m_active.store(true, std::memory_order_release);
+    start();
+    return true;
+}
+
+//! \brief Прекращает прием кадров; поток записи дописывает очередь и закрывает файл.
+void RecordingManager::stopRecording()
+{
+    m_active.store(false, std::memory_order_release);
+    if (isRunning()) {
+        requestInterruption();
+    }
+}
+
+/*!
+ *  \brief Передает кадр на запись без блокировки.
+ *  \param[in] frame Кадр спектра.
+ *  \return false, если запись не ведется или очередь заполнена.
+ */
+bool RecordingManager::submit(const SpectrumFrame &frame)
+{
+    if (!m_active.load(std::memory_order_acquire) || !frame.isValid()) {
+        return false;
+    }
+    if (!m_queue.tryPush(frame)) {
+        m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    m_available.release();
+    return true;
+}
+
+//! \brief Записывает кадры из очереди до запроса остановки и опустошения очереди.
+void RecordingManager::run()
+{
+    if (openFile()) {
+        for (;;) {
+            if (m_available.tryAcquire(1, kWakeIntervalMs)) {
+                SpectrumFrame frame;
+                if (m_queue.tryPop(frame) && !writeFrame(frame)) {
+                    break;
+                }
+                continue;
+            }
+            if (isInterruptionRequested()) {
+                break;
+            }
+        }
+    }
+
+    closeFile();
+    emit recordingStopped();
+}
+
+//! \brief Открывает следующий файл серии и его индекс.
+bool RecordingManager::openFile()
+{
+    const QString base = QDir(m_settings.directory)
+                             .filePath(QStringLiteral("%1_%2").arg(m_seriesName).arg(m_fileIndex, 3, 10, QLatin1Char('0')));
+
+    m_file.setFileName(base + QLatin1Char('.') + QLatin1String(kRecordingSuffix));
+    m_index.setFileName(base + QLatin1Char('.') + QLatin1String(kIndexSuffix));
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)
+        || !m_index.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        fail(tr("Не удалось создать файл записи %1").arg(m_file.fileName()));
+        return false;
+    }
+
+    m_allocatedBytes = 0;
+    m_header = preallocate(kFileHeaderBytes) ? m_file.map(0, kFileHeaderBytes) : nullptr;
+    if (!m_header) {
+        fail(tr("Не удалось отобразить файл записи %1").arg(m_file.fileName()));
+        return false;
+    }
+
+    FileHeader header{};
+    header.magic = kFileMagic;
+    header.version = kVersion;
+    header.chunkBytes = m_settings.chunkBytes;
+    header.createdUs = QDateTime::currentMSecsSinceEpoch() * 1000;
+    header.fileIndex = static_cast<quint32>(m_fileIndex);
+    header.encoding = m_settings.compressed ? kEncodingSpectrumCodec : kEncodingFloat32;
+    header.stepDb = m_codec.settings().stepDb;
+    header.floorDb = m_codec.settings().floorDb;
+    std::memcpy(m_header, &header, sizeof(header));
+
+    m_fileRecords = 0;
+    if (!beginChunk(0)) {
+        return false;
+    }
+
+    emit fileOpened(m_file.fileName());
+    return true;
+}
+
+//! \brief Запечатывает текущий чанк, освобождает лишнее место и закрывает файл.
+void RecordingManager::closeFile()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+
+    sealChunk();
+    if (m_chunkIndex >= 0) {
+        // Место под следующий чанк выделено заранее, но не использовано.
+        m_file.resize(chunkOffset(m_chunkIndex + 1, m_settings.chunkBytes));
+    }
+    if (m_header) {
+        reinterpret_cast<FileHeader *>(m_header)->closed = 1;
+        flushMapping(m_header, kFileHeaderBytes);
+        m_file.unmap(m_header);
+        m_header = nullptr;
+    }
+
+    m_index.close();
+    m_file.close();
+    m_chunkIndex = -1;
+    m_chunkUsed = 0;
+    m_allocatedBytes = 0;
+}
+
+/*!
+ *  \brief Отображает чанк в память и заранее выделяет место под следующий.
+ *  \param[in] chunkIndex Номер чанка.
+ */
+bool RecordingManager::beginChunk(int chunkIndex)
+{
+    const qint64 chunkBytes = m_settings.chunkBytes;
+    const qint64 offset = chunkOffset(chunkIndex, chunkBytes);
+
+    // Следующий чанк выделяется сейчас, чтобы переход к нему не ждал файловой системы.
+    qint64 allocate = offset + chunkBytes;
+    if (chunkOffset(chunkIndex + 2, chunkBytes) <= m_settings.maxFileBytes) {
+        allocate += chunkBytes;
+    }
+    m_chunk = preallocate(allocate) ? m_file.map(offset, chunkBytes) : nullptr;
+    if (!m_chunk) {
+        fail(tr("Не удалось выделить место в файле записи %1").arg(m_file.fileName()));
+        return false;
+    }
+
+    ChunkHeader header{};
+    header.magic = kChunkMagic;
+    header.chunkIndex = static_cast<quint32>(chunkIndex);
+    header.usedBytes = kChunkHeaderBytes;
+    std::memcpy(m_chunk, &header, sizeof(header));
+
+    m_chunkIndex = chunkIndex;
+    m_chunkUsed = kChunkHeaderBytes;
+    reinterpret_cast<FileHeader *>(m_header)->chunkCount = static_cast<quint32>(chunkIndex + 1);
+    return true;
+}
+
+//! \brief Помечает текущий чанк запечатанным, сбрасывает его на диск и снимает отображение.
+void RecordingManager::sealChunk()
+{
+    if (!m_chunk) {
+        return;
+    }
+
+    // Признак запечатывания попадает на диск только после данных чанка.
+    flushMapping(m_chunk, m_chunkUsed);
+    reinterpret_cast<ChunkHeader *>(m_chunk)->sealed = 1;
+    flushMapping(m_chunk, kChunkHeaderBytes);
+
+    m_file.unmap(m_chunk);
+    m_chunk = nullptr;
+    m_index.flush();
+}
+
+/*!
+ *  \brief Записывает кадр, при необходимости переходя к следующему чанку или файлу.
+ *  \param[in] frame Кадр спектра.
+ *  \return false, если запись прервана ошибкой.
+ */
+bool RecordingManager::writeFrame(const SpectrumFrame &frame)
+{
+    const qint64 chunkBytes = m_settings.chunkBytes;
+    const int binCount = frame.binCount();
+    // Сжатому кадру резервируется наибольший размер потока, занимается фактический.
+    qint64 bytes = m_settings.compressed ? codedRecordBytes(SpectrumCodec::maxEncodedBytes(binCount))
+                                         : recordBytes(binCount);
+    if (bytes > chunkBytes - kChunkHeaderBytes) {
+        m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (m_chunkUsed + bytes > chunkBytes) {
+        sealChunk();
+        if (chunkOffset(m_chunkIndex + 2, chunkBytes) > m_settings.maxFileBytes) {
+            closeFile();
+            ++m_fileIndex;
+            if (!openFile()) {
+                return false;
+            }
+        } else if (!beginChunk(m_chunkIndex + 1)) {
+            return false;
+        }
+    }
+
+    uchar *record = m_chunk + m_chunkUsed;
+    if (m_settings.compressed) {
+        // Ключевой кадр в начале чанка: чанк декодируется без предыдущих.
+        uchar *stream = record + sizeof(RecordHeader) + sizeof(CodedRecordHeader);
+        const qint64 codedBytes = m_codec.encode(frame.constBins(), binCount, stream,
+                                                 m_chunkUsed == kChunkHeaderBytes);
+        if (SpectrumCodec::isKeyFrame(stream, codedBytes)) {
+            m_keyRecordOffset = m_chunkUsed;
+        }
+        CodedRecordHeader codedHeader{};
+        codedHeader.codedBytes = static_cast<quint32>(codedBytes);
+        codedHeader.keyOffset = static_cast<quint32>(m_chunkUsed - m_keyRecordOffset);
+        std::memcpy(record + sizeof(RecordHeader), &codedHeader, sizeof(codedHeader));
+        bytes = codedRecordBytes(codedBytes);
+    } else {
+        std::memcpy(record + sizeof(RecordHeader), frame.constBins(), static_cast<size_t>(binCount) * sizeof(float));
+    }
+
+    RecordHeader header{};
+    header.binCount = static_cast<quint32>(binCount);
+    header.sequence = frame.sequence();
+    header.timestampUs = frame.timestampUs();
+    header.viewMinHz = frame.viewMinHz();
+    header.viewMaxHz = frame.viewMaxHz();
+    header.minDb = frame.minDb();
+    header.maxDb = frame.maxDb();
+    std::memcpy(record, &header, sizeof(header));
+    // Сигнатура записывается последней: читатель открытого файла не увидит
+    // запись, значения которой еще не скопированы.
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(record, &kRecordMagic, sizeof(kRecordMagic));
+
+    auto *chunkHeader = reinterpret_cast<ChunkHeader *>(m_chunk);
+    if (chunkHeader->recordCount == 0) {
+        chunkHeader->firstTimestampUs = header.timestampUs;
+        chunkHeader->firstSequence = header.sequence;
+    }
+    chunkHeader->lastTimestampUs = header.timestampUs;
+    ++chunkHeader->recordCount;
+    chunkHeader->usedBytes = m_chunkUsed + bytes;
+
+    if (chunkHeader->recordCount == 1 || m_fileRecords % kIndexStride == 0) {
+        const IndexEntry entry{header.timestampUs, header.sequence,
+                               chunkOffset(m_chunkIndex, chunkBytes) + m_chunkUsed};
+        if (m_index.write(reinterpret_cast<const char *>(&entry), sizeof(entry)) != sizeof(entry)) {
+            fail(tr("Ошибка записи индекса %1").arg(m_index.fileName()));
+            return false;
+        }
+    }
+
+    m_chunkUsed += bytes;
+    ++m_fileRecords;
+    m_writtenFrames.fetch_add(1, std::memory_order_relaxed);
+    m_writtenBytes.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+}
+
+/*!
+ *  \brief Выделяет место в файле до заданного размера.
+ *  \param[in] size Требуемый размер файла, байты.
+ *  \return false, если место выделить не удалось.
+ */
+bool RecordingManager::preallocate(qint64 size)
+{
+    if (size <= m_allocatedBytes) {
+        return true;
+    }
+
+#if defined(Q_OS_LINUX)
+    // Резервирует блоки на диске, а не только увеличивает размер файла.
+    if (::posix_fallocate(m_file.handle(), m_allocatedBytes, size - m_allocatedBytes) != 0) {
+        return false;
+    }
+#endif
+    if (!m_file.resize(size)) {
+        return false;
+    }
+    m_allocatedBytes = size;
+    return true;
+}
+
+/*!
+ *  \brief Сообщает об ошибке и прекращает прием кадров.
+ *  \param[in] message Описание ошибки.
+ */
+void RecordingManager::fail(const QString &message)
+{
+    m_active.store(false, std::memory_order_release);
+    emit errorOccurred(message);
+}
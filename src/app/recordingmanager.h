@@ -0,0 +1,191 @@
+/*!
+ *  \file recordingmanager.h
+ *  \brief Поток записи кадров спектра в файлы, отображаемые в память.
+ */
+#ifndef RECORDINGMANAGER_H
+#define RECORDINGMANAGER_H
+
+#include <QFile>
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+
+#include "spectrumcodec.h"
+#include "spectrumframe.h"
+#include "spscqueue.h"
+
+/*!
+ *  \class RecordingManager
+ *  \brief Записывает кадры спектра в собственном потоке в формате recordingformat.h.
+ *
+ *  Поток DSP передает кадры через submit(): кадр без копирования значений
+ *  помещается в lock-free очередь, а при ее переполнении отбрасывается и
+ *  учитывается в droppedFrames(), поэтому DSP никогда не ждет диска.
+ *
+ *  Поток записи копирует значения в отображенный в память чанк файла. Место
+ *  под следующий чанк выделяется заранее; заполненный чанк запечатывается и
+ *  синхронно сбрасывается на диск, поэтому при аварии теряется не больше
+ *  текущего чанка. При достижении maxFileBytes запись продолжается в
+ *  следующий файл серии.
+ *
+ *  Остановка не блокирует поток UI: stopRecording() только прекращает прием
+ *  кадров, а поток записи дописывает очередь, запечатывает чанк и испускает
+ *  recordingStopped().
+ *
+ *  По умолчанию значения сжимаются SpectrumCodec прямо в отображенный чанк
+ *  (место резервируется по наибольшему размеру потока кадра); первый кадр
+ *  каждого чанка кодируется ключевым.
+ */
+class RecordingManager : public QThread
+{
+    Q_OBJECT
+
+public:
+    //! \brief Параметры записи.
+    struct Settings
+    {
+        //! \brief Каталог файлов записи.
+        QString directory;
+        //! \brief Размер чанка, байты (округляется до 1 МиБ, не меньше 4 МиБ).
+        qint64 chunkBytes = qint64(64) << 20;
+        //! \brief Предельный размер одного файла, байты (не меньше двух чанков).
+        qint64 maxFileBytes = qint64(2) << 30;
+        //! \brief Сжимать значения SpectrumCodec (иначе они хранятся как float).
+        bool compressed = true;
+        //! \brief Параметры сжатия.
+        SpectrumCodec::Settings codec;
+    };
+
+    //! \brief Емкость очереди кадров между DSP и потоком записи.
+    static constexpr int kQueueCapacity = 128;
+
+    /*!
+     *  \brief Конструирует менеджер записи.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit RecordingManager(QObject *parent = nullptr);
+    //! \brief Останавливает запись и дожидается завершения потока.
+    ~RecordingManager() override;
+
+    /*!
+     *  \brief Начинает новую серию записи (поток UI).
+     *
+     *  Если предыдущая серия еще дописывается, дожидается ее закрытия.
+     *  \param[in] settings Параметры записи.
+     *  \return false, если каталог недоступен.
+     */
+    bool startRecording(const Settings &settings);
+    /*!
+     *  \brief Прекращает прием кадров без ожидания (поток UI).
+     *
+     *  Кадры, оставшиеся в очереди, дописываются и файл закрывается в потоке
+     *  записи, после чего испускается recordingStopped().
+     */
+    void stopRecording();
+    //! \brief Проверяет, принимаются ли кадры к записи.
+    bool isRecording() const noexcept { return m_active.load(std::memory_order_acquire); }
+
+    /*!
+     *  \brief Передает кадр на запись без блокировки (один поток-писатель, обычно DSP).
+     *  \param[in] frame Кадр спектра.
+     *  \return false, если запись не ведется или очередь заполнена.
+     */
+    bool submit(const SpectrumFrame &frame);
+
+    //! \brief Возвращает число записанных кадров текущей серии.
+    quint64 writtenFrames() const noexcept { return m_writtenFrames.load(std::memory_order_relaxed); }
+    //! \brief Возвращает число кадров, отброшенных из-за переполнения очереди или размера.
+    quint64 droppedFrames() const noexcept { return m_droppedFrames.load(std::memory_order_relaxed); }
+    //! \brief Возвращает объем записанных данных текущей серии, байты.
+    qint64 writtenBytes() const noexcept { return m_writtenBytes.load(std::memory_order_relaxed); }
+
+signals:
+    /*!
+     *  \brief Сигнал об открытии очередного файла серии.
+     *  \param[in] path Путь к файлу записи.
+     */
+    void fileOpened(const QString &path);
+    /*!
+     *  \brief Сигнал об ошибке, прервавшей запись.
+     *  \param[in] message Описание ошибки.
+     */
+    void errorOccurred(const QString &message);
+    //! \brief Сигнал о закрытии файла серии после остановки или ошибки (из потока записи).
+    void recordingStopped();
+
+protected:
+    //! \brief Цикл записи кадров из очереди.
+    void run() override;
+
+private:
+    //! \brief Открывает следующий файл серии и его индекс.
+    bool openFile();
+    //! \brief Запечатывает текущий чанк, освобождает лишнее место и закрывает файл.
+    void closeFile();
+    /*!
+     *  \brief Отображает чанк в память и заранее выделяет место под следующий.
+     *  \param[in] chunkIndex Номер чанка.
+     */
+    bool beginChunk(int chunkIndex);
+    //! \brief Помечает текущий чанк запечатанным, сбрасывает его на диск и снимает отображение.
+    void sealChunk();
+    /*!
+     *  \brief Записывает кадр, при необходимости переходя к следующему чанку или файлу.
+     *  \param[in] frame Кадр спектра.
+     */
+    bool writeFrame(const SpectrumFrame &frame);
+    /*!
+     *  \brief Выделяет место в файле до заданного размера.
+     *  \param[in] size Требуемый размер файла, байты.
+     */
+    bool preallocate(qint64 size);
+    /*!
+     *  \brief Сообщает об ошибке и прекращает прием кадров.
+     *  \param[in] message Описание ошибки.
+     */
+    void fail(const QString &message);
+
+    //! \brief Очередь кадров (DSP -> поток записи).
+    SpscQueue<SpectrumFrame, kQueueCapacity> m_queue;
+    //! \brief Число кадров в очереди для пробуждения потока записи.
+    QSemaphore m_available;
+    //! \brief Признак приема кадров.
+    std::atomic<bool> m_active{false};
+    //! \brief Записанные кадры.
+    std::atomic<quint64> m_writtenFrames{0};
+    //! \brief Отброшенные кадры.
+    std::atomic<quint64> m_droppedFrames{0};
+    //! \brief Записанные байты.
+    std::atomic<qint64> m_writtenBytes{0};
+
+    //! \brief Параметры серии (поток записи после старта).
+    Settings m_settings;
+    //! \brief Метка серии в именах файлов.
+    QString m_seriesName;
+    //! \brief Номер текущего файла серии.
+    int m_fileIndex = 0;
+    //! \brief Файл записи.
+    QFile m_file;
+    //! \brief Файл разреженного индекса.
+    QFile m_index;
+    //! \brief Отображение заголовка файла.
+    uchar *m_header = nullptr;
+    //! \brief Отображение текущего чанка.
+    uchar *m_chunk = nullptr;
+    //! \brief Номер текущего чанка.
+    int m_chunkIndex = -1;
+    //! \brief Занятые байты текущего чанка.
+    qint64 m_chunkUsed = 0;
+    //! \brief Выделенный размер файла, байты.
+    qint64 m_allocatedBytes = 0;
+    //! \brief Записи текущего файла.
+    quint64 m_fileRecords = 0;
+    //! \brief Кодек сжатия серии (поток записи после старта).
+    SpectrumCodec m_codec;
+    //! \brief Смещение последней ключевой записи от начала текущего чанка, байты.
+    qint64 m_keyRecordOffset = 0;
+};
+
+#endif // RECORDINGMANAGER_H
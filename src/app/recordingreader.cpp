@@ -0,0 +1,397 @@
+/*!
+ *  \file recordingreader.cpp
+ *  \brief Реализация RecordingReader.
+ */
+#include "recordingreader.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFileInfo>
+#include <QStringList>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace RecordingFormat;
+
+//! \brief Конструирует закрытый читатель.
+RecordingReader::RecordingReader() = default;
+
+//! \brief Снимает отображения файлов.
+RecordingReader::~RecordingReader()
+{
+    close();
+}
+
+/*!
+ *  \brief Открывает серию, к которой относится файл записи.
+ *
+ *  Файлы серии отличаются только номером после последнего символа '_'
+ *  (см. RecordingManager) и открываются в порядке номеров.
+ *
+ *  \param[in] path Путь к любому файлу серии.
+ *  \return false, если ни один файл серии не удалось прочитать.
+ */
+bool RecordingReader::open(const QString &path)
+{
+    close();
+
+    const QFileInfo info(path);
+    const QString name = info.completeBaseName();
+    const int separator = name.lastIndexOf(QLatin1Char('_'));
+
+    QStringList paths;
+    if (separator > 0) {
+        const QDir dir = info.dir();
+        const QString filter = name.left(separator + 1) + QStringLiteral("???.") + QLatin1String(kRecordingSuffix);
+        const QStringList names = dir.entryList(QStringList{filter}, QDir::Files, QDir::Name);
+        for (const QString &fileName : names) {
+            paths.append(dir.filePath(fileName));
+        }
+    }
+    if (paths.isEmpty()) {
+        paths.append(path);
+    }
+
+    for (const QString &filePath : std::as_const(paths)) {
+        addFile(filePath);
+    }
+
+    // Метки времени монотонны внутри серии; переупорядочивание нужно только
+    // при переводе системных часов во время записи.
+    if (!std::is_sorted(m_index.begin(), m_index.end(), [](const IndexEntry &a, const IndexEntry &b) {
+            return a.timestampUs < b.timestampUs;
+        })) {
+        std::stable_sort(m_index.begin(), m_index.end(), [](const IndexEntry &a, const IndexEntry &b) {
+            return a.timestampUs < b.timestampUs;
+        });
+    }
+    return isOpen();
+}
+
+//! \brief Закрывает серию и снимает отображения.
+void RecordingReader::close()
+{
+    for (File &file : m_files) {
+        file.file->unmap(const_cast<uchar *>(file.data));
+    }
+    m_files.clear();
+    m_index.clear();
+    m_frameCount = 0;
+    m_lastTimestampUs = 0;
+}
+
+//! \brief Возвращает время первого кадра, мкс от начала эпохи.
+qint64 RecordingReader::firstTimestampUs() const noexcept
+{
+    return m_index.empty() ? 0 : m_index.front().timestampUs;
+}
+
+//! \brief Возвращает положение первого кадра серии.
+RecordingReader::Position RecordingReader::first() const noexcept
+{
+    return firstFrom(0, 0);
+}
+
+/*!
+ *  \brief Находит последний кадр, сформированный не позже заданного времени.
+ *  \param[in] timestampUs Время, мкс от начала эпохи.
+ *  \return Положение кадра.
+ */
+RecordingReader::Position RecordingReader::seek(qint64 timestampUs) const
+{
+    if (m_index.empty()) {
+        return {};
+    }
+
+    const auto it = std::upper_bound(m_index.begin(), m_index.end(), timestampUs,
+                                     [](qint64 value, const IndexEntry &entry) { return value < entry.timestampUs; });
+    if (it == m_index.begin()) {
+        return it->position;
+    }
+
+    // От элемента индекса до искомого кадра не больше kIndexStride записей.
+    Position position = std::prev(it)->position;
+    for (;;) {
+        const Position following = next(position);
+        const RecordHeader *header = recordHeader(following);
+        if (!header || header->timestampUs > timestampUs) {
+            return position;
+        }
+        position = following;
+    }
+}
+
+/*!
+ *  \brief Возвращает положение кадра, следующего за заданным.
+ *  \param[in] position Положение кадра.
+ *  \return Положение следующего кадра или недействительное за концом серии.
+ */
+RecordingReader::Position RecordingReader::next(const Position &position) const
+{
+    const RecordHeader *header = recordHeader(position);
+    if (!header) {
+        return {};
+    }
+
+    const File &file = m_files[static_cast<size_t>(position.file)];
+    const Position following{position.file, position.offset + recordSize(file, header)};
+    if (recordHeader(following)) {
+        return following;
+    }
+
+    // Хвост чанка, в который не поместилась следующая запись, не используется.
+    const int chunk = static_cast<int>((position.offset - kFileHeaderBytes) / file.chunkBytes);
+    return firstFrom(position.file, chunk + 1);
+}
+
+/*!
+ *  \brief Возвращает запись кадра без копирования.
+ *  \param[in] position Положение кадра.
+ *  \param[out] record Запись кадра.
+ *  \return false, если в заданном положении нет целой записи.
+ */
+bool RecordingReader::record(const Position &position, Record &record) const
+{
+    const RecordHeader *header = recordHeader(position);
+    if (!header) {
+        return false;
+    }
+    record.header = header;
+    const uchar *payload = reinterpret_cast<const uchar *>(header) + sizeof(RecordHeader);
+    if (m_files[static_cast<size_t>(position.file)].encoding == kEncodingSpectrumCodec) {
+        record.bins = nullptr;
+        record.coded = payload + sizeof(CodedRecordHeader);
+        record.codedBytes = reinterpret_cast<const CodedRecordHeader *>(payload)->codedBytes;
+    } else {
+        record.bins = reinterpret_cast<const float *>(payload);
+        record.coded = nullptr;
+        record.codedBytes = 0;
+    }
+    return true;
+}
+
+/*!
+ *  \brief Возвращает положение ключевого кадра, с которого декодируется заданный.
+ *  \param[in] position Положение кадра.
+ *  \return Положение ключевого кадра или недействительное.
+ */
+RecordingReader::Position RecordingReader::keyFrame(const Position &position) const
+{
+    const RecordHeader *header = recordHeader(position);
+    if (!header) {
+        return {};
+    }
+    if (m_files[static_cast<size_t>(position.file)].encoding != kEncodingSpectrumCodec) {
+        return position;
+    }
+
+    // Ключевой кадр находится в том же чанке (первая запись чанка всегда ключевая).
+    const auto *coded = reinterpret_cast<const CodedRecordHeader *>(header + 1);
+    const Position key{position.file, position.offset - static_cast<qint64>(coded->keyOffset)};
+    return recordHeader(key) ? key : Position{};
+}
+
+/*!
+ *  \brief Возвращает параметры кодека файла, к которому относится кадр.
+ *  \param[in] position Положение кадра.
+ */
+SpectrumCodec::Settings RecordingReader::codecSettings(const Position &position) const
+{
+    if (position.file < 0 || position.file >= static_cast<int>(m_files.size())) {
+        return {};
+    }
+    return m_files[static_cast<size_t>(position.file)].codec;
+}
+
+/*!
+ *  \brief Просит систему заранее подгрузить страницы после заданного кадра.
+ *  \param[in] position Положение кадра.
+ *  \param[in] bytes Объем упреждающего чтения, байты.
+ */
+void RecordingReader::prefetch(const Position &position, qint64 bytes) const
+{
+#if defined(Q_OS_UNIX)
+    if (!position.isValid() || position.file >= static_cast<int>(m_files.size())) {
+        return;
+    }
+    static const qint64 pageBytes = ::sysconf(_SC_PAGESIZE);
+    const File &file = m_files[static_cast<size_t>(position.file)];
+    const qint64 begin = position.offset / pageBytes * pageBytes;
+    const qint64 end = qMin(file.size, position.offset + bytes);
+    if (end > begin) {
+        // Чтение выполняет ядро в фоне; вызов не ждет диска.
+        ::madvise(const_cast<uchar *>(file.data + begin), static_cast<size_t>(end - begin), MADV_WILLNEED);
+    }
+#else
+    Q_UNUSED(position);
+    Q_UNUSED(bytes);
+#endif
+}
+
+/*!
+ *  \brief Отображает файл серии и дополняет объединенный индекс.
+ *  \param[in] path Путь к файлу записи.
+ *  \return false, если файл не является файлом записи.
+ */
+bool RecordingReader::addFile(const QString &path)
+{
+    File file;
+    file.file = std::make_unique<QFile>(path);
+    if (!file.file->open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    file.size = file.file->size();
+    if (file.size < kFileHeaderBytes) {
+        return false;
+    }
+    file.data = file.file->map(0, file.size);
+    if (!file.data) {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(&header, file.data, sizeof(header));
+    // Файлы версии 1 не содержат полей кодирования: их область заголовка заполнена нулями.
+    if (header.magic != kFileMagic || header.version == 0 || header.version > kVersion
+        || header.chunkBytes < kChunkHeaderBytes + recordBytes(0)
+        || (header.encoding != kEncodingFloat32 && header.encoding != kEncodingSpectrumCodec)) {
+        file.file->unmap(const_cast<uchar *>(file.data));
+        return false;
+    }
+    file.chunkBytes = header.chunkBytes;
+    file.encoding = header.encoding;
+    file.codec.stepDb = header.stepDb;
+    file.codec.floorDb = header.floorDb;
+    // Чанк, место под который выделяется прямо сейчас, может не попасть в отображение.
+    file.chunkCount = static_cast<int>(qMin<qint64>(header.chunkCount, (file.size - kFileHeaderBytes) / file.chunkBytes));
+
+    const int fileNumber = static_cast<int>(m_files.size());
+    m_files.push_back(std::move(file));
+    const File &mapped = m_files.back();
+
+    for (int chunk = 0; chunk < mapped.chunkCount; ++chunk) {
+        ChunkHeader chunkHeader;
+        std::memcpy(&chunkHeader, mapped.data + chunkOffset(chunk, mapped.chunkBytes), sizeof(chunkHeader));
+        if (chunkHeader.magic == kChunkMagic && chunkHeader.recordCount > 0) {
+            m_frameCount += chunkHeader.recordCount;
+            m_lastTimestampUs = qMax(m_lastTimestampUs, chunkHeader.lastTimestampUs);
+        }
+    }
+
+    const size_t indexStart = m_index.size();
+    if (header.closed) {
+        QFile indexFile(QFileInfo(path).dir().filePath(QFileInfo(path).completeBaseName() + QLatin1Char('.')
+                                                       + QLatin1String(kIndexSuffix)));
+        if (indexFile.open(QIODevice::ReadOnly)) {
+            const QByteArray bytes = indexFile.readAll();
+            const qsizetype count = bytes.size() / static_cast<qsizetype>(sizeof(RecordingFormat::IndexEntry));
+            for (qsizetype i = 0; i < count; ++i) {
+                RecordingFormat::IndexEntry entry;
+                std::memcpy(&entry, bytes.constData() + i * sizeof(entry), sizeof(entry));
+                const Position position{fileNumber, entry.offset};
+                if (recordHeader(position)) {
+                    m_index.push_back({entry.timestampUs, position});
+                }
+            }
+        }
+    }
+
+    if (m_index.size() == indexStart) {
+        // Файл закрыт нештатно или индекс утерян: восстанавливаем индекс
+        // с тем же шагом, переходя только по заголовкам записей.
+        qint64 recordNumber = 0;
+        for (int chunk = 0; chunk < mapped.chunkCount; ++chunk) {
+            Position position{fileNumber, chunkOffset(chunk, mapped.chunkBytes) + kChunkHeaderBytes};
+            bool firstInChunk = true;
+            while (const RecordHeader *frameHeader = recordHeader(position)) {
+                if (firstInChunk || recordNumber % kIndexStride == 0) {
+                    m_index.push_back({frameHeader->timestampUs, position});
+                }
+                firstInChunk = false;
+                ++recordNumber;
+                position.offset += recordSize(mapped, frameHeader);
+            }
+        }
+    }
+    return true;
+}
+
+/*!
+ *  \brief Возвращает первую запись, начиная с заданного чанка заданного файла.
+ *  \param[in] file Номер файла.
+ *  \param[in] chunk Номер чанка.
+ *  \return Положение записи или недействительное, если дальше записей нет.
+ */
+RecordingReader::Position RecordingReader::firstFrom(int file, int chunk) const
+{
+    for (; file < static_cast<int>(m_files.size()); ++file, chunk = 0) {
+        const File &mapped = m_files[static_cast<size_t>(file)];
+        for (; chunk < mapped.chunkCount; ++chunk) {
+            const Position position{file, chunkOffset(chunk, mapped.chunkBytes) + kChunkHeaderBytes};
+            if (recordHeader(position)) {
+                return position;
+            }
+        }
+    }
+    return {};
+}
+
+/*!
+ *  \brief Возвращает заголовок записи в пределах чанка.
+ *  \param[in] position Положение записи.
+ *  \return Заголовок или nullptr, если в положении нет целой записи.
+ */
+const RecordHeader *RecordingReader::recordHeader(const Position &position) const
+{
+    if (position.file < 0 || position.file >= static_cast<int>(m_files.size())) {
+        return nullptr;
+    }
+
+    const File &file = m_files[static_cast<size_t>(position.file)];
+    const qint64 chunk = (position.offset - kFileHeaderBytes) / file.chunkBytes;
+    if (position.offset < kFileHeaderBytes + kChunkHeaderBytes || chunk >= file.chunkCount) {
+        return nullptr;
+    }
+    const qint64 chunkStart = chunkOffset(chunk, file.chunkBytes);
+    const qint64 chunkEnd = chunkStart + file.chunkBytes;
+    if (position.offset + static_cast<qint64>(sizeof(RecordHeader)) > chunkEnd
+        || reinterpret_cast<const ChunkHeader *>(file.data + chunkStart)->magic != kChunkMagic) {
+        return nullptr;
+    }
+
+    const auto *header = reinterpret_cast<const RecordHeader *>(file.data + position.offset);
+    if (header->magic != kRecordMagic) {
+        return nullptr;
+    }
+    // Парная к записи сигнатуры последней в RecordingManager.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (file.encoding == kEncodingSpectrumCodec
+        && position.offset + static_cast<qint64>(sizeof(RecordHeader) + sizeof(CodedRecordHeader)) > chunkEnd) {
+        return nullptr;
+    }
+    if (position.offset + recordSize(file, header) > chunkEnd) {
+        return nullptr;
+    }
+    return header;
+}
+
+/*!
+ *  \brief Возвращает размер записи с выравниванием.
+ *  \param[in] file Файл записи.
+ *  \param[in] header Заголовок записи (заголовок сжатых данных уже в пределах чанка).
+ *  \return Размер, байты.
+ */
+qint64 RecordingReader::recordSize(const File &file, const RecordHeader *header) noexcept
+{
+    if (file.encoding == kEncodingSpectrumCodec) {
+        return codedRecordBytes(reinterpret_cast<const CodedRecordHeader *>(header + 1)->codedBytes);
+    }
+    return recordBytes(header->binCount);
+}
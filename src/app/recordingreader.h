@@ -0,0 +1,195 @@
+/*!
+ *  \file recordingreader.h
+ *  \brief Чтение серии файлов записи спектра через отображение в память.
+ */
+#ifndef RECORDINGREADER_H
+#define RECORDINGREADER_H
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+#include <memory>
+#include <vector>
+
+#include "recordingformat.h"
+#include "spectrumcodec.h"
+
+/*!
+ *  \class RecordingReader
+ *  \brief Дает произвольный доступ к кадрам серии записи без загрузки файлов в память.
+ *
+ *  Каждый файл серии целиком отображается в память только для чтения:
+ *  значения кадров читаются прямо из страниц файла, которые система
+ *  подгружает по мере обращения. Разреженные индексы всех файлов
+ *  объединяются в один упорядоченный по времени массив, поэтому seek()
+ *  выполняется двоичным поиском и просмотром не более kIndexStride записей.
+ *  Для файлов, закрытых нештатно (или записываемых сейчас), индекс
+ *  восстанавливается по заголовкам записей.
+ *
+ *  Сжатые записи (kEncodingSpectrumCodec) выдаются потоком кодека без
+ *  декодирования; keyFrame() указывает ключевой кадр, с которого
+ *  декодирование начинается при произвольном доступе.
+ *
+ *  После open() методы только читают состояние и могут вызываться из
+ *  любого одного потока.
+ */
+class RecordingReader
+{
+public:
+    //! \brief Положение записи в серии.
+    struct Position
+    {
+        //! \brief Номер файла серии (-1 — за концом серии).
+        int file = -1;
+        //! \brief Смещение записи от начала файла, байты.
+        qint64 offset = 0;
+
+        //! \brief Проверяет, указывает ли положение на запись.
+        bool isValid() const noexcept { return file >= 0; }
+        //! \brief Сравнивает положения.
+        bool operator==(const Position &other) const noexcept
+        {
+            return file == other.file && offset == other.offset;
+        }
+    };
+
+    //! \brief Запись кадра, указывающая в отображенную память.
+    struct Record
+    {
+        //! \brief Заголовок записи.
+        const RecordingFormat::RecordHeader *header = nullptr;
+        //! \brief Значения спектра (header->binCount штук) или nullptr для сжатой записи.
+        const float *bins = nullptr;
+        //! \brief Поток SpectrumCodec сжатой записи или nullptr.
+        const uchar *coded = nullptr;
+        //! \brief Размер потока, байты.
+        qint64 codedBytes = 0;
+    };
+
+    //! \brief Конструирует закрытый читатель.
+    RecordingReader();
+    //! \brief Снимает отображения файлов.
+    ~RecordingReader();
+
+    /*!
+     *  \brief Открывает серию, к которой относится файл записи.
+     *  \param[in] path Путь к любому файлу серии (*.ssr).
+     *  \return false, если ни один файл серии не удалось прочитать.
+     */
+    bool open(const QString &path);
+    //! \brief Закрывает серию и снимает отображения.
+    void close();
+    //! \brief Проверяет, открыта ли серия.
+    bool isOpen() const noexcept { return !m_index.empty(); }
+
+    //! \brief Возвращает число кадров серии.
+    qint64 frameCount() const noexcept { return m_frameCount; }
+    //! \brief Возвращает время первого кадра, мкс от начала эпохи.
+    qint64 firstTimestampUs() const noexcept;
+    //! \brief Возвращает время последнего кадра, мкс от начала эпохи.
+    qint64 lastTimestampUs() const noexcept { return m_lastTimestampUs; }
+
+    //! \brief Возвращает положение первого кадра серии.
+    Position first() const noexcept;
+    /*!
+     *  \brief Находит последний кадр, сформированный не позже заданного времени.
+     *  \param[in] timestampUs Время, мкс от начала эпохи.
+     *  \return Положение кадра (первый кадр, если время раньше начала серии).
+     */
+    Position seek(qint64 timestampUs) const;
+    /*!
+     *  \brief Возвращает положение кадра, следующего за заданным.
+     *  \param[in] position Положение кадра.
+     *  \return Положение следующего кадра или недействительное за концом серии.
+     */
+    Position next(const Position &position) const;
+    /*!
+     *  \brief Возвращает запись кадра без копирования.
+     *  \param[in] position Положение кадра.
+     *  \param[out] record Запись кадра.
+     *  \return false, если в заданном положении нет целой записи.
+     */
+    bool record(const Position &position, Record &record) const;
+    /*!
+     *  \brief Возвращает положение ключевого кадра, с которого декодируется заданный.
+     *  \param[in] position Положение кадра.
+     *  \return Положение ключевого кадра (сам кадр, если запись не сжата) или недействительное.
+     */
+    Position keyFrame(const Position &position) const;
+    /*!
+     *  \brief Возвращает параметры кодека файла, к которому относится кадр.
+     *  \param[in] position Положение кадра.
+     */
+    SpectrumCodec::Settings codecSettings(const Position &position) const;
+    /*!
+     *  \brief Просит систему заранее подгрузить страницы после заданного кадра.
+     *  \param[in] position Положение кадра.
+     *  \param[in] bytes Объем упреждающего чтения, байты.
+     */
+    void prefetch(const Position &position, qint64 bytes) const;
+
+private:
+    //! \brief Отображенный файл серии.
+    struct File
+    {
+        //! \brief Открытый файл.
+        std::unique_ptr<QFile> file;
+        //! \brief Отображение всего файла.
+        const uchar *data = nullptr;
+        //! \brief Размер отображения, байты.
+        qint64 size = 0;
+        //! \brief Размер чанка, байты.
+        qint64 chunkBytes = 0;
+        //! \brief Количество начатых чанков, целиком попавших в отображение.
+        int chunkCount = 0;
+        //! \brief Кодирование значений.
+        quint32 encoding = RecordingFormat::kEncodingFloat32;
+        //! \brief Параметры кодека сжатого файла.
+        SpectrumCodec::Settings codec;
+    };
+
+    //! \brief Элемент объединенного индекса.
+    struct IndexEntry
+    {
+        //! \brief Время кадра, мкс.
+        qint64 timestampUs;
+        //! \brief Положение кадра.
+        Position position;
+    };
+
+    /*!
+     *  \brief Отображает файл серии и дополняет объединенный индекс.
+     *  \param[in] path Путь к файлу записи.
+     */
+    bool addFile(const QString &path);
+    /*!
+     *  \brief Возвращает первую запись, начиная с заданного чанка заданного файла.
+     *  \param[in] file Номер файла.
+     *  \param[in] chunk Номер чанка.
+     *  \return Положение записи или недействительное, если дальше записей нет.
+     */
+    Position firstFrom(int file, int chunk) const;
+    /*!
+     *  \brief Возвращает заголовок записи в пределах чанка или nullptr.
+     *  \param[in] position Положение записи.
+     */
+    const RecordingFormat::RecordHeader *recordHeader(const Position &position) const;
+    /*!
+     *  \brief Возвращает размер записи с выравниванием.
+     *  \param[in] file Файл записи.
+     *  \param[in] header Заголовок записи, проверенный recordHeader().
+     */
+    static qint64 recordSize(const File &file, const RecordingFormat::RecordHeader *header) noexcept;
+
+    //! \brief Файлы серии в порядке номеров.
+    std::vector<File> m_files;
+    //! \brief Объединенный разреженный индекс, упорядоченный по времени.
+    std::vector<IndexEntry> m_index;
+    //! \brief Число кадров серии.
+    qint64 m_frameCount = 0;
+    //! \brief Время последнего кадра, мкс.
+    qint64 m_lastTimestampUs = 0;
+};
+
+#endif // RECORDINGREADER_H
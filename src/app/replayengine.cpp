@@ -0,0 +1,402 @@
+/*!
+ *  \file replayengine.cpp
+ *  \brief Реализация ReplayEngine.
+ */
+#include "replayengine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+//! \brief Наибольшая пауза между проверками команд, мс.
+constexpr int kPollIntervalMs = 10;
+//! \brief Объем упреждающего чтения впереди позиции, байты.
+constexpr qint64 kPrefetchBytes = qint64(32) << 20;
+
+/*!
+ *  \brief Выбирает значения кадра, которые нужно восстановить для диапазона обзора.
+ *
+ *  Диапазон расширяется на свою ширину в каждую сторону, а границы
+ *  выравниваются по блокам кодека, чтобы небольшой сдвиг обзора не менял
+ *  декодируемые блоки.
+ *
+ *  \param[in] header Заголовок записи.
+ *  \param[in] minHz Нижняя граница обзора, Гц.
+ *  \param[in] maxHz Верхняя граница обзора, Гц.
+ *  \param[out] firstBin Первое значение.
+ *  \param[out] lastBin Значение за последним.
+ */
+void decodeBins(const RecordingFormat::RecordHeader &header, double minHz, double maxHz, int &firstBin, int &lastBin)
+{
+    const int binCount = static_cast<int>(header.binCount);
+    firstBin = 0;
+    lastBin = binCount;
+
+    const double spanHz = header.viewMaxHz - header.viewMinHz;
+    const double rangeHz = maxHz - minHz;
+    if (binCount <= 0 || spanHz <= 0.0 || rangeHz <= 0.0) {
+        return;
+    }
+    const double lowHz = std::max(minHz - rangeHz, header.viewMinHz);
+    const double highHz = std::min(maxHz + rangeHz, header.viewMaxHz);
+    if (highHz <= lowHz || highHz - lowHz >= ReplayEngine::kFullDecodeRatio * spanHz) {
+        return;
+    }
+
+    constexpr int block = CodecKernel::kBlockValues;
+    const double binsPerHz = binCount / spanHz;
+    const int first = static_cast<int>(std::floor((lowHz - header.viewMinHz) * binsPerHz)) / block * block;
+    const int last = static_cast<int>(std::ceil((highHz - header.viewMinHz) * binsPerHz));
+    firstBin = qBound(0, first, binCount);
+    lastBin = qBound(firstBin, (last + block - 1) / block * block, binCount);
+    if (lastBin <= firstBin) {
+        firstBin = 0;
+        lastBin = binCount;
+    }
+}
+
+} // namespace
+
+/*!
+ *  \brief Конструирует движок воспроизведения.
+ *  \param[in] parent Родительский объект.
+ */
+ReplayEngine::ReplayEngine(QObject *parent)
+    : QThread(parent)
+{
+    setObjectName(QStringLiteral("ReplayEngine"));
+}
+
+//! \brief Останавливает поток и закрывает запись.
+ReplayEngine::~ReplayEngine()
+{
+    close();
+}
+
+/*!
+ *  \brief Открывает серию записи и запускает поток на паузе у первого кадра.
+ *  \param[in] path Путь к любому файлу серии.
+ *  \return false, если серия не прочитана.
+ */
+bool ReplayEngine::open(const QString &path)
+{
+    close();
+    if (!m_reader.open(path)) {
+        return false;
+    }
+
+    m_playing.store(false, std::memory_order_relaxed);
+    m_positionUs.store(m_reader.firstTimestampUs(), std::memory_order_relaxed);
+    m_decodeMinHz = 0.0;
+    m_decodeMaxHz = 0.0;
+    m_decodedPosition = RecordingReader::Position();
+    start();
+    return true;
+}
+
+/*!
+ *  \brief Задает получателя всех выданных кадров.
+ *  \param[in] sink Функция, вызываемая в потоке воспроизведения.
+ */
+void ReplayEngine::setFrameSink(FrameSink sink)
+{
+    Q_ASSERT(!isRunning());
+    m_sink = std::move(sink);
+}
+
+//! \brief Останавливает поток и закрывает серию.
+void ReplayEngine::close()
+{
+    if (isRunning()) {
+        requestInterruption();
+        wait();
+    }
+    m_playing.store(false, std::memory_order_relaxed);
+    m_reader.close();
+}
+
+/*!
+ *  \brief Запускает или приостанавливает воспроизведение.
+ *  \param[in] playing Признак воспроизведения.
+ */
+void ReplayEngine::setPlaying(bool playing)
+{
+    m_playing.store(playing, std::memory_order_relaxed);
+}
+
+/*!
+ *  \brief Задает скорость воспроизведения.
+ *  \param[in] speed Скорость или 0 — как можно быстрее.
+ */
+void ReplayEngine::setSpeed(double speed)
+{
+    m_speed.store(speed <= 0.0 ? 0.0 : qBound(kMinSpeed, speed, kMaxSpeed), std::memory_order_relaxed);
+}
+
+/*!
+ *  \brief Публикует запрос перехода для потока воспроизведения.
+ *  \param[in] timestampUs Время, мкс от начала эпохи.
+ */
+void ReplayEngine::seek(qint64 timestampUs)
+{
+    m_seekRequests.writeBuffer() = timestampUs;
+    m_seekRequests.publish();
+}
+
+/*!
+ *  \brief Публикует диапазон обзора для потока воспроизведения.
+ *  \param[in] minHz Нижняя граница обзора, Гц.
+ *  \param[in] maxHz Верхняя граница обзора, Гц.
+ */
+void ReplayEngine::setDecodeRange(double minHz, double maxHz)
+{
+    m_rangeRequests.writeBuffer() = qMakePair(minHz, maxHz);
+    m_rangeRequests.publish();
+}
+
+/*!
+ *  \brief Забирает последний выданный кадр.
+ *  \param[out] frame Последний кадр.
+ *  \return true, если получен новый кадр.
+ */
+bool ReplayEngine::takeLatestFrame(SpectrumFrame &frame)
+{
+    m_notifyPending.store(false, std::memory_order_release);
+    if (!m_frames.consume()) {
+        return false;
+    }
+    frame = m_frames.readBuffer();
+    return true;
+}
+
+//! \brief Выдает кадры по графику их меток времени, деленных на скорость.
+void ReplayEngine::run()
+{
+    RecordingReader::Position position = m_reader.first();
+    // Последний выданный кадр: на паузе он выдается заново при смене диапазона обзора.
+    RecordingReader::Position shown;
+    SpectrumFrame prepared;
+    // Кадр позиции выдается сразу после открытия и перехода, даже на паузе.
+    bool showCurrent = true;
+    bool endSignalled = false;
+    // Упреждающее чтение запрашивается, когда позиция прошла половину прошлого окна.
+    int prefetchFile = -1;
+    qint64 prefetchEnd = 0;
+
+    // Точка привязки графика: кадр anchorUs выдается в момент anchorTime.
+    bool anchored = false;
+    Clock::time_point anchorTime;
+    qint64 anchorUs = 0;
+    double anchorSpeed = 0.0;
+
+    const auto dueTime = [&](qint64 timestampUs) {
+        return anchorTime + std::chrono::duration_cast<Clock::duration>(
+                   std::chrono::duration<double, std::micro>((timestampUs - anchorUs) / anchorSpeed));
+    };
+
+    while (!isInterruptionRequested()) {
+        if (m_seekRequests.consume()) {
+            position = m_reader.seek(m_seekRequests.readBuffer());
+            prepared = SpectrumFrame();
+            showCurrent = true;
+            anchored = false;
+            endSignalled = false;
+        }
+        if (m_rangeRequests.consume()) {
+            m_decodeMinHz = m_rangeRequests.readBuffer().first;
+            m_decodeMaxHz = m_rangeRequests.readBuffer().second;
+            prepared = SpectrumFrame();
+            if (!showCurrent && shown.isValid() && !m_playing.load(std::memory_order_relaxed)) {
+                position = shown;
+                showCurrent = true;
+            }
+        }
+
+        RecordingReader::Record record;
+        if (!m_reader.record(position, record)) {
+            if (!endSignalled) {
+                endSignalled = true;
+                m_playing.store(false, std::memory_order_relaxed);
+                emit endReached();
+            }
+            QThread::msleep(kPollIntervalMs);
+            continue;
+        }
+        const qint64 timestampUs = record.header->timestampUs;
+
+        if (position.file != prefetchFile || position.offset + kPrefetchBytes / 2 > prefetchEnd) {
+            m_reader.prefetch(position, kPrefetchBytes);
+            prefetchFile = position.file;
+            prefetchEnd = position.offset + kPrefetchBytes;
+        }
+
+        const bool playing = m_playing.load(std::memory_order_relaxed);
+        if (!playing && !showCurrent) {
+            anchored = false;
+            QThread::msleep(kPollIntervalMs);
+            continue;
+        }
+
+        if (playing && !showCurrent) {
+            const double speed = m_speed.load(std::memory_order_relaxed);
+            if (speed <= 0.0) {
+                // Как можно быстрее, но без потери кадров: ждем, пока UI заберет предыдущий.
+                if (!prepared.isValid()) {
+                    prepared = decode(position);
+                }
+                if (m_notifyPending.load(std::memory_order_acquire)) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    continue;
+                }
+                anchored = false;
+            } else {
+                if (!anchored || speed != anchorSpeed) {
+                    anchorTime = Clock::now();
+                    anchorUs = timestampUs;
+                    anchorSpeed = speed;
+                    anchored = true;
+                }
+
+                const Clock::time_point now = Clock::now();
+                const Clock::time_point due = dueTime(timestampUs);
+                if (due > now) {
+                    // Ожидание срока используется для подготовки кадра.
+                    if (!prepared.isValid()) {
+                        prepared = decode(position);
+                        continue;
+                    }
+                    std::this_thread::sleep_until(qMin(due, now + std::chrono::milliseconds(kPollIntervalMs)));
+                    continue;
+                }
+
+                // Отстаем от графика: кадр, срок следующего за которым тоже прошел, не выдаем.
+                const RecordingReader::Position following = m_reader.next(position);
+                RecordingReader::Record nextRecord;
+                if (m_reader.record(following, nextRecord) && dueTime(nextRecord.header->timestampUs) <= now) {
+                    position = following;
+                    prepared = SpectrumFrame();
+                    continue;
+                }
+            }
+        }
+
+        if (!prepared.isValid()) {
+            prepared = decode(position);
+        }
+        m_positionUs.store(timestampUs, std::memory_order_relaxed);
+        publish(std::move(prepared));
+        prepared = SpectrumFrame();
+        showCurrent = false;
+        shown = position;
+        position = m_reader.next(position);
+    }
+}
+
+/*!
+ *  \brief Копирует или декодирует запись в кадр и строит его пирамиду.
+ *
+ *  Кадр охватывает окрестность диапазона обзора (см. setDecodeRange()).
+ *  Сжатый кадр, который не удалось декодировать, выдается уровнем floorDb
+ *  кодека — так же, как значения без данных.
+ *
+ *  \param[in] position Положение записи.
+ *  \return Кадр; пустой, если записи нет.
+ */
+SpectrumFrame ReplayEngine::decode(const RecordingReader::Position &position)
+{
+    RecordingReader::Record record;
+    if (!m_reader.record(position, record)) {
+        return SpectrumFrame();
+    }
+
+    const RecordingFormat::RecordHeader &header = *record.header;
+    const int binCount = static_cast<int>(header.binCount);
+    int firstBin = 0;
+    int lastBin = binCount;
+    decodeBins(header, m_decodeMinHz, m_decodeMaxHz, firstBin, lastBin);
+
+    SpectrumFrame frame = m_framePool.acquire(lastBin - firstBin);
+    if (record.bins) {
+        std::memcpy(frame.bins(), record.bins + firstBin, static_cast<size_t>(lastBin - firstBin) * sizeof(float));
+    } else if (!decodeCoded(position, firstBin, lastBin, frame.bins())) {
+        std::fill_n(frame.bins(), lastBin - firstBin, m_reader.codecSettings(position).floorDb);
+    }
+    if (firstBin == 0 && lastBin == binCount) {
+        frame.setSpan(header.viewMinHz, header.viewMaxHz);
+    } else {
+        const double binHz = (header.viewMaxHz - header.viewMinHz) / binCount;
+        frame.setSpan(header.viewMinHz + firstBin * binHz, header.viewMinHz + lastBin * binHz);
+    }
+    frame.setDbRange(header.minDb, header.maxDb);
+    frame.setTimestampUs(header.timestampUs);
+    frame.setSequence(header.sequence);
+    frame.rebuildPyramid();
+    return frame;
+}
+
+/*!
+ *  \brief Декодирует значения [firstBin, lastBin) сжатой записи.
+ *
+ *  Кадр, следующий за последним декодированным, декодируется сразу (кодек
+ *  сам проверяет, что предыдущий кадр восстановлен в покрывающем диапазоне).
+ *  Иначе декодирование повторяется от ключевого кадра чанка, не дальше
+ *  заданной записи.
+ *
+ *  \param[in] position Положение записи.
+ *  \param[in] firstBin Первое значение.
+ *  \param[in] lastBin Значение за последним.
+ *  \param[out] bins Значения, дБ.
+ *  \return false, если запись не декодирована.
+ */
+bool ReplayEngine::decodeCoded(const RecordingReader::Position &position, int firstBin, int lastBin, float *bins)
+{
+    RecordingReader::Record record;
+    if (m_decodedPosition.isValid() && m_reader.next(m_decodedPosition) == position
+        && m_reader.record(position, record)
+        && m_decoder.decodeSlice(record.coded, record.codedBytes, firstBin, lastBin, bins)) {
+        m_decodedPosition = position;
+        return true;
+    }
+
+    m_decodedPosition = RecordingReader::Position();
+    RecordingReader::Position current = m_reader.keyFrame(position);
+    if (!current.isValid()) {
+        return false;
+    }
+    m_decoder = SpectrumCodec(m_reader.codecSettings(position));
+    while (current.isValid() && current.file == position.file && current.offset <= position.offset) {
+        if (!m_reader.record(current, record) || !record.coded
+            || !m_decoder.decodeSlice(record.coded, record.codedBytes, firstBin, lastBin, bins)) {
+            return false;
+        }
+        if (current == position) {
+            m_decodedPosition = position;
+            return true;
+        }
+        current = m_reader.next(current);
+    }
+    return false;
+}
+
+/*!
+ *  \brief Публикует кадр для UI.
+ *  \param[in] frame Кадр.
+ */
+void ReplayEngine::publish(SpectrumFrame frame)
+{
+    if (m_sink) {
+        m_sink(frame);
+    }
+    m_frames.writeBuffer() = std::move(frame);
+    m_frames.publish();
+    if (!m_notifyPending.exchange(true, std::memory_order_acq_rel)) {
+        emit frameAvailable();
+    }
+}
@@ -0,0 +1,194 @@
+/*!
+ *  \file replayengine.h
+ *  \brief Воспроизведение записанных кадров спектра с заданной скоростью.
+ */
+#ifndef REPLAYENGINE_H
+#define REPLAYENGINE_H
+
+#include <QPair>
+#include <QString>
+#include <QThread>
+
+#include <atomic>
+#include <functional>
+
+#include "latestvalueslot.h"
+#include "recordingreader.h"
+#include "spectrumcodec.h"
+#include "spectrumframe.h"
+#include "spectrumframepool.h"
+
+/*!
+ *  \class ReplayEngine
+ *  \brief Выдает кадры серии записи в темпе их формирования, ускоренном или замедленном.
+ *
+ *  Поток воспроизведения заранее готовит следующий кадр, пока ждет срока
+ *  текущего, и просит систему подгрузить страницы файла впереди позиции.
+ *  Если воспроизведение отстает от графика, кадры с прошедшим сроком
+ *  пропускаются по заголовкам без чтения значений. Кадры доставляются в UI
+ *  через LatestValueSlot так же, как в SpectrumProducer.
+ *
+ *  Скорость 0 означает «как можно быстрее»: следующий кадр публикуется,
+ *  как только UI забрал предыдущий.
+ *
+ *  Сжатые кадры декодируются последовательно одним SpectrumCodec; после
+ *  перехода или пропуска кадров декодирование начинается с ключевого кадра
+ *  чанка. Если диапазон обзора (setDecodeRange) много уже кадра, из записи
+ *  восстанавливается только его окрестность, и UI получает кадр этого
+ *  поддиапазона.
+ */
+class ReplayEngine : public QThread
+{
+    Q_OBJECT
+
+public:
+    //! \brief Доля диапазона кадра, начиная с которой кадр декодируется целиком.
+    static constexpr double kFullDecodeRatio = 0.5;
+    //! \brief Минимальная скорость воспроизведения.
+    static constexpr double kMinSpeed = 0.1;
+    //! \brief Максимальная скорость воспроизведения.
+    static constexpr double kMaxSpeed = 100.0;
+
+    //! \brief Функция, получающая каждый выданный кадр в потоке воспроизведения (не должна блокироваться).
+    using FrameSink = std::function<void(const SpectrumFrame &frame)>;
+
+    /*!
+     *  \brief Конструирует движок воспроизведения.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit ReplayEngine(QObject *parent = nullptr);
+    //! \brief Останавливает поток и закрывает запись.
+    ~ReplayEngine() override;
+
+    /*!
+     *  \brief Открывает серию записи и запускает поток на паузе у первого кадра (поток UI).
+     *  \param[in] path Путь к любому файлу серии.
+     *  \return false, если серия не прочитана.
+     */
+    bool open(const QString &path);
+    /*!
+     *  \brief Задает получателя всех выданных кадров (пока поток не запущен).
+     *  \param[in] sink Функция, вызываемая в потоке воспроизведения.
+     */
+    void setFrameSink(FrameSink sink);
+    //! \brief Останавливает поток и закрывает серию (поток UI).
+    void close();
+    //! \brief Проверяет, открыта ли серия.
+    bool isOpen() const noexcept { return m_reader.isOpen(); }
+
+    //! \brief Возвращает время первого кадра серии, мкс от начала эпохи.
+    qint64 startUs() const noexcept { return m_reader.firstTimestampUs(); }
+    //! \brief Возвращает время последнего кадра серии, мкс от начала эпохи.
+    qint64 endUs() const noexcept { return m_reader.lastTimestampUs(); }
+    //! \brief Возвращает число кадров серии.
+    qint64 frameCount() const noexcept { return m_reader.frameCount(); }
+
+    //! \brief Проверяет, идет ли воспроизведение.
+    bool isPlaying() const noexcept { return m_playing.load(std::memory_order_relaxed); }
+    /*!
+     *  \brief Запускает или приостанавливает воспроизведение.
+     *  \param[in] playing Признак воспроизведения.
+     */
+    void setPlaying(bool playing);
+    //! \brief Возвращает скорость воспроизведения (0 — как можно быстрее).
+    double speed() const noexcept { return m_speed.load(std::memory_order_relaxed); }
+    /*!
+     *  \brief Задает скорость воспроизведения.
+     *  \param[in] speed Скорость kMinSpeed..kMaxSpeed или 0 — как можно быстрее.
+     */
+    void setSpeed(double speed);
+    /*!
+     *  \brief Переходит к последнему кадру, сформированному не позже заданного времени.
+     *
+     *  Кадр новой позиции выдается и на паузе, что позволяет листать запись.
+     *
+     *  \param[in] timestampUs Время, мкс от начала эпохи.
+     */
+    void seek(qint64 timestampUs);
+    //! \brief Возвращает время последнего выданного кадра, мкс от начала эпохи.
+    qint64 positionUs() const noexcept { return m_positionUs.load(std::memory_order_relaxed); }
+    //! \brief Возвращает число кадров, созданных в куче из-за исчерпания пула буферов.
+    quint64 framePoolExhaustedCount() const noexcept { return m_framePool.exhaustedCount(); }
+
+    /*!
+     *  \brief Задает диапазон обзора, значения которого нужны UI (поток UI).
+     *
+     *  Кадр декодируется в диапазоне обзора, расширенном на его ширину в каждую
+     *  сторону, если тот меньше kFullDecodeRatio диапазона кадра. На паузе
+     *  текущий кадр выдается заново в новом диапазоне.
+     *
+     *  \param[in] minHz Нижняя граница обзора, Гц.
+     *  \param[in] maxHz Верхняя граница обзора, Гц (не больше minHz — кадр целиком).
+     */
+    void setDecodeRange(double minHz, double maxHz);
+
+    /*!
+     *  \brief Забирает последний выданный кадр (поток UI).
+     *  \param[out] frame Последний кадр, если он появился с прошлого вызова.
+     *  \return true, если получен новый кадр.
+     */
+    bool takeLatestFrame(SpectrumFrame &frame);
+
+signals:
+    //! \brief Сигнал о появлении нового кадра (не чаще одного до его получения).
+    void frameAvailable();
+    //! \brief Сигнал о достижении конца записи (воспроизведение приостанавливается).
+    void endReached();
+
+protected:
+    //! \brief Цикл воспроизведения.
+    void run() override;
+
+private:
+    /*!
+     *  \brief Копирует или декодирует запись в кадр и строит его пирамиду.
+     *  \param[in] position Положение записи.
+     *  \return Кадр; пустой, если записи нет.
+     */
+    SpectrumFrame decode(const RecordingReader::Position &position);
+    /*!
+     *  \brief Декодирует значения [firstBin, lastBin) сжатой записи.
+     *  \param[in] position Положение записи.
+     *  \param[in] firstBin Первое значение.
+     *  \param[in] lastBin Значение за последним.
+     *  \param[out] bins Значения, дБ.
+     *  \return false, если запись не декодирована.
+     */
+    bool decodeCoded(const RecordingReader::Position &position, int firstBin, int lastBin, float *bins);
+    /*!
+     *  \brief Публикует кадр для UI.
+     *  \param[in] frame Кадр.
+     */
+    void publish(SpectrumFrame frame);
+
+    //! \brief Серия записи (после open() только читается потоком воспроизведения).
+    RecordingReader m_reader;
+    //! \brief Слот запросов перехода (UI -> поток).
+    LatestValueSlot<qint64> m_seekRequests;
+    //! \brief Слот диапазонов обзора (UI -> поток).
+    LatestValueSlot<QPair<double, double>> m_rangeRequests;
+    //! \brief Нижняя граница обзора, Гц (поток воспроизведения).
+    double m_decodeMinHz = 0.0;
+    //! \brief Верхняя граница обзора, Гц (поток воспроизведения).
+    double m_decodeMaxHz = 0.0;
+    //! \brief Декодер сжатых кадров (поток воспроизведения).
+    SpectrumCodec m_decoder;
+    //! \brief Положение последнего кадра, декодированного m_decoder.
+    RecordingReader::Position m_decodedPosition;
+    //! \brief Пул буферов декодированных кадров.
+    SpectrumFramePool m_framePool;
+    //! \brief Получатель всех выданных кадров.
+    FrameSink m_sink;
+    //! \brief Слот выданных кадров (поток -> UI).
+    LatestValueSlot<SpectrumFrame> m_frames;
+    //! \brief Признак отправленного и еще не обработанного уведомления.
+    std::atomic<bool> m_notifyPending{false};
+    //! \brief Признак воспроизведения.
+    std::atomic<bool> m_playing{false};
+    //! \brief Скорость воспроизведения.
+    std::atomic<double> m_speed{1.0};
+    //! \brief Время последнего выданного кадра, мкс.
+    std::atomic<qint64> m_positionUs{0};
+};
+
+#endif // REPLAYENGINE_H
@@ -0,0 +1,189 @@
+/*!
+ *  \file scenariokernel.cpp
+ *  \brief Реализация ScenarioKernel.
+ */
+#include "scenariokernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIRIUS_SCENARIO_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//! \brief Сигнатура ядра шумовой подложки.
+using NoiseFn = void (*)(const float *, float *, std::int64_t, float);
+//! \brief Сигнатура ядра спектра излучателя.
+using PeakFn = void (*)(float *, std::int64_t, float, float, float, float);
+
+//! \brief Скалярная шумовая подложка.
+void fillNoiseScalar(const float *table, float *out, std::int64_t count, float floorDb)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        out[i] = table[i] + floorDb;
+    }
+}
+
+/*!
+ *  \brief Скалярный спектр излучателя. Порядок операций совпадает с векторными
+ *  вариантами: x = x0 + i * step, затем level - (curvature * x) * x без FMA.
+ */
+void addPeakScalar(float *out, std::int64_t count, float x0, float step, float levelDb, float curvature)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        const float x = x0 + static_cast<float>(i) * step;
+        const float value = levelDb - curvature * x * x;
+        out[i] = value > out[i] ? value : out[i];
+    }
+}
+
+#ifdef SIRIUS_SCENARIO_X86
+
+//! \brief Шумовая подложка SSE2: 4 значения за шаг.
+void fillNoiseSse2(const float *table, float *out, std::int64_t count, float floorDb)
+{
+    const __m128 floor = _mm_set1_ps(floorDb);
+    std::int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(table + i), floor));
+    }
+    fillNoiseScalar(table + i, out + i, count - i, floorDb);
+}
+
+//! \brief Спектр излучателя SSE2.
+void addPeakSse2(float *out, std::int64_t count, float x0, float step, float levelDb, float curvature)
+{
+    const __m128 origin = _mm_set1_ps(x0);
+    const __m128 stride = _mm_set1_ps(step);
+    const __m128 level = _mm_set1_ps(levelDb);
+    const __m128 curve = _mm_set1_ps(curvature);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i four = _mm_set1_epi32(4);
+    std::int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(index), stride));
+        const __m128 value = _mm_sub_ps(level, _mm_mul_ps(_mm_mul_ps(curve, x), x));
+        _mm_storeu_ps(out + i, _mm_max_ps(value, _mm_loadu_ps(out + i)));
+        index = _mm_add_epi32(index, four);
+    }
+    for (; i < count; ++i) {
+        const float x = x0 + static_cast<float>(i) * step;
+        const float value = levelDb - curvature * x * x;
+        out[i] = value > out[i] ? value : out[i];
+    }
+}
+
+//! \brief Шумовая подложка AVX2: 8 значений за шаг.
+__attribute__((target("avx2")))
+void fillNoiseAvx2(const float *table, float *out, std::int64_t count, float floorDb)
+{
+    const __m256 floor = _mm256_set1_ps(floorDb);
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(table + i), floor));
+    }
+    fillNoiseScalar(table + i, out + i, count - i, floorDb);
+}
+
+//! \brief Спектр излучателя AVX2 (без FMA — результат совпадает со скалярным).
+__attribute__((target("avx2")))
+void addPeakAvx2(float *out, std::int64_t count, float x0, float step, float levelDb, float curvature)
+{
+    const __m256 origin = _mm256_set1_ps(x0);
+    const __m256 stride = _mm256_set1_ps(step);
+    const __m256 level = _mm256_set1_ps(levelDb);
+    const __m256 curve = _mm256_set1_ps(curvature);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i eight = _mm256_set1_epi32(8);
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_add_ps(origin, _mm256_mul_ps(_mm256_cvtepi32_ps(index), stride));
+        const __m256 value = _mm256_sub_ps(level, _mm256_mul_ps(_mm256_mul_ps(curve, x), x));
+        _mm256_storeu_ps(out + i, _mm256_max_ps(value, _mm256_loadu_ps(out + i)));
+        index = _mm256_add_epi32(index, eight);
+    }
+    for (; i < count; ++i) {
+        const float x = x0 + static_cast<float>(i) * step;
+        const float value = levelDb - curvature * x * x;
+        out[i] = value > out[i] ? value : out[i];
+    }
+}
+
+#endif
+
+//! \brief Возвращает ядро шумовой подложки для варианта.
+NoiseFn noiseFunction(ScenarioKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_SCENARIO_X86
+    case ScenarioKernel::Variant::Sse2:
+        return fillNoiseSse2;
+    case ScenarioKernel::Variant::Avx2:
+        return fillNoiseAvx2;
+#endif
+    default:
+        return fillNoiseScalar;
+    }
+}
+
+//! \brief Возвращает ядро спектра излучателя для варианта.
+PeakFn peakFunction(ScenarioKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_SCENARIO_X86
+    case ScenarioKernel::Variant::Sse2:
+        return addPeakSse2;
+    case ScenarioKernel::Variant::Avx2:
+        return addPeakAvx2;
+#endif
+    default:
+        return addPeakScalar;
+    }
+}
+
+} // namespace
+
+//! \brief Возвращает лучший поддерживаемый процессором вариант (определяется один раз).
+ScenarioKernel::Variant ScenarioKernel::bestVariant() noexcept
+{
+    static const Variant best = [] {
+        for (int v = kVariantCount - 1; v > 0; --v) {
+            if (isSupported(static_cast<Variant>(v))) {
+                return static_cast<Variant>(v);
+            }
+        }
+        return Variant::Scalar;
+    }();
+    return best;
+}
+
+//! \brief Проверяет, поддерживает ли процессор вариант.
+bool ScenarioKernel::isSupported(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return true;
+#ifdef SIRIUS_SCENARIO_X86
+    case Variant::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Variant::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+//! \brief Заполняет шумовую подложку.
+void ScenarioKernel::fillNoise(Variant variant, const float *table, float *out, std::int64_t count,
+                               float floorDb) noexcept
+{
+    noiseFunction(variant)(table, out, count, floorDb);
+}
+
+//! \brief Накладывает спектр излучателя.
+void ScenarioKernel::addPeak(Variant variant, float *out, std::int64_t count, float x0, float step, float levelDb,
+                             float curvature) noexcept
+{
+    peakFunction(variant)(out, count, x0, step, levelDb, curvature);
+}
@@ -0,0 +1,61 @@
+/*!
+ *  \file scenariokernel.h
+ *  \brief Векторизованные ядра синтеза спектра сценария (шум и спектры излучателей).
+ */
+#ifndef SCENARIOKERNEL_H
+#define SCENARIOKERNEL_H
+
+#include <cstdint>
+
+/*!
+ *  \class ScenarioKernel
+ *  \brief Ядра синтеза кадра спектра для float32: скалярное, SSE2 и AVX2.
+ *
+ *  Кадр собирается в дБ: шумовая подложка копируется из таблицы со
+ *  смещением уровня, спектр излучателя накладывается максимумом поверх
+ *  нее. Все варианты дают побитно одинаковый результат, поэтому кадр
+ *  сценария не зависит ни от процессора, ни от разбиения на потоки.
+ *  Вариант выбирается один раз по возможностям процессора.
+ */
+class ScenarioKernel
+{
+public:
+    //! \brief Вариант реализации ядра.
+    enum class Variant : int {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2
+    };
+
+    //! \brief Количество вариантов.
+    static constexpr int kVariantCount = 3;
+
+    //! \brief Возвращает лучший поддерживаемый процессором вариант.
+    static Variant bestVariant() noexcept;
+    //! \brief Проверяет, поддерживает ли процессор вариант.
+    static bool isSupported(Variant variant) noexcept;
+
+    /*!
+     *  \brief Шумовая подложка: out = table + floorDb.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] table Отсчеты шума, дБ относительно средней мощности.
+     *  \param[out] out Значения кадра.
+     *  \param[in] count Количество значений.
+     *  \param[in] floorDb Средняя мощность шума, дБ.
+     */
+    static void fillNoise(Variant variant, const float *table, float *out, std::int64_t count, float floorDb) noexcept;
+    /*!
+     *  \brief Спектр излучателя: out = max(out, levelDb - curvature * x * x), x = x0 + i * step.
+     *  \param[in] variant Вариант ядра.
+     *  \param[in,out] out Значения кадра.
+     *  \param[in] count Количество значений (меньше 2^24).
+     *  \param[in] x0 Нормированная расстройка первого значения от центра.
+     *  \param[in] step Шаг нормированной расстройки на значение.
+     *  \param[in] levelDb Уровень в центре, дБ.
+     *  \param[in] curvature Спад на единицу квадрата расстройки, дБ.
+     */
+    static void addPeak(Variant variant, float *out, std::int64_t count, float x0, float step, float levelDb,
+                        float curvature) noexcept;
+};
+
+#endif // SCENARIOKERNEL_H
@@ -0,0 +1,479 @@
+/*!
+ *  \file scenariosimulator.cpp
+ *  \brief Реализация ScenarioSimulator и ScenarioIqSource.
+ */
+#include "scenariosimulator.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtMath>
+
+#include <cmath>
+
+namespace {
+
+//! \brief Размер таблицы шума (степень двойки).
+constexpr int kNoiseTableSize = 1 << 16;
+//! \brief Размер кадра, с которого блоки делятся между потоками.
+constexpr int kParallelThreshold = 1 << 17;
+//! \brief Спад спектра излучателя на краю полосы, дБ.
+constexpr float kEdgeDb = 3.0f;
+//! \brief Насколько ниже шума спектр излучателя перестает учитываться, дБ.
+constexpr double kPeakCutoffDb = 10.0;
+//! \brief Наибольшее число значений кадра сценария.
+constexpr int kMaxBinCount = 1 << 24;
+
+//! \brief Приводит угол к диапазону [0, 360).
+double wrap360(double deg) noexcept
+{
+    const double wrapped = std::fmod(deg, 360.0);
+    return wrapped < 0.0 ? wrapped + 360.0 : wrapped;
+}
+
+//! \brief Перемешивает 64-битное значение (финализатор splitmix64).
+quint64 mix(quint64 value) noexcept
+{
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
+//! \brief Возвращает хеш начального значения и трех номеров.
+quint64 hash(quint32 seed, quint64 a, quint64 b, quint64 c = 0) noexcept
+{
+    return mix(mix(mix(seed ^ a) ^ b) ^ c);
+}
+
+//! \brief Возвращает нормально распределенное число по хешу (преобразование Бокса — Мюллера).
+float gaussian(quint64 bits) noexcept
+{
+    const double u1 = (static_cast<double>(bits >> 40) + 1.0) / 16777217.0;
+    const double u2 = static_cast<double>((bits >> 16) & 0xffffff) / 16777216.0;
+    return static_cast<float>(std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * M_PI * u2));
+}
+
+/*!
+ *  \brief Возвращает время включения импульсного излучателя на [0, timeUs), мкс.
+ *  \param[in] timeUs Время от начала первого импульса, мкс.
+ *  \param[in] periodUs Период, мкс.
+ *  \param[in] widthUs Длительность импульса, мкс.
+ */
+double onTimeUs(double timeUs, double periodUs, double widthUs) noexcept
+{
+    const double periods = std::floor(timeUs / periodUs);
+    return periods * widthUs + qMin(timeUs - periods * periodUs, widthUs);
+}
+
+//! \brief Читает число из объекта JSON или возвращает значение по умолчанию.
+double number(const QJsonObject &object, const char *key, double fallback)
+{
+    return object.value(QLatin1String(key)).toDouble(fallback);
+}
+
+} // namespace
+
+/*!
+ *  \brief Разбирает сценарий из JSON.
+ *  \param[in] json Текст сценария.
+ *  \param[out] scenario Сценарий.
+ *  \param[out] error Описание ошибки.
+ *  \return false, если сценарий не разобран или некорректен.
+ */
+bool ScenarioSimulator::parse(const QByteArray &json, Scenario &scenario, QString *error)
+{
+    const auto fail = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(json, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        return fail(QStringLiteral("Ошибка разбора сценария (позиция %1): %2")
+                        .arg(parseError.offset)
+                        .arg(parseError.errorString()));
+    }
+    if (!document.isObject()) {
+        return fail(QStringLiteral("Корень сценария должен быть объектом"));
+    }
+
+    const QJsonObject root = document.object();
+    Scenario result;
+    result.seed = static_cast<quint32>(number(root, "seed", result.seed));
+    const QString output = root.value(QLatin1String("output")).toString(QStringLiteral("spectrum"));
+    if (output == QLatin1String("spectrum")) {
+        result.output = Output::Spectrum;
+    } else if (output == QLatin1String("iq")) {
+        result.output = Output::Iq;
+    } else {
+        return fail(QStringLiteral("Неизвестный выход сценария: %1").arg(output));
+    }
+    result.minHz = number(root, "minHz", result.minHz);
+    result.maxHz = number(root, "maxHz", result.maxHz);
+    result.binCount = static_cast<int>(number(root, "binCount", result.binCount));
+    result.frameRateHz = number(root, "frameRateHz", result.frameRateHz);
+    result.noiseFloorDb = number(root, "noiseFloorDb", result.noiseFloorDb);
+    result.amplitudeNoiseDb = number(root, "amplitudeNoiseDb", result.amplitudeNoiseDb);
+    if (!(result.maxHz > result.minHz) || result.binCount < 16 || result.binCount > kMaxBinCount
+        || !(result.frameRateHz > 0.0)) {
+        return fail(QStringLiteral("Некорректный диапазон, размер кадра или частота кадров сценария"));
+    }
+
+    const QJsonArray emitters = root.value(QLatin1String("emitters")).toArray();
+    for (qsizetype i = 0; i < emitters.size(); ++i) {
+        const QJsonObject object = emitters.at(i).toObject();
+        const QJsonObject pulse = object.value(QLatin1String("pulse")).toObject();
+        const QJsonObject motion = object.value(QLatin1String("motion")).toObject();
+
+        Emitter emitter;
+        emitter.name = object.value(QLatin1String("name")).toString(QStringLiteral("emitter-%1").arg(i));
+        emitter.frequencyHz = number(object, "frequencyHz", emitter.frequencyHz);
+        emitter.bandwidthHz = number(object, "bandwidthHz", emitter.bandwidthHz);
+        emitter.powerDb = number(object, "powerDb", emitter.powerDb);
+        emitter.bearingDeg = number(object, "bearingDeg", emitter.bearingDeg);
+        emitter.pulsePeriodUs = number(pulse, "periodUs", emitter.pulsePeriodUs);
+        emitter.pulseWidthUs = number(pulse, "widthUs", emitter.pulseWidthUs);
+        emitter.pulseOffsetUs = number(pulse, "offsetUs", emitter.pulseOffsetUs);
+        emitter.bearingRateDegPerSec = number(motion, "bearingRateDegPerSec", emitter.bearingRateDegPerSec);
+        emitter.driftHzPerSec = number(motion, "frequencyDriftHzPerSec", emitter.driftHzPerSec);
+        if (emitter.bandwidthHz <= 0.0 || emitter.pulsePeriodUs < 0.0
+            || (emitter.pulsePeriodUs > 0.0 && emitter.pulseWidthUs <= 0.0)) {
+            return fail(QStringLiteral("Некорректная полоса или импульсы излучателя %1").arg(emitter.name));
+        }
+
+        const int count = static_cast<int>(number(object, "count", 1));
+        if (count < 1 || static_cast<qsizetype>(result.emitters.size()) + count > kMaxEmitters) {
+            return fail(QStringLiteral("Некорректное число излучателей %1").arg(emitter.name));
+        }
+        const double frequencyStepHz = number(object, "frequencyStepHz", 0.0);
+        const double bearingStepDeg = number(object, "bearingStepDeg", 0.0);
+        const double pulseOffsetStepUs = number(object, "pulseOffsetStepUs", 0.0);
+        for (int k = 0; k < count; ++k) {
+            Emitter copy = emitter;
+            if (count > 1) {
+                copy.name = QStringLiteral("%1-%2").arg(emitter.name).arg(k);
+            }
+            copy.frequencyHz += k * frequencyStepHz;
+            copy.bearingDeg = wrap360(emitter.bearingDeg + k * bearingStepDeg);
+            copy.pulseOffsetUs += k * pulseOffsetStepUs;
+            result.emitters.push_back(copy);
+        }
+    }
+
+    scenario = std::move(result);
+    return true;
+}
+
+/*!
+ *  \brief Читает сценарий из файла JSON.
+ *  \param[in] path Путь к файлу.
+ *  \param[out] scenario Сценарий.
+ *  \param[out] error Описание ошибки.
+ *  \return false, если файл не прочитан или сценарий некорректен.
+ */
+bool ScenarioSimulator::load(const QString &path, Scenario &scenario, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QStringLiteral("Не удалось открыть сценарий %1").arg(path);
+        }
+        return false;
+    }
+    return parse(file.readAll(), scenario, error);
+}
+
+/*!
+ *  \brief Конструирует имитатор и таблицу шума.
+ *  \param[in] scenario Сценарий.
+ *  \param[in] epochUs Начало сценария, мкс от начала эпохи.
+ */
+ScenarioSimulator::ScenarioSimulator(const Scenario &scenario, qint64 epochUs)
+    : m_scenario(scenario)
+    , m_epochUs(epochUs)
+    , m_variant(ScenarioKernel::bestVariant())
+{
+    m_scenario.binCount = qBound(16, m_scenario.binCount, kMaxBinCount);
+    m_scenario.frameRateHz = qMax(1e-3, m_scenario.frameRateHz);
+    m_scenario.amplitudeNoiseDb = qMax(0.0, m_scenario.amplitudeNoiseDb);
+
+    // Мощность шума значения кадра распределена экспоненциально (хи-квадрат
+    // с двумя степенями свободы); таблица хранит ее в дБ от среднего.
+    m_noise.resize(kNoiseTableSize + kNoiseBlockBins);
+    for (int i = 0; i < kNoiseTableSize; ++i) {
+        const quint64 bits = hash(m_scenario.seed, 0, static_cast<quint64>(i));
+        const double uniform = (static_cast<double>(bits >> 11) + 1.0) / 9007199254740993.0;
+        m_noise[static_cast<size_t>(i)] = static_cast<float>(10.0 * std::log10(-std::log(uniform)));
+    }
+    // Блок читается одним проходом без перехода через конец таблицы.
+    std::copy(m_noise.cbegin(), m_noise.cbegin() + kNoiseBlockBins, m_noise.begin() + kNoiseTableSize);
+}
+
+/*!
+ *  \brief Возвращает состояние излучателя на интервале.
+ *  \param[in] emitter Излучатель.
+ *  \param[in] startSec Начало интервала, с.
+ *  \param[in] durationSec Длительность интервала, с.
+ *  \return Частота и азимут в начале интервала, доля включения.
+ */
+ScenarioSimulator::EmitterState ScenarioSimulator::emitterState(const Emitter &emitter, double startSec,
+                                                                double durationSec) noexcept
+{
+    EmitterState state;
+    state.frequencyHz = emitter.frequencyHz + emitter.driftHzPerSec * startSec;
+    state.bearingDeg = wrap360(emitter.bearingDeg + emitter.bearingRateDegPerSec * startSec);
+    if (emitter.pulsePeriodUs <= 0.0) {
+        state.dutyCycle = 1.0;
+    } else if (durationSec <= 0.0) {
+        const double phaseUs = std::fmod(startSec * 1e6 - emitter.pulseOffsetUs, emitter.pulsePeriodUs);
+        const double positionUs = phaseUs < 0.0 ? phaseUs + emitter.pulsePeriodUs : phaseUs;
+        state.dutyCycle = positionUs < emitter.pulseWidthUs ? 1.0 : 0.0;
+    } else {
+        const double widthUs = qMin(emitter.pulseWidthUs, emitter.pulsePeriodUs);
+        const double beginUs = startSec * 1e6 - emitter.pulseOffsetUs;
+        const double onUs = onTimeUs(beginUs + durationSec * 1e6, emitter.pulsePeriodUs, widthUs)
+                            - onTimeUs(beginUs, emitter.pulsePeriodUs, widthUs);
+        state.dutyCycle = qBound(0.0, onUs / (durationSec * 1e6), 1.0);
+    }
+    return state;
+}
+
+/*!
+ *  \brief Синтезирует кадр спектра в буфер.
+ *  \param[in] frameIndex Номер кадра.
+ *  \param[out] bins Буфер на binCount значений.
+ *  \param[in] binCount Количество значений.
+ *  \param[in] minHz Нижняя граница кадра, Гц.
+ *  \param[in] maxHz Верхняя граница кадра, Гц.
+ *  \param[in] parallel Делить блоки между потоками пула.
+ */
+void ScenarioSimulator::renderSpectrum(quint64 frameIndex, float *bins, int binCount, double minHz, double maxHz,
+                                       bool parallel) const
+{
+    if (!bins || binCount <= 0 || !(maxHz > minHz)) {
+        return;
+    }
+
+    // Излучатель в кадре светится средней мощностью за время кадра: короткие
+    // импульсы на длинном кадре видны ниже своей мощности, как после БПФ.
+    const double binHz = (maxHz - minHz) / binCount;
+    const double frameSec = 1.0 / m_scenario.frameRateHz;
+    const double cutoffDb = m_scenario.noiseFloorDb - kPeakCutoffDb;
+    std::vector<ActiveEmitter> active;
+    active.reserve(m_scenario.emitters.size());
+    for (const Emitter &emitter : m_scenario.emitters) {
+        const EmitterState state = emitterState(emitter, frameTimeSec(frameIndex), frameSec);
+        if (state.dutyCycle <= 0.0) {
+            continue;
+        }
+        const double levelDb = emitter.powerDb + 10.0 * std::log10(state.dutyCycle);
+        if (levelDb <= cutoffDb) {
+            continue;
+        }
+        ActiveEmitter entry;
+        entry.frequencyHz = state.frequencyHz;
+        entry.halfWidthHz = qMax(0.5 * emitter.bandwidthHz, binHz);
+        entry.levelDb = static_cast<float>(levelDb);
+        const double extentHz = entry.halfWidthHz * std::sqrt((levelDb - cutoffDb) / kEdgeDb);
+        entry.lowHz = state.frequencyHz - extentHz;
+        entry.highHz = state.frequencyHz + extentHz;
+        if (entry.highHz > minHz && entry.lowHz < maxHz) {
+            active.push_back(entry);
+        }
+    }
+
+    const int blockCount = (binCount + kNoiseBlockBins - 1) / kNoiseBlockBins;
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
+    if (!parallel || binCount < kParallelThreshold || threads <= 1) {
+        renderBlocks(frameIndex, active, bins, binCount, minHz, binHz, 0, blockCount);
+        return;
+    }
+
+    // Блоки делятся на непересекающиеся диапазоны: каждый поток пишет только
+    // свои значения, а содержимое блока от разбиения не зависит.
+    QList<QPair<int, int>> ranges;
+    const int chunk = (blockCount + threads - 1) / threads;
+    for (int first = 0; first < blockCount; first += chunk) {
+        ranges.append({first, qMin(blockCount, first + chunk)});
+    }
+    QtConcurrent::blockingMap(ranges, [&](const QPair<int, int> &range) {
+        renderBlocks(frameIndex, active, bins, binCount, minHz, binHz, range.first, range.second);
+    });
+}
+
+/*!
+ *  \brief Синтезирует блоки кадра.
+ *  \param[in] frameIndex Номер кадра.
+ *  \param[in] active Включенные излучатели.
+ *  \param[out] bins Буфер кадра.
+ *  \param[in] binCount Количество значений кадра.
+ *  \param[in] minHz Нижняя граница кадра, Гц.
+ *  \param[in] binHz Ширина значения, Гц.
+ *  \param[in] firstBlock Первый блок.
+ *  \param[in] lastBlock Блок за последним.
+ */
+void ScenarioSimulator::renderBlocks(quint64 frameIndex, const std::vector<ActiveEmitter> &active, float *bins,
+                                     int binCount, double minHz, double binHz, int firstBlock, int lastBlock) const
+{
+    const float floorDb = static_cast<float>(m_scenario.noiseFloorDb);
+    for (int block = firstBlock; block < lastBlock; ++block) {
+        const int begin = block * kNoiseBlockBins;
+        const int end = qMin(binCount, begin + kNoiseBlockBins);
+        const quint64 offset = hash(m_scenario.seed, frameIndex + 1, static_cast<quint64>(block)) & (kNoiseTableSize - 1);
+        ScenarioKernel::fillNoise(m_variant, m_noise.data() + offset, bins + begin, end - begin, floorDb);
+
+        const double blockMinHz = minHz + begin * binHz;
+        const double blockMaxHz = minHz + end * binHz;
+        for (const ActiveEmitter &emitter : active) {
+            if (emitter.highHz <= blockMinHz || emitter.lowHz >= blockMaxHz) {
+                continue;
+            }
+            // Значение i блока соответствует центру своей полосы.
+            const int first = qMax(begin, static_cast<int>(std::ceil((emitter.lowHz - minHz) / binHz - 0.5)));
+            const int last = qMin(end, static_cast<int>(std::floor((emitter.highHz - minHz) / binHz - 0.5)) + 1);
+            if (first >= last) {
+                continue;
+            }
+            const double x0 = (minHz + (first + 0.5) * binHz - emitter.frequencyHz) / emitter.halfWidthHz;
+            ScenarioKernel::addPeak(m_variant, bins + first, last - first, static_cast<float>(x0),
+                                    static_cast<float>(binHz / emitter.halfWidthHz), emitter.levelDb, kEdgeDb);
+        }
+    }
+}
+
+/*!
+ *  \brief Синтезирует кадр спектра на весь диапазон сценария.
+ *  \param[in] frameIndex Номер кадра.
+ *  \param[in] pool Пул буферов.
+ *  \param[in] parallel Делить блоки между потоками пула.
+ *  \return Кадр.
+ */
+SpectrumFrame ScenarioSimulator::renderFrame(quint64 frameIndex, SpectrumFramePool &pool, bool parallel) const
+{
+    SpectrumFrame frame = pool.acquire(m_scenario.binCount);
+    renderSpectrum(frameIndex, frame.bins(), m_scenario.binCount, m_scenario.minHz, m_scenario.maxHz, parallel);
+    frame.setSpan(m_scenario.minHz, m_scenario.maxHz);
+
+    double topDb = m_scenario.noiseFloorDb + 40.0;
+    for (const Emitter &emitter : m_scenario.emitters) {
+        topDb = qMax(topDb, emitter.powerDb + 10.0);
+    }
+    frame.setDbRange(static_cast<float>(m_scenario.noiseFloorDb - 20.0), static_cast<float>(topDb));
+    frame.setTimestampUs(m_epochUs + qRound64(frameTimeSec(frameIndex) * 1e6));
+    frame.setSequence(frameIndex);
+    return frame;
+}
+
+/*!
+ *  \brief Формирует импульсы излучателей на интервале.
+ *  \param[in] startSec Начало интервала, с.
+ *  \param[in] durationSec Длительность интервала, с.
+ *  \param[in] settings Параметры антенной системы.
+ *  \param[in] antennaAzimuthDeg Азимут оси антенной системы, градусы.
+ *  \param[out] pulses Пакет импульсов.
+ *  \return Количество импульсов.
+ */
+int ScenarioSimulator::renderPulses(double startSec, double durationSec, const DirectionFinder::Settings &settings,
+                                    double antennaAzimuthDeg, DirectionFinder::PulseBatch &pulses) const
+{
+    const DirectionFinder::Settings antenna = DirectionFinder::normalized(settings);
+    pulses.timestampUs = m_epochUs + qRound64(startSec * 1e6);
+    pulses.pulses.clear();
+    if (durationSec <= 0.0) {
+        return 0;
+    }
+
+    const double startUs = startSec * 1e6;
+    const double endUs = startUs + durationSec * 1e6;
+    const float noiseDb = static_cast<float>(m_scenario.amplitudeNoiseDb);
+    const auto addPulse = [&](size_t emitterIndex, double timeUs, quint64 pulseIndex) {
+        const Emitter &emitter = m_scenario.emitters[emitterIndex];
+        const EmitterState state = emitterState(emitter, timeUs * 1e-6, 0.0);
+        DirectionFinder::Pulse pulse;
+        pulse.timestampUs = m_epochUs + qRound64(timeUs);
+        pulse.frequencyHz = state.frequencyHz;
+        pulse.antennaAzimuthDeg = static_cast<float>(antennaAzimuthDeg);
+        const double relativeDeg = state.bearingDeg - antennaAzimuthDeg;
+        for (int c = 0; c < antenna.channelCount; ++c) {
+            const float gainDb = DirectionFinder::patternDb(
+                relativeDeg - DirectionFinder::channelBoresightDeg(c, antenna.channelCount), antenna.beamWidthDeg);
+            const float jitter = noiseDb * gaussian(hash(m_scenario.seed, emitterIndex + 1, pulseIndex,
+                                                         static_cast<quint64>(c)));
+            pulse.amplitudeDb[static_cast<size_t>(c)] = static_cast<float>(emitter.powerDb) + gainDb + jitter;
+        }
+        pulses.pulses.push_back(pulse);
+    };
+
+    for (size_t i = 0; i < m_scenario.emitters.size(); ++i) {
+        const Emitter &emitter = m_scenario.emitters[i];
+        if (emitter.pulsePeriodUs <= 0.0) {
+            addPulse(i, startUs, static_cast<quint64>(qRound64(startUs)));
+            continue;
+        }
+        // Импульсы нумеруются от первого, поэтому шум амплитуд импульса не
+        // зависит от того, на какие интервалы поделено время.
+        const qint64 first = static_cast<qint64>(std::ceil((startUs - emitter.pulseOffsetUs) / emitter.pulsePeriodUs));
+        for (qint64 k = qMax<qint64>(0, first), n = 0; n < kMaxPulsesPerEmitter; ++k, ++n) {
+            const double timeUs = emitter.pulseOffsetUs + k * emitter.pulsePeriodUs;
+            if (timeUs >= endUs) {
+                break;
+            }
+            addPulse(i, timeUs, static_cast<quint64>(k));
+        }
+    }
+    return static_cast<int>(pulses.pulses.size());
+}
+
+//! \brief Возвращает излучатели как сигналы синтетического источника I/Q.
+std::vector<SyntheticIqSource::Signal> ScenarioSimulator::iqSignals() const
+{
+    std::vector<SyntheticIqSource::Signal> result;
+    result.reserve(m_scenario.emitters.size());
+    for (const Emitter &emitter : m_scenario.emitters) {
+        SyntheticIqSource::Signal signal;
+        signal.centerHz = emitter.frequencyHz;
+        signal.deviationHz = 0.5 * emitter.bandwidthHz;
+        signal.levelDb = emitter.powerDb;
+        signal.pulsePeriodUs = emitter.pulsePeriodUs;
+        signal.pulseWidthUs = emitter.pulseWidthUs;
+        signal.pulseOffsetUs = emitter.pulseOffsetUs;
+        signal.driftHzPerSec = emitter.driftHzPerSec;
+        result.push_back(signal);
+    }
+    return result;
+}
+
+/*!
+ *  \brief Конструирует источник по сценарию.
+ *  \param[in] simulator Имитатор.
+ */
+ScenarioIqSource::ScenarioIqSource(std::shared_ptr<const ScenarioSimulator> simulator)
+    : SyntheticIqSource(simulator->scenario().seed)
+    , m_simulator(std::move(simulator))
+{
+    setNoiseLevelDb(m_simulator->scenario().noiseFloorDb);
+    setSignals(m_simulator->iqSignals());
+}
+
+/*!
+ *  \brief Выдает следующий кадр сценария, если выход сценария — спектр.
+ *  \param[out] frame Кадр.
+ *  \return false в режиме I/Q.
+ */
+bool ScenarioIqSource::takeSpectrum(SpectrumFrame &frame)
+{
+    if (m_simulator->scenario().output != ScenarioSimulator::Output::Spectrum) {
+        return false;
+    }
+    frame = m_simulator->renderFrame(m_nextFrame++, m_framePool);
+    return true;
+}
@@ -0,0 +1,277 @@
+/*!
+ *  \file scenariosimulator.h
+ *  \brief Имитатор обстановки: излучатели из файла сценария, кадры спектра, отсчеты I/Q и импульсы.
+ */
+#ifndef SCENARIOSIMULATOR_H
+#define SCENARIOSIMULATOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include <memory>
+#include <vector>
+
+#include "alignedallocator.h"
+#include "directionfinder.h"
+#include "iqsource.h"
+#include "scenariokernel.h"
+#include "spectrumframe.h"
+#include "spectrumframepool.h"
+
+/*!
+ *  \class ScenarioSimulator
+ *  \brief Формирует нагрузку по сценарию: излучатели с частотой, полосой,
+ *  мощностью, импульсной структурой, пеленгом и движением.
+ *
+ *  Сценарий читается из JSON (см. parse()). Состояние излучателей —
+ *  функция времени сценария, а случайные составляющие берутся из хеша
+ *  (начальное значение, номер кадра, номер блока), а не из общего
+ *  генератора. Поэтому кадр с данным номером одинаков при любом числе
+ *  потоков, любом порядке формирования и любом варианте ядра: нагрузку
+ *  можно делить между потоками по номерам кадров, а результат повторять.
+ *
+ *  Кадр спектра синтезируется сразу в дБ без БПФ: шумовая подложка из
+ *  таблицы со смещением на каждый блок kNoiseBlockBins значений и
+ *  гауссовы в линейной мере (параболические в дБ) спектры излучателей
+ *  поверх нее; блоки большого кадра делятся между потоками. Импульсы с
+ *  амплитудами каналов антенной системы формируются по модели диаграмм
+ *  DirectionFinder. Все методы формирования константные и могут
+ *  вызываться из нескольких потоков одновременно.
+ */
+class ScenarioSimulator
+{
+public:
+    //! \brief Количество значений кадра с общим смещением по таблице шума.
+    static constexpr int kNoiseBlockBins = 4096;
+    //! \brief Наибольшее число импульсов одного излучателя за вызов renderPulses().
+    static constexpr int kMaxPulsesPerEmitter = 256;
+    //! \brief Наибольшее число излучателей сценария (после размножения).
+    static constexpr int kMaxEmitters = 65536;
+
+    //! \brief Что выдает источник сценария движку.
+    enum class Output {
+        //! \brief Готовые кадры спектра (без БПФ).
+        Spectrum,
+        //! \brief Отсчеты I/Q (спектр вычисляет движок).
+        Iq
+    };
+
+    //! \brief Излучатель сценария.
+    struct Emitter
+    {
+        //! \brief Имя.
+        QString name;
+        //! \brief Центральная частота в начале сценария, Гц.
+        double frequencyHz = 0.0;
+        //! \brief Занимаемая полоса по уровню -3 дБ, Гц.
+        double bandwidthHz = 1e6;
+        //! \brief Мощность в центре полосы, дБ.
+        double powerDb = -40.0;
+        //! \brief Период повторения импульсов, мкс (0 — непрерывное излучение).
+        double pulsePeriodUs = 0.0;
+        //! \brief Длительность импульса, мкс.
+        double pulseWidthUs = 0.0;
+        //! \brief Начало первого импульса, мкс.
+        double pulseOffsetUs = 0.0;
+        //! \brief Азимут в начале сценария, градусы.
+        double bearingDeg = 0.0;
+        //! \brief Скорость изменения азимута, градусы/с.
+        double bearingRateDegPerSec = 0.0;
+        //! \brief Уход частоты, Гц/с.
+        double driftHzPerSec = 0.0;
+    };
+
+    //! \brief Состояние излучателя на интервале времени.
+    struct EmitterState
+    {
+        //! \brief Центральная частота, Гц.
+        double frequencyHz = 0.0;
+        //! \brief Азимут, градусы 0..360.
+        double bearingDeg = 0.0;
+        //! \brief Доля интервала, в течение которой излучатель включен, 0..1.
+        double dutyCycle = 0.0;
+    };
+
+    //! \brief Сценарий.
+    struct Scenario
+    {
+        //! \brief Начальное значение случайных составляющих.
+        quint32 seed = 1;
+        //! \brief Выход источника сценария.
+        Output output = Output::Spectrum;
+        //! \brief Нижняя граница диапазона, Гц.
+        double minHz = 300e6;
+        //! \brief Верхняя граница диапазона, Гц.
+        double maxHz = 18e9;
+        //! \brief Количество значений кадра спектра.
+        int binCount = 1 << 18;
+        //! \brief Частота кадров, Гц.
+        double frameRateHz = 25.0;
+        //! \brief Средняя мощность шума, дБ (для I/Q — относительно полной шкалы).
+        double noiseFloorDb = -100.0;
+        //! \brief Среднеквадратичный шум амплитуд каналов антенной системы, дБ.
+        double amplitudeNoiseDb = 0.5;
+        //! \brief Излучатели.
+        std::vector<Emitter> emitters;
+    };
+
+    /*!
+     *  \brief Разбирает сценарий из JSON.
+     *
+     *  Корневой объект: seed, output ("spectrum" или "iq"), minHz, maxHz,
+     *  binCount, frameRateHz, noiseFloorDb, amplitudeNoiseDb и массив
+     *  emitters. Излучатель: name, frequencyHz, bandwidthHz, powerDb,
+     *  bearingDeg, объект pulse {periodUs, widthUs, offsetUs} и объект
+     *  motion {bearingRateDegPerSec, frequencyDriftHzPerSec}. Поле count
+     *  размножает излучатель с шагами frequencyStepHz, bearingStepDeg и
+     *  pulseOffsetStepUs. Отсутствующие поля берут значения по умолчанию.
+     *
+     *  \param[in] json Текст сценария.
+     *  \param[out] scenario Сценарий.
+     *  \param[out] error Описание ошибки, если указатель задан.
+     *  \return false, если сценарий не разобран или некорректен.
+     */
+    static bool parse(const QByteArray &json, Scenario &scenario, QString *error = nullptr);
+    /*!
+     *  \brief Читает сценарий из файла JSON.
+     *  \param[in] path Путь к файлу.
+     *  \param[out] scenario Сценарий.
+     *  \param[out] error Описание ошибки, если указатель задан.
+     *  \return false, если файл не прочитан или сценарий некорректен.
+     */
+    static bool load(const QString &path, Scenario &scenario, QString *error = nullptr);
+
+    /*!
+     *  \brief Конструирует имитатор.
+     *  \param[in] scenario Сценарий (параметры приводятся к допустимым).
+     *  \param[in] epochUs Начало сценария, мкс от начала эпохи (метки времени кадров и импульсов).
+     */
+    explicit ScenarioSimulator(const Scenario &scenario, qint64 epochUs = 0);
+
+    //! \brief Возвращает сценарий.
+    const Scenario &scenario() const noexcept { return m_scenario; }
+    //! \brief Возвращает начало сценария, мкс от начала эпохи.
+    qint64 epochUs() const noexcept { return m_epochUs; }
+    //! \brief Возвращает время начала кадра, с от начала сценария.
+    double frameTimeSec(quint64 frameIndex) const noexcept { return frameIndex / m_scenario.frameRateHz; }
+
+    /*!
+     *  \brief Возвращает состояние излучателя на интервале [startSec, startSec + durationSec).
+     *  \param[in] emitter Излучатель.
+     *  \param[in] startSec Начало интервала, с от начала сценария.
+     *  \param[in] durationSec Длительность интервала, с.
+     *  \return Состояние в начале интервала и доля включения на интервале.
+     */
+    static EmitterState emitterState(const Emitter &emitter, double startSec, double durationSec) noexcept;
+
+    /*!
+     *  \brief Синтезирует кадр спектра в буфер.
+     *  \param[in] frameIndex Номер кадра (время кадра — frameTimeSec()).
+     *  \param[out] bins Буфер на binCount значений, дБ.
+     *  \param[in] binCount Количество значений.
+     *  \param[in] minHz Нижняя граница кадра, Гц.
+     *  \param[in] maxHz Верхняя граница кадра, Гц.
+     *  \param[in] parallel Делить блоки большого кадра между потоками пула.
+     */
+    void renderSpectrum(quint64 frameIndex, float *bins, int binCount, double minHz, double maxHz,
+                        bool parallel = true) const;
+    /*!
+     *  \brief Синтезирует кадр спектра на весь диапазон сценария в буфер из пула.
+     *  \param[in] frameIndex Номер кадра.
+     *  \param[in] pool Пул буферов кадров.
+     *  \param[in] parallel Делить блоки большого кадра между потоками пула.
+     *  \return Кадр с диапазоном, шкалой, меткой времени и номером.
+     */
+    SpectrumFrame renderFrame(quint64 frameIndex, SpectrumFramePool &pool, bool parallel = true) const;
+    /*!
+     *  \brief Формирует импульсы излучателей на интервале времени.
+     *
+     *  Непрерывный излучатель дает один импульс в начале интервала,
+     *  импульсный — каждый свой импульс, начавшийся на интервале (не более
+     *  kMaxPulsesPerEmitter). Амплитуды каналов — мощность излучателя плюс
+     *  усиление диаграммы канала в направлении излучателя и шум.
+     *
+     *  \param[in] startSec Начало интервала, с от начала сценария.
+     *  \param[in] durationSec Длительность интервала, с.
+     *  \param[in] settings Параметры антенной системы.
+     *  \param[in] antennaAzimuthDeg Азимут оси антенной системы, градусы.
+     *  \param[out] pulses Пакет импульсов; память переиспользуется.
+     *  \return Количество импульсов.
+     */
+    int renderPulses(double startSec, double durationSec, const DirectionFinder::Settings &settings,
+                     double antennaAzimuthDeg, DirectionFinder::PulseBatch &pulses) const;
+    //! \brief Возвращает излучатели как сигналы синтетического источника I/Q.
+    std::vector<SyntheticIqSource::Signal> iqSignals() const;
+
+private:
+    //! \brief Излучатель, включенный в кадре.
+    struct ActiveEmitter
+    {
+        //! \brief Центральная частота, Гц.
+        double frequencyHz = 0.0;
+        //! \brief Половина полосы по уровню -3 дБ (не меньше значения кадра), Гц.
+        double halfWidthHz = 0.0;
+        //! \brief Уровень в центре с учетом доли включения, дБ.
+        float levelDb = 0.0f;
+        //! \brief Нижняя граница заметной части спектра, Гц.
+        double lowHz = 0.0;
+        //! \brief Верхняя граница заметной части спектра, Гц.
+        double highHz = 0.0;
+    };
+
+    /*!
+     *  \brief Синтезирует блоки кадра [firstBlock, lastBlock).
+     *  \param[in] frameIndex Номер кадра.
+     *  \param[in] active Излучатели, включенные в кадре.
+     *  \param[out] bins Буфер кадра.
+     *  \param[in] binCount Количество значений кадра.
+     *  \param[in] minHz Нижняя граница кадра, Гц.
+     *  \param[in] binHz Ширина значения, Гц.
+     *  \param[in] firstBlock Первый блок.
+     *  \param[in] lastBlock Блок за последним.
+     */
+    void renderBlocks(quint64 frameIndex, const std::vector<ActiveEmitter> &active, float *bins, int binCount,
+                      double minHz, double binHz, int firstBlock, int lastBlock) const;
+
+    //! \brief Сценарий.
+    Scenario m_scenario;
+    //! \brief Начало сценария, мкс от начала эпохи.
+    qint64 m_epochUs = 0;
+    //! \brief Вариант векторного ядра.
+    ScenarioKernel::Variant m_variant;
+    //! \brief Таблица шума в дБ относительно средней мощности; хвост повторяет начало на блок.
+    std::vector<float, AlignedAllocator<float>> m_noise;
+};
+
+/*!
+ *  \class ScenarioIqSource
+ *  \brief Источник движка по сценарию: готовые кадры спектра или отсчеты I/Q.
+ *
+ *  В режиме Output::Spectrum каждый вызов takeSpectrum() выдает следующий
+ *  по номеру кадр на весь диапазон сценария, и движок не тратит время на
+ *  БПФ. В режиме Output::Iq излучатели становятся сигналами
+ *  SyntheticIqSource (с импульсами и уходом частоты), и спектр вычисляется
+ *  по отсчетам как для настоящего приемника.
+ */
+class ScenarioIqSource : public SyntheticIqSource
+{
+public:
+    /*!
+     *  \brief Конструирует источник.
+     *  \param[in] simulator Имитатор (разделяется с потребителем импульсов).
+     */
+    explicit ScenarioIqSource(std::shared_ptr<const ScenarioSimulator> simulator);
+
+    bool takeSpectrum(SpectrumFrame &frame) override;
+
+private:
+    //! \brief Имитатор.
+    std::shared_ptr<const ScenarioSimulator> m_simulator;
+    //! \brief Пул буферов кадров.
+    SpectrumFramePool m_framePool;
+    //! \brief Номер следующего кадра.
+    quint64 m_nextFrame = 0;
+};
+
+#endif // SCENARIOSIMULATOR_H
@@ -0,0 +1,282 @@
+/*!
+ *  \file sharedstreamring.cpp
+ *  \brief Реализация SharedStreamRing.
+ */
+#include "sharedstreamring.h"
+
+#include <cstring>
+#include <new>
+
+#if defined(Q_OS_UNIX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace StreamFormat;
+
+namespace {
+
+//! \brief Наименьший размер кольца, байты.
+constexpr qint64 kMinCapacityBytes = qint64(64) << 10;
+//! \brief Наибольший размер кольца, байты.
+constexpr qint64 kMaxCapacityBytes = qint64(1) << 30;
+
+//! \brief Возвращает имя объекта разделяемой памяти POSIX ("/name").
+QByteArray objectName(const QString &name)
+{
+    QByteArray result = name.toUtf8();
+    if (!result.startsWith('/')) {
+        result.prepend('/');
+    }
+    return result;
+}
+
+} // namespace
+
+//! \brief Снимает отображение.
+SharedStreamRing::~SharedStreamRing()
+{
+    close();
+}
+
+/*!
+ *  \brief Создает кольцо.
+ *  \param[in] name Имя объекта разделяемой памяти.
+ *  \param[in] capacityBytes Размер кольца, байты.
+ *  \return false, если объект создать не удалось.
+ */
+bool SharedStreamRing::create(const QString &name, qint64 capacityBytes)
+{
+    close();
+#if defined(Q_OS_UNIX)
+    qint64 capacity = kMinCapacityBytes;
+    while (capacity < qMin(capacityBytes, kMaxCapacityBytes)) {
+        capacity <<= 1;
+    }
+
+    const QByteArray path = objectName(name);
+    ::shm_unlink(path.constData());
+    const int fd = ::shm_open(path.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    const qint64 bytes = kRingHeaderBytes + capacity;
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0 || !map(fd, bytes)) {
+        ::close(fd);
+        ::shm_unlink(path.constData());
+        return false;
+    }
+    ::close(fd);
+    m_ownedName = path;
+
+    // Объект создан нулями; сигнатура пишется последней, чтобы читатель не
+    // увидел незаполненный заголовок.
+    RingHeader *header = new (m_header) RingHeader{};
+    header->version = kVersion;
+    header->capacityBytes = static_cast<quint64>(capacity);
+    header->magic.store(kRingMagic, std::memory_order_release);
+    m_capacity = static_cast<quint64>(capacity);
+    return true;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(capacityBytes);
+    return false;
+#endif
+}
+
+/*!
+ *  \brief Открывает кольцо, созданное писателем.
+ *  \param[in] name Имя объекта разделяемой памяти.
+ *  \return false, если объекта нет или он не является кольцом потока.
+ */
+bool SharedStreamRing::open(const QString &name)
+{
+    close();
+#if defined(Q_OS_UNIX)
+    const QByteArray path = objectName(name);
+    const int fd = ::shm_open(path.constData(), O_RDWR, 0);
+    if (fd < 0) {
+        return false;
+    }
+    const off_t size = ::lseek(fd, 0, SEEK_END);
+    if (size < static_cast<off_t>(kRingHeaderBytes + kMinCapacityBytes) || !map(fd, size)) {
+        ::close(fd);
+        return false;
+    }
+    ::close(fd);
+
+    const quint64 capacity = m_header->capacityBytes;
+    if (m_header->magic.load(std::memory_order_acquire) != kRingMagic || m_header->version != kVersion
+        || capacity == 0 || (capacity & (capacity - 1)) != 0
+        || capacity > static_cast<quint64>(m_mappedBytes - kRingHeaderBytes)) {
+        close();
+        return false;
+    }
+    m_capacity = capacity;
+    m_position = m_header->readIndex.load(std::memory_order_relaxed);
+    m_peerPosition = m_position;
+    return true;
+#else
+    Q_UNUSED(name);
+    return false;
+#endif
+}
+
+//! \brief Снимает отображение.
+void SharedStreamRing::close()
+{
+#if defined(Q_OS_UNIX)
+    if (m_header) {
+        ::munmap(m_header, static_cast<size_t>(m_mappedBytes));
+    }
+    if (!m_ownedName.isEmpty()) {
+        ::shm_unlink(m_ownedName.constData());
+    }
+#endif
+    m_header = nullptr;
+    m_ring = nullptr;
+    m_capacity = 0;
+    m_mappedBytes = 0;
+    m_position = 0;
+    m_peerPosition = 0;
+    m_ownedName.clear();
+}
+
+//! \brief Возвращает число пакетов, не записанных из-за переполнения.
+quint64 SharedStreamRing::droppedPackets() const noexcept
+{
+    return m_header ? m_header->droppedPackets.load(std::memory_order_relaxed) : 0;
+}
+
+/*!
+ *  \brief Записывает пакет.
+ *  \param[in] header Заголовок пакета.
+ *  \param[in] payload Данные пакета.
+ *  \return false, если в кольце нет места.
+ */
+bool SharedStreamRing::write(const PacketHeader &header, const void *payload)
+{
+    if (!m_header) {
+        return false;
+    }
+    const quint64 recordBytes = static_cast<quint64>(ringRecordBytes(header.payloadBytes));
+    const quint64 offset = m_position & (m_capacity - 1);
+    const quint64 tail = m_capacity - offset;
+    const quint64 skip = recordBytes > tail ? tail : 0;
+    const quint64 needed = skip + recordBytes;
+
+    // Позиция читателя перечитывается, только когда по старой места не хватает.
+    if (m_position + needed - m_peerPosition > m_capacity) {
+        m_peerPosition = m_header->readIndex.load(std::memory_order_acquire);
+        if (m_position + needed - m_peerPosition > m_capacity) {
+            return false;
+        }
+    }
+
+    if (skip != 0 && tail >= static_cast<quint64>(kPacketHeaderBytes)) {
+        PacketHeader padding{};
+        padding.magic = kPacketMagic;
+        padding.version = kVersion;
+        padding.type = static_cast<quint16>(PacketType::Padding);
+        padding.payloadBytes = static_cast<quint32>(tail - kPacketHeaderBytes);
+        std::memcpy(m_ring + offset, &padding, sizeof(padding));
+    }
+    uchar *record = m_ring + ((m_position + skip) & (m_capacity - 1));
+    std::memcpy(record, &header, sizeof(header));
+    if (header.payloadBytes > 0) {
+        std::memcpy(record + kPacketHeaderBytes, payload, header.payloadBytes);
+    }
+    m_position += needed;
+    m_header->writeIndex.store(m_position, std::memory_order_release);
+    return true;
+}
+
+//! \brief Учитывает пакет, отброшенный писателем из-за переполнения.
+void SharedStreamRing::reportDropped() noexcept
+{
+    if (m_header) {
+        m_header->droppedPackets.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/*!
+ *  \brief Возвращает очередную непрочитанную запись.
+ *  \param[out] recordBytes Размер записи вместе с пропущенным заполнителем, байты.
+ *  \return Заголовок пакета или nullptr, если записей нет.
+ */
+const PacketHeader *SharedStreamRing::begin(quint64 &recordBytes)
+{
+    recordBytes = 0;
+    if (!m_header) {
+        return nullptr;
+    }
+    for (;;) {
+        const quint64 position = m_position + recordBytes;
+        if (position == m_peerPosition) {
+            m_peerPosition = m_header->writeIndex.load(std::memory_order_acquire);
+            if (position == m_peerPosition) {
+                release(recordBytes);
+                recordBytes = 0;
+                return nullptr;
+            }
+        }
+        const quint64 offset = position & (m_capacity - 1);
+        const quint64 tail = m_capacity - offset;
+        if (tail < static_cast<quint64>(kPacketHeaderBytes)) {
+            recordBytes += tail;
+            continue;
+        }
+        const auto *header = reinterpret_cast<const PacketHeader *>(m_ring + offset);
+        const quint64 bytes = static_cast<quint64>(ringRecordBytes(header->payloadBytes));
+        if (header->magic != kPacketMagic || bytes > tail) {
+            // Испорченная запись: остаток кольца до позиции писателя пропускается.
+            release(m_peerPosition - m_position);
+            recordBytes = 0;
+            return nullptr;
+        }
+        if (header->type == static_cast<quint16>(PacketType::Padding)) {
+            recordBytes += tail;
+            continue;
+        }
+        recordBytes += bytes;
+        return header;
+    }
+}
+
+/*!
+ *  \brief Отпускает прочитанные записи.
+ *  \param[in] bytes Суммарный размер записей, полученных от begin().
+ */
+void SharedStreamRing::release(quint64 bytes)
+{
+    if (!m_header || bytes == 0) {
+        return;
+    }
+    m_position += bytes;
+    m_header->readIndex.store(m_position, std::memory_order_release);
+}
+
+/*!
+ *  \brief Отображает объект разделяемой памяти.
+ *  \param[in] fd Дескриптор объекта.
+ *  \param[in] bytes Размер отображения, байты.
+ *  \return false, если отобразить не удалось.
+ */
+bool SharedStreamRing::map(int fd, qint64 bytes)
+{
+#if defined(Q_OS_UNIX)
+    void *data = ::mmap(nullptr, static_cast<size_t>(bytes), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    m_header = static_cast<RingHeader *>(data);
+    m_ring = static_cast<uchar *>(data) + kRingHeaderBytes;
+    m_mappedBytes = bytes;
+    return true;
+#else
+    Q_UNUSED(fd);
+    Q_UNUSED(bytes);
+    return false;
+#endif
+}
@@ -0,0 +1,105 @@
+/*!
+ *  \file sharedstreamring.h
+ *  \brief Кольцевой буфер пакетов потока в разделяемой памяти.
+ */
+#ifndef SHAREDSTREAMRING_H
+#define SHAREDSTREAMRING_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+#include "streamformat.h"
+
+/*!
+ *  \class SharedStreamRing
+ *  \brief Отображение кольцевого буфера StreamFormat в разделяемую память.
+ *
+ *  Процесс РПУ создает кольцо (create()) и пишет пакеты (write()),
+ *  приложение открывает его (open()) и читает записи через begin() и
+ *  release(): запись остается в кольце, пока читатель не отпустит ее,
+ *  поэтому данные копируются прямо из разделяемой памяти в место
+ *  назначения. Кольцо рассчитано на одного писателя и одного читателя в
+ *  разных процессах; поддерживается на платформах POSIX.
+ */
+class SharedStreamRing
+{
+public:
+    //! \brief Конструирует закрытое кольцо.
+    SharedStreamRing() = default;
+    //! \brief Снимает отображение (объект, созданный create(), удаляется).
+    ~SharedStreamRing();
+
+    SharedStreamRing(const SharedStreamRing &) = delete;
+    SharedStreamRing &operator=(const SharedStreamRing &) = delete;
+
+    /*!
+     *  \brief Создает кольцо (писатель).
+     *  \param[in] name Имя объекта разделяемой памяти.
+     *  \param[in] capacityBytes Размер кольца, байты (округляется вверх до степени двойки).
+     *  \return false, если объект создать не удалось.
+     */
+    bool create(const QString &name, qint64 capacityBytes);
+    /*!
+     *  \brief Открывает кольцо, созданное писателем (читатель).
+     *  \param[in] name Имя объекта разделяемой памяти.
+     *  \return false, если объекта нет или он не является кольцом потока.
+     */
+    bool open(const QString &name);
+    //! \brief Снимает отображение.
+    void close();
+    //! \brief Проверяет, отображено ли кольцо.
+    bool isOpen() const noexcept { return m_header != nullptr; }
+
+    //! \brief Возвращает размер кольца, байты.
+    quint64 capacityBytes() const noexcept { return m_capacity; }
+    //! \brief Возвращает число пакетов, не записанных из-за переполнения.
+    quint64 droppedPackets() const noexcept;
+
+    /*!
+     *  \brief Записывает пакет (только писатель).
+     *  \param[in] header Заголовок пакета; payloadBytes задает размер данных.
+     *  \param[in] payload Данные пакета.
+     *  \return false, если в кольце нет места.
+     */
+    bool write(const StreamFormat::PacketHeader &header, const void *payload);
+    //! \brief Учитывает пакет, отброшенный писателем из-за переполнения (только писатель).
+    void reportDropped() noexcept;
+
+    /*!
+     *  \brief Возвращает очередную непрочитанную запись (только читатель).
+     *
+     *  Заполнители пропускаются; если записей нет, пропущенные заполнители
+     *  отпускаются сразу. Запись действительна до release().
+     *
+     *  \param[out] recordBytes Размер записи вместе с пропущенным заполнителем, байты.
+     *  \return Заголовок пакета, за которым следуют его данные, или nullptr, если записей нет.
+     */
+    const StreamFormat::PacketHeader *begin(quint64 &recordBytes);
+    /*!
+     *  \brief Отпускает прочитанные записи, освобождая место писателю (только читатель).
+     *  \param[in] bytes Суммарный размер записей, полученных от begin().
+     */
+    void release(quint64 bytes);
+
+private:
+    //! \brief Отображает объект разделяемой памяти заданного размера.
+    bool map(int fd, qint64 bytes);
+
+    //! \brief Заголовок кольца в разделяемой памяти.
+    StreamFormat::RingHeader *m_header = nullptr;
+    //! \brief Начало кольца.
+    uchar *m_ring = nullptr;
+    //! \brief Размер кольца, байты.
+    quint64 m_capacity = 0;
+    //! \brief Размер отображения, байты.
+    qint64 m_mappedBytes = 0;
+    //! \brief Локальная копия позиции: записи у писателя, чтения у читателя.
+    quint64 m_position = 0;
+    //! \brief Последняя прочитанная позиция другой стороны.
+    quint64 m_peerPosition = 0;
+    //! \brief Имя объекта, созданного этим процессом (удаляется при закрытии).
+    QByteArray m_ownedName;
+};
+
+#endif // SHAREDSTREAMRING_H
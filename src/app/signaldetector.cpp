@@ -0,0 +1,310 @@
+/*!
+ *  \file signaldetector.cpp
+ *  \brief Реализация SignalDetector.
+ */
+#include "signaldetector.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+/*!
+ *  \brief Находит первый бит маски со значением value, начиная с позиции from.
+ *  \param[in] mask Маска.
+ *  \param[in] count Количество значений маски.
+ *  \param[in] from Начальная позиция.
+ *  \param[in] value Искомое значение бита.
+ *  \return Позиция бита или count, если такого нет.
+ */
+std::int64_t findBit(const std::uint64_t *mask, std::int64_t count, std::int64_t from, bool value)
+{
+    const std::uint64_t invert = value ? 0 : ~std::uint64_t(0);
+    std::int64_t word = from / 64;
+    const std::int64_t words = DetectorKernel::maskWords(count);
+    if (word >= words) {
+        return count;
+    }
+
+    // Пустые слова (64 значения без превышений) пропускаются целиком.
+    std::uint64_t bits = (mask[word] ^ invert) & (~std::uint64_t(0) << (from % 64));
+    while (bits == 0) {
+        if (++word >= words) {
+            return count;
+        }
+        bits = mask[word] ^ invert;
+    }
+    return std::min(count, word * 64 + qCountTrailingZeroBits(bits));
+}
+
+} // namespace
+
+//! \brief Конструирует детектор с параметрами по умолчанию и без полос.
+SignalDetector::SignalDetector()
+    : m_variant(DetectorKernel::bestVariant())
+{
+}
+
+/*!
+ *  \brief Публикует параметры обнаружения.
+ *  \param[in] settings Параметры.
+ */
+void SignalDetector::setSettings(const Settings &settings)
+{
+    m_settingsRequests.writeBuffer() = normalized(settings);
+    m_settingsRequests.publish();
+}
+
+/*!
+ *  \brief Публикует полосы обнаружения.
+ *  \param[in] bands Полосы.
+ */
+void SignalDetector::setBands(const std::vector<Band> &bands)
+{
+    m_bandRequests.writeBuffer() = bands;
+    m_bandRequests.publish();
+}
+
+/*!
+ *  \brief Обнаруживает сигналы в кадре и ставит пакет в очередь.
+ *  \param[in] frame Кадр спектра.
+ *  \return true, если потоку UI нужно отправить уведомление о пакетах.
+ */
+bool SignalDetector::process(const SpectrumFrame &frame)
+{
+    if (m_settingsRequests.consume()) {
+        m_settings = m_settingsRequests.readBuffer();
+    }
+    if (m_bandRequests.consume()) {
+        m_bands = m_bandRequests.readBuffer();
+    }
+    // Последний пакет остается в детекторе для пеленгации в том же потоке,
+    // в очередь уходит копия.
+    m_lastBatch.signalList.clear();
+
+    const bool anyEnabled = std::any_of(m_bands.cbegin(), m_bands.cend(), [](const Band &band) {
+        return band.enabled && band.maxHz > band.minHz;
+    });
+    if (!frame.isValid() || !anyEnabled) {
+        return false;
+    }
+
+    if (m_settings.method == Method::CellAveraging) {
+        // Префиксные суммы считаются один раз на кадр для всех полос.
+        const int count = frame.binCount();
+        const float *bins = frame.constBins();
+        m_prefix.resize(static_cast<size_t>(count) + 1);
+        double sum = 0.0;
+        m_prefix[0] = 0.0;
+        for (int i = 0; i < count; ++i) {
+            sum += bins[i];
+            m_prefix[static_cast<size_t>(i) + 1] = sum;
+        }
+    }
+
+    m_lastBatch.timestampUs = frame.timestampUs();
+    m_lastBatch.sequence = frame.sequence();
+    for (const Band &band : std::as_const(m_bands)) {
+        if (band.enabled && band.maxHz > band.minHz) {
+            detectBand(frame, band, m_lastBatch);
+        }
+    }
+
+    if (!m_batches.tryPush(SignalBatch(m_lastBatch))) {
+        m_droppedBatches.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return !m_notifyPending.exchange(true, std::memory_order_acq_rel);
+}
+
+/*!
+ *  \brief Забирает очередной пакет.
+ *  \param[out] batch Пакет.
+ *  \return false, если очередь пуста.
+ */
+bool SignalDetector::takeBatch(SignalBatch &batch)
+{
+    // Сбрасываем признак до чтения: пакет, поставленный после tryPop(),
+    // гарантированно вызовет новое уведомление.
+    m_notifyPending.store(false, std::memory_order_release);
+    return m_batches.tryPop(batch);
+}
+
+//! \brief Приводит параметры к допустимым значениям.
+SignalDetector::Settings SignalDetector::normalized(const Settings &settings) noexcept
+{
+    Settings result = settings;
+    result.method = static_cast<Method>(
+        qBound(int(Method::Threshold), static_cast<int>(settings.method), int(Method::OrderedStatistic)));
+    result.guardCells = qBound(0, settings.guardCells, 1024);
+    result.trainingCells = qBound(1, settings.trainingCells, 1024);
+    result.offsetDb = qBound(0.0, settings.offsetDb, 100.0);
+    result.orderedRank = qBound(0.0, settings.orderedRank, 1.0);
+    result.mergeGapBins = qBound(0, settings.mergeGapBins, 1024);
+    return result;
+}
+
+/*!
+ *  \brief Обнаруживает сигналы в одной полосе.
+ *  \param[in] frame Кадр спектра.
+ *  \param[in] band Полоса.
+ *  \param[in,out] batch Пакет, в который добавляются сигналы.
+ */
+void SignalDetector::detectBand(const SpectrumFrame &frame, const Band &band, SignalBatch &batch)
+{
+    const std::int64_t count = frame.binCount();
+    const std::int64_t first = qBound<std::int64_t>(0, static_cast<std::int64_t>(std::floor(frame.binPosition(band.minHz))), count);
+    const std::int64_t last = qBound<std::int64_t>(0, static_cast<std::int64_t>(std::ceil(frame.binPosition(band.maxHz))), count);
+    const std::int64_t length = last - first;
+    if (length <= 0) {
+        return;
+    }
+
+    const float *bins = frame.constBins();
+    const float floor = static_cast<float>(band.thresholdDb);
+    m_mask.resize(static_cast<size_t>(DetectorKernel::maskWords(length)));
+
+    const bool adaptive = m_settings.method != Method::Threshold;
+    if (adaptive) {
+        m_thresholds.resize(static_cast<size_t>(length));
+        if (m_settings.method == Method::CellAveraging) {
+            DetectorKernel::cellAveragingThreshold(m_variant, m_prefix.data(), count, first, last,
+                                                   m_settings.guardCells, m_settings.trainingCells,
+                                                   static_cast<float>(m_settings.offsetDb), floor,
+                                                   m_thresholds.data());
+        } else {
+            orderedStatisticThreshold(bins, count, first, last, floor);
+        }
+        DetectorKernel::compare(m_variant, bins + first, m_thresholds.data(), length, m_mask.data());
+    } else {
+        DetectorKernel::compare(m_variant, bins + first, length, floor, m_mask.data());
+    }
+
+    const double binHz = (frame.viewMaxHz() - frame.viewMinHz()) / static_cast<double>(count);
+    const auto addSignal = [&](std::int64_t runFirst, std::int64_t runLast) {
+        if (static_cast<int>(batch.signalList.size()) >= kMaxSignalsPerFrame) {
+            batch.truncated = true;
+            return;
+        }
+        const float *runBins = bins + first + runFirst;
+        const std::int64_t peak = std::max_element(runBins, runBins + (runLast - runFirst)) - runBins + runFirst;
+
+        SignalEntity entity;
+        entity.timestampUs = batch.timestampUs;
+        entity.bandId = band.id;
+        entity.frequencyHz = frame.viewMinHz() + (first + (runFirst + runLast) * 0.5) * binHz;
+        entity.bandwidthHz = static_cast<double>(runLast - runFirst) * binHz;
+        entity.amplitudeDb = bins[first + peak];
+        entity.thresholdDb = adaptive ? m_thresholds[static_cast<size_t>(peak)] : floor;
+        batch.signalList.push_back(entity);
+    };
+
+    // Серии установленных битов, разделенные не более чем mergeGapBins
+    // значениями, объединяются в один сигнал [runFirst, runLast).
+    std::int64_t runFirst = -1;
+    std::int64_t runLast = -1;
+    for (std::int64_t position = findBit(m_mask.data(), length, 0, true); position < length;) {
+        const std::int64_t end = findBit(m_mask.data(), length, position, false);
+        if (runFirst >= 0 && position - runLast > m_settings.mergeGapBins) {
+            addSignal(runFirst, runLast);
+            runFirst = -1;
+        }
+        if (runFirst < 0) {
+            runFirst = position;
+        }
+        runLast = end;
+        position = findBit(m_mask.data(), length, end, true);
+    }
+    if (runFirst >= 0) {
+        addSignal(runFirst, runLast);
+    }
+}
+
+/*!
+ *  \brief Вычисляет пороги OS-CFAR для значений [first, last).
+ *
+ *  Обучающие ячейки ведутся гистограммой квантованных уровней: при сдвиге
+ *  на одну ячейку в окна входят и выходят по два значения, а уровень
+ *  порядковой статистики сдвигается от предыдущего на несколько шагов.
+ *
+ *  \param[in] bins Значения кадра.
+ *  \param[in] count Количество значений кадра.
+ *  \param[in] first Первое значение.
+ *  \param[in] last Значение за последним.
+ *  \param[in] floor Нижняя граница порога, дБ.
+ */
+void SignalDetector::orderedStatisticThreshold(const float *bins, std::int64_t count, std::int64_t first,
+                                               std::int64_t last, float floor)
+{
+    const std::int64_t guard = m_settings.guardCells;
+    const std::int64_t training = m_settings.trainingCells;
+    const float offset = static_cast<float>(m_settings.offsetDb);
+    const double rank = m_settings.orderedRank;
+    m_histogram.assign(kOrderedLevels, 0);
+
+    // Уровни квантуются один раз для значений, входящих в окна диапазона.
+    const std::int64_t windowFirst = std::max<std::int64_t>(0, first - guard - training);
+    const std::int64_t windowLast = std::min(count, last + guard + training);
+    m_levels.resize(static_cast<size_t>(windowLast - windowFirst));
+    for (std::int64_t i = windowFirst; i < windowLast; ++i) {
+        const float level = (bins[i] - kOrderedMinDb) * kOrderedLevelsPerDb;
+        m_levels[static_cast<size_t>(i - windowFirst)] =
+            static_cast<std::uint16_t>(level >= 0.0f ? std::min<float>(kOrderedLevels - 1, level) : 0.0f);
+    }
+
+    // Уровень ranked — уровень искомой статистики, below — число ячеек ниже него.
+    int cells = 0;
+    int ranked = 0;
+    int below = 0;
+    int *histogram = m_histogram.data();
+    const std::uint16_t *levels = m_levels.data() - windowFirst;
+    const auto add = [&](std::int64_t i) {
+        if (i >= 0 && i < count) {
+            const int level = levels[i];
+            ++histogram[level];
+            ++cells;
+            below += level < ranked ? 1 : 0;
+        }
+    };
+    const auto remove = [&](std::int64_t i) {
+        if (i >= 0 && i < count) {
+            const int level = levels[i];
+            --histogram[level];
+            --cells;
+            below -= level < ranked ? 1 : 0;
+        }
+    };
+
+    for (std::int64_t i = first - guard - training; i < first - guard; ++i) {
+        add(i);
+    }
+    for (std::int64_t i = first + guard + 1; i <= first + guard + training; ++i) {
+        add(i);
+    }
+
+    for (std::int64_t i = first; i < last; ++i) {
+        if (i > first) {
+            remove(i - guard - training - 1);
+            add(i - guard - 1);
+            remove(i + guard);
+            add(i + guard + training);
+        }
+
+        float threshold = floor;
+        if (cells > 0) {
+            const int k = static_cast<int>(rank * (cells - 1));
+            while (below > k) {
+                below -= histogram[--ranked];
+            }
+            while (below + histogram[ranked] <= k) {
+                below += histogram[ranked++];
+            }
+            const float noise = kOrderedMinDb + (static_cast<float>(ranked) + 0.5f) / kOrderedLevelsPerDb;
+            threshold = std::max(floor, noise + offset);
+        }
+        m_thresholds[static_cast<size_t>(i - first)] = threshold;
+    }
+}
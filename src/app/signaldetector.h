@@ -0,0 +1,181 @@
+/*!
+ *  \file signaldetector.h
+ *  \brief Обнаружение сигналов в кадрах спектра по порогам полос и CFAR.
+ */
+#ifndef SIGNALDETECTOR_H
+#define SIGNALDETECTOR_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "detectorkernel.h"
+#include "latestvalueslot.h"
+#include "signalentity.h"
+#include "spectrumframe.h"
+#include "spscqueue.h"
+
+/*!
+ *  \class SignalDetector
+ *  \brief Выделяет сигналы в полосах обнаружения и выдает их пакетами по кадрам.
+ *
+ *  В каждой включенной полосе значения кадра сравниваются с порогом:
+ *  постоянным порогом полосы или порогом CFAR (CA — среднее обучающих
+ *  ячеек, OS — их порядковая статистика) плюс превышение, но не ниже
+ *  порога полосы. Шум оценивается по значениям в дБ; порядковая статистика
+ *  OS-CFAR ведется скользящей гистограммой с шагом 1/8 дБ, поэтому
+ *  обходится без сортировки окна для каждой ячейки. Сравнение выполняется
+ *  векторными ядрами DetectorKernel в битовую маску, из которой
+ *  выделяются серии соседних значений; серии с разрывом не больше
+ *  mergeGapBins объединяются в один сигнал.
+ *
+ *  Параметры и полосы публикуются из потока UI через LatestValueSlot и
+ *  применяются потоком DSP перед очередным кадром. Пакеты передаются в
+ *  поток UI через SpscQueue; при переполнении очереди пакет отбрасывается
+ *  и учитывается в droppedBatches().
+ */
+class SignalDetector
+{
+public:
+    //! \brief Способ вычисления порога.
+    enum class Method : int {
+        //! \brief Постоянный порог полосы.
+        Threshold = 0,
+        //! \brief CA-CFAR: среднее обучающих ячеек.
+        CellAveraging = 1,
+        //! \brief OS-CFAR: порядковая статистика обучающих ячеек.
+        OrderedStatistic = 2
+    };
+
+    //! \brief Параметры обнаружения.
+    struct Settings
+    {
+        //! \brief Способ вычисления порога.
+        Method method = Method::Threshold;
+        //! \brief Число защитных ячеек CFAR с каждой стороны.
+        int guardCells = 4;
+        //! \brief Число обучающих ячеек CFAR с каждой стороны.
+        int trainingCells = 16;
+        //! \brief Превышение порога CFAR над оценкой шума, дБ.
+        double offsetDb = 10.0;
+        //! \brief Ранг порядковой статистики OS-CFAR в долях обучающих ячеек, 0..1.
+        double orderedRank = 0.75;
+        //! \brief Наибольший разрыв между значениями одного сигнала, значения.
+        int mergeGapBins = 1;
+    };
+
+    //! \brief Полоса обнаружения.
+    struct Band
+    {
+        //! \brief Идентификатор полосы.
+        int id = 0;
+        //! \brief Нижняя граница, Гц.
+        double minHz = 0.0;
+        //! \brief Верхняя граница, Гц.
+        double maxHz = 0.0;
+        //! \brief Порог полосы, дБ.
+        double thresholdDb = -80.0;
+        //! \brief Признак включения.
+        bool enabled = true;
+    };
+
+    //! \brief Наибольшее число сигналов в пакете одного кадра.
+    static constexpr int kMaxSignalsPerFrame = 4096;
+    //! \brief Нижняя граница шкалы гистограммы OS-CFAR, дБ.
+    static constexpr float kOrderedMinDb = -200.0f;
+    //! \brief Число уровней гистограммы OS-CFAR на 1 дБ.
+    static constexpr int kOrderedLevelsPerDb = 8;
+    //! \brief Число уровней гистограммы OS-CFAR (шкала -200..+56 дБ).
+    static constexpr int kOrderedLevels = 2048;
+    //! \brief Емкость очереди пакетов.
+    static constexpr std::size_t kQueueCapacity = 64;
+
+    //! \brief Конструирует детектор с параметрами по умолчанию и без полос.
+    SignalDetector();
+
+    /*!
+     *  \brief Публикует параметры обнаружения (один поток-писатель, обычно UI).
+     *  \param[in] settings Параметры.
+     */
+    void setSettings(const Settings &settings);
+    /*!
+     *  \brief Публикует полосы обнаружения (тот же поток-писатель).
+     *  \param[in] bands Полосы.
+     */
+    void setBands(const std::vector<Band> &bands);
+
+    /*!
+     *  \brief Обнаруживает сигналы в кадре и ставит пакет в очередь (поток DSP).
+     *  \param[in] frame Кадр спектра.
+     *  \return true, если потоку UI нужно отправить уведомление о пакетах.
+     */
+    bool process(const SpectrumFrame &frame);
+
+    /*!
+     *  \brief Забирает очередной пакет (поток UI).
+     *  \param[out] batch Пакет.
+     *  \return false, если очередь пуста.
+     */
+    bool takeBatch(SignalBatch &batch);
+    //! \brief Возвращает пакет последнего обработанного кадра (поток DSP).
+    const SignalBatch &lastBatch() const noexcept { return m_lastBatch; }
+
+    //! \brief Возвращает число пакетов, отброшенных из-за переполнения очереди.
+    quint64 droppedBatches() const noexcept { return m_droppedBatches.load(std::memory_order_relaxed); }
+
+    //! \brief Приводит параметры к допустимым значениям.
+    static Settings normalized(const Settings &settings) noexcept;
+
+private:
+    /*!
+     *  \brief Обнаруживает сигналы в одной полосе.
+     *  \param[in] frame Кадр спектра.
+     *  \param[in] band Полоса.
+     *  \param[in,out] batch Пакет, в который добавляются сигналы.
+     */
+    void detectBand(const SpectrumFrame &frame, const Band &band, SignalBatch &batch);
+    /*!
+     *  \brief Вычисляет пороги OS-CFAR для значений [first, last).
+     *  \param[in] bins Значения кадра.
+     *  \param[in] count Количество значений кадра.
+     *  \param[in] first Первое значение.
+     *  \param[in] last Значение за последним.
+     *  \param[in] floor Нижняя граница порога, дБ.
+     */
+    void orderedStatisticThreshold(const float *bins, std::int64_t count, std::int64_t first, std::int64_t last,
+                                   float floor);
+
+    //! \brief Слот параметров (UI -> DSP).
+    LatestValueSlot<Settings> m_settingsRequests;
+    //! \brief Слот полос (UI -> DSP).
+    LatestValueSlot<std::vector<Band>> m_bandRequests;
+    //! \brief Очередь пакетов (DSP -> UI).
+    SpscQueue<SignalBatch, kQueueCapacity> m_batches;
+    //! \brief Пакет последнего обработанного кадра (поток DSP).
+    SignalBatch m_lastBatch;
+    //! \brief Признак отправленного и еще не обработанного уведомления.
+    std::atomic<bool> m_notifyPending{false};
+    //! \brief Число отброшенных пакетов.
+    std::atomic<quint64> m_droppedBatches{0};
+
+    //! \brief Вариант векторных ядер.
+    DetectorKernel::Variant m_variant;
+    //! \brief Действующие параметры (поток DSP).
+    Settings m_settings;
+    //! \brief Действующие полосы (поток DSP).
+    std::vector<Band> m_bands;
+    //! \brief Префиксные суммы значений кадра для CA-CFAR.
+    std::vector<double> m_prefix;
+    //! \brief Пороги значений полосы.
+    std::vector<float> m_thresholds;
+    //! \brief Маска превышений порога.
+    std::vector<std::uint64_t> m_mask;
+    //! \brief Скользящая гистограмма обучающих ячеек OS-CFAR.
+    std::vector<int> m_histogram;
+    //! \brief Квантованные уровни значений для гистограммы OS-CFAR.
+    std::vector<std::uint16_t> m_levels;
+};
+
+#endif // SIGNALDETECTOR_H
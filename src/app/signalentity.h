@@ -0,0 +1,58 @@
+/*!
+ *  \file signalentity.h
+ *  \brief Обнаруженный сигнал и пакет обнаружений одного кадра.
+ */
+#ifndef SIGNALENTITY_H
+#define SIGNALENTITY_H
+
+#include <QMetaType>
+#include <QtGlobal>
+
+#include <limits>
+#include <vector>
+
+/*!
+ *  \struct SignalEntity
+ *  \brief Сигнал, обнаруженный в кадре спектра (см. модель данных в ARCHITECTURE.md).
+ */
+struct SignalEntity
+{
+    //! \brief Время кадра, мкс от начала эпохи.
+    qint64 timestampUs = 0;
+    //! \brief Идентификатор полосы, в которой обнаружен сигнал.
+    int bandId = -1;
+    //! \brief Центральная частота, Гц.
+    double frequencyHz = 0.0;
+    //! \brief Занимаемая полоса, Гц.
+    double bandwidthHz = 0.0;
+    //! \brief Пиковый уровень, дБ.
+    float amplitudeDb = 0.0f;
+    //! \brief Порог обнаружения в точке пика, дБ.
+    float thresholdDb = 0.0f;
+    //! \brief Длительность импульса, мкс; 0 — не измерена.
+    float pulseWidthUs = 0.0f;
+    //! \brief Азимут, градусы; NaN — пеленг не определен.
+    float azimuthDeg = std::numeric_limits<float>::quiet_NaN();
+    //! \brief Код класса сигнала; 0 — не классифицирован.
+    int classification = 0;
+};
+
+/*!
+ *  \struct SignalBatch
+ *  \brief Сигналы, обнаруженные в одном кадре.
+ */
+struct SignalBatch
+{
+    //! \brief Время кадра, мкс от начала эпохи.
+    qint64 timestampUs = 0;
+    //! \brief Номер кадра.
+    quint64 sequence = 0;
+    //! \brief Признак того, что часть обнаружений отброшена по ограничению числа сигналов.
+    bool truncated = false;
+    //! \brief Обнаруженные сигналы в порядке полос и частот.
+    std::vector<SignalEntity> signalList;
+};
+
+Q_DECLARE_METATYPE(SignalBatch)
+
+#endif // SIGNALENTITY_H
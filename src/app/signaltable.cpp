@@ -0,0 +1,448 @@
+/*!
+ *  \file signaltable.cpp
+ *  \brief Реализация SignalTable.
+ */
+#include "signaltable.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//! \brief Доля емкости, удаляемая сверх maxRows за один раз.
+constexpr int kEvictSlackDivisor = 16;
+
+//! \brief Удаляет первые count элементов вектора.
+template <typename T>
+void eraseFrontOf(std::vector<T> &values, int count)
+{
+    values.erase(values.begin(), values.begin() + qMin<qsizetype>(count, values.size()));
+}
+
+} // namespace
+
+template <typename Fn>
+void SignalColumns::forEachColumn(SignalColumns &target, const SignalColumns &source, Fn &&fn)
+{
+    fn(target.firstSeenUs, source.firstSeenUs);
+    fn(target.lastSeenUs, source.lastSeenUs);
+    fn(target.bandId, source.bandId);
+    fn(target.frequencyHz, source.frequencyHz);
+    fn(target.bandwidthHz, source.bandwidthHz);
+    fn(target.amplitudeDb, source.amplitudeDb);
+    fn(target.pulseWidthUs, source.pulseWidthUs);
+    fn(target.azimuthDeg, source.azimuthDeg);
+    fn(target.classification, source.classification);
+    fn(target.hits, source.hits);
+}
+
+//! \brief Удаляет все строки, сохраняя выделенную память.
+void SignalColumns::clear()
+{
+    forEachColumn(*this, *this, [](auto &column, const auto &) { column.clear(); });
+}
+
+/*!
+ *  \brief Удаляет первые строки.
+ *  \param[in] count Количество строк.
+ */
+void SignalColumns::eraseFront(int count)
+{
+    forEachColumn(*this, *this, [count](auto &column, const auto &) { eraseFrontOf(column, count); });
+}
+
+/*!
+ *  \brief Добавляет строку из другого хранилища.
+ *  \param[in] source Хранилище.
+ *  \param[in] row Строка в нем.
+ */
+void SignalColumns::appendRow(const SignalColumns &source, int row)
+{
+    const size_t index = static_cast<size_t>(row);
+    forEachColumn(*this, source, [index](auto &column, const auto &values) { column.push_back(values[index]); });
+}
+
+/*!
+ *  \brief Заменяет строку строкой из другого хранилища.
+ *  \param[in] row Заменяемая строка.
+ *  \param[in] source Хранилище.
+ *  \param[in] sourceRow Строка в нем.
+ */
+void SignalColumns::setRow(int row, const SignalColumns &source, int sourceRow)
+{
+    const size_t target = static_cast<size_t>(row);
+    const size_t index = static_cast<size_t>(sourceRow);
+    forEachColumn(*this, source, [target, index](auto &column, const auto &values) { column[target] = values[index]; });
+}
+
+/*!
+ *  \brief Добавляет строку по первому обнаружению сигнала.
+ *  \param[in] signal Обнаруженный сигнал.
+ */
+void SignalColumns::appendSignal(const SignalEntity &signal)
+{
+    firstSeenUs.push_back(signal.timestampUs);
+    lastSeenUs.push_back(signal.timestampUs);
+    bandId.push_back(signal.bandId);
+    frequencyHz.push_back(signal.frequencyHz);
+    bandwidthHz.push_back(signal.bandwidthHz);
+    amplitudeDb.push_back(signal.amplitudeDb);
+    pulseWidthUs.push_back(signal.pulseWidthUs);
+    azimuthDeg.push_back(signal.azimuthDeg);
+    classification.push_back(signal.classification);
+    hits.push_back(1);
+}
+
+/*!
+ *  \brief Задает параметры; смена сортировки или фильтра перестраивает порядок.
+ *  \param[in] settings Параметры.
+ */
+void SignalTable::setSettings(const Settings &settings)
+{
+    if (settings.sortColumn != m_settings.sortColumn || settings.sortDescending != m_settings.sortDescending
+        || settings.filterMinHz != m_settings.filterMinHz || settings.filterMaxHz != m_settings.filterMaxHz
+        || settings.filterMinDb != m_settings.filterMinDb) {
+        m_rebuild = true;
+    }
+    m_settings = settings;
+    m_settings.sortColumn = qBound(0, m_settings.sortColumn, ColumnCount - 1);
+    m_settings.maxRows = qMax(1, m_settings.maxRows);
+}
+
+/*!
+ *  \brief Объединяет пакет обнаружений со строками таблицы.
+ *  \param[in] batch Пакет обнаружений.
+ */
+void SignalTable::merge(const SignalBatch &batch)
+{
+    const std::vector<SignalEntity> &signalList = batch.signalList;
+    const auto byFrequency = [this](int left, int right) {
+        return m_rows.frequencyHz[static_cast<size_t>(left)] < m_rows.frequencyHz[static_cast<size_t>(right)];
+    };
+
+    for (size_t first = 0; first < signalList.size();) {
+        // Пакет упорядочен по полосам: обнаружения одной полосы идут подряд.
+        const int bandId = signalList[first].bandId;
+        size_t last = first;
+        while (last < signalList.size() && signalList[last].bandId == bandId) {
+            ++last;
+        }
+
+        std::vector<int> &active = m_active[bandId];
+        const qint64 expiredUs = batch.timestampUs - m_settings.mergeHoldUs;
+        active.erase(std::remove_if(active.begin(), active.end(),
+                                    [this, expiredUs](int row) {
+                                        return m_rows.lastSeenUs[static_cast<size_t>(row)] < expiredUs;
+                                    }),
+                     active.end());
+        m_taken.assign(active.size(), 0);
+
+        for (size_t i = first; i < last; ++i) {
+            const SignalEntity &signal = signalList[i];
+            m_maxBandwidthHz = qMax(m_maxBandwidthHz, signal.bandwidthHz);
+            const int match = findMatch(active, signal);
+            if (match < 0) {
+                active.push_back(m_rows.size());
+                m_rows.appendSignal(signal);
+                m_keys.push_back(0.0);
+                m_inView.push_back(0);
+                m_dirty.push_back(0);
+                continue;
+            }
+
+            m_taken[static_cast<size_t>(match)] = 1;
+            const int row = active[static_cast<size_t>(match)];
+            const size_t index = static_cast<size_t>(row);
+            m_rows.lastSeenUs[index] = signal.timestampUs;
+            m_rows.frequencyHz[index] = signal.frequencyHz;
+            m_rows.bandwidthHz[index] = signal.bandwidthHz;
+            m_rows.amplitudeDb[index] = qMax(m_rows.amplitudeDb[index], signal.amplitudeDb);
+            if (signal.pulseWidthUs > 0.0f) {
+                m_rows.pulseWidthUs[index] = signal.pulseWidthUs;
+            }
+            if (!std::isnan(signal.azimuthDeg)) {
+                m_rows.azimuthDeg[index] = signal.azimuthDeg;
+            }
+            if (signal.classification != 0) {
+                m_rows.classification[index] = signal.classification;
+            }
+            ++m_rows.hits[index];
+            markDirty(row);
+        }
+
+        // Новые строки добавлены в конец, а частоты совпавших могли сместиться.
+        std::sort(active.begin(), active.end(), byFrequency);
+        first = last;
+    }
+}
+
+//! \brief Удаляет все строки.
+void SignalTable::clear()
+{
+    m_rows.clear();
+    m_keys.clear();
+    m_inView.clear();
+    m_dirty.clear();
+    m_dirtyRows.clear();
+    m_order.clear();
+    m_active.clear();
+    m_maxBandwidthHz = 0.0;
+    m_committedRows = 0;
+    m_rebuild = false;
+}
+
+/*!
+ *  \brief Обновляет порядок строк и забирает накопленные изменения.
+ *  \param[out] changes Изменения; память векторов переиспользуется.
+ *  \return true, если таблица изменилась.
+ */
+bool SignalTable::takeChanges(Changes &changes)
+{
+    bool orderChanged = false;
+    changes.evicted = evict(orderChanged);
+
+    if (m_rebuild) {
+        rebuildOrder();
+        orderChanged = true;
+    } else if (updateOrder()) {
+        orderChanged = true;
+    }
+
+    changes.updatedRows.clear();
+    changes.updated.clear();
+    for (int row : m_dirtyRows) {
+        changes.updatedRows.push_back(row);
+        changes.updated.appendRow(m_rows, row);
+        m_dirty[static_cast<size_t>(row)] = 0;
+    }
+    m_dirtyRows.clear();
+
+    changes.inserted.clear();
+    for (int row = m_committedRows; row < m_rows.size(); ++row) {
+        changes.inserted.appendRow(m_rows, row);
+    }
+    m_committedRows = m_rows.size();
+
+    changes.orderChanged = orderChanged;
+    if (orderChanged) {
+        changes.order = m_order;
+    }
+    return orderChanged || changes.evicted > 0 || !changes.updatedRows.empty() || changes.inserted.size() > 0;
+}
+
+/*!
+ *  \brief Возвращает ключ сортировки строки.
+ *  \param[in] rows Строки.
+ *  \param[in] row Строка.
+ *  \param[in] column Колонка.
+ *  \return Значение колонки; неизвестный азимут меньше любого известного.
+ */
+double SignalTable::sortKey(const SignalColumns &rows, int row, int column) noexcept
+{
+    const size_t index = static_cast<size_t>(row);
+    switch (column) {
+    case TimeColumn:
+        return static_cast<double>(rows.firstSeenUs[index]);
+    case FrequencyColumn:
+        return rows.frequencyHz[index];
+    case BandwidthColumn:
+        return rows.bandwidthHz[index];
+    case AmplitudeColumn:
+        return rows.amplitudeDb[index];
+    case PulseWidthColumn:
+        return rows.pulseWidthUs[index];
+    case AzimuthColumn:
+        return std::isnan(rows.azimuthDeg[index]) ? -1.0 : rows.azimuthDeg[index];
+    case ClassificationColumn:
+        return rows.classification[index];
+    case HitsColumn:
+        return rows.hits[index];
+    default:
+        return 0.0;
+    }
+}
+
+//! \brief Проверяет строку по фильтру.
+bool SignalTable::passes(int row) const noexcept
+{
+    const size_t index = static_cast<size_t>(row);
+    const double frequencyHz = m_rows.frequencyHz[index];
+    return frequencyHz >= m_settings.filterMinHz && frequencyHz <= m_settings.filterMaxHz
+        && m_rows.amplitudeDb[index] >= m_settings.filterMinDb;
+}
+
+//! \brief Сравнивает строки в порядке сортировки.
+bool SignalTable::less(int left, int right) const noexcept
+{
+    const double leftKey = m_keys[static_cast<size_t>(left)];
+    const double rightKey = m_keys[static_cast<size_t>(right)];
+    if (leftKey != rightKey) {
+        return m_settings.sortDescending ? leftKey > rightKey : leftKey < rightKey;
+    }
+    // Номер строки разрешает равенство: при сортировке по времени по
+    // убыванию новые строки одного пакета оказываются сверху одним блоком.
+    return m_settings.sortDescending ? left > right : left < right;
+}
+
+/*!
+ *  \brief Ищет активную строку, с которой совпадает обнаружение.
+ *  \param[in] active Активные строки полосы, упорядоченные по частоте.
+ *  \param[in] signal Обнаружение.
+ *  \return Индекс в active; -1, если совпадения нет.
+ */
+int SignalTable::findMatch(const std::vector<int> &active, const SignalEntity &signal) const
+{
+    // Просматриваются только строки, упорядоченные до начала пакета;
+    // добавленные в этом пакете новые строки лежат в конце и не сортированы.
+    const size_t sortedCount = m_taken.size();
+    const double reachHz = 0.5 * (signal.bandwidthHz + m_maxBandwidthHz) + m_settings.mergeToleranceHz;
+    const auto begin = active.cbegin();
+    const auto end = active.cbegin() + static_cast<qsizetype>(sortedCount);
+    auto it = std::lower_bound(begin, end, signal.frequencyHz - reachHz, [this](int row, double frequencyHz) {
+        return m_rows.frequencyHz[static_cast<size_t>(row)] < frequencyHz;
+    });
+
+    int best = -1;
+    double bestDistanceHz = 0.0;
+    for (; it != end; ++it) {
+        const size_t index = static_cast<size_t>(*it);
+        const double distanceHz = std::abs(m_rows.frequencyHz[index] - signal.frequencyHz);
+        if (m_rows.frequencyHz[index] > signal.frequencyHz + reachHz) {
+            break;
+        }
+        const size_t position = static_cast<size_t>(it - begin);
+        const double overlapHz = 0.5 * (signal.bandwidthHz + m_rows.bandwidthHz[index]) + m_settings.mergeToleranceHz;
+        if (m_taken[position] == 0 && distanceHz <= overlapHz && (best < 0 || distanceHz < bestDistanceHz)) {
+            best = static_cast<int>(position);
+            bestDistanceHz = distanceHz;
+        }
+    }
+    return best;
+}
+
+//! \brief Отмечает прежнюю строку как измененную.
+void SignalTable::markDirty(int row)
+{
+    // Строки, еще не переданные в takeChanges(), уйдут целиком как новые.
+    if (row >= m_committedRows || m_dirty[static_cast<size_t>(row)] != 0) {
+        return;
+    }
+    m_dirty[static_cast<size_t>(row)] = 1;
+    m_dirtyRows.push_back(row);
+}
+
+/*!
+ *  \brief Удаляет самые старые переданные строки сверх maxRows.
+ *  \param[in,out] orderChanged Устанавливается, если удаленные строки были в порядке.
+ *  \return Количество удаленных строк.
+ */
+int SignalTable::evict(bool &orderChanged)
+{
+    if (m_rows.size() <= m_settings.maxRows) {
+        return 0;
+    }
+    // Удаляются только переданные строки, чтобы номера новых строк в
+    // изменениях оставались номерами после удаления.
+    const int count = qMin(m_rows.size() - m_settings.maxRows + m_settings.maxRows / kEvictSlackDivisor,
+                           m_committedRows);
+    if (count <= 0) {
+        return 0;
+    }
+
+    m_rows.eraseFront(count);
+    eraseFrontOf(m_keys, count);
+    eraseFrontOf(m_inView, count);
+    eraseFrontOf(m_dirty, count);
+    m_committedRows -= count;
+
+    const auto shift = [count](std::vector<int> &rows) {
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [count](int row) { return row < count; }), rows.end());
+        for (int &row : rows) {
+            row -= count;
+        }
+    };
+    const size_t orderSize = m_order.size();
+    shift(m_order);
+    orderChanged = orderChanged || m_order.size() != orderSize;
+    shift(m_dirtyRows);
+    for (auto it = m_active.begin(); it != m_active.end(); ++it) {
+        shift(it.value());
+    }
+    return count;
+}
+
+//! \brief Перестраивает порядок полностью.
+void SignalTable::rebuildOrder()
+{
+    m_rebuild = false;
+    m_order.clear();
+    for (int row = 0; row < m_rows.size(); ++row) {
+        const size_t index = static_cast<size_t>(row);
+        m_keys[index] = sortKey(m_rows, row, m_settings.sortColumn);
+        m_inView[index] = passes(row) ? 1 : 0;
+        if (m_inView[index] != 0) {
+            m_order.push_back(row);
+        }
+    }
+    std::sort(m_order.begin(), m_order.end(), [this](int left, int right) { return less(left, right); });
+}
+
+/*!
+ *  \brief Обновляет порядок по новым и измененным строкам.
+ *  \return true, если порядок изменился.
+ */
+bool SignalTable::updateOrder()
+{
+    constexpr char kRemoved = 2;
+
+    m_candidates.clear();
+    int removedCount = 0;
+    for (int row : m_dirtyRows) {
+        const size_t index = static_cast<size_t>(row);
+        const double key = sortKey(m_rows, row, m_settings.sortColumn);
+        const bool pass = passes(row);
+        const bool wasInView = m_inView[index] != 0;
+        const bool keyChanged = key != m_keys[index];
+        m_keys[index] = key;
+        if (wasInView && (keyChanged || !pass)) {
+            m_inView[index] = kRemoved;
+            ++removedCount;
+        }
+        if (pass && (!wasInView || keyChanged)) {
+            m_candidates.push_back(row);
+        }
+    }
+    if (removedCount > 0) {
+        m_order.erase(std::remove_if(m_order.begin(), m_order.end(),
+                                     [this](int row) { return m_inView[static_cast<size_t>(row)] == kRemoved; }),
+                      m_order.end());
+        for (int row : m_dirtyRows) {
+            if (m_inView[static_cast<size_t>(row)] == kRemoved) {
+                m_inView[static_cast<size_t>(row)] = 0;
+            }
+        }
+    }
+
+    for (int row = m_committedRows; row < m_rows.size(); ++row) {
+        m_keys[static_cast<size_t>(row)] = sortKey(m_rows, row, m_settings.sortColumn);
+        if (passes(row)) {
+            m_candidates.push_back(row);
+        }
+    }
+    if (m_candidates.empty()) {
+        return removedCount > 0;
+    }
+
+    const auto byOrder = [this](int left, int right) { return less(left, right); };
+    std::sort(m_candidates.begin(), m_candidates.end(), byOrder);
+    for (int row : m_candidates) {
+        m_inView[static_cast<size_t>(row)] = 1;
+    }
+    m_mergeBuffer.resize(m_order.size() + m_candidates.size());
+    std::merge(m_order.cbegin(), m_order.cend(), m_candidates.cbegin(), m_candidates.cend(), m_mergeBuffer.begin(),
+               byOrder);
+    m_order.swap(m_mergeBuffer);
+    return true;
+}
@@ -0,0 +1,253 @@
+/*!
+ *  \file signaltable.h
+ *  \brief Колоночное хранилище обнаруженных сигналов с инкрементными индексами сортировки и фильтра.
+ */
+#ifndef SIGNALTABLE_H
+#define SIGNALTABLE_H
+
+#include <QHash>
+#include <QtGlobal>
+
+#include <limits>
+#include <vector>
+
+#include "signalentity.h"
+
+/*!
+ *  \struct SignalColumns
+ *  \brief Строки таблицы сигналов, разложенные по колонкам.
+ *
+ *  Каждое поле хранится отдельным массивом: сортировка и фильтр проходят
+ *  только по нужной колонке, а строки добавляются без выделения памяти
+ *  под каждую запись.
+ */
+struct SignalColumns
+{
+    //! \brief Время первого обнаружения, мкс от начала эпохи.
+    std::vector<qint64> firstSeenUs;
+    //! \brief Время последнего обнаружения, мкс от начала эпохи.
+    std::vector<qint64> lastSeenUs;
+    //! \brief Идентификатор полосы.
+    std::vector<int> bandId;
+    //! \brief Центральная частота последнего обнаружения, Гц.
+    std::vector<double> frequencyHz;
+    //! \brief Занимаемая полоса последнего обнаружения, Гц.
+    std::vector<double> bandwidthHz;
+    //! \brief Наибольший пиковый уровень, дБ.
+    std::vector<float> amplitudeDb;
+    //! \brief Длительность импульса, мкс; 0 — не измерена.
+    std::vector<float> pulseWidthUs;
+    //! \brief Азимут, градусы; NaN — пеленг не определен.
+    std::vector<float> azimuthDeg;
+    //! \brief Код класса сигнала; 0 — не классифицирован.
+    std::vector<int> classification;
+    //! \brief Число обнаружений, объединенных в строку.
+    std::vector<quint32> hits;
+
+    //! \brief Возвращает число строк.
+    int size() const noexcept { return static_cast<int>(frequencyHz.size()); }
+    //! \brief Удаляет все строки, сохраняя выделенную память.
+    void clear();
+    /*!
+     *  \brief Удаляет первые строки.
+     *  \param[in] count Количество строк.
+     */
+    void eraseFront(int count);
+    /*!
+     *  \brief Добавляет строку из другого хранилища.
+     *  \param[in] source Хранилище.
+     *  \param[in] row Строка в нем.
+     */
+    void appendRow(const SignalColumns &source, int row);
+    /*!
+     *  \brief Заменяет строку строкой из другого хранилища.
+     *  \param[in] row Заменяемая строка.
+     *  \param[in] source Хранилище.
+     *  \param[in] sourceRow Строка в нем.
+     */
+    void setRow(int row, const SignalColumns &source, int sourceRow);
+    /*!
+     *  \brief Добавляет строку по первому обнаружению сигнала.
+     *  \param[in] signal Обнаруженный сигнал.
+     */
+    void appendSignal(const SignalEntity &signal);
+
+private:
+    //! \brief Применяет fn к парам одноименных колонок двух хранилищ.
+    template <typename Fn>
+    static void forEachColumn(SignalColumns &target, const SignalColumns &source, Fn &&fn);
+};
+
+/*!
+ *  \class SignalTable
+ *  \brief Объединяет пакеты обнаружений в строки и ведет отсортированный и отфильтрованный порядок.
+ *
+ *  Обнаружение, перекрывающееся по частоте с активной строкой той же полосы
+ *  (последнее обнаружение не старше mergeHoldUs), обновляет эту строку,
+ *  иначе добавляется новая. Пакет упорядочен по полосам и частотам, а
+ *  активные строки полосы — по частоте, поэтому сопоставление стоит
+ *  двоичного поиска на обнаружение.
+ *
+ *  Порядок строк (order) содержит строки, прошедшие фильтр, в порядке
+ *  сортировки с разрешением равенства по номеру строки. Ключ сортировки
+ *  каждой строки хранится отдельным массивом. На каждом takeChanges()
+ *  новые и изменившие ключ строки сортируются отдельно и сливаются с
+ *  порядком за O(n + k log k); полная сортировка выполняется только при
+ *  смене колонки сортировки или фильтра. Таблица не потокобезопасна и
+ *  принадлежит одному потоку.
+ *
+ *  При превышении maxRows удаляются самые старые строки: с запасом в
+ *  1/16 емкости, чтобы сдвиг колонок выполнялся редко.
+ */
+class SignalTable
+{
+public:
+    //! \brief Колонки таблицы.
+    enum Column : int {
+        //! \brief Время первого обнаружения.
+        TimeColumn = 0,
+        //! \brief Частота.
+        FrequencyColumn,
+        //! \brief Занимаемая полоса.
+        BandwidthColumn,
+        //! \brief Пиковый уровень.
+        AmplitudeColumn,
+        //! \brief Длительность импульса.
+        PulseWidthColumn,
+        //! \brief Азимут.
+        AzimuthColumn,
+        //! \brief Класс сигнала.
+        ClassificationColumn,
+        //! \brief Число обнаружений.
+        HitsColumn,
+        //! \brief Количество колонок.
+        ColumnCount
+    };
+
+    //! \brief Параметры объединения, сортировки и фильтра.
+    struct Settings
+    {
+        //! \brief Наибольшее число строк.
+        int maxRows = 100000;
+        //! \brief Время, в течение которого строка продолжается новыми обнаружениями, мкс.
+        qint64 mergeHoldUs = 1000000;
+        //! \brief Допуск по частоте сверх перекрытия полос, Гц.
+        double mergeToleranceHz = 0.0;
+        //! \brief Колонка сортировки.
+        int sortColumn = TimeColumn;
+        //! \brief Признак сортировки по убыванию.
+        bool sortDescending = true;
+        //! \brief Нижняя граница частоты фильтра, Гц.
+        double filterMinHz = -std::numeric_limits<double>::infinity();
+        //! \brief Верхняя граница частоты фильтра, Гц.
+        double filterMaxHz = std::numeric_limits<double>::infinity();
+        //! \brief Наименьший уровень фильтра, дБ.
+        double filterMinDb = -std::numeric_limits<double>::infinity();
+    };
+
+    //! \brief Изменения таблицы с прошлого takeChanges().
+    struct Changes
+    {
+        //! \brief Число удаленных первых строк; номера остальных строк уменьшаются на него.
+        int evicted = 0;
+        //! \brief Новые строки, добавляемые в конец после удаления.
+        SignalColumns inserted;
+        //! \brief Номера измененных прежних строк (после удаления).
+        std::vector<int> updatedRows;
+        //! \brief Новые значения измененных строк в порядке updatedRows.
+        SignalColumns updated;
+        //! \brief Признак изменения порядка строк.
+        bool orderChanged = false;
+        //! \brief Новый порядок строк; заполнен, если orderChanged.
+        std::vector<int> order;
+    };
+
+    /*!
+     *  \brief Задает параметры; смена сортировки или фильтра перестраивает порядок.
+     *  \param[in] settings Параметры.
+     */
+    void setSettings(const Settings &settings);
+    //! \brief Возвращает параметры.
+    const Settings &settings() const noexcept { return m_settings; }
+
+    /*!
+     *  \brief Объединяет пакет обнаружений со строками таблицы.
+     *  \param[in] batch Пакет обнаружений.
+     */
+    void merge(const SignalBatch &batch);
+    //! \brief Удаляет все строки.
+    void clear();
+
+    /*!
+     *  \brief Обновляет порядок строк и забирает накопленные изменения.
+     *  \param[out] changes Изменения; память векторов переиспользуется.
+     *  \return true, если таблица изменилась.
+     */
+    bool takeChanges(Changes &changes);
+
+    //! \brief Возвращает строки таблицы.
+    const SignalColumns &rows() const noexcept { return m_rows; }
+    //! \brief Возвращает порядок строк на момент последнего takeChanges().
+    const std::vector<int> &order() const noexcept { return m_order; }
+
+    /*!
+     *  \brief Возвращает ключ сортировки строки.
+     *  \param[in] rows Строки.
+     *  \param[in] row Строка.
+     *  \param[in] column Колонка.
+     *  \return Значение колонки; неизвестный азимут меньше любого известного.
+     */
+    static double sortKey(const SignalColumns &rows, int row, int column) noexcept;
+
+private:
+    //! \brief Проверяет строку по фильтру.
+    bool passes(int row) const noexcept;
+    //! \brief Сравнивает строки в порядке сортировки.
+    bool less(int left, int right) const noexcept;
+    /*!
+     *  \brief Ищет активную строку, с которой совпадает обнаружение.
+     *  \param[in] active Активные строки полосы, упорядоченные по частоте.
+     *  \param[in] signal Обнаружение.
+     *  \return Индекс в active; -1, если совпадения нет.
+     */
+    int findMatch(const std::vector<int> &active, const SignalEntity &signal) const;
+    //! \brief Отмечает прежнюю строку как измененную.
+    void markDirty(int row);
+    //! \brief Удаляет самые старые переданные строки сверх maxRows; возвращает их число.
+    int evict(bool &orderChanged);
+    //! \brief Перестраивает порядок полностью.
+    void rebuildOrder();
+    //! \brief Обновляет порядок по новым и измененным строкам; возвращает признак изменения.
+    bool updateOrder();
+
+    //! \brief Параметры.
+    Settings m_settings;
+    //! \brief Строки.
+    SignalColumns m_rows;
+    //! \brief Ключи сортировки строк, учтенные в порядке.
+    std::vector<double> m_keys;
+    //! \brief Признак присутствия строки в порядке.
+    std::vector<char> m_inView;
+    //! \brief Признак изменения прежней строки.
+    std::vector<char> m_dirty;
+    //! \brief Измененные прежние строки.
+    std::vector<int> m_dirtyRows;
+    //! \brief Порядок строк.
+    std::vector<int> m_order;
+    //! \brief Строки, вставляемые в порядок.
+    std::vector<int> m_candidates;
+    //! \brief Буфер слияния порядка.
+    std::vector<int> m_mergeBuffer;
+    //! \brief Признаки совпавших в текущем пакете активных строк.
+    std::vector<char> m_taken;
+    //! \brief Активные строки полос, упорядоченные по частоте.
+    QHash<int, std::vector<int>> m_active;
+    //! \brief Наибольшая занимаемая полоса среди строк, Гц.
+    double m_maxBandwidthHz = 0.0;
+    //! \brief Число строк, переданных в takeChanges().
+    int m_committedRows = 0;
+    //! \brief Признак необходимости полной перестройки порядка.
+    bool m_rebuild = false;
+};
+
+#endif // SIGNALTABLE_H
@@ -0,0 +1,546 @@
+/*!
+ *  \file signaltablemodel.cpp
+ *  \brief Реализация SignalTableModel.
+ */
+#include "signaltablemodel.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QMetaObject>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+/*!
+ *  \brief Собирает упорядоченные номера в диапазоны подряд идущих.
+ *  \param[in] positions Возрастающие номера.
+ *  \return Диапазоны [first, last].
+ */
+std::vector<std::pair<int, int>> collectRanges(const std::vector<int> &positions)
+{
+    std::vector<std::pair<int, int>> ranges;
+    for (int position : positions) {
+        if (!ranges.empty() && ranges.back().second + 1 == position) {
+            ranges.back().second = position;
+        } else {
+            ranges.emplace_back(position, position);
+        }
+    }
+    return ranges;
+}
+
+} // namespace
+
+/*!
+ *  \brief Конструирует модель и запускает поток объединения.
+ *  \param[in] parent Родительский объект.
+ */
+SignalTableModel::SignalTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    publishSettings();
+    m_thread = QThread::create([this]() { runMerger(); });
+    m_thread->setObjectName(QStringLiteral("SignalTable"));
+    m_thread->start(QThread::LowPriority);
+}
+
+//! \brief Останавливает поток объединения.
+SignalTableModel::~SignalTableModel()
+{
+    m_thread->requestInterruption();
+    m_thread->wait();
+    delete m_thread;
+}
+
+//! \brief Возвращает число строк, прошедших фильтр.
+int SignalTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : count();
+}
+
+//! \brief Возвращает число колонок.
+int SignalTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : SignalTable::ColumnCount;
+}
+
+//! \brief Возвращает данные ячейки по роли.
+QVariant SignalTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count() || index.column() >= SignalTable::ColumnCount) {
+        return {};
+    }
+    // Строка, удаленная из хранилища и еще не снятая с модели, помечена -1.
+    const int row = m_order[static_cast<size_t>(index.row())];
+    if (row < 0) {
+        return {};
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return displayText(row, index.column());
+    case ValueRole:
+        if (index.column() == SignalTable::AzimuthColumn && std::isnan(m_rows.azimuthDeg[static_cast<size_t>(row)])) {
+            return {};
+        }
+        return SignalTable::sortKey(m_rows, row, index.column());
+    default:
+        return {};
+    }
+}
+
+//! \brief Возвращает заголовок колонки.
+QVariant SignalTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return {};
+    }
+    if (orientation == Qt::Vertical) {
+        return section + 1;
+    }
+
+    switch (section) {
+    case SignalTable::TimeColumn:
+        return QStringLiteral("Время");
+    case SignalTable::FrequencyColumn:
+        return QStringLiteral("Частота, МГц");
+    case SignalTable::BandwidthColumn:
+        return QStringLiteral("Полоса, кГц");
+    case SignalTable::AmplitudeColumn:
+        return QStringLiteral("Уровень, дБ");
+    case SignalTable::PulseWidthColumn:
+        return QStringLiteral("Импульс, мкс");
+    case SignalTable::AzimuthColumn:
+        return QStringLiteral("Азимут, °");
+    case SignalTable::ClassificationColumn:
+        return QStringLiteral("Класс");
+    case SignalTable::HitsColumn:
+        return QStringLiteral("Обнаружений");
+    default:
+        return {};
+    }
+}
+
+//! \brief Возвращает имена ролей для QML.
+QHash<int, QByteArray> SignalTableModel::roleNames() const
+{
+    return {
+        {Qt::DisplayRole, "display"},
+        {ValueRole, "value"},
+    };
+}
+
+/*!
+ *  \brief Задает сортировку; порядок перестраивается в потоке объединения.
+ *  \param[in] column Колонка SignalTable::Column.
+ *  \param[in] order Направление.
+ */
+void SignalTableModel::sort(int column, Qt::SortOrder order)
+{
+    column = qBound(0, column, SignalTable::ColumnCount - 1);
+    const bool descending = order == Qt::DescendingOrder;
+    if (m_settings.sortColumn == column && m_settings.sortDescending == descending) {
+        return;
+    }
+    m_settings.sortColumn = column;
+    m_settings.sortDescending = descending;
+    publishSettings();
+    emit sortChanged();
+}
+
+//! \brief Задает нижнюю границу частоты фильтра, Гц.
+void SignalTableModel::setFilterMinHz(double value)
+{
+    if (m_settings.filterMinHz == value) {
+        return;
+    }
+    m_settings.filterMinHz = value;
+    publishSettings();
+    emit filterChanged();
+}
+
+//! \brief Задает верхнюю границу частоты фильтра, Гц.
+void SignalTableModel::setFilterMaxHz(double value)
+{
+    if (m_settings.filterMaxHz == value) {
+        return;
+    }
+    m_settings.filterMaxHz = value;
+    publishSettings();
+    emit filterChanged();
+}
+
+//! \brief Задает наименьший уровень фильтра, дБ.
+void SignalTableModel::setFilterMinDb(double value)
+{
+    if (m_settings.filterMinDb == value) {
+        return;
+    }
+    m_settings.filterMinDb = value;
+    publishSettings();
+    emit filterChanged();
+}
+
+//! \brief Снимает все ограничения фильтра.
+void SignalTableModel::clearFilter()
+{
+    const SignalTable::Settings defaults;
+    m_settings.filterMinHz = defaults.filterMinHz;
+    m_settings.filterMaxHz = defaults.filterMaxHz;
+    m_settings.filterMinDb = defaults.filterMinDb;
+    publishSettings();
+    emit filterChanged();
+}
+
+//! \brief Задает наибольшее число хранимых строк.
+void SignalTableModel::setMaxRows(int value)
+{
+    value = qMax(1, value);
+    if (m_settings.maxRows == value) {
+        return;
+    }
+    m_settings.maxRows = value;
+    publishSettings();
+    emit settingsChanged();
+}
+
+//! \brief Задает время продолжения строки новыми обнаружениями, мс.
+void SignalTableModel::setMergeHoldMs(int value)
+{
+    const qint64 holdUs = qMax<qint64>(0, value) * 1000;
+    if (m_settings.mergeHoldUs == holdUs) {
+        return;
+    }
+    m_settings.mergeHoldUs = holdUs;
+    publishSettings();
+    emit settingsChanged();
+}
+
+//! \brief Задает период публикации изменений, мс.
+void SignalTableModel::setTickIntervalMs(int value)
+{
+    value = qMax(1, value);
+    if (m_tickIntervalMs.exchange(value, std::memory_order_relaxed) != value) {
+        emit settingsChanged();
+    }
+}
+
+//! \brief Удаляет все строки.
+void SignalTableModel::clear()
+{
+    // Изменения, собранные до очистки в потоке, отбрасываются по номеру.
+    m_clearGeneration.fetch_add(1, std::memory_order_relaxed);
+    beginResetModel();
+    m_rows.clear();
+    m_order.clear();
+    m_positions.clear();
+    endResetModel();
+    emit countChanged();
+}
+
+/*!
+ *  \brief Передает пакет обнаружений потоку объединения.
+ *  \param[in] batch Пакет обнаружений.
+ */
+void SignalTableModel::appendBatch(const SignalBatch &batch)
+{
+    if (batch.signalList.empty()) {
+        return;
+    }
+    if (!m_batches.tryPush(batch)) {
+        ++m_droppedBatches;
+        emit droppedBatchesChanged();
+    }
+}
+
+//! \brief Публикует параметры для потока объединения.
+void SignalTableModel::publishSettings()
+{
+    m_settingsSlot.writeBuffer() = m_settings;
+    m_settingsSlot.publish();
+}
+
+//! \brief Цикл потока объединения.
+void SignalTableModel::runMerger()
+{
+    using Clock = std::chrono::steady_clock;
+
+    SignalTable table;
+    SignalBatch batch;
+    quint64 clearGeneration = 0;
+    Clock::time_point deadline = Clock::now();
+
+    while (!m_thread->isInterruptionRequested()) {
+        if (m_settingsSlot.consume()) {
+            table.setSettings(m_settingsSlot.readBuffer());
+        }
+        const quint64 requestedClear = m_clearGeneration.load(std::memory_order_relaxed);
+        if (requestedClear != clearGeneration) {
+            clearGeneration = requestedClear;
+            table.clear();
+        }
+        while (m_batches.tryPop(batch)) {
+            table.merge(batch);
+        }
+
+        // Изменения передаются цепочкой, поэтому новые собираются только
+        // после применения предыдущих; до этого они копятся в таблице.
+        if (!m_updatePending.load(std::memory_order_acquire)) {
+            Update &update = m_updates.writeBuffer();
+            if (table.takeChanges(update.changes)) {
+                update.clearGeneration = clearGeneration;
+                m_updates.publish();
+                m_updatePending.store(true, std::memory_order_relaxed);
+                QMetaObject::invokeMethod(this, &SignalTableModel::applyUpdate, Qt::QueuedConnection);
+            }
+        }
+
+        deadline += std::chrono::milliseconds(m_tickIntervalMs.load(std::memory_order_relaxed));
+        const Clock::time_point now = Clock::now();
+        if (deadline < now) {
+            deadline = now;
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+//! \brief Применяет последние изменения.
+void SignalTableModel::applyUpdate()
+{
+    if (!m_updates.consume()) {
+        m_updatePending.store(false, std::memory_order_release);
+        return;
+    }
+    const Update &update = m_updates.readBuffer();
+    if (update.clearGeneration != m_clearGeneration.load(std::memory_order_relaxed)) {
+        m_updatePending.store(false, std::memory_order_release);
+        return;
+    }
+
+    const SignalTable::Changes &changes = update.changes;
+    const int countBefore = count();
+    const int totalBefore = totalCount();
+
+    if (changes.evicted > 0) {
+        m_rows.eraseFront(changes.evicted);
+        for (int &row : m_order) {
+            row = row < changes.evicted ? -1 : row - changes.evicted;
+        }
+    }
+    for (int i = 0; i < changes.inserted.size(); ++i) {
+        m_rows.appendRow(changes.inserted, i);
+    }
+    for (size_t i = 0; i < changes.updatedRows.size(); ++i) {
+        m_rows.setRow(changes.updatedRows[i], changes.updated, static_cast<int>(i));
+    }
+
+    if (changes.orderChanged) {
+        applyOrder(changes.order);
+    }
+    if (changes.orderChanged || changes.evicted > 0 || changes.inserted.size() > 0) {
+        m_positions.assign(static_cast<size_t>(m_rows.size()), -1);
+        for (size_t position = 0; position < m_order.size(); ++position) {
+            m_positions[static_cast<size_t>(m_order[position])] = static_cast<int>(position);
+        }
+    }
+    emitUpdatedRows(changes.updatedRows);
+
+    m_updatePending.store(false, std::memory_order_release);
+    if (count() != countBefore || totalCount() != totalBefore) {
+        emit countChanged();
+    }
+}
+
+/*!
+ *  \brief Приводит строки модели к новому порядку.
+ *  \param[in] order Новый порядок строк.
+ */
+void SignalTableModel::applyOrder(const std::vector<int> &order)
+{
+    const size_t rowCount = static_cast<size_t>(m_rows.size());
+    std::vector<int> positions;
+
+    // 1. Снимаются строки, которых нет в новом порядке.
+    m_marks.assign(rowCount, 0);
+    for (int row : order) {
+        m_marks[static_cast<size_t>(row)] = 1;
+    }
+    for (size_t position = 0; position < m_order.size(); ++position) {
+        const int row = m_order[position];
+        if (row < 0 || m_marks[static_cast<size_t>(row)] == 0) {
+            positions.push_back(static_cast<int>(position));
+        }
+    }
+    if (!positions.empty()) {
+        const std::vector<std::pair<int, int>> ranges = collectRanges(positions);
+        if (static_cast<int>(ranges.size()) <= kMaxExactRanges) {
+            for (auto it = ranges.crbegin(); it != ranges.crend(); ++it) {
+                beginRemoveRows(QModelIndex(), it->first, it->second);
+                m_order.erase(m_order.begin() + it->first, m_order.begin() + it->second + 1);
+                endRemoveRows();
+            }
+        } else {
+            // Снимаемые строки переносятся в конец и снимаются одним диапазоном.
+            std::vector<int> arranged;
+            arranged.reserve(m_order.size());
+            std::vector<int> newPositions(m_order.size());
+            for (int pass = 0; pass < 2; ++pass) {
+                for (size_t position = 0; position < m_order.size(); ++position) {
+                    const int row = m_order[position];
+                    const bool kept = row >= 0 && m_marks[static_cast<size_t>(row)] != 0;
+                    if (kept == (pass == 0)) {
+                        newPositions[position] = static_cast<int>(arranged.size());
+                        arranged.push_back(row);
+                    }
+                }
+            }
+            const int keptCount = count() - static_cast<int>(positions.size());
+            changeLayout(std::move(arranged), newPositions);
+            beginRemoveRows(QModelIndex(), keptCount, count() - 1);
+            m_order.resize(static_cast<size_t>(keptCount));
+            endRemoveRows();
+        }
+    }
+
+    // 2. Оставшиеся строки переставляются, если их взаимный порядок изменился.
+    m_marks.assign(rowCount, 0);
+    for (int row : m_order) {
+        m_marks[static_cast<size_t>(row)] = 1;
+    }
+    std::vector<int> kept;
+    kept.reserve(m_order.size());
+    for (int row : order) {
+        if (m_marks[static_cast<size_t>(row)] != 0) {
+            kept.push_back(row);
+        }
+    }
+    if (kept != m_order) {
+        m_positions.assign(rowCount, -1);
+        for (size_t position = 0; position < kept.size(); ++position) {
+            m_positions[static_cast<size_t>(kept[position])] = static_cast<int>(position);
+        }
+        std::vector<int> newPositions(m_order.size());
+        for (size_t position = 0; position < m_order.size(); ++position) {
+            newPositions[position] = m_positions[static_cast<size_t>(m_order[position])];
+        }
+        changeLayout(std::move(kept), newPositions);
+    }
+
+    // 3. Вставляются новые строки: по возрастанию мест в новом порядке,
+    // поэтому все строки перед местом вставки уже на своих местах.
+    positions.clear();
+    for (size_t position = 0; position < order.size(); ++position) {
+        if (m_marks[static_cast<size_t>(order[position])] == 0) {
+            positions.push_back(static_cast<int>(position));
+        }
+    }
+    if (positions.empty()) {
+        return;
+    }
+    const std::vector<std::pair<int, int>> ranges = collectRanges(positions);
+    if (static_cast<int>(ranges.size()) <= kMaxExactRanges) {
+        for (const std::pair<int, int> &range : ranges) {
+            beginInsertRows(QModelIndex(), range.first, range.second);
+            m_order.insert(m_order.begin() + range.first, order.begin() + range.first,
+                           order.begin() + range.second + 1);
+            endInsertRows();
+        }
+        return;
+    }
+
+    // Много мест вставки: строки добавляются одним диапазоном в конец и
+    // расставляются сменой разметки.
+    beginInsertRows(QModelIndex(), count(), count() + static_cast<int>(positions.size()) - 1);
+    for (int position : positions) {
+        m_order.push_back(order[static_cast<size_t>(position)]);
+    }
+    endInsertRows();
+    m_positions.assign(rowCount, -1);
+    for (size_t position = 0; position < order.size(); ++position) {
+        m_positions[static_cast<size_t>(order[position])] = static_cast<int>(position);
+    }
+    std::vector<int> newPositions(m_order.size());
+    for (size_t position = 0; position < m_order.size(); ++position) {
+        newPositions[position] = m_positions[static_cast<size_t>(m_order[position])];
+    }
+    changeLayout(order, newPositions);
+}
+
+/*!
+ *  \brief Меняет порядок строк без изменения их набора.
+ *  \param[in] order Новый порядок.
+ *  \param[in] newPositions Новое место каждой прежней строки.
+ */
+void SignalTableModel::changeLayout(std::vector<int> order, const std::vector<int> &newPositions)
+{
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList from = persistentIndexList();
+    QModelIndexList to;
+    to.reserve(from.size());
+    for (const QModelIndex &persistent : from) {
+        to.append(index(newPositions[static_cast<size_t>(persistent.row())], persistent.column()));
+    }
+    m_order = std::move(order);
+    changePersistentIndexList(from, to);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+//! \brief Сообщает об изменении строк updatedRows.
+void SignalTableModel::emitUpdatedRows(const std::vector<int> &updatedRows)
+{
+    std::vector<int> positions;
+    positions.reserve(updatedRows.size());
+    for (int row : updatedRows) {
+        const int position = m_positions[static_cast<size_t>(row)];
+        if (position >= 0) {
+            positions.push_back(position);
+        }
+    }
+    if (positions.empty()) {
+        return;
+    }
+    std::sort(positions.begin(), positions.end());
+
+    std::vector<std::pair<int, int>> ranges = collectRanges(positions);
+    if (static_cast<int>(ranges.size()) > kMaxExactRanges) {
+        // Представление перечитывает только видимые ячейки охватывающего диапазона.
+        ranges = {{positions.front(), positions.back()}};
+    }
+    const QList<int> roles{Qt::DisplayRole, ValueRole};
+    for (const std::pair<int, int> &range : ranges) {
+        emit dataChanged(index(range.first, 0), index(range.second, SignalTable::ColumnCount - 1), roles);
+    }
+}
+
+//! \brief Форматирует значение ячейки.
+QString SignalTableModel::displayText(int row, int column) const
+{
+    const size_t index = static_cast<size_t>(row);
+    switch (column) {
+    case SignalTable::TimeColumn:
+        return QDateTime::fromMSecsSinceEpoch(m_rows.firstSeenUs[index] / 1000).toString(QStringLiteral("hh:mm:ss.zzz"));
+    case SignalTable::FrequencyColumn:
+        return QString::number(m_rows.frequencyHz[index] / 1e6, 'f', 4);
+    case SignalTable::BandwidthColumn:
+        return QString::number(m_rows.bandwidthHz[index] / 1e3, 'f', 1);
+    case SignalTable::AmplitudeColumn:
+        return QString::number(m_rows.amplitudeDb[index], 'f', 1);
+    case SignalTable::PulseWidthColumn:
+        return m_rows.pulseWidthUs[index] > 0.0f ? QString::number(m_rows.pulseWidthUs[index], 'f', 1)
+                                                 : QStringLiteral("—");
+    case SignalTable::AzimuthColumn:
+        return std::isnan(m_rows.azimuthDeg[index]) ? QStringLiteral("—")
+                                                    : QString::number(m_rows.azimuthDeg[index], 'f', 1);
+    case SignalTable::ClassificationColumn:
+        return m_rows.classification[index] != 0 ? QString::number(m_rows.classification[index])
+                                                 : QStringLiteral("—");
+    case SignalTable::HitsColumn:
+        return QString::number(m_rows.hits[index]);
+    default:
+        return {};
+    }
+}
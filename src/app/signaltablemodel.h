@@ -0,0 +1,220 @@
+/*!
+ *  \file signaltablemodel.h
+ *  \brief Табличная модель обнаруженных сигналов с объединением пакетов в отдельном потоке.
+ */
+#ifndef SIGNALTABLEMODEL_H
+#define SIGNALTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QThread>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "latestvalueslot.h"
+#include "signalentity.h"
+#include "signaltable.h"
+#include "spscqueue.h"
+
+/*!
+ *  \class SignalTableModel
+ *  \brief Модель таблицы сигналов (SignalTableView) для десятков тысяч строк.
+ *
+ *  Пакеты обнаружений (SpectrumControllerStub::signalsDetected) передаются
+ *  через SpscQueue потоку объединения, где SignalTable сводит их в строки
+ *  и ведет порядок сортировки и фильтра. Раз в tickIntervalMs поток
+ *  публикует накопленные изменения через LatestValueSlot; следующие
+ *  изменения собираются только после того, как поток UI применил
+ *  предыдущие, поэтому ни одно изменение не теряется, а модель
+ *  обновляется не чаще раза за такт.
+ *
+ *  Поток UI хранит копию строк в колонках и порядок строк. Удаленные и
+ *  вставленные строки сообщаются диапазонами beginRemoveRows/
+ *  beginInsertRows, если диапазонов не больше kMaxExactRanges; иначе строки
+ *  снимаются или добавляются одним диапазоном в конце, а их места задаются
+ *  сменой разметки (layoutChanged), как в QSortFilterProxyModel. Так
+ *  обновление стоит O(n) даже при вставке в тысячу мест 100 тысяч строк,
+ *  а сортировка целиком выполняется в потоке объединения.
+ */
+class SignalTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY countChanged)
+    Q_PROPERTY(int sortColumn READ sortColumn NOTIFY sortChanged)
+    Q_PROPERTY(Qt::SortOrder sortOrder READ sortOrder NOTIFY sortChanged)
+    Q_PROPERTY(double filterMinHz READ filterMinHz WRITE setFilterMinHz NOTIFY filterChanged)
+    Q_PROPERTY(double filterMaxHz READ filterMaxHz WRITE setFilterMaxHz NOTIFY filterChanged)
+    Q_PROPERTY(double filterMinDb READ filterMinDb WRITE setFilterMinDb NOTIFY filterChanged)
+    Q_PROPERTY(int maxRows READ maxRows WRITE setMaxRows NOTIFY settingsChanged)
+    Q_PROPERTY(int mergeHoldMs READ mergeHoldMs WRITE setMergeHoldMs NOTIFY settingsChanged)
+    Q_PROPERTY(int tickIntervalMs READ tickIntervalMs WRITE setTickIntervalMs NOTIFY settingsChanged)
+    Q_PROPERTY(qint64 droppedBatches READ droppedBatches NOTIFY droppedBatchesChanged)
+
+public:
+    //! \brief Роли данных ячейки.
+    enum Roles
+    {
+        //! \brief Значение колонки без форматирования.
+        ValueRole = Qt::UserRole + 1
+    };
+    Q_ENUM(Roles)
+
+    /*!
+     *  \brief Конструирует модель и запускает поток объединения.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit SignalTableModel(QObject *parent = nullptr);
+    //! \brief Останавливает поток объединения.
+    ~SignalTableModel() override;
+
+    //! \brief Возвращает число строк, прошедших фильтр.
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    //! \brief Возвращает число колонок.
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    //! \brief Возвращает данные ячейки по роли.
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    //! \brief Возвращает заголовок колонки.
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    //! \brief Возвращает имена ролей для QML.
+    QHash<int, QByteArray> roleNames() const override;
+    /*!
+     *  \brief Задает сортировку; порядок перестраивается в потоке объединения.
+     *  \param[in] column Колонка SignalTable::Column.
+     *  \param[in] order Направление.
+     */
+    Q_INVOKABLE void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    //! \brief Возвращает число строк, прошедших фильтр.
+    int count() const noexcept { return static_cast<int>(m_order.size()); }
+    //! \brief Возвращает число хранимых строк.
+    int totalCount() const noexcept { return m_rows.size(); }
+    //! \brief Возвращает колонку сортировки.
+    int sortColumn() const noexcept { return m_settings.sortColumn; }
+    //! \brief Возвращает направление сортировки.
+    Qt::SortOrder sortOrder() const noexcept
+    {
+        return m_settings.sortDescending ? Qt::DescendingOrder : Qt::AscendingOrder;
+    }
+
+    //! \brief Возвращает нижнюю границу частоты фильтра, Гц.
+    double filterMinHz() const noexcept { return m_settings.filterMinHz; }
+    //! \brief Задает нижнюю границу частоты фильтра, Гц.
+    void setFilterMinHz(double value);
+    //! \brief Возвращает верхнюю границу частоты фильтра, Гц.
+    double filterMaxHz() const noexcept { return m_settings.filterMaxHz; }
+    //! \brief Задает верхнюю границу частоты фильтра, Гц.
+    void setFilterMaxHz(double value);
+    //! \brief Возвращает наименьший уровень фильтра, дБ.
+    double filterMinDb() const noexcept { return m_settings.filterMinDb; }
+    //! \brief Задает наименьший уровень фильтра, дБ.
+    void setFilterMinDb(double value);
+    //! \brief Снимает все ограничения фильтра.
+    Q_INVOKABLE void clearFilter();
+
+    //! \brief Возвращает наибольшее число хранимых строк.
+    int maxRows() const noexcept { return m_settings.maxRows; }
+    //! \brief Задает наибольшее число хранимых строк.
+    void setMaxRows(int value);
+    //! \brief Возвращает время продолжения строки новыми обнаружениями, мс.
+    int mergeHoldMs() const noexcept { return static_cast<int>(m_settings.mergeHoldUs / 1000); }
+    //! \brief Задает время продолжения строки новыми обнаружениями, мс.
+    void setMergeHoldMs(int value);
+    //! \brief Возвращает период публикации изменений, мс.
+    int tickIntervalMs() const noexcept { return m_tickIntervalMs.load(std::memory_order_relaxed); }
+    //! \brief Задает период публикации изменений, мс (не меньше 1).
+    void setTickIntervalMs(int value);
+
+    //! \brief Возвращает число пакетов, отброшенных при переполнении очереди.
+    qint64 droppedBatches() const noexcept { return m_droppedBatches; }
+
+    //! \brief Удаляет все строки.
+    Q_INVOKABLE void clear();
+
+public slots:
+    /*!
+     *  \brief Передает пакет обнаружений потоку объединения.
+     *  \param[in] batch Пакет обнаружений.
+     */
+    void appendBatch(const SignalBatch &batch);
+
+signals:
+    //! \brief Сигнал об изменении числа строк.
+    void countChanged();
+    //! \brief Сигнал об изменении сортировки.
+    void sortChanged();
+    //! \brief Сигнал об изменении фильтра.
+    void filterChanged();
+    //! \brief Сигнал об изменении параметров.
+    void settingsChanged();
+    //! \brief Сигнал об отброшенном пакете.
+    void droppedBatchesChanged();
+
+private:
+    //! \brief Изменения, передаваемые из потока объединения.
+    struct Update
+    {
+        //! \brief Номер последнего выполненного запроса очистки.
+        quint64 clearGeneration = 0;
+        //! \brief Изменения таблицы.
+        SignalTable::Changes changes;
+    };
+
+    //! \brief Наибольшее число диапазонов, о которых сообщается по отдельности.
+    static constexpr int kMaxExactRanges = 16;
+    //! \brief Емкость очереди пакетов.
+    static constexpr std::size_t kQueueCapacity = 256;
+
+    //! \brief Публикует параметры для потока объединения.
+    void publishSettings();
+    //! \brief Цикл потока объединения.
+    void runMerger();
+    //! \brief Применяет последние изменения (поток UI).
+    void applyUpdate();
+    /*!
+     *  \brief Приводит строки модели к новому порядку.
+     *  \param[in] order Новый порядок строк.
+     */
+    void applyOrder(const std::vector<int> &order);
+    /*!
+     *  \brief Меняет порядок строк без изменения их набора.
+     *  \param[in] order Новый порядок.
+     *  \param[in] newPositions Новое место каждой прежней строки.
+     */
+    void changeLayout(std::vector<int> order, const std::vector<int> &newPositions);
+    //! \brief Сообщает об изменении строк updatedRows.
+    void emitUpdatedRows(const std::vector<int> &updatedRows);
+    //! \brief Форматирует значение ячейки.
+    QString displayText(int row, int column) const;
+
+    //! \brief Параметры таблицы (поток UI).
+    SignalTable::Settings m_settings;
+    //! \brief Период публикации изменений, мс.
+    std::atomic<int> m_tickIntervalMs{16};
+    //! \brief Слот параметров (UI -> поток).
+    LatestValueSlot<SignalTable::Settings> m_settingsSlot;
+    //! \brief Очередь пакетов (UI -> поток).
+    SpscQueue<SignalBatch, kQueueCapacity> m_batches;
+    //! \brief Слот изменений (поток -> UI).
+    LatestValueSlot<Update> m_updates;
+    //! \brief Номер последнего запроса очистки (UI -> поток).
+    std::atomic<quint64> m_clearGeneration{0};
+    //! \brief Признак опубликованных и еще не примененных изменений.
+    std::atomic<bool> m_updatePending{false};
+    //! \brief Поток объединения.
+    QThread *m_thread = nullptr;
+
+    //! \brief Копия строк таблицы.
+    SignalColumns m_rows;
+    //! \brief Порядок строк модели: номер строки хранилища для каждой строки модели.
+    std::vector<int> m_order;
+    //! \brief Строка модели для каждой строки хранилища; -1 — вне фильтра.
+    std::vector<int> m_positions;
+    //! \brief Рабочие признаки строк хранилища.
+    std::vector<char> m_marks;
+    //! \brief Число отброшенных пакетов.
+    qint64 m_droppedBatches = 0;
+};
+
+#endif // SIGNALTABLEMODEL_H
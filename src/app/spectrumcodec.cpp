@@ -0,0 +1,212 @@
+/*!
+ *  \file spectrumcodec.cpp
+ *  \brief Реализация SpectrumCodec.
+ */
+#include "spectrumcodec.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+
+using Block = CodecKernel::Block;
+
+//! \brief Количество значений в блоке.
+constexpr int kBlockValues = CodecKernel::kBlockValues;
+//! \brief Размер данных блока на один бит разрядности, байты.
+constexpr qint64 kBytesPerWidth = kBlockValues / 8;
+//! \brief Наименьший шаг квантования, дБ.
+constexpr float kMinStepDb = 0.001f;
+
+static_assert(sizeof(SpectrumCodec::StreamHeader) == 8, "StreamHeader layout");
+static_assert(sizeof(Block) == 4, "Block descriptor layout");
+
+//! \brief Возвращает количество блоков для заданного количества значений.
+constexpr qint64 blockCountFor(qint64 binCount)
+{
+    return (binCount + kBlockValues - 1) / kBlockValues;
+}
+
+} // namespace
+
+//! \brief Конструирует кодек с параметрами по умолчанию.
+SpectrumCodec::SpectrumCodec()
+    : SpectrumCodec(Settings())
+{
+}
+
+/*!
+ *  \brief Конструирует кодек.
+ *  \param[in] settings Параметры кодирования.
+ */
+SpectrumCodec::SpectrumCodec(const Settings &settings)
+    : m_settings(settings)
+    , m_variant(CodecKernel::bestVariant())
+{
+    m_settings.stepDb = std::max(settings.stepDb, kMinStepDb);
+    m_settings.keyInterval = std::max(settings.keyInterval, 1);
+    m_maxCode = settings.width == Width::UInt8 ? 0xFF : 0xFFFF;
+    m_invStep = 1.0f / m_settings.stepDb;
+}
+
+/*!
+ *  \brief Возвращает наибольший размер потока кадра.
+ *  \param[in] binCount Количество значений.
+ *  \return Размер, байты.
+ */
+qint64 SpectrumCodec::maxEncodedBytes(qint64 binCount) noexcept
+{
+    const qint64 blocks = blockCountFor(binCount);
+    return static_cast<qint64>(sizeof(StreamHeader)) + blocks * static_cast<qint64>(sizeof(Block))
+        + blocks * 16 * kBytesPerWidth;
+}
+
+/*!
+ *  \brief Проверяет, является ли поток ключевым кадром.
+ *  \param[in] data Поток кадра.
+ *  \param[in] size Размер потока, байты.
+ */
+bool SpectrumCodec::isKeyFrame(const uchar *data, qint64 size) noexcept
+{
+    if (size < static_cast<qint64>(sizeof(StreamHeader))) {
+        return false;
+    }
+    StreamHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return (header.flags & kKeyFrame) != 0;
+}
+
+//! \brief Забывает предыдущий кадр.
+void SpectrumCodec::reset() noexcept
+{
+    m_referenceBins = -1;
+    m_sinceKey = 0;
+    m_validFirstBlock = 0;
+    m_validLastBlock = 0;
+}
+
+/*!
+ *  \brief Кодирует кадр.
+ *  \param[in] db Значения, дБ.
+ *  \param[in] binCount Количество значений.
+ *  \param[out] out Буфер не меньше maxEncodedBytes(binCount) байт.
+ *  \param[in] keyFrame Признак принудительного ключевого кадра.
+ *  \return Размер потока кадра, байты.
+ */
+qint64 SpectrumCodec::encode(const float *db, int binCount, uchar *out, bool keyFrame)
+{
+    binCount = std::max(binCount, 0);
+    const int blockCount = static_cast<int>(blockCountFor(binCount));
+    m_codes.resize(static_cast<size_t>(blockCount) * kBlockValues);
+    CodecKernel::quantize(m_variant, db, m_codes.data(), binCount, m_settings.floorDb, m_invStep, m_maxCode);
+    // Хвост последнего блока повторяет последний код и не расширяет остатки.
+    std::fill(m_codes.begin() + binCount, m_codes.end(), binCount > 0 ? m_codes[static_cast<size_t>(binCount - 1)] : 0);
+
+    const bool key = keyFrame || binCount != m_referenceBins || m_sinceKey >= m_settings.keyInterval;
+    StreamHeader header{};
+    header.binCount = static_cast<quint32>(binCount);
+    header.flags = key ? kKeyFrame : 0;
+    header.blockValues = kBlockValues;
+    std::memcpy(out, &header, sizeof(header));
+
+    uchar *descriptors = out + sizeof(StreamHeader);
+    uchar *payload = descriptors + static_cast<size_t>(blockCount) * sizeof(Block);
+    for (int b = 0; b < blockCount; ++b) {
+        const size_t offset = static_cast<size_t>(b) * kBlockValues;
+        const Block block = CodecKernel::encodeBlock(m_variant, m_codes.data() + offset,
+                                                     key ? nullptr : m_reference.data() + offset, payload);
+        std::memcpy(descriptors + static_cast<size_t>(b) * sizeof(Block), &block, sizeof(block));
+        payload += block.width * kBytesPerWidth;
+    }
+
+    m_codes.swap(m_reference);
+    m_referenceBins = binCount;
+    m_sinceKey = key ? 1 : m_sinceKey + 1;
+    return payload - out;
+}
+
+/*!
+ *  \brief Декодирует кадр целиком.
+ *  \param[in] data Поток кадра.
+ *  \param[in] size Размер потока, байты.
+ *  \param[out] db Значения, дБ.
+ *  \return false, если поток поврежден или предыдущий кадр не декодирован.
+ */
+bool SpectrumCodec::decode(const uchar *data, qint64 size, float *db)
+{
+    if (size < static_cast<qint64>(sizeof(StreamHeader))) {
+        return false;
+    }
+    StreamHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    return decodeSlice(data, size, 0, static_cast<int>(header.binCount), db);
+}
+
+/*!
+ *  \brief Декодирует значения [firstBin, lastBin) кадра.
+ *
+ *  Восстановленные блоки становятся опорными для следующего кадра, поэтому
+ *  последовательность кадров можно декодировать в одном и том же диапазоне,
+ *  не распаковывая остальные блоки ни одного кадра.
+ *
+ *  \param[in] data Поток кадра.
+ *  \param[in] size Размер потока, байты.
+ *  \param[in] firstBin Первое значение.
+ *  \param[in] lastBin Значение за последним.
+ *  \param[out] db Значения диапазона, дБ.
+ *  \return false, если кадр не декодирован.
+ */
+bool SpectrumCodec::decodeSlice(const uchar *data, qint64 size, int firstBin, int lastBin, float *db)
+{
+    if (size < static_cast<qint64>(sizeof(StreamHeader))) {
+        return false;
+    }
+    StreamHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const qint64 binCount = header.binCount;
+    const qint64 blockCount = blockCountFor(binCount);
+    const qint64 tableEnd = static_cast<qint64>(sizeof(StreamHeader)) + blockCount * static_cast<qint64>(sizeof(Block));
+    if (header.blockValues != kBlockValues || binCount > 0x7FFFFFFF || tableEnd > size || firstBin < 0
+        || lastBin < firstBin || lastBin > binCount) {
+        return false;
+    }
+
+    const int firstBlock = firstBin / kBlockValues;
+    const int lastBlock = static_cast<int>(blockCountFor(lastBin));
+    const bool key = (header.flags & kKeyFrame) != 0;
+    if (!key
+        && (m_referenceBins != binCount || firstBlock < m_validFirstBlock || lastBlock > m_validLastBlock)) {
+        return false;
+    }
+    if (key) {
+        m_reference.resize(static_cast<size_t>(blockCount) * kBlockValues);
+        m_referenceBins = static_cast<int>(binCount);
+    }
+
+    const uchar *descriptors = data + sizeof(StreamHeader);
+    qint64 offset = tableEnd;
+    for (int b = 0; b < firstBlock; ++b) {
+        offset += descriptors[static_cast<size_t>(b) * sizeof(Block) + offsetof(Block, width)] * kBytesPerWidth;
+    }
+    for (int b = firstBlock; b < lastBlock; ++b) {
+        Block block;
+        std::memcpy(&block, descriptors + static_cast<size_t>(b) * sizeof(Block), sizeof(block));
+        const qint64 bytes = block.width * kBytesPerWidth;
+        if (block.width > 16 || offset + bytes > size) {
+            // Опорный кадр уже частично перезаписан.
+            reset();
+            return false;
+        }
+        // Ядро читает опорный код значения до записи восстановленного на его место.
+        quint16 *codes = m_reference.data() + static_cast<size_t>(b) * kBlockValues;
+        CodecKernel::decodeBlock(m_variant, block, data + offset, codes, codes);
+        offset += bytes;
+    }
+
+    m_validFirstBlock = firstBlock;
+    m_validLastBlock = lastBlock;
+    CodecKernel::dequantize(m_variant, m_reference.data() + firstBin, db, lastBin - firstBin, m_settings.floorDb,
+                            m_settings.stepDb);
+    return true;
+}
@@ -0,0 +1,159 @@
+/*!
+ *  \file spectrumcodec.h
+ *  \brief Компактное кодирование кадров спектра: квантование дБ, предсказание и упаковка остатков.
+ */
+#ifndef SPECTRUMCODEC_H
+#define SPECTRUMCODEC_H
+
+#include <QtGlobal>
+
+#include <vector>
+
+#include "codeckernel.h"
+
+/*!
+ *  \class SpectrumCodec
+ *  \brief Кодирует последовательность кадров спектра с погрешностью не больше половины шага квантования.
+ *
+ *  Значения дБ квантуются с шагом stepDb от уровня floorDb в коды
+ *  0..maxCode (16-битные или 8-битные по диапазону), затем кадр
+ *  делится на блоки по CodecKernel::kBlockValues значений. Для каждого
+ *  блока ядро выбирает предсказание — временное (по предыдущему кадру)
+ *  и/или спектральное (по соседнему значению) — и упаковывает остатки
+ *  с разрядностью, достаточной для этого блока. Коды восстанавливаются
+ *  без потерь, поэтому ошибка кадра определяется только квантованием.
+ *
+ *  Поток кадра:
+ *  \code
+ *  [StreamHeader][CodecKernel::Block x blockCount][данные блока 0][данные блока 1]...
+ *  \endcode
+ *  Размер данных блока равен width * 16 байт, поэтому начало любого блока
+ *  находится по таблице описаний без распаковки предыдущих: decodeSlice()
+ *  восстанавливает только блоки заданного диапазона значений.
+ *
+ *  Ключевой кадр (каждый keyInterval-й, при смене числа значений или по
+ *  запросу) не ссылается на предыдущие. Остальные кадры декодируются,
+ *  только если тот же экземпляр декодировал предыдущий кадр в диапазоне,
+ *  покрывающем запрошенный. Экземпляр используется либо для кодирования,
+ *  либо для декодирования одной последовательности и не потокобезопасен.
+ */
+class SpectrumCodec
+{
+public:
+    //! \brief Разрядность кода квантования.
+    enum class Width {
+        //! \brief Коды 0..65535.
+        Int16,
+        //! \brief Коды 0..255.
+        UInt8
+    };
+
+    //! \brief Параметры кодирования.
+    struct Settings
+    {
+        //! \brief Шаг квантования, дБ (не меньше 0.001).
+        float stepDb = 0.1f;
+        //! \brief Уровень кода 0, дБ; значения ниже и NaN кодируются этим уровнем.
+        float floorDb = -200.0f;
+        //! \brief Разрядность кода; значения выше floorDb + maxCode * stepDb ограничиваются.
+        Width width = Width::Int16;
+        //! \brief Период ключевых кадров, кадры (не меньше 1).
+        int keyInterval = 32;
+    };
+
+    //! \brief Заголовок потока кадра.
+    struct StreamHeader
+    {
+        //! \brief Количество значений кадра.
+        quint32 binCount;
+        //! \brief Признаки кадра (kKeyFrame).
+        quint16 flags;
+        //! \brief Размер блока, значения (CodecKernel::kBlockValues).
+        quint16 blockValues;
+    };
+
+    //! \brief Признак ключевого кадра в StreamHeader::flags.
+    static constexpr quint16 kKeyFrame = 1;
+
+    //! \brief Конструирует кодек с параметрами по умолчанию.
+    SpectrumCodec();
+    /*!
+     *  \brief Конструирует кодек.
+     *  \param[in] settings Параметры кодирования.
+     */
+    explicit SpectrumCodec(const Settings &settings);
+
+    //! \brief Возвращает параметры кодирования (после приведения к допустимым).
+    const Settings &settings() const noexcept { return m_settings; }
+    //! \brief Возвращает наибольший код квантования.
+    quint16 maxCode() const noexcept { return m_maxCode; }
+
+    /*!
+     *  \brief Возвращает наибольший размер потока кадра.
+     *  \param[in] binCount Количество значений.
+     *  \return Размер, байты.
+     */
+    static qint64 maxEncodedBytes(qint64 binCount) noexcept;
+    /*!
+     *  \brief Проверяет, является ли поток ключевым кадром.
+     *  \param[in] data Поток кадра.
+     *  \param[in] size Размер потока, байты.
+     */
+    static bool isKeyFrame(const uchar *data, qint64 size) noexcept;
+
+    //! \brief Забывает предыдущий кадр: следующий кодируется ключевым, декодирование ждет ключевого.
+    void reset() noexcept;
+
+    /*!
+     *  \brief Кодирует кадр.
+     *  \param[in] db Значения, дБ.
+     *  \param[in] binCount Количество значений.
+     *  \param[out] out Буфер не меньше maxEncodedBytes(binCount) байт.
+     *  \param[in] keyFrame Признак принудительного ключевого кадра.
+     *  \return Размер потока кадра, байты.
+     */
+    qint64 encode(const float *db, int binCount, uchar *out, bool keyFrame = false);
+    /*!
+     *  \brief Декодирует кадр целиком.
+     *  \param[in] data Поток кадра.
+     *  \param[in] size Размер потока, байты.
+     *  \param[out] db Значения, дБ (StreamHeader::binCount штук).
+     *  \return false, если поток поврежден или предыдущий кадр не декодирован.
+     */
+    bool decode(const uchar *data, qint64 size, float *db);
+    /*!
+     *  \brief Декодирует значения [firstBin, lastBin) кадра, распаковывая только их блоки.
+     *  \param[in] data Поток кадра.
+     *  \param[in] size Размер потока, байты.
+     *  \param[in] firstBin Первое значение.
+     *  \param[in] lastBin Значение за последним (не больше StreamHeader::binCount).
+     *  \param[out] db Значения диапазона, дБ (lastBin - firstBin штук).
+     *  \return false, если поток поврежден, диапазон неверен или предыдущий кадр
+     *          не декодирован в покрывающем диапазоне.
+     */
+    bool decodeSlice(const uchar *data, qint64 size, int firstBin, int lastBin, float *db);
+
+private:
+    //! \brief Параметры кодирования.
+    Settings m_settings;
+    //! \brief Наибольший код.
+    quint16 m_maxCode = 0;
+    //! \brief Величина, обратная шагу квантования.
+    float m_invStep = 0.0f;
+    //! \brief Вариант ядра.
+    CodecKernel::Variant m_variant;
+    //! \brief Коды кодируемого кадра (переиспользуемый буфер).
+    std::vector<quint16> m_codes;
+    //! \brief Коды предыдущего кадра, дополненные до целого числа блоков.
+    std::vector<quint16> m_reference;
+    //! \brief Количество значений предыдущего кадра (-1 — предыдущего кадра нет).
+    int m_referenceBins = -1;
+    //! \brief Кадры с последнего ключевого, включая его.
+    int m_sinceKey = 0;
+    //! \brief Первый блок предыдущего кадра, восстановленный при декодировании.
+    int m_validFirstBlock = 0;
+    //! \brief Блок за последним восстановленным блоком предыдущего кадра.
+    int m_validLastBlock = 0;
+};
+
+#endif // SPECTRUMCODEC_H
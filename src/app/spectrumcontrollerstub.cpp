@@ -4,30 +4,858 @@
  */
 #include "spectrumcontrollerstub.h"
 
+#include "datastreamadapter.h"
+#include "pipelineprofiler.h"
+#include "recordingmanager.h"
+#include "replayengine.h"
+#include "scenariosimulator.h"
+#include "spectrumframepool.h"
+#include "spectrumproducer.h"
+#include "waterfallhistory.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QStandardPaths>
+#include <QUrl>
 #include <QtMath>
 #include <QDebug>
 
-//! \brief Конструирует заглушку контроллера.
+#include <memory>
+
+namespace {
+
+//! \brief Минимальное число значений панорамы на обзор, ниже которого запрашивается точный диапазон.
+constexpr double kMinPanoramaBinsPerView = 2048.0;
+
+// Кадры источников берутся из пулов размера по умолчанию: отставшая запись
+// и история водопада не должны исчерпывать их.
+static_assert(RecordingManager::kQueueCapacity + WaterfallHistory::kQueueCapacity
+                  <= SpectrumFramePool::kQueuedFrameCount,
+              "Frame pools do not cover the consumer queues");
+
+/*!
+ *  \brief Проверяет, покрывает ли кадр диапазон (с точностью до половины отсчета).
+ *  \param[in] frame Кадр.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+bool coversRange(const SpectrumFrame &frame, double minHz, double maxHz)
+{
+    if (!frame.isValid()) {
+        return false;
+    }
+    const double toleranceHz = 0.5 * (frame.viewMaxHz() - frame.viewMinHz()) / frame.binCount();
+    return frame.viewMinHz() <= minHz + toleranceHz && frame.viewMaxHz() >= maxHz - toleranceHz;
+}
+
+} // namespace
+
+//! \brief Конструирует заглушку контроллера и запускает поток формирования.
 SpectrumControllerStub::SpectrumControllerStub(QObject *parent)
     : QObject(parent)
+    , m_directionFinder(new DirectionFinder(this))
+    , m_recorder(new RecordingManager(this))
+    , m_replay(new ReplayEngine(this))
+    , m_stream(new DataStreamAdapter(this))
+    , m_producer(new SpectrumProducer([this](double minHz, double maxHz,
+                                             const SpectrumProducer::CancelCheck &cancelled) {
+          return m_engine.produce(minHz, maxHz, cancelled);
+      }, this))
+{
+    connect(m_producer, &SpectrumProducer::frameAvailable,
+            this, &SpectrumControllerStub::deliverLatestFrame, Qt::QueuedConnection);
+
+    // Запись и обнаружение получают каждый кадр прямо в потоке формирования,
+    // а не только доставленные в UI.
+    m_producer->setFrameSink([this](const SpectrumFrame &frame) {
+        m_recorder->submit(frame);
+        const qint64 detectStartNs = PipelineProfiler::isActive() ? PipelineProfiler::nowNs() : 0;
+        const bool detected = m_detector.process(frame);
+        if (detectStartNs != 0) {
+            PipelineProfiler::instance().record(PipelineProfiler::Stage::Detect, detectStartNs,
+                                                PipelineProfiler::nowNs(), frame.sequence());
+        }
+        makePulses(frame);
+        if (detected) {
+            QMetaObject::invokeMethod(this, &SpectrumControllerStub::deliverDetections, Qt::QueuedConnection);
+        }
+        if (m_liveTraces.process(frame)) {
+            QMetaObject::invokeMethod(this, &SpectrumControllerStub::deliverTraces, Qt::QueuedConnection);
+        }
+    });
+    m_replay->setFrameSink([this](const SpectrumFrame &frame) {
+        if (m_replayTraces.process(frame)) {
+            QMetaObject::invokeMethod(this, &SpectrumControllerStub::deliverTraces, Qt::QueuedConnection);
+        }
+    });
+    connect(m_recorder, &RecordingManager::fileOpened, this, [this](const QString &path) {
+        m_recordingPath = path;
+        emit recordingChanged();
+    });
+    connect(m_recorder, &RecordingManager::errorOccurred, this, &SpectrumControllerStub::recordingError);
+    connect(m_recorder, &RecordingManager::recordingStopped, this, &SpectrumControllerStub::recordingChanged);
+    connect(m_replay, &ReplayEngine::frameAvailable,
+            this, &SpectrumControllerStub::deliverReplayFrame, Qt::QueuedConnection);
+    connect(m_replay, &ReplayEngine::endReached, this, &SpectrumControllerStub::replayChanged);
+    connect(m_stream, &DataStreamAdapter::errorOccurred, this, &SpectrumControllerStub::streamError);
+    connect(m_stream, &QThread::finished, this, &SpectrumControllerStub::streamChanged);
+
+    m_detector.setSettings(m_detectorSettings);
+    m_liveTraces.setSettings(m_traceSettings);
+    m_replayTraces.setSettings(m_traceSettings);
+    m_producer->start();
+}
+
+//! \brief Останавливает потоки формирования и записи до разрушения контроллера.
+SpectrumControllerStub::~SpectrumControllerStub()
+{
+    m_producer->stop();
+    m_recorder->stopRecording();
+    m_replay->close();
+    m_stream->close();
+}
+
+//! \brief Проверяет, ведется ли запись кадров.
+bool SpectrumControllerStub::isRecording() const noexcept
+{
+    return m_recorder->isRecording();
+}
+
+//! \brief Проверяет, выдаются ли кадры записи вместо живых.
+bool SpectrumControllerStub::isReplayActive() const noexcept
+{
+    return m_replay->isOpen();
+}
+
+//! \brief Проверяет, идет ли воспроизведение записи.
+bool SpectrumControllerStub::isReplayPlaying() const noexcept
+{
+    return m_replay->isPlaying();
+}
+
+//! \brief Возвращает скорость воспроизведения.
+double SpectrumControllerStub::replaySpeed() const noexcept
+{
+    return m_replay->speed();
+}
+
+//! \brief Возвращает время первого кадра записи.
+qint64 SpectrumControllerStub::replayStartUs() const noexcept
+{
+    return m_replay->startUs();
+}
+
+//! \brief Возвращает время последнего кадра записи.
+qint64 SpectrumControllerStub::replayEndUs() const noexcept
+{
+    return m_replay->endUs();
+}
+
+//! \brief Возвращает время последнего выданного кадра записи.
+qint64 SpectrumControllerStub::replayPositionUs() const noexcept
+{
+    return m_replay->positionUs();
+}
+
+//! \brief Возвращает частоту формирования кадров, Гц.
+double SpectrumControllerStub::frameRateHz() const noexcept
+{
+    return m_producer->frameRateHz();
+}
+
+/*!
+ *  \brief Задает частоту формирования кадров и уведомляет подписчиков.
+ *  \param[in] frameRateHz Частота, Гц.
+ */
+void SpectrumControllerStub::setFrameRateHz(double frameRateHz)
+{
+    const double previous = m_producer->frameRateHz();
+    m_producer->setFrameRateHz(frameRateHz);
+    if (!qFuzzyCompare(previous, m_producer->frameRateHz())) {
+        emit frameRateHzChanged(m_producer->frameRateHz());
+    }
+}
+
+//! \brief Задает размер БПФ.
+void SpectrumControllerStub::setFftSize(int fftSize)
+{
+    FFTProcessor::Settings settings = m_fftSettings;
+    settings.fftSize = fftSize;
+    applyFftSettings(settings);
+}
+
+//! \brief Задает оконную функцию.
+void SpectrumControllerStub::setFftWindow(int fftWindow)
+{
+    FFTProcessor::Settings settings = m_fftSettings;
+    settings.window = static_cast<FFTProcessor::Window>(qBound(int(FFTProcessor::Window::Rectangular), fftWindow,
+                                                               int(FFTProcessor::Window::FlatTop)));
+    applyFftSettings(settings);
+}
+
+//! \brief Задает долю перекрытия сегментов.
+void SpectrumControllerStub::setFftOverlap(double fftOverlap)
+{
+    FFTProcessor::Settings settings = m_fftSettings;
+    settings.overlap = fftOverlap;
+    applyFftSettings(settings);
+}
+
+//! \brief Задает режим усреднения.
+void SpectrumControllerStub::setFftAveraging(int fftAveraging)
+{
+    FFTProcessor::Settings settings = m_fftSettings;
+    settings.averaging = static_cast<FFTProcessor::Averaging>(qBound(int(FFTProcessor::Averaging::None), fftAveraging,
+                                                                     int(FFTProcessor::Averaging::Exponential)));
+    applyFftSettings(settings);
+}
+
+//! \brief Задает число усредняемых сегментов.
+void SpectrumControllerStub::setFftAverageCount(int fftAverageCount)
+{
+    FFTProcessor::Settings settings = m_fftSettings;
+    settings.averageCount = fftAverageCount;
+    applyFftSettings(settings);
+}
+
+//! \brief Задает полосу одной стоянки обхода.
+void SpectrumControllerStub::setSweepDwellSpanHz(double sweepDwellSpanHz)
+{
+    sweepDwellSpanHz = qMax(0.0, sweepDwellSpanHz);
+    if (qFuzzyCompare(m_sweepSettings.dwellSpanHz + 1.0, sweepDwellSpanHz + 1.0)) {
+        return;
+    }
+    m_sweepSettings.dwellSpanHz = sweepDwellSpanHz;
+    m_engine.setSweepSettings(m_sweepSettings);
+    emit sweepSettingsChanged();
+    dispatchViewportRequest();
+}
+
+//! \brief Задает число стоянок на один кадр.
+void SpectrumControllerStub::setSweepDwellsPerFrame(int sweepDwellsPerFrame)
+{
+    sweepDwellsPerFrame = qBound(1, sweepDwellsPerFrame, 64);
+    if (m_sweepSettings.dwellsPerFrame == sweepDwellsPerFrame) {
+        return;
+    }
+    m_sweepSettings.dwellsPerFrame = sweepDwellsPerFrame;
+    m_engine.setSweepSettings(m_sweepSettings);
+    emit sweepSettingsChanged();
+}
+
+//! \brief Запускает или приостанавливает воспроизведение записи.
+void SpectrumControllerStub::setReplayPlaying(bool replayPlaying)
+{
+    if (!m_replay->isOpen() || m_replay->isPlaying() == replayPlaying) {
+        return;
+    }
+    m_replay->setPlaying(replayPlaying);
+    emit replayChanged();
+}
+
+//! \brief Задает скорость воспроизведения.
+void SpectrumControllerStub::setReplaySpeed(double replaySpeed)
+{
+    const double previous = m_replay->speed();
+    m_replay->setSpeed(replaySpeed);
+    if (!qFuzzyCompare(previous + 1.0, m_replay->speed() + 1.0)) {
+        emit replayChanged();
+    }
+}
+
+//! \brief Задает способ обнаружения.
+void SpectrumControllerStub::setDetectorMethod(int detectorMethod)
+{
+    SignalDetector::Settings settings = m_detectorSettings;
+    settings.method = static_cast<SignalDetector::Method>(detectorMethod);
+    applyDetectorSettings(settings);
+}
+
+//! \brief Задает число защитных ячеек CFAR.
+void SpectrumControllerStub::setCfarGuardCells(int cfarGuardCells)
+{
+    SignalDetector::Settings settings = m_detectorSettings;
+    settings.guardCells = cfarGuardCells;
+    applyDetectorSettings(settings);
+}
+
+//! \brief Задает число обучающих ячеек CFAR.
+void SpectrumControllerStub::setCfarTrainingCells(int cfarTrainingCells)
+{
+    SignalDetector::Settings settings = m_detectorSettings;
+    settings.trainingCells = cfarTrainingCells;
+    applyDetectorSettings(settings);
+}
+
+//! \brief Задает превышение порога CFAR над шумом.
+void SpectrumControllerStub::setCfarOffsetDb(double cfarOffsetDb)
+{
+    SignalDetector::Settings settings = m_detectorSettings;
+    settings.offsetDb = cfarOffsetDb;
+    applyDetectorSettings(settings);
+}
+
+//! \brief Включает набор трасс обработки.
+void SpectrumControllerStub::setTraceModes(int traceModes)
+{
+    TraceProcessor::Settings settings = m_traceSettings;
+    settings.modes = traceModes;
+    applyTraceSettings(settings);
+}
+
+//! \brief Задает вес нового кадра в средней трассе.
+void SpectrumControllerStub::setTraceAverageFactor(double traceAverageFactor)
+{
+    TraceProcessor::Settings settings = m_traceSettings;
+    settings.averageFactor = static_cast<float>(traceAverageFactor);
+    applyTraceSettings(settings);
+}
+
+//! \brief Задает спад трассы пика за кадр.
+void SpectrumControllerStub::setTracePeakDecayDb(double tracePeakDecayDb)
+{
+    TraceProcessor::Settings settings = m_traceSettings;
+    settings.peakDecayDb = static_cast<float>(tracePeakDecayDb);
+    applyTraceSettings(settings);
+}
+
+/*!
+ *  \brief Начинает трассы обработки заново в диапазоне частот.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+void SpectrumControllerStub::resetTraces(double minHz, double maxHz)
+{
+    m_liveTraces.requestReset(minHz, maxHz);
+    m_replayTraces.requestReset(minHz, maxHz);
+}
+
+//! \brief Начинает все трассы обработки заново со следующего кадра.
+void SpectrumControllerStub::resetTraces()
+{
+    m_liveTraces.requestReset();
+    m_replayTraces.requestReset();
+}
+
+/*!
+ *  \brief Нормализует параметры так же, как FFTProcessor, и передает их движку.
+ *  \param[in] settings Новые параметры.
+ */
+void SpectrumControllerStub::applyFftSettings(const FFTProcessor::Settings &settings)
+{
+    FFTProcessor::Settings normalized = settings;
+    int fftSize = FFTProcessor::kMinFftSize;
+    while (fftSize < normalized.fftSize && fftSize < FFTProcessor::kMaxFftSize) {
+        fftSize <<= 1;
+    }
+    normalized.fftSize = fftSize;
+    normalized.overlap = qBound(0.0, normalized.overlap, FFTProcessor::kMaxOverlap);
+    normalized.averageCount = qBound(1, normalized.averageCount, 1024);
+
+    if (normalized.fftSize == m_fftSettings.fftSize && normalized.window == m_fftSettings.window
+        && qFuzzyCompare(normalized.overlap, m_fftSettings.overlap) && normalized.averaging == m_fftSettings.averaging
+        && normalized.averageCount == m_fftSettings.averageCount) {
+        return;
+    }
+
+    m_fftSettings = normalized;
+    m_engine.setSettings(m_fftSettings);
+    emit fftSettingsChanged();
+    // Детализация панорамы зависит от размера БПФ.
+    dispatchViewportRequest();
+}
+
+/*!
+ *  \brief Нормализует параметры обнаружения и передает их детектору.
+ *  \param[in] settings Новые параметры.
+ */
+void SpectrumControllerStub::applyDetectorSettings(const SignalDetector::Settings &settings)
+{
+    const SignalDetector::Settings normalized = SignalDetector::normalized(settings);
+    if (normalized.method == m_detectorSettings.method && normalized.guardCells == m_detectorSettings.guardCells
+        && normalized.trainingCells == m_detectorSettings.trainingCells
+        && qFuzzyCompare(normalized.offsetDb + 1.0, m_detectorSettings.offsetDb + 1.0)) {
+        return;
+    }
+
+    m_detectorSettings = normalized;
+    m_detector.setSettings(m_detectorSettings);
+    emit detectorSettingsChanged();
+}
+
+/*!
+ *  \brief Нормализует параметры трасс обработки и передает их обоим накопителям.
+ *  \param[in] settings Новые параметры.
+ */
+void SpectrumControllerStub::applyTraceSettings(const TraceProcessor::Settings &settings)
+{
+    const TraceProcessor::Settings normalized = TraceProcessor::normalized(settings);
+    if (normalized.modes == m_traceSettings.modes && normalized.averageFactor == m_traceSettings.averageFactor
+        && normalized.peakDecayDb == m_traceSettings.peakDecayDb) {
+        return;
+    }
+
+    m_traceSettings = normalized;
+    m_liveTraces.setSettings(m_traceSettings);
+    m_replayTraces.setSettings(m_traceSettings);
+    emit traceSettingsChanged();
+}
+
+/*!
+ *  \brief Открывает файл I/Q и передает его движку.
+ *  \param[in] path Путь к файлу cf32.
+ *  \param[in] sampleRateHz Частота дискретизации записи, Гц.
+ *  \param[in] centerHz Центральная частота записи, Гц.
+ *  \return true, если файл открыт.
+ */
+bool SpectrumControllerStub::openIqFile(const QString &path, double sampleRateHz, double centerHz)
+{
+    auto source = std::make_shared<FileIqSource>();
+    if (!source->open(path, sampleRateHz, centerHz)) {
+        qWarning().noquote() << QStringLiteral("openIqFile: cannot read %1").arg(path);
+        return false;
+    }
+    stopStream();
+    stopScenario();
+    m_engine.setSource(std::move(source));
+    return true;
+}
+
+//! \brief Переключает движок на синтетический источник I/Q.
+void SpectrumControllerStub::useSyntheticSource()
 {
+    stopStream();
+    stopScenario();
+    m_engine.setSource(std::make_shared<SyntheticIqSource>());
 }
 
 /*!
- *  \brief Генерирует и отправляет синтетический спектр.
+ *  \brief Начинает прием потока РПУ и переключает на него движок.
+ *  \param[in] address Адрес потока: "udp://адрес:порт" или "shm://имя".
+ *  \return true, если прием начат.
+ */
+bool SpectrumControllerStub::openStream(const QString &address)
+{
+    DataStreamAdapter::Settings settings;
+    if (!DataStreamAdapter::parseAddress(address, settings)) {
+        qWarning().noquote() << QStringLiteral("openStream: unsupported address %1").arg(address);
+        return false;
+    }
+    const bool wasActive = m_stream->isOpen();
+    if (!m_stream->open(settings)) {
+        qWarning().noquote() << QStringLiteral("openStream: cannot open %1").arg(address);
+        if (wasActive) {
+            m_engine.setSource(std::make_shared<SyntheticIqSource>());
+            emit streamChanged();
+        }
+        return false;
+    }
+    stopScenario();
+    m_engine.setSource(m_stream->source());
+    emit streamChanged();
+    return true;
+}
+
+//! \brief Прекращает прием потока и возвращает движок к синтетическому источнику.
+void SpectrumControllerStub::closeStream()
+{
+    if (!m_stream->isOpen()) {
+        return;
+    }
+    useSyntheticSource();
+}
+
+/*!
+ *  \brief Запускает сценарий из файла JSON.
+ *  \param[in] path Путь к файлу сценария.
+ *  \return true, если сценарий прочитан.
+ */
+bool SpectrumControllerStub::openScenario(const QString &path)
+{
+    ScenarioSimulator::Scenario scenario;
+    QString error;
+    if (!ScenarioSimulator::load(path, scenario, &error)) {
+        qWarning().noquote() << QStringLiteral("openScenario: %1").arg(error);
+        emit scenarioError(error);
+        return false;
+    }
+
+    stopStream();
+    // Время сценария отсчитывается от запуска: импульсы привязываются к
+    // меткам времени кадров, которые ставит поток формирования.
+    auto simulator = std::make_shared<const ScenarioSimulator>(scenario, QDateTime::currentMSecsSinceEpoch() * 1000);
+    m_engine.setSource(std::make_shared<ScenarioIqSource>(simulator));
+    m_scenario = simulator;
+    m_scenarioRequests.writeBuffer() = std::move(simulator);
+    m_scenarioRequests.publish();
+    setFrameRateHz(scenario.frameRateHz);
+    emit scenarioChanged();
+    return true;
+}
+
+//! \brief Останавливает сценарий и возвращает движок к синтетическому источнику.
+void SpectrumControllerStub::closeScenario()
+{
+    if (!m_scenario) {
+        return;
+    }
+    useSyntheticSource();
+}
+
+//! \brief Проверяет, читает ли движок поток РПУ.
+bool SpectrumControllerStub::isStreamActive() const noexcept
+{
+    return m_stream->isOpen();
+}
+
+/*!
+ *  \brief Начинает запись всех формируемых кадров.
+ *  \param[in] directory Каталог записи; пустой — каталог recordings данных приложения.
+ *  \return true, если запись начата.
+ */
+bool SpectrumControllerStub::startRecording(const QString &directory)
+{
+    RecordingManager::Settings settings;
+    settings.directory = directory.isEmpty()
+        ? QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(QStringLiteral("recordings"))
+        : directory;
+
+    const bool started = m_recorder->startRecording(settings);
+    if (!started) {
+        qWarning().noquote() << QStringLiteral("startRecording: cannot use %1").arg(settings.directory);
+        emit recordingError(tr("Каталог записи недоступен: %1").arg(settings.directory));
+    }
+    emit recordingChanged();
+    return started;
+}
+
+//! \brief Останавливает запись; кадры из очереди дописываются в потоке записи.
+void SpectrumControllerStub::stopRecording()
+{
+    if (!m_recorder->isRecording()) {
+        return;
+    }
+    m_recorder->stopRecording();
+    emit recordingChanged();
+}
+
+/*!
+ *  \brief Открывает серию записи и выдает ее кадры вместо живых.
+ *  \param[in] path Путь или URL (file://) любого файла серии.
+ *  \return true, если запись открыта.
+ */
+bool SpectrumControllerStub::openReplay(const QString &path)
+{
+    // Из QML путь приходит как URL диалога выбора файла.
+    const QUrl url(path);
+    // Трассы записи начинаются с ее первого кадра, а не с прошлой записи.
+    m_replayTraces.requestReset();
+    const bool opened = m_replay->open(url.isLocalFile() ? url.toLocalFile() : path);
+    if (!opened) {
+        qWarning().noquote() << QStringLiteral("openReplay: cannot read %1").arg(path);
+    } else {
+        m_replay->setDecodeRange(m_viewMinHz, m_viewMaxHz);
+    }
+    emit replayChanged();
+    emit replayPositionChanged();
+    return opened;
+}
+
+//! \brief Закрывает запись и возвращается к живым кадрам.
+void SpectrumControllerStub::closeReplay()
+{
+    if (!m_replay->isOpen()) {
+        return;
+    }
+    m_replay->close();
+    emit replayChanged();
+}
+
+/*!
+ *  \brief Переходит к кадру записи, сформированному не позже заданного времени.
+ *  \param[in] timestampUs Время, мкс от начала эпохи.
+ */
+void SpectrumControllerStub::seekReplay(qint64 timestampUs)
+{
+    if (m_replay->isOpen()) {
+        // После перехода номера кадров идут не по порядку: трассы начинаются с кадра новой позиции.
+        m_replayTraces.requestReset();
+        m_replay->seek(timestampUs);
+    }
+}
+
+/*!
+ *  \brief Передает потоку формирования новый диапазон обзора.
+ *  \param[in] viewMinHz Нижняя граница панорамы, Гц.
+ *  \param[in] viewMaxHz Верхняя граница панорамы, Гц.
+ */
+void SpectrumControllerStub::requestSpectrum(double viewMinHz, double viewMaxHz)
+{
+    m_panoramaMinHz = viewMinHz;
+    m_panoramaMaxHz = viewMaxHz;
+    m_panoramaFrame = SpectrumFrame();
+    if (m_viewMaxHz <= m_viewMinHz) {
+        m_viewMinHz = viewMinHz;
+        m_viewMaxHz = viewMaxHz;
+    }
+    dispatchViewportRequest();
+}
+
+/*!
+ *  \brief Планирует формирование спектра для нового диапазона обзора.
  *  \param[in] viewMinHz Нижняя граница обзора, Гц.
  *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
+ *  \param[in] generation Поколение диапазона.
  */
-void SpectrumControllerStub::requestSpectrum(double viewMinHz, double viewMaxHz)
+void SpectrumControllerStub::scheduleViewport(double viewMinHz, double viewMaxHz, quint64 generation)
+{
+    if (generation <= m_viewGeneration) {
+        return;
+    }
+    m_viewGeneration = generation;
+    m_viewMinHz = viewMinHz;
+    m_viewMaxHz = viewMaxHz;
+    if (m_replay->isOpen()) {
+        // Кадры записи восстанавливаются только в окрестности обзора.
+        m_replay->setDecodeRange(viewMinHz, viewMaxHz);
+    }
+    dispatchViewportRequest();
+}
+
+//! \brief Выбирает диапазон формирования и при необходимости отправляет новый запрос.
+void SpectrumControllerStub::dispatchViewportRequest()
 {
-    float minDb = -120.0f;
-    float maxDb = 0.0f;
-    QVariantList samples = generateSpectrum(viewMinHz, viewMaxHz, minDb, maxDb);
-    emit spectrumReady(viewMinHz, viewMaxHz, samples, minDb, maxDb);
+    if (m_panoramaMaxHz <= m_panoramaMinHz) {
+        return;
+    }
+
+    // Разрешение панорамы: стоянка обхода (или вся панорама) делится на fftSize значений.
+    const double panoramaSpanHz = m_panoramaMaxHz - m_panoramaMinHz;
+    const double dwellSpanHz = m_sweepSettings.dwellSpanHz > 0.0
+        ? qMin(m_sweepSettings.dwellSpanHz, panoramaSpanHz)
+        : panoramaSpanHz;
+    const double panoramaResolutionHz = dwellSpanHz / m_fftSettings.fftSize;
+
+    const double viewMinHz = qMax(m_viewMinHz, m_panoramaMinHz);
+    const double viewMaxHz = qMin(m_viewMaxHz, m_panoramaMaxHz);
+    const double viewSpanHz = viewMaxHz - viewMinHz;
+    const bool exact = viewSpanHz > 0.0 && viewSpanHz <= dwellSpanHz
+        && viewSpanHz / panoramaResolutionHz < kMinPanoramaBinsPerView;
+
+    const double requestMinHz = exact ? viewMinHz : m_panoramaMinHz;
+    const double requestMaxHz = exact ? viewMaxHz : m_panoramaMaxHz;
+    if (m_requestGeneration == 0 || requestMinHz != m_requestMinHz || requestMaxHz != m_requestMaxHz) {
+        m_requestMinHz = requestMinHz;
+        m_requestMaxHz = requestMaxHz;
+        m_producer->requestViewport(requestMinHz, requestMaxHz, ++m_requestGeneration);
+    }
+
+    if (!m_replay->isOpen() && !coversRange(m_latestFrame, viewMinHz, viewMaxHz) && m_panoramaFrame.isValid()
+        && m_latestFrame.sequence() != m_panoramaFrame.sequence()) {
+        m_latestFrame = m_panoramaFrame;
+        emit spectrumReady(m_latestFrame);
+    }
+}
+
+//! \brief Забирает последний готовый кадр, обновляет статистику обхода и отправляет spectrumReady.
+void SpectrumControllerStub::deliverLatestFrame()
+{
+    SpectrumFrame frame;
+    if (!m_producer->takeLatestFrame(frame)) {
+        return;
+    }
+    // Кадры, замененные в слоте до получения потоком UI, до экрана не дошли.
+    const quint64 drops = m_producer->droppedFrames();
+    const quint64 newDrops = drops - qMin(drops, m_reportedDrops);
+    m_reportedDrops = drops;
+    updateFramePoolStats();
+    updateStreamStats();
+    if (PipelineProfiler::isActive()) {
+        PipelineProfiler &profiler = PipelineProfiler::instance();
+        profiler.addDroppedFrames(newDrops);
+        if (frame.publishedNs() != 0) {
+            profiler.record(PipelineProfiler::Stage::Deliver, frame.publishedNs(),
+                            PipelineProfiler::nowNs(), frame.sequence());
+        }
+    }
+
+    if (coversRange(frame, m_panoramaMinHz, m_panoramaMaxHz)) {
+        m_panoramaFrame = frame;
+    }
+    if (frame.viewportGeneration() < m_requestGeneration) {
+        // Кадр замененного запроса обзора: до UI не доходит.
+        return;
+    }
+    m_latestFrame = frame;
+    if (m_replay->isOpen()) {
+        // Живые кадры продолжают формироваться (и записываться), но в UI идут кадры записи.
+        return;
+    }
+
+    if (m_completedSweeps != m_engine.completedSweeps()) {
+        m_completedSweeps = m_engine.completedSweeps();
+        m_sweepDurationUs = m_engine.sweepDurationUs();
+        m_revisitIntervalUs = m_engine.revisitIntervalUs();
+        emit sweepStatsChanged();
+    }
+    emit spectrumReady(m_latestFrame);
+}
+
+//! \brief Забирает последний кадр записи и отправляет spectrumReady.
+void SpectrumControllerStub::deliverReplayFrame()
+{
+    if (!m_replay->takeLatestFrame(m_latestFrame)) {
+        return;
+    }
+    updateFramePoolStats();
+    emit replayPositionChanged();
+    emit spectrumReady(m_latestFrame);
+}
+
+//! \brief Обновляет счетчик исчерпания пулов буферов кадров.
+void SpectrumControllerStub::updateFramePoolStats()
+{
+    const quint64 exhausted = m_engine.framePoolExhaustedCount() + m_replay->framePoolExhaustedCount();
+    if (exhausted != m_framePoolExhaustedCount) {
+        m_framePoolExhaustedCount = exhausted;
+        emit framePoolStatsChanged();
+    }
+}
+
+//! \brief Обновляет счетчики приема потока.
+void SpectrumControllerStub::updateStreamStats()
+{
+    if (!m_stream->isOpen()) {
+        return;
+    }
+    const DataStreamAdapter::Statistics stats = m_stream->statistics();
+    if (stats.packets != m_streamPackets || stats.lostPackets != m_streamLostPackets
+        || stats.completedFrames != m_streamCompletedFrames) {
+        m_streamPackets = stats.packets;
+        m_streamLostPackets = stats.lostPackets;
+        m_streamCompletedFrames = stats.completedFrames;
+        emit streamStatsChanged();
+    }
+}
+
+//! \brief Останавливает прием потока, не меняя источник движка.
+void SpectrumControllerStub::stopStream()
+{
+    if (m_stream->isOpen()) {
+        m_stream->close();
+    }
+}
+
+//! \brief Отключает сценарий от пеленгатора, не меняя источник движка.
+void SpectrumControllerStub::stopScenario()
+{
+    if (!m_scenario) {
+        return;
+    }
+    m_scenario.reset();
+    m_scenarioRequests.writeBuffer().reset();
+    m_scenarioRequests.publish();
+    emit scenarioChanged();
 }
 
 /*!
- *  \brief Логирует изменения полосы и отправляет echo-сигнал.
+ *  \brief Формирует импульсы для пеленгатора (поток формирования).
+ *
+ *  Без сценария импульсы строятся по обнаруженным сигналам кадра моделью
+ *  антенной системы. По сценарию выдаются импульсы всех излучателей за
+ *  время с предыдущего кадра, так что нагрузка на пеленгатор задается
+ *  импульсной структурой сценария, а не частотой кадров.
+ *
+ *  \param[in] frame Очередной кадр.
+ */
+void SpectrumControllerStub::makePulses(const SpectrumFrame &frame)
+{
+    if (m_scenarioRequests.consume()) {
+        m_pulseScenario = m_scenarioRequests.readBuffer();
+        m_pulseScenarioSec = -1.0;
+    }
+
+    if (!m_pulseScenario) {
+        if (!m_detector.lastBatch().signalList.empty()) {
+            m_arraySource.makePulses(m_detector.lastBatch(), m_directionFinder->activeSettings(),
+                                     m_directionFinder->antennaAzimuthDeg(), m_pulses);
+            m_directionFinder->process(m_pulses);
+        }
+        return;
+    }
+
+    const double nowSec = (frame.timestampUs() - m_pulseScenario->epochUs()) * 1e-6;
+    const double startSec = m_pulseScenarioSec < 0.0
+                                ? nowSec - 1.0 / m_pulseScenario->scenario().frameRateHz
+                                : m_pulseScenarioSec;
+    if (nowSec <= startSec) {
+        return;
+    }
+    m_pulseScenarioSec = nowSec;
+    if (m_pulseScenario->renderPulses(startSec, nowSec - startSec, m_directionFinder->activeSettings(),
+                                      m_directionFinder->antennaAzimuthDeg(), m_pulses) > 0) {
+        m_directionFinder->process(m_pulses);
+    }
+}
+
+//! \brief Забирает пакеты обнаружений и отправляет их подписчикам.
+void SpectrumControllerStub::deliverDetections()
+{
+    SignalBatch batch;
+    while (m_detector.takeBatch(batch)) {
+        m_detectedSignalCount = static_cast<int>(batch.signalList.size());
+        emit signalsDetected(batch);
+    }
+}
+
+//! \brief Забирает снимки трасс обработки и отправляет в UI снимок показываемых кадров.
+void SpectrumControllerStub::deliverTraces()
+{
+    // Забираются оба снимка, чтобы каждый накопитель снова мог уведомить UI.
+    SpectrumTraces live;
+    SpectrumTraces replay;
+    const bool liveReady = m_liveTraces.takeTraces(live);
+    const bool replayReady = m_replayTraces.takeTraces(replay);
+    if (m_replay->isOpen()) {
+        if (replayReady) {
+            emit tracesReady(replay);
+        }
+    } else if (liveReady) {
+        emit tracesReady(live);
+    }
+}
+
+/*!
+ *  \brief Возвращает полосу, создавая ее при первом обращении.
+ *  \param[in] bandId Идентификатор полосы.
+ *  \return Полоса.
+ */
+SignalDetector::Band &SpectrumControllerStub::band(int bandId)
+{
+    auto it = m_bands.find(bandId);
+    if (it == m_bands.end()) {
+        SignalDetector::Band created;
+        created.id = bandId;
+        it = m_bands.insert(bandId, created);
+    }
+    return it.value();
+}
+
+/*!
+ *  \brief Передает детектору текущие полосы и сообщает об изменении полосы.
+ *  \param[in] bandId Идентификатор измененной полосы.
+ */
+void SpectrumControllerStub::publishBand(int bandId)
+{
+    m_detector.setBands(std::vector<SignalDetector::Band>(m_bands.cbegin(), m_bands.cend()));
+
+    const SignalDetector::Band &changed = band(bandId);
+    emit bandStateChanged(bandId, (changed.minHz + changed.maxHz) * 0.5, changed.maxHz - changed.minHz,
+                          changed.thresholdDb, changed.enabled);
+}
+
+/*!
+ *  \brief Сохраняет границы полосы и передает их детектору.
  *  \param[in] bandId Идентификатор полосы.
  *  \param[in] centerHz Центральная частота, Гц.
  *  \param[in] widthHz Ширина полосы, Гц.
@@ -41,11 +869,16 @@ void SpectrumControllerStub::setBand(int bandId, double centerHz, double widthHz
                .arg(centerHz, 0, 'f', 2)
                .arg(widthHz, 0, 'f', 2)
                .arg(isFinal);
-    emit bandStateChanged(bandId, centerHz, widthHz, 0.0, true);
+
+    SignalDetector::Band &changed = band(bandId);
+    const double halfWidthHz = qMax(0.0, widthHz) * 0.5;
+    changed.minHz = centerHz - halfWidthHz;
+    changed.maxHz = centerHz + halfWidthHz;
+    publishBand(bandId);
 }
 
 /*!
- *  \brief Логирует изменение порога и отправляет echo-сигнал.
+ *  \brief Сохраняет порог полосы и передает его детектору.
  *  \param[in] bandId Идентификатор полосы.
  *  \param[in] thresholdDb Порог, дБ.
  *  \param[in] isFinal Признак финального подтверждения изменения.
@@ -57,11 +890,13 @@ void SpectrumControllerStub::setBandThreshold(int bandId, double thresholdDb, bo
                .arg(bandId)
                .arg(thresholdDb, 0, 'f', 1)
                .arg(isFinal);
-    emit bandStateChanged(bandId, 0.0, 0.0, thresholdDb, true);
+
+    band(bandId).thresholdDb = thresholdDb;
+    publishBand(bandId);
 }
 
 /*!
- *  \brief Логирует включение полосы и отправляет echo-сигнал.
+ *  \brief Включает или выключает обнаружение в полосе.
  *  \param[in] bandId Идентификатор полосы.
  *  \param[in] enabled Признак включения.
  */
@@ -71,57 +906,8 @@ void SpectrumControllerStub::setBandEnabled(int bandId, bool enabled)
         << QStringLiteral("setBandEnabled id=%1 enabled=%2")
                .arg(bandId)
                .arg(enabled);
-    emit bandStateChanged(bandId, 0.0, 0.0, 0.0, enabled);
-}
-
-/*!
- *  \brief Формирует синтетический спектр с пиками.
- *  \param[in] viewMinHz Нижняя граница обзора, Гц.
- *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
- *  \param[out] outMinDb Минимальное значение, дБ.
- *  \param[out] outMaxDb Максимальное значение, дБ.
- *  \return Список значений спектра.
- */
-QVariantList SpectrumControllerStub::generateSpectrum(double viewMinHz, double viewMaxHz,
-                                                      float &outMinDb, float &outMaxDb) const
-{
-    const int sampleCount = 4096;
-    const double spanHz = qMax(1.0, viewMaxHz - viewMinHz);
-
-    const double peaksHz[] = {1.2e9, 3.6e9, 6.8e9, 12.3e9, 16.2e9};
-    const double peakWidthsHz[] = {80e6, 120e6, 150e6, 200e6, 140e6};
-    const double peakHeightsDb[] = {40.0, 32.0, 38.0, 45.0, 28.0};
-
-    QVariantList samples;
-    samples.reserve(sampleCount);
 
-    outMinDb = 1e9f;
-    outMaxDb = -1e9f;
-
-    for (int i = 0; i < sampleCount; ++i) {
-        const double t = static_cast<double>(i) / (sampleCount - 1);
-        const double freqHz = viewMinHz + t * spanHz;
-
-        double noise = -98.0
-            + 6.0 * qSin(freqHz * 1e-7)
-            + 4.0 * qSin(freqHz * 3e-8)
-            + 2.5 * qSin(freqHz * 7e-8);
-
-        double value = noise;
-        for (int p = 0; p < 5; ++p) {
-            const double dist = (freqHz - peaksHz[p]) / peakWidthsHz[p];
-            if (qAbs(dist) < 6.0) {
-                value += peakHeightsDb[p] * qExp(-0.5 * dist * dist);
-            }
-        }
-
-        outMinDb = qMin(outMinDb, static_cast<float>(value));
-        outMaxDb = qMax(outMaxDb, static_cast<float>(value));
-        samples.append(value);
-    }
-
-    outMinDb = qMin(outMinDb, -120.0f);
-    outMaxDb = qMax(outMaxDb, -5.0f);
-
-    return samples;
+    band(bandId).enabled = enabled;
+    publishBand(bandId);
 }
+
@@ -5,28 +5,287 @@
 #ifndef SPECTRUMCONTROLLERSTUB_H
 #define SPECTRUMCONTROLLERSTUB_H
 
+#include <QMap>
 #include <QObject>
-#include <QVariantList>
+
+#include <memory>
+
+#include "directionfinder.h"
+#include "latestvalueslot.h"
+#include "signaldetector.h"
+#include "signalentity.h"
+#include "spectrumengine.h"
+#include "spectrumframe.h"
+#include "traceprocessor.h"
+
+class DataStreamAdapter;
+class RecordingManager;
+class ReplayEngine;
+class ScenarioSimulator;
+class SpectrumProducer;
 
 /*!
  *  \class SpectrumControllerStub
- *  \brief Генерирует синтетический спектр и отражает изменения диапазонов.
+ *  \brief Вычисляет спектр из отсчетов I/Q и отражает изменения диапазонов.
+ *
+ *  Кадры формируются непрерывно в потоке SpectrumProducer движком
+ *  SpectrumEngine (источник I/Q и FFTProcessor); в поток UI доставляется
+ *  только последний готовый кадр.
+ *
+ *  Запросы обзора планируются здесь же: пока обзор шире, чем детализация
+ *  панорамы, поток формирует всю панораму, а масштабирование обслуживает
+ *  ее пирамида. При глубоком приближении запрашивается точный диапазон
+ *  обзора одной стоянкой. Каждый запрос получает поколение; кадры
+ *  замененных запросов отменяются в потоке формирования или отбрасываются
+ *  до spectrumReady, а до прихода точного кадра показывается панорама.
+ *
+ *  Полосы обнаружения хранятся в контроллере и передаются SignalDetector,
+ *  который в том же потоке обрабатывает каждый кадр и выдает пакеты
+ *  обнаруженных сигналов (signalsDetected). Обнаруженные сигналы там же
+ *  пеленгуются DirectionFinder по амплитудам модели антенной системы
+ *  SyntheticArraySource; пеленги забирает поток сопровождения целей.
+ *
+ *  Трассы обработки (TraceProcessor) накапливаются там же по каждому
+ *  живому кадру, а при воспроизведении — по каждому кадру записи в потоке
+ *  ReplayEngine; в UI уходят их снимки (tracesReady).
+ *
+ *  Вместо синтетического источника движок может читать файл I/Q или поток
+ *  РПУ (DataStreamAdapter): отсчеты потока проходят через БПФ, а готовые
+ *  кадры спектра РПУ выдаются как есть.
+ *
+ *  Сценарий (ScenarioSimulator) заменяет источник для нагрузочных
+ *  прогонов: движок получает кадры или отсчеты излучателей сценария, а
+ *  пеленгатор — их импульсы за время между кадрами вместо модели
+ *  SyntheticArraySource.
  */
 class SpectrumControllerStub : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(double frameRateHz READ frameRateHz WRITE setFrameRateHz NOTIFY frameRateHzChanged FINAL)
+    Q_PROPERTY(int fftSize READ fftSize WRITE setFftSize NOTIFY fftSettingsChanged FINAL)
+    Q_PROPERTY(int fftWindow READ fftWindow WRITE setFftWindow NOTIFY fftSettingsChanged FINAL)
+    Q_PROPERTY(double fftOverlap READ fftOverlap WRITE setFftOverlap NOTIFY fftSettingsChanged FINAL)
+    Q_PROPERTY(int fftAveraging READ fftAveraging WRITE setFftAveraging NOTIFY fftSettingsChanged FINAL)
+    Q_PROPERTY(int fftAverageCount READ fftAverageCount WRITE setFftAverageCount NOTIFY fftSettingsChanged FINAL)
+    Q_PROPERTY(double sweepDwellSpanHz READ sweepDwellSpanHz WRITE setSweepDwellSpanHz NOTIFY sweepSettingsChanged FINAL)
+    Q_PROPERTY(int sweepDwellsPerFrame READ sweepDwellsPerFrame WRITE setSweepDwellsPerFrame NOTIFY sweepSettingsChanged FINAL)
+    Q_PROPERTY(double sweepDurationMs READ sweepDurationMs NOTIFY sweepStatsChanged FINAL)
+    Q_PROPERTY(double revisitIntervalMs READ revisitIntervalMs NOTIFY sweepStatsChanged FINAL)
+    Q_PROPERTY(quint64 completedSweeps READ completedSweeps NOTIFY sweepStatsChanged FINAL)
+    Q_PROPERTY(quint64 framePoolExhaustedCount READ framePoolExhaustedCount NOTIFY framePoolStatsChanged FINAL)
+    Q_PROPERTY(bool recording READ isRecording NOTIFY recordingChanged FINAL)
+    Q_PROPERTY(QString recordingPath READ recordingPath NOTIFY recordingChanged FINAL)
+    Q_PROPERTY(bool replayActive READ isReplayActive NOTIFY replayChanged FINAL)
+    Q_PROPERTY(bool replayPlaying READ isReplayPlaying WRITE setReplayPlaying NOTIFY replayChanged FINAL)
+    Q_PROPERTY(double replaySpeed READ replaySpeed WRITE setReplaySpeed NOTIFY replayChanged FINAL)
+    Q_PROPERTY(qint64 replayStartUs READ replayStartUs NOTIFY replayChanged FINAL)
+    Q_PROPERTY(qint64 replayEndUs READ replayEndUs NOTIFY replayChanged FINAL)
+    Q_PROPERTY(qint64 replayPositionUs READ replayPositionUs NOTIFY replayPositionChanged FINAL)
+    Q_PROPERTY(int detectorMethod READ detectorMethod WRITE setDetectorMethod NOTIFY detectorSettingsChanged FINAL)
+    Q_PROPERTY(int cfarGuardCells READ cfarGuardCells WRITE setCfarGuardCells NOTIFY detectorSettingsChanged FINAL)
+    Q_PROPERTY(int cfarTrainingCells READ cfarTrainingCells WRITE setCfarTrainingCells NOTIFY detectorSettingsChanged FINAL)
+    Q_PROPERTY(double cfarOffsetDb READ cfarOffsetDb WRITE setCfarOffsetDb NOTIFY detectorSettingsChanged FINAL)
+    Q_PROPERTY(int traceModes READ traceModes WRITE setTraceModes NOTIFY traceSettingsChanged FINAL)
+    Q_PROPERTY(double traceAverageFactor READ traceAverageFactor WRITE setTraceAverageFactor
+                   NOTIFY traceSettingsChanged FINAL)
+    Q_PROPERTY(double tracePeakDecayDb READ tracePeakDecayDb WRITE setTracePeakDecayDb
+                   NOTIFY traceSettingsChanged FINAL)
+    Q_PROPERTY(int detectedSignalCount READ detectedSignalCount NOTIFY signalsDetected FINAL)
+    Q_PROPERTY(DirectionFinder *directionFinder READ directionFinder CONSTANT FINAL)
+    Q_PROPERTY(bool streamActive READ isStreamActive NOTIFY streamChanged FINAL)
+    Q_PROPERTY(quint64 streamPackets READ streamPackets NOTIFY streamStatsChanged FINAL)
+    Q_PROPERTY(quint64 streamLostPackets READ streamLostPackets NOTIFY streamStatsChanged FINAL)
+    Q_PROPERTY(quint64 streamCompletedFrames READ streamCompletedFrames NOTIFY streamStatsChanged FINAL)
+    Q_PROPERTY(bool scenarioActive READ isScenarioActive NOTIFY scenarioChanged FINAL)
 
 public:
-    //! \brief Конструирует заглушку контроллера.
+    //! \brief Конструирует заглушку контроллера и запускает поток формирования.
     explicit SpectrumControllerStub(QObject *parent = nullptr);
+    //! \brief Останавливает поток формирования.
+    ~SpectrumControllerStub() override;
+
+    //! \brief Возвращает частоту формирования кадров, Гц.
+    double frameRateHz() const noexcept;
+    //! \brief Возвращает размер БПФ.
+    int fftSize() const noexcept { return m_fftSettings.fftSize; }
+    //! \brief Возвращает оконную функцию (значение FFTProcessor::Window).
+    int fftWindow() const noexcept { return static_cast<int>(m_fftSettings.window); }
+    //! \brief Возвращает долю перекрытия сегментов.
+    double fftOverlap() const noexcept { return m_fftSettings.overlap; }
+    //! \brief Возвращает режим усреднения (значение FFTProcessor::Averaging).
+    int fftAveraging() const noexcept { return static_cast<int>(m_fftSettings.averaging); }
+    //! \brief Возвращает число усредняемых сегментов.
+    int fftAverageCount() const noexcept { return m_fftSettings.averageCount; }
+    //! \brief Возвращает полосу одной стоянки обхода, Гц (0 — без обхода).
+    double sweepDwellSpanHz() const noexcept { return m_sweepSettings.dwellSpanHz; }
+    //! \brief Возвращает число стоянок на один кадр.
+    int sweepDwellsPerFrame() const noexcept { return m_sweepSettings.dwellsPerFrame; }
+    //! \brief Возвращает длительность последнего обхода панорамы, мс.
+    double sweepDurationMs() const noexcept { return m_sweepDurationUs / 1000.0; }
+    //! \brief Возвращает интервал повторного посещения панорамы, мс.
+    double revisitIntervalMs() const noexcept { return m_revisitIntervalUs / 1000.0; }
+    //! \brief Возвращает число завершенных обходов панорамы.
+    quint64 completedSweeps() const noexcept { return m_completedSweeps; }
+    //! \brief Возвращает число кадров, созданных в куче из-за исчерпания пулов буферов.
+    quint64 framePoolExhaustedCount() const noexcept { return m_framePoolExhaustedCount; }
+    //! \brief Проверяет, ведется ли запись кадров.
+    bool isRecording() const noexcept;
+    //! \brief Возвращает путь к текущему (последнему) файлу записи.
+    QString recordingPath() const { return m_recordingPath; }
+    //! \brief Проверяет, выдаются ли в spectrumReady кадры записи вместо живых.
+    bool isReplayActive() const noexcept;
+    //! \brief Проверяет, идет ли воспроизведение записи.
+    bool isReplayPlaying() const noexcept;
+    //! \brief Возвращает скорость воспроизведения (0 — как можно быстрее).
+    double replaySpeed() const noexcept;
+    //! \brief Возвращает время первого кадра записи, мкс от начала эпохи.
+    qint64 replayStartUs() const noexcept;
+    //! \brief Возвращает время последнего кадра записи, мкс от начала эпохи.
+    qint64 replayEndUs() const noexcept;
+    //! \brief Возвращает время последнего выданного кадра записи, мкс от начала эпохи.
+    qint64 replayPositionUs() const noexcept;
+    //! \brief Возвращает способ обнаружения (значение SignalDetector::Method).
+    int detectorMethod() const noexcept { return static_cast<int>(m_detectorSettings.method); }
+    //! \brief Возвращает число защитных ячеек CFAR с каждой стороны.
+    int cfarGuardCells() const noexcept { return m_detectorSettings.guardCells; }
+    //! \brief Возвращает число обучающих ячеек CFAR с каждой стороны.
+    int cfarTrainingCells() const noexcept { return m_detectorSettings.trainingCells; }
+    //! \brief Возвращает превышение порога CFAR над шумом, дБ.
+    double cfarOffsetDb() const noexcept { return m_detectorSettings.offsetDb; }
+    //! \brief Возвращает маску включенных трасс обработки (SpectrumPlotItem::TraceMode).
+    int traceModes() const noexcept { return m_traceSettings.modes; }
+    //! \brief Возвращает вес нового кадра в средней трассе.
+    double traceAverageFactor() const noexcept { return m_traceSettings.averageFactor; }
+    //! \brief Возвращает спад трассы пика за кадр, дБ.
+    double tracePeakDecayDb() const noexcept { return m_traceSettings.peakDecayDb; }
+    //! \brief Возвращает число сигналов в последнем пакете обнаружений.
+    int detectedSignalCount() const noexcept { return m_detectedSignalCount; }
+    //! \brief Возвращает пеленгатор обнаруженных сигналов.
+    DirectionFinder *directionFinder() const noexcept { return m_directionFinder; }
+    //! \brief Проверяет, читает ли движок поток РПУ.
+    bool isStreamActive() const noexcept;
+    //! \brief Возвращает число принятых пакетов потока.
+    quint64 streamPackets() const noexcept { return m_streamPackets; }
+    //! \brief Возвращает число пакетов потока, потерянных по пути.
+    quint64 streamLostPackets() const noexcept { return m_streamLostPackets; }
+    //! \brief Возвращает число собранных кадров спектра потока.
+    quint64 streamCompletedFrames() const noexcept { return m_streamCompletedFrames; }
+    //! \brief Проверяет, работает ли движок по сценарию.
+    bool isScenarioActive() const noexcept { return m_scenario != nullptr; }
+
+    /*!
+     *  \brief Переключает движок на чтение записи I/Q из файла.
+     *  \param[in] path Путь к файлу cf32 (чередующиеся float32 I и Q).
+     *  \param[in] sampleRateHz Частота дискретизации записи, Гц.
+     *  \param[in] centerHz Центральная частота записи, Гц.
+     *  \return true, если файл открыт.
+     */
+    Q_INVOKABLE bool openIqFile(const QString &path, double sampleRateHz, double centerHz);
+    //! \brief Переключает движок на синтетический источник I/Q.
+    Q_INVOKABLE void useSyntheticSource();
+    /*!
+     *  \brief Начинает прием потока РПУ и переключает на него движок.
+     *  \param[in] address Адрес потока: "udp://адрес:порт" или "shm://имя".
+     *  \return true, если прием начат.
+     */
+    Q_INVOKABLE bool openStream(const QString &address);
+    //! \brief Прекращает прием потока и возвращает движок к синтетическому источнику.
+    Q_INVOKABLE void closeStream();
+    /*!
+     *  \brief Запускает сценарий из файла JSON и переключает на него движок и пеленгатор.
+     *
+     *  Частота кадров берется из сценария.
+     *
+     *  \param[in] path Путь к файлу сценария.
+     *  \return true, если сценарий прочитан.
+     */
+    Q_INVOKABLE bool openScenario(const QString &path);
+    //! \brief Останавливает сценарий и возвращает движок к синтетическому источнику.
+    Q_INVOKABLE void closeScenario();
+    /*!
+     *  \brief Начинает запись всех формируемых кадров.
+     *  \param[in] directory Каталог записи; пустой — каталог recordings данных приложения.
+     *  \return true, если запись начата.
+     */
+    Q_INVOKABLE bool startRecording(const QString &directory = QString());
+    //! \brief Останавливает запись без ожидания; кадры из очереди дописываются в потоке записи.
+    Q_INVOKABLE void stopRecording();
+    /*!
+     *  \brief Открывает серию записи и выдает ее кадры вместо живых (на паузе у начала).
+     *  \param[in] path Путь или URL (file://) любого файла серии (*.ssr).
+     *  \return true, если запись открыта.
+     */
+    Q_INVOKABLE bool openReplay(const QString &path);
+    //! \brief Закрывает запись и возвращается к живым кадрам.
+    Q_INVOKABLE void closeReplay();
+    /*!
+     *  \brief Переходит к кадру записи, сформированному не позже заданного времени.
+     *  \param[in] timestampUs Время, мкс от начала эпохи.
+     */
+    Q_INVOKABLE void seekReplay(qint64 timestampUs);
+    /*!
+     *  \brief Начинает трассы обработки заново в диапазоне частот (полоса или обзор).
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     */
+    Q_INVOKABLE void resetTraces(double minHz, double maxHz);
+    //! \brief Начинает все трассы обработки заново со следующего кадра.
+    Q_INVOKABLE void resetTraces();
 
 public slots:
     /*!
-     *  \brief Генерирует синтетический спектр для заданного диапазона.
+     *  \brief Задает частоту формирования кадров.
+     *  \param[in] frameRateHz Частота, Гц.
+     */
+    void setFrameRateHz(double frameRateHz);
+    //! \brief Задает размер БПФ (округляется до степени двойки 1024..1048576).
+    void setFftSize(int fftSize);
+    //! \brief Задает оконную функцию (значение FFTProcessor::Window).
+    void setFftWindow(int fftWindow);
+    //! \brief Задает долю перекрытия сегментов (0..0.95).
+    void setFftOverlap(double fftOverlap);
+    //! \brief Задает режим усреднения (значение FFTProcessor::Averaging).
+    void setFftAveraging(int fftAveraging);
+    //! \brief Задает число усредняемых сегментов.
+    void setFftAverageCount(int fftAverageCount);
+    //! \brief Задает полосу одной стоянки обхода, Гц (0 — весь диапазон за одну стоянку).
+    void setSweepDwellSpanHz(double sweepDwellSpanHz);
+    //! \brief Задает число стоянок на один кадр.
+    void setSweepDwellsPerFrame(int sweepDwellsPerFrame);
+    //! \brief Запускает или приостанавливает воспроизведение записи.
+    void setReplayPlaying(bool replayPlaying);
+    //! \brief Задает скорость воспроизведения (0.1..100 или 0 — как можно быстрее).
+    void setReplaySpeed(double replaySpeed);
+    //! \brief Задает способ обнаружения (значение SignalDetector::Method).
+    void setDetectorMethod(int detectorMethod);
+    //! \brief Задает число защитных ячеек CFAR с каждой стороны (0..1024).
+    void setCfarGuardCells(int cfarGuardCells);
+    //! \brief Задает число обучающих ячеек CFAR с каждой стороны (1..1024).
+    void setCfarTrainingCells(int cfarTrainingCells);
+    //! \brief Задает превышение порога CFAR над шумом, дБ (0..100).
+    void setCfarOffsetDb(double cfarOffsetDb);
+    //! \brief Включает набор трасс обработки (маска SpectrumPlotItem::TraceMode).
+    void setTraceModes(int traceModes);
+    //! \brief Задает вес нового кадра в средней трассе (0..1].
+    void setTraceAverageFactor(double traceAverageFactor);
+    //! \brief Задает спад трассы пика за кадр, дБ.
+    void setTracePeakDecayDb(double tracePeakDecayDb);
+    /*!
+     *  \brief Задает панораму, которую поток формирует при широком обзоре.
+     *  \param[in] viewMinHz Нижняя граница панорамы, Гц.
+     *  \param[in] viewMaxHz Верхняя граница панорамы, Гц.
+     */
+    void requestSpectrum(double viewMinHz, double viewMaxHz);
+    /*!
+     *  \brief Планирует формирование спектра для нового диапазона обзора.
+     *
+     *  Обновления с поколением не новее уже принятого игнорируются.
+     *
      *  \param[in] viewMinHz Нижняя граница обзора, Гц.
      *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
+     *  \param[in] generation Поколение диапазона (FrequencyViewportModel::generation()).
      */
-    void requestSpectrum(double viewMinHz, double viewMaxHz);
+    void scheduleViewport(double viewMinHz, double viewMaxHz, quint64 generation);
     /*!
      *  \brief Принимает обновление параметров полосы от UI.
      *  \param[in] bandId Идентификатор полосы.
@@ -50,15 +309,62 @@ public slots:
     void setBandEnabled(int bandId, bool enabled);
 
 signals:
+    //! \brief Сигнал об изменении частоты формирования кадров.
+    void frameRateHzChanged(double frameRateHz);
+    //! \brief Сигнал об изменении параметров БПФ.
+    void fftSettingsChanged();
+    //! \brief Сигнал об изменении параметров обхода панорамы.
+    void sweepSettingsChanged();
+    //! \brief Сигнал об изменении статистики обхода панорамы.
+    void sweepStatsChanged();
+    //! \brief Сигнал об изменении числа кадров, не получивших буфер пула.
+    void framePoolStatsChanged();
+    //! \brief Сигнал о начале или окончании записи либо смене файла записи.
+    void recordingChanged();
+    /*!
+     *  \brief Сигнал об ошибке, прервавшей запись.
+     *  \param[in] message Описание ошибки.
+     */
+    void recordingError(const QString &message);
+    //! \brief Сигнал об открытии, закрытии записи или смене режима воспроизведения.
+    void replayChanged();
+    //! \brief Сигнал о выдаче очередного кадра записи.
+    void replayPositionChanged();
+    //! \brief Сигнал об изменении параметров обнаружения.
+    void detectorSettingsChanged();
+    //! \brief Сигнал об изменении параметров трасс обработки.
+    void traceSettingsChanged();
+    //! \brief Сигнал о начале или прекращении приема потока РПУ.
+    void streamChanged();
+    //! \brief Сигнал об изменении счетчиков приема потока.
+    void streamStatsChanged();
+    /*!
+     *  \brief Сигнал об ошибке, прервавшей прием потока.
+     *  \param[in] message Описание ошибки.
+     */
+    void streamError(const QString &message);
+    //! \brief Сигнал о запуске или остановке сценария.
+    void scenarioChanged();
+    /*!
+     *  \brief Сигнал об ошибке чтения сценария.
+     *  \param[in] message Описание ошибки.
+     */
+    void scenarioError(const QString &message);
+    /*!
+     *  \brief Сигнал о пакете сигналов, обнаруженных в очередном живом кадре.
+     *  \param[in] batch Пакет обнаружений.
+     */
+    void signalsDetected(const SignalBatch &batch);
     /*!
      *  \brief Сигнал о готовом спектре.
-     *  \param[in] viewMinHz Нижняя граница обзора, Гц.
-     *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
-     *  \param[in] samples Список значений спектра.
-     *  \param[in] minDb Минимальное значение, дБ.
-     *  \param[in] maxDb Максимальное значение, дБ.
+     *  \param[in] frame Кадр спектра (диапазон, шкала и значения в дБ).
+     */
+    void spectrumReady(const SpectrumFrame &frame);
+    /*!
+     *  \brief Сигнал о новом снимке трасс обработки показываемых кадров (живых или записи).
+     *  \param[in] traces Снимок трасс.
      */
-    void spectrumReady(double viewMinHz, double viewMaxHz, const QVariantList &samples, float minDb, float maxDb);
+    void tracesReady(const SpectrumTraces &traces);
     /*!
      *  \brief Сигнал об изменении параметров полосы.
      *  \param[in] bandId Идентификатор полосы.
@@ -69,16 +375,141 @@ signals:
      */
     void bandStateChanged(int bandId, double centerHz, double widthHz, double thresholdDb, bool enabled);
 
+private slots:
+    //! \brief Забирает последний кадр из потока формирования и отправляет его в UI.
+    void deliverLatestFrame();
+    //! \brief Забирает последний кадр записи и отправляет его в UI.
+    void deliverReplayFrame();
+    //! \brief Забирает пакеты обнаружений и отправляет их подписчикам.
+    void deliverDetections();
+    //! \brief Забирает снимки трасс обработки и отправляет в UI снимок показываемых кадров.
+    void deliverTraces();
+
 private:
     /*!
-     *  \brief Формирует синтетические значения спектра и определяет min/max.
-     *  \param[in] viewMinHz Нижняя граница обзора, Гц.
-     *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
-     *  \param[out] outMinDb Минимальное значение, дБ.
-     *  \param[out] outMaxDb Максимальное значение, дБ.
-     *  \return Список значений спектра.
+     *  \brief Нормализует и публикует параметры БПФ, уведомляя об изменении.
+     *  \param[in] settings Новые параметры.
+     */
+    void applyFftSettings(const FFTProcessor::Settings &settings);
+    /*!
+     *  \brief Нормализует и публикует параметры обнаружения, уведомляя об изменении.
+     *  \param[in] settings Новые параметры.
      */
-    QVariantList generateSpectrum(double viewMinHz, double viewMaxHz, float &outMinDb, float &outMaxDb) const;
+    void applyDetectorSettings(const SignalDetector::Settings &settings);
+    /*!
+     *  \brief Нормализует и публикует параметры трасс обработки, уведомляя об изменении.
+     *  \param[in] settings Новые параметры.
+     */
+    void applyTraceSettings(const TraceProcessor::Settings &settings);
+    /*!
+     *  \brief Возвращает полосу, создавая ее при первом обращении.
+     *  \param[in] bandId Идентификатор полосы.
+     */
+    SignalDetector::Band &band(int bandId);
+    //! \brief Передает детектору текущие полосы и сообщает об изменении полосы.
+    void publishBand(int bandId);
+    //! \brief Обновляет счетчик исчерпания пулов буферов кадров.
+    void updateFramePoolStats();
+    //! \brief Обновляет счетчики приема потока.
+    void updateStreamStats();
+    //! \brief Останавливает прием потока, не меняя источник движка.
+    void stopStream();
+    //! \brief Отключает сценарий от пеленгатора, не меняя источник движка.
+    void stopScenario();
+    /*!
+     *  \brief Формирует импульсы для пеленгатора (поток формирования).
+     *  \param[in] frame Очередной кадр.
+     */
+    void makePulses(const SpectrumFrame &frame);
+    /*!
+     *  \brief Выбирает диапазон формирования для текущего обзора и отправляет
+     *  новый запрос потоку, если диапазон изменился.
+     *
+     *  Если последний показанный кадр не покрывает обзор, сразу показывается
+     *  сохраненная панорама.
+     */
+    void dispatchViewportRequest();
+
+    //! \brief Движок вычисления спектра (работает в потоке формирования).
+    SpectrumEngine m_engine;
+    //! \brief Текущие параметры БПФ (поток UI).
+    FFTProcessor::Settings m_fftSettings;
+    //! \brief Текущие параметры обхода (поток UI).
+    SpectrumEngine::SweepSettings m_sweepSettings;
+    //! \brief Длительность последнего обхода, мкс.
+    qint64 m_sweepDurationUs = 0;
+    //! \brief Интервал повторного посещения, мкс.
+    qint64 m_revisitIntervalUs = 0;
+    //! \brief Число завершенных обходов.
+    quint64 m_completedSweeps = 0;
+    //! \brief Детектор сигналов (работает в потоке формирования).
+    SignalDetector m_detector;
+    //! \brief Текущие параметры обнаружения (поток UI).
+    SignalDetector::Settings m_detectorSettings;
+    //! \brief Трассы обработки живых кадров (работают в потоке формирования).
+    TraceProcessor m_liveTraces;
+    //! \brief Трассы обработки кадров записи (работают в потоке воспроизведения).
+    TraceProcessor m_replayTraces;
+    //! \brief Текущие параметры трасс обработки (поток UI).
+    TraceProcessor::Settings m_traceSettings;
+    //! \brief Полосы обнаружения по идентификаторам (поток UI).
+    QMap<int, SignalDetector::Band> m_bands;
+    //! \brief Число сигналов в последнем пакете обнаружений.
+    int m_detectedSignalCount = 0;
+    //! \brief Пеленгатор (обрабатывает пакеты в потоке формирования).
+    DirectionFinder *m_directionFinder = nullptr;
+    //! \brief Модель антенной системы (поток формирования).
+    SyntheticArraySource m_arraySource;
+    //! \brief Импульсы последнего пакета обнаружений (поток формирования).
+    DirectionFinder::PulseBatch m_pulses;
+    //! \brief Текущий сценарий (поток UI).
+    std::shared_ptr<const ScenarioSimulator> m_scenario;
+    //! \brief Слот сценария для импульсов (UI -> поток формирования; пустой — модель антенной системы).
+    LatestValueSlot<std::shared_ptr<const ScenarioSimulator>> m_scenarioRequests;
+    //! \brief Сценарий, по которому формируются импульсы (поток формирования).
+    std::shared_ptr<const ScenarioSimulator> m_pulseScenario;
+    //! \brief Время сценария, до которого импульсы уже выданы, с (отрицательное — еще нет).
+    double m_pulseScenarioSec = -1.0;
+    //! \brief Поток записи кадров.
+    RecordingManager *m_recorder = nullptr;
+    //! \brief Путь к текущему файлу записи.
+    QString m_recordingPath;
+    //! \brief Поток воспроизведения записи.
+    ReplayEngine *m_replay = nullptr;
+    //! \brief Поток приема данных РПУ.
+    DataStreamAdapter *m_stream = nullptr;
+    //! \brief Поток формирования кадров.
+    SpectrumProducer *m_producer = nullptr;
+    //! \brief Последний доставленный в UI кадр.
+    SpectrumFrame m_latestFrame;
+    //! \brief Последний кадр всей панорамы (показывается, пока формируется точный кадр).
+    SpectrumFrame m_panoramaFrame;
+    //! \brief Нижняя граница панорамы, Гц.
+    double m_panoramaMinHz = 0.0;
+    //! \brief Верхняя граница панорамы, Гц.
+    double m_panoramaMaxHz = 0.0;
+    //! \brief Нижняя граница обзора, Гц.
+    double m_viewMinHz = 0.0;
+    //! \brief Верхняя граница обзора, Гц.
+    double m_viewMaxHz = 0.0;
+    //! \brief Поколение принятого диапазона обзора.
+    quint64 m_viewGeneration = 0;
+    //! \brief Нижняя граница последнего запроса потоку, Гц.
+    double m_requestMinHz = 0.0;
+    //! \brief Верхняя граница последнего запроса потоку, Гц.
+    double m_requestMaxHz = 0.0;
+    //! \brief Поколение последнего запроса потоку; кадры старших поколений отбрасываются.
+    quint64 m_requestGeneration = 0;
+    //! \brief Число пропусков потока формирования, уже переданное PipelineProfiler.
+    quint64 m_reportedDrops = 0;
+    //! \brief Число кадров, созданных в куче из-за исчерпания пулов буферов.
+    quint64 m_framePoolExhaustedCount = 0;
+    //! \brief Число принятых пакетов потока.
+    quint64 m_streamPackets = 0;
+    //! \brief Число потерянных пакетов потока.
+    quint64 m_streamLostPackets = 0;
+    //! \brief Число собранных кадров спектра потока.
+    quint64 m_streamCompletedFrames = 0;
 };
 
 #endif // SPECTRUMCONTROLLERSTUB_H
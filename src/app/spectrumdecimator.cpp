@@ -4,8 +4,23 @@
  */
 #include "spectrumdecimator.h"
 
+#include "minmaxkernel.h"
+
+#include <QList>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
 #include <QtMath>
+
+#include <algorithm>
 #include <limits>
+#include <set>
+
+namespace {
+
+//! \brief Число значений, начиная с которого кадр делится между потоками.
+constexpr qint64 kParallelThreshold = qint64(1) << 18;
+
+} // namespace
 
 //! \brief Конструирует декоматор.
 SpectrumDecimator::SpectrumDecimator(QObject *parent)
@@ -14,38 +29,244 @@ SpectrumDecimator::SpectrumDecimator(QObject *parent)
 
 /*!
  *  \brief Вычисляет min/max для каждой выходной колонки.
- *  \param[in] samples Исходные значения спектра.
+ *  \param[in] frame Кадр спектра.
  *  \param[in] targetWidth Целевая ширина в пикселях.
  *  \return Список значений вида [min0, max0, min1, max1, ...].
  */
-QVariantList SpectrumDecimator::decimateMinMax(const QVariantList &samples, int targetWidth) const
+QList<float> SpectrumDecimator::decimateMinMax(const SpectrumFrame &frame, int targetWidth) const
 {
-    if (samples.isEmpty() || targetWidth <= 0) {
+    if (!frame.isValid() || targetWidth <= 0) {
         return {};
     }
 
-    const int sampleCount = samples.size();
-    const int width = qMax(1, targetWidth);
+    QList<float> out(targetWidth * 2);
+    decimateMinMax(frame.constBins(), frame.binCount(), targetWidth, out.data());
+    return out;
+}
+
+/*!
+ *  \brief Вычисляет min/max для поддиапазона кадра.
+ *  \param[in] frame Кадр спектра.
+ *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+ *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+ *  \param[in] targetWidth Целевая ширина в пикселях.
+ *  \return Список значений вида [min0, max0, min1, max1, ...].
+ */
+QList<float> SpectrumDecimator::decimateRange(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                                              int targetWidth) const
+{
+    if (!frame.isValid() || targetWidth <= 0) {
+        return {};
+    }
+
+    QList<float> out(targetWidth * 2);
+    decimateMinMax(frame, viewMinHz, viewMaxHz, targetWidth, out.data());
+    return out;
+}
+
+/*!
+ *  \brief Вычисляет min/max для поддиапазона кадра через пирамиду.
+ *  \param[in] frame Кадр спектра.
+ *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+ *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+ *  \param[in] targetWidth Целевая ширина в пикселях.
+ *  \param[out] out Буфер на 2 * targetWidth значений.
+ */
+void SpectrumDecimator::decimateMinMax(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                                       int targetWidth, float *out)
+{
+    decimateMinMax(frame, viewMinHz, viewMaxHz, targetWidth, 0, targetWidth, out);
+}
+
+/*!
+ *  \brief Вычисляет min/max только для колонок [firstColumn, lastColumn).
+ *  \param[in] frame Кадр спектра.
+ *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+ *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+ *  \param[in] targetWidth Общее количество колонок.
+ *  \param[in] firstColumn Первая колонка.
+ *  \param[in] lastColumn Колонка за последней.
+ *  \param[out] out Буфер на 2 * targetWidth значений.
+ */
+void SpectrumDecimator::decimateMinMax(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                                       int targetWidth, int firstColumn, int lastColumn, float *out)
+{
+    if (!out || targetWidth <= 0) {
+        return;
+    }
+    firstColumn = qBound(0, firstColumn, targetWidth);
+    lastColumn = qBound(firstColumn, lastColumn, targetWidth);
+
+    const double firstBin = frame.binPosition(viewMinHz);
+    const double lastBin = frame.binPosition(viewMaxHz);
+
+    if (frame.pyramid().binCount() == frame.binCount()) {
+        frame.pyramid().query(frame.constBins(), firstBin, lastBin, targetWidth, firstColumn, lastColumn, out);
+        return;
+    }
+
+    // Пирамида не построена: линейный проход по значениям поддиапазона.
+    const float *samples = frame.constBins();
+    const qint64 sampleCount = frame.binCount();
+    const double step = (lastBin - firstBin) / targetWidth;
+    const MinMaxKernel::Variant variant = MinMaxKernel::bestVariant();
+    for (int x = firstColumn; x < lastColumn; ++x) {
+        const qint64 start = qMax<qint64>(0, qFloor(firstBin + x * step));
+        const qint64 end = qMin(sampleCount, qMax(start + 1, qint64(qFloor(firstBin + (x + 1) * step))));
+        MinMaxKernel::reduce(variant, samples + start, qMax<qint64>(0, end - start), out[x * 2], out[x * 2 + 1]);
+    }
+}
+
+/*!
+ *  \brief Вычисляет min/max для каждой выходной колонки.
+ *  \param[in] samples Исходные значения спектра.
+ *  \param[in] sampleCount Количество исходных значений.
+ *  \param[in] targetWidth Целевая ширина в пикселях.
+ *  \param[out] out Буфер на 2 * targetWidth значений.
+ */
+void SpectrumDecimator::decimateMinMax(const float *samples, int sampleCount, int targetWidth, float *out)
+{
+    if (!samples || sampleCount <= 0 || targetWidth <= 0) {
+        return;
+    }
+
+    const MinMaxKernel::Variant variant = MinMaxKernel::bestVariant();
+    const int threads = QThreadPool::globalInstance()->maxThreadCount();
 
-    QVariantList out;
-    out.reserve(width * 2);
+    if (sampleCount < kParallelThreshold || threads <= 1 || targetWidth < threads) {
+        MinMaxKernel::decimate(variant, samples, sampleCount, targetWidth, 0, targetWidth, out);
+        return;
+    }
 
-    for (int x = 0; x < width; ++x) {
-        const int start = (x * sampleCount) / width;
-        const int end = qMax(start + 1, ((x + 1) * sampleCount) / width);
+    // Колонки делятся на непересекающиеся диапазоны: каждый поток пишет
+    // только свои пары min/max, синхронизация не нужна.
+    QList<QPair<int, int>> ranges;
+    const int chunk = (targetWidth + threads - 1) / threads;
+    for (int first = 0; first < targetWidth; first += chunk) {
+        ranges.append({first, qMin(targetWidth, first + chunk)});
+    }
 
-        double minVal = std::numeric_limits<double>::infinity();
-        double maxVal = -std::numeric_limits<double>::infinity();
+    QtConcurrent::blockingMap(ranges, [=](const QPair<int, int> &range) {
+        MinMaxKernel::decimate(variant, samples, sampleCount, targetWidth, range.first, range.second, out);
+    });
+}
+
+/*!
+ *  \brief Строит профиль порогов проходом по отсортированным границам полос.
+ *  \param[in] bands Полосы.
+ *  \return Участки по возрастанию частоты; соседние участки с равным порогом объединены.
+ */
+std::vector<SpectrumDecimator::ThresholdSegment>
+SpectrumDecimator::buildThresholdProfile(const std::vector<ThresholdBand> &bands)
+{
+    // Граница полосы: частота, порог и признак начала.
+    struct Edge
+    {
+        double hz;
+        float thresholdDb;
+        bool opens;
+    };
 
-        for (int i = start; i < end; ++i) {
-            const double v = samples.at(i).toDouble();
-            minVal = qMin(minVal, v);
-            maxVal = qMax(maxVal, v);
+    std::vector<Edge> edges;
+    edges.reserve(bands.size() * 2);
+    for (const ThresholdBand &band : bands) {
+        if (band.maxHz > band.minHz) {
+            edges.push_back({band.minHz, band.thresholdDb, true});
+            edges.push_back({band.maxHz, band.thresholdDb, false});
+        }
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.hz < b.hz; });
+
+    std::vector<ThresholdSegment> profile;
+    std::multiset<float> active;
+    for (size_t i = 0; i < edges.size();) {
+        const double hz = edges[i].hz;
+        for (; i < edges.size() && edges[i].hz == hz; ++i) {
+            if (edges[i].opens) {
+                active.insert(edges[i].thresholdDb);
+            } else {
+                active.erase(active.find(edges[i].thresholdDb));
+            }
+        }
+        if (active.empty() || i == edges.size()) {
+            continue;
         }
 
-        out.append(minVal);
-        out.append(maxVal);
+        const float thresholdDb = *active.rbegin();
+        if (!profile.empty() && profile.back().maxHz == hz && profile.back().thresholdDb == thresholdDb) {
+            profile.back().maxHz = edges[i].hz;
+        } else {
+            profile.push_back({hz, edges[i].hz, thresholdDb});
+        }
     }
+    return profile;
+}
 
-    return out;
+/*!
+ *  \brief Вычисляет порог каждой колонки обзора по профилю.
+ *
+ *  Частота колонки — ее левый край; колонки и участки перебираются
+ *  одновременно по возрастанию частоты.
+ *
+ *  \param[in] profile Профиль порогов.
+ *  \param[in] viewMinHz Нижняя граница обзора, Гц.
+ *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
+ *  \param[in] targetWidth Количество колонок.
+ *  \param[out] thresholds Пороги колонок.
+ */
+void SpectrumDecimator::columnThresholds(const std::vector<ThresholdSegment> &profile, double viewMinHz,
+                                         double viewMaxHz, int targetWidth, float *thresholds)
+{
+    if (!thresholds || targetWidth <= 0) {
+        return;
+    }
+
+    const double spanHz = qMax(1.0, viewMaxHz - viewMinHz);
+    auto segment = std::upper_bound(profile.cbegin(), profile.cend(), viewMinHz,
+                                    [](double hz, const ThresholdSegment &s) { return hz < s.maxHz; });
+    for (int x = 0; x < targetWidth; ++x) {
+        const double freqHz = viewMinHz + (static_cast<double>(x) / targetWidth) * spanHz;
+        while (segment != profile.cend() && segment->maxHz <= freqHz) {
+            ++segment;
+        }
+        thresholds[x] = segment != profile.cend() && segment->minHz <= freqHz
+            ? segment->thresholdDb
+            : -std::numeric_limits<float>::infinity();
+    }
+}
+
+/*!
+ *  \brief Сводит колонки к парам min/max и применяет пороги колонок.
+ *  \param[in] frame Кадр спектра.
+ *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+ *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+ *  \param[in] targetWidth Общее количество колонок.
+ *  \param[in] firstColumn Первая колонка.
+ *  \param[in] lastColumn Колонка за последней.
+ *  \param[in] thresholds Пороги колонок.
+ *  \param[out] out Буфер на 2 * targetWidth значений.
+ *  \param[out] visible Маска видимости на targetWidth значений.
+ *  \return Число видимых колонок в [firstColumn, lastColumn).
+ */
+int SpectrumDecimator::decimateMasked(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                                      int targetWidth, int firstColumn, int lastColumn, const float *thresholds,
+                                      float *out, quint8 *visible)
+{
+    if (!out || !thresholds || !visible || targetWidth <= 0) {
+        return 0;
+    }
+    firstColumn = qBound(0, firstColumn, targetWidth);
+    lastColumn = qBound(firstColumn, lastColumn, targetWidth);
+    decimateMinMax(frame, viewMinHz, viewMaxHz, targetWidth, firstColumn, lastColumn, out);
+
+    int visibleCount = 0;
+    for (int x = firstColumn; x < lastColumn; ++x) {
+        const float minVal = out[x * 2];
+        const float maxVal = out[x * 2 + 1];
+        const bool shown = maxVal >= minVal && maxVal >= thresholds[x];
+        out[x * 2] = qMax(minVal, thresholds[x]);
+        visible[x] = shown ? 1 : 0;
+        visibleCount += shown ? 1 : 0;
+    }
+    return visibleCount;
 }
@@ -4,8 +4,12 @@
 #ifndef SPECTRUMDECIMATOR_H
 #define SPECTRUMDECIMATOR_H
 
+#include <QList>
 #include <QObject>
-#include <QVariantList>
+
+#include <vector>
+
+#include "spectrumframe.h"
 
 /*! \class SpectrumDecimator
  *  \brief Сводит спектр к парам min/max на колонку пикселей.
@@ -14,15 +18,130 @@ class SpectrumDecimator : public QObject
 {
     Q_OBJECT
 public:
+    //! \brief Полоса порога в виде интервала частот.
+    struct ThresholdBand
+    {
+        //! \brief Нижняя граница, Гц.
+        double minHz = 0.0;
+        //! \brief Верхняя граница, Гц.
+        double maxHz = 0.0;
+        //! \brief Порог, дБ.
+        float thresholdDb = 0.0f;
+    };
+
+    //! \brief Участок профиля порогов [minHz, maxHz) с наибольшим порогом перекрывающих его полос.
+    struct ThresholdSegment
+    {
+        //! \brief Нижняя граница, Гц.
+        double minHz = 0.0;
+        //! \brief Верхняя граница (не включается), Гц.
+        double maxHz = 0.0;
+        //! \brief Порог, дБ.
+        float thresholdDb = 0.0f;
+    };
+
     //! \brief Конструирует декоматор.
     explicit SpectrumDecimator(QObject *parent = nullptr);
 
     /*! \brief Возвращает список min/max пар для целевой ширины.
-     *  \param[in] samples Исходные значения спектра.
+     *  \param[in] frame Кадр спектра.
+     *  \param[in] targetWidth Целевая ширина в пикселях.
+     *  \return Список значений вида [min0, max0, min1, max1, ...].
+     */
+    Q_INVOKABLE QList<float> decimateMinMax(const SpectrumFrame &frame, int targetWidth) const;
+
+    /*! \brief Возвращает список min/max пар для поддиапазона кадра.
+     *  \param[in] frame Кадр спектра.
+     *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+     *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
      *  \param[in] targetWidth Целевая ширина в пикселях.
      *  \return Список значений вида [min0, max0, min1, max1, ...].
      */
-    Q_INVOKABLE QVariantList decimateMinMax(const QVariantList &samples, int targetWidth) const;
+    Q_INVOKABLE QList<float> decimateRange(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                                           int targetWidth) const;
+
+    /*! \brief Сводит поддиапазон кадра к парам min/max.
+     *
+     *  Если у кадра построена пирамида, запрос обслуживается за O(targetWidth)
+     *  с подходящего уровня; колонки вне кадра получают пару (+inf, -inf).
+     *
+     *  \param[in] frame Кадр спектра.
+     *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+     *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+     *  \param[in] targetWidth Целевая ширина в пикселях.
+     *  \param[out] out Буфер на 2 * targetWidth значений.
+     */
+    static void decimateMinMax(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                               int targetWidth, float *out);
+
+    /*! \brief Как предыдущая перегрузка, но пересчитывает только колонки [firstColumn, lastColumn).
+     *
+     *  Используется для обновления колонок, затронутых изменившимися участками кадра.
+     *
+     *  \param[in] frame Кадр спектра.
+     *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+     *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+     *  \param[in] targetWidth Общее количество колонок.
+     *  \param[in] firstColumn Первая пересчитываемая колонка.
+     *  \param[in] lastColumn Колонка за последней пересчитываемой.
+     *  \param[out] out Буфер на 2 * targetWidth значений.
+     */
+    static void decimateMinMax(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz,
+                               int targetWidth, int firstColumn, int lastColumn, float *out);
+
+    /*! \brief Сводит непрерывный массив значений к парам min/max.
+     *
+     *  Использует векторное ядро MinMaxKernel, выбранное по возможностям
+     *  процессора; очень большие кадры делятся по колонкам между потоками.
+     *
+     *  \param[in] samples Исходные значения спектра.
+     *  \param[in] sampleCount Количество исходных значений.
+     *  \param[in] targetWidth Целевая ширина в пикселях.
+     *  \param[out] out Буфер на 2 * targetWidth значений вида [min0, max0, ...].
+     */
+    static void decimateMinMax(const float *samples, int sampleCount, int targetWidth, float *out);
+
+    /*! \brief Строит профиль порогов включенных полос.
+     *
+     *  Профиль — отсортированный список непересекающихся участков; строится
+     *  за O(B log B) один раз при изменении полос и затем используется для
+     *  любого обзора и ширины.
+     *
+     *  \param[in] bands Полосы (пустые интервалы пропускаются).
+     *  \return Участки по возрастанию частоты.
+     */
+    static std::vector<ThresholdSegment> buildThresholdProfile(const std::vector<ThresholdBand> &bands);
+
+    /*! \brief Вычисляет порог каждой колонки обзора за O(targetWidth + участков профиля).
+     *  \param[in] profile Профиль порогов.
+     *  \param[in] viewMinHz Нижняя граница обзора, Гц.
+     *  \param[in] viewMaxHz Верхняя граница обзора, Гц.
+     *  \param[in] targetWidth Количество колонок.
+     *  \param[out] thresholds Буфер на targetWidth значений (-inf вне полос).
+     */
+    static void columnThresholds(const std::vector<ThresholdSegment> &profile, double viewMinHz,
+                                 double viewMaxHz, int targetWidth, float *thresholds);
+
+    /*! \brief Сводит колонки [firstColumn, lastColumn) к парам min/max, обрезанным порогами.
+     *
+     *  За один проход по колонкам минимум поднимается до порога колонки и
+     *  заполняется маска: колонка видима, если в ней есть данные и максимум
+     *  не ниже порога.
+     *
+     *  \param[in] frame Кадр спектра.
+     *  \param[in] viewMinHz Нижняя граница поддиапазона, Гц.
+     *  \param[in] viewMaxHz Верхняя граница поддиапазона, Гц.
+     *  \param[in] targetWidth Общее количество колонок.
+     *  \param[in] firstColumn Первая пересчитываемая колонка.
+     *  \param[in] lastColumn Колонка за последней пересчитываемой.
+     *  \param[in] thresholds Пороги колонок (targetWidth значений, см. columnThresholds()).
+     *  \param[out] out Буфер на 2 * targetWidth значений.
+     *  \param[out] visible Маска видимости на targetWidth значений.
+     *  \return Число видимых колонок в [firstColumn, lastColumn).
+     */
+    static int decimateMasked(const SpectrumFrame &frame, double viewMinHz, double viewMaxHz, int targetWidth,
+                              int firstColumn, int lastColumn, const float *thresholds, float *out,
+                              quint8 *visible);
 };
 
 #endif // SPECTRUMDECIMATOR_H
@@ -0,0 +1,191 @@
+/*!
+ *  \file spectrumengine.cpp
+ *  \brief Реализация SpectrumEngine.
+ */
+#include "spectrumengine.h"
+
+#include "minmaxkernel.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+//! \brief Максимальный размер одного чтения из источника, отсчеты.
+constexpr int kReadChunk = 1 << 16;
+
+} // namespace
+
+//! \brief Конструирует движок с синтетическим источником.
+SpectrumEngine::SpectrumEngine()
+    : m_source(std::make_shared<SyntheticIqSource>())
+{
+    m_assembler.setFramePool(&m_framePool);
+}
+
+/*!
+ *  \brief Публикует новые параметры БПФ.
+ *  \param[in] settings Параметры обработки.
+ */
+void SpectrumEngine::setSettings(const FFTProcessor::Settings &settings)
+{
+    m_settingsRequests.writeBuffer() = settings;
+    m_settingsRequests.publish();
+}
+
+/*!
+ *  \brief Публикует новый источник.
+ *  \param[in] source Источник I/Q.
+ */
+void SpectrumEngine::setSource(std::shared_ptr<IqSource> source)
+{
+    m_sourceRequests.writeBuffer() = std::move(source);
+    m_sourceRequests.publish();
+}
+
+/*!
+ *  \brief Публикует параметры обхода.
+ *  \param[in] settings Параметры обхода.
+ */
+void SpectrumEngine::setSweepSettings(const SweepSettings &settings)
+{
+    m_sweepRequests.writeBuffer() = settings;
+    m_sweepRequests.publish();
+}
+
+/*!
+ *  \brief Формирует кадр одной стоянкой или обходом панорамы.
+ *  \param[in] minHz Нижняя граница запрошенного диапазона, Гц.
+ *  \param[in] maxHz Верхняя граница запрошенного диапазона, Гц.
+ *  \param[in] cancelled Проверка отмены.
+ *  \return Кадр спектра.
+ */
+SpectrumFrame SpectrumEngine::produce(double minHz, double maxHz, const CancelCheck &cancelled)
+{
+    if (m_settingsRequests.consume()) {
+        m_fft.configure(m_settingsRequests.readBuffer());
+        m_tuned = false;
+    }
+    if (m_sourceRequests.consume() && m_sourceRequests.readBuffer()) {
+        m_source = m_sourceRequests.readBuffer();
+        m_tuned = false;
+    }
+    if (m_sweepRequests.consume()) {
+        m_sweepSettings = m_sweepRequests.readBuffer();
+        m_sweepSettings.dwellsPerFrame = qMax(1, m_sweepSettings.dwellsPerFrame);
+    }
+
+    // Готовые кадры источника (поток РПУ) выдаются без вычисления по отсчетам.
+    SpectrumFrame ready;
+    if (m_source->takeSpectrum(ready)) {
+        return ready;
+    }
+
+    if (m_source->isTunable() && m_sweepSettings.dwellSpanHz > 0.0
+        && m_sweepSettings.dwellSpanHz < maxHz - minHz) {
+        return produceSweep(minHz, maxHz, cancelled);
+    }
+
+    if (!acquire(minHz, maxHz, cancelled)) {
+        return SpectrumFrame();
+    }
+
+    const int binCount = static_cast<int>(m_segment.size());
+    SpectrumFrame frame = m_framePool.acquire(binCount);
+    std::copy(m_segment.cbegin(), m_segment.cend(), frame.bins());
+
+    const double halfSpanHz = 0.5 * m_source->sampleRateHz();
+    frame.setSpan(m_source->centerHz() - halfSpanHz, m_source->centerHz() + halfSpanHz);
+
+    // Нижняя граница шкалы не следует за провалами шума отдельных
+    // сегментов, иначе шкала дрожит от кадра к кадру.
+    float minDb = 0.0f;
+    float maxDb = 0.0f;
+    MinMaxKernel::reduce(MinMaxKernel::bestVariant(), frame.constBins(), binCount, minDb, maxDb);
+    frame.setDbRange(-120.0f, qMax(maxDb, -5.0f));
+    return frame;
+}
+
+/*!
+ *  \brief Перестраивает источник при необходимости и накапливает один выход БПФ.
+ *  \param[in] minHz Нижняя граница стоянки, Гц.
+ *  \param[in] maxHz Верхняя граница стоянки, Гц.
+ *  \param[in] cancelled Проверка отмены.
+ *  \return false, если источник не выдал данных или накопление отменено.
+ */
+bool SpectrumEngine::acquire(double minHz, double maxHz, const CancelCheck &cancelled)
+{
+    if (!m_tuned || m_tunedMinHz != minHz || m_tunedMaxHz != maxHz) {
+        m_source->tune(minHz, maxHz);
+        m_tuned = true;
+        m_tunedMinHz = minHz;
+        m_tunedMaxHz = maxHz;
+        // Накопленные сегменты относятся к прежнему источнику или настройке.
+        m_fft.reset();
+    }
+
+    while (!m_fft.hasOutput()) {
+        // Накопленные сегменты не теряются: при повторном запросе той же
+        // стоянки накопление продолжится.
+        if (cancelled && cancelled()) {
+            return false;
+        }
+        const int count = qMin(kReadChunk, m_fft.samplesUntilNextSegment());
+        m_iq.resize(count);
+        const int read = m_source->read(m_iq.data(), count);
+        if (read <= 0) {
+            return false;
+        }
+        m_fft.process(m_iq.data(), read);
+    }
+
+    m_segment.resize(m_fft.fftSize());
+    return m_fft.takeSpectrumDb(m_segment.data());
+}
+
+/*!
+ *  \brief Выполняет dwellsPerFrame очередных стоянок и возвращает панораму.
+ *  \param[in] minHz Нижняя граница панорамы, Гц.
+ *  \param[in] maxHz Верхняя граница панорамы, Гц.
+ *  \param[in] cancelled Проверка отмены.
+ *  \return Кадр панорамы.
+ */
+SpectrumFrame SpectrumEngine::produceSweep(double minHz, double maxHz, const CancelCheck &cancelled)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const double dwellSpanHz = m_sweepSettings.dwellSpanHz;
+    const double stepHz = dwellSpanHz * (1.0 - kDwellOverlap);
+    const int dwellCount = qMax(1, qCeil((maxHz - minHz - dwellSpanHz) / stepHz)) + 1;
+
+    // Разрешение панорамы равно разрешению стоянки, но не больше kMaxPanoramaBins значений.
+    const double resolutionHz = dwellSpanHz / m_fft.fftSize();
+    const int panoramaBins = static_cast<int>(qMin<double>(kMaxPanoramaBins, std::ceil((maxHz - minHz) / resolutionHz)));
+    if (m_assembler.minHz() != minHz || m_assembler.maxHz() != maxHz || m_assembler.binCount() != panoramaBins) {
+        m_assembler.configure(minHz, maxHz, panoramaBins, kDwellOverlap);
+        m_nextDwell = 0;
+    }
+
+    for (int i = 0; i < m_sweepSettings.dwellsPerFrame; ++i) {
+        m_nextDwell %= dwellCount;
+        const double dwellMinHz = qMin(minHz + m_nextDwell * stepHz, maxHz - dwellSpanHz);
+        if (!acquire(dwellMinHz, dwellMinHz + dwellSpanHz, cancelled)) {
+            return SpectrumFrame();
+        }
+
+        const double halfSpanHz = 0.5 * m_source->sampleRateHz();
+        const qint64 nowUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 Clock::now().time_since_epoch()).count();
+        m_assembler.addSegment(m_source->centerHz() - halfSpanHz, m_source->centerHz() + halfSpanHz,
+                               m_segment.data(), static_cast<int>(m_segment.size()), nowUs);
+        ++m_nextDwell;
+    }
+
+    m_sweepDurationUs.store(m_assembler.sweepDurationUs(), std::memory_order_relaxed);
+    m_revisitIntervalUs.store(m_assembler.revisitIntervalUs(), std::memory_order_relaxed);
+    m_completedSweeps.store(m_assembler.completedSweeps(), std::memory_order_relaxed);
+    return m_assembler.takeFrame();
+}
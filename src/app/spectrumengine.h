@@ -0,0 +1,147 @@
+/*!
+ *  \file spectrumengine.h
+ *  \brief Формирование кадров спектра из отсчетов I/Q.
+ */
+#ifndef SPECTRUMENGINE_H
+#define SPECTRUMENGINE_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "fftprocessor.h"
+#include "iqsource.h"
+#include "latestvalueslot.h"
+#include "spectrumframe.h"
+#include "spectrumframepool.h"
+#include "sweepassembler.h"
+
+/*!
+ *  \class SpectrumEngine
+ *  \brief Связывает источник I/Q и FFTProcessor и выдает кадры спектра.
+ *
+ *  Если источник перестраивается, а стоянка уже запрошенного диапазона,
+ *  диапазон обходится стоянками с перекрытием, и кадр собирается
+ *  SweepAssembler: каждый кадр содержит dwellsPerFrame новых стоянок, а
+ *  пирамида обновляется только на измененных участках.
+ *
+ *  Параметры БПФ, обхода и смена источника публикуются из любого потока через
+ *  LatestValueSlot и применяются потоком DSP перед очередным кадром.
+ */
+class SpectrumEngine
+{
+public:
+    //! \brief Параметры обхода панорамы.
+    struct SweepSettings
+    {
+        //! \brief Полоса одной стоянки, Гц (0 — весь диапазон за одну стоянку).
+        double dwellSpanHz = 1e9;
+        //! \brief Число стоянок на один кадр.
+        int dwellsPerFrame = 2;
+    };
+
+    //! \brief Доля полосы стоянки, перекрывающаяся с соседней.
+    static constexpr double kDwellOverlap = 0.1;
+    //! \brief Максимальное число значений собранной панорамы.
+    static constexpr int kMaxPanoramaBins = 1 << 19;
+
+    //! \brief Проверка отмены формирования кадра (вызывается между порциями отсчетов и стоянками).
+    using CancelCheck = std::function<bool()>;
+
+    //! \brief Конструирует движок с синтетическим источником.
+    SpectrumEngine();
+
+    /*!
+     *  \brief Публикует новые параметры БПФ (один поток-писатель, обычно UI).
+     *  \param[in] settings Параметры обработки.
+     */
+    void setSettings(const FFTProcessor::Settings &settings);
+    /*!
+     *  \brief Публикует новый источник (тот же поток-писатель, что и для параметров).
+     *  \param[in] source Источник I/Q.
+     */
+    void setSource(std::shared_ptr<IqSource> source);
+    /*!
+     *  \brief Публикует параметры обхода (тот же поток-писатель).
+     *  \param[in] settings Параметры обхода.
+     */
+    void setSweepSettings(const SweepSettings &settings);
+
+    //! \brief Возвращает длительность последнего обхода панорамы, мкс (0 — обхода не было).
+    qint64 sweepDurationUs() const noexcept { return m_sweepDurationUs.load(std::memory_order_relaxed); }
+    //! \brief Возвращает интервал повторного посещения панорамы, мкс.
+    qint64 revisitIntervalUs() const noexcept { return m_revisitIntervalUs.load(std::memory_order_relaxed); }
+    //! \brief Возвращает число завершенных обходов.
+    quint64 completedSweeps() const noexcept { return m_completedSweeps.load(std::memory_order_relaxed); }
+    //! \brief Возвращает число кадров, созданных в куче из-за исчерпания пула буферов.
+    quint64 framePoolExhaustedCount() const noexcept { return m_framePool.exhaustedCount(); }
+
+    /*!
+     *  \brief Формирует кадр (поток DSP).
+     *  \param[in] minHz Нижняя граница запрошенного диапазона, Гц.
+     *  \param[in] maxHz Верхняя граница запрошенного диапазона, Гц.
+     *  \param[in] cancelled Проверка отмены; пустая — кадр не отменяется.
+     *  \return Кадр спектра; пустой, если источник не выдал данных или формирование отменено.
+     */
+    SpectrumFrame produce(double minHz, double maxHz, const CancelCheck &cancelled = CancelCheck());
+
+private:
+    /*!
+     *  \brief Перестраивает источник, накапливает один выход БПФ и выдает его в m_segment.
+     *  \param[in] minHz Нижняя граница стоянки, Гц.
+     *  \param[in] maxHz Верхняя граница стоянки, Гц.
+     *  \param[in] cancelled Проверка отмены.
+     *  \return false, если источник не выдал данных или накопление отменено.
+     */
+    bool acquire(double minHz, double maxHz, const CancelCheck &cancelled);
+    /*!
+     *  \brief Выполняет очередные стоянки обхода и возвращает собранную панораму.
+     *  \param[in] minHz Нижняя граница панорамы, Гц.
+     *  \param[in] maxHz Верхняя граница панорамы, Гц.
+     *  \param[in] cancelled Проверка отмены.
+     *  \return Кадр панорамы; пустой, если источник не выдал данных или обход отменен.
+     */
+    SpectrumFrame produceSweep(double minHz, double maxHz, const CancelCheck &cancelled);
+
+    //! \brief Слот параметров БПФ.
+    LatestValueSlot<FFTProcessor::Settings> m_settingsRequests;
+    //! \brief Слот смены источника.
+    LatestValueSlot<std::shared_ptr<IqSource>> m_sourceRequests;
+    //! \brief Слот параметров обхода.
+    LatestValueSlot<SweepSettings> m_sweepRequests;
+
+    //! \brief Текущий источник (поток DSP).
+    std::shared_ptr<IqSource> m_source;
+    //! \brief Обработчик БПФ (поток DSP).
+    FFTProcessor m_fft;
+    //! \brief Буфер чтения отсчетов (поток DSP).
+    std::vector<std::complex<float>> m_iq;
+    //! \brief Спектр последней стоянки, дБ (поток DSP).
+    std::vector<float> m_segment;
+    //! \brief Параметры обхода (поток DSP).
+    SweepSettings m_sweepSettings;
+    //! \brief Пул буферов кадров (объявлен до сборщика, который берет из него буфер панорамы).
+    SpectrumFramePool m_framePool;
+    //! \brief Сборщик панорамы (поток DSP).
+    SweepAssembler m_assembler;
+    //! \brief Номер следующей стоянки обхода.
+    int m_nextDwell = 0;
+    //! \brief Длительность последнего обхода, мкс.
+    std::atomic<qint64> m_sweepDurationUs{0};
+    //! \brief Интервал повторного посещения, мкс.
+    std::atomic<qint64> m_revisitIntervalUs{0};
+    //! \brief Число завершенных обходов.
+    std::atomic<quint64> m_completedSweeps{0};
+    //! \brief Признак перестройки источника на текущий диапазон.
+    bool m_tuned = false;
+    //! \brief Нижняя граница диапазона настройки источника, Гц.
+    double m_tunedMinHz = 0.0;
+    //! \brief Верхняя граница диапазона настройки источника, Гц.
+    double m_tunedMaxHz = 0.0;
+};
+
+#endif // SPECTRUMENGINE_H
@@ -0,0 +1,279 @@
+/*!
+ *  \file spectrumframe.cpp
+ *  \brief Реализация SpectrumFrame.
+ */
+#include "spectrumframe.h"
+
+#include "spectrumframepool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+//! \brief Возвращает общее пустое содержимое; его ссылка никогда не освобождается.
+SpectrumFrameData *emptyData()
+{
+    static SpectrumFrameData *const empty = [] {
+        auto *data = new SpectrumFrameData;
+        data->ref.ref();
+        return data;
+    }();
+    return empty;
+}
+
+} // namespace
+
+//! \brief Копирует содержимое other; копия не принадлежит пулу.
+SpectrumFrameData::SpectrumFrameData(const SpectrumFrameData &other)
+    : QSharedData(other)
+{
+    assign(other);
+}
+
+//! \brief Копирует содержимое other в уже выделенную память.
+void SpectrumFrameData::assign(const SpectrumFrameData &other)
+{
+    bins.assign(other.bins.cbegin(), other.bins.cend());
+    viewMinHz = other.viewMinHz;
+    viewMaxHz = other.viewMaxHz;
+    minDb = other.minDb;
+    maxDb = other.maxDb;
+    pyramid = other.pyramid;
+    layoutId = other.layoutId;
+    blockRevisions = other.blockRevisions;
+}
+
+/*!
+ *  \brief Сбрасывает описание кадра и задает число значений, сохраняя память.
+ *  \param[in] binCount Количество значений.
+ */
+void SpectrumFrameData::reset(int binCount)
+{
+    bins.resize(static_cast<size_t>(qMax(0, binCount)));
+    viewMinHz = 0.0;
+    viewMaxHz = 0.0;
+    minDb = -120.0f;
+    maxDb = 0.0f;
+    pyramid.invalidate();
+    layoutId = 0;
+    blockRevisions.clear();
+}
+
+//! \brief Конструирует пустой кадр.
+SpectrumFrame::SpectrumFrame()
+    : d(emptyData())
+{
+}
+
+/*!
+ *  \brief Конструирует кадр и выделяет место под значения.
+ *  \param[in] binCount Количество значений спектра.
+ */
+SpectrumFrame::SpectrumFrame(int binCount)
+    : d(new SpectrumFrameData)
+{
+    d->bins.resize(static_cast<size_t>(qMax(0, binCount)));
+}
+
+/*!
+ *  \brief Конструирует кадр, принимая уже учтенную ссылку на данные.
+ *  \param[in] data Данные кадра.
+ */
+SpectrumFrame::SpectrumFrame(SpectrumFrameData *data, QAdoptSharedDataTag tag) noexcept
+    : d(data, tag)
+{
+}
+
+//! \brief Проверяет, разделены ли данные кадра с другими кадрами.
+bool SpectrumFrame::isShared() const noexcept
+{
+    // Буфер пула держит и сам пул: он не разделен, пока ссылок не больше двух.
+    const bool pooled = d->pool.load(std::memory_order_acquire) != nullptr;
+    return d->ref.loadAcquire() > (pooled ? 2 : 1);
+}
+
+//! \brief Возвращает данные для изменения, отделяя копию, если они разделены.
+SpectrumFrameData *SpectrumFrame::mutableData()
+{
+    if (isShared()) {
+        SpectrumFramePool *pool = d->pool.load(std::memory_order_acquire);
+        if (pool != nullptr) {
+            d = pool->acquireCopy(*this).d;
+        } else {
+            d = new SpectrumFrameData(*d);
+        }
+    }
+    return d.data();
+}
+
+/*!
+ *  \brief Задает диапазон частот кадра.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+void SpectrumFrame::setSpan(double minHz, double maxHz)
+{
+    SpectrumFrameData *data = mutableData();
+    data->viewMinHz = minHz;
+    data->viewMaxHz = maxHz;
+}
+
+/*!
+ *  \brief Задает границы шкалы отображения.
+ *  \param[in] minDb Нижняя граница, дБ.
+ *  \param[in] maxDb Верхняя граница, дБ.
+ */
+void SpectrumFrame::setDbRange(float minDb, float maxDb)
+{
+    SpectrumFrameData *data = mutableData();
+    data->minDb = minDb;
+    data->maxDb = maxDb;
+}
+
+//! \brief Строит пирамиду min/max по всем значениям кадра.
+void SpectrumFrame::rebuildPyramid()
+{
+    SpectrumFrameData *data = mutableData();
+    data->pyramid.build(data->bins.data(), binCount());
+}
+
+/*!
+ *  \brief Обновляет пирамиду после изменения части значений.
+ *  \param[in] firstBin Первое измененное значение.
+ *  \param[in] lastBin Значение за последним измененным.
+ */
+void SpectrumFrame::updatePyramid(int firstBin, int lastBin)
+{
+    if (d->pyramid.binCount() != binCount()) {
+        rebuildPyramid();
+        return;
+    }
+    SpectrumFrameData *data = mutableData();
+    data->pyramid.update(data->bins.data(), binCount(), firstBin, lastBin);
+}
+
+//! \brief Объявляет кадр версией буфера с заданным идентификатором.
+void SpectrumFrame::setLayoutId(quint64 layoutId)
+{
+    mutableData()->layoutId = layoutId;
+}
+
+//! \brief Выдает новый уникальный идентификатор буфера.
+quint64 SpectrumFrame::allocateLayoutId() noexcept
+{
+    static std::atomic<quint64> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*!
+ *  \brief Увеличивает ревизии блоков, затронутых изменением [firstBin, lastBin).
+ *  \param[in] firstBin Первое измененное значение.
+ *  \param[in] lastBin Значение за последним измененным.
+ */
+void SpectrumFrame::markChanged(int firstBin, int lastBin)
+{
+    const int count = binCount();
+    firstBin = qBound(0, firstBin, count);
+    lastBin = qBound(firstBin, lastBin, count);
+    if (firstBin == lastBin) {
+        return;
+    }
+
+    const size_t blocks = static_cast<size_t>((count + kRevisionBlockBins - 1) / kRevisionBlockBins);
+    SpectrumFrameData *data = mutableData();
+    if (data->blockRevisions.size() != blocks) {
+        data->blockRevisions.assign(blocks, 0);
+    }
+    quint32 *revisions = data->blockRevisions.data();
+    for (int b = firstBin / kRevisionBlockBins; b <= (lastBin - 1) / kRevisionBlockBins; ++b) {
+        ++revisions[b];
+    }
+}
+
+/*!
+ *  \brief Сравнивает ревизии блоков с предыдущей версией кадра.
+ *  \param[in] previous Предыдущая версия кадра.
+ *  \return Диапазоны измененных значений.
+ */
+QList<QPair<int, int>> SpectrumFrame::changedBinRanges(const SpectrumFrame &previous) const
+{
+    const int count = binCount();
+    if (count == 0) {
+        return {};
+    }
+
+    const bool sameBuffer = d->layoutId != 0 && previous.d->layoutId == d->layoutId
+        && previous.binCount() == count && previous.viewMinHz() == viewMinHz()
+        && previous.viewMaxHz() == viewMaxHz()
+        && previous.d->blockRevisions.size() == d->blockRevisions.size();
+    if (!sameBuffer) {
+        return {{0, count}};
+    }
+
+    QList<QPair<int, int>> ranges;
+    const size_t blocks = d->blockRevisions.size();
+    for (size_t b = 0; b < blocks; ++b) {
+        if (d->blockRevisions[b] == previous.d->blockRevisions[b]) {
+            continue;
+        }
+        const int first = static_cast<int>(b) * kRevisionBlockBins;
+        const int last = qMin(count, first + kRevisionBlockBins);
+        if (!ranges.isEmpty() && ranges.last().second == first) {
+            ranges.last().second = last;
+        } else {
+            ranges.append({first, last});
+        }
+    }
+    return ranges;
+}
+
+/*!
+ *  \brief Догоняет более новую версию того же буфера.
+ *  \param[in] source Новая версия буфера.
+ *  \param[in] ranges Участки, в которых кадр отстает от source.
+ */
+void SpectrumFrame::syncFrom(const SpectrumFrame &source, const QList<QPair<int, int>> &ranges)
+{
+    if (d.data() == source.d.data()) {
+        return;
+    }
+    SpectrumFrameData *data = mutableData();
+    const SpectrumFrameData &from = *source.d;
+    const int count = source.binCount();
+    if (binCount() != count || data->layoutId == 0 || data->layoutId != from.layoutId
+        || data->pyramid.binCount() != count || from.pyramid.binCount() != count) {
+        data->assign(from);
+        return;
+    }
+
+    for (const QPair<int, int> &range : ranges) {
+        const int first = qBound(0, range.first, count);
+        const int last = qBound(first, range.second, count);
+        if (first == last) {
+            continue;
+        }
+        std::copy(from.bins.cbegin() + first, from.bins.cbegin() + last, data->bins.begin() + first);
+        data->pyramid.update(data->bins.data(), count, first, last);
+    }
+    data->viewMinHz = from.viewMinHz;
+    data->viewMaxHz = from.viewMaxHz;
+    data->minDb = from.minDb;
+    data->maxDb = from.maxDb;
+    // Ревизии — по одной на блок, их копирование дешево.
+    data->blockRevisions = from.blockRevisions;
+}
+
+/*!
+ *  \brief Переводит частоту в дробную позицию в отсчетах кадра.
+ *  \param[in] hz Частота, Гц.
+ *  \return Позиция в отсчетах.
+ */
+double SpectrumFrame::binPosition(double hz) const noexcept
+{
+    const double spanHz = d->viewMaxHz - d->viewMinHz;
+    if (spanHz <= 0.0) {
+        return 0.0;
+    }
+    return (hz - d->viewMinHz) / spanHz * binCount();
+}
@@ -0,0 +1,255 @@
+/*!
+ *  \file spectrumframe.h
+ *  \brief Типизированный кадр спектра с неявным разделением данных.
+ */
+#ifndef SPECTRUMFRAME_H
+#define SPECTRUMFRAME_H
+
+#include <QExplicitlySharedDataPointer>
+#include <QList>
+#include <QMetaType>
+#include <QPair>
+#include <QSharedData>
+#include <QtQml/qqmlregistration.h>
+
+#include <atomic>
+#include <vector>
+
+#include "alignedallocator.h"
+#include "spectrumpyramid.h"
+
+class SpectrumFramePool;
+
+/*!
+ *  \class SpectrumFrameData
+ *  \brief Разделяемое содержимое кадра спектра.
+ *
+ *  Все массивы — стандартные контейнеры: копирование глубокое, а повторное
+ *  заполнение того же размера не выделяет память, поэтому буфер пула
+ *  переиспользуется без обращений к куче.
+ */
+class SpectrumFrameData : public QSharedData
+{
+public:
+    //! \brief Конструирует пустое содержимое.
+    SpectrumFrameData() = default;
+    //! \brief Копирует содержимое other; копия не принадлежит пулу.
+    SpectrumFrameData(const SpectrumFrameData &other);
+    SpectrumFrameData &operator=(const SpectrumFrameData &) = delete;
+
+    //! \brief Копирует содержимое other в уже выделенную память (кроме принадлежности пулу).
+    void assign(const SpectrumFrameData &other);
+    /*!
+     *  \brief Сбрасывает описание кадра и задает число значений, сохраняя память.
+     *  \param[in] binCount Количество значений (сами значения не инициализируются).
+     */
+    void reset(int binCount);
+
+    //! \brief Значения спектра в дБ, расположенные непрерывно и выровненные по строке кэша.
+    std::vector<float, AlignedAllocator<float>> bins;
+    //! \brief Нижняя граница диапазона кадра, Гц.
+    double viewMinHz = 0.0;
+    //! \brief Верхняя граница диапазона кадра, Гц.
+    double viewMaxHz = 0.0;
+    //! \brief Нижняя граница шкалы отображения, дБ.
+    float minDb = -120.0f;
+    //! \brief Верхняя граница шкалы отображения, дБ.
+    float maxDb = 0.0f;
+    //! \brief Пирамида min/max над значениями кадра.
+    SpectrumPyramid pyramid;
+    //! \brief Идентификатор буфера, версиями которого являются кадры (0 — независимый кадр).
+    quint64 layoutId = 0;
+    //! \brief Ревизии блоков по SpectrumFrame::kRevisionBlockBins значений.
+    std::vector<quint32> blockRevisions;
+    //! \brief Пул, которому принадлежит буфер и который держит на него ссылку (nullptr — буфер в куче).
+    std::atomic<SpectrumFramePool *> pool{nullptr};
+};
+
+/*!
+ *  \class SpectrumFrame
+ *  \brief Кадр спектра: значения в дБ, диапазон, метка времени и номер.
+ *
+ *  Копирование кадра увеличивает только счетчик ссылок, поэтому кадр
+ *  передается через сигналы и в QML без поэлементных преобразований.
+ *  Изменение разделенного кадра отделяет копию: для буфера пула — в
+ *  свободный буфер того же пула (SpectrumFramePool), иначе — в куче.
+ *  Пустой кадр ссылается на общее пустое содержимое и память не выделяет.
+ *
+ *  Время, номер кадра, метки PipelineProfiler и поколение запроса обзора
+ *  хранятся в самом объекте кадра, а не в разделяемых данных: их установка
+ *  не отделяет копию значений, даже если кадр уже разделен с записью,
+ *  детектором или сборщиком панорамы.
+ */
+class SpectrumFrame
+{
+    Q_GADGET
+    QML_VALUE_TYPE(spectrumFrame)
+    Q_PROPERTY(double viewMinHz READ viewMinHz CONSTANT FINAL)
+    Q_PROPERTY(double viewMaxHz READ viewMaxHz CONSTANT FINAL)
+    Q_PROPERTY(float minDb READ minDb CONSTANT FINAL)
+    Q_PROPERTY(float maxDb READ maxDb CONSTANT FINAL)
+    Q_PROPERTY(qint64 timestampUs READ timestampUs CONSTANT FINAL)
+    Q_PROPERTY(quint64 sequence READ sequence CONSTANT FINAL)
+    Q_PROPERTY(int binCount READ binCount CONSTANT FINAL)
+    Q_PROPERTY(bool valid READ isValid CONSTANT FINAL)
+
+public:
+    //! \brief Число значений в блоке, для которого ведется ревизия изменений.
+    static constexpr int kRevisionBlockBins = 4096;
+
+    //! \brief Конструирует пустой кадр.
+    SpectrumFrame();
+    /*!
+     *  \brief Конструирует кадр с заданным числом значений.
+     *  \param[in] binCount Количество значений спектра.
+     */
+    explicit SpectrumFrame(int binCount);
+
+    //! \brief Возвращает нижнюю границу диапазона кадра, Гц.
+    double viewMinHz() const noexcept { return d->viewMinHz; }
+    //! \brief Возвращает верхнюю границу диапазона кадра, Гц.
+    double viewMaxHz() const noexcept { return d->viewMaxHz; }
+    //! \brief Возвращает нижнюю границу шкалы, дБ.
+    float minDb() const noexcept { return d->minDb; }
+    //! \brief Возвращает верхнюю границу шкалы, дБ.
+    float maxDb() const noexcept { return d->maxDb; }
+    //! \brief Возвращает время формирования кадра, мкс от начала эпохи.
+    qint64 timestampUs() const noexcept { return m_timestampUs; }
+    //! \brief Возвращает порядковый номер кадра.
+    quint64 sequence() const noexcept { return m_sequence; }
+    //! \brief Возвращает количество значений спектра.
+    int binCount() const noexcept { return static_cast<int>(d->bins.size()); }
+    //! \brief Проверяет, содержит ли кадр данные.
+    bool isValid() const noexcept { return !d->bins.empty(); }
+
+    //! \brief Возвращает указатель на значения только для чтения (без копирования).
+    const float *constBins() const noexcept { return d->bins.data(); }
+    //! \brief Возвращает изменяемый указатель на значения (отделяет копию при разделении).
+    float *bins() { return mutableData()->bins.data(); }
+    //! \brief Проверяет, принадлежит ли буфер кадра пулу.
+    bool isPooled() const noexcept { return d->pool.load(std::memory_order_relaxed) != nullptr; }
+    //! \brief Проверяет, разделены ли данные кадра с другими кадрами (запись отделит копию).
+    bool isShared() const noexcept;
+
+    //! \brief Возвращает пирамиду min/max (пустую, если она не построена).
+    const SpectrumPyramid &pyramid() const noexcept { return d->pyramid; }
+    //! \brief Строит пирамиду min/max по всем значениям кадра.
+    void rebuildPyramid();
+    /*!
+     *  \brief Обновляет пирамиду после изменения значений [firstBin, lastBin).
+     *  \param[in] firstBin Первое измененное значение.
+     *  \param[in] lastBin Значение за последним измененным.
+     */
+    void updatePyramid(int firstBin, int lastBin);
+
+    //! \brief Возвращает идентификатор буфера, версией которого является кадр (0 — независимый кадр).
+    quint64 layoutId() const noexcept { return d->layoutId; }
+    /*!
+     *  \brief Объявляет кадр версией буфера с заданным идентификатором.
+     *  \param[in] layoutId Уникальный ненулевой идентификатор (см. allocateLayoutId()).
+     */
+    void setLayoutId(quint64 layoutId);
+    //! \brief Выдает новый уникальный идентификатор буфера.
+    static quint64 allocateLayoutId() noexcept;
+
+    /*!
+     *  \brief Отмечает значения [firstBin, lastBin) как измененные (увеличивает ревизии блоков).
+     *  \param[in] firstBin Первое измененное значение.
+     *  \param[in] lastBin Значение за последним измененным.
+     */
+    void markChanged(int firstBin, int lastBin);
+    /*!
+     *  \brief Возвращает участки, изменившиеся относительно предыдущей версии того же буфера.
+     *
+     *  Если кадры не являются версиями одного буфера (другой идентификатор,
+     *  число значений или диапазон), изменившимся считается весь кадр.
+     *
+     *  \param[in] previous Предыдущая версия кадра.
+     *  \return Упорядоченные непересекающиеся диапазоны значений [first, last).
+     */
+    QList<QPair<int, int>> changedBinRanges(const SpectrumFrame &previous) const;
+    /*!
+     *  \brief Догоняет более новую версию того же буфера, копируя только отставшие участки.
+     *
+     *  Значения и пирамида переносятся для ranges, описание кадра и ревизии —
+     *  целиком. Если кадры не являются версиями одного буфера или пирамида
+     *  не построена, копируется все содержимое. Время, номер кадра и метки
+     *  конвейера не переносятся.
+     *
+     *  \param[in] source Новая версия буфера.
+     *  \param[in] ranges Участки [first, last), в которых кадр отстает от source.
+     */
+    void syncFrom(const SpectrumFrame &source, const QList<QPair<int, int>> &ranges);
+
+    /*!
+     *  \brief Переводит частоту в дробную позицию в отсчетах кадра.
+     *  \param[in] hz Частота, Гц.
+     *  \return Позиция, где 0 — начало первого отсчета, binCount() — конец последнего.
+     */
+    double binPosition(double hz) const noexcept;
+
+    /*!
+     *  \brief Задает диапазон частот кадра.
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     */
+    void setSpan(double minHz, double maxHz);
+    /*!
+     *  \brief Задает границы шкалы отображения.
+     *  \param[in] minDb Нижняя граница, дБ.
+     *  \param[in] maxDb Верхняя граница, дБ.
+     */
+    void setDbRange(float minDb, float maxDb);
+    //! \brief Задает время формирования кадра, мкс от начала эпохи.
+    void setTimestampUs(qint64 timestampUs) noexcept { m_timestampUs = timestampUs; }
+    //! \brief Задает порядковый номер кадра.
+    void setSequence(quint64 sequence) noexcept { m_sequence = sequence; }
+
+    //! \brief Возвращает момент начала формирования кадра, нс PipelineProfiler::nowNs() (0 — без меток).
+    qint64 acquiredNs() const noexcept { return m_acquiredNs; }
+    //! \brief Возвращает момент публикации кадра для потока UI, нс (0 — без меток).
+    qint64 publishedNs() const noexcept { return m_publishedNs; }
+    /*!
+     *  \brief Задает метки прохождения конвейера.
+     *  \param[in] acquiredNs Начало формирования кадра, нс.
+     *  \param[in] publishedNs Публикация кадра для потока UI, нс.
+     */
+    void setPipelineStamps(qint64 acquiredNs, qint64 publishedNs) noexcept
+    {
+        m_acquiredNs = acquiredNs;
+        m_publishedNs = publishedNs;
+    }
+
+    //! \brief Возвращает поколение запроса обзора, для которого сформирован кадр (0 — без запроса).
+    quint64 viewportGeneration() const noexcept { return m_viewportGeneration; }
+    //! \brief Задает поколение запроса обзора.
+    void setViewportGeneration(quint64 generation) noexcept { m_viewportGeneration = generation; }
+
+private:
+    friend class SpectrumFramePool;
+
+    /*!
+     *  \brief Конструирует кадр, принимая уже учтенную ссылку на данные.
+     *  \param[in] data Данные кадра.
+     */
+    SpectrumFrame(SpectrumFrameData *data, QAdoptSharedDataTag) noexcept;
+    //! \brief Возвращает данные для изменения, отделяя копию, если они разделены.
+    SpectrumFrameData *mutableData();
+
+    //! \brief Разделяемые данные кадра.
+    QExplicitlySharedDataPointer<SpectrumFrameData> d;
+    //! \brief Время формирования кадра, мкс от начала эпохи.
+    qint64 m_timestampUs = 0;
+    //! \brief Порядковый номер кадра.
+    quint64 m_sequence = 0;
+    //! \brief Начало формирования кадра, нс.
+    qint64 m_acquiredNs = 0;
+    //! \brief Публикация кадра для потока UI, нс.
+    qint64 m_publishedNs = 0;
+    //! \brief Поколение запроса обзора.
+    quint64 m_viewportGeneration = 0;
+};
+
+Q_DECLARE_METATYPE(SpectrumFrame)
+
+#endif // SPECTRUMFRAME_H
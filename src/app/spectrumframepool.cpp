@@ -0,0 +1,98 @@
+/*!
+ *  \file spectrumframepool.cpp
+ *  \brief Реализация SpectrumFramePool.
+ */
+#include "spectrumframepool.h"
+
+/*!
+ *  \brief Создает буферы пула.
+ *  \param[in] bufferCount Количество буферов.
+ *  \param[in] binCapacity Число значений, под которое память выделяется сразу.
+ */
+SpectrumFramePool::SpectrumFramePool(int bufferCount, int binCapacity)
+{
+    m_buffers.reserve(static_cast<size_t>(qMax(1, bufferCount)));
+    for (int i = 0; i < qMax(1, bufferCount); ++i) {
+        auto *data = new SpectrumFrameData;
+        data->ref.ref();
+        data->pool.store(this, std::memory_order_relaxed);
+        data->bins.reserve(static_cast<size_t>(qMax(0, binCapacity)));
+        m_buffers.push_back(data);
+    }
+}
+
+//! \brief Отпускает буферы; буферы, занятые кадрами, освобождают сами кадры.
+SpectrumFramePool::~SpectrumFramePool()
+{
+    for (SpectrumFrameData *data : m_buffers) {
+        // Кадры, еще держащие буфер, дальше ведут себя как кадры в куче.
+        data->pool.store(nullptr, std::memory_order_release);
+        if (!data->ref.deref()) {
+            delete data;
+        }
+    }
+}
+
+/*!
+ *  \brief Выдает кадр с заданным числом значений.
+ *  \param[in] binCount Количество значений.
+ *  \return Кадр в буфере пула или в куче.
+ */
+SpectrumFrame SpectrumFramePool::acquire(int binCount)
+{
+    SpectrumFrameData *data = claim();
+    if (data == nullptr) {
+        return SpectrumFrame(binCount);
+    }
+    data->reset(binCount);
+    return SpectrumFrame(data, QAdoptSharedDataTag());
+}
+
+/*!
+ *  \brief Выдает копию кадра в отдельном буфере.
+ *  \param[in] source Исходный кадр.
+ *  \return Копия в буфере пула или в куче.
+ */
+SpectrumFrame SpectrumFramePool::acquireCopy(const SpectrumFrame &source)
+{
+    // Метки конвейера и поколение относятся к объекту кадра и копируются с ним.
+    SpectrumFrame frame(source);
+    SpectrumFrameData *data = claim();
+    if (data == nullptr) {
+        frame.d = new SpectrumFrameData(*source.d);
+        return frame;
+    }
+    data->assign(*source.d);
+    frame.d = QExplicitlySharedDataPointer<SpectrumFrameData>(data, QAdoptSharedDataTag());
+    return frame;
+}
+
+//! \brief Возвращает количество свободных буферов.
+int SpectrumFramePool::availableCount() const noexcept
+{
+    int available = 0;
+    for (const SpectrumFrameData *data : m_buffers) {
+        if (data->ref.loadRelaxed() == 1) {
+            ++available;
+        }
+    }
+    return available;
+}
+
+//! \brief Захватывает свободный буфер.
+SpectrumFrameData *SpectrumFramePool::claim() noexcept
+{
+    // Поиск начинается со следующего буфера по кругу: параллельные выдачи
+    // реже проверяют одни и те же буферы.
+    const size_t count = m_buffers.size();
+    const size_t start = m_next.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        SpectrumFrameData *data = m_buffers[(start + i) % count];
+        // Свободный буфер держит только пул; захват добавляет ссылку кадра.
+        if (data->ref.testAndSetAcquire(1, 2)) {
+            return data;
+        }
+    }
+    m_exhausted.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
@@ -0,0 +1,98 @@
+/*!
+ *  \file spectrumframepool.h
+ *  \brief Пул заранее созданных буферов кадров спектра.
+ */
+#ifndef SPECTRUMFRAMEPOOL_H
+#define SPECTRUMFRAMEPOOL_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "spectrumframe.h"
+
+/*!
+ *  \class SpectrumFramePool
+ *  \brief Выдает кадры в буферах фиксированного набора вместо новых выделений памяти.
+ *
+ *  Пул держит по одной ссылке на каждый буфер. Буфер свободен, когда эту
+ *  ссылку держит только пул; выдача атомарно захватывает свободный буфер
+ *  (счетчик ссылок 1 -> 2), а кадр, отпущенный последним потребителем,
+ *  возвращает буфер в пул без освобождения памяти. Память значений
+ *  сохраняется между выдачами и растет только до наибольшего
+ *  запрошенного кадра, поэтому в установившемся режиме кадры не выделяют
+ *  память. Если свободных буферов нет, кадр создается в куче и
+ *  учитывается в exhaustedCount().
+ *
+ *  Пул по умолчанию покрывает все кадры, которые одновременно держат
+ *  очереди и потребители конвейера (kDefaultBufferCount), поэтому отставшая
+ *  запись не исчерпывает его; память буфера занимается только при первой
+ *  выдаче.
+ *
+ *  Выдача потокобезопасна. Пул должен жить, пока в его буферы пишут;
+ *  кадры, переживающие пул, остаются действительными как кадры в куче.
+ */
+class SpectrumFramePool
+{
+public:
+    //! \brief Наибольшая суммарная глубина очередей потребителей кадров (запись и история водопада).
+    static constexpr int kQueuedFrameCount = 136;
+    /*!
+     *  \brief Кадры, которые потребители держат вне очередей.
+     *
+     *  Тройной буфер слота доставки (3), последний и панорамный кадры
+     *  контроллера (2), кадр графика (1), последний кадр трасс (1), кадры в
+     *  работе у потоков записи и истории (2), кадр сборщика панорамы с его
+     *  прежними версиями (5) и копии в QML (2).
+     */
+    static constexpr int kHeldFrameCount = 16;
+    //! \brief Количество буферов по умолчанию: очереди и держатели конвейера кадров.
+    static constexpr int kDefaultBufferCount = kQueuedFrameCount + kHeldFrameCount;
+
+    /*!
+     *  \brief Создает буферы пула.
+     *  \param[in] bufferCount Количество буферов.
+     *  \param[in] binCapacity Число значений, под которое память выделяется сразу.
+     */
+    explicit SpectrumFramePool(int bufferCount = kDefaultBufferCount, int binCapacity = 0);
+    //! \brief Отпускает буферы; буферы, занятые кадрами, освобождают сами кадры.
+    ~SpectrumFramePool();
+
+    SpectrumFramePool(const SpectrumFramePool &) = delete;
+    SpectrumFramePool &operator=(const SpectrumFramePool &) = delete;
+
+    /*!
+     *  \brief Выдает кадр с заданным числом значений.
+     *  \param[in] binCount Количество значений (значения не инициализируются).
+     *  \return Кадр в буфере пула или, если пул исчерпан, в куче.
+     */
+    SpectrumFrame acquire(int binCount);
+    /*!
+     *  \brief Выдает копию кадра в отдельном буфере.
+     *  \param[in] source Исходный кадр.
+     *  \return Копия в буфере пула или, если пул исчерпан, в куче.
+     */
+    SpectrumFrame acquireCopy(const SpectrumFrame &source);
+
+    //! \brief Возвращает количество буферов.
+    int bufferCount() const noexcept { return static_cast<int>(m_buffers.size()); }
+    //! \brief Возвращает количество свободных буферов (мгновенный снимок).
+    int availableCount() const noexcept;
+    //! \brief Возвращает число выдач, не нашедших свободного буфера.
+    quint64 exhaustedCount() const noexcept { return m_exhausted.load(std::memory_order_relaxed); }
+
+private:
+    //! \brief Захватывает свободный буфер или возвращает nullptr, если пул исчерпан.
+    SpectrumFrameData *claim() noexcept;
+
+    //! \brief Буферы; на каждый пул держит одну ссылку.
+    std::vector<SpectrumFrameData *> m_buffers;
+    //! \brief Буфер, с которого начинается поиск свободного.
+    std::atomic<std::size_t> m_next{0};
+    //! \brief Число выдач, не нашедших свободного буфера.
+    std::atomic<quint64> m_exhausted{0};
+};
+
+#endif // SPECTRUMFRAMEPOOL_H
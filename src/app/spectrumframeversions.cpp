@@ -0,0 +1,79 @@
+/*!
+ *  \file spectrumframeversions.cpp
+ *  \brief Реализация SpectrumFrameVersions.
+ */
+#include "spectrumframeversions.h"
+
+#include <algorithm>
+#include <utility>
+
+/*!
+ *  \brief Делает кадр доступным для записи, не изменяя выданные копии.
+ *  \param[in,out] frame Кадр владельца.
+ */
+void SpectrumFrameVersions::prepareWrite(SpectrumFrame &frame)
+{
+    if (!frame.isShared()) {
+        return;
+    }
+
+    // Кадр выдан: пишем в прежнюю версию, которую уже отпустили.
+    for (Version &version : m_versions) {
+        if (!version.frame.isShared()) {
+            for (const QPair<int, int> &range : std::as_const(m_dirty)) {
+                mergeRange(version.stale, range.first, range.second);
+            }
+            version.frame.syncFrom(frame, version.stale);
+            version.stale.clear();
+            std::swap(version.frame, frame);
+            return;
+        }
+    }
+
+    // Свободной версии нет: выданный кадр становится версией, а запись
+    // отделяет полную копию (из пула, если буфер ему принадлежит).
+    if (static_cast<int>(m_versions.size()) < kMaxVersions) {
+        m_versions.push_back({frame, {}});
+    }
+    frame.bins();
+}
+
+//! \brief Отмечает выдачу кадра.
+void SpectrumFrameVersions::markPublished()
+{
+    for (Version &version : m_versions) {
+        for (const QPair<int, int> &range : std::as_const(m_dirty)) {
+            mergeRange(version.stale, range.first, range.second);
+        }
+    }
+    m_dirty.clear();
+}
+
+//! \brief Забывает прежние версии и записанные участки.
+void SpectrumFrameVersions::clear()
+{
+    m_versions.clear();
+    m_dirty.clear();
+}
+
+/*!
+ *  \brief Добавляет диапазон в список, объединяя пересекающиеся и смежные.
+ *  \param[in,out] ranges Упорядоченные непересекающиеся диапазоны.
+ *  \param[in] first Первое значение.
+ *  \param[in] last Значение за последним.
+ */
+void SpectrumFrameVersions::mergeRange(QList<QPair<int, int>> &ranges, int first, int last)
+{
+    if (first >= last) {
+        return;
+    }
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), first,
+                               [](const QPair<int, int> &range, int value) { return range.second < value; });
+    // it — первый диапазон, который заканчивается не раньше first.
+    while (it != ranges.end() && it->first <= last) {
+        first = qMin(first, it->first);
+        last = qMax(last, it->second);
+        it = ranges.erase(it);
+    }
+    ranges.insert(it, {first, last});
+}
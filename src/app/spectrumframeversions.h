@@ -0,0 +1,76 @@
+/*!
+ *  \file spectrumframeversions.h
+ *  \brief Прежние версии изменяемого кадра для записи без копирования выданных кадров.
+ */
+#ifndef SPECTRUMFRAMEVERSIONS_H
+#define SPECTRUMFRAMEVERSIONS_H
+
+#include <QList>
+#include <QPair>
+
+#include <vector>
+
+#include "spectrumframe.h"
+
+/*!
+ *  \class SpectrumFrameVersions
+ *  \brief Держит прежние версии кадра, который владелец пишет на месте и выдает потребителям.
+ *
+ *  Выданный кадр больше не изменяется: перед первой записью после выдачи
+ *  prepareWrite() подменяет кадр владельца прежней версией, которую уже
+ *  отпустили все потребители, а версия догоняет текущую копированием только
+ *  участков, записанных после ее выдачи. Полная копия делается, лишь пока
+ *  версий меньше kMaxVersions или все они еще заняты.
+ *
+ *  Версии должны быть одним буфером (SpectrumFrame::setLayoutId()) с
+ *  построенной пирамидой, иначе догоняющая копия будет полной.
+ */
+class SpectrumFrameVersions
+{
+public:
+    //! \brief Наибольшее число прежних версий.
+    static constexpr int kMaxVersions = 4;
+
+    /*!
+     *  \brief Делает кадр доступным для записи, не изменяя выданные копии.
+     *  \param[in,out] frame Кадр владельца.
+     */
+    void prepareWrite(SpectrumFrame &frame);
+    /*!
+     *  \brief Отмечает участок кадра, записанный после последней выдачи.
+     *  \param[in] first Первое значение.
+     *  \param[in] last Значение за последним.
+     */
+    void markDirty(int first, int last) { mergeRange(m_dirty, first, last); }
+    //! \brief Возвращает участки [first, last), записанные после последней выдачи.
+    const QList<QPair<int, int>> &dirtyRanges() const noexcept { return m_dirty; }
+    //! \brief Отмечает выдачу кадра: записанные участки становятся отставанием прежних версий.
+    void markPublished();
+    //! \brief Забывает прежние версии и записанные участки (кадр заменен другим буфером).
+    void clear();
+
+    /*!
+     *  \brief Добавляет диапазон в список, объединяя пересекающиеся и смежные.
+     *  \param[in,out] ranges Упорядоченные непересекающиеся диапазоны.
+     *  \param[in] first Первое значение.
+     *  \param[in] last Значение за последним.
+     */
+    static void mergeRange(QList<QPair<int, int>> &ranges, int first, int last);
+
+private:
+    //! \brief Прежняя версия кадра.
+    struct Version
+    {
+        //! \brief Кадр версии.
+        SpectrumFrame frame;
+        //! \brief Участки, записанные после выдачи версии.
+        QList<QPair<int, int>> stale;
+    };
+
+    //! \brief Прежние версии.
+    std::vector<Version> m_versions;
+    //! \brief Участки, записанные после последней выдачи.
+    QList<QPair<int, int>> m_dirty;
+};
+
+#endif // SPECTRUMFRAMEVERSIONS_H
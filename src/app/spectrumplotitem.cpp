@@ -0,0 +1,554 @@
+/*!
+ *  \file spectrumplotitem.cpp
+ *  \brief Реализация SpectrumPlotItem.
+ */
+#include "spectrumplotitem.h"
+
+#include "pipelineprofiler.h"
+
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGGeometryNode>
+#include <QVariantMap>
+#include <QtMath>
+
+#include <algorithm>
+
+namespace {
+
+//! \brief Цвета трасс обработки в порядке TraceProcessor::Mode.
+const char *const kProcessedTraceColors[TraceProcessor::kModeCount] = {"#f2c14e", "#ff6b6b", "#5cd6a9", "#c77dff"};
+
+/*!
+ *  \brief Создает узел линий с плоским цветом.
+ *  \param[in] color Цвет линий.
+ *  \return Новый узел, владеющий геометрией и материалом.
+ */
+QSGGeometryNode *createLineNode(const QColor &color)
+{
+    auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+    geometry->setDrawingMode(QSGGeometry::DrawLines);
+    geometry->setLineWidth(1.0f);
+
+    auto *material = new QSGFlatColorMaterial;
+    material->setColor(color);
+
+    auto *node = new QSGGeometryNode;
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setMaterial(material);
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+/*!
+ *  \brief Обновляет цвет материала узла.
+ *  \param[in] node Узел линий.
+ *  \param[in] color Новый цвет.
+ */
+void updateNodeColor(QSGGeometryNode *node, const QColor &color)
+{
+    auto *material = static_cast<QSGFlatColorMaterial *>(node->material());
+    if (material->color() != color) {
+        material->setColor(color);
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+}
+
+} // namespace
+
+//! \brief Конструирует элемент отрисовки.
+SpectrumPlotItem::SpectrumPlotItem(QQuickItem *parent)
+    : QQuickItem(parent)
+{
+    setFlag(ItemHasContents, true);
+}
+
+/*!
+ *  \brief Задает новый кадр спектра и пересчитывает пары min/max.
+ *
+ *  Если кадр — новая версия того же буфера панорамы, пересчитываются только
+ *  колонки, покрывающие изменившиеся участки.
+ *
+ *  \param[in] frame Кадр спектра.
+ */
+void SpectrumPlotItem::setFrame(const SpectrumFrame &frame)
+{
+    const bool profiling = PipelineProfiler::isActive() && frame.acquiredNs() != 0;
+    const qint64 decimateStartNs = profiling ? PipelineProfiler::nowNs() : 0;
+
+    const QList<QPair<int, int>> changed = frame.changedBinRanges(m_frame);
+    const bool partial = !m_minMax.empty()
+        && !(changed.size() == 1 && changed.first() == qMakePair(0, frame.binCount()));
+    m_frame = frame;
+    if (partial) {
+        decimateChanged(changed);
+    } else {
+        decimate();
+    }
+
+    if (profiling) {
+        PipelineProfiler &profiler = PipelineProfiler::instance();
+        profiler.record(PipelineProfiler::Stage::Decimate, decimateStartNs, PipelineProfiler::nowNs(),
+                        frame.sequence());
+        // Предыдущий кадр так и не попал в scene graph — он заменен этим.
+        if (m_frameSyncPending) {
+            profiler.addDroppedFrames(1);
+        }
+        m_frameSyncPending = true;
+    }
+    emit frameChanged();
+}
+
+//! \brief Задает нижнюю границу обзора и перестраивает колонки из пирамиды кадра.
+void SpectrumPlotItem::setViewMinHz(double viewMinHz)
+{
+    if (qFuzzyCompare(m_viewMinHz + 1.0, viewMinHz + 1.0))
+        return;
+    m_viewMinHz = viewMinHz;
+    updateColumnThresholds();
+    decimate();
+    emit viewMinHzChanged();
+}
+
+//! \brief Задает верхнюю границу обзора и перестраивает колонки из пирамиды кадра.
+void SpectrumPlotItem::setViewMaxHz(double viewMaxHz)
+{
+    if (qFuzzyCompare(m_viewMaxHz + 1.0, viewMaxHz + 1.0))
+        return;
+    m_viewMaxHz = viewMaxHz;
+    updateColumnThresholds();
+    decimate();
+    emit viewMaxHzChanged();
+}
+
+//! \brief Задает нижнюю границу шкалы.
+void SpectrumPlotItem::setMinDb(double minDb)
+{
+    if (qFuzzyCompare(m_minDb, minDb))
+        return;
+    m_minDb = minDb;
+    markTraceDirty();
+    emit minDbChanged();
+}
+
+//! \brief Задает верхнюю границу шкалы.
+void SpectrumPlotItem::setMaxDb(double maxDb)
+{
+    if (qFuzzyCompare(m_maxDb, maxDb))
+        return;
+    m_maxDb = maxDb;
+    markTraceDirty();
+    emit maxDbChanged();
+}
+
+//! \brief Задает число вертикальных линий сетки.
+void SpectrumPlotItem::setGridColumns(int gridColumns)
+{
+    gridColumns = qMax(2, gridColumns);
+    if (m_gridColumns == gridColumns)
+        return;
+    m_gridColumns = gridColumns;
+    m_gridDirty = true;
+    update();
+    emit gridColumnsChanged();
+}
+
+//! \brief Задает число горизонтальных линий сетки.
+void SpectrumPlotItem::setGridRows(int gridRows)
+{
+    gridRows = qMax(2, gridRows);
+    if (m_gridRows == gridRows)
+        return;
+    m_gridRows = gridRows;
+    m_gridDirty = true;
+    update();
+    emit gridRowsChanged();
+}
+
+//! \brief Задает цвет сетки.
+void SpectrumPlotItem::setGridColor(const QColor &gridColor)
+{
+    if (m_gridColor == gridColor)
+        return;
+    m_gridColor = gridColor;
+    m_colorsDirty = true;
+    update();
+    emit gridColorChanged();
+}
+
+//! \brief Задает цвет трассы.
+void SpectrumPlotItem::setTraceColor(const QColor &traceColor)
+{
+    if (m_traceColor == traceColor)
+        return;
+    m_traceColor = traceColor;
+    m_colorsDirty = true;
+    update();
+    emit traceColorChanged();
+}
+
+/*!
+ *  \brief Разбирает описание полос и перестраивает профиль порогов.
+ *  \param[in] bands Список объектов {bandId, centerHz, widthHz, thresholdDb, enabled}.
+ */
+void SpectrumPlotItem::setBands(const QVariantList &bands)
+{
+    m_bands = bands;
+    m_plotBands.clear();
+    m_plotBands.reserve(bands.size());
+
+    for (qsizetype i = 0; i < bands.size(); ++i) {
+        const QVariantMap band = bands.at(i).toMap();
+        const double centerHz = band.value(QStringLiteral("centerHz")).toDouble();
+        const double halfHz = band.value(QStringLiteral("widthHz")).toDouble() * 0.5;
+        PlotBand plotBand;
+        plotBand.id = band.value(QStringLiteral("bandId"), static_cast<int>(i)).toInt();
+        plotBand.band = {centerHz - halfHz, centerHz + halfHz, band.value(QStringLiteral("thresholdDb")).toFloat()};
+        plotBand.enabled = band.value(QStringLiteral("enabled"), true).toBool();
+        m_plotBands.push_back(plotBand);
+    }
+
+    rebuildThresholdProfile();
+    emit bandsChanged();
+}
+
+/*!
+ *  \brief Обновляет одну полосу порога и перестраивает профиль.
+ *  \param[in] bandId Идентификатор полосы.
+ *  \param[in] centerHz Центральная частота, Гц.
+ *  \param[in] widthHz Ширина, Гц.
+ *  \param[in] thresholdDb Порог, дБ.
+ *  \param[in] enabled Признак включения.
+ */
+void SpectrumPlotItem::updateBand(int bandId, double centerHz, double widthHz, double thresholdDb, bool enabled)
+{
+    const QVariantMap description{{QStringLiteral("bandId"), bandId},
+                                  {QStringLiteral("centerHz"), centerHz},
+                                  {QStringLiteral("widthHz"), widthHz},
+                                  {QStringLiteral("thresholdDb"), thresholdDb},
+                                  {QStringLiteral("enabled"), enabled}};
+    const double halfHz = widthHz * 0.5;
+    PlotBand plotBand;
+    plotBand.id = bandId;
+    plotBand.band = {centerHz - halfHz, centerHz + halfHz, static_cast<float>(thresholdDb)};
+    plotBand.enabled = enabled;
+
+    const auto it = std::find_if(m_plotBands.begin(), m_plotBands.end(),
+                                 [bandId](const PlotBand &band) { return band.id == bandId; });
+    if (it == m_plotBands.end()) {
+        m_plotBands.push_back(plotBand);
+        m_bands.append(description);
+    } else {
+        *it = plotBand;
+        m_bands[it - m_plotBands.begin()] = description;
+    }
+
+    rebuildThresholdProfile();
+    emit bandsChanged();
+}
+
+/*!
+ *  \brief Задает снимок трасс обработки.
+ *  \param[in] traces Снимок трасс.
+ */
+void SpectrumPlotItem::setTraces(const SpectrumTraces &traces)
+{
+    m_traces = traces;
+    decimateTraces();
+    emit tracesChanged();
+}
+
+/*!
+ *  \brief Отслеживает изменение размеров.
+ *  \param[in] newGeometry Новая геометрия.
+ *  \param[in] oldGeometry Предыдущая геометрия.
+ */
+void SpectrumPlotItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() == oldGeometry.size())
+        return;
+
+    m_gridDirty = true;
+    if (qFloor(newGeometry.width()) != qFloor(oldGeometry.width())) {
+        updateColumnThresholds();
+        decimate();
+    } else {
+        markTraceDirty();
+    }
+}
+
+/*!
+ *  \brief Подключает учет отрисовки к окну, в котором оказался элемент.
+ *  \param[in] change Вид изменения.
+ *  \param[in] value Новое значение.
+ */
+void SpectrumPlotItem::itemChange(ItemChange change, const ItemChangeData &value)
+{
+    QQuickItem::itemChange(change, value);
+    if (change != ItemSceneChange)
+        return;
+
+    disconnect(m_frameSwappedConnection);
+    if (value.window) {
+        // frameSwapped приходит в потоке отрисовки — там же, где updatePaintNode().
+        m_frameSwappedConnection = connect(value.window, &QQuickWindow::frameSwapped,
+                                           this, &SpectrumPlotItem::recordFrameSwapped, Qt::DirectConnection);
+    }
+}
+
+//! \brief Учитывает отрисовку и сквозную задержку кадра, выведенного на экран.
+void SpectrumPlotItem::recordFrameSwapped()
+{
+    if (m_syncStartNs == 0) {
+        return;
+    }
+    const qint64 swappedNs = PipelineProfiler::nowNs();
+    PipelineProfiler &profiler = PipelineProfiler::instance();
+    profiler.record(PipelineProfiler::Stage::Render, m_syncStartNs, swappedNs, m_syncSequence);
+    profiler.record(PipelineProfiler::Stage::EndToEnd, m_syncAcquiredNs, swappedNs, m_syncSequence);
+    m_syncStartNs = 0;
+}
+
+//! \brief Пересчитывает пары min/max для текущего обзора и ширины (O(ширина) по пирамиде).
+void SpectrumPlotItem::decimate()
+{
+    const int columns = qMax(0, qFloor(width()));
+    if (!m_frame.isValid() || columns <= 0) {
+        m_minMax.clear();
+        m_visible.clear();
+        m_visibleCount = 0;
+    } else {
+        if (m_columnThresholds.size() != static_cast<size_t>(columns)) {
+            updateColumnThresholds();
+        }
+        m_minMax.resize(static_cast<size_t>(columns) * 2);
+        m_visible.resize(static_cast<size_t>(columns));
+        m_visibleCount = SpectrumDecimator::decimateMasked(m_frame, m_viewMinHz, m_viewMaxHz, columns, 0, columns,
+                                                           m_columnThresholds.data(), m_minMax.data(),
+                                                           m_visible.data());
+    }
+    decimateTraces();
+    markTraceDirty();
+}
+
+//! \brief Сводит включенные трассы обработки к парам min/max колонок (O(ширина) по пирамидам).
+void SpectrumPlotItem::decimateTraces()
+{
+    const int columns = qMax(0, qFloor(width()));
+    for (int i = 0; i < TraceProcessor::kModeCount; ++i) {
+        const SpectrumFrame &trace = m_traces.frames[static_cast<size_t>(i)];
+        std::vector<float> &minMax = m_traceMinMax[static_cast<size_t>(i)];
+        if (!trace.isValid() || columns <= 0) {
+            minMax.clear();
+            continue;
+        }
+        minMax.resize(static_cast<size_t>(columns) * 2);
+        SpectrumDecimator::decimateMinMax(trace, m_viewMinHz, m_viewMaxHz, columns, minMax.data());
+    }
+    markTraceDirty();
+}
+
+/*!
+ *  \brief Пересчитывает пары min/max только колонок, покрывающих измененные значения.
+ *  \param[in] changed Измененные диапазоны значений кадра.
+ */
+void SpectrumPlotItem::decimateChanged(const QList<QPair<int, int>> &changed)
+{
+    const int columns = static_cast<int>(m_minMax.size() / 2);
+    if (changed.isEmpty() || columns <= 0) {
+        return;
+    }
+
+    const double firstBin = m_frame.binPosition(m_viewMinHz);
+    const double step = (m_frame.binPosition(m_viewMaxHz) - firstBin) / columns;
+    if (step <= 0.0) {
+        decimate();
+        return;
+    }
+
+    const auto decimateColumns = [&](int first, int last) {
+        m_visibleCount -= static_cast<int>(std::count(m_visible.cbegin() + first, m_visible.cbegin() + last, 1));
+        m_visibleCount += SpectrumDecimator::decimateMasked(m_frame, m_viewMinHz, m_viewMaxHz, columns, first,
+                                                            last, m_columnThresholds.data(), m_minMax.data(),
+                                                            m_visible.data());
+    };
+
+    // Запрос к пирамиде округляет колонки наружу до блока (не больше колонки),
+    // поэтому захватывается по одной соседней колонке с каждой стороны.
+    int pendingFirst = -1;
+    int pendingLast = -1;
+    for (const QPair<int, int> &range : changed) {
+        const int first = qBound(0, qFloor((range.first - firstBin) / step) - 1, columns);
+        const int last = qBound(0, qCeil((range.second - firstBin) / step) + 1, columns);
+        if (first >= last) {
+            continue;
+        }
+        if (pendingLast >= first) {
+            pendingLast = qMax(pendingLast, last);
+            continue;
+        }
+        if (pendingFirst < pendingLast) {
+            decimateColumns(pendingFirst, pendingLast);
+        }
+        pendingFirst = first;
+        pendingLast = last;
+    }
+    if (pendingFirst < pendingLast) {
+        decimateColumns(pendingFirst, pendingLast);
+        markTraceDirty();
+    }
+}
+
+//! \brief Перестраивает профиль порогов включенных полос (только при изменении полос).
+void SpectrumPlotItem::rebuildThresholdProfile()
+{
+    std::vector<SpectrumDecimator::ThresholdBand> enabledBands;
+    enabledBands.reserve(m_plotBands.size());
+    for (const PlotBand &plotBand : m_plotBands) {
+        if (plotBand.enabled) {
+            enabledBands.push_back(plotBand.band);
+        }
+    }
+    m_thresholdProfile = SpectrumDecimator::buildThresholdProfile(enabledBands);
+
+    updateColumnThresholds();
+    decimate();
+}
+
+//! \brief Пересчитывает порог каждой колонки по профилю (при изменении полос, обзора или ширины).
+void SpectrumPlotItem::updateColumnThresholds()
+{
+    const int columns = qMax(0, qFloor(width()));
+    m_columnThresholds.resize(static_cast<size_t>(columns));
+    SpectrumDecimator::columnThresholds(m_thresholdProfile, m_viewMinHz, m_viewMaxHz, columns,
+                                        m_columnThresholds.data());
+}
+
+//! \brief Помечает трассу для обновления и планирует перерисовку.
+void SpectrumPlotItem::markTraceDirty()
+{
+    m_traceDirty = true;
+    update();
+}
+
+/*!
+ *  \brief Обновляет узлы сетки и трассы.
+ *  \param[in] oldNode Корневой узел с прошлой отрисовки.
+ *  \return Корневой узел элемента.
+ */
+QSGNode *SpectrumPlotItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    if (m_frameSyncPending) {
+        // Поток UI заблокирован на время синхронизации, поэтому метки кадра читаются без гонок.
+        m_frameSyncPending = false;
+        if (PipelineProfiler::isActive()) {
+            m_syncStartNs = PipelineProfiler::nowNs();
+            m_syncAcquiredNs = m_frame.acquiredNs();
+            m_syncSequence = m_frame.sequence();
+        }
+    }
+
+    QSGNode *root = oldNode;
+    if (!root) {
+        root = new QSGNode;
+        root->appendChildNode(createLineNode(m_gridColor));
+        root->appendChildNode(createLineNode(m_traceColor));
+        for (const char *color : kProcessedTraceColors) {
+            root->appendChildNode(createLineNode(QColor(QLatin1String(color))));
+        }
+        m_gridDirty = true;
+        m_traceDirty = true;
+    }
+
+    auto *gridNode = static_cast<QSGGeometryNode *>(root->childAtIndex(0));
+    auto *traceNode = static_cast<QSGGeometryNode *>(root->childAtIndex(1));
+    const float w = static_cast<float>(width());
+    const float h = static_cast<float>(height());
+
+    if (m_colorsDirty) {
+        updateNodeColor(gridNode, m_gridColor);
+        updateNodeColor(traceNode, m_traceColor);
+        m_colorsDirty = false;
+    }
+
+    if (m_gridDirty) {
+        QSGGeometry *geometry = gridNode->geometry();
+        geometry->allocate((m_gridColumns + m_gridRows) * 2);
+        QSGGeometry::Point2D *v = geometry->vertexDataAsPoint2D();
+
+        for (int i = 0; i < m_gridColumns; ++i) {
+            const float x = qMin(w - 0.5f, (static_cast<float>(i) / (m_gridColumns - 1)) * w + 0.5f);
+            (v++)->set(x, 0.0f);
+            (v++)->set(x, h);
+        }
+        for (int j = 0; j < m_gridRows; ++j) {
+            const float y = qMin(h - 0.5f, (static_cast<float>(j) / (m_gridRows - 1)) * h + 0.5f);
+            (v++)->set(0.0f, y);
+            (v++)->set(w, y);
+        }
+
+        gridNode->markDirty(QSGNode::DirtyGeometry);
+        m_gridDirty = false;
+    }
+
+    if (m_traceDirty) {
+        const int columns = static_cast<int>(qMin(m_minMax.size() / 2, m_visible.size()));
+        const int visible = columns == static_cast<int>(m_visible.size()) ? m_visibleCount : 0;
+        const float minDb = static_cast<float>(m_minDb);
+        const float dbSpan = static_cast<float>(qMax(1.0, m_maxDb - m_minDb));
+
+        // Видимость и обрезка по порогу уже вычислены при сведении кадра.
+        QSGGeometry *geometry = traceNode->geometry();
+        if (geometry->vertexCount() != visible * 2) {
+            geometry->allocate(visible * 2);
+        }
+        QSGGeometry::Point2D *v = geometry->vertexDataAsPoint2D();
+
+        for (int x = 0; x < columns && visible > 0; ++x) {
+            if (!m_visible[static_cast<size_t>(x)]) {
+                continue;
+            }
+            const float px = static_cast<float>(x) + 0.5f;
+            (v++)->set(px, qBound(0.0f, h - (m_minMax[x * 2] - minDb) / dbSpan * h, h));
+            (v++)->set(px, qBound(0.0f, h - (m_minMax[x * 2 + 1] - minDb) / dbSpan * h, h));
+        }
+
+        traceNode->markDirty(QSGNode::DirtyGeometry);
+
+        // Трассы обработки — ломаные по максимумам колонок (минимумам для
+        // удержания минимума); колонки вне кадра разрывают линию.
+        for (int i = 0; i < TraceProcessor::kModeCount; ++i) {
+            const std::vector<float> &minMax = m_traceMinMax[static_cast<size_t>(i)];
+            const int traceColumns = static_cast<int>(minMax.size() / 2);
+            const int offset = static_cast<TraceProcessor::Mode>(i) == TraceProcessor::Mode::MinHold ? 0 : 1;
+            const auto level = [&](int x) { return minMax[static_cast<size_t>(x) * 2 + offset]; };
+
+            int segments = 0;
+            for (int x = 1; x < traceColumns; ++x) {
+                segments += qIsFinite(level(x - 1)) && qIsFinite(level(x));
+            }
+
+            auto *processedNode = static_cast<QSGGeometryNode *>(root->childAtIndex(2 + i));
+            QSGGeometry *processedGeometry = processedNode->geometry();
+            if (processedGeometry->vertexCount() != segments * 2) {
+                processedGeometry->allocate(segments * 2);
+            }
+            QSGGeometry::Point2D *p = processedGeometry->vertexDataAsPoint2D();
+            for (int x = 1; x < traceColumns && segments > 0; ++x) {
+                const float from = level(x - 1);
+                const float to = level(x);
+                if (!qIsFinite(from) || !qIsFinite(to)) {
+                    continue;
+                }
+                (p++)->set(static_cast<float>(x) - 0.5f, qBound(0.0f, h - (from - minDb) / dbSpan * h, h));
+                (p++)->set(static_cast<float>(x) + 0.5f, qBound(0.0f, h - (to - minDb) / dbSpan * h, h));
+            }
+            processedNode->markDirty(QSGNode::DirtyGeometry);
+        }
+        m_traceDirty = false;
+    }
+
+    return root;
+}
@@ -0,0 +1,256 @@
+/*!
+ *  \file spectrumplotitem.h
+ *  \brief Отрисовка панорамного спектра средствами scene graph.
+ */
+#ifndef SPECTRUMPLOTITEM_H
+#define SPECTRUMPLOTITEM_H
+
+#include <QColor>
+#include <QQuickItem>
+#include <QVariantList>
+
+#include <array>
+#include <vector>
+
+#include "spectrumdecimator.h"
+#include "spectrumframe.h"
+#include "traceprocessor.h"
+
+/*!
+ *  \class SpectrumPlotItem
+ *  \brief Рисует сетку и трассу спектра (пары min/max на колонку) узлами QSGGeometryNode.
+ *
+ *  Геометрия сетки кэшируется и перестраивается только при изменении
+ *  размеров; на каждом кадре обновляется лишь вершинный буфер трассы.
+ *  Кадр может покрывать более широкий диапазон, чем обзор: колонки
+ *  обзора берутся из пирамиды min/max кадра без повторного запроса данных.
+ *
+ *  Пороги полос сводятся в профиль SpectrumDecimator при изменении полос;
+ *  пороги колонок пересчитываются из профиля только при изменении обзора
+ *  или ширины, а обрезка пар и маска видимости колонок вычисляются вместе
+ *  со сведением кадра.
+ *
+ *  Поверх основного спектра рисуются включенные трассы обработки
+ *  (среднее, удержание максимума и минимума, пик со спадом). Их
+ *  накопители обновляет TraceProcessor в потоке формирования на каждом
+ *  кадре; элемент получает снимки трасс (traces), а колонки берутся из
+ *  пирамид накопителей так же, как для основного спектра.
+ */
+class SpectrumPlotItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(SpectrumFrame frame READ frame WRITE setFrame NOTIFY frameChanged FINAL)
+    Q_PROPERTY(double viewMinHz READ viewMinHz WRITE setViewMinHz NOTIFY viewMinHzChanged FINAL)
+    Q_PROPERTY(double viewMaxHz READ viewMaxHz WRITE setViewMaxHz NOTIFY viewMaxHzChanged FINAL)
+    Q_PROPERTY(double minDb READ minDb WRITE setMinDb NOTIFY minDbChanged FINAL)
+    Q_PROPERTY(double maxDb READ maxDb WRITE setMaxDb NOTIFY maxDbChanged FINAL)
+    Q_PROPERTY(int gridColumns READ gridColumns WRITE setGridColumns NOTIFY gridColumnsChanged FINAL)
+    Q_PROPERTY(int gridRows READ gridRows WRITE setGridRows NOTIFY gridRowsChanged FINAL)
+    Q_PROPERTY(QColor gridColor READ gridColor WRITE setGridColor NOTIFY gridColorChanged FINAL)
+    Q_PROPERTY(QColor traceColor READ traceColor WRITE setTraceColor NOTIFY traceColorChanged FINAL)
+    Q_PROPERTY(QVariantList bands READ bands WRITE setBands NOTIFY bandsChanged FINAL)
+    Q_PROPERTY(SpectrumTraces traces READ traces WRITE setTraces NOTIFY tracesChanged FINAL)
+
+public:
+    //! \brief Биты трасс обработки для маски SpectrumControllerStub::traceModes.
+    enum TraceMode {
+        //! \brief Экспоненциальное среднее.
+        TraceAverage = 1 << static_cast<int>(TraceProcessor::Mode::Average),
+        //! \brief Удержание максимума.
+        TraceMaxHold = 1 << static_cast<int>(TraceProcessor::Mode::MaxHold),
+        //! \brief Удержание минимума.
+        TraceMinHold = 1 << static_cast<int>(TraceProcessor::Mode::MinHold),
+        //! \brief Пик со спадом.
+        TracePeakDecay = 1 << static_cast<int>(TraceProcessor::Mode::PeakDecay)
+    };
+    Q_ENUM(TraceMode)
+
+    //! \brief Конструирует элемент отрисовки.
+    explicit SpectrumPlotItem(QQuickItem *parent = nullptr);
+
+    //! \brief Возвращает текущий кадр спектра.
+    SpectrumFrame frame() const { return m_frame; }
+    //! \brief Возвращает нижнюю границу обзора, Гц.
+    double viewMinHz() const noexcept { return m_viewMinHz; }
+    //! \brief Возвращает верхнюю границу обзора, Гц.
+    double viewMaxHz() const noexcept { return m_viewMaxHz; }
+    //! \brief Возвращает нижнюю границу шкалы, дБ.
+    double minDb() const noexcept { return m_minDb; }
+    //! \brief Возвращает верхнюю границу шкалы, дБ.
+    double maxDb() const noexcept { return m_maxDb; }
+    //! \brief Возвращает число вертикальных линий сетки.
+    int gridColumns() const noexcept { return m_gridColumns; }
+    //! \brief Возвращает число горизонтальных линий сетки.
+    int gridRows() const noexcept { return m_gridRows; }
+    //! \brief Возвращает цвет сетки.
+    QColor gridColor() const { return m_gridColor; }
+    //! \brief Возвращает цвет трассы.
+    QColor traceColor() const { return m_traceColor; }
+    //! \brief Возвращает описание полос порогов.
+    QVariantList bands() const { return m_bands; }
+    //! \brief Возвращает снимок трасс обработки.
+    SpectrumTraces traces() const { return m_traces; }
+
+public slots:
+    /*!
+     *  \brief Задает новый кадр спектра и пересчитывает пары min/max.
+     *  \param[in] frame Кадр спектра.
+     */
+    void setFrame(const SpectrumFrame &frame);
+    //! \brief Задает нижнюю границу обзора, Гц.
+    void setViewMinHz(double viewMinHz);
+    //! \brief Задает верхнюю границу обзора, Гц.
+    void setViewMaxHz(double viewMaxHz);
+    //! \brief Задает нижнюю границу шкалы, дБ.
+    void setMinDb(double minDb);
+    //! \brief Задает верхнюю границу шкалы, дБ.
+    void setMaxDb(double maxDb);
+    //! \brief Задает число вертикальных линий сетки.
+    void setGridColumns(int gridColumns);
+    //! \brief Задает число горизонтальных линий сетки.
+    void setGridRows(int gridRows);
+    //! \brief Задает цвет сетки.
+    void setGridColor(const QColor &gridColor);
+    //! \brief Задает цвет трассы.
+    void setTraceColor(const QColor &traceColor);
+    /*!
+     *  \brief Задает полосы порогов.
+     *  \param[in] bands Список объектов {centerHz, widthHz, thresholdDb, enabled}.
+     */
+    void setBands(const QVariantList &bands);
+    /*!
+     *  \brief Обновляет одну полосу порога без повторной передачи всего списка.
+     *  \param[in] bandId Идентификатор полосы (ключ bandId в описании полос).
+     *  \param[in] centerHz Центральная частота, Гц.
+     *  \param[in] widthHz Ширина, Гц.
+     *  \param[in] thresholdDb Порог, дБ.
+     *  \param[in] enabled Признак включения.
+     */
+    void updateBand(int bandId, double centerHz, double widthHz, double thresholdDb, bool enabled);
+    /*!
+     *  \brief Задает снимок трасс обработки и пересчитывает их пары min/max.
+     *  \param[in] traces Снимок трасс (пустой кадр — трасса выключена).
+     */
+    void setTraces(const SpectrumTraces &traces);
+
+signals:
+    //! \brief Сигнал об изменении кадра.
+    void frameChanged();
+    //! \brief Сигнал об изменении нижней границы обзора.
+    void viewMinHzChanged();
+    //! \brief Сигнал об изменении верхней границы обзора.
+    void viewMaxHzChanged();
+    //! \brief Сигнал об изменении нижней границы шкалы.
+    void minDbChanged();
+    //! \brief Сигнал об изменении верхней границы шкалы.
+    void maxDbChanged();
+    //! \brief Сигнал об изменении числа вертикальных линий сетки.
+    void gridColumnsChanged();
+    //! \brief Сигнал об изменении числа горизонтальных линий сетки.
+    void gridRowsChanged();
+    //! \brief Сигнал об изменении цвета сетки.
+    void gridColorChanged();
+    //! \brief Сигнал об изменении цвета трассы.
+    void traceColorChanged();
+    //! \brief Сигнал об изменении полос порогов.
+    void bandsChanged();
+    //! \brief Сигнал об изменении снимка трасс обработки.
+    void tracesChanged();
+
+protected:
+    //! \brief Обновляет узлы сетки и трассы в потоке отрисовки.
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    //! \brief Отслеживает изменение размеров для пересчета колонок и сетки.
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    //! \brief Подключает учет отрисовки PipelineProfiler к окну элемента.
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
+
+private:
+    //! \brief Полоса порога с идентификатором.
+    struct PlotBand
+    {
+        //! \brief Идентификатор полосы.
+        int id = 0;
+        //! \brief Интервал частот и порог.
+        SpectrumDecimator::ThresholdBand band;
+        //! \brief Признак включения.
+        bool enabled = true;
+    };
+
+    //! \brief Пересчитывает пары min/max под текущую ширину.
+    void decimate();
+    /*!
+     *  \brief Пересчитывает пары min/max только колонок, покрывающих измененные значения.
+     *  \param[in] changed Измененные диапазоны значений кадра [first, last).
+     */
+    void decimateChanged(const QList<QPair<int, int>> &changed);
+    //! \brief Перестраивает профиль порогов по текущим полосам и пересчитывает колонки.
+    void rebuildThresholdProfile();
+    //! \brief Пересчитывает порог для каждой колонки по профилю.
+    void updateColumnThresholds();
+    //! \brief Помечает трассу для обновления и планирует перерисовку.
+    void markTraceDirty();
+    //! \brief Сводит включенные трассы обработки к парам min/max колонок.
+    void decimateTraces();
+    //! \brief Учитывает этапы отрисовки кадра после вывода на экран (поток отрисовки).
+    void recordFrameSwapped();
+
+    //! \brief Текущий кадр спектра.
+    SpectrumFrame m_frame;
+    //! \brief Нижняя граница обзора, Гц.
+    double m_viewMinHz = 0.0;
+    //! \brief Верхняя граница обзора, Гц.
+    double m_viewMaxHz = 0.0;
+    //! \brief Нижняя граница шкалы, дБ.
+    double m_minDb = -120.0;
+    //! \brief Верхняя граница шкалы, дБ.
+    double m_maxDb = 0.0;
+    //! \brief Число вертикальных линий сетки.
+    int m_gridColumns = 5;
+    //! \brief Число горизонтальных линий сетки.
+    int m_gridRows = 5;
+    //! \brief Цвет сетки.
+    QColor m_gridColor = QColor(QStringLiteral("#222a33"));
+    //! \brief Цвет трассы.
+    QColor m_traceColor = QColor(QStringLiteral("#4ea1ff"));
+    //! \brief Исходное описание полос порогов.
+    QVariantList m_bands;
+    //! \brief Разобранные полосы порогов.
+    std::vector<PlotBand> m_plotBands;
+    //! \brief Профиль порогов включенных полос.
+    std::vector<SpectrumDecimator::ThresholdSegment> m_thresholdProfile;
+
+    //! \brief Пары min/max по колонкам пикселей, минимум обрезан порогом колонки.
+    std::vector<float> m_minMax;
+    //! \brief Порог для каждой колонки (-inf, если колонка вне полос).
+    std::vector<float> m_columnThresholds;
+    //! \brief Маска видимости колонок.
+    std::vector<quint8> m_visible;
+    //! \brief Число видимых колонок.
+    int m_visibleCount = 0;
+
+    //! \brief Снимок трасс обработки.
+    SpectrumTraces m_traces;
+    //! \brief Пары min/max трасс обработки по колонкам (пусто — трасса выключена).
+    std::array<std::vector<float>, TraceProcessor::kModeCount> m_traceMinMax;
+
+    //! \brief Требуется перестроить сетку.
+    bool m_gridDirty = true;
+    //! \brief Требуется обновить вершины трассы.
+    bool m_traceDirty = true;
+    //! \brief Требуется обновить цвета материалов.
+    bool m_colorsDirty = true;
+
+    //! \brief Профилируемый кадр задан, но еще не синхронизирован с scene graph.
+    bool m_frameSyncPending = false;
+    //! \brief Начало синхронизации профилируемого кадра, нс (0 — нет кадра к выводу; поток отрисовки).
+    qint64 m_syncStartNs = 0;
+    //! \brief Начало формирования синхронизированного кадра, нс.
+    qint64 m_syncAcquiredNs = 0;
+    //! \brief Номер синхронизированного кадра.
+    quint64 m_syncSequence = 0;
+    //! \brief Подключение к QQuickWindow::frameSwapped.
+    QMetaObject::Connection m_frameSwappedConnection;
+};
+
+#endif // SPECTRUMPLOTITEM_H
@@ -0,0 +1,193 @@
+/*!
+ *  \file spectrumproducer.cpp
+ *  \brief Реализация SpectrumProducer.
+ */
+#include "spectrumproducer.h"
+
+#include "pipelineprofiler.h"
+
+#include <QDateTime>
+#include <QtMath>
+
+#include <chrono>
+
+/*!
+ *  \brief Конструирует поток формирования.
+ *  \param[in] generator Функция формирования кадра.
+ *  \param[in] parent Родительский объект.
+ */
+SpectrumProducer::SpectrumProducer(Generator generator, QObject *parent)
+    : QThread(parent)
+    , m_generator(std::move(generator))
+{
+    setObjectName(QStringLiteral("SpectrumProducer"));
+}
+
+//! \brief Останавливает поток и дожидается его завершения.
+SpectrumProducer::~SpectrumProducer()
+{
+    stop();
+}
+
+/*!
+ *  \brief Задает частоту формирования кадров.
+ *  \param[in] frameRateHz Частота, Гц.
+ */
+void SpectrumProducer::setFrameRateHz(double frameRateHz)
+{
+    m_frameRateHz.store(qBound(1.0, frameRateHz, 1000.0), std::memory_order_relaxed);
+    wake();
+}
+
+/*!
+ *  \brief Задает получателя всех сформированных кадров.
+ *  \param[in] sink Функция, вызываемая в потоке формирования.
+ */
+void SpectrumProducer::setFrameSink(FrameSink sink)
+{
+    Q_ASSERT(!isRunning());
+    m_sink = std::move(sink);
+}
+
+/*!
+ *  \brief Публикует новый диапазон обзора для потока формирования.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ *  \param[in] generation Поколение запроса.
+ */
+void SpectrumProducer::requestViewport(double minHz, double maxHz, quint64 generation)
+{
+    // Поколение публикуется раньше запроса: поток формирования прерывает
+    // текущий кадр и затем гарантированно находит новый запрос в слоте.
+    m_latestGeneration.store(generation, std::memory_order_release);
+    ViewportRequest &request = m_requests.writeBuffer();
+    request.minHz = minHz;
+    request.maxHz = maxHz;
+    request.generation = generation;
+    m_requests.publish();
+}
+
+/*!
+ *  \brief Забирает последний готовый кадр.
+ *  \param[out] frame Последний кадр.
+ *  \return true, если получен новый кадр.
+ */
+bool SpectrumProducer::takeLatestFrame(SpectrumFrame &frame)
+{
+    // Сбрасываем признак до чтения: кадр, опубликованный после consume(),
+    // гарантированно вызовет новое уведомление.
+    m_notifyPending.store(false, std::memory_order_release);
+    if (!m_frames.consume()) {
+        return false;
+    }
+    frame = m_frames.readBuffer();
+    return true;
+}
+
+//! \brief Останавливает поток и дожидается его завершения.
+void SpectrumProducer::stop()
+{
+    requestInterruption();
+    wake();
+    wait();
+}
+
+//! \brief Прерывает текущую паузу потока формирования.
+void SpectrumProducer::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeRequested = true;
+    }
+    m_wakeCondition.notify_one();
+}
+
+/*!
+ *  \brief Ждет начала следующего кадра, пересчитывая срок при смене частоты.
+ *  \param[in] frameStart Плановое начало текущего кадра.
+ *  \return Плановое начало следующего кадра.
+ */
+SpectrumProducer::Clock::time_point SpectrumProducer::waitForNextFrame(Clock::time_point frameStart)
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    while (!isInterruptionRequested()) {
+        const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / frameRateHz()));
+        const Clock::time_point deadline = frameStart + period;
+        const Clock::time_point now = Clock::now();
+        if (deadline <= now) {
+            // Не успеваем: не пытаемся «догонять» пропущенные кадры.
+            return now;
+        }
+        if (!m_wakeCondition.wait_until(lock, deadline, [this]() { return m_wakeRequested; })) {
+            return deadline;
+        }
+        m_wakeRequested = false;
+    }
+    return Clock::now();
+}
+
+//! \brief Формирует кадры для последнего запрошенного диапазона с заданной частотой.
+void SpectrumProducer::run()
+{
+    ViewportRequest viewport;
+    bool hasViewport = false;
+    Clock::time_point deadline = Clock::now();
+
+    // Запрос отменяется, как только опубликовано более новое поколение.
+    const CancelCheck cancelled = [this, &viewport]() {
+        return isInterruptionRequested()
+            || m_latestGeneration.load(std::memory_order_acquire) != viewport.generation;
+    };
+
+    while (!isInterruptionRequested()) {
+        if (m_requests.consume()) {
+            viewport = m_requests.readBuffer();
+            hasViewport = true;
+        }
+
+        const bool profiling = PipelineProfiler::isActive();
+        const qint64 acquiredNs = profiling ? PipelineProfiler::nowNs() : 0;
+
+        SpectrumFrame frame;
+        if (hasViewport && m_generator) {
+            frame = m_generator(viewport.minHz, viewport.maxHz, cancelled);
+        }
+        if (!frame.isValid() && hasViewport && cancelled()) {
+            // Новый запрос уже ждет в слоте: берем его без паузы до следующего кадра.
+            deadline = Clock::now();
+            continue;
+        }
+
+        if (frame.isValid()) {
+            // Собранная панорама приходит с уже обновленной пирамидой.
+            if (frame.pyramid().binCount() != frame.binCount()) {
+                frame.rebuildPyramid();
+            }
+            frame.setTimestampUs(QDateTime::currentMSecsSinceEpoch() * 1000);
+            frame.setSequence(m_nextSequence++);
+            frame.setViewportGeneration(viewport.generation);
+            if (profiling) {
+                const qint64 generatedNs = PipelineProfiler::nowNs();
+                PipelineProfiler::instance().record(PipelineProfiler::Stage::Generate,
+                                                    acquiredNs, generatedNs, frame.sequence());
+                frame.setPipelineStamps(acquiredNs, generatedNs);
+            }
+            if (m_sink) {
+                m_sink(frame);
+            }
+
+            if (profiling) {
+                frame.setPipelineStamps(acquiredNs, PipelineProfiler::nowNs());
+            }
+            m_frames.writeBuffer() = std::move(frame);
+            m_frames.publish();
+
+            if (!m_notifyPending.exchange(true, std::memory_order_acq_rel)) {
+                emit frameAvailable();
+            }
+        }
+
+        deadline = waitForNextFrame(deadline);
+    }
+}
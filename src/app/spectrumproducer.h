@@ -0,0 +1,147 @@
+/*!
+ *  \file spectrumproducer.h
+ *  \brief Поток непрерывного формирования кадров спектра.
+ */
+#ifndef SPECTRUMPRODUCER_H
+#define SPECTRUMPRODUCER_H
+
+#include <QThread>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+#include "latestvalueslot.h"
+#include "spectrumframe.h"
+
+/*!
+ *  \class SpectrumProducer
+ *  \brief Формирует кадры спектра в отдельном потоке с заданной частотой.
+ *
+ *  Запросы диапазона от UI и готовые кадры передаются через LatestValueSlot,
+ *  поэтому UI всегда получает только последний готовый кадр, а устаревшие
+ *  кадры отбрасываются без блокировок.
+ *
+ *  Каждый запрос несет поколение. Формирование кадра для запроса, который
+ *  уже заменен более новым, прерывается генератором по проверке отмены, а
+ *  готовый кадр помечается поколением своего запроса.
+ *
+ *  Пауза до следующего кадра прерывается остановкой и сменой частоты,
+ *  поэтому stop() не ждет окончания периода даже при низкой частоте.
+ */
+class SpectrumProducer : public QThread
+{
+    Q_OBJECT
+
+public:
+    //! \brief Проверка отмены: true, если запрос заменен более новым или поток останавливается.
+    using CancelCheck = std::function<bool()>;
+    //! \brief Функция формирования кадра для диапазона [minHz, maxHz] (пустой кадр — нет данных или отмена).
+    using Generator = std::function<SpectrumFrame(double minHz, double maxHz, const CancelCheck &cancelled)>;
+    //! \brief Функция, получающая каждый сформированный кадр в потоке формирования (не должна блокироваться).
+    using FrameSink = std::function<void(const SpectrumFrame &frame)>;
+
+    /*!
+     *  \brief Конструирует поток формирования.
+     *  \param[in] generator Функция формирования кадра.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit SpectrumProducer(Generator generator, QObject *parent = nullptr);
+    //! \brief Останавливает поток и дожидается его завершения.
+    ~SpectrumProducer() override;
+
+    //! \brief Возвращает частоту формирования кадров, Гц.
+    double frameRateHz() const noexcept { return m_frameRateHz.load(std::memory_order_relaxed); }
+    /*!
+     *  \brief Задает частоту формирования кадров.
+     *
+     *  Текущая пауза пересчитывается от начала последнего кадра с новым периодом.
+     *  \param[in] frameRateHz Частота, Гц (ограничивается диапазоном 1..1000).
+     */
+    void setFrameRateHz(double frameRateHz);
+
+    /*!
+     *  \brief Задает получателя всех сформированных кадров (до запуска потока).
+     *  \param[in] sink Функция, вызываемая в потоке формирования.
+     */
+    void setFrameSink(FrameSink sink);
+
+    /*!
+     *  \brief Передает потоку новый диапазон обзора (поток UI).
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     *  \param[in] generation Поколение запроса (не убывает от запроса к запросу).
+     */
+    void requestViewport(double minHz, double maxHz, quint64 generation = 0);
+
+    /*!
+     *  \brief Забирает последний готовый кадр (поток UI).
+     *  \param[out] frame Последний кадр, если он появился с прошлого вызова.
+     *  \return true, если получен новый кадр.
+     */
+    bool takeLatestFrame(SpectrumFrame &frame);
+
+    //! \brief Возвращает число кадров, замененных до доставки в UI.
+    quint64 droppedFrames() const noexcept { return m_frames.droppedCount(); }
+
+    //! \brief Останавливает поток и дожидается его завершения.
+    void stop();
+
+signals:
+    //! \brief Сигнал о появлении нового кадра (не чаще одного до его получения).
+    void frameAvailable();
+
+protected:
+    //! \brief Цикл формирования кадров.
+    void run() override;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /*!
+     *  \brief Ждет начала следующего кадра.
+     *  \param[in] frameStart Плановое начало текущего кадра.
+     *  \return Плановое начало следующего кадра.
+     */
+    Clock::time_point waitForNextFrame(Clock::time_point frameStart);
+    //! \brief Прерывает текущую паузу потока формирования.
+    void wake();
+
+    //! \brief Запрошенный диапазон обзора.
+    struct ViewportRequest
+    {
+        //! \brief Нижняя граница, Гц.
+        double minHz = 0.0;
+        //! \brief Верхняя граница, Гц.
+        double maxHz = 0.0;
+        //! \brief Поколение запроса.
+        quint64 generation = 0;
+    };
+
+    //! \brief Функция формирования кадра.
+    Generator m_generator;
+    //! \brief Получатель всех сформированных кадров.
+    FrameSink m_sink;
+    //! \brief Частота формирования кадров, Гц.
+    std::atomic<double> m_frameRateHz{20.0};
+    //! \brief Слот запросов диапазона (UI -> поток).
+    LatestValueSlot<ViewportRequest> m_requests;
+    //! \brief Поколение последнего запроса (читается потоком формирования для отмены).
+    std::atomic<quint64> m_latestGeneration{0};
+    //! \brief Слот готовых кадров (поток -> UI).
+    LatestValueSlot<SpectrumFrame> m_frames;
+    //! \brief Признак отправленного и еще не обработанного уведомления.
+    std::atomic<bool> m_notifyPending{false};
+    //! \brief Номер следующего кадра.
+    quint64 m_nextSequence = 0;
+    //! \brief Защищает m_wakeRequested.
+    std::mutex m_wakeMutex;
+    //! \brief Будит поток формирования во время паузы.
+    std::condition_variable m_wakeCondition;
+    //! \brief Признак запрошенного пробуждения.
+    bool m_wakeRequested = false;
+};
+
+#endif // SPECTRUMPRODUCER_H
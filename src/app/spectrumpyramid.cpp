@@ -0,0 +1,186 @@
+/*!
+ *  \file spectrumpyramid.cpp
+ *  \brief Реализация SpectrumPyramid.
+ */
+#include "spectrumpyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/*!
+ *  \brief Пересчитывает блоки [first, last) уровня 1 по значениям кадра.
+ *  \param[in] bins Значения спектра.
+ *  \param[in] count Количество значений.
+ *  \param[out] level Пары min/max уровня 1.
+ *  \param[in] first Первый блок.
+ *  \param[in] last Блок за последним.
+ */
+void reduceBins(const float *bins, int count, std::vector<float> &level, int first, int last)
+{
+    for (int i = first; i < last; ++i) {
+        const int a = i * 2;
+        const int b = std::min(a + 1, count - 1);
+        level[static_cast<size_t>(i) * 2] = std::min(bins[a], bins[b]);
+        level[static_cast<size_t>(i) * 2 + 1] = std::max(bins[a], bins[b]);
+    }
+}
+
+/*!
+ *  \brief Пересчитывает блоки [first, last) уровня по предыдущему уровню.
+ *  \param[in] lower Пары min/max предыдущего уровня.
+ *  \param[out] upper Пары min/max текущего уровня.
+ *  \param[in] first Первый блок.
+ *  \param[in] last Блок за последним.
+ */
+void reducePairs(const std::vector<float> &lower, std::vector<float> &upper, int first, int last)
+{
+    const int lowerCount = static_cast<int>(lower.size() / 2);
+    for (int i = first; i < last; ++i) {
+        const size_t a = static_cast<size_t>(i) * 2;
+        const size_t b = static_cast<size_t>(std::min(i * 2 + 1, lowerCount - 1));
+        upper[static_cast<size_t>(i) * 2] = std::min(lower[a * 2], lower[b * 2]);
+        upper[static_cast<size_t>(i) * 2 + 1] = std::max(lower[a * 2 + 1], lower[b * 2 + 1]);
+    }
+}
+
+} // namespace
+
+/*!
+ *  \brief Строит все уровни по значениям кадра.
+ *  \param[in] bins Значения спектра.
+ *  \param[in] count Количество значений.
+ */
+void SpectrumPyramid::build(const float *bins, int count)
+{
+    m_binCount = std::max(0, count);
+
+    int levelSize = (m_binCount + 1) / 2;
+    size_t level = 0;
+    while (m_binCount > 1 && levelSize >= 1) {
+        if (m_levels.size() <= level) {
+            m_levels.emplace_back();
+        }
+        m_levels[level].resize(static_cast<size_t>(levelSize) * 2);
+        ++level;
+        if (levelSize == 1) {
+            break;
+        }
+        levelSize = (levelSize + 1) / 2;
+    }
+    m_levels.resize(level);
+
+    update(bins, count, 0, m_binCount);
+}
+
+/*!
+ *  \brief Пересчитывает блоки, затронутые изменением [firstBin, lastBin).
+ *  \param[in] bins Значения спектра.
+ *  \param[in] count Количество значений.
+ *  \param[in] firstBin Первое измененное значение.
+ *  \param[in] lastBin Значение за последним измененным.
+ */
+void SpectrumPyramid::update(const float *bins, int count, int firstBin, int lastBin)
+{
+    if (count != m_binCount || m_levels.empty()) {
+        return;
+    }
+    firstBin = std::clamp(firstBin, 0, count);
+    lastBin = std::clamp(lastBin, firstBin, count);
+    if (firstBin == lastBin) {
+        return;
+    }
+
+    int first = firstBin >> 1;
+    int last = ((lastBin - 1) >> 1) + 1;
+    reduceBins(bins, count, m_levels[0], first, last);
+
+    for (size_t level = 1; level < m_levels.size(); ++level) {
+        first >>= 1;
+        last = ((last - 1) >> 1) + 1;
+        reducePairs(m_levels[level - 1], m_levels[level], first, last);
+    }
+}
+
+//! \brief Сбрасывает все уровни.
+void SpectrumPyramid::clear()
+{
+    m_levels.clear();
+    m_binCount = 0;
+}
+
+/*!
+ *  \brief Сводит диапазон значений к парам min/max за O(width).
+ *  \param[in] bins Значения спектра.
+ *  \param[in] firstBin Дробная позиция начала диапазона.
+ *  \param[in] lastBin Дробная позиция конца диапазона.
+ *  \param[in] width Количество колонок.
+ *  \param[out] out Буфер на 2 * width значений.
+ */
+void SpectrumPyramid::query(const float *bins, double firstBin, double lastBin, int width, float *out) const
+{
+    query(bins, firstBin, lastBin, width, 0, width, out);
+}
+
+/*!
+ *  \brief Сводит к парам min/max только колонки [firstColumn, lastColumn).
+ *  \param[in] bins Значения спектра.
+ *  \param[in] firstBin Дробная позиция начала диапазона.
+ *  \param[in] lastBin Дробная позиция конца диапазона.
+ *  \param[in] width Общее количество колонок.
+ *  \param[in] firstColumn Первая колонка.
+ *  \param[in] lastColumn Колонка за последней.
+ *  \param[out] out Буфер на 2 * width значений.
+ */
+void SpectrumPyramid::query(const float *bins, double firstBin, double lastBin, int width,
+                            int firstColumn, int lastColumn, float *out) const
+{
+    if (!out || width <= 0) {
+        return;
+    }
+    firstColumn = std::clamp(firstColumn, 0, width);
+    lastColumn = std::clamp(lastColumn, firstColumn, width);
+
+    constexpr float kInf = std::numeric_limits<float>::infinity();
+    const double step = (lastBin - firstBin) / width;
+
+    // Уровень, у которого блок не больше числа значений на колонку.
+    int level = 0;
+    if (step >= 2.0) {
+        level = std::min(static_cast<int>(std::floor(std::log2(step))), levelCount());
+    }
+
+    for (int x = firstColumn; x < lastColumn; ++x) {
+        const double startPos = firstBin + x * step;
+        const double endPos = firstBin + (x + 1) * step;
+        long long start = static_cast<long long>(std::floor(startPos));
+        long long end = std::max(start + 1, static_cast<long long>(std::floor(endPos)));
+        start = std::max(0LL, start);
+        end = std::min(static_cast<long long>(m_binCount), end);
+
+        float minVal = kInf;
+        float maxVal = -kInf;
+
+        if (start < end && bins) {
+            if (level == 0) {
+                for (long long i = start; i < end; ++i) {
+                    minVal = std::min(minVal, bins[i]);
+                    maxVal = std::max(maxVal, bins[i]);
+                }
+            } else {
+                const std::vector<float> &pairs = m_levels[static_cast<size_t>(level) - 1];
+                const long long blockFirst = start >> level;
+                const long long blockLast = ((end - 1) >> level) + 1;
+                for (long long b = blockFirst; b < blockLast; ++b) {
+                    minVal = std::min(minVal, pairs[static_cast<size_t>(b) * 2]);
+                    maxVal = std::max(maxVal, pairs[static_cast<size_t>(b) * 2 + 1]);
+                }
+            }
+        }
+
+        out[x * 2] = minVal;
+        out[x * 2 + 1] = maxVal;
+    }
+}
@@ -0,0 +1,83 @@
+/*!
+ *  \file spectrumpyramid.h
+ *  \brief Многоуровневая пирамида min/max над кадром спектра.
+ */
+#ifndef SPECTRUMPYRAMID_H
+#define SPECTRUMPYRAMID_H
+
+#include <vector>
+
+/*!
+ *  \class SpectrumPyramid
+ *  \brief Хранит уровни min/max для быстрого прореживания любого поддиапазона.
+ *
+ *  Уровень 0 — сами значения кадра (не хранятся), уровень k содержит пары
+ *  min/max по блокам из 2^k значений. Запрос произвольного диапазона на
+ *  заданную ширину обслуживается за O(ширина) с уровня, у которого блок
+ *  не превышает число значений на колонку.
+ */
+class SpectrumPyramid
+{
+public:
+    /*!
+     *  \brief Строит все уровни по значениям кадра.
+     *  \param[in] bins Значения спектра.
+     *  \param[in] count Количество значений.
+     */
+    void build(const float *bins, int count);
+
+    /*!
+     *  \brief Пересчитывает только блоки, затронутые изменением [firstBin, lastBin).
+     *  \param[in] bins Значения спектра (уже обновленные).
+     *  \param[in] count Количество значений (должно совпадать с build()).
+     *  \param[in] firstBin Первое измененное значение.
+     *  \param[in] lastBin Значение за последним измененным.
+     */
+    void update(const float *bins, int count, int firstBin, int lastBin);
+
+    //! \brief Сбрасывает все уровни.
+    void clear();
+    //! \brief Помечает пирамиду непостроенной, сохраняя память уровней для следующего build().
+    void invalidate() noexcept { m_binCount = 0; }
+
+    //! \brief Возвращает число хранимых уровней (без уровня 0).
+    int levelCount() const noexcept { return static_cast<int>(m_levels.size()); }
+    //! \brief Возвращает число значений, по которым построена пирамида.
+    int binCount() const noexcept { return m_binCount; }
+
+    /*!
+     *  \brief Сводит диапазон значений [firstBin, lastBin) к парам min/max.
+     *
+     *  Границы колонок округляются наружу до блоков выбранного уровня, т.е.
+     *  колонка может захватить меньше одного блока соседних значений.
+     *  Колонки вне кадра заполняются парой (+inf, -inf).
+     *
+     *  \param[in] bins Значения спектра (уровень 0).
+     *  \param[in] firstBin Дробная позиция начала диапазона в отсчетах.
+     *  \param[in] lastBin Дробная позиция конца диапазона в отсчетах.
+     *  \param[in] width Количество колонок.
+     *  \param[out] out Буфер на 2 * width значений вида [min0, max0, ...].
+     */
+    void query(const float *bins, double firstBin, double lastBin, int width, float *out) const;
+
+    /*!
+     *  \brief Как query(), но вычисляет только колонки [firstColumn, lastColumn).
+     *  \param[in] bins Значения спектра (уровень 0).
+     *  \param[in] firstBin Дробная позиция начала диапазона в отсчетах.
+     *  \param[in] lastBin Дробная позиция конца диапазона в отсчетах.
+     *  \param[in] width Общее количество колонок.
+     *  \param[in] firstColumn Первая вычисляемая колонка.
+     *  \param[in] lastColumn Колонка за последней вычисляемой.
+     *  \param[out] out Буфер на 2 * width значений; заполняются только колонки диапазона.
+     */
+    void query(const float *bins, double firstBin, double lastBin, int width,
+               int firstColumn, int lastColumn, float *out) const;
+
+private:
+    //! \brief Уровни 1..N: пары [min, max] по блокам 2^k значений.
+    std::vector<std::vector<float>> m_levels;
+    //! \brief Количество значений уровня 0.
+    int m_binCount = 0;
+};
+
+#endif // SPECTRUMPYRAMID_H
@@ -0,0 +1,98 @@
+/*!
+ *  \file spscqueue.h
+ *  \brief Lock-free очередь фиксированной емкости для одного писателя и одного читателя.
+ */
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*!
+ *  \class SpscQueue
+ *  \brief Кольцевая очередь без блокировок для передачи значений между двумя потоками.
+ *
+ *  В отличие от LatestValueSlot очередь сохраняет все значения по порядку.
+ *  Писатель и читатель владеют каждый своим индексом; индексы разнесены по
+ *  разным строкам кэша. Если очередь заполнена, tryPush() сразу возвращает
+ *  false — писатель никогда не ждет читателя.
+ *
+ *  \tparam T Тип значения; должен быть конструируемым по умолчанию и перемещаемым.
+ *  \tparam Capacity Емкость очереди (степень двойки).
+ */
+template <typename T, std::size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    //! \brief Возвращает емкость очереди.
+    static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+    /*!
+     *  \brief Добавляет значение в конец очереди (только поток писателя).
+     *  \param[in] value Значение.
+     *  \return false, если очередь заполнена.
+     */
+    template <typename U>
+    bool tryPush(U &&value)
+    {
+        const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead >= Capacity) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead >= Capacity) {
+                return false;
+            }
+        }
+        m_items[tail & kMask] = std::forward<U>(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*!
+     *  \brief Забирает значение из начала очереди (только поток читателя).
+     *  \param[out] value Значение.
+     *  \return false, если очередь пуста.
+     */
+    bool tryPop(T &value)
+    {
+        const std::size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail) {
+                return false;
+            }
+        }
+        // Ячейка освобождается сразу, чтобы не удерживать разделяемые данные.
+        value = std::exchange(m_items[head & kMask], T());
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Возвращает приблизительное число значений в очереди (любой поток).
+    std::size_t sizeApprox() const noexcept
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    //! \brief Маска индекса ячейки.
+    static constexpr std::size_t kMask = Capacity - 1;
+    //! \brief Размер строки кэша, на который разносятся индексы.
+    static constexpr std::size_t kCacheLine = 64;
+
+    //! \brief Ячейки очереди.
+    std::array<T, Capacity> m_items{};
+    //! \brief Индекс следующего читаемого значения (пишет читатель).
+    alignas(kCacheLine) std::atomic<std::size_t> m_head{0};
+    //! \brief Последний увиденный читателем индекс записи.
+    std::size_t m_cachedTail = 0;
+    //! \brief Индекс следующей записи (пишет писатель).
+    alignas(kCacheLine) std::atomic<std::size_t> m_tail{0};
+    //! \brief Последний увиденный писателем индекс чтения.
+    std::size_t m_cachedHead = 0;
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,159 @@
+/*!
+ *  \file streamformat.h
+ *  \brief Пакеты потока данных РПУ и кольцевой буфер разделяемой памяти.
+ *
+ *  Поток состоит из пакетов:
+ *  \code
+ *  пакет: [PacketHeader, kPacketHeaderBytes][payloadBytes байт данных]
+ *  \endcode
+ *
+ *  Пакет Samples несет подряд идущие отсчеты I/Q (пары float32), пакет
+ *  Spectrum — фрагмент кадра спектра (значения float32, дБ). Кадр
+ *  передается fragmentCount фрагментами; все фрагменты, кроме последнего,
+ *  имеют одинаковый размер, смещение фрагмента — fragmentIndex на этот
+ *  размер. Номер пакета sequence сквозной для потока и увеличивается на
+ *  единицу, что позволяет обнаруживать потери и перестановки. Отсчеты
+ *  одного потока передаются пакетами одного размера, кроме, возможно,
+ *  последнего пакета блока.
+ *
+ *  Через UDP каждый пакет — одна датаграмма. Через разделяемую память
+ *  пакеты идут записями кольцевого буфера:
+ *  \code
+ *  [RingHeader, kRingHeaderBytes][кольцо capacityBytes]
+ *  запись: [PacketHeader][данные][выравнивание до kRecordAlignment]
+ *  \endcode
+ *
+ *  Запись никогда не пересекает конец кольца: если она не помещается,
+ *  писатель закрывает хвост пакетом Padding (или оставляет хвост короче
+ *  заголовка пустым) и пишет запись с начала кольца. Индексы записи и
+ *  чтения монотонно растут в байтах; писатель не затирает непрочитанные
+ *  записи. Кольцо рассчитано на одного писателя и одного читателя. Поля
+ *  хранятся в порядке байтов платформы (little-endian на всех целевых).
+ */
+#ifndef STREAMFORMAT_H
+#define STREAMFORMAT_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <type_traits>
+
+namespace StreamFormat {
+
+//! \brief Сигнатура пакета ("SRPU").
+constexpr quint32 kPacketMagic = 0x55505253u;
+//! \brief Сигнатура кольцевого буфера ("SRNG").
+constexpr quint32 kRingMagic = 0x474E5253u;
+//! \brief Версия формата.
+constexpr quint16 kVersion = 1;
+
+//! \brief Размер заголовка пакета, байты.
+constexpr int kPacketHeaderBytes = 72;
+//! \brief Наибольший размер данных пакета UDP, байты.
+constexpr int kMaxDatagramPayloadBytes = 8192;
+//! \brief Наибольший размер кадра спектра, байты.
+constexpr quint32 kMaxFrameBytes = quint32(16) << 20;
+//! \brief Размер области заголовка кольцевого буфера.
+constexpr qint64 kRingHeaderBytes = 256;
+//! \brief Выравнивание записей кольцевого буфера.
+constexpr qint64 kRecordAlignment = 8;
+
+//! \brief Тип пакета.
+enum class PacketType : quint16 {
+    //! \brief Отсчеты I/Q.
+    Samples = 1,
+    //! \brief Фрагмент кадра спектра.
+    Spectrum = 2,
+    //! \brief Заполнитель хвоста кольцевого буфера.
+    Padding = 3
+};
+
+//! \brief Заголовок пакета.
+struct PacketHeader
+{
+    //! \brief Сигнатура kPacketMagic.
+    quint32 magic;
+    //! \brief Версия формата.
+    quint16 version;
+    //! \brief Тип пакета (PacketType).
+    quint16 type;
+    //! \brief Сквозной номер пакета потока.
+    quint32 sequence;
+    //! \brief Размер данных пакета, байты.
+    quint32 payloadBytes;
+    //! \brief Номер кадра спектра или блока отсчетов.
+    quint64 frameSequence;
+    //! \brief Номер фрагмента в кадре.
+    quint32 fragmentIndex;
+    //! \brief Количество фрагментов кадра.
+    quint32 fragmentCount;
+    //! \brief Смещение фрагмента от начала кадра, байты.
+    quint32 fragmentOffset;
+    //! \brief Размер кадра, байты.
+    quint32 frameBytes;
+    //! \brief Время формирования данных, мкс от начала эпохи.
+    qint64 timestampUs;
+    //! \brief Нижняя граница полосы, Гц (для отсчетов — центр минус половина частоты дискретизации).
+    double minHz;
+    //! \brief Верхняя граница полосы, Гц.
+    double maxHz;
+    //! \brief Нижняя граница шкалы кадра спектра, дБ.
+    float minDb;
+    //! \brief Верхняя граница шкалы кадра спектра, дБ.
+    float maxDb;
+};
+
+//! \brief Заголовок кольцевого буфера разделяемой памяти.
+struct RingHeader
+{
+    //! \brief Сигнатура kRingMagic (записывается последней при создании).
+    std::atomic<quint32> magic;
+    //! \brief Версия формата.
+    quint32 version;
+    //! \brief Размер кольца, байты (степень двойки).
+    quint64 capacityBytes;
+    //! \brief Позиция записи, байты от начала потока (только писатель).
+    alignas(64) std::atomic<quint64> writeIndex;
+    //! \brief Позиция чтения, байты от начала потока (только читатель).
+    alignas(64) std::atomic<quint64> readIndex;
+    //! \brief Число пакетов, не записанных из-за переполнения кольца.
+    alignas(64) std::atomic<quint64> droppedPackets;
+};
+
+static_assert(sizeof(PacketHeader) == kPacketHeaderBytes, "PacketHeader layout changed");
+static_assert(kPacketHeaderBytes % kRecordAlignment == 0, "Records must stay aligned after the header");
+static_assert(std::is_trivially_copyable<PacketHeader>::value, "PacketHeader is copied as raw bytes");
+static_assert(sizeof(RingHeader) <= kRingHeaderBytes, "RingHeader does not fit its area");
+static_assert(std::atomic<quint64>::is_always_lock_free && std::atomic<quint32>::is_always_lock_free,
+              "Ring indices are shared between processes and must be lock-free");
+
+//! \brief Возвращает размер записи кольца для данных пакета, байты.
+constexpr qint64 ringRecordBytes(qint64 payloadBytes) noexcept
+{
+    return (kPacketHeaderBytes + payloadBytes + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+//! \brief Проверяет заголовок пакета: сигнатуру, версию и согласованность полей фрагмента.
+inline bool isValid(const PacketHeader &header) noexcept
+{
+    if (header.magic != kPacketMagic || header.version != kVersion) {
+        return false;
+    }
+    switch (static_cast<PacketType>(header.type)) {
+    case PacketType::Samples:
+        return header.payloadBytes % (2 * sizeof(float)) == 0;
+    case PacketType::Spectrum:
+        return header.frameBytes > 0 && header.frameBytes <= kMaxFrameBytes
+            && header.frameBytes % sizeof(float) == 0 && header.fragmentIndex < header.fragmentCount
+            && header.fragmentOffset % sizeof(float) == 0 && header.fragmentOffset < header.frameBytes
+            && header.payloadBytes > 0 && header.payloadBytes % sizeof(float) == 0
+            && header.payloadBytes <= header.frameBytes - header.fragmentOffset;
+    case PacketType::Padding:
+        return true;
+    }
+    return false;
+}
+
+} // namespace StreamFormat
+
+#endif // STREAMFORMAT_H
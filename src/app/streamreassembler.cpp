@@ -0,0 +1,463 @@
+/*!
+ *  \file streamreassembler.cpp
+ *  \brief Реализация StreamIqSource и StreamReassembler.
+ */
+#include "streamreassembler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace StreamFormat;
+
+namespace {
+
+//! \brief Размер отсчета I/Q, байты.
+constexpr int kSampleBytes = static_cast<int>(sizeof(std::complex<float>));
+//! \brief Наименьшая емкость кольца отсчетов.
+constexpr int kMinSampleCapacity = 1 << 12;
+//! \brief Отставание номера пакета, после которого поток считается перезапущенным.
+constexpr qint32 kSequenceResyncWindow = 1 << 16;
+//! \brief Отставание номера кадра, после которого поток считается перезапущенным.
+constexpr qint64 kFrameResyncWindow = 1024;
+
+} // namespace
+
+/*!
+ *  \brief Конструирует источник.
+ *  \param[in] sampleCapacity Емкость кольца отсчетов.
+ *  \param[in] frameBufferCount Количество буферов пула кадров спектра.
+ */
+StreamIqSource::StreamIqSource(int sampleCapacity, int frameBufferCount)
+    : m_framePool(frameBufferCount)
+{
+    int capacity = kMinSampleCapacity;
+    while (capacity < sampleCapacity && capacity < (1 << 30)) {
+        capacity <<= 1;
+    }
+    m_samples.resize(static_cast<size_t>(capacity));
+}
+
+//! \brief Возвращает частоту дискретизации потока отсчетов, Гц (0, пока отсчетов не было).
+double StreamIqSource::sampleRateHz() const
+{
+    return m_maxHz.load(std::memory_order_relaxed) - m_minHz.load(std::memory_order_relaxed);
+}
+
+//! \brief Возвращает центральную частоту потока отсчетов, Гц.
+double StreamIqSource::centerHz() const
+{
+    return 0.5 * (m_minHz.load(std::memory_order_relaxed) + m_maxHz.load(std::memory_order_relaxed));
+}
+
+/*!
+ *  \brief Читает отсчеты из кольца.
+ *  \param[out] out Буфер на count отсчетов.
+ *  \param[in] count Запрошенное количество.
+ *  \return Количество прочитанных отсчетов (0 — данных нет).
+ */
+int StreamIqSource::read(std::complex<float> *out, int count)
+{
+    const quint64 capacity = m_samples.size();
+    const quint64 write = m_writeIndex.load(std::memory_order_acquire);
+    quint64 read = m_readIndex.load(std::memory_order_relaxed);
+    if (write - read > capacity / 2) {
+        const quint64 fresh = write - capacity / 4;
+        m_skippedSamples.fetch_add(fresh - read, std::memory_order_relaxed);
+        read = fresh;
+    }
+
+    const int available = static_cast<int>(qMin<quint64>(static_cast<quint64>(qMax(0, count)), write - read));
+    const size_t offset = static_cast<size_t>(read & (capacity - 1));
+    const int first = static_cast<int>(qMin<quint64>(static_cast<quint64>(available), capacity - offset));
+    std::copy_n(m_samples.data() + offset, first, out);
+    std::copy_n(m_samples.data(), available - first, out + first);
+    m_readIndex.store(read + static_cast<quint64>(available), std::memory_order_release);
+    return available;
+}
+
+/*!
+ *  \brief Забирает последний собранный кадр спектра (поток DSP).
+ *  \param[out] frame Кадр, если он появился с прошлого вызова.
+ *  \return true, если получен новый кадр.
+ */
+bool StreamIqSource::takeSpectrum(SpectrumFrame &frame)
+{
+    if (!m_frames.consume()) {
+        return false;
+    }
+    // Кадр забирается из слота, а не копируется: у потребителя он остается
+    // единственным владельцем буфера и изменяется без копирования.
+    std::swap(frame, m_frames.readBuffer());
+    return frame.isValid();
+}
+
+//! \brief Возвращает число свободных отсчетов кольца.
+qint64 StreamIqSource::freeSamples() const noexcept
+{
+    const quint64 used = m_writeIndex.load(std::memory_order_relaxed) - m_readIndex.load(std::memory_order_acquire);
+    return static_cast<qint64>(m_samples.size() - used);
+}
+
+//! \brief Делает записанные отсчеты доступными читателю.
+void StreamIqSource::commitSamples(int count) noexcept
+{
+    m_writeIndex.store(m_writeIndex.load(std::memory_order_relaxed) + static_cast<quint64>(count),
+                       std::memory_order_release);
+}
+
+/*!
+ *  \brief Задает полосу отсчетов.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+void StreamIqSource::setBand(double minHz, double maxHz) noexcept
+{
+    // Полоса меняется редко: запись только при изменении не гоняет строку кэша.
+    if (m_minHz.load(std::memory_order_relaxed) != minHz) {
+        m_minHz.store(minHz, std::memory_order_relaxed);
+    }
+    if (m_maxHz.load(std::memory_order_relaxed) != maxHz) {
+        m_maxHz.store(maxHz, std::memory_order_relaxed);
+    }
+}
+
+//! \brief Публикует собранный кадр спектра.
+void StreamIqSource::publishSpectrum(SpectrumFrame frame)
+{
+    m_frames.writeBuffer() = std::move(frame);
+    m_frames.publish();
+}
+
+/*!
+ *  \brief Конструирует сборщик.
+ *  \param[in] sink Источник, в который собираются данные.
+ */
+StreamReassembler::StreamReassembler(std::shared_ptr<StreamIqSource> sink)
+    : m_sink(std::move(sink))
+{
+}
+
+//! \brief Возвращает снимок счетчиков.
+StreamReassembler::Statistics StreamReassembler::statistics() const noexcept
+{
+    Statistics stats;
+    stats.packets = m_packets.load(std::memory_order_relaxed);
+    stats.payloadBytes = m_payloadBytes.load(std::memory_order_relaxed);
+    stats.lostPackets = m_lostPackets.load(std::memory_order_relaxed);
+    stats.reorderedPackets = m_reorderedPackets.load(std::memory_order_relaxed);
+    stats.malformedPackets = m_malformedPackets.load(std::memory_order_relaxed);
+    stats.duplicateFragments = m_duplicateFragments.load(std::memory_order_relaxed);
+    stats.lateFragments = m_lateFragments.load(std::memory_order_relaxed);
+    stats.completedFrames = m_completedFrames.load(std::memory_order_relaxed);
+    stats.incompleteFrames = m_incompleteFrames.load(std::memory_order_relaxed);
+    stats.placedPackets = m_placedPackets.load(std::memory_order_relaxed);
+    stats.droppedSamples = m_droppedSamples.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/*!
+ *  \brief Принимает пакет, данные которого лежат подряд.
+ *  \param[in] header Заголовок пакета.
+ *  \param[in] payload Данные пакета.
+ *  \param[in] payloadBytes Фактический размер данных, байты (отрицательный — пакет обрезан).
+ */
+void StreamReassembler::accept(const PacketHeader &header, const char *payload, int payloadBytes)
+{
+    bump(m_packets);
+    if (payloadBytes < 0 || static_cast<quint32>(payloadBytes) != header.payloadBytes || !isValid(header)) {
+        bump(m_malformedPackets);
+        return;
+    }
+    bump(m_payloadBytes, static_cast<quint64>(payloadBytes));
+
+    if (m_hasSequence) {
+        const qint32 delta = static_cast<qint32>(header.sequence - m_nextSequence);
+        if (delta >= 0) {
+            bump(m_lostPackets, static_cast<quint64>(delta));
+            m_nextSequence = header.sequence + 1;
+        } else if (delta > -kSequenceResyncWindow) {
+            // Пакет, учтенный потерянным, все же пришел.
+            bump(m_reorderedPackets);
+            const quint64 lost = m_lostPackets.load(std::memory_order_relaxed);
+            if (lost > 0) {
+                m_lostPackets.store(lost - 1, std::memory_order_relaxed);
+            }
+        } else {
+            m_nextSequence = header.sequence + 1;
+        }
+    } else {
+        m_hasSequence = true;
+        m_nextSequence = header.sequence + 1;
+    }
+
+    switch (static_cast<PacketType>(header.type)) {
+    case PacketType::Samples:
+        acceptSamples(header, payload, payloadBytes);
+        break;
+    case PacketType::Spectrum:
+        acceptSpectrum(header, payload, payloadBytes);
+        break;
+    case PacketType::Padding:
+        break;
+    }
+}
+
+/*!
+ *  \brief Предсказывает места данных следующих пакетов.
+ *  \param[in,out] batch Слоты.
+ *  \param[in] count Количество слотов.
+ */
+void StreamReassembler::predict(Slot *batch, int count)
+{
+    int k = 0;
+    if (m_expect == Expect::Samples && m_samplePacketBytes > 0 && m_samplePacketBytes <= kMaxDatagramPayloadBytes) {
+        // Следующие пакеты отсчетов ложатся в кольцо подряд за позицией записи.
+        const qint64 packetSamples = m_samplePacketBytes / kSampleBytes;
+        const qint64 capacity = m_sink->sampleCapacity();
+        const qint64 freeSamples = m_sink->freeSamples();
+        const qint64 offset = static_cast<qint64>(m_sink->sampleWriteIndex() & static_cast<quint64>(capacity - 1));
+        for (; k < count; ++k) {
+            const qint64 begin = offset + k * packetSamples;
+            if (begin + packetSamples > capacity || (k + 1) * packetSamples > freeSamples) {
+                break;
+            }
+            batch[k].predicted = reinterpret_cast<char *>(m_sink->sampleData() + begin);
+            batch[k].predictedBytes = m_samplePacketBytes;
+        }
+    } else if (m_expect == Expect::Spectrum && m_fragmentBytes > 0
+               && m_fragmentBytes <= static_cast<quint32>(kMaxDatagramPayloadBytes)) {
+        // Фрагменты текущего кадра после последнего принятого...
+        bool frameEnded = !m_frameData;
+        for (quint64 offset = m_nextOffset; m_frameData && k < count; ++k, offset += m_fragmentBytes) {
+            if (offset >= m_frameBytes) {
+                frameEnded = true;
+                break;
+            }
+            if (offset % m_fragmentBytes != 0 || hasFragment(static_cast<quint32>(offset / m_fragmentBytes))) {
+                break;
+            }
+            batch[k].predicted = m_frameData + offset;
+            batch[k].predictedBytes = static_cast<int>(qMin<quint64>(m_fragmentBytes, m_frameBytes - offset));
+        }
+        // ...и начало следующего кадра того же размера в запасном буфере.
+        if (frameEnded && k < count) {
+            const int binCount = static_cast<int>(m_frameBytes / sizeof(float));
+            if (m_spareFrame.binCount() != binCount) {
+                m_spareFrame = m_sink->framePool().acquire(binCount);
+                m_spareData = reinterpret_cast<char *>(m_spareFrame.bins());
+            }
+            for (quint64 offset = 0; k < count && offset < m_frameBytes; ++k, offset += m_fragmentBytes) {
+                batch[k].predicted = m_spareData + offset;
+                batch[k].predictedBytes = static_cast<int>(qMin<quint64>(m_fragmentBytes, m_frameBytes - offset));
+            }
+        }
+    }
+    for (; k < count; ++k) {
+        batch[k].predicted = nullptr;
+        batch[k].predictedBytes = 0;
+    }
+}
+
+/*!
+ *  \brief Принимает пакеты, полученные по слотам predict().
+ *  \param[in] headers Заголовки пакетов.
+ *  \param[in] payloadBytes Фактические размеры данных пакетов, байты.
+ *  \param[in,out] batch Слоты пакетов.
+ *  \param[in] count Количество пакетов.
+ */
+void StreamReassembler::acceptBatch(const PacketHeader *headers, const int *payloadBytes, Slot *batch, int count)
+{
+    bool evacuated = false;
+    for (int k = 0; k < count; ++k) {
+        const char *payload = batch[k].scratch;
+        if (!evacuated && batch[k].predicted) {
+            if (payloadBytes[k] <= batch[k].predictedBytes
+                && destination(headers[k], payloadBytes[k]) == batch[k].predicted) {
+                payload = batch[k].predicted;
+            } else {
+                // Предсказание не сбылось: место этого пакета может оказаться
+                // местом данных следующих, поэтому все оставшиеся предсказанные
+                // данные сначала переносятся в запасные буферы.
+                for (int j = k; j < count && batch[j].predicted; ++j) {
+                    const int bytes = qBound(0, payloadBytes[j], batch[j].predictedBytes);
+                    std::memcpy(batch[j].scratch, batch[j].predicted, static_cast<size_t>(bytes));
+                }
+                evacuated = true;
+            }
+        }
+        accept(headers[k], payload, payloadBytes[k]);
+    }
+}
+
+/*!
+ *  \brief Возвращает место данных пакета при текущем состоянии или nullptr.
+ *  \param[in] header Заголовок пакета.
+ *  \param[in] payloadBytes Фактический размер данных, байты.
+ */
+char *StreamReassembler::destination(const PacketHeader &header, int payloadBytes) const
+{
+    if (payloadBytes <= 0 || static_cast<quint32>(payloadBytes) != header.payloadBytes || !isValid(header)) {
+        return nullptr;
+    }
+    switch (static_cast<PacketType>(header.type)) {
+    case PacketType::Samples: {
+        const qint64 count = payloadBytes / kSampleBytes;
+        const qint64 capacity = m_sink->sampleCapacity();
+        const qint64 offset = static_cast<qint64>(m_sink->sampleWriteIndex() & static_cast<quint64>(capacity - 1));
+        if (m_sink->freeSamples() < count || offset + count > capacity) {
+            return nullptr;
+        }
+        return reinterpret_cast<char *>(m_sink->sampleData() + offset);
+    }
+    case PacketType::Spectrum:
+        if (m_frameData && header.frameSequence == m_frameSequence) {
+            if (header.frameBytes != m_frameBytes || header.fragmentCount != m_fragmentCount
+                || hasFragment(header.fragmentIndex)) {
+                return nullptr;
+            }
+            return m_frameData + header.fragmentOffset;
+        }
+        if (m_spareData && header.frameBytes == static_cast<quint32>(m_spareFrame.binCount()) * sizeof(float)
+            && (!m_hasFrameSequence || static_cast<qint64>(header.frameSequence - m_frameSequence) > 0)
+            && header.fragmentCount <= header.frameBytes / sizeof(float)) {
+            return m_spareData + header.fragmentOffset;
+        }
+        return nullptr;
+    case PacketType::Padding:
+        break;
+    }
+    return nullptr;
+}
+
+/*!
+ *  \brief Принимает отсчеты.
+ *  \param[in] header Заголовок пакета.
+ *  \param[in] payload Данные пакета.
+ *  \param[in] payloadBytes Размер данных, байты.
+ */
+void StreamReassembler::acceptSamples(const PacketHeader &header, const char *payload, int payloadBytes)
+{
+    m_expect = Expect::Samples;
+    m_samplePacketBytes = payloadBytes;
+    m_sink->setBand(header.minHz, header.maxHz);
+
+    const int count = payloadBytes / kSampleBytes;
+    if (count == 0) {
+        return;
+    }
+    if (m_sink->freeSamples() < count) {
+        bump(m_droppedSamples, static_cast<quint64>(count));
+        return;
+    }
+
+    const qint64 capacity = m_sink->sampleCapacity();
+    const qint64 offset = static_cast<qint64>(m_sink->sampleWriteIndex() & static_cast<quint64>(capacity - 1));
+    char *target = reinterpret_cast<char *>(m_sink->sampleData() + offset);
+    if (target == payload) {
+        bump(m_placedPackets);
+    } else {
+        const qint64 first = qMin<qint64>(count, capacity - offset);
+        std::memcpy(target, payload, static_cast<size_t>(first * kSampleBytes));
+        std::memcpy(m_sink->sampleData(), payload + first * kSampleBytes,
+                    static_cast<size_t>((count - first) * kSampleBytes));
+    }
+    m_sink->commitSamples(count);
+}
+
+/*!
+ *  \brief Принимает фрагмент кадра спектра.
+ *  \param[in] header Заголовок пакета.
+ *  \param[in] payload Данные пакета.
+ *  \param[in] payloadBytes Размер данных, байты.
+ */
+void StreamReassembler::acceptSpectrum(const PacketHeader &header, const char *payload, int payloadBytes)
+{
+    m_expect = Expect::Spectrum;
+    if (!m_frameData || header.frameSequence != m_frameSequence) {
+        const qint64 delta = static_cast<qint64>(header.frameSequence - m_frameSequence);
+        if (m_hasFrameSequence && delta <= 0 && delta > -kFrameResyncWindow) {
+            bump(m_lateFragments);
+            return;
+        }
+        if (m_frameData) {
+            bump(m_incompleteFrames);
+        }
+        if (!beginFrame(header)) {
+            bump(m_malformedPackets);
+            return;
+        }
+    } else if (header.frameBytes != m_frameBytes || header.fragmentCount != m_fragmentCount) {
+        bump(m_malformedPackets);
+        return;
+    }
+
+    const quint32 index = header.fragmentIndex;
+    if (hasFragment(index)) {
+        bump(m_duplicateFragments);
+        return;
+    }
+    char *target = m_frameData + header.fragmentOffset;
+    if (target == payload) {
+        bump(m_placedPackets);
+    } else {
+        std::memcpy(target, payload, static_cast<size_t>(payloadBytes));
+    }
+    m_received[index / 64] |= quint64(1) << (index % 64);
+    ++m_receivedFragments;
+    m_nextOffset = header.fragmentOffset + static_cast<quint32>(payloadBytes);
+
+    if (m_receivedFragments == m_fragmentCount) {
+        bump(m_completedFrames);
+        m_frameData = nullptr;
+        m_sink->publishSpectrum(std::exchange(m_frame, SpectrumFrame()));
+    }
+}
+
+/*!
+ *  \brief Начинает сборку кадра.
+ *  \param[in] header Заголовок первого принятого фрагмента кадра.
+ *  \return false, если описание кадра недопустимо.
+ */
+bool StreamReassembler::beginFrame(const PacketHeader &header)
+{
+    m_frameData = nullptr;
+    m_frame = SpectrumFrame();
+    if (header.fragmentCount > header.frameBytes / sizeof(float)) {
+        return false;
+    }
+
+    const int binCount = static_cast<int>(header.frameBytes / sizeof(float));
+    if (m_spareFrame.binCount() == binCount) {
+        m_frame = std::exchange(m_spareFrame, SpectrumFrame());
+        m_spareData = nullptr;
+    } else {
+        m_frame = m_sink->framePool().acquire(binCount);
+    }
+    m_frame.setSpan(header.minHz, header.maxHz);
+    m_frame.setDbRange(header.minDb, header.maxDb);
+    m_frame.setTimestampUs(header.timestampUs);
+    m_frameData = reinterpret_cast<char *>(m_frame.bins());
+
+    m_hasFrameSequence = true;
+    m_frameSequence = header.frameSequence;
+    m_frameBytes = header.frameBytes;
+    m_fragmentCount = header.fragmentCount;
+    m_fragmentBytes = header.fragmentIndex > 0 ? header.fragmentOffset / header.fragmentIndex : header.payloadBytes;
+    m_received.assign((m_fragmentCount + 63) / 64, 0);
+    m_receivedFragments = 0;
+    m_nextOffset = header.fragmentOffset;
+    return true;
+}
+
+//! \brief Проверяет, принят ли фрагмент текущего кадра.
+bool StreamReassembler::hasFragment(quint32 index) const noexcept
+{
+    return index < m_fragmentCount && (m_received[index / 64] & (quint64(1) << (index % 64))) != 0;
+}
+
+//! \brief Увеличивает счетчик (пишет только поток приема).
+void StreamReassembler::bump(std::atomic<quint64> &counter, quint64 value) noexcept
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
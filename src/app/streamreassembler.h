@@ -0,0 +1,280 @@
+/*!
+ *  \file streamreassembler.h
+ *  \brief Сборка пакетов потока РПУ в кадры спектра и поток отсчетов I/Q.
+ */
+#ifndef STREAMREASSEMBLER_H
+#define STREAMREASSEMBLER_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <complex>
+#include <memory>
+#include <vector>
+
+#include "alignedallocator.h"
+#include "iqsource.h"
+#include "latestvalueslot.h"
+#include "spectrumframe.h"
+#include "spectrumframepool.h"
+#include "streamformat.h"
+
+/*!
+ *  \class StreamIqSource
+ *  \brief Источник данных потока РПУ для движка спектра.
+ *
+ *  Отсчеты I/Q приемник пакетов пишет в кольцо отсчетов, движок читает их
+ *  через read(); готовые кадры спектра передаются через LatestValueSlot и
+ *  выдаются движку takeSpectrum() в обход БПФ. Кольцо рассчитано на
+ *  одного писателя (поток приема) и одного читателя (поток DSP). Если
+ *  читатель отстал больше чем на половину кольца, старые отсчеты
+ *  пропускаются: спектр строится по свежим данным, а задержка ограничена.
+ */
+class StreamIqSource : public IqSource
+{
+public:
+    //! \brief Емкость кольца отсчетов по умолчанию.
+    static constexpr int kDefaultSampleCapacity = 1 << 21;
+
+    /*!
+     *  \brief Конструирует источник.
+     *  \param[in] sampleCapacity Емкость кольца отсчетов (округляется вверх до степени двойки).
+     *  \param[in] frameBufferCount Количество буферов пула кадров спектра.
+     */
+    explicit StreamIqSource(int sampleCapacity = kDefaultSampleCapacity,
+                            int frameBufferCount = SpectrumFramePool::kDefaultBufferCount);
+
+    double sampleRateHz() const override;
+    double centerHz() const override;
+    int read(std::complex<float> *out, int count) override;
+    bool takeSpectrum(SpectrumFrame &frame) override;
+
+    //! \brief Возвращает число отсчетов, пропущенных читателем из-за отставания.
+    quint64 skippedSamples() const noexcept { return m_skippedSamples.load(std::memory_order_relaxed); }
+
+    //! \brief Возвращает емкость кольца отсчетов.
+    qint64 sampleCapacity() const noexcept { return static_cast<qint64>(m_samples.size()); }
+    //! \brief Возвращает начало кольца отсчетов (поток приема).
+    std::complex<float> *sampleData() noexcept { return m_samples.data(); }
+    //! \brief Возвращает позицию записи в кольце, отсчеты от начала потока (поток приема).
+    quint64 sampleWriteIndex() const noexcept { return m_writeIndex.load(std::memory_order_relaxed); }
+    //! \brief Возвращает число свободных отсчетов кольца (поток приема).
+    qint64 freeSamples() const noexcept;
+    //! \brief Делает записанные отсчеты доступными читателю (поток приема).
+    void commitSamples(int count) noexcept;
+    /*!
+     *  \brief Задает полосу отсчетов (поток приема).
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     */
+    void setBand(double minHz, double maxHz) noexcept;
+
+    //! \brief Возвращает пул буферов кадров спектра.
+    SpectrumFramePool &framePool() noexcept { return m_framePool; }
+    //! \brief Публикует собранный кадр спектра (поток приема).
+    void publishSpectrum(SpectrumFrame frame);
+
+private:
+    //! \brief Кольцо отсчетов.
+    std::vector<std::complex<float>, AlignedAllocator<std::complex<float>>> m_samples;
+    //! \brief Позиция записи, отсчеты от начала потока.
+    alignas(64) std::atomic<quint64> m_writeIndex{0};
+    //! \brief Позиция чтения, отсчеты от начала потока.
+    alignas(64) std::atomic<quint64> m_readIndex{0};
+    //! \brief Число отсчетов, пропущенных читателем.
+    std::atomic<quint64> m_skippedSamples{0};
+    //! \brief Нижняя граница полосы отсчетов, Гц.
+    std::atomic<double> m_minHz{0.0};
+    //! \brief Верхняя граница полосы отсчетов, Гц.
+    std::atomic<double> m_maxHz{0.0};
+    //! \brief Пул буферов кадров спектра (объявлен до слота: кадры слота отпускаются первыми).
+    SpectrumFramePool m_framePool;
+    //! \brief Слот собранных кадров спектра (поток приема -> DSP).
+    LatestValueSlot<SpectrumFrame> m_frames;
+};
+
+/*!
+ *  \class StreamReassembler
+ *  \brief Раскладывает пакеты потока по кадрам спектра и кольцу отсчетов.
+ *
+ *  Фрагменты кадра спектра пишутся прямо в буфер кадра из пула
+ *  StreamIqSource, отсчеты — прямо в кольцо отсчетов; промежуточных
+ *  копий нет. Для приема пакетами (recvmmsg) predict() заранее сообщает,
+ *  куда лягут данные следующих пакетов, если поток идет по порядку:
+ *  ядро кладет их сразу на место, и acceptBatch() только отмечает их
+ *  принятыми. При расхождении (потеря, перестановка, смена типа пакета,
+ *  граница кадра) данные оставшихся пакетов пакета приема переносятся в
+ *  их запасные буферы и копируются на место обычным путем.
+ *
+ *  По сквозному номеру пакетов считаются потери и перестановки. Кадр, не
+ *  собранный к приходу фрагмента следующего кадра, отбрасывается.
+ *  Счетчики читаются из любого потока; остальное — только поток приема.
+ */
+class StreamReassembler
+{
+public:
+    //! \brief Счетчики приема.
+    struct Statistics
+    {
+        //! \brief Принятые пакеты.
+        quint64 packets = 0;
+        //! \brief Принятые байты данных.
+        quint64 payloadBytes = 0;
+        //! \brief Пакеты, пропущенные в последовательности номеров.
+        quint64 lostPackets = 0;
+        //! \brief Пакеты, пришедшие позже следующих за ними.
+        quint64 reorderedPackets = 0;
+        //! \brief Пакеты с неверным заголовком.
+        quint64 malformedPackets = 0;
+        //! \brief Повторно принятые фрагменты.
+        quint64 duplicateFragments = 0;
+        //! \brief Фрагменты уже собранных или отброшенных кадров.
+        quint64 lateFragments = 0;
+        //! \brief Собранные кадры спектра.
+        quint64 completedFrames = 0;
+        //! \brief Кадры, отброшенные несобранными.
+        quint64 incompleteFrames = 0;
+        //! \brief Пакеты, данные которых легли на место без копирования.
+        quint64 placedPackets = 0;
+        //! \brief Отсчеты, отброшенные из-за переполнения кольца отсчетов.
+        quint64 droppedSamples = 0;
+    };
+
+    //! \brief Место данных одного пакета в пакете приема.
+    struct Slot
+    {
+        //! \brief Предсказанное место данных или nullptr.
+        char *predicted = nullptr;
+        //! \brief Размер предсказанного места, байты.
+        int predictedBytes = 0;
+        //! \brief Запасной буфер на kMaxDatagramPayloadBytes байт; хвост данных сверх
+        //!        predictedBytes ложится в него со смещением predictedBytes.
+        char *scratch = nullptr;
+    };
+
+    /*!
+     *  \brief Конструирует сборщик.
+     *  \param[in] sink Источник, в который собираются данные.
+     */
+    explicit StreamReassembler(std::shared_ptr<StreamIqSource> sink);
+
+    //! \brief Возвращает источник, в который собираются данные.
+    const std::shared_ptr<StreamIqSource> &sink() const noexcept { return m_sink; }
+    //! \brief Возвращает снимок счетчиков (любой поток).
+    Statistics statistics() const noexcept;
+
+    /*!
+     *  \brief Принимает пакет, данные которого лежат подряд.
+     *  \param[in] header Заголовок пакета.
+     *  \param[in] payload Данные пакета; если они уже на своем месте, копирования нет.
+     *  \param[in] payloadBytes Фактический размер данных, байты.
+     */
+    void accept(const StreamFormat::PacketHeader &header, const char *payload, int payloadBytes);
+
+    /*!
+     *  \brief Предсказывает места данных следующих пакетов.
+     *
+     *  Предсказанные места образуют начало массива: после первого слота без
+     *  предсказания остальные тоже не предсказываются.
+     *
+     *  \param[in,out] batch Слоты; заполняются predicted и predictedBytes.
+     *  \param[in] count Количество слотов.
+     */
+    void predict(Slot *batch, int count);
+    /*!
+     *  \brief Принимает пакеты, полученные по слотам predict().
+     *  \param[in] headers Заголовки пакетов.
+     *  \param[in] payloadBytes Фактические размеры данных пакетов, байты.
+     *  \param[in,out] batch Слоты пакетов.
+     *  \param[in] count Количество пакетов.
+     */
+    void acceptBatch(const StreamFormat::PacketHeader *headers, const int *payloadBytes, Slot *batch, int count);
+
+private:
+    //! \brief Тип последнего принятого пакета.
+    enum class Expect {
+        Nothing,
+        Samples,
+        Spectrum
+    };
+
+    /*!
+     *  \brief Возвращает место данных пакета при текущем состоянии или nullptr.
+     *
+     *  nullptr означает, что пакет требует смены кадра, отбрасывается или
+     *  его данные не лежат подряд в кольце отсчетов.
+     */
+    char *destination(const StreamFormat::PacketHeader &header, int payloadBytes) const;
+    //! \brief Принимает отсчеты.
+    void acceptSamples(const StreamFormat::PacketHeader &header, const char *payload, int payloadBytes);
+    //! \brief Принимает фрагмент кадра спектра.
+    void acceptSpectrum(const StreamFormat::PacketHeader &header, const char *payload, int payloadBytes);
+    //! \brief Начинает сборку кадра; false, если описание кадра недопустимо.
+    bool beginFrame(const StreamFormat::PacketHeader &header);
+    //! \brief Проверяет, принят ли фрагмент текущего кадра.
+    bool hasFragment(quint32 index) const noexcept;
+    //! \brief Увеличивает счетчик (пишет только поток приема).
+    static void bump(std::atomic<quint64> &counter, quint64 value = 1) noexcept;
+
+    //! \brief Источник, в который собираются данные.
+    std::shared_ptr<StreamIqSource> m_sink;
+
+    //! \brief Признак принятого номера пакета.
+    bool m_hasSequence = false;
+    //! \brief Ожидаемый номер следующего пакета.
+    quint32 m_nextSequence = 0;
+    //! \brief Тип последнего принятого пакета.
+    Expect m_expect = Expect::Nothing;
+    //! \brief Размер данных последнего пакета отсчетов, байты.
+    int m_samplePacketBytes = 0;
+
+    //! \brief Собираемый кадр спектра.
+    SpectrumFrame m_frame;
+    //! \brief Начало значений собираемого кадра.
+    char *m_frameData = nullptr;
+    //! \brief Признак номера кадра, собранного или начатого ранее.
+    bool m_hasFrameSequence = false;
+    //! \brief Номер собираемого (или последнего) кадра.
+    quint64 m_frameSequence = 0;
+    //! \brief Размер кадра, байты.
+    quint32 m_frameBytes = 0;
+    //! \brief Количество фрагментов кадра.
+    quint32 m_fragmentCount = 0;
+    //! \brief Размер фрагмента (кроме последнего), байты.
+    quint32 m_fragmentBytes = 0;
+    //! \brief Количество принятых фрагментов.
+    quint32 m_receivedFragments = 0;
+    //! \brief Смещение, следующее за последним принятым фрагментом, байты.
+    quint32 m_nextOffset = 0;
+    //! \brief Битовая карта принятых фрагментов.
+    std::vector<quint64> m_received;
+    //! \brief Запасной буфер следующего кадра, в который предсказываются его первые фрагменты.
+    SpectrumFrame m_spareFrame;
+    //! \brief Начало значений запасного буфера.
+    char *m_spareData = nullptr;
+
+    //! \brief Принятые пакеты.
+    std::atomic<quint64> m_packets{0};
+    //! \brief Принятые байты данных.
+    std::atomic<quint64> m_payloadBytes{0};
+    //! \brief Пропущенные пакеты.
+    std::atomic<quint64> m_lostPackets{0};
+    //! \brief Переставленные пакеты.
+    std::atomic<quint64> m_reorderedPackets{0};
+    //! \brief Пакеты с неверным заголовком.
+    std::atomic<quint64> m_malformedPackets{0};
+    //! \brief Повторные фрагменты.
+    std::atomic<quint64> m_duplicateFragments{0};
+    //! \brief Опоздавшие фрагменты.
+    std::atomic<quint64> m_lateFragments{0};
+    //! \brief Собранные кадры.
+    std::atomic<quint64> m_completedFrames{0};
+    //! \brief Отброшенные несобранные кадры.
+    std::atomic<quint64> m_incompleteFrames{0};
+    //! \brief Пакеты, принятые без копирования.
+    std::atomic<quint64> m_placedPackets{0};
+    //! \brief Отброшенные отсчеты.
+    std::atomic<quint64> m_droppedSamples{0};
+};
+
+#endif // STREAMREASSEMBLER_H
@@ -0,0 +1,191 @@
+/*!
+ *  \file sweepassembler.cpp
+ *  \brief Реализация SweepAssembler.
+ */
+#include "sweepassembler.h"
+
+#include "spectrumframepool.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+//! \brief Значение панорамы, в которое еще не записан ни один сегмент, дБ.
+constexpr float kNoDataDb = -200.0f;
+//! \brief Минимальный вес записи у самого края сегмента.
+constexpr float kMinBlendWeight = 1e-3f;
+
+} // namespace
+
+/*!
+ *  \brief Задает панораму и сбрасывает накопленные данные.
+ *  \param[in] minHz Нижняя граница панорамы, Гц.
+ *  \param[in] maxHz Верхняя граница панорамы, Гц.
+ *  \param[in] binCount Количество значений панорамы.
+ *  \param[in] blendFraction Доля ширины сегмента для плавного перехода у краев.
+ */
+void SweepAssembler::configure(double minHz, double maxHz, int binCount, double blendFraction)
+{
+    m_minHz = minHz;
+    m_maxHz = qMax(minHz, maxHz);
+    m_blendFraction = qBound(0.0, blendFraction, 0.5);
+
+    binCount = qMax(0, binCount);
+    m_frame = m_framePool != nullptr ? m_framePool->acquire(binCount) : SpectrumFrame(binCount);
+    m_frame.setSpan(m_minHz, m_maxHz);
+    m_frame.setLayoutId(SpectrumFrame::allocateLayoutId());
+    std::fill_n(m_frame.bins(), binCount, kNoDataDb);
+    m_frame.rebuildPyramid();
+    m_versions.clear();
+
+    m_binSweep.assign(static_cast<size_t>(binCount), 0);
+    m_binWeight.assign(static_cast<size_t>(binCount), 0.0f);
+    m_sweep = 1;
+    m_covered = 0;
+    m_sweepStartUs = 0;
+    m_lastCompletionUs = -1;
+    m_completedSweeps = 0;
+    m_sweepDurationUs = 0;
+    m_revisitIntervalUs = 0;
+}
+
+/*!
+ *  \brief Пересчитывает сегмент на сетку панорамы и записывает его.
+ *
+ *  Если значение панорамы шире отсчета сегмента, берется максимум покрытых
+ *  отсчетов (пики не теряются), иначе — линейная интерполяция. Повторная
+ *  запись в том же обходе усредняет мощность с весами записей.
+ *
+ *  \param[in] segmentMinHz Нижняя граница сегмента, Гц.
+ *  \param[in] segmentMaxHz Верхняя граница сегмента, Гц.
+ *  \param[in] bins Значения сегмента, дБ.
+ *  \param[in] count Количество значений сегмента.
+ *  \param[in] timestampUs Время получения сегмента, мкс.
+ */
+void SweepAssembler::addSegment(double segmentMinHz, double segmentMaxHz, const float *bins, int count,
+                                qint64 timestampUs)
+{
+    const int panoramaBins = binCount();
+    if (!bins || count <= 0 || segmentMaxHz <= segmentMinHz || panoramaBins <= 0 || m_maxHz <= m_minHz) {
+        return;
+    }
+
+    const double binHz = (m_maxHz - m_minHz) / panoramaBins;
+    const double segmentBinHz = (segmentMaxHz - segmentMinHz) / count;
+
+    // Значения панорамы, центры которых лежат внутри сегмента.
+    const int first = qMax(0, qCeil((segmentMinHz - m_minHz) / binHz - 0.5));
+    const int last = qMin(panoramaBins, qFloor((segmentMaxHz - m_minHz) / binHz - 0.5) + 1);
+    if (first >= last) {
+        return;
+    }
+
+    // У краев панорамы соседнего сегмента нет, плавный переход не нужен.
+    const double blendHz = m_blendFraction * (segmentMaxHz - segmentMinHz);
+    const bool blendLower = blendHz > 0.0 && segmentMinHz > m_minHz + 0.5 * binHz;
+    const bool blendUpper = blendHz > 0.0 && segmentMaxHz < m_maxHz - 0.5 * binHz;
+
+    if (m_covered == 0) {
+        m_sweepStartUs = timestampUs;
+    }
+
+    m_versions.prepareWrite(m_frame);
+    float *out = m_frame.bins();
+    for (int b = first; b < last; ++b) {
+        const double lowHz = m_minHz + b * binHz;
+        const double centerHz = lowHz + 0.5 * binHz;
+        const double startPos = (lowHz - segmentMinHz) / segmentBinHz;
+        const double endPos = startPos + binHz / segmentBinHz;
+
+        float value;
+        if (endPos - startPos >= 1.0) {
+            const int i0 = qBound(0, qFloor(startPos), count - 1);
+            const int i1 = qBound(i0 + 1, qCeil(endPos), count);
+            value = *std::max_element(bins + i0, bins + i1);
+        } else {
+            const double pos = (centerHz - segmentMinHz) / segmentBinHz - 0.5;
+            const int i = qFloor(pos);
+            const float t = static_cast<float>(pos - i);
+            const float a = bins[qBound(0, i, count - 1)];
+            const float c = bins[qBound(0, i + 1, count - 1)];
+            value = a + t * (c - a);
+        }
+
+        float weight = 1.0f;
+        if (blendLower) {
+            weight = qMin(weight, static_cast<float>((centerHz - segmentMinHz) / blendHz));
+        }
+        if (blendUpper) {
+            weight = qMin(weight, static_cast<float>((segmentMaxHz - centerHz) / blendHz));
+        }
+        weight = qBound(kMinBlendWeight, weight, 1.0f);
+
+        if (m_binSweep[static_cast<size_t>(b)] != m_sweep) {
+            // Первая запись в этом обходе вытесняет данные прошлого обхода.
+            out[b] = value;
+            m_binWeight[static_cast<size_t>(b)] = weight;
+            m_binSweep[static_cast<size_t>(b)] = m_sweep;
+            ++m_covered;
+        } else {
+            const float previousWeight = m_binWeight[static_cast<size_t>(b)];
+            const double power = (previousWeight * std::pow(10.0, out[b] / 10.0)
+                                  + weight * std::pow(10.0, value / 10.0))
+                / (previousWeight + weight);
+            out[b] = static_cast<float>(10.0 * std::log10(qMax(power, 1e-30)));
+            m_binWeight[static_cast<size_t>(b)] = previousWeight + weight;
+        }
+    }
+    m_versions.markDirty(first, last);
+
+    if (m_covered >= panoramaBins) {
+        m_sweepDurationUs = timestampUs - m_sweepStartUs;
+        if (m_lastCompletionUs >= 0) {
+            m_revisitIntervalUs = timestampUs - m_lastCompletionUs;
+        }
+        m_lastCompletionUs = timestampUs;
+        ++m_completedSweeps;
+        m_covered = 0;
+        if (++m_sweep == 0) {
+            // Номер 0 зарезервирован за значениями без данных.
+            std::fill(m_binSweep.begin(), m_binSweep.end(), 0);
+            m_sweep = 1;
+        }
+    }
+}
+
+/*!
+ *  \brief Обновляет пирамиду и ревизии измененных диапазонов и возвращает кадр.
+ *  \return Кадр панорамы.
+ */
+SpectrumFrame SweepAssembler::takeFrame()
+{
+    const QList<QPair<int, int>> &dirty = m_versions.dirtyRanges();
+    if (dirty.isEmpty() && m_frame.isShared()) {
+        // С прошлой выдачи ничего не записано.
+        return m_frame;
+    }
+
+    for (const QPair<int, int> &range : dirty) {
+        m_frame.updatePyramid(range.first, range.second);
+        m_frame.markChanged(range.first, range.second);
+    }
+    m_versions.markPublished();
+
+    // Максимум панорамы берется с верхних уровней пирамиды за O(1).
+    float extremes[2] = {0.0f, 0.0f};
+    if (binCount() > 0) {
+        m_frame.pyramid().query(m_frame.constBins(), 0.0, binCount(), 1, extremes);
+    }
+    m_frame.setDbRange(-120.0f, qMax(extremes[1], -5.0f));
+    return m_frame;
+}
+
+//! \brief Возвращает долю панорамы, записанную в текущем обходе.
+double SweepAssembler::coverage() const noexcept
+{
+    const int panoramaBins = binCount();
+    return panoramaBins > 0 ? static_cast<double>(m_covered) / panoramaBins : 0.0;
+}
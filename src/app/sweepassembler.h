@@ -0,0 +1,129 @@
+/*!
+ *  \file sweepassembler.h
+ *  \brief Сборка панорамы из спектров отдельных стоянок приемника.
+ */
+#ifndef SWEEPASSEMBLER_H
+#define SWEEPASSEMBLER_H
+
+#include <QList>
+#include <QPair>
+#include <QtGlobal>
+
+#include <vector>
+
+#include "spectrumframe.h"
+#include "spectrumframeversions.h"
+
+class SpectrumFramePool;
+
+/*!
+ *  \class SweepAssembler
+ *  \brief Собирает непрерывную панораму из сегментов спектра по мере их поступления.
+ *
+ *  Каждый сегмент (спектр одной стоянки приемника) пересчитывается на сетку
+ *  заранее выделенного буфера панорамы. В зонах перекрытия соседних стоянок
+ *  значения усредняются по мощности с весом, убывающим к краям сегмента.
+ *  Измененные участки накапливаются как диапазоны значений; takeFrame()
+ *  обновляет пирамиду min/max и ревизии кадра только для них.
+ *
+ *  Выданный кадр больше не изменяется: прежние версии панорамы держит
+ *  SpectrumFrameVersions, и запись после выдачи идет в версию, которую уже
+ *  отпустили все потребители.
+ *
+ *  Обход считается завершенным, когда в текущем обходе записано каждое
+ *  значение панорамы; длительность обхода и интервал между завершениями
+ *  доступны через sweepDurationUs() и revisitIntervalUs().
+ */
+class SweepAssembler
+{
+public:
+    /*!
+     *  \brief Задает панораму и сбрасывает накопленные данные.
+     *  \param[in] minHz Нижняя граница панорамы, Гц.
+     *  \param[in] maxHz Верхняя граница панорамы, Гц.
+     *  \param[in] binCount Количество значений панорамы.
+     *  \param[in] blendFraction Доля ширины сегмента у каждого края, в которой вес нарастает от 0 до 1.
+     */
+    void configure(double minHz, double maxHz, int binCount, double blendFraction);
+    /*!
+     *  \brief Задает пул, из которого берется буфер панорамы.
+     *
+     *  Копии панорамы, отделяемые при записи в уже выданный кадр, тоже
+     *  берутся из этого пула.
+     *  \param[in] pool Пул или nullptr (буфер в куче).
+     */
+    void setFramePool(SpectrumFramePool *pool) noexcept { m_framePool = pool; }
+
+    //! \brief Возвращает нижнюю границу панорамы, Гц.
+    double minHz() const noexcept { return m_minHz; }
+    //! \brief Возвращает верхнюю границу панорамы, Гц.
+    double maxHz() const noexcept { return m_maxHz; }
+    //! \brief Возвращает количество значений панорамы.
+    int binCount() const noexcept { return m_frame.binCount(); }
+
+    /*!
+     *  \brief Записывает сегмент спектра в панораму.
+     *  \param[in] segmentMinHz Нижняя граница сегмента, Гц.
+     *  \param[in] segmentMaxHz Верхняя граница сегмента, Гц.
+     *  \param[in] bins Значения сегмента, дБ.
+     *  \param[in] count Количество значений сегмента.
+     *  \param[in] timestampUs Время получения сегмента, мкс (монотонное).
+     */
+    void addSegment(double segmentMinHz, double segmentMaxHz, const float *bins, int count, qint64 timestampUs);
+
+    //! \brief Возвращает измененные с прошлого takeFrame() диапазоны значений [first, last).
+    const QList<QPair<int, int>> &dirtyRanges() const noexcept { return m_versions.dirtyRanges(); }
+
+    /*!
+     *  \brief Применяет накопленные изменения и возвращает кадр панорамы.
+     *
+     *  Пирамида и ревизии обновляются только для измененных диапазонов.
+     *  Сборщик больше не пишет в данные выданного кадра.
+     *
+     *  \return Кадр панорамы.
+     */
+    SpectrumFrame takeFrame();
+
+    //! \brief Возвращает число завершенных обходов.
+    quint64 completedSweeps() const noexcept { return m_completedSweeps; }
+    //! \brief Возвращает долю панорамы, записанную в текущем обходе.
+    double coverage() const noexcept;
+    //! \brief Возвращает длительность последнего обхода (от первой стоянки до последней), мкс.
+    qint64 sweepDurationUs() const noexcept { return m_sweepDurationUs; }
+    //! \brief Возвращает интервал между двумя последними завершениями обхода, мкс.
+    qint64 revisitIntervalUs() const noexcept { return m_revisitIntervalUs; }
+
+private:
+    //! \brief Нижняя граница панорамы, Гц.
+    double m_minHz = 0.0;
+    //! \brief Верхняя граница панорамы, Гц.
+    double m_maxHz = 0.0;
+    //! \brief Доля ширины сегмента для плавного перехода у краев.
+    double m_blendFraction = 0.0;
+    //! \brief Пул буферов кадров (nullptr — кадры в куче).
+    SpectrumFramePool *m_framePool = nullptr;
+    //! \brief Буфер панорамы.
+    SpectrumFrame m_frame;
+    //! \brief Прежние версии панорамы и измененные с прошлой выдачи диапазоны.
+    SpectrumFrameVersions m_versions;
+    //! \brief Номер обхода, в котором значение записано последний раз (0 — не записано).
+    std::vector<quint32> m_binSweep;
+    //! \brief Суммарный вес записей значения в текущем обходе.
+    std::vector<float> m_binWeight;
+    //! \brief Номер текущего обхода (начинается с 1).
+    quint32 m_sweep = 1;
+    //! \brief Значений, записанных в текущем обходе.
+    int m_covered = 0;
+    //! \brief Время первой стоянки текущего обхода, мкс.
+    qint64 m_sweepStartUs = 0;
+    //! \brief Время последнего завершения обхода, мкс (-1 — не было).
+    qint64 m_lastCompletionUs = -1;
+    //! \brief Число завершенных обходов.
+    quint64 m_completedSweeps = 0;
+    //! \brief Длительность последнего обхода, мкс.
+    qint64 m_sweepDurationUs = 0;
+    //! \brief Интервал между двумя последними завершениями, мкс.
+    qint64 m_revisitIntervalUs = 0;
+};
+
+#endif // SWEEPASSEMBLER_H
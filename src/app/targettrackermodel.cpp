@@ -0,0 +1,368 @@
+/*!
+ *  \file targettrackermodel.cpp
+ *  \brief Реализация TargetTrackerModel.
+ */
+#include "targettrackermodel.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QMetaObject>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+/*!
+ *  \brief Конструирует модель и запускает поток сопровождения.
+ *  \param[in] parent Родительский объект.
+ */
+TargetTrackerModel::TargetTrackerModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+    publishSettings();
+    m_thread = QThread::create([this]() { runTracker(); });
+    m_thread->setObjectName(QStringLiteral("TargetTracker"));
+    m_thread->start(QThread::LowPriority);
+}
+
+//! \brief Останавливает поток сопровождения.
+TargetTrackerModel::~TargetTrackerModel()
+{
+    m_thread->requestInterruption();
+    m_thread->wait();
+    delete m_thread;
+}
+
+//! \brief Возвращает число строк (трасс).
+int TargetTrackerModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : count();
+}
+
+//! \brief Возвращает данные трассы по роли.
+QVariant TargetTrackerModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count()) {
+        return {};
+    }
+
+    const BearingTracker::Track &track = m_rows[static_cast<size_t>(index.row())];
+    switch (role) {
+    case TrackIdRole:
+        return QVariant::fromValue(track.id);
+    case Qt::DisplayRole:
+    case AzimuthDegRole:
+        return track.azimuthDeg;
+    case LastSeenMsRole:
+        return track.lastSeenMs;
+    case FreshestRole:
+        return track.id == m_freshestId;
+    default:
+        return {};
+    }
+}
+
+//! \brief Возвращает имена ролей для QML.
+QHash<int, QByteArray> TargetTrackerModel::roleNames() const
+{
+    return {
+        {TrackIdRole, "trackId"},
+        {AzimuthDegRole, "azimuthDeg"},
+        {LastSeenMsRole, "lastSeenMs"},
+        {FreshestRole, "freshest"},
+    };
+}
+
+//! \brief Задает максимальное число трасс.
+void TargetTrackerModel::setMaxTargets(int value)
+{
+    value = qMax(0, value);
+    if (m_settings.maxTargets == value) {
+        return;
+    }
+    m_settings.maxTargets = value;
+    publishSettings();
+}
+
+//! \brief Задает порог совпадения пеленга с трассой, градусы.
+void TargetTrackerModel::setMatchThresholdDeg(double value)
+{
+    value = qBound(0.0, value, 180.0);
+    if (qFuzzyCompare(m_settings.matchThresholdDeg, value)) {
+        return;
+    }
+    m_settings.matchThresholdDeg = value;
+    publishSettings();
+}
+
+//! \brief Задает время жизни трассы, мс.
+void TargetTrackerModel::setTtlMs(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+    if (m_settings.ttlMs == value) {
+        return;
+    }
+    m_settings.ttlMs = value;
+    publishSettings();
+}
+
+//! \brief Задает время угасания трассы, мс.
+void TargetTrackerModel::setFadeMs(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+    if (m_settings.fadeMs == value) {
+        return;
+    }
+    m_settings.fadeMs = value;
+    publishSettings();
+}
+
+//! \brief Задает множитель затухания счета.
+void TargetTrackerModel::setScoreDecayPerIngest(double value)
+{
+    value = qBound(0.0, value, 1.0);
+    if (qFuzzyCompare(m_settings.scoreDecayPerIngest, value)) {
+        return;
+    }
+    m_settings.scoreDecayPerIngest = value;
+    publishSettings();
+}
+
+//! \brief Задает долю сдвига азимута трассы к пеленгу.
+void TargetTrackerModel::setAzimuthLerpK(double value)
+{
+    value = qBound(0.0, value, 1.0);
+    if (qFuzzyCompare(m_settings.azimuthLerpK, value)) {
+        return;
+    }
+    m_settings.azimuthLerpK = value;
+    publishSettings();
+}
+
+//! \brief Задает период приема пеленгов, мс.
+void TargetTrackerModel::setTickIntervalMs(int value)
+{
+    value = qMax(1, value);
+    if (m_tickIntervalMs.exchange(value, std::memory_order_relaxed) != value) {
+        emit settingsChanged();
+    }
+}
+
+/*!
+ *  \brief Задает текущие пеленги.
+ *  \param[in] bearings Пеленги, градусы.
+ */
+void TargetTrackerModel::setBearings(const QList<double> &bearings)
+{
+    if (m_bearings == bearings) {
+        return;
+    }
+    m_bearings = bearings;
+    m_bearingsSlot.writeBuffer().assign(m_bearings.cbegin(), m_bearings.cend());
+    m_bearingsSlot.publish();
+    emit bearingsChanged();
+}
+
+/*!
+ *  \brief Задает источник пеленгов.
+ *  \param[in] finder Пеленгатор или nullptr.
+ */
+void TargetTrackerModel::setDirectionFinder(DirectionFinder *finder)
+{
+    if (m_directionFinder == finder) {
+        return;
+    }
+    m_directionFinder = finder;
+    m_bearingQueueSlot.writeBuffer() = finder != nullptr ? finder->bearingQueue() : nullptr;
+    m_bearingQueueSlot.publish();
+    emit directionFinderChanged();
+}
+
+/*!
+ *  \brief Возвращает прозрачность трассы по времени ее последнего совпадения.
+ *  \param[in] lastSeenMs Время последнего совпадения, мс от начала эпохи.
+ *  \return Прозрачность 0..1 относительно nowMs.
+ */
+double TargetTrackerModel::alpha(qint64 lastSeenMs) const
+{
+    if (m_settings.fadeMs <= 0) {
+        return 1.0;
+    }
+    // tau = fadeMs / 3: к концу угасания остается exp(-3) ~ 0.05.
+    const double ageMs = static_cast<double>(qMax<qint64>(0, m_nowMs - lastSeenMs));
+    const double tau = qMax(1.0, m_settings.fadeMs / 3.0);
+    return qBound(0.0, std::exp(-ageMs / tau), 1.0);
+}
+
+//! \brief Удаляет все трассы.
+void TargetTrackerModel::clear()
+{
+    // Снимки, сформированные до очистки в потоке, отбрасываются по номеру.
+    m_clearGeneration.fetch_add(1, std::memory_order_relaxed);
+    if (m_rows.empty()) {
+        return;
+    }
+    beginResetModel();
+    m_rows.clear();
+    m_freshestId = 0;
+    endResetModel();
+    emit countChanged();
+}
+
+//! \brief Публикует параметры для потока сопровождения.
+void TargetTrackerModel::publishSettings()
+{
+    m_settingsSlot.writeBuffer() = m_settings;
+    m_settingsSlot.publish();
+    emit settingsChanged();
+}
+
+//! \brief Цикл потока сопровождения.
+void TargetTrackerModel::runTracker()
+{
+    using Clock = std::chrono::steady_clock;
+
+    BearingTracker tracker;
+    std::vector<double> bearings;
+    std::shared_ptr<DirectionFinder::BearingQueue> bearingQueue;
+    DirectionFinder::BearingBatch bearingBatch;
+    std::vector<double> ingested;
+    quint64 clearGeneration = 0;
+    Clock::time_point deadline = Clock::now();
+
+    while (!m_thread->isInterruptionRequested()) {
+        if (m_settingsSlot.consume()) {
+            tracker.setSettings(m_settingsSlot.readBuffer());
+        }
+        if (m_bearingsSlot.consume()) {
+            bearings = m_bearingsSlot.readBuffer();
+        }
+        if (m_bearingQueueSlot.consume()) {
+            bearingQueue = m_bearingQueueSlot.readBuffer();
+            // Пеленги, накопленные, пока очередь никто не читал, устарели.
+            while (bearingQueue && bearingQueue->tryPop(bearingBatch)) {
+            }
+        }
+        const quint64 requestedClear = m_clearGeneration.load(std::memory_order_relaxed);
+        if (requestedClear != clearGeneration) {
+            clearGeneration = requestedClear;
+            tracker.clear();
+        }
+
+        // Пеленги принимаются на каждом такте, как в исходной логике индикатора:
+        // устойчивая цель набирает счет и не устаревает, пока ее пеленг есть.
+        // Пеленги пеленгатора, поступившие с прошлого такта, принимаются один раз.
+        ingested.assign(bearings.cbegin(), bearings.cend());
+        while (bearingQueue && bearingQueue->tryPop(bearingBatch)) {
+            for (const DirectionFinder::Bearing &bearing : bearingBatch.bearings) {
+                ingested.push_back(bearing.azimuthDeg);
+            }
+        }
+        const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+        tracker.ingest(ingested.data(), static_cast<int>(ingested.size()), nowMs);
+
+        Snapshot &snapshot = m_snapshots.writeBuffer();
+        snapshot.nowMs = nowMs;
+        snapshot.freshestId = tracker.freshestId();
+        snapshot.clearGeneration = clearGeneration;
+        snapshot.tracks = tracker.tracks();
+        m_snapshots.publish();
+        if (!m_notifyPending.exchange(true, std::memory_order_acq_rel)) {
+            QMetaObject::invokeMethod(this, &TargetTrackerModel::applySnapshot, Qt::QueuedConnection);
+        }
+
+        deadline += std::chrono::milliseconds(m_tickIntervalMs.load(std::memory_order_relaxed));
+        const Clock::time_point now = Clock::now();
+        if (deadline < now) {
+            deadline = now;
+        }
+        std::this_thread::sleep_until(deadline);
+    }
+}
+
+//! \brief Сопоставляет последний снимок со строками модели.
+void TargetTrackerModel::applySnapshot()
+{
+    m_notifyPending.store(false, std::memory_order_release);
+    if (!m_snapshots.consume()) {
+        return;
+    }
+    const Snapshot &snapshot = m_snapshots.readBuffer();
+    if (snapshot.clearGeneration != m_clearGeneration.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    QHash<quint64, int> snapshotRows;
+    snapshotRows.reserve(static_cast<qsizetype>(snapshot.tracks.size()));
+    for (size_t i = 0; i < snapshot.tracks.size(); ++i) {
+        snapshotRows.insert(snapshot.tracks[i].id, static_cast<int>(i));
+    }
+
+    const int countBefore = count();
+
+    // Удаленные трассы: подряд идущие строки снимаются одним диапазоном.
+    for (int row = count() - 1; row >= 0;) {
+        if (snapshotRows.contains(m_rows[static_cast<size_t>(row)].id)) {
+            --row;
+            continue;
+        }
+        int first = row;
+        while (first > 0 && !snapshotRows.contains(m_rows[static_cast<size_t>(first - 1)].id)) {
+            --first;
+        }
+        beginRemoveRows(QModelIndex(), first, row);
+        m_rows.erase(m_rows.begin() + first, m_rows.begin() + row + 1);
+        endRemoveRows();
+        row = first - 1;
+    }
+
+    // Оставшиеся трассы: сообщаем только об изменившихся ролях.
+    std::vector<bool> present(snapshot.tracks.size(), false);
+    for (int row = 0; row < count(); ++row) {
+        BearingTracker::Track &current = m_rows[static_cast<size_t>(row)];
+        const int source = snapshotRows.value(current.id);
+        const BearingTracker::Track &updated = snapshot.tracks[static_cast<size_t>(source)];
+        present[static_cast<size_t>(source)] = true;
+
+        QList<int> roles;
+        if (current.azimuthDeg != updated.azimuthDeg) {
+            roles.append(AzimuthDegRole);
+            roles.append(Qt::DisplayRole);
+        }
+        if (current.lastSeenMs != updated.lastSeenMs) {
+            roles.append(LastSeenMsRole);
+        }
+        if ((current.id == m_freshestId) != (current.id == snapshot.freshestId)) {
+            roles.append(FreshestRole);
+        }
+        current = updated;
+        if (!roles.isEmpty()) {
+            const QModelIndex modelIndex = index(row);
+            emit dataChanged(modelIndex, modelIndex, roles);
+        }
+    }
+    m_freshestId = snapshot.freshestId;
+
+    // Новые трассы добавляются в конец одним диапазоном.
+    int added = 0;
+    for (bool isPresent : present) {
+        added += isPresent ? 0 : 1;
+    }
+    if (added > 0) {
+        beginInsertRows(QModelIndex(), count(), count() + added - 1);
+        for (size_t i = 0; i < snapshot.tracks.size(); ++i) {
+            if (!present[i]) {
+                m_rows.push_back(snapshot.tracks[i]);
+            }
+        }
+        endInsertRows();
+    }
+
+    if (m_nowMs != snapshot.nowMs) {
+        m_nowMs = snapshot.nowMs;
+        emit nowMsChanged();
+    }
+    if (count() != countBefore) {
+        emit countChanged();
+    }
+}
@@ -0,0 +1,210 @@
+/*!
+ *  \file targettrackermodel.h
+ *  \brief Модель трасс целей для индикатора с сопровождением в отдельном потоке.
+ */
+#ifndef TARGETTRACKERMODEL_H
+#define TARGETTRACKERMODEL_H
+
+#include <QAbstractListModel>
+#include <QList>
+#include <QPointer>
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "bearingtracker.h"
+#include "directionfinder.h"
+#include "latestvalueslot.h"
+
+/*!
+ *  \class TargetTrackerModel
+ *  \brief Модель списка трасс, формируемых BearingTracker в отдельном потоке.
+ *
+ *  Поток сопровождения с периодом tickIntervalMs принимает текущие пеленги
+ *  (свойство bearings) вместе с пеленгами, поступившими с прошлого такта
+ *  из очереди DirectionFinder (свойство directionFinder), обновляет трассы
+ *  и публикует их снимок через LatestValueSlot. В потоке UI снимок сопоставляется со строками модели
+ *  по идентификатору трассы: строки не переупорядочиваются, а сообщается
+ *  только о вставленных, удаленных и действительно изменившихся строках.
+ *
+ *  Прозрачность трассы зависит от времени, поэтому в модели хранится
+ *  только время последнего совпадения (роль lastSeenMs), а прозрачность
+ *  вычисляется делегатом по свойству nowMs или методом alpha(). Счет
+ *  затухает на каждом такте у всех трасс и служит только для их отбора,
+ *  поэтому ролью модели не является.
+ */
+class TargetTrackerModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int maxTargets READ maxTargets WRITE setMaxTargets NOTIFY settingsChanged)
+    Q_PROPERTY(double matchThresholdDeg READ matchThresholdDeg WRITE setMatchThresholdDeg NOTIFY settingsChanged)
+    Q_PROPERTY(qint64 ttlMs READ ttlMs WRITE setTtlMs NOTIFY settingsChanged)
+    Q_PROPERTY(qint64 fadeMs READ fadeMs WRITE setFadeMs NOTIFY settingsChanged)
+    Q_PROPERTY(double scoreDecayPerIngest READ scoreDecayPerIngest WRITE setScoreDecayPerIngest NOTIFY settingsChanged)
+    Q_PROPERTY(double azimuthLerpK READ azimuthLerpK WRITE setAzimuthLerpK NOTIFY settingsChanged)
+    Q_PROPERTY(int tickIntervalMs READ tickIntervalMs WRITE setTickIntervalMs NOTIFY settingsChanged)
+    Q_PROPERTY(QList<double> bearings READ bearings WRITE setBearings NOTIFY bearingsChanged)
+    Q_PROPERTY(DirectionFinder *directionFinder READ directionFinder WRITE setDirectionFinder
+                   NOTIFY directionFinderChanged)
+    Q_PROPERTY(qint64 nowMs READ nowMs NOTIFY nowMsChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    //! \brief Роли данных трассы.
+    enum Roles
+    {
+        TrackIdRole = Qt::UserRole + 1,
+        AzimuthDegRole,
+        LastSeenMsRole,
+        FreshestRole
+    };
+    Q_ENUM(Roles)
+
+    /*!
+     *  \brief Конструирует модель и запускает поток сопровождения.
+     *  \param[in] parent Родительский объект.
+     */
+    explicit TargetTrackerModel(QObject *parent = nullptr);
+    //! \brief Останавливает поток сопровождения.
+    ~TargetTrackerModel() override;
+
+    //! \brief Возвращает число строк (трасс).
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    //! \brief Возвращает данные трассы по роли.
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    //! \brief Возвращает имена ролей для QML.
+    QHash<int, QByteArray> roleNames() const override;
+
+    //! \brief Возвращает максимальное число трасс.
+    int maxTargets() const noexcept { return m_settings.maxTargets; }
+    //! \brief Задает максимальное число трасс.
+    void setMaxTargets(int value);
+    //! \brief Возвращает порог совпадения пеленга с трассой, градусы.
+    double matchThresholdDeg() const noexcept { return m_settings.matchThresholdDeg; }
+    //! \brief Задает порог совпадения пеленга с трассой, градусы.
+    void setMatchThresholdDeg(double value);
+    //! \brief Возвращает время жизни трассы, мс.
+    qint64 ttlMs() const noexcept { return m_settings.ttlMs; }
+    //! \brief Задает время жизни трассы, мс.
+    void setTtlMs(qint64 value);
+    //! \brief Возвращает время угасания трассы, мс.
+    qint64 fadeMs() const noexcept { return m_settings.fadeMs; }
+    //! \brief Задает время угасания трассы, мс.
+    void setFadeMs(qint64 value);
+    //! \brief Возвращает множитель затухания счета.
+    double scoreDecayPerIngest() const noexcept { return m_settings.scoreDecayPerIngest; }
+    //! \brief Задает множитель затухания счета.
+    void setScoreDecayPerIngest(double value);
+    //! \brief Возвращает долю сдвига азимута трассы к пеленгу.
+    double azimuthLerpK() const noexcept { return m_settings.azimuthLerpK; }
+    //! \brief Задает долю сдвига азимута трассы к пеленгу.
+    void setAzimuthLerpK(double value);
+    //! \brief Возвращает период приема пеленгов, мс.
+    int tickIntervalMs() const noexcept { return m_tickIntervalMs.load(std::memory_order_relaxed); }
+    //! \brief Задает период приема пеленгов, мс (не меньше 1).
+    void setTickIntervalMs(int value);
+
+    //! \brief Возвращает текущие пеленги, градусы.
+    QList<double> bearings() const { return m_bearings; }
+    /*!
+     *  \brief Задает текущие пеленги; они принимаются на каждом такте до замены.
+     *  \param[in] bearings Пеленги, градусы.
+     */
+    void setBearings(const QList<double> &bearings);
+
+    //! \brief Возвращает источник пеленгов.
+    DirectionFinder *directionFinder() const noexcept { return m_directionFinder; }
+    /*!
+     *  \brief Задает источник пеленгов; его очередь читает поток сопровождения.
+     *
+     *  У очереди DirectionFinder один потребитель: источник нельзя назначать
+     *  одновременно нескольким моделям.
+     *  \param[in] finder Пеленгатор или nullptr.
+     */
+    void setDirectionFinder(DirectionFinder *finder);
+
+    //! \brief Возвращает время последнего принятого снимка, мс от начала эпохи.
+    qint64 nowMs() const noexcept { return m_nowMs; }
+    //! \brief Возвращает число трасс.
+    int count() const noexcept { return static_cast<int>(m_rows.size()); }
+    //! \brief Возвращает трассы в порядке строк модели.
+    const std::vector<BearingTracker::Track> &tracks() const noexcept { return m_rows; }
+    //! \brief Возвращает идентификатор самой свежей трассы.
+    quint64 freshestId() const noexcept { return m_freshestId; }
+
+    /*!
+     *  \brief Возвращает прозрачность трассы по времени ее последнего совпадения.
+     *  \param[in] lastSeenMs Время последнего совпадения, мс от начала эпохи.
+     *  \return Прозрачность 0..1 относительно nowMs.
+     */
+    Q_INVOKABLE double alpha(qint64 lastSeenMs) const;
+    //! \brief Удаляет все трассы.
+    Q_INVOKABLE void clear();
+
+signals:
+    //! \brief Сигнал об изменении параметров сопровождения.
+    void settingsChanged();
+    //! \brief Сигнал об изменении пеленгов.
+    void bearingsChanged();
+    //! \brief Сигнал о смене источника пеленгов.
+    void directionFinderChanged();
+    //! \brief Сигнал о приеме нового снимка трасс.
+    void nowMsChanged();
+    //! \brief Сигнал об изменении числа трасс.
+    void countChanged();
+
+private:
+    //! \brief Снимок трасс, передаваемый из потока сопровождения.
+    struct Snapshot
+    {
+        //! \brief Время такта, мс от начала эпохи.
+        qint64 nowMs = 0;
+        //! \brief Идентификатор самой свежей трассы.
+        quint64 freshestId = 0;
+        //! \brief Номер последнего выполненного запроса очистки.
+        quint64 clearGeneration = 0;
+        //! \brief Трассы.
+        std::vector<BearingTracker::Track> tracks;
+    };
+
+    //! \brief Публикует параметры для потока сопровождения.
+    void publishSettings();
+    //! \brief Цикл потока сопровождения.
+    void runTracker();
+    //! \brief Сопоставляет последний снимок со строками модели (поток UI).
+    void applySnapshot();
+
+    //! \brief Параметры сопровождения (поток UI).
+    BearingTracker::Settings m_settings;
+    //! \brief Текущие пеленги (поток UI).
+    QList<double> m_bearings;
+    //! \brief Период приема пеленгов, мс.
+    std::atomic<int> m_tickIntervalMs{16};
+    //! \brief Слот параметров (UI -> поток).
+    LatestValueSlot<BearingTracker::Settings> m_settingsSlot;
+    //! \brief Слот пеленгов (UI -> поток).
+    LatestValueSlot<std::vector<double>> m_bearingsSlot;
+    //! \brief Источник пеленгов (поток UI).
+    QPointer<DirectionFinder> m_directionFinder;
+    //! \brief Слот очереди пеленгов источника (UI -> поток).
+    LatestValueSlot<std::shared_ptr<DirectionFinder::BearingQueue>> m_bearingQueueSlot;
+    //! \brief Слот снимков трасс (поток -> UI).
+    LatestValueSlot<Snapshot> m_snapshots;
+    //! \brief Номер последнего запроса очистки (UI -> поток).
+    std::atomic<quint64> m_clearGeneration{0};
+    //! \brief Признак отправленного и еще не обработанного уведомления.
+    std::atomic<bool> m_notifyPending{false};
+    //! \brief Поток сопровождения.
+    QThread *m_thread = nullptr;
+
+    //! \brief Строки модели в порядке появления трасс.
+    std::vector<BearingTracker::Track> m_rows;
+    //! \brief Идентификатор самой свежей трассы в строках.
+    quint64 m_freshestId = 0;
+    //! \brief Время последнего принятого снимка, мс.
+    qint64 m_nowMs = 0;
+};
+
+#endif // TARGETTRACKERMODEL_H
@@ -0,0 +1,269 @@
+/*!
+ *  \file tracekernel.cpp
+ *  \brief Реализация TraceKernel.
+ */
+#include "tracekernel.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIRIUS_TRACE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+//! \brief Сигнатура ядра с параметром (среднее, спад).
+using UpdateFn = void (*)(const float *, float *, std::int64_t, float);
+//! \brief Сигнатура ядра удержания.
+using HoldFn = void (*)(const float *, float *, std::int64_t);
+
+/*!
+ *  \brief Скалярное среднее. Умножение и сложение раздельные, как в векторных вариантах.
+ */
+void averageScalar(const float *values, float *acc, std::int64_t count, float factor)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        const float delta = values[i] - acc[i];
+        const float step = delta * factor;
+        acc[i] = acc[i] + step;
+    }
+}
+
+//! \brief Скалярное удержание максимума; семантика maxps(values, acc).
+void maxHoldScalar(const float *values, float *acc, std::int64_t count)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        acc[i] = values[i] > acc[i] ? values[i] : acc[i];
+    }
+}
+
+//! \brief Скалярное удержание минимума; семантика minps(values, acc).
+void minHoldScalar(const float *values, float *acc, std::int64_t count)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        acc[i] = values[i] < acc[i] ? values[i] : acc[i];
+    }
+}
+
+//! \brief Скалярный пик со спадом; семантика maxps(values, acc - decay).
+void peakDecayScalar(const float *values, float *acc, std::int64_t count, float decay)
+{
+    for (std::int64_t i = 0; i < count; ++i) {
+        const float decayed = acc[i] - decay;
+        acc[i] = values[i] > decayed ? values[i] : decayed;
+    }
+}
+
+#ifdef SIRIUS_TRACE_X86
+
+//! \brief Среднее SSE2: 4 значения за шаг.
+void averageSse2(const float *values, float *acc, std::int64_t count, float factor)
+{
+    const __m128 f = _mm_set1_ps(factor);
+    std::int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 a = _mm_loadu_ps(acc + i);
+        const __m128 step = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(values + i), a), f);
+        _mm_storeu_ps(acc + i, _mm_add_ps(a, step));
+    }
+    averageScalar(values + i, acc + i, count - i, factor);
+}
+
+//! \brief Удержание максимума SSE2.
+void maxHoldSse2(const float *values, float *acc, std::int64_t count)
+{
+    std::int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(acc + i, _mm_max_ps(_mm_loadu_ps(values + i), _mm_loadu_ps(acc + i)));
+    }
+    maxHoldScalar(values + i, acc + i, count - i);
+}
+
+//! \brief Удержание минимума SSE2.
+void minHoldSse2(const float *values, float *acc, std::int64_t count)
+{
+    std::int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(acc + i, _mm_min_ps(_mm_loadu_ps(values + i), _mm_loadu_ps(acc + i)));
+    }
+    minHoldScalar(values + i, acc + i, count - i);
+}
+
+//! \brief Пик со спадом SSE2.
+void peakDecaySse2(const float *values, float *acc, std::int64_t count, float decay)
+{
+    const __m128 d = _mm_set1_ps(decay);
+    std::int64_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 decayed = _mm_sub_ps(_mm_loadu_ps(acc + i), d);
+        _mm_storeu_ps(acc + i, _mm_max_ps(_mm_loadu_ps(values + i), decayed));
+    }
+    peakDecayScalar(values + i, acc + i, count - i, decay);
+}
+
+//! \brief Среднее AVX2: 8 значений за шаг (без FMA — результат совпадает со скалярным).
+__attribute__((target("avx2")))
+void averageAvx2(const float *values, float *acc, std::int64_t count, float factor)
+{
+    const __m256 f = _mm256_set1_ps(factor);
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 a = _mm256_loadu_ps(acc + i);
+        const __m256 step = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(values + i), a), f);
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(a, step));
+    }
+    averageScalar(values + i, acc + i, count - i, factor);
+}
+
+//! \brief Удержание максимума AVX2.
+__attribute__((target("avx2")))
+void maxHoldAvx2(const float *values, float *acc, std::int64_t count)
+{
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(acc + i, _mm256_max_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(acc + i)));
+    }
+    maxHoldScalar(values + i, acc + i, count - i);
+}
+
+//! \brief Удержание минимума AVX2.
+__attribute__((target("avx2")))
+void minHoldAvx2(const float *values, float *acc, std::int64_t count)
+{
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(acc + i, _mm256_min_ps(_mm256_loadu_ps(values + i), _mm256_loadu_ps(acc + i)));
+    }
+    minHoldScalar(values + i, acc + i, count - i);
+}
+
+//! \brief Пик со спадом AVX2.
+__attribute__((target("avx2")))
+void peakDecayAvx2(const float *values, float *acc, std::int64_t count, float decay)
+{
+    const __m256 d = _mm256_set1_ps(decay);
+    std::int64_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 decayed = _mm256_sub_ps(_mm256_loadu_ps(acc + i), d);
+        _mm256_storeu_ps(acc + i, _mm256_max_ps(_mm256_loadu_ps(values + i), decayed));
+    }
+    peakDecayScalar(values + i, acc + i, count - i, decay);
+}
+
+#endif
+
+//! \brief Возвращает ядро среднего для варианта.
+UpdateFn averageFunction(TraceKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_TRACE_X86
+    case TraceKernel::Variant::Sse2:
+        return averageSse2;
+    case TraceKernel::Variant::Avx2:
+        return averageAvx2;
+#endif
+    default:
+        return averageScalar;
+    }
+}
+
+//! \brief Возвращает ядро удержания максимума для варианта.
+HoldFn maxHoldFunction(TraceKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_TRACE_X86
+    case TraceKernel::Variant::Sse2:
+        return maxHoldSse2;
+    case TraceKernel::Variant::Avx2:
+        return maxHoldAvx2;
+#endif
+    default:
+        return maxHoldScalar;
+    }
+}
+
+//! \brief Возвращает ядро удержания минимума для варианта.
+HoldFn minHoldFunction(TraceKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_TRACE_X86
+    case TraceKernel::Variant::Sse2:
+        return minHoldSse2;
+    case TraceKernel::Variant::Avx2:
+        return minHoldAvx2;
+#endif
+    default:
+        return minHoldScalar;
+    }
+}
+
+//! \brief Возвращает ядро пика со спадом для варианта.
+UpdateFn peakDecayFunction(TraceKernel::Variant variant)
+{
+    switch (variant) {
+#ifdef SIRIUS_TRACE_X86
+    case TraceKernel::Variant::Sse2:
+        return peakDecaySse2;
+    case TraceKernel::Variant::Avx2:
+        return peakDecayAvx2;
+#endif
+    default:
+        return peakDecayScalar;
+    }
+}
+
+} // namespace
+
+//! \brief Возвращает лучший поддерживаемый процессором вариант (определяется один раз).
+TraceKernel::Variant TraceKernel::bestVariant() noexcept
+{
+    static const Variant best = [] {
+        for (int v = kVariantCount - 1; v > 0; --v) {
+            if (isSupported(static_cast<Variant>(v))) {
+                return static_cast<Variant>(v);
+            }
+        }
+        return Variant::Scalar;
+    }();
+    return best;
+}
+
+//! \brief Проверяет, поддерживает ли процессор вариант.
+bool TraceKernel::isSupported(Variant variant) noexcept
+{
+    switch (variant) {
+    case Variant::Scalar:
+        return true;
+#ifdef SIRIUS_TRACE_X86
+    case Variant::Sse2:
+        return __builtin_cpu_supports("sse2");
+    case Variant::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+//! \brief Обновляет экспоненциальное среднее.
+void TraceKernel::average(Variant variant, const float *values, float *acc, std::int64_t count, float factor) noexcept
+{
+    averageFunction(variant)(values, acc, count, factor);
+}
+
+//! \brief Обновляет удержание максимума.
+void TraceKernel::maxHold(Variant variant, const float *values, float *acc, std::int64_t count) noexcept
+{
+    maxHoldFunction(variant)(values, acc, count);
+}
+
+//! \brief Обновляет удержание минимума.
+void TraceKernel::minHold(Variant variant, const float *values, float *acc, std::int64_t count) noexcept
+{
+    minHoldFunction(variant)(values, acc, count);
+}
+
+//! \brief Обновляет пик со спадом.
+void TraceKernel::peakDecay(Variant variant, const float *values, float *acc, std::int64_t count, float decay) noexcept
+{
+    peakDecayFunction(variant)(values, acc, count, decay);
+}
@@ -0,0 +1,73 @@
+/*!
+ *  \file tracekernel.h
+ *  \brief Векторизованные ядра накопления трасс (среднее, удержание, спад пика).
+ */
+#ifndef TRACEKERNEL_H
+#define TRACEKERNEL_H
+
+#include <cstdint>
+
+/*!
+ *  \class TraceKernel
+ *  \brief Ядра обновления накопителей трасс для float32: скалярное, SSE2 и AVX2.
+ *
+ *  Каждое ядро обновляет накопитель на месте одним проходом по значениям.
+ *  NaN во входном кадре не меняет накопитель удержания и спада; все
+ *  варианты дают побитно одинаковый результат. Вариант выбирается один
+ *  раз по возможностям процессора.
+ */
+class TraceKernel
+{
+public:
+    //! \brief Вариант реализации ядра.
+    enum class Variant : int {
+        Scalar = 0,
+        Sse2 = 1,
+        Avx2 = 2
+    };
+
+    //! \brief Количество вариантов.
+    static constexpr int kVariantCount = 3;
+
+    //! \brief Возвращает лучший поддерживаемый процессором вариант.
+    static Variant bestVariant() noexcept;
+    //! \brief Проверяет, поддерживает ли процессор вариант.
+    static bool isSupported(Variant variant) noexcept;
+
+    /*!
+     *  \brief Экспоненциальное среднее: acc += factor * (values - acc).
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] values Новые значения.
+     *  \param[in,out] acc Накопитель.
+     *  \param[in] count Количество значений.
+     *  \param[in] factor Вес нового значения, 0..1.
+     */
+    static void average(Variant variant, const float *values, float *acc, std::int64_t count, float factor) noexcept;
+    /*!
+     *  \brief Удержание максимума: acc = max(values, acc).
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] values Новые значения.
+     *  \param[in,out] acc Накопитель.
+     *  \param[in] count Количество значений.
+     */
+    static void maxHold(Variant variant, const float *values, float *acc, std::int64_t count) noexcept;
+    /*!
+     *  \brief Удержание минимума: acc = min(values, acc).
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] values Новые значения.
+     *  \param[in,out] acc Накопитель.
+     *  \param[in] count Количество значений.
+     */
+    static void minHold(Variant variant, const float *values, float *acc, std::int64_t count) noexcept;
+    /*!
+     *  \brief Пик со спадом: acc = max(values, acc - decay).
+     *  \param[in] variant Вариант ядра.
+     *  \param[in] values Новые значения.
+     *  \param[in,out] acc Накопитель.
+     *  \param[in] count Количество значений.
+     *  \param[in] decay Спад за одно обновление, дБ.
+     */
+    static void peakDecay(Variant variant, const float *values, float *acc, std::int64_t count, float decay) noexcept;
+};
+
+#endif // TRACEKERNEL_H
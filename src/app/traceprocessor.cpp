@@ -0,0 +1,257 @@
+/*!
+ *  \file traceprocessor.cpp
+ *  \brief Реализация TraceProcessor.
+ */
+#include "traceprocessor.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <utility>
+
+/*!
+ *  \brief Приводит параметры к допустимым значениям.
+ *  \param[in] settings Параметры.
+ *  \return Параметры в допустимых границах.
+ */
+TraceProcessor::Settings TraceProcessor::normalized(const Settings &settings) noexcept
+{
+    Settings result = settings;
+    result.modes &= (1 << kModeCount) - 1;
+    result.averageFactor = qBound(1e-4f, settings.averageFactor, 1.0f);
+    result.peakDecayDb = qMax(0.0f, settings.peakDecayDb);
+    return result;
+}
+
+/*!
+ *  \brief Публикует параметры.
+ *  \param[in] settings Параметры трасс.
+ */
+void TraceProcessor::setSettings(const Settings &settings)
+{
+    m_settingsRequests.writeBuffer() = normalized(settings);
+    m_settingsRequests.publish();
+}
+
+/*!
+ *  \brief Просит начать трассы заново в диапазоне частот.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+void TraceProcessor::requestReset(double minHz, double maxHz)
+{
+    m_resetRequests.tryPush(ResetRequest{minHz, maxHz, false});
+}
+
+//! \brief Просит начать все трассы заново со следующего кадра.
+void TraceProcessor::requestReset()
+{
+    m_resetRequests.tryPush(ResetRequest{0.0, 0.0, true});
+}
+
+/*!
+ *  \brief Обновляет включенные трассы по новому кадру.
+ *  \param[in] frame Кадр спектра.
+ *  \return true, если потоку UI нужно отправить уведомление о снимке трасс.
+ */
+bool TraceProcessor::process(const SpectrumFrame &frame)
+{
+    if (m_settingsRequests.consume()) {
+        applySettings(m_settingsRequests.readBuffer());
+    }
+    ResetRequest request;
+    while (m_resetRequests.tryPop(request)) {
+        if (request.all) {
+            clear();
+        } else {
+            reset(request.minHz, request.maxHz);
+        }
+    }
+
+    // Один и тот же кадр может прийти повторно (например, переотправленная
+    // панорама); накапливать его второй раз нельзя.
+    if (frame.isValid() && !(m_hasSequence && frame.sequence() <= m_lastSequence)) {
+        const bool relayout = frame.binCount() != m_input.binCount() || frame.viewMinHz() != m_input.viewMinHz()
+            || frame.viewMaxHz() != m_input.viewMaxHz();
+        const QList<QPair<int, int>> changed = frame.changedBinRanges(m_input);
+        m_input = frame;
+        m_lastSequence = frame.sequence();
+        m_hasSequence = true;
+
+        const float *values = frame.constBins();
+        for (int i = 0; i < kModeCount; ++i) {
+            const Mode mode = static_cast<Mode>(i);
+            if (!isEnabled(mode)) {
+                continue;
+            }
+            SpectrumFrame &trace = m_traces[static_cast<size_t>(i)];
+            if (relayout || !trace.isValid()) {
+                allocate(mode);
+                restart(mode, 0, frame.binCount());
+                continue;
+            }
+
+            // Выданный снимок не изменяется: запись идет в свободную прежнюю версию.
+            SpectrumFrameVersions &versions = m_versions[static_cast<size_t>(i)];
+            versions.prepareWrite(trace);
+            float *acc = trace.bins();
+            for (const QPair<int, int> &range : changed) {
+                const int first = qBound(0, range.first, frame.binCount());
+                const int last = qBound(first, range.second, frame.binCount());
+                const std::int64_t count = last - first;
+                switch (mode) {
+                case Mode::Average:
+                    TraceKernel::average(m_variant, values + first, acc + first, count, m_settings.averageFactor);
+                    break;
+                case Mode::MaxHold:
+                    TraceKernel::maxHold(m_variant, values + first, acc + first, count);
+                    break;
+                case Mode::MinHold:
+                    TraceKernel::minHold(m_variant, values + first, acc + first, count);
+                    break;
+                case Mode::PeakDecay:
+                    TraceKernel::peakDecay(m_variant, values + first, acc + first, count, m_settings.peakDecayDb);
+                    break;
+                }
+                trace.updatePyramid(first, last);
+                trace.markChanged(first, last);
+                versions.markDirty(first, last);
+            }
+            trace.setDbRange(frame.minDb(), frame.maxDb());
+            trace.setSequence(frame.sequence());
+            m_snapshotDirty = true;
+        }
+    }
+    return publish();
+}
+
+/*!
+ *  \brief Забирает последний снимок трасс.
+ *  \param[out] traces Снимок.
+ *  \return true, если получен новый снимок.
+ */
+bool TraceProcessor::takeTraces(SpectrumTraces &traces)
+{
+    m_snapshotPending.store(false, std::memory_order_release);
+    if (!m_snapshots.consume()) {
+        return false;
+    }
+    // Буфер читателя не держит кадры: версии накопителей освобождаются,
+    // как только их отпустит получатель.
+    traces = std::move(m_snapshots.readBuffer());
+    m_snapshots.readBuffer() = SpectrumTraces();
+    return true;
+}
+
+/*!
+ *  \brief Применяет новые параметры.
+ *  \param[in] settings Параметры.
+ */
+void TraceProcessor::applySettings(const Settings &settings)
+{
+    for (int i = 0; i < kModeCount; ++i) {
+        const Mode mode = static_cast<Mode>(i);
+        const bool wasEnabled = isEnabled(mode);
+        const bool enabled = (settings.modes & modeBit(mode)) != 0;
+        if (enabled == wasEnabled) {
+            continue;
+        }
+        m_settings.modes ^= modeBit(mode);
+        if (enabled && m_input.isValid()) {
+            allocate(mode);
+            restart(mode, 0, m_input.binCount());
+        } else if (!enabled) {
+            m_traces[static_cast<size_t>(i)] = SpectrumFrame();
+            m_versions[static_cast<size_t>(i)].clear();
+        }
+        m_snapshotDirty = true;
+    }
+    m_settings = settings;
+}
+
+/*!
+ *  \brief Начинает трассы заново в диапазоне частот.
+ *  \param[in] minHz Нижняя граница, Гц.
+ *  \param[in] maxHz Верхняя граница, Гц.
+ */
+void TraceProcessor::reset(double minHz, double maxHz)
+{
+    if (m_settings.modes == 0 || !m_input.isValid()) {
+        return;
+    }
+    const int firstBin = qBound(0, qFloor(m_input.binPosition(qMin(minHz, maxHz))), m_input.binCount());
+    const int lastBin = qBound(firstBin, qCeil(m_input.binPosition(qMax(minHz, maxHz))), m_input.binCount());
+    if (firstBin == lastBin) {
+        return;
+    }
+    for (int i = 0; i < kModeCount; ++i) {
+        if (isEnabled(static_cast<Mode>(i)) && m_traces[static_cast<size_t>(i)].isValid()) {
+            restart(static_cast<Mode>(i), firstBin, lastBin);
+        }
+    }
+}
+
+//! \brief Забывает накопители и последний кадр.
+void TraceProcessor::clear()
+{
+    for (int i = 0; i < kModeCount; ++i) {
+        if (m_traces[static_cast<size_t>(i)].isValid()) {
+            m_traces[static_cast<size_t>(i)] = SpectrumFrame();
+            m_versions[static_cast<size_t>(i)].clear();
+        }
+    }
+    m_input = SpectrumFrame();
+    m_hasSequence = false;
+}
+
+/*!
+ *  \brief Копирует значения последнего кадра в накопитель трассы.
+ *  \param[in] mode Вид трассы.
+ *  \param[in] firstBin Первое значение.
+ *  \param[in] lastBin Значение за последним.
+ */
+void TraceProcessor::restart(Mode mode, int firstBin, int lastBin)
+{
+    SpectrumFrame &trace = m_traces[static_cast<size_t>(mode)];
+    SpectrumFrameVersions &versions = m_versions[static_cast<size_t>(mode)];
+    versions.prepareWrite(trace);
+    std::copy(m_input.constBins() + firstBin, m_input.constBins() + lastBin, trace.bins() + firstBin);
+    trace.updatePyramid(firstBin, lastBin);
+    trace.markChanged(firstBin, lastBin);
+    versions.markDirty(firstBin, lastBin);
+    m_snapshotDirty = true;
+}
+
+//! \brief Создает накопитель трассы с разметкой последнего кадра.
+void TraceProcessor::allocate(Mode mode)
+{
+    SpectrumFrame trace(m_input.binCount());
+    trace.setSpan(m_input.viewMinHz(), m_input.viewMaxHz());
+    trace.setDbRange(m_input.minDb(), m_input.maxDb());
+    trace.setLayoutId(SpectrumFrame::allocateLayoutId());
+    trace.setSequence(m_input.sequence());
+    trace.rebuildPyramid();
+    m_traces[static_cast<size_t>(mode)] = trace;
+    m_versions[static_cast<size_t>(mode)].clear();
+}
+
+/*!
+ *  \brief Публикует снимок трасс.
+ *  \return true, если потоку UI нужно отправить уведомление о снимке.
+ */
+bool TraceProcessor::publish()
+{
+    if (!m_snapshotDirty) {
+        return false;
+    }
+    m_snapshotDirty = false;
+    m_snapshots.writeBuffer().frames = m_traces;
+    m_snapshots.publish();
+    // Вернувшийся буфер писателя — непрочитанный снимок или пустой буфер
+    // читателя; прежние версии в нем не должны оставаться занятыми.
+    m_snapshots.writeBuffer() = SpectrumTraces();
+    for (SpectrumFrameVersions &versions : m_versions) {
+        versions.markPublished();
+    }
+    return !m_snapshotPending.exchange(true, std::memory_order_acq_rel);
+}
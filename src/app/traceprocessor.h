@@ -0,0 +1,206 @@
+/*!
+ *  \file traceprocessor.h
+ *  \brief Накопление трасс обработки спектра: среднее, удержание максимума и минимума, пик со спадом.
+ */
+#ifndef TRACEPROCESSOR_H
+#define TRACEPROCESSOR_H
+
+#include <QList>
+#include <QMetaType>
+#include <QPair>
+#include <QtQml/qqmlregistration.h>
+
+#include <array>
+#include <atomic>
+
+#include "latestvalueslot.h"
+#include "spectrumframe.h"
+#include "spectrumframeversions.h"
+#include "spscqueue.h"
+#include "tracekernel.h"
+
+/*!
+ *  \struct SpectrumTraces
+ *  \brief Снимок трасс обработки, передаваемый потоку UI.
+ */
+struct SpectrumTraces
+{
+    Q_GADGET
+    QML_VALUE_TYPE(spectrumTraces)
+
+public:
+    //! \brief Количество видов трасс (TraceProcessor::kModeCount).
+    static constexpr int kTraceCount = 4;
+
+    //! \brief Кадры трасс в порядке TraceProcessor::Mode (пустой — трасса выключена).
+    std::array<SpectrumFrame, kTraceCount> frames;
+};
+
+Q_DECLARE_METATYPE(SpectrumTraces)
+
+/*!
+ *  \class TraceProcessor
+ *  \brief Обновляет на месте накопители трасс по каждому сформированному кадру.
+ *
+ *  Накопитель каждой трассы — собственный кадр SpectrumFrame с пирамидой:
+ *  обновление не выделяет память, а трассы сводятся к колонкам тем же
+ *  SpectrumDecimator, что и основной спектр. На кадр с изменившимися
+ *  участками (версия того же буфера панорамы) обновляются только эти
+ *  участки; N включенных трасс стоят N векторных проходов по ним и
+ *  обновления пирамиды.
+ *
+ *  Кадры обрабатываются в потоке формирования (process()), поэтому в
+ *  трассы попадает каждый кадр, а не только дошедшие до экрана; кадр с уже
+ *  учтенным номером пропускается. Параметры и сбросы публикуются из потока
+ *  UI через LatestValueSlot и SpscQueue, а снимок трасс передается в поток
+ *  UI через LatestValueSlot. Выданные снимки не изменяются: прежние версии
+ *  накопителей держит SpectrumFrameVersions.
+ *
+ *  При смене разметки кадра (число значений или диапазон частот)
+ *  накопители начинаются заново со значений кадра.
+ */
+class TraceProcessor
+{
+public:
+    //! \brief Вид трассы.
+    enum class Mode : int {
+        //! \brief Экспоненциальное среднее.
+        Average = 0,
+        //! \brief Удержание максимума.
+        MaxHold = 1,
+        //! \brief Удержание минимума.
+        MinHold = 2,
+        //! \brief Пик со спадом.
+        PeakDecay = 3
+    };
+
+    //! \brief Количество видов трасс.
+    static constexpr int kModeCount = SpectrumTraces::kTraceCount;
+    //! \brief Емкость очереди запросов сброса.
+    static constexpr std::size_t kResetQueueCapacity = 16;
+
+    //! \brief Параметры трасс.
+    struct Settings
+    {
+        //! \brief Маска включенных трасс из modeBit().
+        int modes = 0;
+        //! \brief Вес нового кадра в среднем (0..1].
+        float averageFactor = 0.1f;
+        //! \brief Спад пика за обновление, дБ (не меньше 0).
+        float peakDecayDb = 0.5f;
+    };
+
+    //! \brief Возвращает бит вида трассы в маске.
+    static constexpr int modeBit(Mode mode) noexcept { return 1 << static_cast<int>(mode); }
+    //! \brief Приводит параметры к допустимым значениям.
+    static Settings normalized(const Settings &settings) noexcept;
+
+    /*!
+     *  \brief Публикует параметры (один поток-писатель, обычно UI).
+     *
+     *  Включенная трасса начинается со значений последнего кадра.
+     *  \param[in] settings Параметры трасс.
+     */
+    void setSettings(const Settings &settings);
+    /*!
+     *  \brief Просит начать трассы заново в диапазоне частот (тот же поток-писатель).
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     */
+    void requestReset(double minHz, double maxHz);
+    /*!
+     *  \brief Просит начать все трассы заново со следующего кадра (тот же поток-писатель).
+     *
+     *  Следующий кадр принимается с любым номером: нужен, когда номера
+     *  кадров идут не по порядку, например после перехода по записи.
+     */
+    void requestReset();
+
+    /*!
+     *  \brief Обновляет включенные трассы по новому кадру (поток DSP).
+     *  \param[in] frame Кадр спектра.
+     *  \return true, если потоку UI нужно отправить уведомление о снимке трасс.
+     */
+    bool process(const SpectrumFrame &frame);
+
+    /*!
+     *  \brief Забирает последний снимок трасс (поток UI).
+     *  \param[out] traces Снимок.
+     *  \return true, если получен новый снимок.
+     */
+    bool takeTraces(SpectrumTraces &traces);
+
+    /*!
+     *  \brief Возвращает кадр трассы (поток DSP).
+     *  \param[in] mode Вид трассы.
+     *  \return Накопитель; пустой кадр, если трасса выключена или кадров еще не было.
+     */
+    const SpectrumFrame &trace(Mode mode) const noexcept { return m_traces[static_cast<size_t>(mode)]; }
+
+private:
+    //! \brief Запрос сброса трасс.
+    struct ResetRequest
+    {
+        //! \brief Нижняя граница, Гц.
+        double minHz = 0.0;
+        //! \brief Верхняя граница, Гц.
+        double maxHz = 0.0;
+        //! \brief Сбросить все трассы до следующего кадра и забыть номер последнего.
+        bool all = false;
+    };
+
+    //! \brief Проверяет, включена ли трасса.
+    bool isEnabled(Mode mode) const noexcept { return (m_settings.modes & modeBit(mode)) != 0; }
+    /*!
+     *  \brief Применяет новые параметры.
+     *  \param[in] settings Параметры.
+     */
+    void applySettings(const Settings &settings);
+    /*!
+     *  \brief Начинает трассы заново в диапазоне частот со значений последнего кадра.
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     */
+    void reset(double minHz, double maxHz);
+    //! \brief Забывает накопители и последний кадр: трассы начнутся со следующего кадра.
+    void clear();
+    /*!
+     *  \brief Копирует значения последнего кадра в накопитель трассы.
+     *  \param[in] mode Вид трассы.
+     *  \param[in] firstBin Первое значение.
+     *  \param[in] lastBin Значение за последним.
+     */
+    void restart(Mode mode, int firstBin, int lastBin);
+    //! \brief Создает накопитель трассы с разметкой последнего кадра.
+    void allocate(Mode mode);
+    //! \brief Публикует снимок трасс, если поток UI забрал предыдущий.
+    bool publish();
+
+    //! \brief Слот параметров.
+    LatestValueSlot<Settings> m_settingsRequests;
+    //! \brief Очередь запросов сброса.
+    SpscQueue<ResetRequest, kResetQueueCapacity> m_resetRequests;
+    //! \brief Слот снимков трасс (поток DSP -> UI).
+    LatestValueSlot<SpectrumTraces> m_snapshots;
+    //! \brief Признак опубликованного и еще не забранного снимка.
+    std::atomic<bool> m_snapshotPending{false};
+
+    //! \brief Вариант векторных ядер.
+    TraceKernel::Variant m_variant = TraceKernel::bestVariant();
+    //! \brief Действующие параметры (поток DSP).
+    Settings m_settings;
+    //! \brief Последний обработанный кадр.
+    SpectrumFrame m_input;
+    //! \brief Номер последнего обработанного кадра.
+    quint64 m_lastSequence = 0;
+    //! \brief Признак того, что номер последнего кадра известен.
+    bool m_hasSequence = false;
+    //! \brief Снимок изменился после последней публикации.
+    bool m_snapshotDirty = false;
+    //! \brief Накопители трасс.
+    std::array<SpectrumFrame, kModeCount> m_traces;
+    //! \brief Прежние версии накопителей, выданные в снимках.
+    std::array<SpectrumFrameVersions, kModeCount> m_versions;
+};
+
+#endif // TRACEPROCESSOR_H
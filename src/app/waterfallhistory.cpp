@@ -0,0 +1,1005 @@
+/*!
+ *  \file waterfallhistory.cpp
+ *  \brief Реализация WaterfallHistory.
+ */
+#include "waterfallhistory.h"
+
+#include "spectrumdecimator.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QtMath>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+//! \brief Наибольшее число базовых колонок.
+constexpr int kMaxColumns = 65536;
+//! \brief Наименьший бюджет памяти. Запрос и добавление строки держат
+//! указатели на плитки одной строки плиток (не больше 256 на уровень),
+//! и вытеснение не должно до них доходить.
+constexpr qint64 kMinHotBytes = qint64(64) << 20;
+//! \brief Период пробуждения потока записи без кадров, мс.
+constexpr int kWakeIntervalMs = 50;
+
+//! \brief Сводит уровни минимумов без учета уровня 0 (нет данных).
+inline quint8 minLevel(quint8 a, quint8 b) noexcept
+{
+    return (a == 0 || (b != 0 && b < a)) ? b : a;
+}
+
+/*!
+ *  \brief Выбирает уровень, на котором пиксель покрывает от одной до двух ячеек.
+ *  \param[in] cellsPerPixel Базовых ячеек на пиксель.
+ *  \param[in] maxLevel Наибольший уровень.
+ *  \return Номер уровня.
+ */
+int levelFor(double cellsPerPixel, int maxLevel)
+{
+    int level = 0;
+    while (level < maxLevel && cellsPerPixel >= static_cast<double>(qint64(2) << level)) {
+        ++level;
+    }
+    return level;
+}
+
+//! \brief Возвращает знак разности.
+inline int direction(qint64 delta) noexcept
+{
+    return (delta > 0) - (delta < 0);
+}
+
+} // namespace
+
+//! \brief Создает хранилище с параметрами по умолчанию.
+WaterfallHistory::WaterfallHistory()
+    : WaterfallHistory(Settings())
+{
+}
+
+/*!
+ *  \brief Приводит параметры к допустимым, создает каталог сегментов и запускает поток записи.
+ *  \param[in] settings Параметры.
+ */
+WaterfallHistory::WaterfallHistory(const Settings &settings)
+    : m_settings(settings)
+{
+    const quint32 columns = qNextPowerOfTwo(static_cast<quint32>(qMax(1, m_settings.columns) - 1));
+    m_settings.columns = qBound(kTileColumns, static_cast<int>(qMin<quint32>(columns, kMaxColumns)), kMaxColumns);
+    if (!(m_settings.maxHz > m_settings.minHz)) {
+        m_settings.maxHz = m_settings.minHz + 1.0;
+    }
+    m_settings.hotBytes = qMax(kMinHotBytes, m_settings.hotBytes);
+    m_settings.coldBytes = qMax<qint64>(0, m_settings.coldBytes);
+
+    m_freqLevels = 0;
+    while ((m_settings.columns >> m_freqLevels) >= kTileColumns) {
+        m_levelOffsets.push_back(m_pyramidColumns);
+        m_pyramidColumns += m_settings.columns >> m_freqLevels;
+        ++m_freqLevels;
+    }
+    m_pyramidRow.resize(static_cast<size_t>(m_pyramidColumns) * 2);
+    m_carry.resize(kTimeLevels);
+    for (int level = 1; level < kTimeLevels; ++level) {
+        m_carry[static_cast<size_t>(level)].resize(m_pyramidRow.size());
+    }
+    m_baseLevels.resize(static_cast<size_t>(m_settings.columns) * 2);
+
+    if (m_settings.coldBytes > 0) {
+        const QString base = m_settings.directory.isEmpty() ? QDir::tempPath() : m_settings.directory;
+        QDir().mkpath(base);
+        m_directory = std::make_unique<QTemporaryDir>(
+            QDir(base).filePath(QStringLiteral("siriusscope-waterfall-XXXXXX")));
+        if (!m_directory->isValid()) {
+            qWarning().noquote() << QStringLiteral("WaterfallHistory: cannot use %1, history is kept in memory only")
+                                        .arg(base);
+            m_directory.reset();
+        }
+    }
+    m_prefetchPool.setMaxThreadCount(1);
+
+    m_writer = QThread::create([this]() { runWriter(); });
+    m_writer->setObjectName(QStringLiteral("WaterfallHistory"));
+    m_writer->start(QThread::LowPriority);
+}
+
+//! \brief Останавливает потоки записи и подкачки; файлы удаляются вместе с каталогом.
+WaterfallHistory::~WaterfallHistory()
+{
+    m_writer->requestInterruption();
+    m_writer->wait();
+    delete m_writer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_prefetchKeys.clear();
+    }
+    m_prefetchPool.waitForDone();
+}
+
+//! \brief Возвращает номер самой старой хранимой строки.
+qint64 WaterfallHistory::firstRow() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_firstRow;
+}
+
+//! \brief Возвращает номер строки, следующей за последней добавленной.
+qint64 WaterfallHistory::rowCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rowCount;
+}
+
+//! \brief Возвращает состояние уровней хранения.
+WaterfallHistory::Stats WaterfallHistory::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats;
+    stats.hotTiles = static_cast<int>(m_hot.size() + m_spilling.size());
+    stats.hotBytes = m_hotBytes + m_spillingBytes;
+    for (const auto &segment : m_segments) {
+        stats.coldTiles += static_cast<int>(segment.second.tileSlots.size());
+    }
+    stats.coldBytes = m_coldBytes;
+    stats.coldMisses = m_coldMisses;
+    stats.prefetchedTiles = m_prefetchedTiles;
+    stats.droppedFrames = m_droppedFrames.load(std::memory_order_relaxed);
+    return stats;
+}
+
+/*!
+ *  \brief Передает кадр потоку записи без копирования значений.
+ *  \param[in] frame Кадр спектра.
+ *  \return false, если кадр пуст или очередь заполнена.
+ */
+bool WaterfallHistory::submit(const SpectrumFrame &frame)
+{
+    if (!frame.isValid()) {
+        return false;
+    }
+    if (!m_queue.tryPush(frame)) {
+        m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    ++m_submittedFrames;
+    m_available.release();
+    return true;
+}
+
+//! \brief Дожидается, пока поток записи обработает все принятые кадры и запишет вытесненные плитки.
+void WaterfallHistory::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_processed.wait(lock, [this]() { return m_processedFrames >= m_submittedFrames; });
+}
+
+/*!
+ *  \brief Дожидается, пока поток записи добавит строки до rowCount.
+ *
+ *  Кадры, отброшенные очисткой, строк не дают: ожидание их строк
+ *  заканчивается по времени.
+ *  \param[in] rowCount Номер строки, следующей за ожидаемой.
+ *  \param[in] timeoutMs Наибольшее время ожидания, мс.
+ *  \return false, если строки не добавлены за отведенное время.
+ */
+bool WaterfallHistory::waitForRows(qint64 rowCount, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    return m_processed.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                                [this, rowCount]() { return m_rowCount >= rowCount; });
+}
+
+/*!
+ *  \brief Скрывает всю историю от запросов и поручает потоку записи удалить плитки и файлы сегментов.
+ *
+ *  Номера строк после очистки продолжают прежние, поэтому строки, уже
+ *  сводимые в уровни по времени, не смешиваются с новыми.
+ */
+void WaterfallHistory::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_clearRequested = true;
+    m_discardBefore = m_submittedFrames;
+    m_firstRow = m_rowCount;
+    m_prefetchKeys.clear();
+    m_lastWindow = Window();
+}
+
+/*!
+ *  \brief Задает обработчик завершения подкачки плиток, недостающих запросу.
+ *  \param[in] handler Обработчик; вызывается в потоке подкачки.
+ */
+void WaterfallHistory::setTilesLoadedHandler(TilesLoadedHandler handler)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tilesLoaded = std::move(handler);
+}
+
+/*!
+ *  \brief Принимает кадры из очереди до остановки хранилища.
+ *
+ *  После каждого кадра его буфер возвращается пулу, а плитки, вытесненные
+ *  из памяти, записываются на диск; без кадров поток просыпается раз в
+ *  kWakeIntervalMs, чтобы выполнить очистку и записать плитки,
+ *  вытесненные подкачкой.
+ */
+void WaterfallHistory::runWriter()
+{
+    while (!m_writer->isInterruptionRequested()) {
+        const bool available = m_available.tryAcquire(1, kWakeIntervalMs);
+        bool clearRequested = false;
+        quint64 discardBefore = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            clearRequested = m_clearRequested;
+            m_clearRequested = false;
+            discardBefore = m_discardBefore;
+        }
+        if (clearRequested) {
+            resetStore();
+        }
+
+        if (!available) {
+            writeSpills();
+            continue;
+        }
+        SpectrumFrame frame;
+        if (!m_queue.tryPop(frame)) {
+            continue;
+        }
+        if (m_processedFrames >= discardBefore) {
+            appendFrame(frame);
+        }
+        frame = SpectrumFrame();
+        writeSpills();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_processedFrames;
+        }
+        m_processed.notify_all();
+    }
+}
+
+/*!
+ *  \brief Сводит кадр к базовым колонкам всего диапазона и добавляет строкой.
+ *  \param[in] frame Кадр спектра.
+ */
+void WaterfallHistory::appendFrame(const SpectrumFrame &frame)
+{
+    const int columns = m_settings.columns;
+    m_minMax.resize(static_cast<size_t>(columns) * 2);
+    SpectrumDecimator::decimateMinMax(frame, m_settings.minHz, m_settings.maxHz, columns, m_minMax.data());
+
+    quint8 *minLevels = m_baseLevels.data();
+    quint8 *maxLevels = minLevels + columns;
+    for (int x = 0; x < columns; ++x) {
+        maxLevels[x] = levelFromDb(m_minMax[static_cast<size_t>(x) * 2 + 1]);
+        minLevels[x] = maxLevels[x] != 0 ? levelFromDb(m_minMax[static_cast<size_t>(x) * 2]) : 0;
+    }
+    appendLevels(minLevels, maxLevels);
+}
+
+/*!
+ *  \brief Строит пирамиду строки по частоте и сводит ее в уровни по времени.
+ *
+ *  Строка уровня lt получается из пары строк уровня lt - 1: первая строка
+ *  пары ждет вторую в m_carry, так что на строку приходится в среднем
+ *  меньше двух сведений пирамиды. Буферы пирамиды принадлежат потоку
+ *  записи, поэтому мьютекс берется только на запись в плитки.
+ *  \param[in] minLevels Уровни минимумов.
+ *  \param[in] maxLevels Уровни максимумов.
+ */
+void WaterfallHistory::appendLevels(const quint8 *minLevels, const quint8 *maxLevels)
+{
+    const int columns = m_settings.columns;
+    const size_t planeSize = static_cast<size_t>(m_pyramidColumns);
+    quint8 *maxPlane = m_pyramidRow.data();
+    quint8 *minPlane = maxPlane + planeSize;
+    std::memcpy(maxPlane, maxLevels, static_cast<size_t>(columns));
+    std::memcpy(minPlane, minLevels, static_cast<size_t>(columns));
+    for (int level = 1; level < m_freqLevels; ++level) {
+        const int from = m_levelOffsets[static_cast<size_t>(level - 1)];
+        const int to = m_levelOffsets[static_cast<size_t>(level)];
+        const int count = columns >> level;
+        for (int c = 0; c < count; ++c) {
+            maxPlane[to + c] = std::max(maxPlane[from + 2 * c], maxPlane[from + 2 * c + 1]);
+            minPlane[to + c] = minLevel(minPlane[from + 2 * c], minPlane[from + 2 * c + 1]);
+        }
+    }
+
+    m_rowWrites.clear();
+    m_rowWrites.push_back(RowWrite{0, m_rowCount, m_pyramidRow.data()});
+    const quint8 *row = m_pyramidRow.data();
+    for (int level = 1; level < kTimeLevels; ++level) {
+        const qint64 index = m_rowCount >> (level - 1);
+        quint8 *carry = m_carry[static_cast<size_t>(level)].data();
+        if ((index & 1) == 0) {
+            std::memcpy(carry, row, planeSize * 2);
+            break;
+        }
+        for (size_t i = 0; i < planeSize; ++i) {
+            carry[i] = std::max(carry[i], row[i]);
+        }
+        for (size_t i = planeSize; i < planeSize * 2; ++i) {
+            carry[i] = minLevel(carry[i], row[i]);
+        }
+        m_rowWrites.push_back(RowWrite{level, index >> 1, carry});
+        row = carry;
+    }
+
+    loadRowTiles();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto &loaded : m_loadedTiles) {
+        if (m_hot.count(loaded.first) == 0 && m_spilling.count(loaded.first) == 0) {
+            insertHot(loaded.first, std::move(loaded.second), false);
+        }
+    }
+    m_loadedTiles.clear();
+    for (const RowWrite &write : m_rowWrites) {
+        writeRow(write.timeLevel, write.levelRow, write.row);
+    }
+    ++m_rowCount;
+}
+
+/*!
+ *  \brief Читает с диска плитки строк m_rowWrites, вытесненные из памяти.
+ *
+ *  Файлы сегментов пишет и удаляет только поток записи, поэтому место
+ *  плитки, найденное под мьютексом, остается верным и после его снятия.
+ */
+void WaterfallHistory::loadRowTiles()
+{
+    std::vector<std::pair<quint64, ColdSlot>> reads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_segments.empty()) {
+            return;
+        }
+        for (const RowWrite &write : m_rowWrites) {
+            const qint64 tileRow = write.levelRow / kTileRows;
+            for (int level = 0; level < m_freqLevels; ++level) {
+                const int tiles = (m_settings.columns >> level) / kTileColumns;
+                for (int column = 0; column < tiles; ++column) {
+                    const quint64 key = tileKey(write.timeLevel, level, tileRow, column);
+                    if (m_hot.count(key) != 0 || m_spilling.count(key) != 0) {
+                        continue;
+                    }
+                    const auto segment = m_segments.find(segmentOf(key));
+                    if (segment == m_segments.end()) {
+                        continue;
+                    }
+                    const auto slot = segment->second.tileSlots.find(key);
+                    if (slot != segment->second.tileSlots.end()) {
+                        reads.emplace_back(key, slot->second);
+                    }
+                }
+            }
+        }
+    }
+
+    for (const auto &read : reads) {
+        QFile *file = m_segments.find(segmentOf(read.first))->second.file.get();
+        auto data = std::make_unique<quint8[]>(static_cast<size_t>(kTileBytes));
+        if (file && file->seek(read.second.offset)
+            && file->read(reinterpret_cast<char *>(data.get()), kTileBytes) == kTileBytes) {
+            m_loadedTiles.emplace_back(read.first, std::move(data));
+        }
+    }
+}
+
+/*!
+ *  \brief Сводит участок истории к изображению width x height.
+ *
+ *  Уровни выбираются так, чтобы пиксель покрывал от одной до двух ячеек
+ *  по каждой оси; строки, еще не сведенные в ячейку выбранного уровня по
+ *  времени (последние 2^lt - 1), остаются пустыми. Читаются только
+ *  плитки в памяти: плитки с диска ставятся в подкачку первыми.
+ *  \return false, если часть плиток была только на диске.
+ */
+bool WaterfallHistory::query(qint64 firstRow, qint64 lastRow, double minHz, double maxHz, int width, int height,
+                             quint8 *maxLevels, quint8 *minLevels)
+{
+    if (!maxLevels || width <= 0 || height <= 0) {
+        return true;
+    }
+    const size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+    std::fill_n(maxLevels, pixels, quint8(0));
+    if (minLevels) {
+        std::fill_n(minLevels, pixels, quint8(0));
+    }
+    if (lastRow <= firstRow || !(maxHz > minHz)) {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const double rowsPerPixel = static_cast<double>(lastRow - firstRow) / height;
+    const double columnsPerHz = m_settings.columns / (m_settings.maxHz - m_settings.minHz);
+    const double columnsPerPixel = (maxHz - minHz) * columnsPerHz / width;
+
+    Window window;
+    window.timeLevel = levelFor(rowsPerPixel, kTimeLevels - 1);
+    window.freqLevel = levelFor(columnsPerPixel, m_freqLevels - 1);
+    const double rowScale = 1.0 / static_cast<double>(qint64(1) << window.timeLevel);
+    const double cellScale = 1.0 / static_cast<double>(1 << window.freqLevel);
+    const int levelColumns = m_settings.columns >> window.freqLevel;
+
+    // Ячейки колонок изображения на выбранном уровне по частоте.
+    m_cellRanges.resize(static_cast<size_t>(width) * 2);
+    const double firstCell = (minHz - m_settings.minHz) * columnsPerHz * cellScale;
+    const double cellsPerPixel = columnsPerPixel * cellScale;
+    int firstUsed = levelColumns;
+    int lastUsed = -1;
+    for (int x = 0; x < width; ++x) {
+        const double start = std::floor(firstCell + x * cellsPerPixel);
+        const double end = std::max(start + 1.0, std::floor(firstCell + (x + 1) * cellsPerPixel));
+        const int first = static_cast<int>(qBound(0.0, start, static_cast<double>(levelColumns)));
+        const int last = static_cast<int>(qBound(static_cast<double>(first), end, static_cast<double>(levelColumns)));
+        m_cellRanges[static_cast<size_t>(x) * 2] = first;
+        m_cellRanges[static_cast<size_t>(x) * 2 + 1] = last;
+        if (first < last) {
+            firstUsed = std::min(firstUsed, first);
+            lastUsed = std::max(lastUsed, last - 1);
+        }
+    }
+
+    // Строки уровня, полностью сведенные и еще хранимые.
+    const qint64 levelFirst = (m_firstRow + (qint64(1) << window.timeLevel) - 1) >> window.timeLevel;
+    const qint64 levelEnd = m_rowCount >> window.timeLevel;
+    const qint64 firstLevelRow = std::max(levelFirst, static_cast<qint64>(std::floor(firstRow * rowScale)));
+    const qint64 lastLevelRow = std::min(levelEnd, static_cast<qint64>(std::ceil(lastRow * rowScale)));
+    if (lastUsed < 0 || firstLevelRow >= lastLevelRow) {
+        return true;
+    }
+
+    window.firstTileColumn = firstUsed / kTileColumns;
+    window.lastTileColumn = lastUsed / kTileColumns;
+    window.firstTileRow = firstLevelRow / kTileRows;
+    window.lastTileRow = (lastLevelRow - 1) / kTileRows;
+    const size_t tileCount = static_cast<size_t>(window.lastTileColumn - window.firstTileColumn + 1);
+    m_rowTiles.assign(tileCount, nullptr);
+    qint64 loadedTileRow = -1;
+    // Строка уровня собирается из плиток в непрерывный буфер, начинающийся с первой плитки окна.
+    const size_t bufferColumns = tileCount * kTileColumns;
+    m_rowCells.resize(bufferColumns * 2);
+    quint8 *cellMax = m_rowCells.data();
+    quint8 *cellMin = cellMax + bufferColumns;
+    const int bufferOrigin = window.firstTileColumn * kTileColumns;
+    for (int &cell : m_cellRanges) {
+        cell -= bufferOrigin;
+    }
+    m_missingKeys.clear();
+
+    qint64 previousFirst = -1;
+    qint64 previousLast = -1;
+    for (int y = 0; y < height; ++y) {
+        const double start = std::floor((firstRow + y * rowsPerPixel) * rowScale);
+        const double end = std::max(start + 1.0, std::floor((firstRow + (y + 1) * rowsPerPixel) * rowScale));
+        const qint64 rowFirst = std::max(levelFirst, static_cast<qint64>(start));
+        const qint64 rowLast = std::min(levelEnd, static_cast<qint64>(end));
+        quint8 *outMax = maxLevels + static_cast<size_t>(y) * static_cast<size_t>(width);
+        quint8 *outMin = minLevels ? minLevels + static_cast<size_t>(y) * static_cast<size_t>(width) : nullptr;
+
+        // При растяжении по времени соседние строки изображения берут одни и те же строки уровня.
+        if (rowFirst == previousFirst && rowLast == previousLast) {
+            std::memcpy(outMax, outMax - width, static_cast<size_t>(width));
+            if (outMin) {
+                std::memcpy(outMin, outMin - width, static_cast<size_t>(width));
+            }
+            continue;
+        }
+        previousFirst = rowFirst;
+        previousLast = rowLast;
+
+        for (qint64 row = rowFirst; row < rowLast; ++row) {
+            const qint64 tileRow = row / kTileRows;
+            if (tileRow != loadedTileRow) {
+                for (size_t i = 0; i < tileCount; ++i) {
+                    const quint64 key = tileKey(window.timeLevel, window.freqLevel, tileRow,
+                                                window.firstTileColumn + static_cast<int>(i));
+                    m_rowTiles[i] = residentTile(key);
+                    if (!m_rowTiles[i] && isCold(key)) {
+                        m_missingKeys.push_back(key);
+                    }
+                }
+                loadedTileRow = tileRow;
+            }
+            const int rowOffset = static_cast<int>(row % kTileRows) * kTileColumns;
+            for (size_t i = 0; i < tileCount; ++i) {
+                const quint8 *data = m_rowTiles[i];
+                if (data) {
+                    std::memcpy(cellMax + i * kTileColumns, data + rowOffset, kTileColumns);
+                } else {
+                    std::memset(cellMax + i * kTileColumns, 0, kTileColumns);
+                }
+                if (outMin && data) {
+                    std::memcpy(cellMin + i * kTileColumns, data + kTileRows * kTileColumns + rowOffset, kTileColumns);
+                } else if (outMin) {
+                    std::memset(cellMin + i * kTileColumns, 0, kTileColumns);
+                }
+            }
+
+            for (int x = 0; x < width; ++x) {
+                const int first = m_cellRanges[static_cast<size_t>(x) * 2];
+                const int last = m_cellRanges[static_cast<size_t>(x) * 2 + 1];
+                quint8 maxValue = outMax[x];
+                for (int cell = first; cell < last; ++cell) {
+                    maxValue = std::max(maxValue, cellMax[cell]);
+                }
+                outMax[x] = maxValue;
+            }
+            if (outMin) {
+                for (int x = 0; x < width; ++x) {
+                    const int first = m_cellRanges[static_cast<size_t>(x) * 2];
+                    const int last = m_cellRanges[static_cast<size_t>(x) * 2 + 1];
+                    quint8 minValue = outMin[x];
+                    for (int cell = first; cell < last; ++cell) {
+                        minValue = minLevel(minValue, cellMin[cell]);
+                    }
+                    outMin[x] = minValue;
+                }
+            }
+        }
+    }
+
+    m_coldMisses += m_missingKeys.size();
+    schedulePrefetch(window, m_missingKeys);
+    return m_missingKeys.empty();
+}
+
+/*!
+ *  \brief Квантует мощность в уровень.
+ *  \param[in] db Мощность, дБ; пустая колонка сведения дает бесконечность.
+ *  \return Уровень 1..255 или 0.
+ */
+quint8 WaterfallHistory::levelFromDb(float db) noexcept
+{
+    if (!std::isfinite(db)) {
+        return 0;
+    }
+    return static_cast<quint8>(qBound(1.0f, std::round((db - kFloorDb) / kStepDb) + 1.0f, 255.0f));
+}
+
+/*!
+ *  \brief Возвращает мощность уровня.
+ *  \param[in] level Уровень.
+ *  \return Мощность, дБ; для уровня 0 — минус бесконечность.
+ */
+float WaterfallHistory::dbFromLevel(quint8 level) noexcept
+{
+    if (level == 0) {
+        return -std::numeric_limits<float>::infinity();
+    }
+    return kFloorDb + static_cast<float>(level - 1) * kStepDb;
+}
+
+//! \brief Составляет ключ плитки: строка плиток, колонка, уровень по частоте, уровень по времени.
+quint64 WaterfallHistory::tileKey(int timeLevel, int freqLevel, qint64 tileRow, int tileColumn) noexcept
+{
+    return (static_cast<quint64>(tileRow) << 24) | (static_cast<quint64>(tileColumn) << 8)
+           | (static_cast<quint64>(freqLevel) << 3) | static_cast<quint64>(timeLevel);
+}
+
+//! \brief Возвращает номер сегмента по первой строке плитки.
+qint64 WaterfallHistory::segmentOf(quint64 key) noexcept
+{
+    const int timeLevel = static_cast<int>(key & 7);
+    const qint64 tileRow = static_cast<qint64>(key >> 24);
+    return ((tileRow * kTileRows) << timeLevel) / kSegmentRows;
+}
+
+/*!
+ *  \brief Записывает строку пирамиды уровня по времени во все плитки строки (под мьютексом).
+ *  \param[in] timeLevel Уровень по времени.
+ *  \param[in] levelRow Номер строки на уровне.
+ *  \param[in] pyramidRow Плоскость максимумов и плоскость минимумов всех уровней по частоте.
+ */
+void WaterfallHistory::writeRow(int timeLevel, qint64 levelRow, const quint8 *pyramidRow)
+{
+    const qint64 tileRow = levelRow / kTileRows;
+    const int rowOffset = static_cast<int>(levelRow % kTileRows) * kTileColumns;
+    const quint8 *maxPlane = pyramidRow;
+    const quint8 *minPlane = pyramidRow + m_pyramidColumns;
+    for (int level = 0; level < m_freqLevels; ++level) {
+        const int tiles = (m_settings.columns >> level) / kTileColumns;
+        for (int column = 0; column < tiles; ++column) {
+            quint8 *data = writableTile(tileKey(timeLevel, level, tileRow, column));
+            const int source = m_levelOffsets[static_cast<size_t>(level)] + column * kTileColumns;
+            std::memcpy(data + rowOffset, maxPlane + source, kTileColumns);
+            std::memcpy(data + kTileRows * kTileColumns + rowOffset, minPlane + source, kTileColumns);
+        }
+    }
+}
+
+/*!
+ *  \brief Возвращает плитку для записи и помечает ее измененной.
+ *
+ *  Плитки с диска к этому моменту уже прочитаны loadRowTiles(); плитка,
+ *  ожидающая записи на диск, возвращается в память.
+ *  \param[in] key Ключ плитки.
+ *  \return Данные плитки.
+ */
+quint8 *WaterfallHistory::writableTile(quint64 key)
+{
+    const auto hot = m_hot.find(key);
+    if (hot != m_hot.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, hot->second.lru);
+        hot->second.dirty = true;
+        return hot->second.data.get();
+    }
+
+    const auto spilling = m_spilling.find(key);
+    if (spilling != m_spilling.end()) {
+        std::unique_ptr<quint8[]> data = std::move(spilling->second);
+        m_spilling.erase(spilling);
+        m_spillingBytes -= kTileBytes;
+        return insertHot(key, std::move(data), true);
+    }
+    return insertHot(key, std::make_unique<quint8[]>(static_cast<size_t>(kTileBytes)), true);
+}
+
+/*!
+ *  \brief Возвращает плитку из памяти, отмечая ее использование.
+ *  \param[in] key Ключ плитки.
+ *  \return Данные или nullptr, если плитка только на диске или ее нет.
+ */
+const quint8 *WaterfallHistory::residentTile(quint64 key)
+{
+    const auto hot = m_hot.find(key);
+    if (hot != m_hot.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, hot->second.lru);
+        return hot->second.data.get();
+    }
+    const auto spilling = m_spilling.find(key);
+    return spilling != m_spilling.end() ? spilling->second.get() : nullptr;
+}
+
+//! \brief Проверяет, записана ли плитка в файл сегмента.
+bool WaterfallHistory::isCold(quint64 key) const
+{
+    const auto segment = m_segments.find(segmentOf(key));
+    return segment != m_segments.end() && segment->second.tileSlots.count(key) != 0;
+}
+
+/*!
+ *  \brief Помещает плитку в начало списка давности, вытесняя самые давние.
+ *
+ *  Измененные плитки не пишутся здесь на диск, а переходят в m_spilling,
+ *  откуда их забирает поток записи; без холодного уровня они теряются.
+ *  \param[in] key Ключ плитки.
+ *  \param[in] data Данные плитки.
+ *  \param[in] dirty Плитка отличается от своей копии на диске.
+ *  \return Данные плитки.
+ */
+quint8 *WaterfallHistory::insertHot(quint64 key, std::unique_ptr<quint8[]> data, bool dirty)
+{
+    while (m_hotBytes + kTileBytes > m_settings.hotBytes && !m_lru.empty()) {
+        const auto victim = m_hot.find(m_lru.back());
+        if (victim->second.dirty && m_directory) {
+            m_spilling[victim->first] = std::move(victim->second.data);
+            m_spillingBytes += kTileBytes;
+        }
+        m_lru.pop_back();
+        m_hot.erase(victim);
+        m_hotBytes -= kTileBytes;
+    }
+
+    m_lru.push_front(key);
+    HotTile &entry = m_hot[key];
+    entry.data = std::move(data);
+    entry.lru = m_lru.begin();
+    entry.dirty = dirty;
+    m_hotBytes += kTileBytes;
+    return entry.data.get();
+}
+
+/*!
+ *  \brief Записывает вытесненные плитки в их места в файлах сегментов или в конец файлов.
+ *
+ *  Места выделяются под мьютексом, запись идет без него: запросы тем
+ *  временем читают плитки из m_spilling. Плитка покидает m_spilling и
+ *  получает новую версию места только после записи, поэтому подкачка не
+ *  примет недописанную копию. Затем соблюдается дисковый бюджет.
+ */
+void WaterfallHistory::writeSpills()
+{
+    struct Spill
+    {
+        quint64 key;
+        const quint8 *data;
+        qint64 offset;
+        bool appended;
+        bool written;
+    };
+    std::vector<Spill> spills;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_spilling.empty()) {
+            return;
+        }
+        spills.reserve(m_spilling.size());
+        for (const auto &entry : m_spilling) {
+            Segment &segment = m_segments[segmentOf(entry.first)];
+            const auto slot = segment.tileSlots.find(entry.first);
+            if (slot != segment.tileSlots.end()) {
+                spills.push_back(Spill{entry.first, entry.second.get(), slot->second.offset, false, false});
+            } else {
+                spills.push_back(Spill{entry.first, entry.second.get(), segment.end, true, false});
+                segment.end += kTileBytes;
+            }
+        }
+    }
+
+    for (Spill &spill : spills) {
+        const qint64 index = segmentOf(spill.key);
+        Segment &segment = m_segments.find(index)->second;
+        if (!segment.file) {
+            // Без буфера QFile запись сразу видна потоку подкачки, читающему свой дескриптор.
+            auto file = std::make_unique<QFile>(segmentPath(index));
+            if (!file->open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Unbuffered)) {
+                continue;
+            }
+            segment.file = std::move(file);
+        }
+        spill.written = segment.file->seek(spill.offset)
+                        && segment.file->write(reinterpret_cast<const char *>(spill.data), kTileBytes) == kTileBytes;
+    }
+
+    std::vector<std::unique_ptr<QFile>> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const Spill &spill : spills) {
+            // Незаписанная плитка теряется.
+            m_spilling.erase(spill.key);
+            m_spillingBytes -= kTileBytes;
+            if (!spill.written) {
+                continue;
+            }
+            Segment &segment = m_segments.find(segmentOf(spill.key))->second;
+            if (spill.appended) {
+                segment.tileSlots.emplace(spill.key, ColdSlot{spill.offset, ++m_spillVersion});
+                m_coldBytes += kTileBytes;
+            } else {
+                segment.tileSlots[spill.key].version = ++m_spillVersion;
+            }
+        }
+        enforceRetention(removed);
+    }
+    for (const auto &file : removed) {
+        file->remove();
+    }
+}
+
+//! \brief Удаляет плитки и сегменты по запросу clear(); пары уровней по времени начинаются заново.
+void WaterfallHistory::resetStore()
+{
+    std::vector<std::unique_ptr<QFile>> removed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_hot.clear();
+        m_lru.clear();
+        m_hotBytes = 0;
+        m_spilling.clear();
+        m_spillingBytes = 0;
+        for (auto &segment : m_segments) {
+            if (segment.second.file) {
+                removed.push_back(std::move(segment.second.file));
+            }
+        }
+        m_segments.clear();
+        m_coldBytes = 0;
+        m_firstRow = m_rowCount;
+        m_prefetchKeys.clear();
+    }
+    for (auto &carry : m_carry) {
+        std::fill(carry.begin(), carry.end(), quint8(0));
+    }
+    for (const auto &file : removed) {
+        file->remove();
+    }
+}
+
+/*!
+ *  \brief Удаляет самые старые сегменты, пока диск превышает бюджет (текущий сегмент не удаляется).
+ *  \param[out] removed Файлы удаленных сегментов: удаляются с диска после снятия мьютекса.
+ */
+void WaterfallHistory::enforceRetention(std::vector<std::unique_ptr<QFile>> &removed)
+{
+    const qint64 current = (m_rowCount - 1) / kSegmentRows;
+    while (m_coldBytes > m_settings.coldBytes && !m_segments.empty() && m_segments.begin()->first < current) {
+        dropSegment(m_segments.begin()->first, removed);
+    }
+}
+
+/*!
+ *  \brief Удаляет сегмент, плитки в памяти не новее его и его строки.
+ *  \param[in] index Номер сегмента.
+ *  \param[out] removed Файл сегмента.
+ */
+void WaterfallHistory::dropSegment(qint64 index, std::vector<std::unique_ptr<QFile>> &removed)
+{
+    const auto segment = m_segments.find(index);
+    if (segment != m_segments.end()) {
+        m_coldBytes -= static_cast<qint64>(segment->second.tileSlots.size()) * kTileBytes;
+        if (segment->second.file) {
+            removed.push_back(std::move(segment->second.file));
+        }
+        m_segments.erase(segment);
+    }
+
+    for (auto it = m_hot.begin(); it != m_hot.end();) {
+        if (segmentOf(it->first) <= index) {
+            m_lru.erase(it->second.lru);
+            it = m_hot.erase(it);
+            m_hotBytes -= kTileBytes;
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_spilling.begin(); it != m_spilling.end();) {
+        if (segmentOf(it->first) <= index) {
+            it = m_spilling.erase(it);
+            m_spillingBytes -= kTileBytes;
+        } else {
+            ++it;
+        }
+    }
+
+    m_firstRow = std::max(m_firstRow, (index + 1) * kSegmentRows);
+}
+
+//! \brief Возвращает путь файла сегмента.
+QString WaterfallHistory::segmentPath(qint64 index) const
+{
+    return m_directory->filePath(QStringLiteral("segment-%1.tiles").arg(index));
+}
+
+/*!
+ *  \brief Ставит в очередь подкачки недостающие плитки запроса и плитки окна, следующего за ним.
+ *
+ *  Недостающие плитки идут первыми. Направление соседнего окна берется из
+ *  сдвига окна относительно прошлого запроса на тех же уровнях; при смене
+ *  масштаба оно не планируется. Ставятся только плитки, лежащие на диске
+ *  и отсутствующие в памяти, ближайшие к текущему окну первыми, всего не
+ *  больше половины бюджета памяти.
+ *  \param[in] window Окно текущего запроса.
+ *  \param[in] missing Плитки запроса, лежащие только на диске.
+ */
+void WaterfallHistory::schedulePrefetch(const Window &window, const std::vector<quint64> &missing)
+{
+    const Window previous = m_lastWindow;
+    m_lastWindow = window;
+    const size_t limit = static_cast<size_t>(m_settings.hotBytes / 2 / kTileBytes);
+    std::vector<quint64> keys;
+
+    const int rowShift = direction((window.firstTileRow + window.lastTileRow)
+                                   - (previous.firstTileRow + previous.lastTileRow));
+    const int columnShift = direction(static_cast<qint64>(window.firstTileColumn + window.lastTileColumn)
+                                      - (previous.firstTileColumn + previous.lastTileColumn));
+    if (!m_segments.empty() && previous.timeLevel == window.timeLevel && previous.freqLevel == window.freqLevel
+        && (rowShift != 0 || columnShift != 0)) {
+        const qint64 rowSpan = window.lastTileRow - window.firstTileRow + 1;
+        const int columnSpan = window.lastTileColumn - window.firstTileColumn + 1;
+        const qint64 levelFirst = (m_firstRow + (qint64(1) << window.timeLevel) - 1) >> window.timeLevel;
+        const qint64 levelEnd = m_rowCount >> window.timeLevel;
+        const qint64 minTileRow = levelFirst / kTileRows;
+        const qint64 maxTileRow = levelEnd > 0 ? (levelEnd - 1) / kTileRows : -1;
+        const int maxTileColumn = ((m_settings.columns >> window.freqLevel) / kTileColumns) - 1;
+
+        const qint64 firstTileRow = qMax(minTileRow, window.firstTileRow + rowShift * rowSpan);
+        const qint64 lastTileRow = qMin(maxTileRow, window.lastTileRow + rowShift * rowSpan);
+        const int firstTileColumn = qMax(0, window.firstTileColumn + columnShift * columnSpan);
+        const int lastTileColumn = qMin(maxTileColumn, window.lastTileColumn + columnShift * columnSpan);
+        const size_t neighbourLimit = limit - qMin(limit, missing.size());
+
+        // Обход от стороны, примыкающей к текущему окну.
+        for (qint64 i = 0; i <= lastTileRow - firstTileRow && keys.size() < neighbourLimit; ++i) {
+            const qint64 tileRow = rowShift < 0 ? lastTileRow - i : firstTileRow + i;
+            for (int j = 0; j <= lastTileColumn - firstTileColumn && keys.size() < neighbourLimit; ++j) {
+                const int tileColumn = columnShift < 0 ? lastTileColumn - j : firstTileColumn + j;
+                const quint64 key = tileKey(window.timeLevel, window.freqLevel, tileRow, tileColumn);
+                if (m_hot.count(key) == 0 && m_spilling.count(key) == 0 && isCold(key)) {
+                    keys.push_back(key);
+                }
+            }
+        }
+        std::reverse(keys.begin(), keys.end());
+    }
+    const size_t missingCount = qMin(limit, missing.size());
+    keys.insert(keys.end(), missing.begin(), missing.begin() + static_cast<std::ptrdiff_t>(missingCount));
+    m_prefetchKeys = std::move(keys);
+    m_missingQueued = m_missingQueued || !missing.empty();
+
+    if (!m_prefetchKeys.empty() && !m_prefetchRunning && !m_stopping) {
+        m_prefetchRunning = true;
+        m_prefetchPool.start([this]() { runPrefetch(); });
+    }
+}
+
+/*!
+ *  \brief Читает плитки из очереди подкачки без блокировки хранилища на время чтения.
+ *
+ *  Плитка помещается в память, только если за время чтения она не
+ *  появилась там и не была перезаписана на диске. Если в очереди были
+ *  плитки, недостающие запросу, по ее опустошении вызывается обработчик
+ *  setTilesLoadedHandler().
+ */
+void WaterfallHistory::runPrefetch()
+{
+    QFile file;
+    qint64 openSegment = -1;
+    auto data = std::make_unique<quint8[]>(static_cast<size_t>(kTileBytes));
+
+    for (;;) {
+        quint64 key = 0;
+        ColdSlot slot;
+        qint64 index = -1;
+        TilesLoadedHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            while (!m_stopping && !m_prefetchKeys.empty()) {
+                const quint64 candidate = m_prefetchKeys.back();
+                m_prefetchKeys.pop_back();
+                if (m_hot.count(candidate) != 0 || m_spilling.count(candidate) != 0) {
+                    continue;
+                }
+                const auto segment = m_segments.find(segmentOf(candidate));
+                if (segment == m_segments.end()) {
+                    continue;
+                }
+                const auto found = segment->second.tileSlots.find(candidate);
+                if (found != segment->second.tileSlots.end()) {
+                    key = candidate;
+                    slot = found->second;
+                    index = segment->first;
+                    break;
+                }
+            }
+            if (index < 0) {
+                m_prefetchRunning = false;
+                if (m_missingQueued && !m_stopping) {
+                    handler = m_tilesLoaded;
+                }
+                m_missingQueued = false;
+            }
+        }
+        if (index < 0) {
+            if (handler) {
+                handler();
+            }
+            return;
+        }
+
+        if (index != openSegment) {
+            file.close();
+            file.setFileName(segmentPath(index));
+            openSegment = file.open(QIODevice::ReadOnly | QIODevice::Unbuffered) ? index : -1;
+        }
+        if (openSegment < 0 || !file.seek(slot.offset)
+            || file.read(reinterpret_cast<char *>(data.get()), kTileBytes) != kTileBytes) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping || m_hot.count(key) != 0 || m_spilling.count(key) != 0) {
+            continue;
+        }
+        const auto segment = m_segments.find(index);
+        if (segment == m_segments.end()) {
+            continue;
+        }
+        const auto found = segment->second.tileSlots.find(key);
+        if (found == segment->second.tileSlots.end() || found->second.version != slot.version) {
+            continue;
+        }
+        insertHot(key, std::move(data), false);
+        ++m_prefetchedTiles;
+        data = std::make_unique<quint8[]>(static_cast<size_t>(kTileBytes));
+    }
+}
@@ -0,0 +1,388 @@
+/*!
+ *  \file waterfallhistory.h
+ *  \brief Хранилище истории водопада: плитки время x частота с пирамидой min/max.
+ */
+#ifndef WATERFALLHISTORY_H
+#define WATERFALLHISTORY_H
+
+#include <QFile>
+#include <QSemaphore>
+#include <QString>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "spectrumframe.h"
+#include "spscqueue.h"
+
+/*!
+ *  \class WaterfallHistory
+ *  \brief История кадров спектра по всему диапазону с выборкой в любом масштабе.
+ *
+ *  Каждый кадр сводится к settings().columns базовым колонкам по всему
+ *  диапазону [minHz, maxHz] и квантуется в уровни 1..255 с шагом kStepDb
+ *  (0 — нет данных). Из базовой строки строится пирамида уровней,
+ *  независимых по частоте (каждый следующий вдвое уже) и по времени
+ *  (каждый следующий сводит вдвое больше строк): ячейка уровня (lt, lf)
+ *  хранит min и max по 2^lt строкам и 2^lf базовым колонкам. Уровни
+ *  нарезаны на плитки kTileRows x kTileColumns ячеек.
+ *
+ *  Плитки держатся в памяти (горячий уровень) и вытесняются по давности
+ *  использования в файлы сегментов на диске (холодный уровень); сегмент
+ *  хранит все плитки kSegmentRows строк, и при превышении дискового
+ *  бюджета удаляется самый старый сегмент вместе с его строками.
+ *
+ *  Кадры передаются через submit() без блокировки и сводятся, пишутся в
+ *  плитки и вытесняются на диск в собственном потоке записи; чтение и
+ *  запись файлов идут вне внутреннего мьютекса. Запрос query() читает
+ *  только плитки в памяти: недостающие плитки окна подкачиваются с диска
+ *  в отдельном потоке, после чего вызывается обработчик
+ *  setTilesLoadedHandler(). Туда же после запроса ставятся плитки
+ *  соседнего окна по направлению сдвига обзора.
+ *
+ *  Запрос выбирает уровни, на которых пиксель покрывает одну-две ячейки
+ *  по каждой оси, поэтому его стоимость определяется размером
+ *  результата, а не охватом по времени и частоте (пока на пиксель
+ *  приходится не больше 2^kTimeLevels строк).
+ *
+ *  submit(), flush() и clear() вызываются из одного потока; query() и
+ *  waitForRows() могут вызываться из другого, но тоже одного потока:
+ *  запрос держит внутренний мьютекс и задерживает только поток записи.
+ */
+class WaterfallHistory
+{
+public:
+    //! \brief Число строк ячеек в плитке.
+    static constexpr int kTileRows = 64;
+    //! \brief Число колонок ячеек в плитке.
+    static constexpr int kTileColumns = 256;
+    //! \brief Число уровней по времени (ячейка сводит до 2^(kTimeLevels-1) строк).
+    static constexpr int kTimeLevels = 6;
+    //! \brief Число строк в сегменте: плитка любого уровня целиком лежит в одном сегменте.
+    static constexpr qint64 kSegmentRows = qint64(kTileRows) << (kTimeLevels - 1);
+    //! \brief Мощность уровня 1, дБ.
+    static constexpr float kFloorDb = -160.0f;
+    //! \brief Шаг уровней, дБ (уровень 255 соответствует -1.25 дБ).
+    static constexpr float kStepDb = 0.625f;
+    //! \brief Емкость очереди кадров к потоку записи.
+    static constexpr int kQueueCapacity = 8;
+
+    //! \brief Обработчик завершения подкачки плиток, недостающих запросу (вызывается в потоке подкачки).
+    using TilesLoadedHandler = std::function<void()>;
+
+    //! \brief Параметры хранилища.
+    struct Settings
+    {
+        //! \brief Нижняя граница диапазона, Гц (весь диапазон FrequencyViewportModel).
+        double minHz = 300e6;
+        //! \brief Верхняя граница диапазона, Гц.
+        double maxHz = 18e9;
+        //! \brief Число базовых колонок (степень двойки, kTileColumns..65536).
+        int columns = 16384;
+        //! \brief Бюджет памяти горячего уровня, байт (не меньше 64 МиБ; память занимается по мере роста истории).
+        qint64 hotBytes = qint64(256) << 20;
+        //! \brief Бюджет диска холодного уровня, байт (0 — история только в памяти).
+        qint64 coldBytes = qint64(4) << 30;
+        //! \brief Каталог для файлов сегментов (пустой — временный каталог системы).
+        QString directory;
+    };
+
+    //! \brief Состояние уровней хранения.
+    struct Stats
+    {
+        //! \brief Число плиток в памяти.
+        int hotTiles = 0;
+        //! \brief Объем плиток в памяти, байт.
+        qint64 hotBytes = 0;
+        //! \brief Число плиток на диске.
+        int coldTiles = 0;
+        //! \brief Объем файлов сегментов, байт.
+        qint64 coldBytes = 0;
+        //! \brief Плитки на диске, которых не было в памяти во время запроса.
+        quint64 coldMisses = 0;
+        //! \brief Плитки, подкачанные с диска.
+        quint64 prefetchedTiles = 0;
+        //! \brief Кадры, отброшенные при заполненной очереди потока записи.
+        quint64 droppedFrames = 0;
+    };
+
+    //! \brief Создает пустое хранилище с параметрами по умолчанию.
+    WaterfallHistory();
+    /*!
+     *  \brief Создает пустое хранилище и каталог сегментов.
+     *  \param[in] settings Параметры (приводятся к допустимым).
+     */
+    explicit WaterfallHistory(const Settings &settings);
+    //! \brief Останавливает потоки записи и подкачки и удаляет файлы сегментов.
+    ~WaterfallHistory();
+
+    WaterfallHistory(const WaterfallHistory &) = delete;
+    WaterfallHistory &operator=(const WaterfallHistory &) = delete;
+
+    //! \brief Возвращает действующие параметры.
+    const Settings &settings() const noexcept { return m_settings; }
+    //! \brief Возвращает номер самой старой хранимой строки.
+    qint64 firstRow() const;
+    //! \brief Возвращает номер строки, следующей за последней добавленной.
+    qint64 rowCount() const;
+    //! \brief Возвращает состояние уровней хранения.
+    Stats stats() const;
+
+    /*!
+     *  \brief Передает кадр потоку записи без блокировки.
+     *  \param[in] frame Кадр спектра; колонки вне кадра получают уровень 0.
+     *  \return false, если очередь заполнена (кадр отброшен).
+     */
+    bool submit(const SpectrumFrame &frame);
+    //! \brief Дожидается записи всех переданных кадров.
+    void flush();
+    /*!
+     *  \brief Дожидается, пока число строк истории достигнет rowCount.
+     *  \param[in] rowCount Номер строки, следующей за ожидаемой.
+     *  \param[in] timeoutMs Наибольшее время ожидания, мс.
+     *  \return false, если строки не добавлены за отведенное время.
+     */
+    bool waitForRows(qint64 rowCount, int timeoutMs);
+    //! \brief Удаляет всю историю; кадры, переданные до вызова, отбрасываются.
+    void clear();
+    /*!
+     *  \brief Задает обработчик завершения подкачки плиток, недостающих запросу.
+     *  \param[in] handler Обработчик; вызывается в потоке подкачки.
+     */
+    void setTilesLoadedHandler(TilesLoadedHandler handler);
+
+    /*!
+     *  \brief Сводит участок истории к изображению width x height.
+     *
+     *  Строка изображения 0 соответствует строке firstRow. Пиксели без
+     *  данных (вне хранимых строк или диапазона) получают уровень 0.
+     *  \param[in] firstRow Первая строка истории.
+     *  \param[in] lastRow Строка за последней.
+     *  \param[in] minHz Нижняя граница, Гц.
+     *  \param[in] maxHz Верхняя граница, Гц.
+     *  \param[in] width Ширина изображения.
+     *  \param[in] height Высота изображения.
+     *  \param[out] maxLevels Уровни максимумов, width * height значений.
+     *  \param[out] minLevels Уровни минимумов или nullptr.
+     *  \return false, если часть плиток была на диске: они пусты в результате и уже подкачиваются.
+     */
+    bool query(qint64 firstRow, qint64 lastRow, double minHz, double maxHz, int width, int height,
+               quint8 *maxLevels, quint8 *minLevels = nullptr);
+
+    //! \brief Квантует мощность в уровень 1..255 (0 — нет данных).
+    static quint8 levelFromDb(float db) noexcept;
+    //! \brief Возвращает мощность уровня, дБ.
+    static float dbFromLevel(quint8 level) noexcept;
+
+private:
+    //! \brief Плитка в памяти: плоскость максимумов, затем плоскость минимумов.
+    struct HotTile
+    {
+        //! \brief Данные плитки, kTileBytes байт.
+        std::unique_ptr<quint8[]> data;
+        //! \brief Позиция в списке давности.
+        std::list<quint64>::iterator lru;
+        //! \brief Плитка изменена после последней записи на диск.
+        bool dirty = true;
+    };
+
+    //! \brief Место плитки в файле сегмента.
+    struct ColdSlot
+    {
+        //! \brief Смещение в файле, байт.
+        qint64 offset = 0;
+        //! \brief Номер записи: подкачка отбрасывает плитку, перезаписанную во время чтения.
+        quint64 version = 0;
+    };
+
+    //! \brief Сегмент холодного уровня.
+    struct Segment
+    {
+        //! \brief Файл сегмента (открывается и пишется только потоком записи).
+        std::unique_ptr<QFile> file;
+        //! \brief Конец занятой части файла, байт.
+        qint64 end = 0;
+        //! \brief Плитки сегмента по ключу.
+        std::unordered_map<quint64, ColdSlot> tileSlots;
+    };
+
+    //! \brief Строка уровня по времени, завершенная добавленной строкой.
+    struct RowWrite
+    {
+        //! \brief Уровень по времени.
+        int timeLevel = 0;
+        //! \brief Номер строки на уровне.
+        qint64 levelRow = 0;
+        //! \brief Строка пирамиды (буфер потока записи).
+        const quint8 *row = nullptr;
+    };
+
+    //! \brief Окно последнего запроса в плитках, для направления подкачки.
+    struct Window
+    {
+        //! \brief Уровень по времени.
+        int timeLevel = -1;
+        //! \brief Уровень по частоте.
+        int freqLevel = -1;
+        //! \brief Первая строка плиток.
+        qint64 firstTileRow = 0;
+        //! \brief Последняя строка плиток.
+        qint64 lastTileRow = -1;
+        //! \brief Первая колонка плиток.
+        int firstTileColumn = 0;
+        //! \brief Последняя колонка плиток.
+        int lastTileColumn = -1;
+    };
+
+    //! \brief Размер плитки, байт.
+    static constexpr qint64 kTileBytes = qint64(kTileRows) * kTileColumns * 2;
+
+    //! \brief Составляет ключ плитки.
+    static quint64 tileKey(int timeLevel, int freqLevel, qint64 tileRow, int tileColumn) noexcept;
+    //! \brief Возвращает номер сегмента плитки.
+    static qint64 segmentOf(quint64 key) noexcept;
+
+    //! \brief Принимает кадры из очереди и пишет их строками (поток записи).
+    void runWriter();
+    //! \brief Сводит кадр к базовым колонкам и добавляет строкой (поток записи).
+    void appendFrame(const SpectrumFrame &frame);
+    //! \brief Строит пирамиду строки и записывает завершенные строки уровней в плитки (поток записи).
+    void appendLevels(const quint8 *minLevels, const quint8 *maxLevels);
+    //! \brief Читает с диска плитки строк m_rowWrites, которых нет в памяти (поток записи, вне мьютекса).
+    void loadRowTiles();
+    //! \brief Записывает строку пирамиды уровня по времени в плитки.
+    void writeRow(int timeLevel, qint64 levelRow, const quint8 *pyramidRow);
+    //! \brief Возвращает плитку из памяти для записи, создавая пустую при необходимости.
+    quint8 *writableTile(quint64 key);
+    //! \brief Возвращает плитку из памяти или nullptr, если ее там нет.
+    const quint8 *residentTile(quint64 key);
+    //! \brief Проверяет, лежит ли плитка на диске.
+    bool isCold(quint64 key) const;
+    //! \brief Помещает плитку в память, вытесняя самые давние.
+    quint8 *insertHot(quint64 key, std::unique_ptr<quint8[]> data, bool dirty);
+    //! \brief Записывает вытесненные плитки в файлы сегментов и соблюдает дисковый бюджет (поток записи).
+    void writeSpills();
+    //! \brief Удаляет все плитки и сегменты по запросу clear() (поток записи).
+    void resetStore();
+    //! \brief Удаляет старые сегменты сверх дискового бюджета.
+    void enforceRetention(std::vector<std::unique_ptr<QFile>> &removed);
+    //! \brief Удаляет сегмент, его плитки и строки; файл переносится в removed.
+    void dropSegment(qint64 index, std::vector<std::unique_ptr<QFile>> &removed);
+    //! \brief Возвращает путь файла сегмента.
+    QString segmentPath(qint64 index) const;
+    /*!
+     *  \brief Ставит в очередь подкачку недостающих плиток запроса и окна, соседнего по направлению сдвига.
+     *  \param[in] window Окно запроса.
+     *  \param[in] missing Плитки запроса, лежащие на диске.
+     */
+    void schedulePrefetch(const Window &window, const std::vector<quint64> &missing);
+    //! \brief Подкачивает плитки из очереди (поток пула).
+    void runPrefetch();
+
+    //! \brief Действующие параметры.
+    Settings m_settings;
+    //! \brief Число уровней по частоте.
+    int m_freqLevels = 1;
+    //! \brief Смещения уровней по частоте в строке пирамиды.
+    std::vector<int> m_levelOffsets;
+    //! \brief Длина плоскости строки пирамиды (все уровни по частоте).
+    int m_pyramidColumns = 0;
+
+    //! \brief Очередь кадров к потоку записи.
+    SpscQueue<SpectrumFrame, kQueueCapacity> m_queue;
+    //! \brief Число кадров в очереди.
+    QSemaphore m_available;
+    //! \brief Число кадров, принятых submit() (поток вызывающего).
+    quint64 m_submittedFrames = 0;
+    //! \brief Кадры, отброшенные при заполненной очереди.
+    std::atomic<quint64> m_droppedFrames{0};
+    //! \brief Поток записи.
+    QThread *m_writer = nullptr;
+
+    //! \brief Защищает все состояние ниже от потоков записи и подкачки.
+    mutable std::mutex m_mutex;
+    //! \brief Сигнализирует flush() об обработке кадра.
+    std::condition_variable m_processed;
+    //! \brief Число кадров, обработанных потоком записи.
+    quint64 m_processedFrames = 0;
+    //! \brief Кадры с номером меньше этого отбрасываются (переданы до clear()).
+    quint64 m_discardBefore = 0;
+    //! \brief clear() ждет удаления плиток потоком записи.
+    bool m_clearRequested = false;
+    //! \brief Номер самой старой хранимой строки.
+    qint64 m_firstRow = 0;
+    //! \brief Номер следующей строки (меняется только потоком записи).
+    qint64 m_rowCount = 0;
+
+    //! \brief Плитки в памяти.
+    std::unordered_map<quint64, HotTile> m_hot;
+    //! \brief Ключи плиток в памяти от недавних к давним.
+    std::list<quint64> m_lru;
+    //! \brief Объем плиток в памяти, байт.
+    qint64 m_hotBytes = 0;
+    //! \brief Плитки, вытесненные из памяти и еще не записанные (доступны запросам).
+    std::unordered_map<quint64, std::unique_ptr<quint8[]>> m_spilling;
+    //! \brief Объем плиток, ожидающих записи, байт.
+    qint64 m_spillingBytes = 0;
+    //! \brief Каталог сегментов (удаляется вместе с хранилищем).
+    std::unique_ptr<QTemporaryDir> m_directory;
+    //! \brief Сегменты на диске по номеру.
+    std::map<qint64, Segment> m_segments;
+    //! \brief Объем файлов сегментов, байт.
+    qint64 m_coldBytes = 0;
+    //! \brief Счетчик записей плиток на диск.
+    quint64 m_spillVersion = 0;
+    //! \brief Плитки на диске, которых не было в памяти во время запроса.
+    quint64 m_coldMisses = 0;
+    //! \brief Плитки, подкачанные с диска.
+    quint64 m_prefetchedTiles = 0;
+
+    //! \brief Строка пирамиды базового уровня по времени.
+    std::vector<quint8> m_pyramidRow;
+    //! \brief Первая строка незавершенной пары на каждом уровне по времени.
+    std::vector<std::vector<quint8>> m_carry;
+    //! \brief Буфер пар min/max для сведения кадра (поток добавления).
+    std::vector<float> m_minMax;
+    //! \brief Буферы базовых уровней (поток добавления).
+    std::vector<quint8> m_baseLevels;
+    //! \brief Строки уровней, завершенные текущей строкой (поток записи).
+    std::vector<RowWrite> m_rowWrites;
+    //! \brief Плитки текущей строки, прочитанные с диска (поток записи).
+    std::vector<std::pair<quint64, std::unique_ptr<quint8[]>>> m_loadedTiles;
+    //! \brief Диапазоны ячеек колонок изображения (поток запросов).
+    std::vector<int> m_cellRanges;
+    //! \brief Плитки текущей строки плиток запроса.
+    std::vector<const quint8 *> m_rowTiles;
+    //! \brief Плитки запроса, лежащие на диске (поток запросов).
+    std::vector<quint64> m_missingKeys;
+    //! \brief Строка уровня, собранная из плиток окна запроса (максимумы, затем минимумы).
+    std::vector<quint8> m_rowCells;
+
+    //! \brief Окно последнего запроса.
+    Window m_lastWindow;
+    //! \brief Ключи к подкачке, ближайшие в конце.
+    std::vector<quint64> m_prefetchKeys;
+    //! \brief В очереди подкачки есть плитки, недостающие запросу.
+    bool m_missingQueued = false;
+    //! \brief Обработчик завершения подкачки недостающих плиток.
+    TilesLoadedHandler m_tilesLoaded;
+    //! \brief Задача подкачки запущена.
+    bool m_prefetchRunning = false;
+    //! \brief Хранилище разрушается.
+    bool m_stopping = false;
+    //! \brief Пул из одного потока для подкачки.
+    QThreadPool m_prefetchPool;
+};
+
+#endif // WATERFALLHISTORY_H
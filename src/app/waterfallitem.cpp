@@ -0,0 +1,484 @@
+/*!
+ *  \file waterfallitem.cpp
+ *  \brief Реализация WaterfallItem.
+ */
+#include "waterfallitem.h"
+
+#include "spectrumdecimator.h"
+#include "waterfallnode.h"
+
+#include <QColor>
+#include <QtMath>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+//! \brief Максимальная глубина истории (ограничение размера текстуры).
+constexpr int kMaxHistoryDepth = 16384;
+//! \brief Максимальная ширина строки истории.
+constexpr int kMaxBinsPerRow = 8192;
+//! \brief Интервал измерения частоты строк, мс.
+constexpr qint64 kRowRateIntervalMs = 1000;
+//! \brief Наибольшее ожидание записи строк, переданных хранилищу до запроса перепроецирования, мс.
+constexpr int kRowWaitMs = 100;
+
+} // namespace
+
+//! \brief Конструирует водопад и формирует палитру.
+WaterfallItem::WaterfallItem(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_lut(buildLut())
+{
+    setFlag(ItemHasContents, true);
+    m_reprojectPool.setMaxThreadCount(1);
+}
+
+//! \brief Дожидается задания перепроецирования: оно читает хранилище истории.
+WaterfallItem::~WaterfallItem()
+{
+    m_reprojectPool.waitForDone();
+}
+
+/*!
+ *  \brief Передает кадр в историю, прореживает обзорную часть до ширины строки и квантует в уровни палитры.
+ *
+ *  Повторно показанный кадр (например, панорама при выходе обзора из
+ *  точного кадра) и кадры старше уже переданного дают строку на экране,
+ *  но не в истории, поэтому строки истории идут по возрастанию времени.
+ *  \param[in] frame Кадр спектра.
+ */
+void WaterfallItem::pushFrame(const SpectrumFrame &frame)
+{
+    if (!frame.isValid()) {
+        return;
+    }
+    // Строка без своей строки хранилища помечается номером следующей: она
+    // выгружается поверх перепроецирования, если оно не видело предыдущую.
+    qint64 historyRow = m_nextHistoryRow;
+    if (frame.sequence() >= m_nextSequence) {
+        if (!m_history) {
+            m_history = std::make_unique<WaterfallHistory>(m_historySettings);
+            m_history->setTilesLoadedHandler([this]() {
+                QMetaObject::invokeMethod(this, &WaterfallItem::handleTilesLoaded, Qt::QueuedConnection);
+            });
+        }
+        if (m_history->submit(frame)) {
+            ++m_nextHistoryRow;
+        }
+        m_nextSequence = frame.sequence() + 1;
+    }
+    if (m_viewMaxHz <= m_viewMinHz) {
+        return;
+    }
+
+    m_minMax.resize(static_cast<size_t>(m_binsPerRow) * 2);
+    SpectrumDecimator::decimateMinMax(frame, m_viewMinHz, m_viewMaxHz, m_binsPerRow, m_minMax.data());
+
+    const float minDb = static_cast<float>(m_minDb);
+    const float scale = 255.0f / static_cast<float>(qMax(1.0, m_maxDb - m_minDb));
+
+    QByteArray row(m_binsPerRow, Qt::Uninitialized);
+    auto *levels = reinterpret_cast<uchar *>(row.data());
+    for (int x = 0; x < m_binsPerRow; ++x) {
+        const float level = (m_minMax[static_cast<size_t>(x) * 2 + 1] - minDb) * scale;
+        levels[x] = static_cast<uchar>(qBound(0.0f, level, 255.0f));
+    }
+
+    // Непереданная строка означает, что синхронизация scene graph не успевает за кадрами.
+    const bool busy = !m_pendingRows.isEmpty();
+    if (m_busy != busy) {
+        m_busy = busy;
+        emit busyChanged();
+    }
+    if (m_pendingRows.size() >= m_historyDepth) {
+        m_pendingRows.removeFirst();
+    }
+    m_pendingRows.append(row);
+    if (m_reprojectRunning) {
+        if (m_replayRows.size() >= m_historyDepth) {
+            m_replayRows.removeFirst();
+        }
+        m_replayRows.append({historyRow, row});
+    }
+    update();
+
+    ++m_rateRows;
+    if (!m_rateClock.isValid()) {
+        m_rateClock.start();
+    } else if (m_rateClock.elapsed() >= kRowRateIntervalMs) {
+        m_rowRateHz = m_rateRows * 1000.0 / static_cast<double>(m_rateClock.restart());
+        m_rateRows = 0;
+        emit rowRateHzChanged();
+    }
+}
+
+//! \brief Очищает историю вместе с хранилищем; нумерация кадров истории начинается заново.
+void WaterfallItem::clear()
+{
+    if (m_history) {
+        m_history->clear();
+        m_nextHistoryRow = m_history->firstRow();
+    }
+    m_nextSequence = 0;
+    scheduleReset();
+}
+
+//! \brief Задает глубину истории.
+void WaterfallItem::setHistoryDepth(int historyDepth)
+{
+    historyDepth = qBound(1, historyDepth, kMaxHistoryDepth);
+    if (m_historyDepth == historyDepth)
+        return;
+    m_historyDepth = historyDepth;
+    m_recreatePending = true;
+    scheduleReprojection();
+    emit historyDepthChanged();
+}
+
+//! \brief Задает ширину строки истории.
+void WaterfallItem::setBinsPerRow(int binsPerRow)
+{
+    binsPerRow = qBound(1, binsPerRow, kMaxBinsPerRow);
+    if (m_binsPerRow == binsPerRow)
+        return;
+    m_binsPerRow = binsPerRow;
+    m_recreatePending = true;
+    scheduleReprojection();
+    emit binsPerRowChanged();
+}
+
+//! \brief Задает нижнюю границу палитры; история перепроецируется в новую палитру.
+void WaterfallItem::setMinDb(double minDb)
+{
+    if (qFuzzyCompare(m_minDb, minDb))
+        return;
+    m_minDb = minDb;
+    scheduleReprojection();
+    emit minDbChanged();
+}
+
+//! \brief Задает верхнюю границу палитры; история перепроецируется в новую палитру.
+void WaterfallItem::setMaxDb(double maxDb)
+{
+    if (qFuzzyCompare(m_maxDb, maxDb))
+        return;
+    m_maxDb = maxDb;
+    scheduleReprojection();
+    emit maxDbChanged();
+}
+
+//! \brief Задает нижнюю границу обзора; история перепроецируется в новый диапазон.
+void WaterfallItem::setViewMinHz(double viewMinHz)
+{
+    if (qFuzzyCompare(m_viewMinHz + 1.0, viewMinHz + 1.0))
+        return;
+    m_viewMinHz = viewMinHz;
+    scheduleReprojection();
+    emit viewMinHzChanged();
+}
+
+//! \brief Задает верхнюю границу обзора; история перепроецируется в новый диапазон.
+void WaterfallItem::setViewMaxHz(double viewMaxHz)
+{
+    if (qFuzzyCompare(m_viewMaxHz + 1.0, viewMaxHz + 1.0))
+        return;
+    m_viewMaxHz = viewMaxHz;
+    scheduleReprojection();
+    emit viewMaxHzChanged();
+}
+
+//! \brief Задает бюджет памяти истории.
+void WaterfallItem::setHistoryHotBytes(qint64 historyHotBytes)
+{
+    if (m_historySettings.hotBytes == historyHotBytes)
+        return;
+    m_historySettings.hotBytes = historyHotBytes;
+    resetHistory();
+    emit historyBudgetChanged();
+}
+
+//! \brief Задает бюджет диска истории.
+void WaterfallItem::setHistoryColdBytes(qint64 historyColdBytes)
+{
+    if (m_historySettings.coldBytes == historyColdBytes)
+        return;
+    m_historySettings.coldBytes = historyColdBytes;
+    resetHistory();
+    emit historyBudgetChanged();
+}
+
+/*!
+ *  \brief Отслеживает изменение размеров.
+ *  \param[in] newGeometry Новая геометрия.
+ *  \param[in] oldGeometry Предыдущая геометрия.
+ */
+void WaterfallItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        m_geometryDirty = true;
+        update();
+    }
+}
+
+//! \brief Запускает перепроецирование, если с прошлого кадра менялись обзор, палитра или размеры текстуры.
+void WaterfallItem::updatePolish()
+{
+    if (m_reprojectPending && !m_reprojectRunning) {
+        startReprojection();
+    }
+}
+
+//! \brief Удаляет хранилище вместе с файлами и очищает текстуру.
+void WaterfallItem::resetHistory()
+{
+    if (!m_history) {
+        return;
+    }
+    m_reprojectPool.waitForDone();
+    m_history.reset();
+    m_nextSequence = 0;
+    m_nextHistoryRow = 0;
+    scheduleReset();
+}
+
+//! \brief Перепроецирует историю еще раз, если прошлому запросу не хватило плиток с диска.
+void WaterfallItem::handleTilesLoaded()
+{
+    if (!m_tilesAwaited) {
+        return;
+    }
+    m_tilesAwaited = false;
+    m_tilesRetry = true;
+    scheduleReprojection();
+}
+
+//! \brief Отбрасывает накопленные строки и очищает историю при следующей синхронизации.
+void WaterfallItem::scheduleReset()
+{
+    m_pendingRows.clear();
+    m_replayRows.clear();
+    m_contentsPending = false;
+    m_reprojectPending = false;
+    m_resetPending = true;
+    // Результат выполняемого задания относится к прежней истории.
+    ++m_reprojectGeneration;
+    update();
+}
+
+//! \brief Откладывает перепроецирование до кадра окна: несколько изменений обзора дают одно задание.
+void WaterfallItem::scheduleReprojection()
+{
+    m_reprojectPending = true;
+    polish();
+    update();
+}
+
+/*!
+ *  \brief Передает потоку перепроецирования запрос последних historyDepth строк в текущем обзоре.
+ *
+ *  Задание забирает буферы прошлого задания, поэтому память под уровни и
+ *  содержимое текстуры выделяется заново только при смене размеров.
+ */
+void WaterfallItem::startReprojection()
+{
+    const bool retry = m_tilesRetry;
+    m_tilesRetry = false;
+    if (!m_history || m_viewMaxHz <= m_viewMinHz) {
+        scheduleReset();
+        return;
+    }
+    m_reprojectPending = false;
+    m_reprojectRunning = true;
+    m_replayRows.clear();
+
+    Reprojection &job = m_reprojection;
+    job.history = m_history.get();
+    job.generation = m_reprojectGeneration;
+    job.submittedRows = m_nextHistoryRow;
+    job.viewMinHz = m_viewMinHz;
+    job.viewMaxHz = m_viewMaxHz;
+    job.minDb = m_minDb;
+    job.maxDb = m_maxDb;
+    job.binsPerRow = m_binsPerRow;
+    job.historyDepth = m_historyDepth;
+    job.retry = retry;
+    m_reprojectPool.start([this]() {
+        runReprojection(m_reprojection);
+        QMetaObject::invokeMethod(this, &WaterfallItem::applyReprojection, Qt::QueuedConnection);
+    });
+}
+
+/*!
+ *  \brief Запрашивает у хранилища последние historyDepth строк и переводит их в уровни палитры.
+ *
+ *  Одна строка хранилища дает одну строку текстуры, поэтому стоимость
+ *  задания определяется размером текстуры. Строки, переданные до запроса,
+ *  обычно еще в очереди потока записи: задание сначала дожидается их.
+ *  \param[in,out] job Задание.
+ */
+void WaterfallItem::runReprojection(Reprojection &job)
+{
+    job.history->waitForRows(job.submittedRows, kRowWaitMs);
+    job.lastRow = job.history->rowCount();
+    const qint64 firstRow = qMax(job.history->firstRow(), job.lastRow - job.historyDepth);
+    job.rows = static_cast<int>(qMax(qint64(0), job.lastRow - firstRow));
+    job.complete = true;
+    if (job.rows == 0) {
+        return;
+    }
+
+    job.levels.resize(static_cast<size_t>(job.binsPerRow) * static_cast<size_t>(job.rows));
+    job.complete = job.history->query(firstRow, job.lastRow, job.viewMinHz, job.viewMaxHz, job.binsPerRow, job.rows,
+                                      job.levels.data());
+
+    // Уровни хранилища переводятся в уровни палитры так же, как строки pushFrame().
+    const float minDb = static_cast<float>(job.minDb);
+    const float scale = 255.0f / static_cast<float>(qMax(1.0, job.maxDb - job.minDb));
+    uchar palette[256];
+    palette[0] = 0;
+    for (int level = 1; level < 256; ++level) {
+        const float value = (WaterfallHistory::dbFromLevel(static_cast<quint8>(level)) - minDb) * scale;
+        palette[level] = static_cast<uchar>(qBound(0.0f, value, 255.0f));
+    }
+
+    // Буфер, который поток отрисовки уже выгрузил и отпустил, заполняется на месте.
+    const qsizetype size = qsizetype(job.binsPerRow) * job.historyDepth;
+    if (job.contents.size() != size || !job.contents.isDetached()) {
+        job.contents = QByteArray(size, Qt::Uninitialized);
+    }
+    auto *levels = reinterpret_cast<uchar *>(job.contents.data());
+    for (size_t i = 0; i < job.levels.size(); ++i) {
+        levels[i] = palette[job.levels[i]];
+    }
+    std::fill(levels + job.levels.size(), levels + size, uchar(0));
+}
+
+/*!
+ *  \brief Заменяет историю текстуры результатом задания.
+ *
+ *  Строки, выгруженные во время задания, но еще не записанные хранилищем
+ *  к моменту запроса, выгружаются поверх результата; остальные уже в нем.
+ */
+void WaterfallItem::applyReprojection()
+{
+    m_reprojectRunning = false;
+    Reprojection &job = m_reprojection;
+    if (job.generation == m_reprojectGeneration) {
+        // Повтор только один: если плитки снова вытеснены до него, пробелы остаются до следующей смены обзора.
+        m_tilesAwaited = !job.complete && !job.retry;
+        if (job.rows > 0) {
+            // Прежнее содержимое уходит заданию для повторного использования.
+            std::swap(m_historyContents, job.contents);
+            m_historyRows = job.rows;
+            m_contentsPending = true;
+            m_resetPending = false;
+        } else {
+            m_contentsPending = false;
+            m_resetPending = true;
+        }
+        m_pendingRows.clear();
+        for (const ReplayRow &row : std::as_const(m_replayRows)) {
+            if (row.historyRow >= job.lastRow) {
+                m_pendingRows.append(row.levels);
+            }
+        }
+        update();
+    }
+    m_replayRows.clear();
+    if (m_reprojectPending) {
+        polish();
+    }
+}
+
+/*!
+ *  \brief Передает накопленные строки узлу (поток UI в это время заблокирован).
+ *  \param[in] oldNode Узел с прошлой отрисовки.
+ *  \return Узел водопада.
+ */
+QSGNode *WaterfallItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    auto *node = static_cast<WaterfallNode *>(oldNode);
+    if (width() <= 0.0 || height() <= 0.0) {
+        delete node;
+        return nullptr;
+    }
+
+    if (node && m_recreatePending) {
+        delete node;
+        node = nullptr;
+    }
+    if (!node) {
+        node = new WaterfallNode(m_binsPerRow, m_historyDepth, m_lut);
+        m_recreatePending = false;
+        m_resetPending = false;
+        m_geometryDirty = true;
+    }
+
+    if (m_contentsPending) {
+        // Содержимое строится под размеры на момент запроса; если они с тех пор
+        // изменились, узел очищается до результата следующего задания.
+        if (m_historyContents.size() == qsizetype(node->columns()) * node->rows()) {
+            node->setHistory(m_historyContents, m_historyRows);
+        } else {
+            node->clear();
+        }
+        m_contentsPending = false;
+        m_resetPending = false;
+    } else if (m_resetPending) {
+        node->clear();
+        m_resetPending = false;
+    }
+    if (m_geometryDirty) {
+        node->setRect(boundingRect());
+        m_geometryDirty = false;
+    }
+
+    for (const QByteArray &row : std::as_const(m_pendingRows)) {
+        // Строки прежней ширины остаются от кадров до смены binsPerRow.
+        if (row.size() == node->columns()) {
+            node->appendRow(row);
+        }
+    }
+    m_pendingRows.clear();
+
+    return node;
+}
+
+//! \brief Формирует палитру: темно-синий -> голубой -> желтый -> красный -> белый.
+QByteArray WaterfallItem::buildLut()
+{
+    struct Stop
+    {
+        float position;
+        QColor color;
+    };
+    const Stop stops[] = {
+        {0.00f, QColor(QStringLiteral("#05070d"))},
+        {0.25f, QColor(QStringLiteral("#123a7a"))},
+        {0.50f, QColor(QStringLiteral("#1fa4c9"))},
+        {0.70f, QColor(QStringLiteral("#f2d43d"))},
+        {0.88f, QColor(QStringLiteral("#e8412c"))},
+        {1.00f, QColor(QStringLiteral("#ffffff"))},
+    };
+
+    QByteArray lut(256 * 4, Qt::Uninitialized);
+    auto *rgba = reinterpret_cast<uchar *>(lut.data());
+    for (int i = 0; i < 256; ++i) {
+        const float t = static_cast<float>(i) / 255.0f;
+        int s = 1;
+        while (s < int(std::size(stops)) - 1 && t > stops[s].position) {
+            ++s;
+        }
+        const Stop &a = stops[s - 1];
+        const Stop &b = stops[s];
+        const float k = qBound(0.0f, (t - a.position) / (b.position - a.position), 1.0f);
+        rgba[i * 4 + 0] = static_cast<uchar>(a.color.red() + (b.color.red() - a.color.red()) * k);
+        rgba[i * 4 + 1] = static_cast<uchar>(a.color.green() + (b.color.green() - a.color.green()) * k);
+        rgba[i * 4 + 2] = static_cast<uchar>(a.color.blue() + (b.color.blue() - a.color.blue()) * k);
+        rgba[i * 4 + 3] = 255;
+    }
+    return lut;
+}
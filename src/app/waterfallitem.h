@@ -0,0 +1,267 @@
+/*!
+ *  \file waterfallitem.h
+ *  \brief Спектрально-временная диаграмма (водопад) с историей на GPU.
+ */
+#ifndef WATERFALLITEM_H
+#define WATERFALLITEM_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QQuickItem>
+#include <QThreadPool>
+
+#include <memory>
+#include <vector>
+
+#include "spectrumframe.h"
+#include "waterfallhistory.h"
+
+/*!
+ *  \class WaterfallItem
+ *  \brief Водопад: каждая строка — кадр спектра, цвет — амплитуда.
+ *
+ *  История хранится в текстуре GPU как кольцевой буфер: каждый кадр
+ *  выгружает ровно одну строку, а прокрутка выполняется смещением
+ *  текстурной координаты в шейдере. Палитра применяется в шейдере через LUT.
+ *
+ *  Кадры также передаются в WaterfallHistory, которая сводит их по всему
+ *  диапазону частот в собственном потоке записи; кадр, не новее уже
+ *  переданного (по sequence()), в историю не попадает. При смене обзора,
+ *  палитры, глубины или ширины строки история не сбрасывается, а
+ *  перепроецируется: последние historyDepth строк запрашиваются у
+ *  хранилища в новом диапазоне и переводятся в уровни палитры в потоке
+ *  перепроецирования (не больше одного задания за раз, изменения за кадр
+ *  окна сводятся в одно задание в updatePolish()), а готовая текстура
+ *  выгружается целиком. Строки, которых хранилище еще не записало к
+ *  моменту запроса, выгружаются поверх результата. Запрос читает только
+ *  плитки в памяти; если часть плиток была на диске, перепроецирование
+ *  повторяется один раз после их подкачки.
+ */
+class WaterfallItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(int historyDepth READ historyDepth WRITE setHistoryDepth NOTIFY historyDepthChanged FINAL)
+    Q_PROPERTY(int binsPerRow READ binsPerRow WRITE setBinsPerRow NOTIFY binsPerRowChanged FINAL)
+    Q_PROPERTY(double minDb READ minDb WRITE setMinDb NOTIFY minDbChanged FINAL)
+    Q_PROPERTY(double maxDb READ maxDb WRITE setMaxDb NOTIFY maxDbChanged FINAL)
+    Q_PROPERTY(double viewMinHz READ viewMinHz WRITE setViewMinHz NOTIFY viewMinHzChanged FINAL)
+    Q_PROPERTY(double viewMaxHz READ viewMaxHz WRITE setViewMaxHz NOTIFY viewMaxHzChanged FINAL)
+    Q_PROPERTY(qint64 historyHotBytes READ historyHotBytes WRITE setHistoryHotBytes NOTIFY historyBudgetChanged FINAL)
+    Q_PROPERTY(qint64 historyColdBytes READ historyColdBytes WRITE setHistoryColdBytes NOTIFY historyBudgetChanged
+                   FINAL)
+    Q_PROPERTY(double rowRateHz READ rowRateHz NOTIFY rowRateHzChanged FINAL)
+    Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged FINAL)
+
+public:
+    //! \brief Конструирует водопад.
+    explicit WaterfallItem(QQuickItem *parent = nullptr);
+    //! \brief Дожидается задания перепроецирования.
+    ~WaterfallItem() override;
+
+    //! \brief Возвращает глубину истории в строках.
+    int historyDepth() const noexcept { return m_historyDepth; }
+    //! \brief Возвращает ширину строки истории в отсчетах.
+    int binsPerRow() const noexcept { return m_binsPerRow; }
+    //! \brief Возвращает нижнюю границу палитры, дБ.
+    double minDb() const noexcept { return m_minDb; }
+    //! \brief Возвращает верхнюю границу палитры, дБ.
+    double maxDb() const noexcept { return m_maxDb; }
+    //! \brief Возвращает нижнюю границу обзора, Гц.
+    double viewMinHz() const noexcept { return m_viewMinHz; }
+    //! \brief Возвращает верхнюю границу обзора, Гц.
+    double viewMaxHz() const noexcept { return m_viewMaxHz; }
+    //! \brief Возвращает бюджет памяти истории, байт.
+    qint64 historyHotBytes() const noexcept { return m_historySettings.hotBytes; }
+    //! \brief Возвращает бюджет диска истории, байт (0 — история только в памяти).
+    qint64 historyColdBytes() const noexcept { return m_historySettings.coldBytes; }
+    //! \brief Возвращает число строк, добавленных за секунду последнего интервала измерения.
+    double rowRateHz() const noexcept { return m_rowRateHz; }
+    //! \brief Проверяет, пришла ли новая строка раньше, чем предыдущая ушла в поток отрисовки.
+    bool isBusy() const noexcept { return m_busy; }
+
+public slots:
+    /*!
+     *  \brief Добавляет кадр спектра как новую строку водопада.
+     *  \param[in] frame Кадр спектра; в строку попадает только обзорный диапазон.
+     */
+    void pushFrame(const SpectrumFrame &frame);
+    //! \brief Очищает историю.
+    void clear();
+    //! \brief Задает глубину истории (пересоздает текстуру).
+    void setHistoryDepth(int historyDepth);
+    //! \brief Задает ширину строки истории (пересоздает текстуру).
+    void setBinsPerRow(int binsPerRow);
+    //! \brief Задает нижнюю границу палитры, дБ.
+    void setMinDb(double minDb);
+    //! \brief Задает верхнюю границу палитры, дБ.
+    void setMaxDb(double maxDb);
+    //! \brief Задает нижнюю границу обзора и перепроецирует историю.
+    void setViewMinHz(double viewMinHz);
+    //! \brief Задает верхнюю границу обзора и перепроецирует историю.
+    void setViewMaxHz(double viewMaxHz);
+    //! \brief Задает бюджет памяти истории (история пересоздается пустой).
+    void setHistoryHotBytes(qint64 historyHotBytes);
+    //! \brief Задает бюджет диска истории (история пересоздается пустой).
+    void setHistoryColdBytes(qint64 historyColdBytes);
+
+signals:
+    //! \brief Сигнал об изменении глубины истории.
+    void historyDepthChanged();
+    //! \brief Сигнал об изменении ширины строки.
+    void binsPerRowChanged();
+    //! \brief Сигнал об изменении нижней границы палитры.
+    void minDbChanged();
+    //! \brief Сигнал об изменении верхней границы палитры.
+    void maxDbChanged();
+    //! \brief Сигнал об изменении нижней границы обзора.
+    void viewMinHzChanged();
+    //! \brief Сигнал об изменении верхней границы обзора.
+    void viewMaxHzChanged();
+    //! \brief Сигнал об изменении бюджетов истории.
+    void historyBudgetChanged();
+    //! \brief Сигнал об обновлении частоты строк.
+    void rowRateHzChanged();
+    //! \brief Сигнал об изменении признака отставания отрисовки.
+    void busyChanged();
+
+protected:
+    //! \brief Передает накопленные строки узлу в потоке отрисовки.
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    //! \brief Обновляет геометрию узла при изменении размеров.
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    //! \brief Запускает перепроецирование истории, если с прошлого кадра менялся обзор или палитра.
+    void updatePolish() override;
+
+private:
+    //! \brief Задание перепроецирования: параметры запроса и результат.
+    struct Reprojection
+    {
+        //! \brief Хранилище истории.
+        WaterfallHistory *history = nullptr;
+        //! \brief Поколение истории на момент запроса.
+        quint64 generation = 0;
+        //! \brief Номер строки, следующей за последней переданной в хранилище до запроса.
+        qint64 submittedRows = 0;
+        //! \brief Нижняя граница обзора, Гц.
+        double viewMinHz = 0.0;
+        //! \brief Верхняя граница обзора, Гц.
+        double viewMaxHz = 0.0;
+        //! \brief Нижняя граница палитры, дБ.
+        double minDb = 0.0;
+        //! \brief Верхняя граница палитры, дБ.
+        double maxDb = 0.0;
+        //! \brief Ширина строки текстуры.
+        int binsPerRow = 0;
+        //! \brief Глубина текстуры в строках.
+        int historyDepth = 0;
+        //! \brief Задание — повтор после подкачки плиток.
+        bool retry = false;
+        //! \brief Номер строки за последней, вошедшей в результат.
+        qint64 lastRow = 0;
+        //! \brief Число заполненных строк в contents.
+        int rows = 0;
+        //! \brief Все плитки запроса были в памяти.
+        bool complete = true;
+        //! \brief Буфер уровней хранилища.
+        std::vector<quint8> levels;
+        //! \brief Содержимое текстуры в уровнях палитры.
+        QByteArray contents;
+    };
+
+    //! \brief Строка, выгруженная во время перепроецирования.
+    struct ReplayRow
+    {
+        //! \brief Номер строки хранилища, не меньше которого строка в нем еще не записана.
+        qint64 historyRow = 0;
+        //! \brief Уровни палитры.
+        QByteArray levels;
+    };
+
+    //! \brief Формирует палитру 256 * RGBA8.
+    static QByteArray buildLut();
+    //! \brief Отбрасывает накопленные строки и очищает историю при следующей синхронизации.
+    void scheduleReset();
+    //! \brief Перепроецирует историю после текущего задания, начиная со следующего кадра окна.
+    void scheduleReprojection();
+    //! \brief Передает потоку перепроецирования задание для текущего обзора и палитры.
+    void startReprojection();
+    /*!
+     *  \brief Строит содержимое текстуры из хранилища истории (поток перепроецирования).
+     *  \param[in,out] job Задание.
+     */
+    static void runReprojection(Reprojection &job);
+    //! \brief Заменяет историю текстуры результатом задания и выгружает строки поверх него.
+    void applyReprojection();
+    //! \brief Удаляет хранилище истории: следующий кадр создает его с новыми бюджетами.
+    void resetHistory();
+    //! \brief Повторяет перепроецирование после подкачки плиток, которых не хватило запросу.
+    void handleTilesLoaded();
+
+    //! \brief Глубина истории в строках.
+    int m_historyDepth = 2048;
+    //! \brief Ширина строки истории в отсчетах.
+    int m_binsPerRow = 2048;
+    //! \brief Нижняя граница палитры, дБ.
+    double m_minDb = -120.0;
+    //! \brief Верхняя граница палитры, дБ.
+    double m_maxDb = -20.0;
+    //! \brief Нижняя граница обзора, Гц.
+    double m_viewMinHz = 0.0;
+    //! \brief Верхняя граница обзора, Гц.
+    double m_viewMaxHz = 0.0;
+
+    //! \brief Палитра 256 * RGBA8.
+    QByteArray m_lut;
+    //! \brief Строки, ожидающие передачи в поток отрисовки.
+    QList<QByteArray> m_pendingRows;
+    //! \brief Буфер пар min/max для прореживания кадра.
+    std::vector<float> m_minMax;
+    //! \brief Параметры хранилища истории.
+    WaterfallHistory::Settings m_historySettings;
+    //! \brief Хранилище истории по всему диапазону (создается с первым кадром).
+    std::unique_ptr<WaterfallHistory> m_history;
+    //! \brief Наименьший номер кадра, который еще может попасть в историю.
+    quint64 m_nextSequence = 0;
+    //! \brief Номер строки хранилища, которую получит следующий переданный кадр.
+    qint64 m_nextHistoryRow = 0;
+    //! \brief Задание перепроецирования (пока оно выполняется, им владеет поток перепроецирования).
+    Reprojection m_reprojection;
+    //! \brief Поток перепроецирования.
+    QThreadPool m_reprojectPool;
+    //! \brief Поколение истории: очистка делает результат выполняемого задания устаревшим.
+    quint64 m_reprojectGeneration = 0;
+    //! \brief Строки, выгруженные с начала выполняемого задания.
+    QList<ReplayRow> m_replayRows;
+    //! \brief Содержимое текстуры, ожидающее передачи в поток отрисовки (буфер переиспользуется).
+    QByteArray m_historyContents;
+    //! \brief Число заполненных строк в m_historyContents.
+    int m_historyRows = 0;
+    //! \brief Требуется очистить историю.
+    bool m_resetPending = false;
+    //! \brief Требуется перепроецировать историю.
+    bool m_reprojectPending = false;
+    //! \brief Задание перепроецирования выполняется.
+    bool m_reprojectRunning = false;
+    //! \brief Последнему перепроецированию не хватило плиток с диска.
+    bool m_tilesAwaited = false;
+    //! \brief Текущее перепроецирование — повтор после подкачки.
+    bool m_tilesRetry = false;
+    //! \brief Требуется заменить историю содержимым m_historyContents.
+    bool m_contentsPending = false;
+    //! \brief Требуется пересоздать узел (изменились размеры текстуры).
+    bool m_recreatePending = false;
+    //! \brief Требуется обновить геометрию узла.
+    bool m_geometryDirty = true;
+
+    //! \brief Длительность текущего интервала измерения частоты строк.
+    QElapsedTimer m_rateClock;
+    //! \brief Число строк в текущем интервале измерения.
+    int m_rateRows = 0;
+    //! \brief Число строк в секунду за последний интервал.
+    double m_rowRateHz = 0.0;
+    //! \brief Отрисовка отстает от поступления строк.
+    bool m_busy = false;
+};
+
+#endif // WATERFALLITEM_H
@@ -0,0 +1,296 @@
+/*!
+ *  \file waterfallnode.cpp
+ *  \brief Реализация узла, материала и текстур водопада.
+ */
+#include "waterfallnode.h"
+
+#include <QtMath>
+
+#include <cstring>
+
+namespace {
+
+/*!
+ *  \class WaterfallShader
+ *  \brief Шейдер водопада: выборка из кольцевой истории и палитры.
+ */
+class WaterfallShader : public QSGMaterialShader
+{
+public:
+    //! \brief Загружает скомпилированные шейдеры из ресурсов.
+    WaterfallShader()
+    {
+        setShaderFileName(VertexStage, QStringLiteral(":/shaders/waterfall.vert.qsb"));
+        setShaderFileName(FragmentStage, QStringLiteral(":/shaders/waterfall.frag.qsb"));
+    }
+
+    //! \brief Записывает матрицу, прозрачность и смещение кольца в uniform-буфер.
+    bool updateUniformData(RenderState &state, QSGMaterial *newMaterial, QSGMaterial *) override
+    {
+        QByteArray *buf = state.uniformData();
+        Q_ASSERT(buf->size() >= 80);
+        char *data = buf->data();
+
+        if (state.isMatrixDirty()) {
+            const QMatrix4x4 m = state.combinedMatrix();
+            std::memcpy(data, m.constData(), 64);
+        }
+        if (state.isOpacityDirty()) {
+            const float opacity = state.opacity();
+            std::memcpy(data + 64, &opacity, 4);
+        }
+
+        const auto *material = static_cast<const WaterfallMaterial *>(newMaterial);
+        std::memcpy(data + 68, &material->rowOffset, 4);
+        std::memcpy(data + 72, &material->rowHeight, 4);
+        std::memcpy(data + 76, &material->visibleFraction, 4);
+        return true;
+    }
+
+    //! \brief Подставляет текстуры истории (binding 1) и палитры (binding 2).
+    void updateSampledImage(RenderState &, int binding, QSGTexture **texture,
+                            QSGMaterial *newMaterial, QSGMaterial *) override
+    {
+        auto *material = static_cast<WaterfallMaterial *>(newMaterial);
+        if (binding == 1) {
+            *texture = material->history;
+        } else if (binding == 2) {
+            *texture = material->lut;
+        }
+    }
+};
+
+} // namespace
+
+/*!
+ *  \brief Конструирует текстуру.
+ *  \param[in] format Формат пикселей.
+ *  \param[in] size Размер текстуры.
+ */
+WaterfallTexture::WaterfallTexture(QRhiTexture::Format format, const QSize &size)
+    : m_format(format)
+    , m_size(size)
+{
+}
+
+//! \brief Освобождает ресурс QRhi.
+WaterfallTexture::~WaterfallTexture()
+{
+    if (m_texture) {
+        m_texture->deleteLater();
+    }
+}
+
+//! \brief Возвращает ключ сравнения текстур.
+qint64 WaterfallTexture::comparisonKey() const
+{
+    return qint64(qintptr(m_texture ? static_cast<const void *>(m_texture) : static_cast<const void *>(this)));
+}
+
+/*!
+ *  \brief Создает текстуру и выгружает накопленные изменения.
+ *  \param[in] rhi Экземпляр QRhi.
+ *  \param[in] resourceUpdates Пакет обновлений ресурсов текущего кадра.
+ */
+void WaterfallTexture::commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates)
+{
+    if (!m_texture) {
+        if (!rhi->isTextureFormatSupported(m_format)) {
+            qWarning("WaterfallTexture: texture format %d is not supported", int(m_format));
+            return;
+        }
+        m_texture = rhi->newTexture(m_format, m_size, 1, {});
+        if (!m_texture->create()) {
+            qWarning("WaterfallTexture: failed to create %dx%d texture", m_size.width(), m_size.height());
+            delete m_texture;
+            m_texture = nullptr;
+            return;
+        }
+        if (m_pendingContents.isEmpty()) {
+            clear();
+        }
+    }
+
+    QList<QRhiTextureUploadEntry> entries;
+    if (!m_pendingContents.isEmpty()) {
+        entries.append(QRhiTextureUploadEntry(0, 0, QRhiTextureSubresourceUploadDescription(m_pendingContents)));
+        m_pendingContents.clear();
+    }
+
+    for (const PendingRow &pending : std::as_const(m_pendingRows)) {
+        QRhiTextureSubresourceUploadDescription desc(pending.data);
+        desc.setDestinationTopLeft(QPoint(0, pending.row));
+        desc.setSourceSize(QSize(m_size.width(), 1));
+        entries.append(QRhiTextureUploadEntry(0, 0, desc));
+    }
+    m_pendingRows.clear();
+
+    if (!entries.isEmpty()) {
+        QRhiTextureUploadDescription description;
+        description.setEntries(entries.cbegin(), entries.cend());
+        resourceUpdates->uploadTexture(m_texture, description);
+    }
+}
+
+/*!
+ *  \brief Ставит в очередь выгрузку одной строки.
+ *  \param[in] row Номер строки.
+ *  \param[in] data Данные строки.
+ */
+void WaterfallTexture::setRow(int row, const QByteArray &data)
+{
+    Q_ASSERT(data.size() == m_size.width() * bytesPerPixel());
+    // Если строки копятся быстрее отрисовки, старые записи все равно будут
+    // перезаписаны по кругу: держим не больше одного оборота кольца.
+    if (m_pendingRows.size() >= m_size.height()) {
+        m_pendingRows.removeFirst();
+    }
+    m_pendingRows.append({row, data});
+}
+
+/*!
+ *  \brief Ставит в очередь выгрузку всего содержимого.
+ *  \param[in] data Данные всей текстуры.
+ */
+void WaterfallTexture::setContents(const QByteArray &data)
+{
+    Q_ASSERT(data.size() == m_size.width() * m_size.height() * bytesPerPixel());
+    m_pendingRows.clear();
+    m_pendingContents = data;
+}
+
+//! \brief Ставит в очередь заполнение текстуры нулями.
+void WaterfallTexture::clear()
+{
+    setContents(QByteArray(m_size.width() * m_size.height() * bytesPerPixel(), '\0'));
+}
+
+//! \brief Возвращает размер пикселя формата в байтах.
+int WaterfallTexture::bytesPerPixel() const noexcept
+{
+    return m_format == QRhiTexture::R8 ? 1 : 4;
+}
+
+//! \brief Конструирует материал без текстур.
+WaterfallMaterial::WaterfallMaterial()
+{
+    setFlag(Blending, false);
+}
+
+//! \brief Освобождает текстуры.
+WaterfallMaterial::~WaterfallMaterial()
+{
+    delete history;
+    delete lut;
+}
+
+//! \brief Возвращает тип материала.
+QSGMaterialType *WaterfallMaterial::type() const
+{
+    static QSGMaterialType type;
+    return &type;
+}
+
+//! \brief Создает шейдер материала.
+QSGMaterialShader *WaterfallMaterial::createShader(QSGRendererInterface::RenderMode) const
+{
+    return new WaterfallShader;
+}
+
+//! \brief Сравнивает материалы по текстурам и смещению.
+int WaterfallMaterial::compare(const QSGMaterial *other) const
+{
+    const auto *o = static_cast<const WaterfallMaterial *>(other);
+    if (history != o->history) {
+        return history < o->history ? -1 : 1;
+    }
+    if (!qFuzzyCompare(rowOffset, o->rowOffset)) {
+        return rowOffset < o->rowOffset ? -1 : 1;
+    }
+    return 0;
+}
+
+/*!
+ *  \brief Конструирует узел с пустой историей.
+ *  \param[in] columns Ширина истории в отсчетах.
+ *  \param[in] rows Глубина истории в строках.
+ *  \param[in] lut Палитра 256 * RGBA8.
+ */
+WaterfallNode::WaterfallNode(int columns, int rows, const QByteArray &lut)
+    : m_columns(columns)
+    , m_rows(rows)
+{
+    auto *geometry = new QSGGeometry(QSGGeometry::defaultAttributes_TexturedPoint2D(), 4);
+    geometry->setDrawingMode(QSGGeometry::DrawTriangleStrip);
+    setGeometry(geometry);
+    setFlag(OwnsGeometry);
+
+    m_material = new WaterfallMaterial;
+    m_material->history = new WaterfallTexture(QRhiTexture::R8, QSize(columns, rows));
+    m_material->history->setFiltering(QSGTexture::Nearest);
+    m_material->history->setHorizontalWrapMode(QSGTexture::ClampToEdge);
+    m_material->history->setVerticalWrapMode(QSGTexture::Repeat);
+    m_material->history->clear();
+
+    m_material->lut = new WaterfallTexture(QRhiTexture::RGBA8, QSize(lut.size() / 4, 1));
+    m_material->lut->setFiltering(QSGTexture::Linear);
+    m_material->lut->setHorizontalWrapMode(QSGTexture::ClampToEdge);
+    m_material->lut->setVerticalWrapMode(QSGTexture::ClampToEdge);
+    m_material->lut->setContents(lut);
+
+    m_material->rowHeight = 1.0f / static_cast<float>(rows);
+    setMaterial(m_material);
+    setFlag(OwnsMaterial);
+}
+
+/*!
+ *  \brief Записывает строку в голову кольца и сдвигает смещение.
+ *  \param[in] row Уровни 0..255.
+ */
+void WaterfallNode::appendRow(const QByteArray &row)
+{
+    m_material->history->setRow(m_head, row);
+    m_head = (m_head + 1) % m_rows;
+    updateOffsets();
+}
+
+//! \brief Очищает историю.
+void WaterfallNode::clear()
+{
+    m_material->history->clear();
+    m_head = 0;
+    updateOffsets();
+}
+
+/*!
+ *  \brief Заменяет историю целиком.
+ *  \param[in] contents Уровни всей текстуры.
+ *  \param[in] filledRows Число заполненных строк от начала текстуры.
+ */
+void WaterfallNode::setHistory(const QByteArray &contents, int filledRows)
+{
+    m_material->history->setContents(contents);
+    m_head = qBound(0, filledRows, m_rows) % m_rows;
+    updateOffsets();
+}
+
+/*!
+ *  \brief Обновляет геометрию и видимую долю истории.
+ *  \param[in] rect Прямоугольник элемента.
+ */
+void WaterfallNode::setRect(const QRectF &rect)
+{
+    QSGGeometry::updateTexturedRectGeometry(geometry(), rect, QRectF(0.0, 0.0, 1.0, 1.0));
+    markDirty(DirtyGeometry);
+
+    // Одна строка истории на пиксель высоты, пока хватает глубины.
+    m_material->visibleFraction = static_cast<float>(qBound(1.0 / m_rows, rect.height() / m_rows, 1.0));
+    markDirty(DirtyMaterial);
+}
+
+//! \brief Обновляет смещение кольца в материале.
+void WaterfallNode::updateOffsets()
+{
+    m_material->rowOffset = static_cast<float>(m_head) / static_cast<float>(m_rows);
+    markDirty(DirtyMaterial);
+}
@@ -0,0 +1,172 @@
+/*!
+ *  \file waterfallnode.h
+ *  \brief Узел scene graph водопада: кольцевая текстура истории и палитра.
+ */
+#ifndef WATERFALLNODE_H
+#define WATERFALLNODE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QSGGeometryNode>
+#include <QSGMaterial>
+#include <QSGMaterialShader>
+#include <QSGTexture>
+
+#include <rhi/qrhi.h>
+
+/*!
+ *  \class WaterfallTexture
+ *  \brief Текстура, обновляемая построчно через QRhi.
+ *
+ *  Все методы вызываются в потоке отрисовки: изменения накапливаются при
+ *  синхронизации и выгружаются на GPU в commitTextureOperations().
+ */
+class WaterfallTexture : public QSGTexture
+{
+public:
+    /*!
+     *  \brief Конструирует текстуру.
+     *  \param[in] format Формат пикселей (R8 или RGBA8).
+     *  \param[in] size Размер текстуры в пикселях.
+     */
+    WaterfallTexture(QRhiTexture::Format format, const QSize &size);
+    //! \brief Освобождает ресурс QRhi.
+    ~WaterfallTexture() override;
+
+    //! \brief Возвращает ключ сравнения текстур.
+    qint64 comparisonKey() const override;
+    //! \brief Возвращает текстуру QRhi.
+    QRhiTexture *rhiTexture() const override { return m_texture; }
+    //! \brief Возвращает размер текстуры.
+    QSize textureSize() const override { return m_size; }
+    //! \brief Текстура не содержит альфа-канала для смешивания.
+    bool hasAlphaChannel() const override { return false; }
+    //! \brief Текстура не использует mip-уровни.
+    bool hasMipmaps() const override { return false; }
+    //! \brief Создает текстуру при необходимости и выгружает накопленные строки.
+    void commitTextureOperations(QRhi *rhi, QRhiResourceUpdateBatch *resourceUpdates) override;
+
+    /*!
+     *  \brief Ставит в очередь выгрузку одной строки.
+     *  \param[in] row Номер строки текстуры.
+     *  \param[in] data Данные строки (ширина * байт на пиксель).
+     */
+    void setRow(int row, const QByteArray &data);
+    /*!
+     *  \brief Ставит в очередь выгрузку всего содержимого.
+     *  \param[in] data Данные всей текстуры.
+     */
+    void setContents(const QByteArray &data);
+    //! \brief Ставит в очередь заполнение текстуры нулями.
+    void clear();
+
+private:
+    //! \brief Строка, ожидающая выгрузки.
+    struct PendingRow
+    {
+        //! \brief Номер строки.
+        int row = 0;
+        //! \brief Данные строки.
+        QByteArray data;
+    };
+
+    //! \brief Возвращает размер пикселя формата в байтах.
+    int bytesPerPixel() const noexcept;
+
+    //! \brief Формат пикселей.
+    QRhiTexture::Format m_format;
+    //! \brief Размер текстуры.
+    QSize m_size;
+    //! \brief Текстура QRhi (создается при первой выгрузке).
+    QRhiTexture *m_texture = nullptr;
+    //! \brief Полное содержимое, ожидающее выгрузки.
+    QByteArray m_pendingContents;
+    //! \brief Строки, ожидающие выгрузки.
+    QList<PendingRow> m_pendingRows;
+};
+
+/*!
+ *  \class WaterfallMaterial
+ *  \brief Материал водопада: текстура истории, палитра и смещение кольца.
+ */
+class WaterfallMaterial : public QSGMaterial
+{
+public:
+    //! \brief Конструирует материал без текстур.
+    WaterfallMaterial();
+    //! \brief Освобождает текстуры.
+    ~WaterfallMaterial() override;
+
+    //! \brief Возвращает тип материала.
+    QSGMaterialType *type() const override;
+    //! \brief Создает шейдер материала.
+    QSGMaterialShader *createShader(QSGRendererInterface::RenderMode renderMode) const override;
+    //! \brief Сравнивает материалы для пакетирования.
+    int compare(const QSGMaterial *other) const override;
+
+    //! \brief Текстура истории (кольцевой буфер строк).
+    WaterfallTexture *history = nullptr;
+    //! \brief Текстура палитры 256x1.
+    WaterfallTexture *lut = nullptr;
+    //! \brief Нормированная позиция следующей записываемой строки.
+    float rowOffset = 0.0f;
+    //! \brief Нормированная высота одной строки.
+    float rowHeight = 1.0f;
+    //! \brief Доля истории, отображаемая по высоте элемента.
+    float visibleFraction = 1.0f;
+};
+
+/*!
+ *  \class WaterfallNode
+ *  \brief Прямоугольник водопада с кольцевой историей на GPU.
+ */
+class WaterfallNode : public QSGGeometryNode
+{
+public:
+    /*!
+     *  \brief Конструирует узел.
+     *  \param[in] columns Ширина истории в отсчетах.
+     *  \param[in] rows Глубина истории в строках.
+     *  \param[in] lut Палитра 256 * RGBA8.
+     */
+    WaterfallNode(int columns, int rows, const QByteArray &lut);
+
+    //! \brief Возвращает ширину истории в отсчетах.
+    int columns() const noexcept { return m_columns; }
+    //! \brief Возвращает глубину истории в строках.
+    int rows() const noexcept { return m_rows; }
+
+    /*!
+     *  \brief Добавляет строку в кольцевой буфер (одна выгрузка строки на GPU).
+     *  \param[in] row Уровни 0..255, columns() байт.
+     */
+    void appendRow(const QByteArray &row);
+    //! \brief Очищает историю.
+    void clear();
+    /*!
+     *  \brief Заменяет историю целиком (одна выгрузка текстуры).
+     *  \param[in] contents Уровни columns() * rows() байт; строки [0, filledRows) от старой к новой.
+     *  \param[in] filledRows Число заполненных строк; следующая строка пишется за ними.
+     */
+    void setHistory(const QByteArray &contents, int filledRows);
+    /*!
+     *  \brief Обновляет геометрию и видимую долю истории.
+     *  \param[in] rect Прямоугольник элемента.
+     */
+    void setRect(const QRectF &rect);
+
+private:
+    //! \brief Обновляет смещение кольца в материале.
+    void updateOffsets();
+
+    //! \brief Материал узла.
+    WaterfallMaterial *m_material = nullptr;
+    //! \brief Ширина истории в отсчетах.
+    int m_columns = 0;
+    //! \brief Глубина истории в строках.
+    int m_rows = 0;
+    //! \brief Номер следующей записываемой строки.
+    int m_head = 0;
+};
+
+#endif // WATERFALLNODE_H
@@ -0,0 +1,25 @@
+// Водопад: кольцевой буфер истории и цветовая палитра (LUT).
+// Строка rowOffset - rowHeight / 2 - самая свежая; вниз по экрану идут
+// более старые строки, прокрутка выполняется только сдвигом координаты.
+#version 440
+
+layout(location = 0) in vec2 v_texCoord;
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    float rowOffset;
+    float rowHeight;
+    float visibleFraction;
+};
+
+layout(binding = 1) uniform sampler2D history;
+layout(binding = 2) uniform sampler2D lut;
+
+void main()
+{
+    float row = fract(rowOffset - rowHeight * 0.5 - v_texCoord.y * visibleFraction);
+    float level = texture(history, vec2(v_texCoord.x, row)).r;
+    fragColor = texture(lut, vec2(level, 0.5)) * qt_Opacity;
+}
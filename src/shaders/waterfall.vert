@@ -0,0 +1,21 @@
+// Водопад: вершинный шейдер прямоугольника с текстурными координатами.
+#version 440
+
+layout(location = 0) in vec4 qt_Vertex;
+layout(location = 1) in vec2 qt_MultiTexCoord0;
+
+layout(location = 0) out vec2 v_texCoord;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    float rowOffset;
+    float rowHeight;
+    float visibleFraction;
+};
+
+void main()
+{
+    v_texCoord = qt_MultiTexCoord0;
+    gl_Position = qt_Matrix * qt_Vertex;
+}
@@ -40,11 +40,25 @@ ApplicationWindow {
             }
         }
 
-        AntInd.AntennaIndicator {
+        ColumnLayout {
             Layout.fillWidth: true
             Layout.fillHeight: true
             Layout.horizontalStretchFactor: 2
             Layout.minimumWidth: 280
+            spacing: 4
+
+            AntInd.AntennaIndicator {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                Layout.verticalStretchFactor: 3
+            }
+
+            Components.SignalTableView {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                Layout.verticalStretchFactor: 2
+                Layout.minimumHeight: 120
+            }
         }
     }
 
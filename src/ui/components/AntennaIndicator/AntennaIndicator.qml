@@ -21,6 +21,13 @@ Item {
         }
     }
 
+    // Пеленгатор переводит углы антенной системы в азимуты по текущему азимуту.
+    Binding {
+        target: SpectrumController.directionFinder
+        property: "antennaAzimuthDeg"
+        value: antennaIndicator.azimuthDeg
+    }
+
     Timer {
         id: timerSendAzimuth
         interval: 100
@@ -104,6 +111,7 @@ Item {
             id: indicator
             azimuthDeg: antennaIndicator.azimuthDeg
             targetAzimuthsDeg: antennaIndicator.activeBearings
+            directionFinder: antennaIndicator.isTestState ? null : SpectrumController.directionFinder
             Layout.fillWidth: true
             Layout.fillHeight: true
             Layout.verticalStretchFactor: 8
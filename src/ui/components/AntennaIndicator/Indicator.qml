@@ -2,12 +2,15 @@ import QtQuick
 import QtQuick.Shapes
 import QtQuick.Layouts
 import QtQuick.Controls
+import SiriusScope 1.0
 
 Item {
     id: indicator
 
     // сырые пеленги (0..359.9); передаются извне для изоляции компонента
     property var targetAzimuthsDeg: []
+    // пеленгатор, пеленги которого сопровождение читает напрямую (null — только targetAzimuthsDeg)
+    property DirectionFinder directionFinder: null
 
 
     // Вход: обновляется хоть каждые 10 мс (0..359.9)
@@ -17,75 +20,26 @@ Item {
     property real beamWidthDeg: 60          // полный угол сектора
     property real innerRadiusRatio: 0.3    // Радиус внутреннего кольца
     property real beamOpacity: 0.45         // базовая прозрачность
-    property real smoothing: 0.1           // 0..1: скорость подтягивания renderAzimuth к latestAzimuth
-    property int renderFps: 60              // частота обновления UI
-
-    // Внутреннее состояние
-    property real _latestAzimuthDeg: 0
-    property real _renderAzimuthDeg: 0
-    property real _tickMs: 0
-
-
-
-    function _norm360(deg) {
-        var a = deg % 360.0
-        if (a < 0) a += 360.0
-        return a
-    }
-
-    // signed delta in [-180, 180]
-    function _deltaDeg(fromDeg, toDeg) {
-        var d = _norm360(toDeg) - _norm360(fromDeg)
-        if (d > 180) d -= 360
-        else if (d < -180) d += 360
-        return d
-    }
-
-    function _updateRenderAzimuth() {
-        var target = _norm360(_latestAzimuthDeg)
-        var cur = _norm360(_renderAzimuthDeg)
-
-        var d = _deltaDeg(cur, target)
-        cur = _norm360(cur + d * smoothing)
-
-        _renderAzimuthDeg = cur
-    }
-
-    onAzimuthDegChanged: {
-        _latestAzimuthDeg = _norm360(azimuthDeg)
-        // первое значение ставим сразу, без "догонялок"
-        if (_tickMs === 0) {
-            _renderAzimuthDeg = _latestAzimuthDeg
-        }
-    }
+    property real smoothing: 0.1           // 0..1: доля подтягивания луча к azimuthDeg за 1/60 с
+    property int renderFps: 60              // частота тактов сопровождения целей
 
+    // Сопровождение целей выполняется в C++ в отдельном потоке; модель
+    // сообщает только об изменившихся трассах.
     TargetTracker {
         id: targetTracker
         maxTargets: 15
         matchThresholdDeg: 4.0
         ttlMs: 12000
         fadeMs: 8000
+        tickIntervalMs: Math.max(16, Math.round(1000 / Math.max(1, indicator.renderFps)))
+        bearings: indicator.targetAzimuthsDeg
+        directionFinder: indicator.directionFinder
     }
 
     function resetTargets() {
         targetTracker.clear()
     }
 
-    Timer {
-        id: renderTimer
-        interval: Math.max(16, Math.round(1000 / Math.max(1, indicator.renderFps)))
-        running: true
-        repeat: true
-        onTriggered: {
-            indicator._tickMs = Date.now()
-            indicator._updateRenderAzimuth()
-
-            // обновляем трекер целей
-            targetTracker.nowMs = indicator._tickMs
-            targetTracker.ingest(indicator.targetAzimuthsDeg)
-        }
-    }
-
     // --- Background / Frame -------------------------------------------------
     Rectangle {
         id: frame
@@ -131,14 +85,7 @@ Item {
                     radius: width / 2
                 }
 
-                // --- Scale parameters (под dial.*) ---
-                readonly property real tickOuterPad: dial.rOuter * 0.03
-                readonly property real majorTickLen: dial.rOuter * 0.085
-                readonly property real midTickLen:   dial.rOuter * 0.055
-                readonly property real minorTickLen: dial.rOuter * 0.032
-                readonly property real labelRadius:  dial.rOuter * 0.80
-                readonly property real targetRadius: dial.rInner + (dial.rOuter - dial.rInner) * 0.55
-
+                readonly property real labelRadius: dial.rOuter * 0.80
 
                 // Функции координат для компасной системы: 0° вверх, 90° вправо
                 function _xAt(radius, deg) {
@@ -150,72 +97,6 @@ Item {
                     return dial.height / 2 - radius * Math.cos(rad)
                 }
 
-                // --- Major ticks (каждые 30°) ---
-                Repeater {
-                    model: 12  // 0..330
-                    Rectangle {
-                        width: 2
-                        height: dial.majorTickLen
-                        radius: 1
-                        color: "#9aa3b1"
-                        opacity: 0.95
-
-                        x: (dial.width - width) / 2
-                        y: dial.tickOuterPad
-                        transform: Rotation {
-                            origin.x: width / 2
-                            origin.y: dial.rOuter - dial.tickOuterPad
-                            angle: index * 30
-                        }
-                    }
-                }
-
-                // --- Medium ticks (каждые 15°, но не 30°) ---
-                Repeater {
-                    model: 24 // 0..345 шаг 15
-                    Rectangle {
-                        readonly property int deg: index * 15
-                        visible: (deg % 30) !== 0
-
-                        width: 2
-                        height: dial.midTickLen
-                        radius: 1
-                        color: "#9aa3b1"
-                        opacity: 0.7
-
-                        x: (dial.width - width) / 2
-                        y: dial.tickOuterPad
-                        transform: Rotation {
-                            origin.x: width / 2
-                            origin.y: dial.rOuter - dial.tickOuterPad
-                            angle: deg
-                        }
-                    }
-                }
-
-                // --- Minor ticks (каждые 5°, но не 15°) ---
-                Repeater {
-                    model: 72 // 0..355 шаг 5
-                    Rectangle {
-                        readonly property int deg: index * 5
-                        visible: (deg % 15) !== 0   // не рисуем поверх 15° и 30° (30 тоже кратно 15)
-
-                        width: 1
-                        height: dial.minorTickLen
-                        radius: 0.5
-                        color: "#9aa3b1"
-                        opacity: 0.55
-
-                        x: (dial.width - width) / 2
-                        y: dial.tickOuterPad
-                        transform: Rotation {
-                            origin.x: width / 2
-                            origin.y: dial.rOuter - dial.tickOuterPad
-                            angle: deg
-                        }
-                    }
-                }
-
                 // --- Angle labels (каждые 30°) ---
                 Repeater {
                     model: 12
@@ -236,7 +117,7 @@ Item {
                     anchors.fill: parent
                     // Входной азимут считаем по часовой (как на компасе),
                     // поэтому: baseRotation + azimuth
-                    rotation: dial.baseRotation + indicator._renderAzimuthDeg
+                    rotation: dial.baseRotation + dialScale.renderAzimuthDeg
                     transformOrigin: Item.Center
 
                     // --- Shadow under beam ---
@@ -403,48 +284,19 @@ Item {
                     }
                 }
 
-                // --- Targets belt -----------------------------------------------------------
-                Item {
-                    id: targetsLayer
+                // --- Риски шкалы и маркеры целей: два узла scene graph ----------------
+                // Геометрия перестраивается только при изменении размеров, набора
+                // трасс или видимой прозрачности маркеров; отображаемый азимут луча
+                // подтягивается по кадрам окна, пока не совпадет с входным.
+                IndicatorDial {
+                    id: dialScale
                     anchors.fill: parent
-
-                    Repeater {
-                        model: targetTracker.tracks.length
-
-                        Item {
-                            readonly property var tr: targetTracker.tracks[index]
-                            readonly property real a: targetTracker.alpha(tr)
-                            readonly property bool freshest: index === 0
-
-                            readonly property real xPos: dial._xAt(dial.targetRadius, tr.az)
-                            readonly property real yPos: dial._yAt(dial.targetRadius, tr.az)
-
-                            // ореол самой свежей
-                            Rectangle {
-                                visible: freshest
-                                width: 14
-                                height: 14
-                                radius: 7
-                                x: xPos - width/2
-                                y: yPos - height/2
-                                color: "transparent"
-                                border.width: 2
-                                border.color: "#2b2f36"
-                                opacity: 0.22
-                            }
-
-                            // маркер цели
-                            Rectangle {
-                                width: freshest ? 8 : 6
-                                height: width
-                                radius: width / 2
-                                x: xPos - width/2
-                                y: yPos - height/2
-                                color: "#2b2f36"
-                                opacity: Math.max(0.10, a)
-                            }
-                        }
-                    }
+                    azimuthDeg: indicator.azimuthDeg
+                    smoothing: indicator.smoothing
+                    innerRadiusRatio: indicator.innerRadiusRatio
+                    tracker: targetTracker
+                    tickColor: "#9aa3b1"
+                    targetColor: "#2b2f36"
                 }
 
 
@@ -1,10 +1,117 @@
 import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import SiriusScope 1.0
 
 Rectangle {
+    id: root
+
+    readonly property string monoFontFamily: "Consolas"
+    property string lastTracePath: ""
+
+    function formatMs(value) {
+        return value < 10 ? value.toFixed(2) : value.toFixed(1)
+    }
+
     anchors {
         bottom: parent.bottom
         left: parent.left
         right: parent.right
     }
     height: parent.height * 1/3
+    color: "#0f131a"
+    border.color: "#2b2f36"
+    border.width: 1
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 8
+        spacing: 6
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 8
+
+            CheckBox {
+                id: profilingToggle
+                text: "Профилирование"
+                checked: PipelineProfiler.enabled
+                onToggled: PipelineProfiler.enabled = checked
+            }
+
+            Button {
+                text: PipelineProfiler.tracing ? "Сохранить трассу" : "Начать трассу"
+                enabled: PipelineProfiler.enabled
+                onClicked: {
+                    if (PipelineProfiler.tracing) {
+                        PipelineProfiler.tracing = false
+                        root.lastTracePath = PipelineProfiler.writeTrace()
+                    } else {
+                        PipelineProfiler.tracing = true
+                    }
+                }
+            }
+
+            Button {
+                text: "Сброс"
+                enabled: PipelineProfiler.enabled
+                onClicked: PipelineProfiler.reset()
+            }
+
+            Text {
+                Layout.fillWidth: true
+                color: "#a5b0bd"
+                font.family: root.monoFontFamily
+                font.pixelSize: 12
+                elide: Text.ElideMiddle
+                text: PipelineProfiler.enabled
+                      ? "кадров/с: " + PipelineProfiler.framesPerSecond.toFixed(1)
+                        + "   пропущено: " + PipelineProfiler.droppedFrames
+                        + (root.lastTracePath.length > 0 ? "   трасса: " + root.lastTracePath : "")
+                      : "Профилирование выключено (SIRIUS_PROFILE=1 включает при запуске)"
+            }
+        }
+
+        GridLayout {
+            Layout.fillWidth: true
+            visible: PipelineProfiler.enabled
+            columns: 5
+            columnSpacing: 16
+            rowSpacing: 2
+
+            Repeater {
+                model: ["этап", "кадров", "p50, мс", "p99, мс", "макс, мс"]
+                delegate: Text {
+                    required property string modelData
+                    text: modelData
+                    color: "#6f7a87"
+                    font.family: root.monoFontFamily
+                    font.pixelSize: 12
+                }
+            }
+
+            Repeater {
+                model: PipelineProfiler.stages
+                delegate: Repeater {
+                    required property var modelData
+                    model: [modelData.name,
+                            String(modelData.count),
+                            root.formatMs(modelData.p50Ms),
+                            root.formatMs(modelData.p99Ms),
+                            root.formatMs(modelData.maxMs)]
+                    delegate: Text {
+                        required property string modelData
+                        text: modelData
+                        color: "#a5b0bd"
+                        font.family: root.monoFontFamily
+                        font.pixelSize: 12
+                    }
+                }
+            }
+        }
+
+        Item {
+            Layout.fillHeight: true
+        }
+    }
 }
@@ -1,5 +1,6 @@
 import QtQuick
 import QtQuick.Controls
+import QtQuick.Dialogs
 import SiriusScope 1.0
 
 MenuBar {
@@ -15,6 +16,13 @@ MenuBar {
         id: appModeGroup
     }
 
+    FileDialog {
+        id: replayDialog
+        title: qsTr("Открыть запись спектра")
+        nameFilters: [qsTr("Запись спектра (*.ssr)")]
+        onAccepted: SpectrumController.openReplay(selectedFile.toString())
+    }
+
     Menu {
         title: qsTr("Режим")
         Action {
@@ -51,7 +59,12 @@ MenuBar {
         Action {
             text: qsTr("Открыть")
             shortcut: StandardKey.Open
-            onTriggered: console.log("Файл->Открыть")
+            onTriggered: replayDialog.open()
+        }
+        Action {
+            text: qsTr("Закрыть запись")
+            enabled: SpectrumController.replayActive
+            onTriggered: SpectrumController.closeReplay()
         }
         Action {
             text: qsTr("Сохранить")
@@ -64,6 +77,18 @@ MenuBar {
             onTriggered: console.log("Файл->Сохранить как...")
         }
         MenuSeparator { }
+        Action {
+            text: qsTr("Запись спектра")
+            checkable: true
+            checked: SpectrumController.recording
+            onTriggered: {
+                if (checked)
+                    SpectrumController.startRecording("")
+                else
+                    SpectrumController.stopRecording()
+            }
+        }
+        MenuSeparator { }
         Action {
             text: qsTr("Выход")
             shortcut: StandardKey.Quit
@@ -0,0 +1,126 @@
+import QtQuick
+import QtQuick.Controls
+import QtQuick.Layouts
+import SiriusScope 1.0
+
+Rectangle {
+    id: root
+
+    readonly property string monoFontFamily: "Consolas"
+    property var columnWidths: [96, 96, 84, 80, 84, 72, 56, 88]
+
+    color: "#0f131a"
+    border.color: "#2b2f36"
+    border.width: 1
+    radius: 4
+
+    ColumnLayout {
+        anchors.fill: parent
+        anchors.margins: 8
+        spacing: 4
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 8
+
+            Text {
+                Layout.fillWidth: true
+                color: "#a5b0bd"
+                font.family: root.monoFontFamily
+                font.pixelSize: 12
+                elide: Text.ElideRight
+                text: "Сигналы: " + SignalTable.count
+                      + (SignalTable.count !== SignalTable.totalCount ? " из " + SignalTable.totalCount : "")
+                      + (SignalTable.droppedBatches > 0 ? "   пропущено пакетов: " + SignalTable.droppedBatches : "")
+            }
+
+            Button {
+                text: "Фильтр: вид"
+                checkable: true
+                onToggled: {
+                    if (checked) {
+                        SignalTable.filterMinHz = FrequencyViewportModel.viewMinHz
+                        SignalTable.filterMaxHz = FrequencyViewportModel.viewMaxHz
+                    } else {
+                        SignalTable.clearFilter()
+                    }
+                }
+            }
+
+            Button {
+                text: "Очистить"
+                onClicked: SignalTable.clear()
+            }
+        }
+
+        HorizontalHeaderView {
+            id: header
+            Layout.fillWidth: true
+            syncView: table
+            clip: true
+
+            delegate: Rectangle {
+                required property int column
+                required property string display
+
+                implicitWidth: root.columnWidths[column]
+                implicitHeight: 22
+                color: "#1a2029"
+
+                Text {
+                    anchors.fill: parent
+                    anchors.leftMargin: 4
+                    verticalAlignment: Text.AlignVCenter
+                    color: "#d6dde6"
+                    font.pixelSize: 12
+                    elide: Text.ElideRight
+                    text: parent.display
+                          + (SignalTable.sortColumn === parent.column
+                             ? (SignalTable.sortOrder === Qt.AscendingOrder ? " ▲" : " ▼") : "")
+                }
+
+                TapHandler {
+                    onTapped: {
+                        var column = parent.column
+                        var order = SignalTable.sortColumn === column && SignalTable.sortOrder === Qt.DescendingOrder
+                                ? Qt.AscendingOrder : Qt.DescendingOrder
+                        SignalTable.sort(column, order)
+                    }
+                }
+            }
+        }
+
+        TableView {
+            id: table
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            clip: true
+            model: SignalTable
+            boundsBehavior: Flickable.StopAtBounds
+            reuseItems: true
+            columnWidthProvider: function(column) { return root.columnWidths[column] }
+
+            ScrollBar.vertical: ScrollBar { }
+
+            delegate: Rectangle {
+                required property int row
+                required property string display
+
+                implicitHeight: 20
+                color: row % 2 === 0 ? "#131922" : "#0f131a"
+
+                Text {
+                    anchors.fill: parent
+                    anchors.leftMargin: 4
+                    anchors.rightMargin: 4
+                    verticalAlignment: Text.AlignVCenter
+                    color: "#c8d0da"
+                    font.family: root.monoFontFamily
+                    font.pixelSize: 12
+                    elide: Text.ElideRight
+                    text: parent.display
+                }
+            }
+        }
+    }
+}
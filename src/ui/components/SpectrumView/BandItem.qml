@@ -25,6 +25,7 @@ Item {
     signal bandEdited(real centerHz, real widthHz, bool isFinal)
     signal thresholdEdited(real thresholdDb, bool isFinal)
     signal enabledEdited(bool enabled, bool isFinal)
+    signal tracesResetRequested()
 
     readonly property real viewSpanHz: Math.max(1.0, viewMaxHz - viewMinHz)
     readonly property real bandMinHz: centerHz - widthHz * 0.5
@@ -253,7 +254,7 @@ Item {
         modal: false
         focus: true
         width: 200
-        height: 120
+        height: 156
         closePolicy: Popup.CloseOnEscape | Popup.CloseOnPressOutside
 
         background: Rectangle {
@@ -307,6 +308,13 @@ Item {
                     font.pixelSize: 10
                 }
             }
+
+            Button {
+                text: "Reset traces"
+                font.family: root.monoFontFamily
+                font.pixelSize: 10
+                onClicked: tracesResetRequested()
+            }
         }
     }
 
@@ -17,41 +17,35 @@ Item {
     readonly property real globalMaxHz: FrequencyViewportModel.globalMaxHz
     property real minSpanHz: 1050e6
     readonly property real maxSpanHz: globalMaxHz - globalMinHz
-    property var rawSamples: []
-    property var decimatedMinMax: []
-    property real pendingRequestMinHz: viewMinHz
-    property real pendingRequestMaxHz: viewMaxHz
+    readonly property int tickCountX: 5
+    readonly property int tickCountY: 5
+    property var bandsSnapshot: []
     property bool spacePressed: false
+    // Трассы обработки поверх спектра (маска SpectrumPlot.Trace*); накапливает их контроллер.
+    property int traceModes: 0
 
-    function scheduleSpectrumRequest() {
-        pendingRequestMinHz = viewMinHz
-        pendingRequestMaxHz = viewMaxHz
-        spectrumRequestTimer.restart()
-    }
-
-    function decimateAndRepaint() {
-        if (plot.width <= 0 || rawSamples.length === 0) {
-            return
-        }
-        decimatedMinMax = SpectrumDecimator.decimateMinMax(rawSamples, Math.floor(plot.width))
-        plot.requestPaint()
-    }
+    onTraceModesChanged: SpectrumController.traceModes = traceModes
 
-    function thresholdForHz(hz) {
-        var threshold = -1e9
+    // Пороги по колонкам считает SpectrumPlot; сюда передается снимок полос
+    // при запуске, а при редактировании — только измененная полоса.
+    function updateBandsSnapshot() {
+        var bands = []
         for (var i = 0; i < bandModel.count; i++) {
             var band = bandModel.get(i)
-            if (!band.enabled) {
-                continue
-            }
-            var half = band.widthHz * 0.5
-            var minHz = band.centerHz - half
-            var maxHz = band.centerHz + half
-            if (hz >= minHz && hz <= maxHz) {
-                threshold = Math.max(threshold, band.thresholdDb)
-            }
+            bands.push({
+                bandId: band.bandId,
+                centerHz: band.centerHz,
+                widthHz: band.widthHz,
+                thresholdDb: band.thresholdDb,
+                enabled: band.enabled
+            })
         }
-        return threshold
+        bandsSnapshot = bands
+    }
+
+    function updatePlotBand(index) {
+        var band = bandModel.get(index)
+        plot.updateBand(band.bandId, band.centerHz, band.widthHz, band.thresholdDb, band.enabled)
     }
 
     function formatHz(valueHz) {
@@ -81,15 +75,6 @@ Item {
         }
     }
 
-    Timer {
-        id: spectrumRequestTimer
-        interval: 50
-        repeat: false
-        onTriggered: {
-            SpectrumController.requestSpectrum(pendingRequestMinHz, pendingRequestMaxHz)
-        }
-    }
-
     ListModel {
         id: bandModel
         ListElement { bandId: 0; centerHz: 3.0e9; widthHz: 5.0e8; thresholdDb: -80; enabled: true }
@@ -101,24 +86,26 @@ Item {
 
     Connections {
         target: SpectrumController
-        function onSpectrumReady(minHz, maxHz, samples, minDbValue, maxDbValue) {
-            if (Math.abs(minHz - viewMinHz) > 1 || Math.abs(maxHz - viewMaxHz) > 1) {
-                return
-            }
-            rawSamples = samples
-            minDb = minDbValue
-            maxDb = maxDbValue
-            decimateAndRepaint()
+        function onSpectrumReady(frame) {
+            // Кадр может быть шире обзора; обзор вырезается SpectrumPlot.
+            minDb = frame.minDb
+            maxDb = frame.maxDb
+            plot.frame = frame
+        }
+        function onTracesReady(traces) {
+            plot.traces = traces
         }
     }
 
-    onViewMinHzChanged: scheduleSpectrumRequest()
-    onViewMaxHzChanged: scheduleSpectrumRequest()
-    onMinDbChanged: plot.requestPaint()
-    onMaxDbChanged: plot.requestPaint()
-
     Component.onCompleted: {
-        scheduleSpectrumRequest()
+        updateBandsSnapshot()
+        // Начальные полосы передаются контроллеру для обнаружения сигналов.
+        for (var i = 0; i < bandModel.count; i++) {
+            var band = bandModel.get(i)
+            SpectrumController.setBand(band.bandId, band.centerHz, band.widthHz, true)
+            SpectrumController.setBandThreshold(band.bandId, band.thresholdDb, true)
+            SpectrumController.setBandEnabled(band.bandId, band.enabled)
+        }
     }
 
     Rectangle {
@@ -133,96 +120,79 @@ Item {
             anchors.fill: parent
             anchors.margins: 8
 
-            Canvas {
+            SpectrumPlot {
                 id: plot
                 anchors.fill: parent
+                viewMinHz: root.viewMinHz
+                viewMaxHz: root.viewMaxHz
+                minDb: root.minDb
+                maxDb: root.maxDb
+                gridColumns: root.tickCountX
+                gridRows: root.tickCountY
+                gridColor: "#222a33"
+                traceColor: "#4ea1ff"
+                bands: root.bandsSnapshot
+            }
 
-                onPaint: {
-                    var ctx = getContext("2d")
-                    ctx.clearRect(0, 0, width, height)
-
-                    ctx.fillStyle = "#0f131a"
-                    ctx.fillRect(0, 0, width, height)
-
-                    var spanHz = Math.max(1.0, viewMaxHz - viewMinHz)
-                    var dbSpan = Math.max(1.0, maxDb - minDb)
-
-                    ctx.strokeStyle = "#222a33"
-                    ctx.lineWidth = 1
-
-                    var tickCountX = 5
-                    var tickCountY = 5
-
-                    for (var i = 0; i < tickCountX; i++) {
-                        var x = (i / (tickCountX - 1)) * width
-                        ctx.beginPath()
-                        ctx.moveTo(x, 0)
-                        ctx.lineTo(x, height)
-                        ctx.stroke()
-                    }
-
-                    for (var j = 0; j < tickCountY; j++) {
-                        var y = (j / (tickCountY - 1)) * height
-                        ctx.beginPath()
-                        ctx.moveTo(0, y)
-                        ctx.lineTo(width, y)
-                        ctx.stroke()
-                    }
-
-                    ctx.fillStyle = "#a5b0bd"
-                    ctx.font = "10px " + root.monoFontFamily
-                    ctx.textAlign = "center"
-                    ctx.textBaseline = "bottom"
-
-                    for (var t = 0; t < tickCountX; t++) {
-                        var fx = viewMinHz + (t / (tickCountX - 1)) * spanHz
-                        var label = formatHz(fx)
-                        var lx = (t / (tickCountX - 1)) * width
-                        ctx.fillText(label, lx, height - 2)
+            Row {
+                anchors.top: parent.top
+                anchors.right: parent.right
+                anchors.margins: 4
+                spacing: 4
+                z: 3
+
+                Repeater {
+                    model: [
+                        { label: "AVG", mode: SpectrumPlot.TraceAverage },
+                        { label: "MAX", mode: SpectrumPlot.TraceMaxHold },
+                        { label: "MIN", mode: SpectrumPlot.TraceMinHold },
+                        { label: "PEAK", mode: SpectrumPlot.TracePeakDecay }
+                    ]
+                    delegate: CheckBox {
+                        required property var modelData
+                        text: modelData.label
+                        font.family: root.monoFontFamily
+                        font.pixelSize: 10
+                        checked: (root.traceModes & modelData.mode) !== 0
+                        onToggled: root.traceModes = checked
+                                   ? (root.traceModes | modelData.mode)
+                                   : (root.traceModes & ~modelData.mode)
                     }
+                }
 
-                    ctx.textAlign = "left"
-                    ctx.textBaseline = "middle"
-                    for (var ty = 0; ty < tickCountY; ty++) {
-                        var db = maxDb - (ty / (tickCountY - 1)) * dbSpan
-                        var ly = (ty / (tickCountY - 1)) * height
-                        ctx.fillText(db.toFixed(0) + " dB", 4, ly)
-                    }
+                Button {
+                    text: "Reset"
+                    font.family: root.monoFontFamily
+                    font.pixelSize: 10
+                    enabled: root.traceModes !== 0
+                    // Сбрасывается только видимый диапазон.
+                    onClicked: SpectrumController.resetTraces(root.viewMinHz, root.viewMaxHz)
+                }
+            }
 
-                    if (decimatedMinMax.length < 2) {
-                        return
-                    }
+            Repeater {
+                model: root.tickCountX
+                delegate: Text {
+                    readonly property real ratio: index / (root.tickCountX - 1)
+                    x: ratio * plot.width - width * 0.5
+                    y: plot.height - 2 - height
+                    text: formatHz(root.viewMinHz + ratio * (root.viewMaxHz - root.viewMinHz))
+                    color: "#a5b0bd"
+                    font.family: root.monoFontFamily
+                    font.pixelSize: 10
+                }
+            }
 
-                    ctx.strokeStyle = "#4ea1ff"
-                    ctx.lineWidth = 1
-
-                    for (var px = 0; px < width; px++) {
-                        var idx = px * 2
-                        if (idx + 1 >= decimatedMinMax.length) {
-                            break
-                        }
-                        var minVal = decimatedMinMax[idx]
-                        var maxVal = decimatedMinMax[idx + 1]
-                        var freqHz = viewMinHz + (px / width) * spanHz
-                        var bandThreshold = thresholdForHz(freqHz)
-
-                        if (bandThreshold > -1e8) {
-                            if (maxVal < bandThreshold) {
-                                continue
-                            }
-                            if (minVal < bandThreshold) {
-                                minVal = bandThreshold
-                            }
-                        }
-
-                        var yMin = height - (minVal - minDb) / dbSpan * height
-                        var yMax = height - (maxVal - minDb) / dbSpan * height
-
-                        ctx.beginPath()
-                        ctx.moveTo(px + 0.5, yMin)
-                        ctx.lineTo(px + 0.5, yMax)
-                        ctx.stroke()
-                    }
+            Repeater {
+                model: root.tickCountY
+                delegate: Text {
+                    readonly property real ratio: index / (root.tickCountY - 1)
+                    x: 4
+                    y: ratio * plot.height - height * 0.5
+                    text: (root.maxDb - ratio * Math.max(1.0, root.maxDb - root.minDb)).toFixed(0) + " dB"
+                    color: "#a5b0bd"
+                    font.family: root.monoFontFamily
+                    font.pixelSize: 10
                 }
             }
 
@@ -321,30 +291,22 @@ Item {
                     onBandEdited: (nextCenter, nextWidth, isFinal) => {
                         bandModel.setProperty(index, "centerHz", nextCenter)
                         bandModel.setProperty(index, "widthHz", nextWidth)
-                        plot.requestPaint()
+                        root.updatePlotBand(index)
                     }
 
                     onThresholdEdited: (nextThreshold, isFinal) => {
                         bandModel.setProperty(index, "thresholdDb", nextThreshold)
-                        plot.requestPaint()
+                        root.updatePlotBand(index)
                     }
 
                     onEnabledEdited: (nextEnabled, isFinal) => {
                         bandModel.setProperty(index, "enabled", nextEnabled)
-                        plot.requestPaint()
+                        root.updatePlotBand(index)
                     }
+
+                    onTracesResetRequested: SpectrumController.resetTraces(bandMinHz, bandMaxHz)
                 }
             }
         }
     }
-
-    Connections {
-        target: plot
-        function onWidthChanged() {
-            decimateAndRepaint()
-        }
-        function onHeightChanged() {
-            plot.requestPaint()
-        }
-    }
 }
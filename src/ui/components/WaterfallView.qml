@@ -7,41 +7,49 @@ Item {
     id: root
 
     property bool running: false
-    property bool busy: false
-    property real fps: 0
+    property bool busy: waterfall.busy
+    property real fps: waterfall.rowRateHz
     property real centerFrequency: 0
     property real viewMinHz: FrequencyViewportModel.viewMinHz
     property real viewMaxHz: FrequencyViewportModel.viewMaxHz
+    property alias historyDepth: waterfall.historyDepth
+    property alias minDb: waterfall.minDb
+    property alias maxDb: waterfall.maxDb
+    // Бюджеты истории водопада: память горячих плиток и диск холодных (0 — без диска).
+    property alias historyHotBytes: waterfall.historyHotBytes
+    property alias historyColdBytes: waterfall.historyColdBytes
+    // Кадры записи не смешиваются с живой историей: смена источника начинает историю заново.
+    property bool replayActive: SpectrumController.replayActive
+
+    onReplayActiveChanged: waterfall.clear()
 
     Rectangle {
         id: frame
         anchors.fill: parent
-        color: "#f3f4f6"
-        border.color: "#b5bcc7"
+        color: "#0f131a"
+        border.color: "#2b2f36"
         border.width: 1
         radius: 4
     }
 
-    ColumnLayout {
+    Waterfall {
+        id: waterfall
         anchors.fill: parent
-        anchors.margins: 12
-        spacing: 6
-
-        Label {
-            text: qsTr("Водопад (заготовка)")
-            font.bold: true
-            color: "#2b2f36"
-        }
-
-        Label {
-            text: qsTr("Здесь будет спектрально-временная визуализация.")
-            color: "#5a6270"
-            wrapMode: Text.WordWrap
-        }
+        anchors.margins: 8
+        historyDepth: 2048
+        binsPerRow: 2048
+        minDb: -120
+        maxDb: -20
+        historyHotBytes: 256 * 1024 * 1024
+        historyColdBytes: 4 * 1024 * 1024 * 1024
+        viewMinHz: root.viewMinHz
+        viewMaxHz: root.viewMaxHz
+    }
 
-        Item {
-            Layout.fillWidth: true
-            Layout.fillHeight: true
+    Connections {
+        target: SpectrumController
+        function onSpectrumReady(frame) {
+            waterfall.pushFrame(frame)
         }
     }
 }